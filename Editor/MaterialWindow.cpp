@@ -419,7 +419,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->baseColorMap = wiResourceManager::Load(fileName);
+				material->baseColorMap = wiResourceManager::Load(fileName, wiResourceManager::LOAD_COLOR);
 				material->baseColorMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -667,7 +667,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->emissiveMap = wiResourceManager::Load(fileName);
+				material->emissiveMap = wiResourceManager::Load(fileName, wiResourceManager::LOAD_COLOR);
 				material->emissiveMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
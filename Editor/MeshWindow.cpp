@@ -16,7 +16,7 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 
 
 	meshWindow = new wiWindow(GUI, "Mesh Window");
-	meshWindow->SetSize(XMFLOAT2(800, 700));
+	meshWindow->SetSize(XMFLOAT2(800, 930));
 	GUI->AddWidget(meshWindow);
 
 	float x = 200;
@@ -42,6 +42,19 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	});
 	meshWindow->AddWidget(doubleSidedCheckBox);
 
+	quantizedCheckBox = new wiCheckBox("Quantized: ");
+	quantizedCheckBox->SetTooltip("If enabled, the mesh will be rendered and saved with compressed vertex data (16-bit positions, octahedral normals, 8-bit bone weights when saved).");
+	quantizedCheckBox->SetPos(XMFLOAT2(x, y += step));
+	quantizedCheckBox->OnClick([&](wiEventArgs args) {
+		MeshComponent* mesh = wiScene::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->SetQuantized(args.bValue);
+			mesh->CreateRenderData();
+		}
+	});
+	meshWindow->AddWidget(quantizedCheckBox);
+
 	softbodyCheckBox = new wiCheckBox("Soft body: ");
 	softbodyCheckBox->SetTooltip("Enable soft body simulation.");
 	softbodyCheckBox->SetPos(XMFLOAT2(x, y += step));
@@ -220,6 +233,81 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	});
 	meshWindow->AddWidget(recenterToBottomButton);
 
+	generateLODsButton = new wiButton("Generate LODs");
+	generateLODsButton->SetTooltip("Generate 4 levels of detail with mesh simplification. Every LOD has half the triangles of the previous one.");
+	generateLODsButton->SetSize(XMFLOAT2(240, 30));
+	generateLODsButton->SetPos(XMFLOAT2(x - 50, y += step));
+	generateLODsButton->OnClick([&](wiEventArgs args) {
+		MeshComponent* mesh = wiScene::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->GenerateLODs(4);
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(generateLODsButton);
+
+	clearLODsButton = new wiButton("Clear LODs");
+	clearLODsButton->SetTooltip("Remove levels of detail, only the full detail mesh is kept.");
+	clearLODsButton->SetSize(XMFLOAT2(240, 30));
+	clearLODsButton->SetPos(XMFLOAT2(x - 50, y += step));
+	clearLODsButton->OnClick([&](wiEventArgs args) {
+		MeshComponent* mesh = wiScene::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->ClearLODs();
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(clearLODsButton);
+
+	optimizeButton = new wiButton("Optimize");
+	optimizeButton->SetTooltip("Reorder triangles and vertices for better vertex cache utilization, less overdraw and vertex fetch locality.\nMeshes with soft body physics are not optimized, disable the soft body first.");
+	optimizeButton->SetSize(XMFLOAT2(240, 30));
+	optimizeButton->SetPos(XMFLOAT2(x - 50, y += step));
+	optimizeButton->OnClick([&](wiEventArgs args) {
+		Scene& scene = wiScene::GetScene();
+		if (scene.meshes.Contains(entity))
+		{
+			if (!scene.OptimizeMesh(entity))
+			{
+				wiBackLog::post("Mesh optimization skipped: the mesh has soft body physics, disable the soft body first!");
+				return;
+			}
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(optimizeButton);
+
+	optimizeAllButton = new wiButton("Optimize All Meshes");
+	optimizeAllButton->SetTooltip("Optimize every mesh of the scene like the Optimize button does.\nMeshes with soft body physics are skipped.");
+	optimizeAllButton->SetSize(XMFLOAT2(240, 30));
+	optimizeAllButton->SetPos(XMFLOAT2(x - 50, y += step));
+	optimizeAllButton->OnClick([&](wiEventArgs args) {
+		Scene& scene = wiScene::GetScene();
+		const size_t count = scene.OptimizeMeshes();
+		if (count < scene.meshes.GetCount())
+		{
+			wiBackLog::post(("Mesh optimization skipped " + std::to_string(scene.meshes.GetCount() - count) + " meshes with soft body physics").c_str());
+		}
+		SetEntity(entity);
+	});
+	meshWindow->AddWidget(optimizeAllButton);
+
+	meshletsButton = new wiButton("Create Meshlets");
+	meshletsButton->SetTooltip("Split the mesh into small triangle clusters that can be culled individually by the renderer.");
+	meshletsButton->SetSize(XMFLOAT2(240, 30));
+	meshletsButton->SetPos(XMFLOAT2(x - 50, y += step));
+	meshletsButton->OnClick([&](wiEventArgs args) {
+		MeshComponent* mesh = wiScene::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->CreateMeshlets();
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(meshletsButton);
+
 
 
 
@@ -254,6 +342,10 @@ void MeshWindow::SetEntity(Entity entity)
 		ss << "Vertex count: " << mesh->vertex_positions.size() << endl;
 		ss << "Index count: " << mesh->indices.size() << endl;
 		ss << "Subset count: " << mesh->subsets.size() << endl;
+		ss << "LOD count: " << mesh->GetLODCount() << endl;
+		ss << "Meshlet count: " << mesh->meshlets.size() << endl;
+		const wiMeshOptimizer::VertexCacheStatistics vcache = wiMeshOptimizer::AnalyzeVertexCache(mesh->indices.data(), mesh->GetBaseIndexCount(), mesh->vertex_positions.size());
+		ss << "Vertex cache: ACMR = " << vcache.acmr << ", ATVR = " << vcache.atvr << endl;
 		ss << endl << "Vertex buffers: ";
 		if (mesh->vertexBuffer_POS != nullptr) ss << "position; ";
 		if (mesh->vertexBuffer_UV0 != nullptr) ss << "uvset_0; ";
@@ -266,6 +358,7 @@ void MeshWindow::SetEntity(Entity entity)
 		meshInfoLabel->SetText(ss.str());
 
 		doubleSidedCheckBox->SetCheck(mesh->IsDoubleSided());
+		quantizedCheckBox->SetCheck(mesh->IsQuantized());
 
 		const ImpostorComponent* impostor = scene.impostors.GetComponent(entity);
 		if (impostor != nullptr)
@@ -21,6 +21,7 @@ public:
 	wiWindow*	meshWindow;
 	wiLabel*	meshInfoLabel;
 	wiCheckBox* doubleSidedCheckBox;
+	wiCheckBox* quantizedCheckBox;
 	wiCheckBox* softbodyCheckBox;
 	wiSlider*	massSlider;
 	wiSlider*	frictionSlider;
@@ -33,5 +34,10 @@ public:
 	wiButton*	computeNormalsHardButton;
 	wiButton*	recenterButton;
 	wiButton*	recenterToBottomButton;
+	wiButton*	generateLODsButton;
+	wiButton*	clearLODsButton;
+	wiButton*	optimizeButton;
+	wiButton*	optimizeAllButton;
+	wiButton*	meshletsButton;
 };
 
@@ -686,7 +686,7 @@ void ImportModel_GLTF(const std::string& fileName, Scene& scene)
 
 		}
 
-		mesh.CreateRenderData();
+		mesh.Optimize(); // also creates render data
 	}
 
 	// Create armatures:
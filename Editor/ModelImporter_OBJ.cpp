@@ -70,7 +70,7 @@ void ImportModel_OBJ(const std::string& fileName, Scene& scene)
 			}
 			if (!material.baseColorMapName.empty())
 			{
-				material.baseColorMap = wiResourceManager::Load(directory + material.baseColorMapName);
+				material.baseColorMap = wiResourceManager::Load(directory + material.baseColorMapName, wiResourceManager::LOAD_COLOR);
 			}
 			if (!material.normalMapName.empty())
 			{
@@ -181,7 +181,7 @@ void ImportModel_OBJ(const std::string& fileName, Scene& scene)
 					mesh.subsets.back().indexCount++;
 				}
 			}
-			mesh.CreateRenderData();
+			mesh.Optimize(); // also creates render data
 		}
 
 		scene.Update(0);
@@ -71,6 +71,9 @@ static Atlas_Dim GenerateMeshAtlas(MeshComponent& meshcomponent, uint32_t resolu
 {
 	Atlas_Dim dim;
 
+	// The vertices will be rebuilt, so LODs would be invalid:
+	meshcomponent.ClearLODs();
+
 	xatlas::Atlas* atlas = xatlas::Create();
 
 	// Prepare mesh to be processed by xatlas:
@@ -16,7 +16,7 @@ RendererWindow::RendererWindow(wiGUI* gui, EditorComponent* editorcomponent, Ren
 	wiRenderer::SetToDrawDebugCameras(true);
 
 	rendererWindow = new wiWindow(GUI, "Renderer Window");
-	rendererWindow->SetSize(XMFLOAT2(640, 790));
+	rendererWindow->SetSize(XMFLOAT2(640, 820));
 	GUI->AddWidget(rendererWindow);
 
 	float x = 260, y = 20, step = 30;
@@ -164,6 +164,15 @@ RendererWindow::RendererWindow(wiGUI* gui, EditorComponent* editorcomponent, Ren
 	debugLightCullingCheckBox->SetCheck(wiRenderer::GetDebugLightCulling());
 	rendererWindow->AddWidget(debugLightCullingCheckBox);
 
+	clusteredLightCullingCheckBox = new wiCheckBox("Clustered Light Culling: ");
+	clusteredLightCullingCheckBox->SetTooltip("Forward renderer will use light clusters computed on the CPU instead of per object light lists. This lifts the 64 light per object limit (Forward renderer only)");
+	clusteredLightCullingCheckBox->SetPos(XMFLOAT2(x, y += step));
+	clusteredLightCullingCheckBox->OnClick([](wiEventArgs args) {
+		wiRenderer::SetClusteredLightCullingEnabled(args.bValue);
+	});
+	clusteredLightCullingCheckBox->SetCheck(wiRenderer::GetClusteredLightCullingEnabled());
+	rendererWindow->AddWidget(clusteredLightCullingCheckBox);
+
 	tessellationCheckBox = new wiCheckBox("Tessellation Enabled: ");
 	tessellationCheckBox->SetTooltip("Enable tessellation feature. You also need to specify a tessellation factor for individual objects.");
 	tessellationCheckBox->SetPos(XMFLOAT2(x, y += step));
@@ -53,6 +53,7 @@ public:
 	wiCheckBox* wireFrameCheckBox;
 	wiCheckBox* advancedLightCullingCheckBox;
 	wiCheckBox* debugLightCullingCheckBox;
+	wiCheckBox* clusteredLightCullingCheckBox;
 	wiCheckBox* tessellationCheckBox;
 	wiCheckBox* advancedRefractionsCheckBox;
 	wiCheckBox* alphaCompositionCheckBox;
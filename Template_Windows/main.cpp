@@ -164,6 +164,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 				int width = LOWORD(lParam);
 				int height = HIWORD(lParam);
 
+				main.SyncRender(); // the render thread of pipelined mode can be presenting
 				wiRenderer::GetDevice()->SetResolution(width, height);
 				wiRenderer::GetCamera().CreatePerspective((float)wiRenderer::GetInternalResolution().x, (float)wiRenderer::GetInternalResolution().y, 0.1f, 800);
 			}
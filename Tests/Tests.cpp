@@ -1,9 +1,12 @@
 #include "stdafx.h"
 #include "Tests.h"
+#include "Vector_BindLua.h"
 
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <cstdio>
+#include <random>
 
 using namespace wiScene;
 
@@ -107,6 +110,31 @@ TestsRenderer::TestsRenderer()
 	testSelector->AddItem("Lightmap Bake Test");
 	testSelector->AddItem("Network Test");
 	testSelector->AddItem("Controller Test");
+	testSelector->AddItem("Clustered Culling Test");
+	testSelector->AddItem("Atlas Allocator Test");
+	testSelector->AddItem("Material Atlas Test");
+	testSelector->AddItem("Mesh LOD Test");
+	testSelector->AddItem("Mesh Optimizer Test");
+	testSelector->AddItem("Meshlet Culling Test");
+	testSelector->AddItem("Vertex Quantization Test");
+	testSelector->AddItem("Texture Compression Test");
+	testSelector->AddItem("Texture Loading Test");
+	testSelector->AddItem("Virtual Texture Test");
+	testSelector->AddItem("Physics Multithreading Test");
+	testSelector->AddItem("Physics Shape Cache Test");
+	testSelector->AddItem("Physics Query Test");
+	testSelector->AddItem("Physics Fixed Timestep Test");
+	testSelector->AddItem("Emitted Particle CPU Test");
+	testSelector->AddItem("Hair Particle CPU Test");
+	testSelector->AddItem("Ocean CPU Test");
+	testSelector->AddItem("Random Test");
+	testSelector->AddItem("Lua Script Pool Test");
+	testSelector->AddItem("Lua Binding Test");
+	testSelector->AddItem("Network Loopback Test");
+	testSelector->AddItem("Replication Test");
+	testSelector->AddItem("Audio Mixer Test");
+	testSelector->AddItem("Frame Pipeline Test");
+	testSelector->AddItem("Frame Pacing Test");
 	testSelector->SetMaxVisibleItemCount(10);
 	testSelector->OnSelect([=](wiEventArgs args) {
 
@@ -216,6 +244,81 @@ TestsRenderer::TestsRenderer()
 			wiInput::SetControllerFeedback(feedback, 0);
 		}
 		break;
+		case 17:
+			RunClusteredCullingTest();
+			break;
+		case 18:
+			RunAtlasAllocatorTest();
+			break;
+		case 19:
+			RunMaterialAtlasTest();
+			break;
+		case 20:
+			RunMeshLODTest();
+			break;
+		case 21:
+			RunMeshOptimizerTest();
+			break;
+		case 22:
+			RunMeshletCullingTest();
+			break;
+		case 23:
+			RunVertexQuantizationTest();
+			break;
+		case 24:
+			RunTextureCompressionTest();
+			break;
+		case 25:
+			RunTextureLoadingTest();
+			break;
+		case 26:
+			RunVirtualTextureTest();
+			break;
+		case 27:
+			RunPhysicsMultithreadingTest();
+			break;
+		case 28:
+			RunPhysicsShapeCacheTest();
+			break;
+		case 29:
+			RunPhysicsQueryTest();
+			break;
+		case 30:
+			RunPhysicsFixedTimestepTest();
+			break;
+		case 31:
+			RunEmittedParticleCPUTest();
+			break;
+		case 32:
+			RunHairParticleCPUTest();
+			break;
+		case 33:
+			RunOceanCPUTest();
+			break;
+		case 34:
+			RunRandomTest();
+			break;
+		case 35:
+			RunScriptPoolTest();
+			break;
+		case 36:
+			RunLuaBindingTest();
+			break;
+		case 37:
+			RunNetworkLoopbackTest();
+			break;
+		case 38:
+			RunReplicationTest();
+			break;
+		case 39:
+			RunAudioMixerTest();
+			break;
+		case 40:
+			RunFramePipelineTest();
+			break;
+		case 41:
+			RunFramePacingTest();
+			break;
 		default:
 			assert(0);
 			break;
@@ -302,6 +405,3472 @@ void TestsRenderer::RunJobSystemTest()
 	font.params.size = 24;
 	this->addFont(&font);
 }
+void TestsRenderer::RunClusteredCullingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Clustered culling performance test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunClusteredCullingTest() function." << std::endl << std::endl;
+
+	CameraComponent camera;
+	camera.width = (float)wiRenderer::GetInternalResolution().x;
+	camera.height = (float)wiRenderer::GetInternalResolution().y;
+	camera.UpdateCamera();
+
+	wiClusteredCulling::ClusterGrid grid;
+	ss << "Cluster grid: " << grid.tileCountX << " x " << grid.tileCountY << " x " << grid.sliceCount << std::endl << std::endl;
+
+	const int iterations = 10;
+	for (uint32_t lightCount = 1024; lightCount <= 16384; lightCount *= 2)
+	{
+		// Random point lights scattered in front of the camera:
+		std::vector<SPHERE> lights(lightCount);
+		for (auto& light : lights)
+		{
+			light.center.x = (float)wiRandom::getRandom(-100, 100);
+			light.center.y = (float)wiRandom::getRandom(-20, 20);
+			light.center.z = (float)wiRandom::getRandom(0, 200);
+			light.radius = (float)wiRandom::getRandom(1, 8);
+		}
+
+		wiClusteredCulling::EntityList entities[wiClusteredCulling::CATEGORY_COUNT];
+		entities[wiClusteredCulling::CATEGORY_LIGHT].spheres = lights.data();
+		entities[wiClusteredCulling::CATEGORY_LIGHT].count = lightCount;
+
+		// First build allocates memory, it is not measured:
+		wiClusteredCulling::Build(grid, camera.View, camera.Projection, camera.zNearP, camera.zFarP, entities);
+
+		timer.record();
+		for (int i = 0; i < iterations; ++i)
+		{
+			wiClusteredCulling::Build(grid, camera.View, camera.Projection, camera.zNearP, camera.zFarP, entities);
+		}
+		double time = timer.elapsed() / iterations;
+
+		uint32_t maxCount = 0;
+		for (uint32_t i = 0; i < grid.GetClusterCount(); ++i)
+		{
+			maxCount = std::max(maxCount, grid.GetItemCount(i, wiClusteredCulling::CATEGORY_LIGHT));
+		}
+
+		ss << lightCount << " lights: " << time << " milliseconds, " << grid.items.size() << " cluster items, max " << maxCount << " lights in a cluster" << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunAtlasAllocatorTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Atlas allocator churn test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunAtlasAllocatorTest() function." << std::endl << std::endl;
+
+	// Every step removes a random region and inserts a new one, like when decals are streamed in and out:
+	const uint32_t regionCount = 1000;
+	const uint32_t churnCount = 10000;
+	const uint32_t maxSize = 16384;
+
+	std::vector<wiRectPacker::rect_xywh> sizes(regionCount + churnCount);
+	for (auto& x : sizes)
+	{
+		x = wiRectPacker::rect_xywh(0, 0, wiRandom::getRandom(16, 256), wiRandom::getRandom(16, 256));
+	}
+	std::vector<uint32_t> removals(churnCount);
+	for (auto& x : removals)
+	{
+		x = (uint32_t)wiRandom::getRandom((int)regionCount - 1);
+	}
+
+	// Persistent allocator:
+	{
+		wiAtlasAllocator allocator;
+		std::vector<wiRectPacker::rect_xywh> regions(sizes.begin(), sizes.begin() + regionCount);
+
+		timer.record();
+		for (auto& region : regions)
+		{
+			allocator.Allocate(region, maxSize);
+		}
+		double time = timer.elapsed();
+		ss << "wiAtlasAllocator: " << regionCount << " inserts took " << time << " milliseconds" << std::endl;
+
+		uint32_t defragCount = 0;
+		timer.record();
+		for (uint32_t i = 0; i < churnCount; ++i)
+		{
+			wiRectPacker::rect_xywh& region = regions[removals[i]];
+			allocator.Free(region);
+			region = sizes[regionCount + i];
+			if (!allocator.Allocate(region, maxSize))
+			{
+				std::vector<wiRectPacker::rect_xywh*> rects(regions.size());
+				for (size_t j = 0; j < regions.size(); ++j)
+				{
+					rects[j] = &regions[j];
+				}
+				allocator.Defragment(rects.data(), rects.size(), maxSize);
+				defragCount++;
+			}
+		}
+		time = timer.elapsed();
+		ss << "wiAtlasAllocator: " << churnCount << " remove + insert took " << time << " milliseconds (" << defragCount << " defragmentations)" << std::endl;
+		ss << "    atlas: " << allocator.GetWidth() << " x " << allocator.GetHeight() << ", occupancy: " << allocator.GetOccupancy() * 100 << "%" << std::endl;
+
+		timer.record();
+		std::vector<wiRectPacker::rect_xywh*> rects(regions.size());
+		for (size_t j = 0; j < regions.size(); ++j)
+		{
+			rects[j] = &regions[j];
+		}
+		allocator.Defragment(rects.data(), rects.size(), maxSize);
+		time = timer.elapsed();
+		ss << "wiAtlasAllocator: Defragment() took " << time << " milliseconds" << std::endl;
+		ss << "    atlas: " << allocator.GetWidth() << " x " << allocator.GetHeight() << ", occupancy: " << allocator.GetOccupancy() * 100 << "%" << std::endl << std::endl;
+	}
+
+	// Full repack on every change, for reference (only a fraction of the churn steps are measured, because this is slow):
+	{
+		const uint32_t repackCount = churnCount / 100;
+		std::vector<wiRectPacker::rect_xywh> regions(sizes.begin(), sizes.begin() + regionCount);
+		std::vector<wiRectPacker::rect_xywh*> rects(regions.size());
+		for (size_t j = 0; j < regions.size(); ++j)
+		{
+			rects[j] = &regions[j];
+		}
+
+		timer.record();
+		for (uint32_t i = 0; i < repackCount; ++i)
+		{
+			regions[removals[i]] = sizes[regionCount + i];
+			std::vector<wiRectPacker::bin> bins;
+			wiRectPacker::pack(rects.data(), (int)rects.size(), maxSize, bins);
+		}
+		double time = timer.elapsed();
+		ss << "wiRectPacker::pack(): " << repackCount << " remove + insert took " << time << " milliseconds" << std::endl;
+		ss << "    estimated for " << churnCount << ": " << time * (churnCount / repackCount) << " milliseconds" << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunMaterialAtlasTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Material atlas streaming test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunMaterialAtlasTest() function." << std::endl << std::endl;
+
+	// Materials reference 4 textures each from a shared texture pool, materials are streamed in and out randomly:
+	const uint32_t textureCount = 2000;
+	const uint32_t materialCount = 1000;
+	const uint32_t residentCount = 500;
+	const uint32_t churnCount = 10000;
+
+	struct TextureInfo
+	{
+		uint32_t width, height;
+	};
+	std::vector<TextureInfo> textures(textureCount);
+	for (auto& x : textures)
+	{
+		x.width = 1u << wiRandom::getRandom(4, 8);
+		x.height = 1u << wiRandom::getRandom(4, 8);
+	}
+	struct MaterialInfo
+	{
+		uint32_t textures[4];
+	};
+	std::vector<MaterialInfo> materials(materialCount);
+	for (auto& x : materials)
+	{
+		for (auto& t : x.textures)
+		{
+			t = (uint32_t)wiRandom::getRandom((int)textureCount - 1);
+		}
+	}
+
+	wiAtlasCache atlas;
+	uint64_t copiedTexels = 0;
+	auto streamIn = [&](uint32_t materialIndex) {
+		atlas.Update(); // every change is a new frame
+		for (uint32_t t : materials[materialIndex].textures)
+		{
+			atlas.AddRef(&textures[t], textures[t].width, textures[t].height);
+		}
+		if (atlas.IsFullRefreshNeeded())
+		{
+			copiedTexels += atlas.GetAllocator().GetAllocatedArea();
+		}
+		else
+		{
+			for (const void* key : atlas.GetDirtyEntries())
+			{
+				const TextureInfo* texture = (const TextureInfo*)key;
+				copiedTexels += texture->width * texture->height;
+			}
+		}
+		atlas.ClearDirty();
+	};
+	auto streamOut = [&](uint32_t materialIndex) {
+		for (uint32_t t : materials[materialIndex].textures)
+		{
+			atlas.Release(&textures[t]);
+		}
+	};
+
+	std::vector<uint32_t> resident(residentCount);
+	for (uint32_t i = 0; i < residentCount; ++i)
+	{
+		resident[i] = i;
+	}
+
+	timer.record();
+	for (uint32_t materialIndex : resident)
+	{
+		streamIn(materialIndex);
+	}
+	double time = timer.elapsed();
+	ss << "wiAtlasCache: streaming in " << residentCount << " materials took " << time << " milliseconds" << std::endl;
+
+	copiedTexels = 0;
+	timer.record();
+	for (uint32_t i = 0; i < churnCount; ++i)
+	{
+		// Replace a random resident material with a random material:
+		uint32_t& slot = resident[wiRandom::getRandom((int)residentCount - 1)];
+		streamOut(slot);
+		slot = (uint32_t)wiRandom::getRandom((int)materialCount - 1);
+		streamIn(slot);
+	}
+	time = timer.elapsed();
+	ss << "wiAtlasCache: " << churnCount << " material stream out + in took " << time << " milliseconds" << std::endl;
+	ss << "    atlas: " << atlas.GetWidth() << " x " << atlas.GetHeight() << ", entries: " << atlas.GetEntryCount() << ", occupancy: " << atlas.GetAllocator().GetOccupancy() * 100 << "%" << std::endl;
+	ss << "    copied texels per change: " << copiedTexels / churnCount << std::endl;
+	ss << "    full repack would copy: " << atlas.GetAllocator().GetAllocatedArea() << " texels per change" << std::endl;
+
+	// An entry that doesn't fit even after defragmentation leaves the other entries where they were:
+	{
+		wiAtlasCache small;
+		small.border = 0;
+		small.maxSize = 256;
+		int keys[5];
+		small.AddRef(&keys[0], 256, 128);
+		small.AddRef(&keys[1], 128, 128);
+		small.ClearDirty();
+		wiRectPacker::rect_xywh before[2];
+		small.GetRegion(&keys[0], before[0]);
+		small.GetRegion(&keys[1], before[1]);
+		const bool failed = !small.AddRef(&keys[2], 256, 256);
+		wiRectPacker::rect_xywh after[2];
+		const bool kept = small.GetRegion(&keys[0], after[0]) && small.GetRegion(&keys[1], after[1]) &&
+			after[0].x == before[0].x && after[0].y == before[0].y && after[1].x == before[1].x && after[1].y == before[1].y &&
+			!small.IsFullRefreshNeeded() && small.GetAllocator().GetAllocatedArea() == 256 * 128 + 128 * 128;
+		// The retry waits for the next frame, then the entry gets its region once there is space:
+		small.Release(&keys[0]);
+		small.Release(&keys[1]);
+		const bool waited = !small.GetRegion(&keys[2], after[0]);
+		small.Update();
+		const bool retried = small.GetRegion(&keys[2], after[0]);
+		ss << "wiAtlasCache: failed allocation rolls back " << (failed && kept ? "[OK]" : "[FAIL]") << ", retried in the next frame " << (waited && retried ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunMeshLODTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Mesh LOD generation test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunMeshLODTest() function." << std::endl << std::endl;
+
+	// Bumpy sphere with a texture seam, the seam vertices are duplicated like in an imported mesh:
+	const uint32_t rings = 128;
+	const uint32_t segments = 256;
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t r = 0; r <= rings; ++r)
+	{
+		for (uint32_t s = 0; s <= segments; ++s)
+		{
+			const float theta = XM_PI * r / rings;
+			const float phi = XM_2PI * s / segments;
+			const float radius = 1 + 0.05f * std::sin(phi * 5) * std::sin(theta * 7);
+			positions.push_back(XMFLOAT3(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi)));
+		}
+	}
+	for (uint32_t r = 0; r < rings; ++r)
+	{
+		for (uint32_t s = 0; s < segments; ++s)
+		{
+			const uint32_t i0 = r * (segments + 1) + s;
+			const uint32_t i1 = i0 + 1;
+			const uint32_t i2 = i0 + segments + 1;
+			const uint32_t i3 = i2 + 1;
+			if (r > 0)
+			{
+				indices.push_back(i0);
+				indices.push_back(i2);
+				indices.push_back(i1);
+			}
+			if (r < rings - 1)
+			{
+				indices.push_back(i1);
+				indices.push_back(i2);
+				indices.push_back(i3);
+			}
+		}
+	}
+	ss << "Source mesh: " << indices.size() / 3 << " triangles, " << positions.size() << " vertices" << std::endl << std::endl;
+
+	// Generate a LOD chain like MeshComponent::GenerateLODs(), every LOD is simplified from the source with a growing error limit:
+	const uint32_t lodCount = 6;
+	const float targetError = 0.05f;
+	std::vector<std::vector<uint32_t>> lods(lodCount);
+	lods[0] = indices;
+	bool success = true;
+	std::vector<float> errors(lodCount, 0.0f);
+	timer.record();
+	for (uint32_t lod = 1; lod < lodCount; ++lod)
+	{
+		lods[lod].resize(indices.size());
+		const size_t count = wiMeshOptimizer::Simplify(lods[lod].data(), indices.data(), indices.size(), positions.data(), positions.size(), (indices.size() >> lod) / 3 * 3, targetError * lod, &errors[lod]);
+		lods[lod].resize(count);
+	}
+	double time = timer.elapsed();
+
+	// The LODs are measured independently of the simplifier: the distance of sampled source vertices from the LOD surface
+	//	(one sided Hausdorff distance), relative to the mesh extents like the target error. Every LOD must also halve the triangle count,
+	//	the bumps are small enough to allow it within the error limit of the LOD.
+	auto distanceToTriangle = [](XMVECTOR P, XMVECTOR A, XMVECTOR B, XMVECTOR C) {
+		// Closest point on triangle by Voronoi regions:
+		const XMVECTOR AB = B - A;
+		const XMVECTOR AC = C - A;
+		const XMVECTOR AP = P - A;
+		const float d1 = XMVectorGetX(XMVector3Dot(AB, AP));
+		const float d2 = XMVectorGetX(XMVector3Dot(AC, AP));
+		if (d1 <= 0 && d2 <= 0)
+			return XMVectorGetX(XMVector3Length(P - A));
+		const XMVECTOR BP = P - B;
+		const float d3 = XMVectorGetX(XMVector3Dot(AB, BP));
+		const float d4 = XMVectorGetX(XMVector3Dot(AC, BP));
+		if (d3 >= 0 && d4 <= d3)
+			return XMVectorGetX(XMVector3Length(P - B));
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0)
+			return XMVectorGetX(XMVector3Length(P - (A + AB * (d1 / (d1 - d3)))));
+		const XMVECTOR CP = P - C;
+		const float d5 = XMVectorGetX(XMVector3Dot(AB, CP));
+		const float d6 = XMVectorGetX(XMVector3Dot(AC, CP));
+		if (d6 >= 0 && d5 <= d6)
+			return XMVectorGetX(XMVector3Length(P - C));
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0)
+			return XMVectorGetX(XMVector3Length(P - (A + AC * (d2 / (d2 - d6)))));
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+			return XMVectorGetX(XMVector3Length(P - (B + (C - B) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))));
+		const float denom = 1.0f / (va + vb + vc);
+		return XMVectorGetX(XMVector3Length(P - (A + AB * (vb * denom) + AC * (vc * denom))));
+	};
+	XMVECTOR extentMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR extentMax = XMVectorReplicate(-FLT_MAX);
+	for (const XMFLOAT3& position : positions)
+	{
+		extentMin = XMVectorMin(extentMin, XMLoadFloat3(&position));
+		extentMax = XMVectorMax(extentMax, XMLoadFloat3(&position));
+	}
+	XMFLOAT3 extents;
+	XMStoreFloat3(&extents, extentMax - extentMin);
+	const float extent = std::max(extents.x, std::max(extents.y, extents.z));
+	const size_t sampleStride = positions.size() / 512;
+	for (uint32_t lod = 1; lod < lodCount; ++lod)
+	{
+		const std::vector<uint32_t>& lodIndices = lods[lod];
+		float distance = 0;
+		for (size_t v = 0; v < positions.size(); v += sampleStride)
+		{
+			const XMVECTOR P = XMLoadFloat3(&positions[v]);
+			float closest = FLT_MAX;
+			for (size_t t = 0; t < lodIndices.size(); t += 3)
+			{
+				closest = std::min(closest, distanceToTriangle(P, XMLoadFloat3(&positions[lodIndices[t]]), XMLoadFloat3(&positions[lodIndices[t + 1]]), XMLoadFloat3(&positions[lodIndices[t + 2]])));
+			}
+			distance = std::max(distance, closest);
+		}
+		const float measuredError = distance / extent;
+		success &= lodIndices.size() <= lods[lod - 1].size() / 2 && measuredError <= targetError * lod;
+		ss << "    LOD " << lod << ": " << lodIndices.size() / 3 << " triangles, error: " << errors[lod] << ", measured distance from source: " << measuredError << std::endl;
+	}
+	ss << "LOD chain generation took " << time << " milliseconds" << std::endl;
+
+	// The result must be the same when simplifying the same input again:
+	{
+		std::vector<uint32_t> repeat(indices.size());
+		const size_t count = wiMeshOptimizer::Simplify(repeat.data(), indices.data(), indices.size(), positions.data(), positions.size(), (indices.size() >> (lodCount - 1)) / 3 * 3, targetError * (lodCount - 1));
+		repeat.resize(count);
+		success &= repeat == lods[lodCount - 1];
+	}
+
+	// Independent meshes can be simplified in parallel:
+	const uint32_t meshCount = 16;
+	std::vector<std::vector<uint32_t>> results(meshCount);
+	{
+		timer.record();
+		for (uint32_t i = 0; i < meshCount; ++i)
+		{
+			results[i].resize(indices.size());
+			results[i].resize(wiMeshOptimizer::Simplify(results[i].data(), indices.data(), indices.size(), positions.data(), positions.size(), indices.size() / 4 / 3 * 3, targetError));
+		}
+		time = timer.elapsed();
+		ss << std::endl << "Simplifying " << meshCount << " meshes serially took " << time << " milliseconds" << std::endl;
+	}
+	{
+		wiJobSystem::context ctx;
+		timer.record();
+		wiJobSystem::Dispatch(ctx, meshCount, 1, [&](wiJobDispatchArgs args) {
+			std::vector<uint32_t> result(indices.size());
+			result.resize(wiMeshOptimizer::Simplify(result.data(), indices.data(), indices.size(), positions.data(), positions.size(), indices.size() / 4 / 3 * 3, targetError));
+			results[args.jobIndex] = std::move(result);
+		});
+		wiJobSystem::Wait(ctx);
+		time = timer.elapsed();
+		ss << "Simplifying " << meshCount << " meshes with wiJobSystem::Dispatch() took " << time << " milliseconds" << std::endl;
+		for (uint32_t i = 1; i < meshCount; ++i)
+		{
+			success &= results[i] == results[0];
+		}
+	}
+
+	ss << std::endl << "Result: " << (success ? "SUCCESS" : "FAILED") << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunMeshOptimizerTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Mesh optimizer test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunMeshOptimizerTest() function." << std::endl << std::endl;
+
+	// The bundled models are loaded into a separate scene, so the test doesn't modify the rendered scene:
+	const char* models[] = {
+		"../models/teapot.wiscene",
+		"../models/hairparticle_torus.wiscene",
+		"../models/shadows_test.wiscene",
+		"../models/physics_test.wiscene",
+		"../models/cloth_test.wiscene",
+		"../models/lightmap_bake_test.wiscene",
+	};
+
+	for (const char* model : models)
+	{
+		Scene scene;
+		wiScene::LoadModel(scene, model);
+
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;
+		uint32_t transformedBefore = 0;
+		uint32_t transformedAfter = 0;
+		for (size_t i = 0; i < scene.meshes.GetCount(); ++i)
+		{
+			MeshComponent& mesh = scene.meshes[i];
+			triangleCount += (uint32_t)mesh.indices.size() / 3;
+			vertexCount += (uint32_t)mesh.vertex_positions.size();
+			transformedBefore += wiMeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertex_positions.size()).vertices_transformed;
+		}
+
+		timer.record();
+		scene.OptimizeMeshes();
+		const double time = timer.elapsed();
+
+		uint32_t referencedVertexCount = 0;
+		for (size_t i = 0; i < scene.meshes.GetCount(); ++i)
+		{
+			const MeshComponent& mesh = scene.meshes[i];
+			referencedVertexCount += (uint32_t)mesh.vertex_positions.size();
+			transformedAfter += wiMeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertex_positions.size()).vertices_transformed;
+		}
+
+		ss << model << ": " << scene.meshes.GetCount() << " meshes, " << triangleCount << " triangles, " << vertexCount << " vertices" << std::endl;
+		if (triangleCount > 0 && referencedVertexCount > 0)
+		{
+			ss << "    ACMR: " << float(transformedBefore) / triangleCount << " -> " << float(transformedAfter) / triangleCount;
+			ss << ", ATVR: " << float(transformedBefore) / referencedVertexCount << " -> " << float(transformedAfter) / referencedVertexCount;
+			ss << ", optimization took " << time << " milliseconds" << std::endl;
+		}
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunMeshletCullingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Meshlet culling test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunMeshletCullingTest() function." << std::endl << std::endl;
+
+	// The bundled models are loaded into a separate scene, and viewed from cameras orbiting around them:
+	const char* models[] = {
+		"../models/teapot.wiscene",
+		"../models/shadows_test.wiscene",
+		"../models/physics_test.wiscene",
+		"../models/lightmap_bake_test.wiscene",
+	};
+	const uint32_t viewCount = 32;
+
+	for (const char* model : models)
+	{
+		Scene scene;
+		wiScene::LoadModel(scene, model);
+		scene.Update(0);
+
+		timer.record();
+		size_t meshletCount = 0;
+		for (size_t i = 0; i < scene.meshes.GetCount(); ++i)
+		{
+			scene.meshes[i].CreateMeshlets();
+			meshletCount += scene.meshes[i].meshlets.size();
+		}
+		const double buildTime = timer.elapsed();
+
+		AABB bounds;
+		for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
+		{
+			bounds = AABB::Merge(bounds, scene.aabb_objects[i]);
+		}
+		const XMFLOAT3 center = bounds.getCenter();
+		const float radius = std::max(bounds.getRadius(), 0.001f);
+
+		uint64_t visibleObjectTriangles = 0;
+		uint64_t drawnTriangles = 0;
+		uint64_t rangeCount = 0;
+		std::vector<MeshComponent::IndexRange> ranges;
+		double cullTime = 0;
+		for (uint32_t view = 0; view < viewCount; ++view)
+		{
+			// The camera is looking at the model from a random direction, close enough that the model partially fills the view:
+			const float angle = XM_2PI * view / viewCount;
+			const float height = wiRandom::getRandom(-100, 100) / 100.0f * radius;
+			CameraComponent camera;
+			camera.CreatePerspective(1920, 1080, 0.1f, radius * 10);
+			camera.Eye = XMFLOAT3(center.x + std::cos(angle) * radius * 1.2f, center.y + height, center.z + std::sin(angle) * radius * 1.2f);
+			camera.At = XMFLOAT3(center.x - camera.Eye.x, center.y - camera.Eye.y, center.z - camera.Eye.z);
+			camera.Up = XMFLOAT3(0, 1, 0);
+			camera.UpdateCamera();
+
+			timer.record();
+			for (size_t i = 0; i < scene.objects.GetCount(); ++i)
+			{
+				const ObjectComponent& object = scene.objects[i];
+				if (object.meshID == INVALID_ENTITY || camera.frustum.CheckBox(scene.aabb_objects[i]) == Frustum::BOX_FRUSTUM_OUTSIDE)
+				{
+					continue;
+				}
+				const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
+				const XMMATRIX W = object.transform_index >= 0 ? XMLoadFloat4x4(&scene.transforms[object.transform_index].world) : XMMatrixIdentity();
+
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
+					visibleObjectTriangles += subset.indexCount / 3;
+					ranges.resize(subset.meshletCount);
+					const uint32_t count = mesh.CullMeshlets(subset, W, camera.frustum, camera.Eye, !mesh.IsDoubleSided(), ranges.data());
+					for (uint32_t r = 0; r < count; ++r)
+					{
+						drawnTriangles += ranges[r].indexCount / 3;
+					}
+					rangeCount += count;
+				}
+			}
+			cullTime += timer.elapsed();
+		}
+
+		ss << model << ": " << meshletCount << " meshlets, built in " << buildTime << " milliseconds" << std::endl;
+		if (visibleObjectTriangles > 0)
+		{
+			ss << "    triangles of visible objects per view: " << visibleObjectTriangles / viewCount;
+			ss << ", rejected by meshlet culling: " << 100.0 * double(visibleObjectTriangles - drawnTriangles) / double(visibleObjectTriangles) << "%";
+			ss << ", draw calls per view: " << rangeCount / viewCount;
+			ss << ", culling took " << cullTime / viewCount << " milliseconds per view" << std::endl;
+		}
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunVertexQuantizationTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Vertex quantization test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunVertexQuantizationTest() function." << std::endl << std::endl;
+
+	// Encode/decode round trip on random data, the errors are checked against the theoretical bounds of the encodings:
+	{
+		const int count = 100000;
+		const XMFLOAT3 aabb_min = XMFLOAT3(-3, -1, -20);
+		const XMFLOAT3 aabb_max = XMFLOAT3(5, 2, 40);
+		float maxNormalError = 0;
+		float maxPositionError = 0;
+		float maxWeightError = 0;
+		bool weightSumCorrect = true;
+		bool positionStreamCorrect = true;
+		for (int i = 0; i < count; ++i)
+		{
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(wiRandom::getRandom(-1000, 1000) + 0.5f, wiRandom::getRandom(-1000, 1000) + 0.5f, wiRandom::getRandom(-1000, 1000) + 0.5f, 0)));
+			XMFLOAT3 decodedNormal = wiMath::DecodeOctahedral(wiMath::EncodeOctahedral(normal));
+			// angle from the cross product, acos() is not precise enough for small angles:
+			const float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(XMLoadFloat3(&normal), XMLoadFloat3(&decodedNormal))));
+			maxNormalError = std::max(maxNormalError, std::asin(std::min(sine, 1.0f)));
+
+			const XMFLOAT3 position = XMFLOAT3(
+				wiMath::Lerp(aabb_min.x, aabb_max.x, wiRandom::getRandom(0, 10000) / 10000.0f),
+				wiMath::Lerp(aabb_min.y, aabb_max.y, wiRandom::getRandom(0, 10000) / 10000.0f),
+				wiMath::Lerp(aabb_min.z, aabb_max.z, wiRandom::getRandom(0, 10000) / 10000.0f)
+			);
+			uint16_t quantizedPosition[3];
+			wiMath::QuantizePosition(position, aabb_min, aabb_max, quantizedPosition);
+			const XMFLOAT3 decodedPosition = wiMath::DequantizePosition(quantizedPosition, aabb_min, aabb_max);
+			maxPositionError = std::max(maxPositionError, std::abs(decodedPosition.x - position.x) / (aabb_max.x - aabb_min.x));
+			maxPositionError = std::max(maxPositionError, std::abs(decodedPosition.y - position.y) / (aabb_max.y - aabb_min.y));
+			maxPositionError = std::max(maxPositionError, std::abs(decodedPosition.z - position.z) / (aabb_max.z - aabb_min.z));
+
+			// The quantized GPU position stream must decode to the same values as the serialized encodings:
+			const AABB box = AABB(aabb_min, aabb_max);
+			MeshComponent::Vertex_POS16 vertex;
+			vertex.FromFULL(box, position, normal, (uint32_t)i % 256);
+			const XMFLOAT3 streamPosition = vertex.GetPos_FULL(box);
+			const XMFLOAT3 streamNormal = vertex.GetNor_FULL();
+			positionStreamCorrect &= vertex.GetMaterialIndex() == (uint32_t)i % 256;
+			positionStreamCorrect &= streamPosition.x == decodedPosition.x && streamPosition.y == decodedPosition.y && streamPosition.z == decodedPosition.z;
+			positionStreamCorrect &= streamNormal.x == decodedNormal.x && streamNormal.y == decodedNormal.y && streamNormal.z == decodedNormal.z;
+
+			XMFLOAT4 weights = XMFLOAT4((float)wiRandom::getRandom(0, 1000), (float)wiRandom::getRandom(0, 1000), (float)wiRandom::getRandom(0, 1000), (float)wiRandom::getRandom(1, 1000));
+			const float sum = weights.x + weights.y + weights.z + weights.w;
+			weights = XMFLOAT4(weights.x / sum, weights.y / sum, weights.z / sum, weights.w / sum);
+			const uint32_t quantizedWeights = wiMath::QuantizeBoneWeights(weights);
+			weightSumCorrect &= ((quantizedWeights & 0xFF) + ((quantizedWeights >> 8) & 0xFF) + ((quantizedWeights >> 16) & 0xFF) + (quantizedWeights >> 24)) == 255;
+			const XMFLOAT4 decodedWeights = wiMath::DequantizeBoneWeights(quantizedWeights);
+			maxWeightError = std::max(maxWeightError, std::abs(decodedWeights.x - weights.x));
+			maxWeightError = std::max(maxWeightError, std::abs(decodedWeights.y - weights.y));
+			maxWeightError = std::max(maxWeightError, std::abs(decodedWeights.z - weights.z));
+			maxWeightError = std::max(maxWeightError, std::abs(decodedWeights.w - weights.w));
+		}
+
+		// octahedral 16-bit: less than 0.01 degrees, position: one 16-bit step, weights: 2.5 8-bit steps (half step rounding + the sum correction)
+		const float normalBound = XMConvertToRadians(0.01f);
+		const float positionBound = 1.0f / 65535.0f;
+		const float weightBound = 2.5f / 255.0f;
+		ss << "Octahedral normals: max error = " << XMConvertToDegrees(maxNormalError) << " degrees " << (maxNormalError <= normalBound ? "[OK]" : "[FAIL]") << std::endl;
+		ss << "16-bit positions: max error = " << maxPositionError << " * AABB size " << (maxPositionError <= positionBound ? "[OK]" : "[FAIL]") << std::endl;
+		ss << "8-bit bone weights: max error = " << maxWeightError << ", sum is exactly 1: " << (weightSumCorrect ? "yes" : "no") << " " << (maxWeightError <= weightBound && weightSumCorrect ? "[OK]" : "[FAIL]") << std::endl;
+		ss << "GPU position stream round trip: " << (positionStreamCorrect ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+	}
+
+	// Serialize the meshes of the sample scenes with full precision and quantized vertex streams, then load them back:
+	const char* models[] = {
+		"../models/teapot.wiscene",
+		"../models/girl.wiscene",
+		"../models/emitter_skinned.wiscene",
+		"../models/playground.wiscene",
+	};
+	for (const char* model : models)
+	{
+		Scene scene;
+		wiScene::LoadModel(scene, model);
+
+		size_t vertexCount = 0;
+		size_t sizes[2] = {};
+		double loadTimes[2] = {};
+		for (int quantized = 0; quantized < 2; ++quantized)
+		{
+			for (size_t i = 0; i < scene.meshes.GetCount(); ++i)
+			{
+				MeshComponent& mesh = scene.meshes[i];
+				mesh.SetQuantized(quantized != 0);
+				if (quantized == 0)
+				{
+					vertexCount += mesh.vertex_positions.size();
+				}
+
+				wiArchive archive;
+				mesh.Serialize(archive);
+				sizes[quantized] += archive.GetSize();
+
+				archive.SetReadModeAndResetPos(true);
+				MeshComponent loaded;
+				timer.record();
+				loaded.Serialize(archive);
+				loadTimes[quantized] += timer.elapsed();
+			}
+		}
+
+		if (vertexCount > 0)
+		{
+			ss << model << ": " << vertexCount << " vertices" << std::endl;
+			ss << "    full precision: " << (float)sizes[0] / (float)vertexCount << " bytes per vertex, loaded in " << loadTimes[0] << " milliseconds" << std::endl;
+			ss << "    quantized: " << (float)sizes[1] / (float)vertexCount << " bytes per vertex, loaded in " << loadTimes[1] << " milliseconds" << std::endl;
+		}
+	}
+	ss << std::endl << "GPU position stream: " << sizeof(MeshComponent::Vertex_POS) << " bytes per vertex, quantized: " << sizeof(MeshComponent::Vertex_POS16) << " bytes per vertex" << std::endl;
+	ss << "GPU bone stream: " << sizeof(MeshComponent::Vertex_BON) << " bytes per vertex (16-bit indices, 16-bit weights)" << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunTextureCompressionTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Texture compression test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunTextureCompressionTest() function." << std::endl << std::endl;
+
+	// Procedural test image with smooth gradients, hard edges, noise and a varying alpha channel:
+	const uint32_t width = 1024;
+	const uint32_t height = 1024;
+	std::vector<uint8_t> image(width * height * 4);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint8_t* pixel = &image[(y * width + x) * 4];
+			const float u = (float)x / (float)width;
+			const float v = (float)y / (float)height;
+			const bool checker = ((x / 64) + (y / 64)) % 2 == 0;
+			const int noise = wiRandom::getRandom(-12, 12);
+			pixel[0] = (uint8_t)wiMath::Clamp(u * 255.0f + noise, 0.0f, 255.0f);
+			pixel[1] = (uint8_t)wiMath::Clamp(v * 255.0f + noise, 0.0f, 255.0f);
+			pixel[2] = checker ? 200 : 40;
+			pixel[3] = (uint8_t)(127.5f + 127.5f * std::sin(u * XM_2PI * 4) * std::cos(v * XM_2PI * 4));
+		}
+	}
+
+	struct Format
+	{
+		FORMAT format;
+		const char* name;
+		uint32_t channelCount; // the channels that are compared
+	};
+	const Format formats[] = {
+		{ FORMAT_BC1_UNORM, "BC1 (RGB)", 3 },
+		{ FORMAT_BC3_UNORM, "BC3 (RGBA)", 4 },
+		{ FORMAT_BC5_UNORM, "BC5 (RG)", 2 },
+		{ FORMAT_BC7_UNORM, "BC7 (RGBA)", 4 },
+	};
+	// Minimum expected quality for this image:
+	const double psnrBounds[] = { 38, 38, 45, 42 };
+
+	std::vector<uint8_t> compressed;
+	std::vector<uint8_t> decompressed(image.size());
+	for (size_t i = 0; i < arraysize(formats); ++i)
+	{
+		const Format& format = formats[i];
+		compressed.resize(wiBlockCompression::GetCompressedSize(format.format, width, height));
+
+		timer.record();
+		wiBlockCompression::CompressImage(format.format, image.data(), width, height, compressed.data());
+		const double elapsed = timer.elapsed();
+		wiBlockCompression::DecompressImage(format.format, compressed.data(), width, height, decompressed.data());
+
+		double squaredError = 0;
+		for (size_t j = 0; j < width * height; ++j)
+		{
+			for (uint32_t c = 0; c < format.channelCount; ++c)
+			{
+				const double diff = (double)image[j * 4 + c] - (double)decompressed[j * 4 + c];
+				squaredError += diff * diff;
+			}
+		}
+		const double mse = squaredError / (double)(width * height * format.channelCount);
+		const double psnr = mse > 0 ? 10 * std::log10(255.0 * 255.0 / mse) : 100;
+
+		ss << format.name << ": PSNR = " << psnr << " dB " << (psnr >= psnrBounds[i] ? "[OK]" : "[FAIL]");
+		ss << ", " << (double)(width * height) / elapsed / 1000.0 << " MPixels/s";
+		ss << ", size = " << 100.0f * (float)compressed.size() / (float)image.size() << "% of RGBA8" << std::endl;
+	}
+
+	// Full mip chain encoded into a DDS file, the same as the texture cache does when loading an image:
+	{
+		std::vector<uint8_t> dds;
+		timer.record();
+		wiTextureCache::CreateDDS(image.data(), width, height, FORMAT_BC3_UNORM, dds);
+		const double elapsed = timer.elapsed();
+		ss << std::endl << "BC3 DDS with " << wiMipGenerator::GetMipCount(width, height) << " mip levels: " << dds.size() / 1024 << " KB, created in " << elapsed << " milliseconds" << std::endl;
+	}
+
+	// Transcoding cache, the second request is served from the cache directory:
+	{
+		const std::string fileName = "images/earth_001.png";
+		const bool enabled = wiTextureCache::IsEnabled();
+		wiTextureCache::SetEnabled(true);
+		std::vector<uint8_t> dds;
+		timer.record();
+		bool success = wiTextureCache::GetDDS(fileName, dds, true);
+		const double first = timer.elapsed();
+		timer.record();
+		success &= wiTextureCache::GetDDS(fileName, dds, true);
+		const double second = timer.elapsed();
+		wiTextureCache::SetEnabled(enabled);
+		ss << fileName << ": first request: " << first << " milliseconds, second request: " << second << " milliseconds " << (success ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunTextureLoadingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Texture loading test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunTextureLoadingTest() function." << std::endl << std::endl;
+
+	// The sample images are copied to unique file names, because the resource manager would return the already loaded texture for the same name:
+	const char* sources[] = {
+		"images/HelloWorld.png",
+		"images/spritesheet_grid.png",
+	};
+	const size_t textureCount = 500;
+	std::vector<wiHashString> names;
+	for (size_t i = 0; i < textureCount; ++i)
+	{
+		const std::string source = sources[i % arraysize(sources)];
+		std::vector<uint8_t> data;
+		if (wiHelper::readByteData(source, data))
+		{
+			const std::string name = "texture_loading_test_" + std::to_string(i) + ".png";
+			std::ofstream file(name, std::ios::binary | std::ios::trunc);
+			if (file.is_open())
+			{
+				file.write((const char*)data.data(), (std::streamsize)data.size());
+				names.push_back(name);
+			}
+		}
+	}
+
+	// The textures are released after each batch, to keep the memory usage low:
+	const size_t batchSize = 50;
+
+	size_t loadedSerial = 0;
+	timer.record();
+	for (auto& name : names)
+	{
+		loadedSerial += wiResourceManager::Load(name) != nullptr ? 1 : 0;
+	}
+	const double serialTime = timer.elapsed();
+
+	size_t loadedParallel = 0;
+	timer.record();
+	for (size_t i = 0; i < names.size(); i += batchSize)
+	{
+		const std::vector<wiHashString> batch(names.begin() + i, names.begin() + std::min(i + batchSize, names.size()));
+		for (auto& resource : wiResourceManager::LoadBatch(batch))
+		{
+			loadedParallel += resource != nullptr ? 1 : 0;
+		}
+	}
+	const double parallelTime = timer.elapsed();
+
+	for (auto& name : names)
+	{
+		std::remove(name.GetString().c_str());
+	}
+
+	ss << "Loaded " << names.size() << " textures with full mip chains (" << wiJobSystem::GetThreadCount() << " threads):" << std::endl;
+	ss << "Serial: " << serialTime << " milliseconds " << (loadedSerial == names.size() ? "[OK]" : "[FAIL]") << std::endl;
+	ss << "Parallel (LoadBatch): " << parallelTime << " milliseconds " << (loadedParallel == names.size() ? "[OK]" : "[FAIL]") << std::endl;
+	ss << "Speedup: " << serialTime / std::max(parallelTime, 0.001) << "x" << std::endl << std::endl;
+
+	// CPU mip chain generation with the different filters:
+	{
+		const uint32_t width = 2048;
+		const uint32_t height = 2048;
+		std::vector<uint8_t> image(width * height * 4);
+		for (size_t i = 0; i < image.size(); ++i)
+		{
+			image[i] = (uint8_t)wiRandom::getRandom(0, 255);
+		}
+		std::vector<uint8_t> mips;
+		const char* filterNames[] = { "box", "box sRGB", "Kaiser", "Kaiser sRGB" };
+		for (size_t i = 0; i < arraysize(filterNames); ++i)
+		{
+			timer.record();
+			wiMipGenerator::GenerateMipChain(image.data(), width, height, mips, i < 2 ? wiMipGenerator::FILTER_BOX : wiMipGenerator::FILTER_KAISER, i % 2 == 1);
+			ss << width << "x" << height << " mip chain, " << filterNames[i] << " filter: " << timer.elapsed() << " milliseconds" << std::endl;
+		}
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunVirtualTextureTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Virtual texture test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunVirtualTextureTest() function." << std::endl << std::endl;
+
+	// Offline tiling of a procedural 4096x4096 image:
+	const uint32_t width = 4096;
+	const uint32_t height = 4096;
+	const uint32_t pageSize = 128;
+	const uint32_t border = 4;
+	std::vector<uint8_t> image(width * height * 4);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint8_t* pixel = &image[(y * width + x) * 4];
+			pixel[0] = (uint8_t)x;
+			pixel[1] = (uint8_t)y;
+			pixel[2] = (uint8_t)((x / pageSize + y / pageSize) * 16);
+			pixel[3] = 255;
+		}
+	}
+	std::vector<uint8_t> tiledImage;
+	timer.record();
+	wiVirtualTexture::CreateTiledImage(image.data(), width, height, pageSize, border, tiledImage);
+	ss << "Tiling " << width << "x" << height << " into " << pageSize << "x" << pageSize << " pages: " << timer.elapsed() << " milliseconds, " << tiledImage.size() / (1024 * 1024) << " MB" << std::endl;
+
+	const std::string fileName = "virtual_texture_test.wivt";
+	{
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		file.write((const char*)tiledImage.data(), (std::streamsize)tiledImage.size());
+	}
+	wiVirtualTexture::TiledImageFile file;
+	bool pagesCorrect = file.Open(fileName);
+	const wiVirtualTexture::TiledImageDesc& desc = file.GetDesc();
+
+	// Check a page of mip 0 against the source image (including the border):
+	if (pagesCorrect)
+	{
+		const uint32_t pageX = 3;
+		const uint32_t pageY = 5;
+		const uint32_t paddedSize = desc.GetPaddedPageSize();
+		std::vector<uint8_t> page(desc.GetPageDataSize());
+		pagesCorrect = file.ReadPage(VIRTUALTEXTURE_PACK_PAGE(pageX, pageY, 0), page.data());
+		for (uint32_t y = 0; y < paddedSize && pagesCorrect; ++y)
+		{
+			for (uint32_t x = 0; x < paddedSize && pagesCorrect; ++x)
+			{
+				const uint32_t srcX = pageX * pageSize + x - border;
+				const uint32_t srcY = pageY * pageSize + y - border;
+				pagesCorrect = memcmp(&page[(y * paddedSize + x) * 4], &image[(srcY * width + srcX) * 4], 4) == 0;
+			}
+		}
+	}
+	ss << desc.mipCount << " mip levels, " << desc.GetPageCount() << " pages, page contents " << (pagesCorrect ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+
+	// Synthetic feedback: a view window that pans over the texture and zooms out, every feedback element is the page of a sample
+	//	The feedback has 1/8 of the resolution of a 1280x720 view, the mip level is selected for the full resolution:
+	wiVirtualTexture::PageTable pageTable;
+	pageTable.Initialize(desc, 16, 16);
+	const uint32_t feedbackWidth = 160;
+	const uint32_t feedbackHeight = 90;
+	std::vector<uint32_t> feedback(feedbackWidth * feedbackHeight);
+	std::vector<uint32_t> requests;
+	const uint32_t frameCount = 300;
+	const uint32_t maxUploadsPerFrame = 16;
+	size_t totalUploads = 0;
+	size_t totalSamples = 0;
+	size_t exactSamples = 0;
+	bool fallbackValid = true;
+	double resolveTime = 0;
+	double pageTableTime = 0;
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		const float t = (float)frame / (float)frameCount;
+		const float viewSize = wiMath::Lerp(0.05f, 0.5f, t);
+		const float viewX = (1 - viewSize) * (0.5f + 0.5f * std::sin(t * XM_2PI));
+		const float viewY = (1 - viewSize) * t;
+		const uint32_t mip = std::min(desc.mipCount - 1, (uint32_t)std::log2(std::max(1.0f, viewSize * width / 1280.0f)));
+		for (uint32_t y = 0; y < feedbackHeight; ++y)
+		{
+			for (uint32_t x = 0; x < feedbackWidth; ++x)
+			{
+				const float u = viewX + viewSize * (x + 0.5f) / feedbackWidth;
+				const float v = viewY + viewSize * (y + 0.5f) / feedbackHeight;
+				const uint32_t pageX = std::min(desc.GetPageCountX(mip) - 1, (uint32_t)(u * std::max(1u, width >> mip) / pageSize));
+				const uint32_t pageY = std::min(desc.GetPageCountY(mip) - 1, (uint32_t)(v * std::max(1u, height >> mip) / pageSize));
+				feedback[y * feedbackWidth + x] = VIRTUALTEXTURE_PACK_PAGE(pageX, pageY, mip);
+			}
+		}
+
+		timer.record();
+		pageTable.ResolveFeedback(feedback.data(), feedback.size(), requests, maxUploadsPerFrame);
+		resolveTime += timer.elapsed();
+		for (uint32_t page : requests)
+		{
+			if (pageTable.MakeResident(page) < 0)
+			{
+				break;
+			}
+			totalUploads++;
+		}
+		timer.record();
+		pageTable.UpdatePageTable();
+		pageTableTime += timer.elapsed();
+
+		// Every sample must be mapped to its own page or to a resident parent page:
+		for (uint32_t page : feedback)
+		{
+			const uint32_t entry = pageTable.GetEntry(page);
+			fallbackValid &= (entry & VIRTUALTEXTURE_ENTRY_VALID) != 0 && VIRTUALTEXTURE_ENTRY_MIP(entry) >= VIRTUALTEXTURE_PAGE_MIP(page);
+			exactSamples += VIRTUALTEXTURE_ENTRY_MIP(entry) == VIRTUALTEXTURE_PAGE_MIP(page) ? 1 : 0;
+		}
+		totalSamples += feedback.size();
+
+		pageTable.NextFrame();
+	}
+	std::remove(fileName.c_str());
+
+	ss << frameCount << " frames of synthetic feedback (" << feedbackWidth << "x" << feedbackHeight << "), " << pageTable.GetSlotCount() << " physical pages:" << std::endl;
+	ss << "Page uploads: " << totalUploads << " (" << (float)totalUploads / (float)frameCount << " per frame), resident pages: " << pageTable.GetResidentCount() << std::endl;
+	ss << "Samples with the requested resolution: " << 100.0 * (double)exactSamples / (double)totalSamples << "%" << std::endl;
+	ss << "Every sample has a valid fallback: " << (fallbackValid ? "[OK]" : "[FAIL]") << std::endl;
+	ss << "Feedback resolve: " << resolveTime / frameCount << " milliseconds per frame" << std::endl;
+	ss << "Page table update: " << pageTableTime / frameCount << " milliseconds per frame" << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunPhysicsMultithreadingTest()
+{
+	std::stringstream ss("");
+	ss << "Physics multithreading test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunPhysicsMultithreadingTest() function." << std::endl << std::endl;
+
+	// 10000 boxes are dropped in a separate physics world, with a different number of jobs every time:
+	const uint32_t boxCount = 10000;
+	const uint32_t stepCount = 120;
+	ss << boxCount << " boxes, " << stepCount << " simulation steps:" << std::endl;
+
+	const auto single = wiPhysicsEngine::RunBenchmark(boxCount, stepCount, 0);
+	ss << "Single threaded: " << single.stepTime << " milliseconds per step" << std::endl;
+
+	// Powers of two, then every thread of the job system:
+	std::vector<uint32_t> threadCounts;
+	const uint32_t maxThreadCount = wiJobSystem::GetThreadCount() + 1;
+	for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreadCount);
+
+	bool deterministic = true;
+	uint64_t hash = 0;
+	for (uint32_t threadCount : threadCounts)
+	{
+		const auto result = wiPhysicsEngine::RunBenchmark(boxCount, stepCount, threadCount);
+		if (threadCount == 1)
+		{
+			hash = result.hash;
+		}
+		deterministic &= result.hash == hash;
+		ss << threadCount << (threadCount == 1 ? " job: " : " jobs: ") << result.stepTime << " milliseconds per step (" << single.stepTime / result.stepTime << "x)" << std::endl;
+	}
+	ss << "Same result with every job count: " << (deterministic ? "[OK]" : "[FAIL]") << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunPhysicsShapeCacheTest()
+{
+	std::stringstream ss("");
+	ss << "Physics shape cache test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunPhysicsShapeCacheTest() function." << std::endl << std::endl;
+
+	// A separate scene with a rock mesh that is used by many convex hull and triangle mesh rigid bodies:
+	wiScene::Scene scene;
+	const wiECS::Entity rockID = wiECS::CreateEntity();
+	MeshComponent& rock = scene.meshes.Create(rockID);
+	const int rings = 32;
+	const int segments = 64;
+	for (int y = 0; y <= rings; ++y)
+	{
+		for (int x = 0; x <= segments; ++x)
+		{
+			const float theta = XM_PI * y / rings;
+			const float phi = XM_2PI * x / segments;
+			const float radius = 1 + 0.2f * std::sin(theta * 5) * std::cos(phi * 3);
+			rock.vertex_positions.push_back(XMFLOAT3(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi)));
+		}
+	}
+	for (int y = 0; y < rings; ++y)
+	{
+		for (int x = 0; x < segments; ++x)
+		{
+			const uint32_t i0 = y * (segments + 1) + x;
+			const uint32_t i1 = i0 + segments + 1;
+			rock.indices.insert(rock.indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+		}
+	}
+
+	const uint32_t bodyCount = 500;
+	ss << bodyCount << " rigid bodies (half convex hull, half triangle mesh) with 4 different scales, the mesh has " << rock.vertex_positions.size() << " vertices:" << std::endl;
+
+	auto run = [&](const char* name) {
+		for (uint32_t i = 0; i < bodyCount; ++i)
+		{
+			const wiECS::Entity entity = wiECS::CreateEntity();
+			const float scale = 1 + (i / 2 % 4) * 0.5f;
+			TransformComponent& transform = scene.transforms.Create(entity);
+			transform.Translate(XMFLOAT3((i % 25) * 8.0f, 100.0f + (i / 25) * 8.0f, 0));
+			transform.Scale(XMFLOAT3(scale, scale, scale));
+			transform.UpdateTransform();
+			ObjectComponent& object = scene.objects.Create(entity);
+			object.meshID = rockID;
+			RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+			if (i % 2 == 0)
+			{
+				rigidbody.shape = RigidBodyPhysicsComponent::CONVEX_HULL;
+			}
+			else
+			{
+				rigidbody.shape = RigidBodyPhysicsComponent::TRIANGLE_MESH;
+				rigidbody.mass = 0;
+			}
+		}
+
+		// The rigid bodies are created by the physics update, the time step is too small to simulate anything:
+		wiJobSystem::context ctx;
+		wiTimer timer;
+		timer.record();
+		wiPhysicsEngine::RunPhysicsUpdateSystem(ctx, scene.weather, scene.armatures, scene.transforms, scene.meshes, scene.objects, scene.rigidbodies, scene.softbodies, 0.001f);
+		const double time = timer.elapsed();
+		const auto stats = wiPhysicsEngine::GetShapeStats();
+		ss << name << ": " << time << " milliseconds, " << stats.shapeCount << " shapes, " << stats.memory / 1024 << " KB" << std::endl;
+
+		// Remove the rigid bodies, they are removed from the physics world by the next update:
+		for (uint32_t i = 0; i < bodyCount; ++i)
+		{
+			const wiECS::Entity entity = scene.rigidbodies.GetEntity(0);
+			scene.transforms.Remove(entity);
+			scene.objects.Remove(entity);
+			scene.rigidbodies.Remove(entity);
+		}
+		wiPhysicsEngine::RunPhysicsUpdateSystem(ctx, scene.weather, scene.armatures, scene.transforms, scene.meshes, scene.objects, scene.rigidbodies, scene.softbodies, 0.001f);
+	};
+
+	const bool shapeCache = wiPhysicsEngine::IsShapeCacheEnabled();
+	const bool cookedShapes = wiPhysicsEngine::IsCookedShapesEnabled();
+
+	wiPhysicsEngine::SetShapeCacheEnabled(false);
+	wiPhysicsEngine::SetCookedShapesEnabled(false);
+	run("Without shape cache");
+
+	wiPhysicsEngine::SetShapeCacheEnabled(true);
+	run("With shape cache");
+
+	// The first run cooks the shapes (unless they were cooked by an earlier run of the test), the second run loads them:
+	wiPhysicsEngine::SetCookedShapesEnabled(true);
+	run("With cooked shapes (1st run)");
+	run("With cooked shapes (2nd run)");
+
+	wiPhysicsEngine::SetShapeCacheEnabled(shapeCache);
+	wiPhysicsEngine::SetCookedShapesEnabled(cookedShapes);
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunPhysicsQueryTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Physics query test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunPhysicsQueryTest() function." << std::endl << std::endl;
+
+	// A separate scene with a grid of boxes, every box has a mesh for Pick() and a rigid body for the physics queries:
+	wiScene::Scene scene;
+	const wiECS::Entity materialID = scene.Entity_CreateMaterial("material");
+	const wiECS::Entity meshID = scene.Entity_CreateMesh("box");
+	MeshComponent& mesh = *scene.meshes.GetComponent(meshID);
+	for (int i = 0; i < 8; ++i)
+	{
+		mesh.vertex_positions.push_back(XMFLOAT3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f));
+	}
+	mesh.indices = {
+		0, 2, 1, 1, 2, 3,	// -z
+		4, 5, 6, 5, 7, 6,	// +z
+		0, 1, 4, 1, 5, 4,	// -y
+		2, 6, 3, 3, 6, 7,	// +y
+		0, 4, 2, 2, 4, 6,	// -x
+		1, 3, 5, 3, 7, 5,	// +x
+	};
+	mesh.subsets.emplace_back();
+	mesh.subsets.back().materialID = materialID;
+	mesh.subsets.back().indexCount = (uint32_t)mesh.indices.size();
+	mesh.CreateRenderData();
+
+	const uint32_t gridSize = 64;
+	const float spacing = 4;
+	for (uint32_t i = 0; i < gridSize * gridSize; ++i)
+	{
+		const wiECS::Entity entity = scene.Entity_CreateObject("box");
+		TransformComponent& transform = *scene.transforms.GetComponent(entity);
+		transform.Translate(XMFLOAT3((i % gridSize) * spacing, 1, (i / gridSize) * spacing));
+		transform.UpdateTransform();
+		scene.objects.GetComponent(entity)->meshID = meshID;
+		RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+		rigidbody.shape = RigidBodyPhysicsComponent::BOX;
+		rigidbody.mass = 0;
+	}
+
+	// The update creates the rigid bodies and the bounding boxes for Pick(), the time step is too small to simulate anything:
+	scene.Update(0.001f);
+
+	// Rays are shot downwards at an angle from above the grid, some of them hit the boxes, the others miss:
+	const uint32_t rayCount = 100000;
+	std::vector<RAY> rays(rayCount);
+	for (uint32_t i = 0; i < rayCount; ++i)
+	{
+		const float x = (i % 317) * gridSize * spacing / 317.0f;
+		const float z = (i / 317 % 317) * gridSize * spacing / 317.0f;
+		rays[i] = RAY(XMFLOAT3(x, 20, z), XMFLOAT3(0.1f + (i % 7) * 0.05f, -1, 0.05f * (i % 5)));
+	}
+	ss << gridSize * gridSize << " boxes, " << rayCount << " rays:" << std::endl;
+
+	std::vector<wiPhysicsEngine::QueryHit> hits(rayCount);
+	wiPhysicsEngine::RayCast(rays[0]); // takes the snapshot of the physics world
+	timer.record();
+	wiPhysicsEngine::RayCastBatch(rays.data(), rayCount, hits.data());
+	const double batchTime = timer.elapsed();
+	uint32_t hitCount = 0;
+	for (auto& hit : hits)
+	{
+		hitCount += hit.entity != wiECS::INVALID_ENTITY ? 1 : 0;
+	}
+	ss << "RayCastBatch: " << batchTime << " milliseconds, " << hitCount << " hits" << std::endl;
+
+	// Pick() tests every object, so it is only measured with a part of the rays:
+	const uint32_t pickCount = 1000;
+	const uint32_t pickStride = rayCount / pickCount;
+	uint32_t matching = 0;
+	timer.record();
+	for (uint32_t i = 0; i < pickCount; ++i)
+	{
+		const PickResult pick = wiScene::Pick(rays[i * pickStride], RENDERTYPE_ALL, ~0, scene);
+		matching += pick.entity == hits[i * pickStride].entity ? 1 : 0;
+	}
+	const double pickTime = timer.elapsed() * rayCount / pickCount;
+	ss << "Pick: " << pickTime << " milliseconds (estimated from " << pickCount << " rays, " << pickTime / batchTime << "x slower)" << std::endl;
+	ss << "Same entity as Pick: " << matching << " / " << pickCount << (matching == pickCount ? " [OK]" : " [FAIL]") << std::endl;
+
+	// Sphere sweeps and box overlaps at the same positions:
+	const uint32_t queryCount = 10000;
+	std::vector<wiPhysicsEngine::SweepQuery> sweeps(queryCount);
+	std::vector<wiPhysicsEngine::OverlapQuery> overlaps(queryCount);
+	for (uint32_t i = 0; i < queryCount; ++i)
+	{
+		sweeps[i].shape.radius = 0.5f;
+		sweeps[i].from = rays[i * 10].origin;
+		sweeps[i].to = XMFLOAT3(sweeps[i].from.x, -1, sweeps[i].from.z);
+		overlaps[i].shape.type = wiPhysicsEngine::QueryShape::BOX;
+		overlaps[i].shape.halfExtents = XMFLOAT3(1, 1, 1);
+		overlaps[i].position = XMFLOAT3(sweeps[i].from.x, 1, sweeps[i].from.z);
+	}
+	std::vector<wiPhysicsEngine::QueryHit> sweepHits(queryCount);
+	timer.record();
+	wiPhysicsEngine::SweepBatch(sweeps.data(), queryCount, sweepHits.data());
+	ss << "SweepBatch (" << queryCount << " spheres): " << timer.elapsed() << " milliseconds" << std::endl;
+	std::vector<std::vector<wiECS::Entity>> overlapResults(queryCount);
+	timer.record();
+	wiPhysicsEngine::OverlapBatch(overlaps.data(), queryCount, overlapResults.data());
+	ss << "OverlapBatch (" << queryCount << " boxes): " << timer.elapsed() << " milliseconds" << std::endl;
+
+	// A sphere that is swept down onto a box stops on the top of the box, and a box at the same place overlaps with it:
+	bool success = true;
+	for (uint32_t i = 0; i < queryCount; ++i)
+	{
+		const XMFLOAT3 position = sweeps[i].from;
+		const float cellX = std::round(position.x / spacing) * spacing;
+		const float cellZ = std::round(position.z / spacing) * spacing;
+		const bool above = std::abs(position.x - cellX) < 1 && std::abs(position.z - cellZ) < 1;
+		if (above)
+		{
+			success &= sweepHits[i].entity != wiECS::INVALID_ENTITY && std::abs(sweepHits[i].position.y - 2) < 0.1f;
+			success &= !overlapResults[i].empty() && overlapResults[i][0] == sweepHits[i].entity;
+		}
+	}
+	ss << "Sweep and overlap results: " << (success ? "[OK]" : "[FAIL]") << std::endl;
+
+	// Remove the rigid bodies from the physics world:
+	scene.Clear();
+	scene.Update(0.001f);
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunPhysicsFixedTimestepTest()
+{
+	std::stringstream ss("");
+	ss << "Physics fixed timestep test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunPhysicsFixedTimestepTest() function." << std::endl << std::endl;
+
+	const float step = wiPhysicsEngine::GetFixedTimestep();
+
+	// The same total time is simulated with different frame rates, the fixed timestep result must be the same for all of them:
+	//	The total time is in the middle of a step, so the rounding of the frame times can't change the number of steps
+	const uint32_t boxCount = 1000;
+	const float totalTime = (120 + 0.5f) * step;
+	auto make_frames = [&](float frameTime, bool random) {
+		std::vector<float> frameTimes;
+		float time = 0;
+		while (true)
+		{
+			const float dt = random ? wiRandom::getRandom(5, 50) * 0.001f : frameTime;
+			if (time + dt >= totalTime)
+				break;
+			frameTimes.push_back(dt);
+			time += dt;
+		}
+		frameTimes.push_back(totalTime - time);
+		return frameTimes;
+	};
+	const std::vector<float> patterns[] = {
+		make_frames(1.0f / 60.0f, false),
+		make_frames(1.0f / 144.0f, false),
+		make_frames(1.0f / 30.0f, false),
+		make_frames(0, true),
+	};
+	const char* patternNames[] = { "60 Hz", "144 Hz", "30 Hz", "random 5-50 ms" };
+	ss << boxCount << " boxes, " << totalTime << " seconds:" << std::endl;
+
+	bool deterministic = true;
+	uint64_t hash = 0;
+	for (size_t i = 0; i < arraysize(patterns); ++i)
+	{
+		const auto result = wiPhysicsEngine::RunFrameBenchmark(boxCount, patterns[i].data(), (uint32_t)patterns[i].size(), true);
+		if (i == 0)
+		{
+			hash = result.hash;
+		}
+		deterministic &= result.hash == hash;
+		ss << patternNames[i] << ": " << patterns[i].size() << " frames, " << result.stepCount << " steps" << std::endl;
+	}
+	ss << "Same result with every frame rate: " << (deterministic ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+
+	// 60 Hz frames with a 250 ms hitch every second, the variable timestep simulates the hitch in one long update,
+	//	the fixed timestep spreads it over the next frames within the substep budget:
+	const uint32_t hitchBoxCount = 2000;
+	std::vector<float> frameTimes(600, 1.0f / 60.0f);
+	for (size_t i = 59; i < frameTimes.size(); i += 60)
+	{
+		frameTimes[i] = 0.25f;
+	}
+	ss << hitchBoxCount << " boxes, " << frameTimes.size() << " frames at 60 Hz with a 250 ms hitch every 60 frames, max " << wiPhysicsEngine::GetMaxSubsteps() << " substeps:" << std::endl;
+	for (int fixed = 0; fixed < 2; ++fixed)
+	{
+		const auto result = wiPhysicsEngine::RunFrameBenchmark(hitchBoxCount, frameTimes.data(), (uint32_t)frameTimes.size(), fixed != 0);
+		ss << (fixed ? "Fixed timestep: " : "Variable timestep: ") << result.averageFrameTime << " ms average, " << result.maxFrameTime << " ms max, ";
+		ss << result.maxSteps << " max steps in a frame";
+		if (fixed)
+		{
+			ss << ", " << result.maxDebt * 1000 << " ms max debt";
+		}
+		ss << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunEmittedParticleCPUTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Emitted particle CPU simulation test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunEmittedParticleCPUTest() function." << std::endl << std::endl;
+
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+	// One particle falls in a planar force field without falloff, the result must match the explicit Euler integration:
+	{
+		wiEmittedParticle emitter;
+		emitter.random_factor = 0;
+		emitter.normal_factor = 0;
+		emitter.life = 100;
+		emitter.random_life = 0;
+
+		wiEmittedParticleCPU::ForceField gravity;
+		gravity.planar = true;
+		gravity.normal = XMFLOAT3(0, -1, 0);
+		gravity.gravity = 10;
+		wiEmittedParticleCPU::Environment environment;
+		environment.forceFields = &gravity;
+		environment.forceFieldCount = 1;
+
+		wiEmittedParticleCPU simulation;
+		simulation.Initialize(16);
+		simulation.Update(emitter, world, nullptr, environment, 1, 0);
+
+		const float dt = 0.1f;
+		const uint32_t steps = 10;
+		for (uint32_t i = 0; i < steps; ++i)
+		{
+			simulation.Update(emitter, world, nullptr, environment, 0, dt);
+		}
+		const Particle particle = simulation.GetParticle(0);
+		const float expectedVelocity = -gravity.gravity * dt * steps;
+		const float expectedPosition = -gravity.gravity * dt * dt * steps * (steps + 1) * 0.5f;
+		const bool ok = std::abs(particle.velocity.y - expectedVelocity) < 0.001f && std::abs(particle.position.y - expectedPosition) < 0.001f;
+		ss << "Ballistic particle: " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// One particle is emitted every frame with a fixed life, the alive count must settle:
+	{
+		wiEmittedParticle emitter;
+		emitter.life = 0.55f;
+		emitter.random_life = 0;
+
+		wiEmittedParticleCPU simulation;
+		simulation.Initialize(100);
+		for (int i = 0; i < 30; ++i)
+		{
+			simulation.Update(emitter, world, nullptr, wiEmittedParticleCPU::Environment(), 1, 0.1f);
+		}
+		ss << "Particle life: " << (simulation.GetAliveCount() == 6 ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// The SPH densities from the hashed grid must match the brute force sum over every particle pair:
+	{
+		wiEmittedParticle emitter;
+		emitter.SetSPHEnabled(true);
+		emitter.life = 100;
+		emitter.normal_factor = 0;
+
+		wiEmittedParticleCPU simulation;
+		simulation.Initialize(2000);
+		for (int i = 0; i < 20; ++i)
+		{
+			simulation.Update(emitter, world, nullptr, wiEmittedParticleCPU::Environment(), 100, 0.016f);
+		}
+		simulation.Update(emitter, world, nullptr, wiEmittedParticleCPU::Environment(), 0, 0);
+
+		const float h = emitter.SPH_h;
+		const float h2 = h * h;
+		const float h9 = h2 * h2 * h2 * h2 * h;
+		const float poly6 = 315.0f / (64.0f * XM_PI * h9);
+		float maxError = 0;
+		for (uint32_t i = 0; i < simulation.GetAliveCount(); ++i)
+		{
+			const Particle a = simulation.GetParticle(i);
+			float density = 0;
+			for (uint32_t j = 0; j < simulation.GetAliveCount(); ++j)
+			{
+				const Particle b = simulation.GetParticle(j);
+				const float r2 = wiMath::DistanceSquared(a.position, b.position);
+				if (r2 < h2)
+				{
+					const float w = h2 - r2;
+					density += b.mass * poly6 * w * w * w;
+				}
+			}
+			density = std::max(emitter.SPH_p0, density);
+			maxError = std::max(maxError, std::abs(density - simulation.GetDensity(i)) / density);
+		}
+		ss << "SPH density (" << simulation.GetAliveCount() << " particles): " << (maxError < 0.001f ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+	}
+
+	// Performance: 100k particles with two force fields and a row of colliders, then an SPH fluid:
+	{
+		wiEmittedParticle emitter;
+		emitter.life = 1000;
+		emitter.SetDepthCollisionEnabled(true);
+
+		wiEmittedParticleCPU::ForceField forces[2];
+		forces[0].planar = true;
+		forces[0].gravity = 9.8f;
+		forces[1].position = XMFLOAT3(3, 0, 0);
+		forces[1].gravity = -5;
+		forces[1].range_inverse = 0.2f;
+		AABB colliders[8];
+		for (size_t i = 0; i < arraysize(colliders); ++i)
+		{
+			colliders[i] = AABB(XMFLOAT3(i * 2.0f - 8, -3, -1), XMFLOAT3(i * 2.0f - 7, -2, 1));
+		}
+		wiEmittedParticleCPU::Environment environment;
+		environment.forceFields = forces;
+		environment.forceFieldCount = (uint32_t)arraysize(forces);
+		environment.colliders = colliders;
+		environment.colliderCount = (uint32_t)arraysize(colliders);
+
+		const uint32_t particleCount = 100000;
+		const int frameCount = 20;
+		wiEmittedParticleCPU simulation;
+		simulation.Initialize(particleCount);
+		simulation.Update(emitter, world, nullptr, environment, particleCount, 0.016f);
+
+		timer.record();
+		for (int i = 0; i < frameCount; ++i)
+		{
+			simulation.Update(emitter, world, nullptr, environment, 0, 0.016f);
+		}
+		double time = timer.elapsed() / frameCount;
+		ss << particleCount << " particles: " << time << " ms per frame, " << (int)(particleCount / time) << " particles per millisecond" << std::endl;
+
+		// The fluid is emitted from the surface of a quad, so the particles start spread out:
+		MeshComponent quad;
+		quad.vertex_positions = { XMFLOAT3(-15, 2, -10), XMFLOAT3(15, 2, -10), XMFLOAT3(15, 2, 10), XMFLOAT3(-15, 2, 10) };
+		quad.indices = { 0, 1, 2, 0, 2, 3 };
+
+		const uint32_t fluidCount = 10000;
+		emitter.SetSPHEnabled(true);
+		emitter.SetDepthCollisionEnabled(false);
+		simulation.Initialize(fluidCount);
+		simulation.Update(emitter, world, &quad, wiEmittedParticleCPU::Environment(), fluidCount, 0.016f);
+
+		timer.record();
+		for (int i = 0; i < frameCount; ++i)
+		{
+			simulation.Update(emitter, world, &quad, wiEmittedParticleCPU::Environment(), 0, 0.016f);
+		}
+		time = timer.elapsed() / frameCount;
+		ss << fluidCount << " SPH particles: " << time << " ms per frame" << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunHairParticleCPUTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Hair particle CPU simulation test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunHairParticleCPUTest() function." << std::endl << std::endl;
+
+	// Two triangles with the same area, the vertex weights of the second one are three times higher:
+	MeshComponent mesh;
+	mesh.vertex_positions = { XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT3(2, 0, 0), XMFLOAT3(2, 0, 1), XMFLOAT3(3, 0, 0) };
+	mesh.vertex_normals = std::vector<XMFLOAT3>(mesh.vertex_positions.size(), XMFLOAT3(0, 1, 0));
+	mesh.indices = { 0, 1, 2, 3, 4, 5 };
+
+	wiHairParticle hair;
+	hair.strandCount = 10000;
+	hair.segmentCount = 3;
+	hair.vertex_weights = { 1, 1, 1, 3, 3, 3 };
+
+	// Every leading range of the strands must follow the weights, this is what makes the density LOD work:
+	{
+		wiHairParticleCPU simulation;
+		simulation.Generate(hair, mesh);
+
+		bool ok = true;
+		const uint32_t prefixes[] = { 8, 64, 1000, 10000 };
+		for (uint32_t prefix : prefixes)
+		{
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < prefix; ++i)
+			{
+				count += simulation.GetStrandRoot(i).x > 1.5f ? 1 : 0;
+			}
+			ok &= std::abs((float)count - prefix * 0.75f) <= 1;
+		}
+		ss << "Strand density follows the vertex weights: " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+
+		wiHairParticleCPU simulation2;
+		simulation2.Generate(hair, mesh);
+		ok = true;
+		for (uint32_t i = 0; i < simulation.GetStrandCount(); ++i)
+		{
+			const XMFLOAT3 a = simulation.GetStrandRoot(i);
+			const XMFLOAT3 b = simulation2.GetStrandRoot(i);
+			ok &= a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+		ss << "Deterministic placement: " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+
+		hair.vertex_weights = { 1, 1, 1, 0, 0, 0 };
+		simulation2.Generate(hair, mesh);
+		ok = true;
+		for (uint32_t i = 0; i < simulation2.GetStrandCount(); ++i)
+		{
+			ok &= simulation2.GetStrandRoot(i).x < 1.5f;
+		}
+		ss << "No strands on zero weights: " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+		hair.vertex_weights = { 1, 1, 1, 3, 3, 3 };
+
+		// Without forces, the strands must stay in rest state:
+		wiHairParticleCPU::Environment environment;
+		environment.gravity = XMFLOAT3(0, 0, 0);
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+		for (int i = 0; i < 100; ++i)
+		{
+			simulation.Update(hair, world, environment, simulation.GetStrandCount(), 0.016f);
+		}
+		float maxError = 0;
+		for (uint32_t i = 0; i < simulation.GetStrandCount(); ++i)
+		{
+			for (uint32_t segment = 0; segment < simulation.GetSegmentCount(); ++segment)
+			{
+				maxError = std::max(maxError, std::abs(simulation.GetPatch(i, segment).normal.y - 1));
+			}
+		}
+		ss << "Rest state is stable: " << (maxError < 0.0001f ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+	}
+
+	// Performance: 100k strands on a big quad with a force field and wind, first up close, then from a distance with the density LOD:
+	{
+		MeshComponent quad;
+		quad.vertex_positions = { XMFLOAT3(-50, 0, -50), XMFLOAT3(50, 0, -50), XMFLOAT3(50, 0, 50), XMFLOAT3(-50, 0, 50) };
+		quad.vertex_normals = std::vector<XMFLOAT3>(quad.vertex_positions.size(), XMFLOAT3(0, 1, 0));
+		quad.indices = { 0, 2, 1, 0, 3, 2 };
+		quad.aabb = AABB(XMFLOAT3(-50, 0, -50), XMFLOAT3(50, 0, 50));
+
+		wiHairParticle grass;
+		grass.strandCount = 100000;
+		grass.segmentCount = 4;
+		grass.SetCPUSimulationEnabled(true);
+		TransformComponent transform;
+
+		wiHairParticleCPU::ForceField force;
+		force.position = XMFLOAT3(0, 1, 0);
+		force.gravity = -3;
+		force.range_inverse = 0.1f;
+		wiHairParticleCPU::Environment environment;
+		environment.forceFields = &force;
+		environment.forceFieldCount = 1;
+		environment.wind = XMFLOAT3(2, 0, 1);
+
+		const int frameCount = 20;
+		const XMFLOAT3 far_eye = XMFLOAT3(0, grass.viewDistance * 0.4f, 0);
+		for (int lod = 0; lod < 2; ++lod)
+		{
+			grass.SetDensityLODEnabled(lod != 0);
+			grass.UpdateCPU(transform, quad, 0);
+			grass.UpdateSimulationCPU(transform, quad, environment, far_eye, 0.016f);
+
+			timer.record();
+			for (int i = 0; i < frameCount; ++i)
+			{
+				grass.UpdateSimulationCPU(transform, quad, environment, far_eye, 0.016f);
+			}
+			const double time = timer.elapsed() / frameCount;
+			const uint32_t activeStrandCount = grass.GetSimulationCPU()->GetActiveStrandCount();
+			ss << (lod ? "With density LOD: " : "Without LOD: ") << activeStrandCount << " strands, " << time << " ms, ";
+			ss << (int)(activeStrandCount / time) << " strands per millisecond" << std::endl;
+		}
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunOceanCPUTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Ocean CPU simulation test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunOceanCPUTest() function." << std::endl << std::endl;
+
+	WeatherComponent::OceanParameters params;
+	const int N = params.dmap_dim;
+	const float time = 3.7f;
+
+	// Reference: the GPU simulation evaluated directly (oceanSimulatorCS, the FFT as a plain DFT and oceanUpdateDisplacementMapCS):
+	std::vector<XMFLOAT2> h0((N + 4) * (N + 1));
+	std::vector<float> omega((N + 4) * (N + 1));
+	wiOceanCPU::InitHeightMap(params, 0, h0.data(), omega.data());
+
+	std::vector<double> ht_re(N * N), ht_im(N * N), dir_x(N * N), dir_z(N * N);
+	for (int y = 0; y < N; ++y)
+	{
+		for (int x = 0; x < N; ++x)
+		{
+			const XMFLOAT2 h0_k = h0[y * (N + 4) + x];
+			const XMFLOAT2 h0_mk = h0[(N - y) * (N + 4) + (N - x)];
+			const double phase = (double)omega[y * (N + 4) + x] * time * params.time_scale;
+			ht_re[y * N + x] = (h0_k.x + h0_mk.x) * std::cos(phase) - (h0_k.y + h0_mk.y) * std::sin(phase);
+			ht_im[y * N + x] = (h0_k.x - h0_mk.x) * std::sin(phase) + (h0_k.y - h0_mk.y) * std::cos(phase);
+			const double kx = x - N * 0.5;
+			const double ky = y - N * 0.5;
+			const double sqr_k = kx * kx + ky * ky;
+			const double rsqr_k = sqr_k > 1e-12 ? 1 / std::sqrt(sqr_k) : 0;
+			dir_x[y * N + x] = kx * rsqr_k;
+			dir_z[y * N + x] = ky * rsqr_k;
+		}
+	}
+	std::vector<double> cos_table(N), sin_table(N);
+	for (int i = 0; i < N; ++i)
+	{
+		cos_table[i] = std::cos(-2 * XM_PI * i / N);
+		sin_table[i] = std::sin(-2 * XM_PI * i / N);
+	}
+	auto reference = [&](int mx, int mz) {
+		double height = 0, disp_x = 0, disp_z = 0;
+		for (int y = 0; y < N; ++y)
+		{
+			for (int x = 0; x < N; ++x)
+			{
+				const int i = y * N + x;
+				const int p = (x * mx + y * mz) & (N - 1);
+				// Real part of the products with exp(-2*pi*i*(k.m)/N), D(x) = (ht.y * dir_x, -ht.x * dir_x):
+				const double re = ht_re[i] * cos_table[p] - ht_im[i] * sin_table[p];
+				const double im = ht_im[i] * cos_table[p] + ht_re[i] * sin_table[p];
+				height += re;
+				disp_x += im * dir_x[i];
+				disp_z += im * dir_z[i];
+			}
+		}
+		const double sign_correction = ((mx + mz) & 1) ? -1 : 1;
+		return XMFLOAT3(float(disp_x * sign_correction * params.choppy_scale), float(height * sign_correction), float(disp_z * sign_correction * params.choppy_scale));
+	};
+
+	wiOceanCPU ocean_full;
+	ocean_full.Initialize(params, N);
+	ocean_full.Update(time);
+
+	double rms = 0;
+	for (int z = 0; z < N; ++z)
+	{
+		for (int x = 0; x < N; ++x)
+		{
+			const float h = ocean_full.GetDisplacementTexel(x, z).y;
+			rms += h * h;
+		}
+	}
+	rms = std::sqrt(rms / (N * N));
+	ss << "Wave height RMS: " << rms << std::endl;
+
+	// The full resolution CPU simulation must match the GPU formulation:
+	{
+		float maxError = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			const int mx = (i * 97 + 13) % N;
+			const int mz = (i * 211 + 5) % N;
+			const XMFLOAT3 expected = reference(mx, mz);
+			const XMFLOAT4 result = ocean_full.GetDisplacementTexel(mx, mz);
+			maxError = std::max(maxError, std::abs(result.x - expected.x));
+			maxError = std::max(maxError, std::abs(result.y - expected.y));
+			maxError = std::max(maxError, std::abs(result.z - expected.z));
+		}
+		ss << "Full resolution matches the GPU formulation, max error " << maxError / rms << " * RMS: " << (maxError < 1e-3f * rms ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// The height query finds the displaced surface point that is over the query position:
+	{
+		const float texelLength = params.patch_length / N;
+		uint32_t missCount = 0;
+		const uint32_t queryCount = 10000;
+		for (uint32_t i = 0; i < queryCount; ++i)
+		{
+			const float x = i * 0.0731f - 200;
+			const float z = i * 0.0377f + 50;
+			const XMFLOAT2 p = ocean_full.FindSurfacePoint(x, z);
+			const XMFLOAT3 d = ocean_full.GetDisplacement(p.x, p.y);
+			const float distance = std::sqrt((p.x + d.x - x) * (p.x + d.x - x) + (p.y + d.z - z) * (p.y + d.z - z));
+			missCount += distance > 0.01f * texelLength ? 1 : 0;
+			const float height = ocean_full.SampleHeight(x, z);
+			missCount += height != params.waterHeight + d.y ? 1 : 0;
+		}
+		ss << "Height query finds the displaced surface, " << missCount << " misses of " << queryCount << ": " << (missCount < queryCount / 100 ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// Lower resolutions only simulate the lower frequencies, the error is the energy of the missing waves:
+	ss << std::endl;
+	for (uint32_t resolution = 32; resolution <= 256; resolution *= 2)
+	{
+		wiOceanCPU ocean;
+		ocean.Initialize(params, resolution);
+		ocean.Update(time);
+
+		const int step = N / (int)resolution;
+		double error = 0;
+		for (uint32_t z = 0; z < resolution; ++z)
+		{
+			for (uint32_t x = 0; x < resolution; ++x)
+			{
+				const double d = ocean.GetDisplacementTexel(x, z).y - ocean_full.GetDisplacementTexel(x * step, z * step).y;
+				error += d * d;
+			}
+		}
+		error = std::sqrt(error / (resolution * resolution));
+
+		const int frameCount = 10;
+		timer.record();
+		for (int i = 0; i < frameCount; ++i)
+		{
+			ocean.Update(time + i * 0.016f);
+		}
+		const double updateTime = timer.elapsed() / frameCount;
+
+		ss << resolution << " x " << resolution << ": height RMS error " << error / rms << " * RMS, update " << updateTime << " ms, " << ocean.GetMemorySizeInBytes() / 1024 << " KB" << std::endl;
+	}
+
+	// Query throughput, for example buoyancy sample points:
+	{
+		wiOceanCPU ocean;
+		ocean.Initialize(params, 64);
+
+		const uint32_t queryCount = 100000;
+		std::vector<XMFLOAT2> positions(queryCount);
+		std::vector<float> heights(queryCount);
+		for (uint32_t i = 0; i < queryCount; ++i)
+		{
+			positions[i] = XMFLOAT2((float)wiRandom::getRandom(-500, 500), (float)wiRandom::getRandom(-500, 500));
+		}
+		ocean.SampleHeight(positions.data(), heights.data(), queryCount, time);
+
+		const int frameCount = 10;
+		timer.record();
+		for (int i = 0; i < frameCount; ++i)
+		{
+			ocean.SampleHeight(positions.data(), heights.data(), queryCount, time);
+		}
+		const double queryTime = timer.elapsed() / frameCount;
+		ss << std::endl << queryCount << " height queries: " << queryTime << " ms, " << (int)(queryCount / queryTime) << " queries per millisecond" << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunRandomTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Random number generation test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunRandomTest() function." << std::endl << std::endl;
+
+	const uint32_t sampleCount = 1000000;
+
+	// Chi-square test of 100 equally likely buckets, 148.2 is the critical value of 99 degrees of freedom at p = 0.001:
+	auto chi_square = [](const std::vector<uint32_t>& buckets, uint32_t count) {
+		const double expected = (double)count / buckets.size();
+		double sum = 0;
+		for (uint32_t x : buckets)
+		{
+			sum += (x - expected) * (x - expected) / expected;
+		}
+		return sum;
+	};
+	const double critical = 148.2;
+
+	// Explicit seeding makes the sequence of the thread reproducible:
+	{
+		int a[16], b[16];
+		wiRandom::seed(1234);
+		for (int& x : a)
+		{
+			x = wiRandom::getRandom(0, 1000000);
+		}
+		wiRandom::seed(1234);
+		for (int& x : b)
+		{
+			x = wiRandom::getRandom(0, 1000000);
+		}
+		bool ok = std::equal(a, a + 16, b);
+
+		wiRandom::Generator generator(42), generator2(42), generator3(43);
+		bool different = false;
+		for (int i = 0; i < 16; ++i)
+		{
+			const uint32_t x = generator.nextUint();
+			ok &= x == generator2.nextUint();
+			different |= x != generator3.nextUint();
+		}
+		ss << "Reproducible with seed: " << (ok && different ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// Uniformity of the integers:
+	{
+		std::vector<uint32_t> buckets(100);
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			buckets[wiRandom::getRandom(0, 99)]++;
+		}
+		const double x2 = chi_square(buckets, sampleCount);
+		ss << "getRandom() chi-square: " << x2 << " " << (x2 < critical ? "[OK]" : "[FAIL]") << std::endl;
+
+		std::vector<int> values(sampleCount);
+		wiRandom::fillInt(values.data(), values.size(), -50, 49);
+		std::fill(buckets.begin(), buckets.end(), 0);
+		for (int x : values)
+		{
+			buckets[x + 50]++;
+		}
+		const double x2_fill = chi_square(buckets, sampleCount);
+		ss << "fillInt() chi-square: " << x2_fill << " " << (x2_fill < critical ? "[OK]" : "[FAIL]") << std::endl;
+
+		std::fill(buckets.begin(), buckets.end(), 0);
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			buckets[std::min(99u, uint32_t(wiRandom::hashToFloat(i, 7) * 100))]++;
+		}
+		const double x2_hash = chi_square(buckets, sampleCount);
+		ss << "hashToFloat() chi-square: " << x2_hash << " " << (x2_hash < critical ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// Moments and serial correlation of the floats:
+	{
+		std::vector<float> values(sampleCount);
+		wiRandom::fillFloat(values.data(), values.size());
+		double mean = 0, variance = 0, correlation = 0;
+		bool inRange = true;
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			inRange &= values[i] >= 0 && values[i] < 1;
+			mean += values[i];
+		}
+		mean /= sampleCount;
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			variance += (values[i] - mean) * (values[i] - mean);
+			correlation += (values[i] - mean) * (values[(i + 1) % sampleCount] - mean);
+		}
+		correlation /= variance;
+		variance /= sampleCount;
+		const bool ok = inRange && std::abs(mean - 0.5) < 0.002 && std::abs(variance - 1.0 / 12.0) < 0.001 && std::abs(correlation) < 0.005;
+		ss << "fillFloat() mean " << mean << ", variance " << variance << ", serial correlation " << correlation << " " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// Normal distribution:
+	{
+		std::vector<float> values(sampleCount);
+		wiRandom::fillGaussian(values.data(), values.size());
+		double mean = 0, variance = 0;
+		uint32_t oneSigma = 0;
+		for (float x : values)
+		{
+			mean += x;
+			oneSigma += std::abs(x) < 1 ? 1 : 0;
+		}
+		mean /= sampleCount;
+		for (float x : values)
+		{
+			variance += (x - mean) * (x - mean);
+		}
+		variance /= sampleCount;
+		const double fraction = (double)oneSigma / sampleCount;
+		const bool ok = std::abs(mean) < 0.005 && std::abs(variance - 1) < 0.01 && std::abs(fraction - 0.6827) < 0.003;
+		ss << "fillGaussian() mean " << mean << ", variance " << variance << ", within one sigma " << fraction << " " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// Unit vectors:
+	{
+		std::vector<XMFLOAT3> values(sampleCount);
+		wiRandom::fillUnitVector(values.data(), values.size());
+		XMVECTOR sum = XMVectorZero();
+		float maxError = 0;
+		for (auto& x : values)
+		{
+			const XMVECTOR v = XMLoadFloat3(&x);
+			sum = XMVectorAdd(sum, v);
+			maxError = std::max(maxError, std::abs(XMVectorGetX(XMVector3Length(v)) - 1));
+		}
+		const float bias = XMVectorGetX(XMVector3Length(sum)) / sampleCount;
+		ss << "fillUnitVector() length error " << maxError << ", mean length " << bias << " " << (maxError < 1e-4f && bias < 0.005f ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+	}
+
+	// Throughput against the previous generator (std::mt19937 with the standard distributions):
+	{
+		std::mt19937 mt(1234);
+		std::vector<int> ints(sampleCount);
+		std::vector<float> floats(sampleCount);
+		int checksum = 0;
+
+		timer.record();
+		for (auto& x : ints)
+		{
+			std::uniform_int_distribution<int> distr(0, 99);
+			x = distr(mt);
+		}
+		double time_std = timer.elapsed();
+		timer.record();
+		for (auto& x : ints)
+		{
+			x = wiRandom::getRandom(0, 99);
+		}
+		double time_wi = timer.elapsed();
+		timer.record();
+		wiRandom::fillInt(ints.data(), ints.size(), 0, 99);
+		double time_fill = timer.elapsed();
+		checksum += ints[0];
+		ss << sampleCount << " ints: std::mt19937 " << time_std << " ms, getRandom() " << time_wi << " ms, fillInt() " << time_fill << " ms" << std::endl;
+
+		timer.record();
+		std::uniform_real_distribution<float> uniform(0, 1);
+		for (auto& x : floats)
+		{
+			x = uniform(mt);
+		}
+		time_std = timer.elapsed();
+		timer.record();
+		wiRandom::fillFloat(floats.data(), floats.size());
+		time_fill = timer.elapsed();
+		checksum += (int)floats[0];
+		ss << sampleCount << " floats: std::mt19937 " << time_std << " ms, fillFloat() " << time_fill << " ms" << std::endl;
+
+		timer.record();
+		std::normal_distribution<float> normal(0, 1);
+		for (auto& x : floats)
+		{
+			x = normal(mt);
+		}
+		time_std = timer.elapsed();
+		timer.record();
+		wiRandom::fillGaussian(floats.data(), floats.size());
+		time_fill = timer.elapsed();
+		checksum += (int)floats[0];
+		ss << sampleCount << " gaussians: std::mt19937 " << time_std << " ms, fillGaussian() " << time_fill << " ms" << std::endl;
+
+		timer.record();
+		uint32_t hashed = 0;
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			hashed += wiRandom::hash(i, 7);
+		}
+		const double time_hash = timer.elapsed();
+		checksum += (int)(hashed & 1);
+		ss << sampleCount << " hashes: " << time_hash << " ms (checksum " << checksum << ")" << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunScriptPoolTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Lua script pool test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunScriptPoolTest() function." << std::endl << std::endl;
+
+	// Every entity moves itself and pushes the next entity with a message, a broadcast message sets the scale of everyone:
+	static const char* script = R"(
+		Mover = {
+			update = function(self, dt)
+				local x, y, z = GetPosition(self.entity)
+				local s = 0
+				for i = 1, 20 do
+					s = s + math.sin(x * i + y)
+				end
+				Translate(self.entity, s * dt * 0.01, dt, 0)
+				if self.next ~= nil then
+					SendMessage(self.next, "push", x)
+				end
+			end,
+			message = function(self, sender, name, value)
+				if name == "next" then
+					self.next = value
+				elseif name == "push" then
+					Translate(self.entity, 0, 0, value * 0.001 + 0.001)
+				elseif name == "scale" then
+					SetScale(self.entity, value, value, value)
+				end
+			end,
+		}
+	)";
+
+	const uint32_t entityCount = 10000;
+	const int frameCount = 20;
+	const float dt = 1.0f / 60.0f;
+
+	Scene scene;
+	std::vector<wiECS::Entity> entities(entityCount);
+	for (uint32_t i = 0; i < entityCount; ++i)
+	{
+		entities[i] = wiECS::CreateEntity();
+		scene.transforms.Create(entities[i]);
+	}
+
+	std::vector<TransformComponent> reference;
+	const uint32_t stateCounts[] = { 1, 4, 16 };
+	double referenceTime = 0;
+	for (uint32_t stateCount : stateCounts)
+	{
+		for (uint32_t i = 0; i < entityCount; ++i)
+		{
+			TransformComponent& transform = *scene.transforms.GetComponent(entities[i]);
+			transform = TransformComponent();
+			transform.translation_local = XMFLOAT3((float)(i % 100), 0, (float)(i / 100));
+		}
+
+		wiLuaScriptPool pool;
+		pool.Initialize(stateCount);
+		bool ok = pool.RunText(script);
+		for (uint32_t i = 0; i < entityCount; ++i)
+		{
+			ok &= pool.AddEntity(entities[i], "Mover");
+			if (i + 1 < entityCount)
+			{
+				pool.SendScriptMessage(entities[i], "next", (double)entities[i + 1]);
+			}
+		}
+
+		timer.record();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			if (frame == frameCount - 2)
+			{
+				pool.SendScriptMessage(wiECS::INVALID_ENTITY, "scale", 2.0);
+			}
+			pool.Update(scene, dt);
+		}
+		const double time = timer.elapsed() / frameCount;
+
+		// Every entity except the first one received the pushes and the broadcast:
+		for (uint32_t i = 0; i < entityCount; ++i)
+		{
+			const TransformComponent& transform = *scene.transforms.GetComponent(entities[i]);
+			ok &= transform.scale_local.x == 2.0f;
+			ok &= i == 0 || transform.translation_local.z > (float)(i / 100) + 0.001f * (frameCount - 2);
+		}
+
+		// The result must be the same as with a single state, bit by bit:
+		bool identical = true;
+		if (reference.empty())
+		{
+			for (uint32_t i = 0; i < entityCount; ++i)
+			{
+				reference.push_back(*scene.transforms.GetComponent(entities[i]));
+			}
+			referenceTime = time;
+		}
+		else
+		{
+			for (uint32_t i = 0; i < entityCount; ++i)
+			{
+				const TransformComponent& transform = *scene.transforms.GetComponent(entities[i]);
+				identical &= memcmp(&transform.translation_local, &reference[i].translation_local, sizeof(XMFLOAT3)) == 0;
+				identical &= memcmp(&transform.rotation_local, &reference[i].rotation_local, sizeof(XMFLOAT4)) == 0;
+				identical &= memcmp(&transform.scale_local, &reference[i].scale_local, sizeof(XMFLOAT3)) == 0;
+			}
+		}
+
+		ss << entityCount << " scripted entities, " << stateCount << (stateCount > 1 ? " states: " : " state: ") << time << " ms per update, speedup " << referenceTime / time;
+		ss << ", messages delivered " << (ok ? "[OK]" : "[FAIL]") << ", same result as 1 state " << (identical ? "[OK]" : "[FAIL]") << std::endl;
+	}
+	ss << std::endl << "Worker threads: " << wiJobSystem::GetThreadCount() << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+
+void TestsRenderer::RunLuaBindingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Lua binding benchmark:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunLuaBindingTest() function." << std::endl << std::endl;
+
+	const int entityCount = 10000;
+	const int frameCount = 10;
+	wiLua* lua = wiLua::GetGlobal();
+	auto get_number = [&](const char* name) {
+		lua_getglobal(lua->GetLuaState(), name);
+		const double value = lua_tonumber(lua->GetLuaState(), -1);
+		lua_pop(lua->GetLuaState(), 1);
+		return value;
+	};
+
+	// Two scenes with the same transforms, one is updated with the per component accessors, the other with the bulk accessors:
+	lua->RunText(R"(
+		binding_test = { entities = {}, positions = {} }
+		binding_test.scene_single = Scene()
+		binding_test.scene_bulk = Scene()
+		for i = 1, )" + std::to_string(entityCount) + R"( do
+			local entity = CreateEntity()
+			binding_test.scene_single.Component_CreateTransform(entity)
+			binding_test.scene_bulk.Component_CreateTransform(entity)
+			binding_test.entities[i] = entity
+		end
+	)");
+
+	// Lua garbage of one frame in KB, the collector is stopped while it's measured:
+	auto measure_garbage = [&](const std::string& frame) {
+		lua->RunText("collectgarbage('collect') collectgarbage('stop') binding_test_memory = collectgarbage('count')");
+		lua->RunText(frame);
+		lua->RunText("binding_test_garbage = collectgarbage('count') - binding_test_memory collectgarbage('restart')");
+		return get_number("binding_test_garbage");
+	};
+
+	const std::string frame_single = R"(
+		local scene = binding_test.scene_single
+		local entities = binding_test.entities
+		for i = 1, #entities do
+			local transform = scene.Component_GetTransform(entities[i])
+			transform.Translate(Vector(0, 0.5, 0))
+		end
+	)";
+	const std::string frame_bulk = R"(
+		local scene = binding_test.scene_bulk
+		local positions = binding_test.positions
+		local _, count = scene.Component_ReadArray(binding_test.entities, TRANSFORM_TRANSLATION, positions)
+		for i = 2, count * 3, 3 do
+			positions[i] = positions[i] + 0.5
+		end
+		scene.Component_WriteArray(binding_test.entities, TRANSFORM_TRANSLATION, positions)
+	)";
+
+	timer.record();
+	for (int i = 0; i < frameCount - 1; ++i)
+	{
+		lua->RunText(frame_single);
+	}
+	const double time_single = timer.elapsed() / (frameCount - 1);
+	const double garbage_single = measure_garbage(frame_single);
+
+	timer.record();
+	for (int i = 0; i < frameCount - 1; ++i)
+	{
+		lua->RunText(frame_bulk);
+	}
+	const double time_bulk = timer.elapsed() / (frameCount - 1);
+	const double garbage_bulk = measure_garbage(frame_bulk);
+
+	lua->RunText(R"(
+		local a = binding_test.scene_single.Component_ReadArray(binding_test.entities, TRANSFORM_TRANSLATION)
+		local b = binding_test.scene_bulk.Component_ReadArray(binding_test.entities, TRANSFORM_TRANSLATION)
+		binding_test_ok = #a == #binding_test.entities * 3 and 1 or 0
+		for i = 1, #a do
+			if a[i] ~= b[i] or (i % 3 == 2 and a[i] ~= )" + std::to_string(0.5 * frameCount) + R"() then
+				binding_test_ok = 0
+			end
+		end
+	)");
+	const bool ok = get_number("binding_test_ok") == 1;
+
+	ss << entityCount << " transforms translated from Lua, per frame:" << std::endl;
+	ss << "Component_GetTransform() + Translate(Vector): " << time_single << " ms, " << garbage_single << " KB garbage" << std::endl;
+	ss << "Component_ReadArray() + Component_WriteArray(): " << time_bulk << " ms, " << garbage_bulk << " KB garbage, speedup " << time_single / time_bulk << std::endl;
+	ss << "Same result: " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+
+	// Writing fewer values than components is an error, the components are not zeroed:
+	lua->RunText(R"(
+		local scene = binding_test.scene_bulk
+		local before = scene.Component_ReadArray(nil, TRANSFORM_TRANSLATION)
+		scene.Component_WriteArray(nil, TRANSFORM_TRANSLATION, { 1, 2, 3 })
+		local after = scene.Component_ReadArray(nil, TRANSFORM_TRANSLATION)
+		binding_test_ok = #before == #binding_test.entities * 3 and #after == #before and 1 or 0
+		for i = 1, #after do
+			if after[i] ~= before[i] then
+				binding_test_ok = 0
+			end
+		end
+	)");
+	ss << "Short values table is rejected: " << (get_number("binding_test_ok") == 1 ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+
+	lua->RunText("binding_test = nil collectgarbage('collect')");
+
+	// The binding objects come from a free list instead of the aligned heap allocation:
+	{
+		const int objectCount = 100000;
+		std::vector<Vector_BindLua*> objects(objectCount);
+		std::vector<void*> memory(objectCount);
+
+		timer.record();
+		for (int i = 0; i < objectCount; ++i)
+		{
+			memory[i] = _mm_malloc(sizeof(Vector_BindLua), 16);
+		}
+		for (int i = 0; i < objectCount; ++i)
+		{
+			_mm_free(memory[i]);
+		}
+		const double time_heap = timer.elapsed();
+
+		for (int i = 0; i < objectCount; ++i)
+		{
+			objects[i] = new Vector_BindLua(XMVectorZero());
+		}
+		for (int i = 0; i < objectCount; ++i)
+		{
+			delete objects[i];
+		}
+		timer.record();
+		for (int i = 0; i < objectCount; ++i)
+		{
+			objects[i] = new Vector_BindLua(XMVectorZero());
+		}
+		for (int i = 0; i < objectCount; ++i)
+		{
+			delete objects[i];
+		}
+		const double time_pool = timer.elapsed();
+
+		ss << objectCount << " Vector objects allocated and freed: heap " << time_heap << " ms, pool " << time_pool << " ms, speedup " << time_heap / time_pool << std::endl;
+		ss << "Vector pool: " << wiLuaAllocator<Vector_BindLua>::GetAllocatedCount() << " live objects, capacity " << wiLuaAllocator<Vector_BindLua>::GetCapacity() << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+
+void TestsRenderer::RunNetworkLoopbackTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Network loopback test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunNetworkLoopbackTest() function." << std::endl << std::endl;
+
+	using namespace wiNetwork;
+
+	const uint16_t port = 27777;
+	Socket receiver, sender;
+	bool ok = CreateSocket(&receiver) && CreateSocket(&sender) && ListenPort(&receiver, port);
+	ok = ok && SetNonBlocking(&receiver);
+	Poller poller;
+	ok = ok && CreatePoller(&poller) && PollerAdd(&poller, &receiver);
+	if (!ok)
+	{
+		ss << "Couldn't open the loopback sockets on port " << port << " [FAIL]" << std::endl;
+	}
+	else
+	{
+		Connection target;
+		target.ipaddress = { 127,0,0,1 };
+		target.port = port;
+
+		const size_t batchSize = 64;
+		const size_t payloadSize = 64;
+		Packet sendPackets[batchSize];
+		Packet receivePackets[batchSize];
+		AllocatePackets(sendPackets, batchSize);
+		AllocatePackets(receivePackets, batchSize);
+		for (auto& packet : sendPackets)
+		{
+			packet.connection = target;
+			packet.dataSize = payloadSize;
+		}
+
+		// Every packet carries its sequence number, the received packets are checked against it:
+		auto fill = [&](uint32_t first) {
+			for (size_t i = 0; i < batchSize; ++i)
+			{
+				const uint32_t sequence = first + (uint32_t)i;
+				for (size_t j = 0; j < payloadSize; j += sizeof(uint32_t))
+				{
+					memcpy(sendPackets[i].data + j, &sequence, sizeof(uint32_t));
+				}
+			}
+		};
+
+		// Correctness of the batched path:
+		{
+			fill(1000);
+			size_t sent = SendBatch(&sender, sendPackets, batchSize);
+			size_t received = 0;
+			bool valid = true;
+			const Socket* ready[1];
+			while (received < sent && PollerWait(&poller, ready, 1, 100000) > 0)
+			{
+				const size_t count = ReceiveBatch(ready[0], receivePackets, batchSize);
+				for (size_t i = 0; i < count; ++i)
+				{
+					const Packet& packet = receivePackets[i];
+					uint32_t sequence;
+					memcpy(&sequence, packet.data, sizeof(uint32_t));
+					valid &= packet.dataSize == payloadSize;
+					valid &= sequence == 1000 + received + i;
+					valid &= packet.connection.ipaddress[0] == 127 && packet.connection.ipaddress[3] == 1;
+				}
+				received += count;
+			}
+			ss << "Batched send and receive: " << received << " / " << batchSize << " packets " << (valid && received == batchSize ? "[OK]" : "[FAIL]") << std::endl;
+			ss << "Nothing left to receive: " << (ReceiveBatch(&receiver, receivePackets, batchSize) == 0 ? "[OK]" : "[FAIL]") << std::endl << std::endl;
+		}
+
+		// Throughput, the packets are sent in rounds of batchSize so that the receive buffer of the socket doesn't overflow:
+		const uint32_t rounds = 2000;
+		const uint64_t packetCount = rounds * batchSize;
+		auto report = [&](const char* name, double time) {
+			const Statistics statistics = GetStatistics();
+			ss << name << ": " << statistics.packetsReceived << " / " << packetCount << " packets in " << time << " ms, ";
+			ss << uint64_t(statistics.packetsReceived / (time / 1000.0)) << " packets per second, ";
+			ss << (double)statistics.systemCalls / (statistics.packetsSent + statistics.packetsReceived) << " syscalls per packet";
+			ss << " (lost " << (packetCount - statistics.packetsReceived) << ")" << std::endl;
+		};
+
+		ResetStatistics();
+		timer.record();
+		for (uint32_t round = 0; round < rounds; ++round)
+		{
+			fill(round * batchSize);
+			for (size_t i = 0; i < batchSize; ++i)
+			{
+				Send(&sender, &target, sendPackets[i].data, sendPackets[i].dataSize);
+			}
+			for (size_t i = 0; i < batchSize && CanReceive(&receiver, 100000); ++i)
+			{
+				Receive(&receiver, &receivePackets[0].connection, receivePackets[0].data, PACKET_CAPACITY);
+			}
+		}
+		report("Send() + CanReceive() + Receive()", timer.elapsed());
+
+		ResetStatistics();
+		timer.record();
+		for (uint32_t round = 0; round < rounds; ++round)
+		{
+			fill(round * batchSize);
+			SendBatch(&sender, sendPackets, batchSize);
+			size_t received = 0;
+			const Socket* ready[1];
+			while (received < batchSize)
+			{
+				size_t count = ReceiveBatch(&receiver, receivePackets, batchSize - received);
+				if (count == 0 && PollerWait(&poller, ready, 1, 100000) == 0)
+				{
+					break;
+				}
+				received += count;
+			}
+		}
+		report("SendBatch() + ReceiveBatch() + PollerWait()", timer.elapsed());
+
+		FreePackets(sendPackets, batchSize);
+		FreePackets(receivePackets, batchSize);
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunReplicationTest()
+{
+	std::stringstream ss("");
+	ss << "Scene replication test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunReplicationTest() function." << std::endl << std::endl;
+
+	const uint32_t entityCount = 10000;
+	const uint32_t lightCount = 100;
+	const uint32_t tickCount = 120;
+	const float dt = 1.0f / 60.0f;
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> uniform(0, 1);
+
+	Scene serverScene;
+	Scene clientScene;
+	wiReplication::Server server;
+	wiReplication::Client client;
+	const uint32_t clientIndex = server.AddClient();
+
+	std::vector<wiECS::Entity> entities;
+	std::vector<XMFLOAT3> velocities;
+	for (uint32_t i = 0; i < entityCount; ++i)
+	{
+		const XMFLOAT3 position = XMFLOAT3(uniform(rng) * 1000 - 500, uniform(rng) * 50, uniform(rng) * 1000 - 500);
+		wiECS::Entity entity;
+		if (i < lightCount)
+		{
+			entity = serverScene.Entity_CreateLight("", position, XMFLOAT3(uniform(rng), uniform(rng), uniform(rng)), 1 + uniform(rng) * 10, 5 + uniform(rng) * 20);
+		}
+		else
+		{
+			entity = wiECS::CreateEntity();
+			TransformComponent& transform = serverScene.transforms.Create(entity);
+			transform.translation_local = position;
+			XMStoreFloat4(&transform.rotation_local, XMQuaternionRotationRollPitchYaw(uniform(rng) * XM_2PI, uniform(rng) * XM_2PI, uniform(rng) * XM_2PI));
+		}
+		server.AddEntity(entity);
+		entities.push_back(entity);
+		velocities.push_back(XMFLOAT3(uniform(rng) * 10 - 5, uniform(rng) * 2 - 1, uniform(rng) * 10 - 5));
+	}
+
+	// The previous approach: every tick, the entity and the whole TransformComponent is serialized with wiArchive
+	size_t archiveSize = 0;
+	{
+		wiArchive archive;
+		for (wiECS::Entity entity : entities)
+		{
+			archive << entity;
+			serverScene.transforms.GetComponent(entity)->Serialize(archive);
+		}
+		archiveSize = archive.GetSize();
+	}
+
+	// In-process link that drops packets randomly and delivers them after a latency of a few ticks:
+	struct Datagram
+	{
+		uint32_t deliverTick;
+		std::vector<uint8_t> data;
+	};
+	std::vector<Datagram> toClient, toServer;
+	float lossRate = 0;
+	uint32_t latency = 2;
+	uint32_t tick = 0;
+	auto make_send = [&](std::vector<Datagram>& queue) {
+		std::vector<Datagram>* target = &queue;
+		return [&, target](const void* data, size_t dataSize) {
+			if (uniform(rng) >= lossRate)
+			{
+				target->push_back({ tick + latency, std::vector<uint8_t>((const uint8_t*)data, (const uint8_t*)data + dataSize) });
+			}
+		};
+	};
+	const wiReplication::SendCallback sendToClient = make_send(toClient);
+	const wiReplication::SendCallback sendToServer = make_send(toServer);
+	auto deliver = [&](std::vector<Datagram>& queue, const std::function<void(const Datagram&)>& receive) {
+		size_t count = 0;
+		for (auto& x : queue)
+		{
+			if (x.deliverTick <= tick)
+			{
+				receive(x);
+			}
+			else
+			{
+				queue[count++] = std::move(x);
+			}
+		}
+		queue.resize(count);
+	};
+	auto run_tick = [&](float movingFraction) {
+		const uint32_t movingCount = uint32_t(entityCount * movingFraction);
+		for (uint32_t i = 0; i < movingCount; ++i)
+		{
+			TransformComponent& transform = *serverScene.transforms.GetComponent(entities[i]);
+			transform.Translate(XMFLOAT3(velocities[i].x * dt, velocities[i].y * dt, velocities[i].z * dt));
+			if (i % 4 == 0)
+			{
+				transform.RotateRollPitchYaw(XMFLOAT3(0, dt, 0));
+			}
+		}
+
+		tick++;
+		server.Capture(serverScene);
+		server.Send(clientIndex, sendToClient);
+		deliver(toClient, [&](const Datagram& x) { client.Receive(x.data.data(), x.data.size(), sendToServer); });
+		deliver(toServer, [&](const Datagram& x) { server.Receive(clientIndex, x.data.data(), x.data.size()); });
+		client.Apply(clientScene);
+	};
+
+	// Runs loss-free ticks until the client has the latest state, then compares the scenes:
+	auto verify = [&]() {
+		const float lossRate_prev = lossRate;
+		lossRate = 0;
+		for (uint32_t i = 0; i < latency + 2; ++i)
+		{
+			run_tick(0);
+		}
+		lossRate = lossRate_prev;
+
+		bool ok = true;
+		float maxError = 0;
+		float minDot = 1;
+		uint32_t replicated = 0;
+		for (wiECS::Entity entity : entities)
+		{
+			const TransformComponent* transform = serverScene.transforms.GetComponent(entity);
+			const wiECS::Entity clientEntity = client.GetEntity(server.GetID(entity));
+			const TransformComponent* clientTransform = clientScene.transforms.GetComponent(clientEntity);
+			if (transform == nullptr || server.GetID(entity) == 0)
+			{
+				ok &= clientTransform == nullptr;
+				continue;
+			}
+			if (clientTransform == nullptr)
+			{
+				ok = false;
+				continue;
+			}
+			replicated++;
+			maxError = std::max(maxError, std::abs(transform->translation_local.x - clientTransform->translation_local.x));
+			maxError = std::max(maxError, std::abs(transform->translation_local.y - clientTransform->translation_local.y));
+			maxError = std::max(maxError, std::abs(transform->translation_local.z - clientTransform->translation_local.z));
+			maxError = std::max(maxError, std::abs(transform->scale_local.x - clientTransform->scale_local.x));
+			minDot = std::min(minDot, std::abs(XMVectorGetX(XMQuaternionDot(XMLoadFloat4(&transform->rotation_local), XMLoadFloat4(&clientTransform->rotation_local)))));
+			const LightComponent* light = serverScene.lights.GetComponent(entity);
+			const LightComponent* clientLight = clientScene.lights.GetComponent(clientEntity);
+			if (light != nullptr)
+			{
+				ok &= clientLight != nullptr && clientLight->energy == light->energy && clientLight->range_local == light->range_local;
+			}
+			else
+			{
+				ok &= clientLight == nullptr;
+			}
+		}
+		ok &= clientScene.transforms.GetCount() == replicated;
+		ok &= maxError <= wiReplication::POSITION_PRECISION && minDot > 0.9999f;
+		ss << "Client matches server (" << replicated << " entities, position error " << maxError << ", rotation dot " << minDot << "): " << (ok ? "[OK]" : "[FAIL]") << std::endl;
+	};
+
+	auto scenario = [&](const char* name, float movingFraction, float loss) {
+		lossRate = loss;
+		const wiReplication::Statistics serverStart = server.GetStatistics(clientIndex);
+		const wiReplication::Statistics clientStart = client.GetStatistics();
+		for (uint32_t i = 0; i < tickCount; ++i)
+		{
+			run_tick(movingFraction);
+		}
+		const wiReplication::Statistics& serverEnd = server.GetStatistics(clientIndex);
+		const wiReplication::Statistics& clientEnd = client.GetStatistics();
+		const double bytesPerTick = double(serverEnd.bytes - serverStart.bytes) / tickCount;
+		ss << name << ": " << uint64_t(bytesPerTick) << " bytes per tick (wiArchive: " << archiveSize;
+		if (bytesPerTick > 0)
+		{
+			ss << ", " << uint64_t(archiveSize / bytesPerTick) << "x less";
+		}
+		ss << "), ";
+		ss << double(serverEnd.datagrams - serverStart.datagrams) / tickCount << " datagrams per tick, ";
+		ss << "encode " << (serverEnd.time - serverStart.time) / tickCount << " ms, ";
+		ss << "decode " << (clientEnd.time - clientStart.time) / tickCount << " ms, ";
+		ss << "slices " << (serverEnd.slices - serverStart.slices) << " (full " << (serverEnd.fullSlices - serverStart.fullSlices) << ")" << std::endl;
+		verify();
+	};
+
+	ss << entityCount << " replicated entities, " << tickCount << " ticks, " << latency << " ticks of latency:" << std::endl;
+	scenario("Initial state, no loss", 0, 0);
+	scenario("Every entity moving, 10% loss", 1, 0.1f);
+	scenario("10% of the entities moving, 10% loss", 0.1f, 0.1f);
+	scenario("10% of the entities moving, 30% loss", 0.1f, 0.3f);
+	scenario("Nothing moving, 10% loss", 0, 0.1f);
+
+	// Removal, half of the entities stop being replicated, the other half are removed from the scene:
+	for (uint32_t i = lightCount; i < lightCount + 200; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			server.RemoveEntity(entities[i]);
+		}
+		else
+		{
+			serverScene.Entity_Remove(entities[i]);
+		}
+	}
+	scenario("Removed 200 entities, 10% loss", 0, 0.1f);
+
+	// Component removal, half of the lights stay as entities with only a transform:
+	for (uint32_t i = 0; i < lightCount; i += 2)
+	{
+		serverScene.lights.Remove(entities[i]);
+		serverScene.aabb_lights.Remove(entities[i]);
+	}
+	scenario("Removed 50 light components, 10% loss", 0, 0.1f);
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunAudioMixerTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Audio mixer test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunAudioMixerTest() function." << std::endl << std::endl;
+
+	// Everything is rendered offline into memory, no audio device is needed:
+	const uint32_t sampleRate = 48000;
+	wiAudioMixer mixer(sampleRate);
+	std::vector<float> output;
+	auto render = [&](size_t frameCount) {
+		output.resize(frameCount * wiAudioMixer::CHANNEL_COUNT);
+		mixer.Render(output.data(), frameCount);
+	};
+	auto sine = [](float frequency, uint32_t rate, size_t frameCount, float amplitude) {
+		std::vector<float> samples(frameCount);
+		for (size_t i = 0; i < frameCount; ++i)
+		{
+			samples[i] = amplitude * std::sin(XM_2PI * frequency * float(i) / float(rate));
+		}
+		return samples;
+	};
+	auto result = [&](bool ok) {
+		ss << (ok ? "[OK]" : "[FAIL]") << std::endl;
+	};
+
+	// Mono sine at the output sample rate, the voice volume is applied to both channels:
+	{
+		const std::vector<float> samples = sine(1000, sampleRate, sampleRate, 1);
+		wiAudioMixer::SoundID sound = mixer.CreateSound(samples.data(), samples.size(), 1, sampleRate);
+		wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound);
+		mixer.SetVolume(voice, 0.5f);
+		mixer.Play(voice);
+		render(4801);
+		float error = 0;
+		for (size_t i = 0; i < 4801; ++i)
+		{
+			error = std::max(error, std::abs(output[i * 2 + 0] - 0.5f * samples[i]));
+			error = std::max(error, std::abs(output[i * 2 + 1] - 0.5f * samples[i]));
+		}
+		ss << "Sine, error " << error << ": ";
+		result(error < 1e-6f);
+		mixer.DestroyVoice(voice);
+		mixer.DestroySound(sound);
+	}
+
+	// 44.1 kHz sine resampled to 48 kHz:
+	{
+		const std::vector<float> samples = sine(1000, 44100, 44100, 1);
+		wiAudioMixer::SoundID sound = mixer.CreateSound(samples.data(), samples.size(), 1, 44100);
+		wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound);
+		mixer.Play(voice);
+		render(sampleRate / 2);
+		const std::vector<float> expected = sine(1000, sampleRate, sampleRate / 2, 1);
+		float error = 0;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			error = std::max(error, std::abs(output[i * 2] - expected[i]));
+		}
+		ss << "Resampled 44100 Hz -> " << sampleRate << " Hz, error " << error << ": ";
+		result(error < 0.005f);
+		mixer.DestroyVoice(voice);
+		mixer.DestroySound(sound);
+	}
+
+	// Two voices in different submixes, with submix and master volume:
+	{
+		const std::vector<float> a = sine(440, sampleRate, sampleRate, 0.5f);
+		const std::vector<float> b = sine(660, sampleRate, sampleRate, 0.5f);
+		wiAudioMixer::SoundID soundA = mixer.CreateSound(a.data(), a.size(), 1, sampleRate);
+		wiAudioMixer::SoundID soundB = mixer.CreateSound(b.data(), b.size(), 1, sampleRate);
+		wiAudioMixer::VoiceID voiceA = mixer.CreateVoice(soundA, wiAudio::SUBMIX_TYPE_SOUNDEFFECT);
+		wiAudioMixer::VoiceID voiceB = mixer.CreateVoice(soundB, wiAudio::SUBMIX_TYPE_MUSIC);
+		mixer.SetSubmixVolume(wiAudio::SUBMIX_TYPE_MUSIC, 0.25f);
+		mixer.SetMasterVolume(0.5f);
+		mixer.Play(voiceA);
+		mixer.Play(voiceB);
+		render(10000);
+		float error = 0;
+		for (size_t i = 0; i < 10000; ++i)
+		{
+			error = std::max(error, std::abs(output[i * 2] - 0.5f * (a[i] + 0.25f * b[i])));
+		}
+		ss << "Voices summed into submixes, error " << error << ": ";
+		result(error < 1e-6f);
+		mixer.SetSubmixVolume(wiAudio::SUBMIX_TYPE_MUSIC, 1);
+		mixer.SetMasterVolume(1);
+		mixer.DestroyVoice(voiceA);
+		mixer.DestroyVoice(voiceB);
+		mixer.DestroySound(soundA);
+		mixer.DestroySound(soundB);
+	}
+
+	// Loop region, then ExitLoop() plays until the end and the voice stops:
+	{
+		std::vector<float> ramp(100);
+		for (size_t i = 0; i < ramp.size(); ++i)
+		{
+			ramp[i] = float(i) / 100.0f;
+		}
+		wiAudioMixer::SoundID sound = mixer.CreateSound(ramp.data(), ramp.size(), 1, sampleRate);
+		wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound);
+		mixer.SetLoop(voice, true, 50.0f / sampleRate, 25.0f / sampleRate);
+		mixer.Play(voice);
+		render(1000);
+		bool ok = true;
+		for (size_t i = 0; i < 1000; ++i)
+		{
+			const size_t frame = i < 75 ? i : 50 + (i - 75) % 25;
+			ok &= output[i * 2] == ramp[frame];
+		}
+		mixer.ExitLoop(voice);
+		render(200);
+		for (size_t i = 0; i < 200; ++i)
+		{
+			ok &= output[i * 2] == (i < 50 ? ramp[50 + i] : 0); // the voice was at the beginning of the loop region
+		}
+		ok &= !mixer.IsPlaying(voice);
+		ss << "Loop region and ExitLoop: ";
+		result(ok);
+		mixer.DestroyVoice(voice);
+		mixer.DestroySound(sound);
+	}
+
+	// 3D: emitter to the right of the listener at 4 units, inverse distance attenuation and constant power panning:
+	{
+		const std::vector<float> dc(sampleRate, 1.0f);
+		wiAudioMixer::SoundID sound = mixer.CreateSound(dc.data(), dc.size(), 1, sampleRate);
+		wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound);
+		wiAudio::SoundInstance3D instance3D;
+		instance3D.emitterPos = XMFLOAT3(4, 0, 0);
+		mixer.Set3D(voice, instance3D);
+		mixer.Play(voice);
+		render(256);
+		const float left = output[255 * 2 + 0];
+		const float right = output[255 * 2 + 1];
+		ss << "3D right: left " << left << ", right " << right << ": ";
+		result(std::abs(left) < 1e-6f && std::abs(right - 0.25f) < 1e-6f);
+
+		instance3D.emitterPos = XMFLOAT3(0, 0, 2);
+		mixer.Set3D(voice, instance3D);
+		render(512); // the gain is ramped during the first block
+		const float frontLeft = output[511 * 2 + 0];
+		const float frontRight = output[511 * 2 + 1];
+		ss << "3D front: left " << frontLeft << ", right " << frontRight << ": ";
+		result(std::abs(frontLeft - frontRight) < 1e-6f && std::abs(frontLeft * frontLeft + frontRight * frontRight - 0.25f) < 1e-5f);
+		mixer.DestroyVoice(voice);
+		mixer.DestroySound(sound);
+	}
+
+	// Doppler: an approaching emitter raises the pitch, counted by the zero crossings of a sine:
+	{
+		const std::vector<float> samples = sine(1000, sampleRate, sampleRate * 2, 1);
+		wiAudioMixer::SoundID sound = mixer.CreateSound(samples.data(), samples.size(), 1, sampleRate);
+		wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound);
+		wiAudio::SoundInstance3D instance3D;
+		instance3D.emitterPos = XMFLOAT3(0, 0, 1);
+		instance3D.emitterVelocity = XMFLOAT3(0, 0, -34.35f);
+		mixer.Set3D(voice, instance3D);
+		mixer.Play(voice);
+		render(sampleRate);
+		uint32_t crossings = 0;
+		for (size_t i = 1; i < sampleRate; ++i)
+		{
+			crossings += (output[(i - 1) * 2] < 0) != (output[i * 2] < 0) ? 1 : 0;
+		}
+		const float frequency = crossings / 2.0f;
+		ss << "Doppler, approaching at 10% of the speed of sound: " << frequency << " Hz: ";
+		result(std::abs(frequency - 1000 * 343.5f / (343.5f - 34.35f)) < 2);
+		mixer.DestroyVoice(voice);
+		mixer.DestroySound(sound);
+	}
+
+	// IMA ADPCM, the sound stays compressed and is decoded in chunks while playing:
+	const uint32_t musicLength = 10;
+	std::vector<uint8_t> adpcm;
+	std::vector<int16_t> music(sampleRate * musicLength * 2);
+	{
+		for (size_t i = 0; i < music.size() / 2; ++i)
+		{
+			const float t = float(i) / sampleRate;
+			const float envelope = 0.5f + 0.5f * std::sin(XM_2PI * 0.5f * t);
+			music[i * 2 + 0] = int16_t(12000 * envelope * (std::sin(XM_2PI * 220 * t) + 0.5f * std::sin(XM_2PI * 330 * t)));
+			music[i * 2 + 1] = int16_t(12000 * envelope * (std::sin(XM_2PI * 277 * t) + 0.5f * std::sin(XM_2PI * 440 * t)));
+		}
+		wiAudioMixer::EncodeWAV(music.data(), music.size() / 2, 2, sampleRate, wiAudioMixer::FORMAT_IMA_ADPCM, adpcm);
+		wiAudioMixer::SoundID sound = mixer.LoadSound(adpcm.data(), adpcm.size());
+		wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound, wiAudio::SUBMIX_TYPE_MUSIC);
+		mixer.Play(voice);
+		render(music.size() / 2);
+		double signal = 0;
+		double noise = 0;
+		for (size_t i = 0; i < music.size(); ++i)
+		{
+			const double original = music[i] / 32768.0;
+			signal += original * original;
+			noise += (output[i] - original) * (output[i] - original);
+		}
+		const double snr = 10 * std::log10(signal / std::max(noise, 1e-20));
+		ss << "Streamed IMA ADPCM: " << musicLength << " s stereo in " << adpcm.size() / 1024 << " KB (PCM16: " << music.size() * 2 / 1024 << " KB), ";
+		ss << mixer.GetFrameCount(sound) << " frames, SNR " << snr << " dB: ";
+		result(sound != 0 && mixer.GetFrameCount(sound) == music.size() / 2 && snr > 25 && !mixer.IsPlaying(voice));
+		mixer.DestroyVoice(voice);
+		mixer.DestroySound(sound);
+	}
+	ss << std::endl;
+
+	// Voice throughput, milliseconds of voices mixed per millisecond:
+	{
+		const std::vector<float> samples = sine(440, sampleRate, sampleRate, 0.01f);
+		const std::vector<float> samples44 = sine(440, 44100, 44100, 0.01f);
+		const uint32_t voiceCount = 256;
+		const size_t frameCount = sampleRate;
+		auto benchmark = [&](const char* name, wiAudioMixer::SoundID sound) {
+			std::vector<wiAudioMixer::VoiceID> voices;
+			for (uint32_t i = 0; i < voiceCount; ++i)
+			{
+				wiAudioMixer::VoiceID voice = mixer.CreateVoice(sound, wiAudio::SUBMIX_TYPE(i % 2));
+				mixer.SetLoop(voice, true);
+				mixer.Play(voice);
+				voices.push_back(voice);
+			}
+			output.resize(wiAudioMixer::BLOCK_SIZE * wiAudioMixer::CHANNEL_COUNT);
+			timer.record();
+			for (size_t i = 0; i < frameCount; i += wiAudioMixer::BLOCK_SIZE)
+			{
+				mixer.Render(output.data(), wiAudioMixer::BLOCK_SIZE);
+			}
+			const double time = timer.elapsed();
+			const double audioTime = 1000.0 * frameCount / sampleRate;
+			ss << name << ": " << voiceCount << " voices, " << audioTime << " ms of audio in " << time << " ms, ";
+			ss << uint32_t(voiceCount * audioTime / time) << " voice-ms per ms (voices in real time on one thread)" << std::endl;
+			for (auto voice : voices)
+			{
+				mixer.DestroyVoice(voice);
+			}
+		};
+		wiAudioMixer::SoundID sound = mixer.CreateSound(samples.data(), samples.size(), 1, sampleRate);
+		wiAudioMixer::SoundID sound44 = mixer.CreateSound(samples44.data(), samples44.size(), 1, 44100);
+		wiAudioMixer::SoundID soundADPCM = mixer.LoadSound(adpcm.data(), adpcm.size());
+		benchmark("48 kHz mono", sound);
+		benchmark("44.1 kHz mono, resampled", sound44);
+		benchmark("48 kHz stereo IMA ADPCM, streamed", soundADPCM);
+		mixer.DestroySound(sound);
+		mixer.DestroySound(sound44);
+		mixer.DestroySound(soundADPCM);
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+
+void TestsRenderer::RunFramePipelineTest()
+{
+	std::stringstream ss("");
+	ss << "Frame pipeline test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunFramePipelineTest() function." << std::endl << std::endl;
+
+	const uint32_t objectCount = 10000;
+	const uint32_t meshCount = 16;
+	const uint32_t lightCount = 256;
+	const uint32_t frameCount = 300;
+	const float dt = 1.0f / 60.0f;
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> uniform(0, 1);
+
+	Scene scene;
+	std::vector<wiECS::Entity> meshes;
+	for (uint32_t i = 0; i < meshCount; ++i)
+	{
+		const wiECS::Entity entity = scene.Entity_CreateMesh("");
+		scene.meshes.GetComponent(entity)->aabb = AABB(XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1));
+		meshes.push_back(entity);
+		scene.Entity_CreateMaterial("");
+	}
+	std::vector<XMFLOAT3> velocities;
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		const wiECS::Entity entity = scene.Entity_CreateObject("");
+		scene.objects.GetComponent(entity)->meshID = meshes[i % meshCount];
+		scene.transforms.GetComponent(entity)->Translate(XMFLOAT3(uniform(rng) * 400 - 200, uniform(rng) * 20, uniform(rng) * 400 - 200));
+		velocities.push_back(XMFLOAT3(uniform(rng) * 10 - 5, uniform(rng) * 2 - 1, uniform(rng) * 10 - 5));
+	}
+	for (uint32_t i = 0; i < lightCount; ++i)
+	{
+		scene.Entity_CreateLight("", XMFLOAT3(uniform(rng) * 400 - 200, uniform(rng) * 20, uniform(rng) * 400 - 200), XMFLOAT3(1, 1, 1), 2, 10 + uniform(rng) * 20);
+	}
+	// The first object carries the frame number in its position, so the render stage can check that its state belongs to its frame:
+	const wiECS::Entity probe = scene.objects.GetEntity(0);
+
+	CameraComponent camera;
+	camera.CreatePerspective(1920, 1080, 0.1f, 500);
+
+	// The update stage, the simulation of frame:
+	auto update = [&](uint64_t frame) {
+		for (size_t i = 0; i < scene.objects.GetCount(); ++i)
+		{
+			TransformComponent& transform = *scene.transforms.GetComponent(scene.objects.GetEntity(i));
+			transform.Translate(XMFLOAT3(velocities[i].x * dt, velocities[i].y * dt, velocities[i].z * dt));
+			if (i % 4 == 0)
+			{
+				transform.RotateRollPitchYaw(XMFLOAT3(0, dt, 0));
+			}
+		}
+		scene.transforms.GetComponent(probe)->translation_local = XMFLOAT3(float(frame), 0, 0);
+		scene.transforms.GetComponent(probe)->SetDirty();
+		scene.materials[frame % meshCount].SetDirty();
+		scene.Update(dt);
+
+		const float angle = float(frame) * dt * 0.5f;
+		camera.Eye = XMFLOAT3(0, 10, 0);
+		camera.At = XMFLOAT3(std::sin(angle), -0.1f, std::cos(angle));
+		camera.Up = XMFLOAT3(0, 1, 0);
+		camera.UpdateCamera();
+	};
+
+	// The render state of a frame. The update stage captures it into the buffer of the frame, so the update of the next frame
+	//	can modify the scene while the render stage works from the previous frame:
+	struct FrameState
+	{
+		uint64_t frame = 0;
+		Frustum frustum;
+		std::vector<XMFLOAT4X4> transforms;		// world matrices of the objects
+		std::vector<AABB> objects;
+		std::vector<uint32_t> meshes;			// mesh index of the objects
+		std::vector<AABB> lights;
+		std::vector<uint32_t> dirtyMaterials;
+	};
+	FrameState states[wiFramePipeline::BUFFER_COUNT];
+	auto capture = [&](FrameState& state, uint64_t frame) {
+		state.frame = frame;
+		state.frustum = camera.frustum;
+		state.transforms.resize(scene.objects.GetCount());
+		state.objects.resize(scene.objects.GetCount());
+		state.meshes.resize(scene.objects.GetCount());
+		for (size_t i = 0; i < scene.objects.GetCount(); ++i)
+		{
+			const ObjectComponent& object = scene.objects[i];
+			state.transforms[i] = scene.transforms[object.transform_index].world;
+			state.objects[i] = scene.aabb_objects[i];
+			state.meshes[i] = (uint32_t)scene.meshes.GetIndex(object.meshID);
+		}
+		state.lights.resize(scene.aabb_lights.GetCount());
+		for (size_t i = 0; i < scene.aabb_lights.GetCount(); ++i)
+		{
+			state.lights[i] = scene.aabb_lights[i];
+		}
+		state.dirtyMaterials.clear();
+		for (size_t i = 0; i < scene.materials.GetCount(); ++i)
+		{
+			if (scene.materials[i].IsDirty())
+			{
+				state.dirtyMaterials.push_back(uint32_t(i));
+			}
+		}
+	};
+
+	// The render stage, works only from the captured state. It is headless: culling, batching and the instance and material data
+	//	are computed like for a draw, but written to memory instead of a graphics device:
+	struct FrameResult
+	{
+		double begin = 0;
+		double end = 0;
+		uint32_t visible = 0;
+		bool ok = false;
+	};
+	std::vector<FrameResult> results(frameCount);
+	std::vector<uint32_t> culledObjects;
+	std::vector<XMFLOAT4X4> instances;
+	std::vector<ShaderMaterial> materials;
+	uint64_t firstFrame = 0;
+	auto render = [&](uint64_t frame, uint32_t buffer) {
+		const FrameState& state = states[buffer];
+
+		culledObjects.clear();
+		for (size_t i = 0; i < state.objects.size(); ++i)
+		{
+			if (state.frustum.CheckBox(state.objects[i]))
+			{
+				culledObjects.push_back(uint32_t(i));
+			}
+		}
+		uint32_t culledLights = 0;
+		for (const AABB& light : state.lights)
+		{
+			culledLights += state.frustum.CheckBox(light) ? 1 : 0;
+		}
+
+		materials.clear();
+		for (uint32_t material : state.dirtyMaterials)
+		{
+			ShaderMaterial data = {};
+			data.baseColor = XMFLOAT4(float(material), 1, 1, 1);
+			materials.push_back(data);
+		}
+
+		// Batch the visible objects by mesh:
+		std::sort(culledObjects.begin(), culledObjects.end(), [&](uint32_t a, uint32_t b) {
+			return state.meshes[a] < state.meshes[b];
+		});
+		instances.clear();
+		uint32_t batchCount = 0;
+		size_t batchBegin = 0;
+		while (batchBegin < culledObjects.size())
+		{
+			const uint32_t mesh = state.meshes[culledObjects[batchBegin]];
+			size_t batchEnd = batchBegin;
+			while (batchEnd < culledObjects.size() && state.meshes[culledObjects[batchEnd]] == mesh)
+			{
+				const XMMATRIX W = XMLoadFloat4x4(&state.transforms[culledObjects[batchEnd]]);
+				instances.emplace_back();
+				XMStoreFloat4x4(&instances.back(), XMMatrixTranspose(W));
+				batchEnd++;
+			}
+			batchCount++;
+			batchBegin = batchEnd;
+		}
+
+		FrameResult& result = results[state.frame];
+		result.end = wiTimer::TotalTime();
+		result.visible = (uint32_t)culledObjects.size();
+		result.ok = state.frame == frame - firstFrame && state.transforms[0]._41 == float(state.frame) && batchCount <= meshCount && culledLights <= lightCount;
+	};
+
+	wiFramePipeline pipeline;
+	pipeline.SetRenderCallback(render);
+
+	struct Run
+	{
+		std::vector<double> frameTimes;
+		std::vector<double> latencies;
+		std::vector<uint32_t> visible;
+		double total = 0;
+		bool ok = true;
+	};
+	auto run = [&](bool enabled, wiFramePipeline::PACING pacing) {
+		// Every mode simulates the same frames from the same start:
+		Scene initial;
+		initial.transforms.Copy(scene.transforms);
+		Run result;
+		pipeline.SetEnabled(enabled);
+		pipeline.SetPacing(pacing);
+		// The frame numbers of the pipeline keep counting, but the results are indexed from 0 in every mode:
+		firstFrame = pipeline.GetSubmittedFrameCount();
+		const double begin = wiTimer::TotalTime();
+		double previous = begin;
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			pipeline.BeginFrame();
+			results[i].begin = wiTimer::TotalTime();
+			update(i);
+			pipeline.Submit([&](uint32_t buffer) {
+				capture(states[buffer], i);
+			});
+			const double now = wiTimer::TotalTime();
+			if (i > 0)
+			{
+				result.frameTimes.push_back(now - previous);
+			}
+			previous = now;
+		}
+		pipeline.Sync();
+		result.total = wiTimer::TotalTime() - begin;
+		pipeline.SetEnabled(false);
+		for (const FrameResult& x : results)
+		{
+			result.latencies.push_back(x.end - x.begin);
+			result.visible.push_back(x.visible);
+			result.ok &= x.ok;
+		}
+		scene.transforms.Copy(initial.transforms);
+		return result;
+	};
+	auto percentiles = [&](std::vector<double> values) {
+		std::sort(values.begin(), values.end());
+		auto at = [&](double p) { return values[std::min(values.size() - 1, size_t(p * values.size()))]; };
+		ss << "p50 " << at(0.5) << ", p95 " << at(0.95) << ", p99 " << at(0.99) << ", max " << values.back() << " ms";
+	};
+
+	ss << objectCount << " objects, " << lightCount << " lights, " << frameCount << " frames, " << wiJobSystem::GetThreadCount() << " threads:" << std::endl;
+	run(false, wiFramePipeline::PACING_LATENCY); // warm up the caches and allocations
+
+	const Run serial = run(false, wiFramePipeline::PACING_LATENCY);
+	const Run latency = run(true, wiFramePipeline::PACING_LATENCY);
+	const Run throughput = run(true, wiFramePipeline::PACING_THROUGHPUT);
+	const wiFramePipeline::Statistics statistics = pipeline.GetStatistics();
+
+	ss.precision(2);
+	ss << std::fixed;
+	auto report = [&](const char* name, const Run& x) {
+		ss << name << ": " << x.total / frameCount << " ms per frame (" << serial.total / x.total << "x)" << std::endl;
+		ss << "    frame time: ";
+		percentiles(x.frameTimes);
+		ss << std::endl << "    latency: ";
+		percentiles(x.latencies);
+		ss << std::endl;
+		ss << "    every captured state matches its frame: " << (x.ok ? "[OK]" : "[FAIL]") << std::endl;
+	};
+	report("Serial", serial);
+	report("Pipelined, latency pacing", latency);
+	report("Pipelined, throughput pacing", throughput);
+	ss << "Same visible objects in every mode: " << (serial.visible == latency.visible && serial.visible == throughput.visible ? "[OK]" : "[FAIL]") << std::endl;
+	ss << "Last frame: update " << statistics.updateTime << " ms, capture " << statistics.captureTime << " ms, render " << statistics.renderTime << " ms, " << serial.visible.back() << " visible objects" << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+
+void TestsRenderer::RunFramePacingTest()
+{
+	std::stringstream ss("");
+	ss << "Frame pacing test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunFramePacingTest() function." << std::endl << std::endl;
+	ss.precision(2);
+	ss << std::fixed;
+
+	const uint32_t frameCount = 60;
+	const double targetTime = 10;
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> uniform(2, 6);
+
+	auto percentiles = [&](std::vector<double> values) {
+		std::sort(values.begin(), values.end());
+		auto at = [&](double p) { return values[std::min(values.size() - 1, size_t(p * values.size()))]; };
+		ss << "p50 " << at(0.5) << ", p95 " << at(0.95) << ", p99 " << at(0.99) << ", max " << values.back() << " ms";
+	};
+
+	// The synthetic workload spins, like a frame that keeps the CPU busy:
+	struct Run
+	{
+		std::vector<double> frameTimes;
+		double average = 0;
+		double busy = 0; // share of the time that the CPU was busy (work and spin)
+		uint64_t missed = 0;
+	};
+	auto run = [&](double target, uint32_t spikeInterval) {
+		wiFramePacer pacer;
+		pacer.SetTargetFrameTime(target);
+		pacer.Wait(); // the first frame begins here
+		Run result;
+		double total = 0;
+		double busy = 0;
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			const bool spike = spikeInterval > 0 && i % spikeInterval == spikeInterval - 1;
+			wiHelper::Spin(spike ? 15.0f : uniform(rng));
+			pacer.Wait();
+			const wiFramePacer::Statistics& statistics = pacer.GetStatistics();
+			result.frameTimes.push_back(statistics.frameTime);
+			total += statistics.frameTime;
+			busy += statistics.workTime + statistics.spinTime;
+		}
+		result.average = total / frameCount;
+		result.busy = busy / total;
+		result.missed = pacer.GetStatistics().missedFrames;
+		return result;
+	};
+	auto report = [&](const char* name, const Run& x) {
+		ss << name << ": average " << x.average << " ms, CPU busy " << x.busy * 100 << "%" << std::endl;
+		ss << "    frame time: ";
+		percentiles(x.frameTimes);
+		ss << std::endl;
+	};
+
+	ss << frameCount << " frames of 2-6 ms work, target " << targetTime << " ms:" << std::endl;
+	const Run unpaced = run(0, 0);
+	const Run paced = run(targetTime, 0);
+	const Run spikes = run(targetTime, 15);
+	report("Unpaced", unpaced);
+	report("Paced", paced);
+	report("Paced, 15 ms spike in every 15th frame", spikes);
+	ss << "Average frame time is on target: " << (std::abs(paced.average - targetTime) < targetTime * 0.05 ? "[OK]" : "[FAIL]") << std::endl;
+	ss << "Spikes are missed frames, without catching up after them: " << (spikes.missed >= frameCount / 15 && *std::min_element(spikes.frameTimes.begin(), spikes.frameTimes.end()) > targetTime * 0.5 ? "[OK]" : "[FAIL]") << std::endl;
+	ss << std::endl;
+
+	// Governor with synthetic optional work, the level cost is in milliseconds, a cost of 0 is a feature that is already disabled:
+	{
+		const double levelCosts[] = { 4, 0, 2, 2, 1 };
+		const size_t levelCount = arraysize(levelCosts);
+		bool levelsEnabled[levelCount] = {};
+		wiFrameGovernor governor;
+		for (size_t i = 0; i < levelCount; ++i)
+		{
+			levelsEnabled[i] = levelCosts[i] > 0;
+			governor.AddLevel("Level " + std::to_string(i), [&levelsEnabled, i] {
+				const bool reduced = levelsEnabled[i];
+				levelsEnabled[i] = false;
+				return reduced;
+			}, [&levelsEnabled, i] {
+				levelsEnabled[i] = true;
+			});
+		}
+		const double budget = 12;
+		governor.SetBudget(budget);
+		governor.SetWindow(10);
+
+		wiFramePacer pacer;
+		auto phase = [&](double baseCost, uint32_t frames) {
+			uint32_t changes = 0;
+			for (uint32_t i = 0; i < frames; ++i)
+			{
+				double cost = baseCost;
+				for (size_t j = 0; j < levelCount; ++j)
+				{
+					cost += levelsEnabled[j] ? levelCosts[j] : 0;
+				}
+				wiHelper::Spin(float(cost));
+				pacer.Wait();
+				changes += governor.Update(pacer.GetStatistics().workTime) ? 1 : 0;
+			}
+			ss << "base work " << baseCost << " ms: level " << governor.GetLevel() << ", average work " << governor.GetAverageWorkTime() << " ms, " << changes << " changes" << std::endl;
+		};
+
+		ss << "Governor, budget " << budget << " ms, optional work of 4, 0, 2, 2, 1 ms:" << std::endl;
+		phase(5, 60);
+		const size_t level1 = governor.GetLevel();
+		phase(0, 60);
+		const size_t level2 = governor.GetLevel();
+		phase(10, 80);
+		const size_t level3 = governor.GetLevel();
+		governor.SetBudget(0);
+		const bool restored = levelsEnabled[0] && !levelsEnabled[1] && levelsEnabled[2] && levelsEnabled[3] && levelsEnabled[4];
+		ss << "Reduces to the budget, skips the disabled level: " << (level1 == 1 && level3 == 4 ? "[OK]" : "[FAIL]") << std::endl;
+		ss << "Restores when the saved work fits: " << (level2 == 0 ? "[OK]" : "[FAIL]") << std::endl;
+		ss << "Disabling restores every level: " << (restored && governor.GetLevel() == 0 ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	// The levels of this RenderPath3D, every level is reduced and then restored:
+	{
+		const bool motionBlur = getMotionBlurEnabled();
+		const bool ssao = getSSAOEnabled();
+		const bool reflections = getReflectionsEnabled();
+
+		wiFrameGovernor governor;
+		AddGovernorLevels(governor);
+		governor.SetBudget(1);
+		governor.SetWindow(1);
+		for (size_t i = 0; i < governor.GetLevelCount(); ++i)
+		{
+			governor.Update(100);
+		}
+		const size_t levelCount = governor.GetLevelCount();
+		const bool reduced = !getMotionBlurEnabled() && !getSSAOEnabled() && !getReflectionsEnabled();
+		governor.ClearLevels();
+		const bool restored = getMotionBlurEnabled() == motionBlur && getSSAOEnabled() == ssao && getReflectionsEnabled() == reflections;
+		ss << "RenderPath3D, " << levelCount << " levels: reduced " << (reduced ? "[OK]" : "[FAIL]") << ", restored " << (restored ? "[OK]" : "[FAIL]") << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+
 void TestsRenderer::RunFontTest()
 {
 	static wiFont font;
@@ -17,5 +17,30 @@ public:
 	void RunFontTest();
 	void RunSpriteTest();
 	void RunNetworkTest();
+	void RunReplicationTest();
+	void RunAudioMixerTest();
+	void RunFramePipelineTest();
+	void RunFramePacingTest();
+	void RunClusteredCullingTest();
+	void RunAtlasAllocatorTest();
+	void RunMaterialAtlasTest();
+	void RunMeshLODTest();
+	void RunMeshOptimizerTest();
+	void RunMeshletCullingTest();
+	void RunVertexQuantizationTest();
+	void RunTextureCompressionTest();
+	void RunTextureLoadingTest();
+	void RunVirtualTextureTest();
+	void RunPhysicsMultithreadingTest();
+	void RunPhysicsShapeCacheTest();
+	void RunPhysicsQueryTest();
+	void RunPhysicsFixedTimestepTest();
+	void RunEmittedParticleCPUTest();
+	void RunHairParticleCPUTest();
+	void RunOceanCPUTest();
+	void RunRandomTest();
+	void RunScriptPoolTest();
+	void RunLuaBindingTest();
+	void RunNetworkLoopbackTest();
 };
 
@@ -31,6 +31,8 @@
 #define CBSLOT_RENDERER_BVH						7
 #define CBSLOT_RENDERER_UTILITY					7
 #define CBSLOT_RENDERER_POSTPROCESS				7
+#define CBSLOT_RENDERER_SKINNING				7
+#define CBSLOT_RENDERER_VERTEXSTREAM			8
 
 #define CBSLOT_OTHER_EMITTEDPARTICLE			7
 #define CBSLOT_OTHER_HAIRPARTICLE				7
@@ -6,6 +6,7 @@
 #include "wiInput.h"
 #include "wiBackLog.h"
 #include "MainComponent_BindLua.h"
+#include "wiLuaScriptPool.h"
 #include "wiVersion.h"
 #include "wiEnums.h"
 #include "wiTextureHelper.h"
@@ -25,6 +26,12 @@
 using namespace std;
 using namespace wiGraphics;
 
+MainComponent::~MainComponent()
+{
+	// The render thread must not outlive the component:
+	pipeline.SetEnabled(false);
+}
+
 void MainComponent::Initialize()
 {
 	if (initialized)
@@ -33,11 +40,16 @@ void MainComponent::Initialize()
 	}
 	initialized = true;
 
+	// The levels of the frame governor modify the active path, which the render stage of pipelined mode reads:
+	frameGovernor.onChange = [this] { pipeline.Sync(); };
+
 	wiHelper::GetOriginalWorkingDirectory();
 
 	// User can also create a graphics device if custom logic is desired, but he must do before this function!
 	if (wiRenderer::GetDevice() == nullptr)
 	{
+		pipeline.Sync();
+
 		auto window = wiPlatform::GetWindow();
 
 		bool debugdevice = wiStartupArguments::HasArgument("debugdevice");
@@ -79,10 +91,16 @@ void MainComponent::ActivatePath(RenderPath* component, float fadeSeconds, wiCol
 		return;
 	}
 
+	// The render stage of pipelined mode uses the active path:
+	pipeline.Sync();
+
 	// Fade manager will activate on fadeout
 	fadeManager.Clear();
 	fadeManager.Start(fadeSeconds, fadeColor, [this, component]() {
 
+		// The optional work that the frame governor can reduce belongs to the active path:
+		frameGovernor.ClearLevels();
+
 		if (activePath != nullptr)
 		{
 			activePath->Stop();
@@ -90,6 +108,8 @@ void MainComponent::ActivatePath(RenderPath* component, float fadeSeconds, wiCol
 
 		component->Start();
 		activePath = component;
+
+		component->AddGovernorLevels(frameGovernor);
 	});
 
 	fadeManager.Update(0); // If user calls ActivatePath without fadeout, it will be instant
@@ -110,6 +130,7 @@ void MainComponent::Run()
 		wiRenderer::GetDevice()->PresentBegin(cmd);
 		wiFont(wiBackLog::getText(), wiFontParams(4, 4, infoDisplay.size)).Draw(cmd);
 		wiRenderer::GetDevice()->PresentEnd(cmd);
+		framePacer.Wait();
 		return;
 	}
 
@@ -121,7 +142,19 @@ void MainComponent::Run()
 		wiLua::GetGlobal()->RunFile("startup.lua");
 	}
 
-	wiProfiler::BeginFrame();
+	const bool pipelined = pipeline.IsEnabled() && wiPlatform::IsWindowActive();
+	if (pipelined)
+	{
+		pipeline.BeginFrame();
+		// The render stage reads the live scene, it must finish before the update stage modifies it:
+		pipeline.Sync();
+	}
+	else
+	{
+		// The frame will be rendered on this thread, the render thread must be idle:
+		pipeline.Sync();
+		wiProfiler::BeginFrame();
+	}
 
 	deltaTime = float(std::max(0.0, timer.elapsed() / 1000.0));
 	timer.record();
@@ -132,38 +165,17 @@ void MainComponent::Run()
 
 		const float dt = framerate_lock ? (1.0f / targetFrameRate) : deltaTime;
 
-		fadeManager.Update(dt);
+		RunUpdateStage(dt);
 
-		// Fixed time update:
-		auto range = wiProfiler::BeginRangeCPU("Fixed Update");
+		if (pipelined)
 		{
-			if (frameskip)
-			{
-				deltaTimeAccumulator += dt;
-				if (deltaTimeAccumulator > 10)
-				{
-					// application probably lost control, fixed update would take too long
-					deltaTimeAccumulator = 0;
-				}
-
-				const float targetFrameRateInv = 1.0f / targetFrameRate;
-				while (deltaTimeAccumulator >= targetFrameRateInv)
-				{
-					FixedUpdate();
-					deltaTimeAccumulator -= targetFrameRateInv;
-				}
-			}
-			else
-			{
-				FixedUpdate();
-			}
-		}
-		wiProfiler::EndRange(range); // Fixed Update
-
-		// Variable-timed update:
-		Update(dt);
+			// The lua scripts are signaled here, because they run on this thread:
+			wiLua::GetGlobal()->Render();
 
-		wiInput::Update();
+			pipeline.Submit(nullptr);
+			PaceFrame(true);
+			return;
+		}
 
 		Render();
 	}
@@ -173,23 +185,107 @@ void MainComponent::Run()
 		deltaTimeAccumulator = 0;
 	}
 
+	PresentFrame();
+	PaceFrame(false);
+}
+
+void MainComponent::RunUpdateStage(float dt)
+{
+	if (pipeline.IsEnabled() && fadeManager.IsActive())
+	{
+		// The fade can switch the active path, which the render stage uses:
+		pipeline.Sync();
+	}
+	fadeManager.Update(dt);
+
+	// Fixed time update:
+	auto range = wiProfiler::BeginRangeCPU("Fixed Update");
+	{
+		if (frameskip)
+		{
+			deltaTimeAccumulator += dt;
+			if (deltaTimeAccumulator > 10)
+			{
+				// application probably lost control, fixed update would take too long
+				deltaTimeAccumulator = 0;
+			}
+
+			const float targetFrameRateInv = 1.0f / targetFrameRate;
+			while (deltaTimeAccumulator >= targetFrameRateInv)
+			{
+				FixedUpdate();
+				deltaTimeAccumulator -= targetFrameRateInv;
+			}
+		}
+		else
+		{
+			FixedUpdate();
+		}
+	}
+	wiProfiler::EndRange(range); // Fixed Update
+
+	// Variable-timed update:
+	Update(dt);
+
+	wiInput::Update();
+}
+
+void MainComponent::PresentFrame()
+{
 	CommandList cmd = wiRenderer::GetDevice()->BeginCommandList();
 	wiRenderer::GetDevice()->PresentBegin(cmd);
 	{
 		Compose(cmd);
 		wiProfiler::EndFrame(cmd); // End before Present() so that GPU queries are properly recorded
 	}
+	const double presentBegin = wiTimer::TotalTime();
 	wiRenderer::GetDevice()->PresentEnd(cmd);
+	presentTime = wiTimer::TotalTime() - presentBegin;
 
 	wiRenderer::EndFrame();
 }
 
+void MainComponent::PaceFrame(bool pipelined)
+{
+	// The time that the main thread was blocked is not work:
+	double renderTime = 0;
+	if (pipelined)
+	{
+		const wiFramePipeline::Statistics statistics = pipeline.GetStatistics();
+		framePacer.AddIdleTime(statistics.waitTime);
+		renderTime = statistics.renderTime;
+	}
+	else
+	{
+		framePacer.AddIdleTime(presentTime);
+	}
+
+	framePacer.Wait();
+
+	// In pipelined mode, the frame is as long as the longer of the update and render stages:
+	frameGovernor.Update(std::max(framePacer.GetStatistics().workTime, renderTime));
+}
+
+void MainComponent::setPipelined(bool enabled)
+{
+	pipeline.SetRenderCallback([this](uint64_t frame, uint32_t buffer) {
+		// The render stage of the frame on the render thread:
+		renderThread = true;
+		wiProfiler::BeginFrame();
+		Render();
+		PresentFrame();
+		renderThread = false;
+	});
+	pipeline.SetEnabled(enabled);
+}
+
 void MainComponent::Update(float dt)
 {
 	auto range = wiProfiler::BeginRangeCPU("Update");
 
 	wiLua::GetGlobal()->SetDeltaTime(double(dt));
 	wiLua::GetGlobal()->Update();
+	wiLuaScriptPool::GetGlobal()->Update(wiScene::GetScene(), dt);
 
 	if (GetActivePath() != nullptr)
 	{
@@ -203,6 +299,7 @@ void MainComponent::FixedUpdate()
 {
 	wiBackLog::Update();
 	wiLua::GetGlobal()->FixedUpdate();
+	wiLuaScriptPool::GetGlobal()->FixedUpdate(wiScene::GetScene(), 1.0f / targetFrameRate);
 
 	if (GetActivePath() != nullptr)
 	{
@@ -214,7 +311,11 @@ void MainComponent::Render()
 {
 	auto range = wiProfiler::BeginRangeCPU("Render");
 
-	wiLua::GetGlobal()->Render();
+	if (!renderThread)
+	{
+		// In pipelined mode, the lua scripts are signaled by the update stage instead of the render thread
+		wiLua::GetGlobal()->Render();
+	}
 
 	if (GetActivePath() != nullptr)
 	{
@@ -312,6 +413,8 @@ void MainComponent::Compose(CommandList cmd)
 
 void MainComponent::SetWindow(wiPlatform::window_type window)
 {
+	// The render thread of pipelined mode presents to the window:
+	pipeline.Sync();
 	wiPlatform::GetWindow() = window;
 }
 
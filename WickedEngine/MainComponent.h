@@ -4,6 +4,9 @@
 #include "wiResourceManager.h"
 #include "wiColor.h"
 #include "wiFadeManager.h"
+#include "wiFramePipeline.h"
+#include "wiFramePacer.h"
+#include "wiFrameGovernor.h"
 
 class RenderPath;
 
@@ -21,7 +24,23 @@ protected:
 	float deltaTime = 0;
 	float deltaTimeAccumulator = 0;
 	wiTimer timer;
+
+	wiFramePipeline pipeline;
+	bool renderThread = false;	// Render() and Compose() run on the render thread of pipelined mode
+
+	// Runs the fade, the FixedUpdate() loop, Update() and the input update
+	void RunUpdateStage(float dt);
+	wiFramePacer framePacer;
+	wiFrameGovernor frameGovernor;
+	double presentTime = 0;
+
+	// Runs Compose() on the backbuffer and presents the frame
+	void PresentFrame();
+	// Waits for the frame pacer at the end of the frame and updates the frame governor with the work time of the frame
+	void PaceFrame(bool pipelined);
 public:
+	virtual ~MainComponent();
+
 	bool fullscreen = false;
 
 	// Runs the main engine loop
@@ -41,6 +60,34 @@ public:
 	//	disabled	: the FixedUpdate() loop will run every frame only once.
 	void	setFrameSkip(bool enabled) { frameskip = enabled; }
 	void	setFrameRateLock(bool enabled) { framerate_lock = enabled; }
+	// Limit the frame rate (default = 0, unlimited)
+	//	The end of every frame waits until the target frame time passed, the wait sleeps first and spins at the end (see wiFramePacer)
+	//	This is independent of setTargetFrameRate(), which is the frequency of the FixedUpdate() loop
+	void	setFrameRateLimit(float value) { framePacer.SetTargetFrameRate(value); }
+	float	getFrameRateLimit() const { return framePacer.GetTargetFrameRate(); }
+	// Set the CPU time budget of a frame in milliseconds (default = 0, disabled)
+	//	When the frames work longer, the frame governor reduces the optional work of the active path (see RenderPath::AddGovernorLevels())
+	//	and restores it when there is time for it again. The time that the frame is blocked in the present doesn't count as work
+	void	setFrameBudget(double milliseconds) { frameGovernor.SetBudget(milliseconds); }
+	double	getFrameBudget() const { return frameGovernor.GetBudget(); }
+	wiFramePacer& GetFramePacer() { return framePacer; }
+	wiFrameGovernor& GetFrameGovernor() { return frameGovernor; }
+
+	// Set pipelined mode (default = false), call it from the update stage (not from Render() or Compose())
+	//	disabled	: Update(), Render() and Compose() of a frame run in sequence on the main thread
+	//	enabled		: Render(), Compose() and the present of a frame run on a render thread, while the main thread returns from Run() and processes
+	//				  the window messages. The update stage of the next frame waits for the render stage, because the render paths read the live scene.
+	//	The render thread calls the virtual Render() and Compose(), so a derived class that enables it must call SyncRender() in its destructor.
+	//	Call SyncRender() before resizing the swapchain or changing the device outside of Run(), for example when the window is resized
+	void	setPipelined(bool enabled);
+	bool	isPipelined() const { return pipeline.IsEnabled(); }
+	// Set the frame pacing of pipelined mode (default = PACING_LATENCY)
+	void	setPipelinePacing(wiFramePipeline::PACING value) { pipeline.SetPacing(value); }
+	wiFramePipeline::PACING getPipelinePacing() const { return pipeline.GetPacing(); }
+	// Synchronization point for pipelined mode: waits until the render stage finished every submitted frame
+	void	SyncRender() { pipeline.Sync(); }
+	// Timing of the update and render stages
+	wiFramePipeline::Statistics GetPipelineStatistics() { return pipeline.GetStatistics(); }
 
 	// This is where the critical initializations happen (before any rendering or anything else)
 	virtual void Initialize();
@@ -17,6 +17,8 @@ Luna<MainComponent_BindLua>::FunctionType MainComponent_BindLua::methods[] = {
 	lunamethod(MainComponent_BindLua, SetFrameSkip),
 	lunamethod(MainComponent_BindLua, SetTargetFrameRate),
 	lunamethod(MainComponent_BindLua, SetFrameRateLock),
+	lunamethod(MainComponent_BindLua, SetFrameRateLimit),
+	lunamethod(MainComponent_BindLua, SetFrameBudget),
 	lunamethod(MainComponent_BindLua, SetInfoDisplay),
 	lunamethod(MainComponent_BindLua, SetWatermarkDisplay),
 	lunamethod(MainComponent_BindLua, SetFPSDisplay),
@@ -259,6 +261,40 @@ int MainComponent_BindLua::SetFrameRateLock(lua_State *L)
 		wiLua::SError(L, "SetFrameRateLock(bool enabled) not enought arguments!");
 	return 0;
 }
+int MainComponent_BindLua::SetFrameRateLimit(lua_State *L)
+{
+	if (component == nullptr)
+	{
+		wiLua::SError(L, "SetFrameRateLimit(float value) component is empty!");
+		return 0;
+	}
+
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		component->setFrameRateLimit(wiLua::SGetFloat(L, 1));
+	}
+	else
+		wiLua::SError(L, "SetFrameRateLimit(float value) not enought arguments!");
+	return 0;
+}
+int MainComponent_BindLua::SetFrameBudget(lua_State *L)
+{
+	if (component == nullptr)
+	{
+		wiLua::SError(L, "SetFrameBudget(float milliseconds) component is empty!");
+		return 0;
+	}
+
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		component->setFrameBudget(wiLua::SGetFloat(L, 1));
+	}
+	else
+		wiLua::SError(L, "SetFrameBudget(float milliseconds) not enought arguments!");
+	return 0;
+}
 int MainComponent_BindLua::SetInfoDisplay(lua_State *L)
 {
 	if (component == nullptr)
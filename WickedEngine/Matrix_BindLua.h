@@ -1,6 +1,7 @@
 #pragma once
 #include "wiLua.h"
 #include "wiLuna.h"
+#include "wiLuaAllocator.h"
 #include <DirectXMath.h>
 
 class Matrix_BindLua
@@ -35,6 +36,6 @@ public:
 
 	static void Bind();
 
-	ALIGN_16
+	WILUA_POOLED(Matrix_BindLua)
 };
 
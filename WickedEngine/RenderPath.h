@@ -4,6 +4,8 @@
 
 #include <functional>
 
+class wiFrameGovernor;
+
 class RenderPath
 {
 private:
@@ -40,6 +42,9 @@ public:
 	// Compose the rendered layers (for example blend the layers together as Images)
 	// This will be rendered to the backbuffer
 	virtual void Compose(wiGraphics::CommandList cmd) const {}
+	// Add the optional work that the frame governor can reduce when the frames are over the CPU budget (see MainComponent::setFrameBudget())
+	//	The levels are added when the component is activated, and removed (restored) when an other component is activated
+	virtual void AddGovernorLevels(wiFrameGovernor& governor) {}
 
 	inline uint32_t getLayerMask() const { return layerMask; }
 	inline void setlayerMask(uint32_t value) { layerMask = value; }
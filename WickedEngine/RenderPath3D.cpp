@@ -6,6 +6,7 @@
 #include "wiScene.h"
 #include "ResourceMapping.h"
 #include "wiProfiler.h"
+#include "wiFrameGovernor.h"
 
 using namespace wiGraphics;
 
@@ -322,6 +323,38 @@ void RenderPath3D::Update(float dt)
 	wiRenderer::UpdatePerFrameData(dt, getLayerMask());
 }
 
+void RenderPath3D::AddGovernorLevels(wiFrameGovernor& governor)
+{
+	// The features are reduced in this order, the ones that cost less to lose first:
+	struct Feature
+	{
+		const char* name;
+		bool RenderPath3D::*enabled;
+	};
+	static const Feature features[] = {
+		{ "Motion blur", &RenderPath3D::motionBlurEnabled },
+		{ "Depth of field", &RenderPath3D::depthOfFieldEnabled },
+		{ "Light shafts", &RenderPath3D::lightShaftsEnabled },
+		{ "Lens flare", &RenderPath3D::lensFlareEnabled },
+		{ "SSR", &RenderPath3D::ssrEnabled },
+		{ "SSAO", &RenderPath3D::ssaoEnabled },
+		{ "Volume lights", &RenderPath3D::volumeLightsEnabled },
+		{ "SSS", &RenderPath3D::sssEnabled },
+		{ "Reflections", &RenderPath3D::reflectionsEnabled },
+	};
+	for (const Feature& feature : features)
+	{
+		bool RenderPath3D::*enabled = feature.enabled;
+		governor.AddLevel(feature.name, [this, enabled] {
+			const bool reduced = this->*enabled;
+			this->*enabled = false;
+			return reduced;
+		}, [this, enabled] {
+			this->*enabled = true;
+		});
+	}
+}
+
 void RenderPath3D::Compose(CommandList cmd) const
 {
 	GraphicsDevice* device = wiRenderer::GetDevice();
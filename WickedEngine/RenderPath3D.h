@@ -193,6 +193,7 @@ public:
 
 	void Update(float dt) override;
 	void Render() const override = 0;
+	void AddGovernorLevels(wiFrameGovernor& governor) override;
 	void Compose(wiGraphics::CommandList cmd) const override;
 };
 
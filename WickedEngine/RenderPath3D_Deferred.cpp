@@ -153,6 +153,7 @@ void RenderPath3D_Deferred::Render() const
 		{
 			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
 
+			wiRenderer::BindVirtualTextureFeedback(cmd);
 			device->RenderPassBegin(&renderpass_gbuffer, cmd);
 
 			Viewport vp;
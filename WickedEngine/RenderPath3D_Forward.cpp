@@ -153,6 +153,7 @@ void RenderPath3D_Forward::Render() const
 		{
 			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
 
+			wiRenderer::BindVirtualTextureFeedback(cmd);
 			device->RenderPassBegin(&renderpass_main, cmd);
 
 			Viewport vp;
@@ -58,6 +58,7 @@ void RenderPath3D_TiledDeferred::Render() const
 		{
 			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
 
+			wiRenderer::BindVirtualTextureFeedback(cmd);
 			device->RenderPassBegin(&renderpass_gbuffer, cmd);
 
 			Viewport vp;
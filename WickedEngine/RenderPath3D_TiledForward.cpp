@@ -92,6 +92,7 @@ void RenderPath3D_TiledForward::Render() const
 		{
 			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
 
+			wiRenderer::BindVirtualTextureFeedback(cmd);
 			device->RenderPassBegin(&renderpass_main, cmd);
 
 			Viewport vp;
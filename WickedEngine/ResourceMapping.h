@@ -66,6 +66,16 @@
 #define TEXSLOT_RENDERER_EMISSIVEMAP		TEXSLOT_ONDEMAND4
 #define TEXSLOT_RENDERER_OCCLUSIONMAP		TEXSLOT_ONDEMAND5
 
+// wiRenderer object vertex shaders fetch the positions themselves, because they can be stored in different formats (see VertexStreamCB):
+#define TEXSLOT_RENDERER_VERTEX_POS			TEXSLOT_UNIQUE0
+#define TEXSLOT_RENDERER_VERTEX_PRE			TEXSLOT_UNIQUE1
+
+// wiRenderer object shader virtual texture of the material, it is sampled instead of the base color map (see wiVirtualTexture):
+#define TEXSLOT_RENDERER_VIRTUALTEXTURE				5
+#define SBSLOT_RENDERER_VIRTUALTEXTURE_PAGETABLE	18
+// The main scene pixel shaders write the virtual texture feedback, the UAV slot is after the render targets of the gbuffer:
+#define UAVSLOT_RENDERER_VIRTUALTEXTURE_FEEDBACK	7
+
 // RenderPath texture mappings:
 #define TEXSLOT_RENDERPATH_REFLECTION		TEXSLOT_ONDEMAND6
 #define TEXSLOT_RENDERPATH_REFRACTION		TEXSLOT_ONDEMAND7
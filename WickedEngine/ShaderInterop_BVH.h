@@ -1,6 +1,7 @@
 #ifndef WI_SHADERINTEROP_BVH_H
 #define WI_SHADERINTEROP_BVH_H
 #include "ShaderInterop.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 static const uint BVH_BUILDER_GROUPSIZE = 64;
 
@@ -11,7 +12,9 @@ CBUFFER(BVHCB, CBSLOT_RENDERER_BVH)
 	uint xBVHMaterialOffset;
 	uint xBVHMeshTriangleOffset;
 	uint xBVHMeshTriangleCount;
-	uint xBVHMeshVertexPOSStride;
+	uint xBVHPadding;
+
+	ShaderPositionStream xBVHMeshPositionStream;
 };
 
 
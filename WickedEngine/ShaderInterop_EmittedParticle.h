@@ -2,6 +2,7 @@
 #define WI_SHADERINTEROP_EMITTEDPARTICLE_H
 
 #include "ShaderInterop.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 struct Particle
 {
@@ -34,7 +35,7 @@ CBUFFER(EmittedParticleCB, CBSLOT_OTHER_EMITTEDPARTICLE)
 
 	uint		xEmitCount;
 	uint		xEmitterMeshIndexCount;
-	uint		xEmitterMeshVertexPositionStride;
+	uint		xEmitterPadding;
 	float		xEmitterRandomness;
 
 	float		xParticleSize;
@@ -67,6 +68,7 @@ CBUFFER(EmittedParticleCB, CBSLOT_OTHER_EMITTEDPARTICLE)
 	float		xEmitterFixedTimestep;	// we can force a fixed timestep (>0) onto the simulation to avoid blowing up
 	float		xParticleEmissive;
 
+	ShaderPositionStream xEmitterMeshPositionStream;
 };
 
 #define THREADCOUNT_EMIT 256
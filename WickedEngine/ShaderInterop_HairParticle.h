@@ -2,6 +2,7 @@
 #define WI_SHADERINTEROP_HAIRPARTICLE_H
 
 #include "ShaderInterop.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 #define THREADCOUNT_SIMULATEHAIR 256
 
@@ -36,8 +37,10 @@ CBUFFER(HairParticleCB, CBSLOT_OTHER_HAIRPARTICLE)
 
 	float xHairViewDistance;
 	uint xHairBaseMeshIndexCount;
-	uint xHairBaseMeshVertexPositionStride;
+	uint xHairPadding;
 	uint xHairNumDispatchGroups;
+
+	ShaderPositionStream xHairBaseMeshPositionStream;
 };
 
 #endif // WI_SHADERINTEROP_HAIRPARTICLE_H
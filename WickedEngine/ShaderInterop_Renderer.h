@@ -1,6 +1,7 @@
 #ifndef WI_SHADERINTEROP_RENDERER_H
 #define WI_SHADERINTEROP_RENDERER_H
 #include "ShaderInterop.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 struct ShaderMaterial
 {
@@ -31,6 +32,14 @@ struct ShaderMaterial
 	uint		specularGlossinessWorkflow;
 	uint		occlusion_primary;
 	uint		occlusion_secondary;
+	uint		virtualTextureID;		// 0 if the material doesn't have a virtual texture
+
+	uint2		virtualTextureSize;
+	uint		virtualTexturePageSize;
+	uint		virtualTextureBorder;
+
+	float2		virtualTexturePhysicalSizeRcp;
+	uint		virtualTextureMipCount;
 	uint		padding;
 
 	float4		baseColorAtlasMulAdd;
@@ -231,6 +240,13 @@ CBUFFER(FrameCB, CBSLOT_RENDERER_FRAME)
 	float3		g_xFrame_WorldBoundsExtents;			float pad2_frameCB;		// world enclosing AABB abs(max - min)
 	float3		g_xFrame_WorldBoundsExtents_rcp;								// world enclosing AABB 1.0f / abs(max - min)
 	float		g_xFrame_CloudSpeed;
+
+	uint3		g_xFrame_EntityClusterCount;		// CPU clustered entity culling grid dimensions (zero when disabled)
+	float		g_xFrame_EntityClusterSliceScale;	// depth slice = log(lineardepth) * scale - bias
+
+	float2		g_xFrame_EntityClusterTileSize_rcp;	// cluster tile count / internal resolution
+	float		g_xFrame_EntityClusterSliceBias;
+	float		pad0_entityClusters;
 };
 
 CBUFFER(CameraCB, CBSLOT_RENDERER_CAMERA)
@@ -320,6 +336,12 @@ CBUFFER(TessellationCB, CBSLOT_RENDERER_TESSELLATION)
 	float4 g_f4TessFactors;
 };
 
+CBUFFER(VertexStreamCB, CBSLOT_RENDERER_VERTEXSTREAM)
+{
+	ShaderPositionStream xPositionStream;		// TEXSLOT_RENDERER_VERTEX_POS
+	ShaderPositionStream xPrevPositionStream;	// TEXSLOT_RENDERER_VERTEX_PRE
+};
+
 CBUFFER(DispatchParamsCB, CBSLOT_RENDERER_DISPATCHPARAMS)
 {
 	uint3	xDispatchParams_numThreadGroups;
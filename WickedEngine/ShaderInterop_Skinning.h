@@ -1,10 +1,16 @@
 #ifndef WI_SHADERINTEROP_SKINNING_H
 #define WI_SHADERINTEROP_SKINNING_H
 #include "ShaderInterop.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 
 // Skinning compute params:
 #define SKINNING_COMPUTE_THREADCOUNT 128
 
+CBUFFER(SkinningCB, CBSLOT_RENDERER_SKINNING)
+{
+	ShaderPositionStream xSkinningPositionStream;	// how the source positions are encoded, the output is always full precision
+};
+
 
 #endif // WI_SHADERINTEROP_SKINNING_H
@@ -0,0 +1,83 @@
+#ifndef WI_SHADERINTEROP_VERTEXQUANTIZATION_H
+#define WI_SHADERINTEROP_VERTEXQUANTIZATION_H
+#include "ShaderInterop.h"
+
+// Quantized vertex layouts of the serialized meshes (MeshComponent::QUANTIZED), the encoders are in wiMath:
+//	Position:		3x 16-bit unorm, relative to the mesh AABB (wiMath::QuantizePosition)
+//	Normal:			2x 16-bit snorm octahedral encoding (wiMath::EncodeOctahedral)
+//	Bone weights:	4x 8-bit unorm, summing to exactly 1 (wiMath::QuantizeBoneWeights)
+
+// GPU position streams, the shaders fetch them as raw buffers and decode them with load_vertex_pos():
+//	Full precision (MeshComponent::Vertex_POS): 3x 32-bit float position + 3x 8-bit unorm normal + 8-bit subset index
+//	Quantized (MeshComponent::Vertex_POS16): 3x 16-bit unorm position relative to a box + 8-bit subset index + 8 bits unused + 2x 16-bit snorm octahedral normal
+//	Quantized meshes use the quantized stream, the skinning output is always full precision
+#define VERTEX_POS_STRIDE 16
+#define VERTEX_POS16_STRIDE 12
+
+// GPU bone stream (MeshComponent::Vertex_BON): 4x 16-bit uint bone indices + 4x 16-bit unorm bone weights
+#define VERTEX_BON_STRIDE 16
+
+// Tells the shaders how a position stream is encoded, see MeshComponent::GetPositionStream()
+struct ShaderPositionStream
+{
+	float3 boxMin;
+	uint quantized;
+	float3 boxExtent;
+	uint padding;
+};
+
+#ifndef __cplusplus
+
+// Decode a unit vector from two 16-bit snorm octahedral coordinates
+inline float3 decode_octahedral(in uint value)
+{
+	float2 e = float2((int)(value << 16u) >> 16, (int)value >> 16) / 32767.0f;
+	e = max(e, -1);
+	float3 n = float3(e.x, e.y, 1 - abs(e.x) - abs(e.y));
+	const float t = saturate(-n.z);
+	n.xy += n.xy >= 0 ? -t : t;
+	return normalize(n);
+}
+
+// Decode a position from 16-bit unorm coordinates packed into value.x (x, y) and value.y (z)
+inline float3 decode_position16(in uint2 value, in float3 box_min, in float3 box_extent)
+{
+	const float3 q = float3(value.x & 0xFFFF, value.x >> 16u, value.y & 0xFFFF) / 65535.0f;
+	return box_min + q * box_extent;
+}
+
+// Load the position, normal and subset index of a vertex from a position stream
+inline void load_vertex_pos(in ByteAddressBuffer buffer, in ShaderPositionStream stream, in uint vertexID, out float3 position, out float3 normal, out uint subsetIndex)
+{
+	[branch]
+	if (stream.quantized)
+	{
+		const uint3 value = buffer.Load3(vertexID * VERTEX_POS16_STRIDE);
+		position = decode_position16(value.xy, stream.boxMin, stream.boxExtent);
+		normal = decode_octahedral(value.z);
+		subsetIndex = (value.y >> 16u) & 0xFF;
+	}
+	else
+	{
+		const uint4 value = buffer.Load4(vertexID * VERTEX_POS_STRIDE);
+		position = asfloat(value.xyz);
+		normal = float3(value.w & 0xFF, (value.w >> 8u) & 0xFF, (value.w >> 16u) & 0xFF) / 255.0f * 2.0f - 1.0f;
+		subsetIndex = (value.w >> 24u) & 0xFF;
+	}
+}
+
+// Decode four 16-bit bone indices
+inline uint4 decode_boneindices16(in uint2 value)
+{
+	return uint4(value.x & 0xFFFF, value.x >> 16u, value.y & 0xFFFF, value.y >> 16u);
+}
+
+// Decode four 16-bit unorm bone weights
+inline float4 decode_boneweights16(in uint2 value)
+{
+	return float4(value.x & 0xFFFF, value.x >> 16u, value.y & 0xFFFF, value.y >> 16u) / 65535.0f;
+}
+
+#endif // __cplusplus
+
+#endif // WI_SHADERINTEROP_VERTEXQUANTIZATION_H
@@ -0,0 +1,80 @@
+#ifndef WI_SHADERINTEROP_VIRTUALTEXTURE_H
+#define WI_SHADERINTEROP_VIRTUALTEXTURE_H
+#include "ShaderInterop.h"
+
+// Virtual texture encodings, the CPU side is in wiVirtualTexture:
+//	Page ID:			x (14 bits), y (14 bits), mip (4 bits), written into the feedback buffer by the GPU
+//	Page table entry:	physical slot x (8 bits), physical slot y (8 bits), mip of the resident page (8 bits), valid (1 bit)
+//	Page table buffer:	the entries of every mip level one after the other, mip 0 first
+//	Feedback buffer:	uint2(virtual texture ID, page ID) for every cell of a screen space grid, ID 0 means no request
+
+#define VIRTUALTEXTURE_INVALID_PAGE 0xFFFFFFFF
+#define VIRTUALTEXTURE_ENTRY_VALID (1u << 24u)
+#define VIRTUALTEXTURE_MAX_MIPS 16
+#define VIRTUALTEXTURE_FEEDBACK_SIZE 128
+
+#define VIRTUALTEXTURE_PACK_PAGE(x, y, mip) (((x) & 0x3FFF) | (((y) & 0x3FFF) << 14u) | (((mip) & 0xF) << 28u))
+#define VIRTUALTEXTURE_PAGE_X(page) ((page) & 0x3FFF)
+#define VIRTUALTEXTURE_PAGE_Y(page) (((page) >> 14u) & 0x3FFF)
+#define VIRTUALTEXTURE_PAGE_MIP(page) ((page) >> 28u)
+
+#define VIRTUALTEXTURE_PACK_ENTRY(slotX, slotY, mip) (((slotX) & 0xFF) | (((slotY) & 0xFF) << 8u) | (((mip) & 0xFF) << 16u) | VIRTUALTEXTURE_ENTRY_VALID)
+#define VIRTUALTEXTURE_ENTRY_SLOT_X(entry) ((entry) & 0xFF)
+#define VIRTUALTEXTURE_ENTRY_SLOT_Y(entry) (((entry) >> 8u) & 0xFF)
+#define VIRTUALTEXTURE_ENTRY_MIP(entry) (((entry) >> 16u) & 0xFF)
+
+#ifndef __cplusplus
+
+// Number of pages of a mip level along one axis
+inline uint virtualtexture_pagecount(in uint size, in uint page_size, in uint mip)
+{
+	return (max(1u, size >> mip) + page_size - 1) / page_size;
+}
+
+// Mip level that the uv derivatives of the pixel need
+inline uint virtualtexture_mip(in float2 uv, in uint2 size, in uint mip_count)
+{
+	const float2 dx = ddx(uv) * size;
+	const float2 dy = ddy(uv) * size;
+	const float lod = 0.5f * log2(max(dot(dx, dx), dot(dy, dy)));
+	return (uint)clamp(lod, 0, mip_count - 1.0f);
+}
+
+// Page ID of the page that contains uv at the given mip level, for the feedback buffer
+inline uint virtualtexture_page(in float2 uv, in uint2 size, in uint page_size, in uint mip)
+{
+	const uint2 count = uint2(virtualtexture_pagecount(size.x, page_size, mip), virtualtexture_pagecount(size.y, page_size, mip));
+	const uint2 page = min(uint2(saturate(uv) * max(1u, size >> mip) / page_size), count - 1);
+	return VIRTUALTEXTURE_PACK_PAGE(page.x, page.y, mip);
+}
+
+// Index of a page in the page table buffer
+inline uint virtualtexture_pagetable_index(in uint page, in uint2 size, in uint page_size)
+{
+	const uint mip = VIRTUALTEXTURE_PAGE_MIP(page);
+	uint offset = 0;
+	for (uint i = 0; i < mip; ++i)
+	{
+		offset += virtualtexture_pagecount(size.x, page_size, i) * virtualtexture_pagecount(size.y, page_size, i);
+	}
+	return offset + VIRTUALTEXTURE_PAGE_Y(page) * virtualtexture_pagecount(size.x, page_size, mip) + VIRTUALTEXTURE_PAGE_X(page);
+}
+
+// Translate a virtual uv to the physical page cache texture with a page table entry
+//	the entry can refer to a lower resolution parent page than the one that was looked up
+//	The position inside the page is clamped instead of wrapped, so the uv never leaves the page and its border,
+//	not even at the edge of the image or when the page was selected with a slightly different rounding
+inline float2 virtualtexture_translate(in float2 uv, in uint entry, in uint2 size, in uint page_size, in uint border, in float2 physical_size_rcp)
+{
+	const uint mip = VIRTUALTEXTURE_ENTRY_MIP(entry);
+	const float2 pagecoord = saturate(uv) * max(1u, size >> mip) / page_size;
+	const float2 count = float2(virtualtexture_pagecount(size.x, page_size, mip), virtualtexture_pagecount(size.y, page_size, mip));
+	const float2 page = min(floor(pagecoord), count - 1);
+	const float2 slot = float2(VIRTUALTEXTURE_ENTRY_SLOT_X(entry), VIRTUALTEXTURE_ENTRY_SLOT_Y(entry));
+	const float padded_size = page_size + border * 2;
+	return (slot * padded_size + border + saturate(pagecoord - page) * page_size) * physical_size_rcp;
+}
+
+#endif // __cplusplus
+
+#endif // WI_SHADERINTEROP_VIRTUALTEXTURE_H
@@ -1,6 +1,7 @@
 #pragma once
 #include "wiLua.h"
 #include "wiLuna.h"
+#include "wiLuaAllocator.h"
 #include <DirectXMath.h>
 #include "CommonInclude.h"
 
@@ -50,6 +51,6 @@ public:
 
 	static void Bind();
 
-	ALIGN_16
+	WILUA_POOLED(Vector_BindLua)
 };
 
@@ -33,7 +33,9 @@
 #include "wiRenderer.h"
 #include "wiMath.h"
 #include "wiAudio.h"
+#include "wiAudioMixer.h"
 #include "wiResourceManager.h"
+#include "wiTextureCache.h"
 #include "wiTimer.h"
 #include "wiHelper.h"
 #include "wiInput.h"
@@ -46,6 +48,7 @@
 #include "wiEnums.h"
 #include "wiInitializer.h"
 #include "wiLua.h"
+#include "wiLuaScriptPool.h"
 #include "wiLuna.h"
 #include "wiGraphicsDevice.h"
 #include "wiGUI.h"
@@ -54,13 +57,24 @@
 #include "wiArchive.h"
 #include "wiSpinLock.h"
 #include "wiRectPacker.h"
+#include "wiAtlasAllocator.h"
+#include "wiMeshOptimizer.h"
+#include "wiBlockCompression.h"
+#include "wiMipGenerator.h"
+#include "wiVirtualTexture.h"
 #include "wiProfiler.h"
 #include "wiOcean.h"
+#include "wiOcean_CPU.h"
 #include "wiStartupArguments.h"
 #include "wiGPUBVH.h"
 #include "wiGPUSortLib.h"
+#include "wiClusteredCulling.h"
 #include "wiJobSystem.h"
+#include "wiFramePipeline.h"
+#include "wiFramePacer.h"
+#include "wiFrameGovernor.h"
 #include "wiNetwork.h"
+#include "wiReplication.h"
 
 #ifdef _WIN32
 #ifdef WINSTORE_SUPPORT
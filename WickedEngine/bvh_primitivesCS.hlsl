@@ -35,19 +35,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
 		uint i2 = meshIndexBuffer[tri * 3 + 1];
 
 		// load vertices of triangle from vertex buffer:
-		float4 pos_nor0 = asfloat(meshVertexBuffer_POS.Load4(i0 * xBVHMeshVertexPOSStride));
-		float4 pos_nor1 = asfloat(meshVertexBuffer_POS.Load4(i1 * xBVHMeshVertexPOSStride));
-		float4 pos_nor2 = asfloat(meshVertexBuffer_POS.Load4(i2 * xBVHMeshVertexPOSStride));
-
-		uint nor_u = asuint(pos_nor0.w);
-		float3 nor0 = unpack_unitvector(nor_u);
-		uint subsetIndex = (nor_u >> 24) & 0x000000FF;
-
-		nor_u = asuint(pos_nor1.w);
-		float3 nor1 = unpack_unitvector(nor_u);
-
-		nor_u = asuint(pos_nor2.w);
-		float3 nor2 = unpack_unitvector(nor_u);
+		float3 pos0, pos1, pos2;
+		float3 nor0, nor1, nor2;
+		uint subsetIndex, subsetIndex1, subsetIndex2;
+		load_vertex_pos(meshVertexBuffer_POS, xBVHMeshPositionStream, i0, pos0, nor0, subsetIndex);
+		load_vertex_pos(meshVertexBuffer_POS, xBVHMeshPositionStream, i1, pos1, nor1, subsetIndex1);
+		load_vertex_pos(meshVertexBuffer_POS, xBVHMeshPositionStream, i2, pos2, nor2, subsetIndex2);
 
 
 		// Compute triangle parameters:
@@ -55,9 +48,9 @@ void main(uint3 DTid : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
 		const uint materialIndex = xBVHMaterialOffset + subsetIndex;
 		ShaderMaterial material = materialBuffer[materialIndex];
 
-		float3 v0 = mul(WORLD, float4(pos_nor0.xyz, 1)).xyz;
-		float3 v1 = mul(WORLD, float4(pos_nor1.xyz, 1)).xyz;
-		float3 v2 = mul(WORLD, float4(pos_nor2.xyz, 1)).xyz;
+		float3 v0 = mul(WORLD, float4(pos0, 1)).xyz;
+		float3 v1 = mul(WORLD, float4(pos1, 1)).xyz;
+		float3 v2 = mul(WORLD, float4(pos2, 1)).xyz;
 		nor0 = normalize(mul((float3x3)WORLD, nor0));
 		nor1 = normalize(mul((float3x3)WORLD, nor1));
 		nor2 = normalize(mul((float3x3)WORLD, nor2));
@@ -49,12 +49,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint groupIn
 	uint i2 = meshIndexBuffer[tri * 3 + 2];
 
 	// load vertices of triangle from vertex buffer:
-	float4 pos_nor0 = asfloat(meshVertexBuffer_POS.Load4(i0 * xHairBaseMeshVertexPositionStride));
-	float4 pos_nor1 = asfloat(meshVertexBuffer_POS.Load4(i1 * xHairBaseMeshVertexPositionStride));
-	float4 pos_nor2 = asfloat(meshVertexBuffer_POS.Load4(i2 * xHairBaseMeshVertexPositionStride));
-    float3 nor0 = unpack_unitvector(asuint(pos_nor0.w));
-    float3 nor1 = unpack_unitvector(asuint(pos_nor1.w));
-    float3 nor2 = unpack_unitvector(asuint(pos_nor2.w));
+	float3 pos0, pos1, pos2;
+	float3 nor0, nor1, nor2;
+	uint subsetIndex0, subsetIndex1, subsetIndex2;
+	load_vertex_pos(meshVertexBuffer_POS, xHairBaseMeshPositionStream, i0, pos0, nor0, subsetIndex0);
+	load_vertex_pos(meshVertexBuffer_POS, xHairBaseMeshPositionStream, i1, pos1, nor1, subsetIndex1);
+	load_vertex_pos(meshVertexBuffer_POS, xHairBaseMeshPositionStream, i2, pos2, nor2, subsetIndex2);
 
 	// random barycentric coords:
 	float f = rand(seed, uv);
@@ -67,9 +67,9 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint groupIn
 	}
 
 	// compute final surface position on triangle from barycentric coords:
-	float3 position = pos_nor0.xyz + f * (pos_nor1.xyz - pos_nor0.xyz) + g * (pos_nor2.xyz - pos_nor0.xyz);
+	float3 position = pos0 + f * (pos1 - pos0) + g * (pos2 - pos0);
 	float3 target = normalize(nor0 + f * (nor1 - nor0) + g * (nor2 - nor0));
-	float3 tangent = normalize((rand(seed, uv) < 0.5f ? pos_nor0.xyz : pos_nor2.xyz) - pos_nor1.xyz);
+	float3 tangent = normalize((rand(seed, uv) < 0.5f ? pos0 : pos2) - pos1);
 	float3 binormal = cross(target, tangent);
 
 	uint tangent_random = 0;
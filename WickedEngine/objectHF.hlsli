@@ -22,6 +22,7 @@
 #include "objectInputLayoutHF.hlsli"
 #include "brdf.hlsli"
 #include "lightingHF.hlsli"
+#include "ShaderInterop_VirtualTexture.h"
 
 // DEFINITIONS
 //////////////////
@@ -33,6 +34,14 @@ TEXTURE2D(texture_surfacemap, float4, TEXSLOT_RENDERER_SURFACEMAP);				// r: occ
 TEXTURE2D(texture_displacementmap, float, TEXSLOT_RENDERER_DISPLACEMENTMAP);	// r: heightmap
 TEXTURE2D(texture_emissivemap, float4, TEXSLOT_RENDERER_EMISSIVEMAP);			// rgba: emissive
 TEXTURE2D(texture_occlusionmap, float, TEXSLOT_RENDERER_OCCLUSIONMAP);			// r: occlusion
+TEXTURE2D(texture_virtualtexture, float4, TEXSLOT_RENDERER_VIRTUALTEXTURE);		// rgb: baseColor, a: opacity (physical page cache of the virtual texture)
+STRUCTUREDBUFFER(virtualtexture_pagetable, uint, SBSLOT_RENDERER_VIRTUALTEXTURE_PAGETABLE);
+
+// The main scene render passes request the virtual texture pages, the feedback is bound by RenderPath (wiRenderer::BindVirtualTextureFeedback):
+#if (defined(DEFERRED) || defined(FORWARD) || defined(TILEDFORWARD)) && !defined(TRANSPARENT) && !defined(ENVMAPRENDERING)
+#define VIRTUALTEXTURE_FEEDBACK
+RWSTRUCTUREDBUFFER(virtualtexture_feedback, uint2, UAVSLOT_RENDERER_VIRTUALTEXTURE_FEEDBACK);
+#endif // VIRTUALTEXTURE_FEEDBACK
 
 // These are bound by RenderPath (based on Render Path):
 TEXTURE2D(texture_reflection, float4, TEXSLOT_RENDERPATH_REFLECTION);		// rgba: scene color from reflected camera angle
@@ -127,6 +136,31 @@ inline void NormalMapping(in float2 UV, in float3 V, inout float3 N, in float3x3
 	bumpColor *= g_xMaterial.normalMapStrength;
 }
 
+inline float4 SampleVirtualTexture(in float2 UV, in float2 pixel)
+{
+	const uint2 size = g_xMaterial.virtualTextureSize;
+	const uint page_size = g_xMaterial.virtualTexturePageSize;
+	const uint mip = virtualtexture_mip(UV, size, g_xMaterial.virtualTextureMipCount);
+	UV = frac(UV); // emulate wrap
+	const uint page = virtualtexture_page(UV, size, page_size, mip);
+
+#ifdef VIRTUALTEXTURE_FEEDBACK
+	// The feedback is a low resolution grid over the screen, any pixel of a cell can write the request of the cell:
+	const uint2 cell = min(uint2(pixel * g_xFrame_InternalResolution_Inverse * VIRTUALTEXTURE_FEEDBACK_SIZE), VIRTUALTEXTURE_FEEDBACK_SIZE - 1);
+	virtualtexture_feedback[cell.y * VIRTUALTEXTURE_FEEDBACK_SIZE + cell.x] = uint2(g_xMaterial.virtualTextureID, page);
+#endif // VIRTUALTEXTURE_FEEDBACK
+
+	// The entry refers to the requested page or to its closest resident parent:
+	const uint entry = virtualtexture_pagetable[virtualtexture_pagetable_index(page, size, page_size)];
+	[branch]
+	if ((entry & VIRTUALTEXTURE_ENTRY_VALID) == 0)
+	{
+		return 1;
+	}
+	const float2 physical_uv = virtualtexture_translate(UV, entry, size, page_size, g_xMaterial.virtualTextureBorder, g_xMaterial.virtualTexturePhysicalSizeRcp);
+	return texture_virtualtexture.SampleLevel(sampler_linear_clamp, physical_uv, 0);
+}
+
 inline float3 PlanarReflection(in Surface surface, in float2 bumpColor)
 {
 	float4 reflectionUV = mul(g_xFrame_MainCamera_ReflVP, float4(surface.P, 1));
@@ -389,11 +423,9 @@ inline void ForwardLighting(inout Surface surface, inout Lighting lighting)
 
 }
 
-inline void TiledLighting(in float2 pixel, inout Surface surface, inout Lighting lighting)
+// Lighting from entity buckets (EntityTiles), flatTileIndex is the first bucket of the tile or cluster
+inline void BucketedLighting(in uint flatTileIndex, inout Surface surface, inout Lighting lighting)
 {
-	const uint2 tileIndex = uint2(floor(pixel / TILED_CULLING_BLOCKSIZE));
-	const uint flatTileIndex = flatten2D(tileIndex, g_xFrame_EntityCullingTileCount.xy) * SHADER_ENTITY_TILE_BUCKET_COUNT;
-
 
 #ifndef DISABLE_DECALS
 	[branch]
@@ -641,6 +673,22 @@ inline void TiledLighting(in float2 pixel, inout Surface surface, inout Lighting
 
 }
 
+inline void TiledLighting(in float2 pixel, inout Surface surface, inout Lighting lighting)
+{
+	const uint2 tileIndex = uint2(floor(pixel / TILED_CULLING_BLOCKSIZE));
+	const uint flatTileIndex = flatten2D(tileIndex, g_xFrame_EntityCullingTileCount.xy) * SHADER_ENTITY_TILE_BUCKET_COUNT;
+	BucketedLighting(flatTileIndex, surface, lighting);
+}
+
+// The entity clusters are computed on the CPU for the main camera and bound to the EntityTiles slot
+inline void ClusteredLighting(in float2 pixel, in float lineardepth, inout Surface surface, inout Lighting lighting)
+{
+	const float slice = floor(log(lineardepth) * g_xFrame_EntityClusterSliceScale - g_xFrame_EntityClusterSliceBias);
+	const uint3 clusterIndex = min(uint3(floor(pixel * g_xFrame_EntityClusterTileSize_rcp), max(0, slice)), g_xFrame_EntityClusterCount - 1);
+	const uint flatClusterIndex = flatten3D(clusterIndex, g_xFrame_EntityClusterCount) * SHADER_ENTITY_TILE_BUCKET_COUNT;
+	BucketedLighting(flatClusterIndex, surface, lighting);
+}
+
 inline void ApplyLighting(in Surface surface, in Lighting lighting, inout float4 color)
 {
 	LightingPart combined_lighting = CombineLighting(surface, lighting);
@@ -742,7 +790,15 @@ GBUFFEROutputType_Thin main(PIXELINPUT input)
 	if (g_xMaterial.uvset_baseColorMap >= 0)
 	{
 		const float2 UV_baseColorMap = g_xMaterial.uvset_baseColorMap == 0 ? input.uvsets.xy : input.uvsets.zw;
-		color = texture_basecolormap.Sample(sampler_objectshader, UV_baseColorMap);
+		[branch]
+		if (g_xMaterial.virtualTextureID != 0)
+		{
+			color = SampleVirtualTexture(UV_baseColorMap, pixel);
+		}
+		else
+		{
+			color = texture_basecolormap.Sample(sampler_objectshader, UV_baseColorMap);
+		}
 		color.rgb = DEGAMMA(color.rgb);
 	}
 	else
@@ -898,7 +954,17 @@ GBUFFEROutputType_Thin main(PIXELINPUT input)
 
 
 #ifdef FORWARD
-	ForwardLighting(surface, lighting);
+#ifndef ENVMAPRENDERING
+	[branch]
+	if (g_xFrame_EntityClusterCount.z > 0)
+	{
+		ClusteredLighting(pixel, lineardepth, surface, lighting);
+	}
+	else
+#endif // ENVMAPRENDERING
+	{
+		ForwardLighting(surface, lighting);
+	}
 #endif // FORWARD
 
 #ifdef TILEDFORWARD
@@ -3,6 +3,10 @@
 #include "globals.hlsli"
 #include "ShaderInterop_Renderer.h"
 
+// The position streams are fetched by SV_VertexID, because their encoding depends on the mesh (see VertexStreamCB):
+RAWBUFFER(vertexBuffer_POS, TEXSLOT_RENDERER_VERTEX_POS);
+RAWBUFFER(vertexBuffer_PRE, TEXSLOT_RENDERER_VERTEX_PRE);
+
 struct Input_Instance
 {
 	float4 mat0 : INSTANCEMATRIX0;
@@ -23,24 +27,23 @@ struct Input_InstanceAtlas
 
 struct Input_Object_POS
 {
-	float4 pos : POSITION_NORMAL_SUBSETINDEX;
+	uint vertexID : SV_VertexID;
 	Input_Instance inst;
 };
 struct Input_Object_POS_TEX
 {
-	float4 pos : POSITION_NORMAL_SUBSETINDEX;
+	uint vertexID : SV_VertexID;
 	float2 uv0 : UVSET0;
 	float2 uv1 : UVSET1;
 	Input_Instance inst;
 };
 struct Input_Object_ALL
 {
-	float4 pos : POSITION_NORMAL_SUBSETINDEX;
+	uint vertexID : SV_VertexID;
 	float2 uv0 : UVSET0;
 	float2 uv1 : UVSET1;
 	float2 atl : ATLAS;
 	float4 col : COLOR;
-	float4 pre : PREVPOS;
 	Input_Instance inst;
 	Input_InstancePrev instPrev;
 	Input_InstanceAtlas instAtlas;
@@ -79,32 +82,24 @@ inline VertexSurface MakeVertexSurfaceFromInput(Input_Object_POS input)
 {
 	VertexSurface surface;
 
-	surface.position = float4(input.pos.xyz, 1);
+	float3 position;
+	load_vertex_pos(vertexBuffer_POS, xPositionStream, input.vertexID, position, surface.normal, surface.subsetIndex);
+	surface.position = float4(position, 1);
 
 	surface.color = g_xMaterial.baseColor * unpack_rgba(input.inst.userdata.x);
 
-	uint normal_subsetIndex = asuint(input.pos.w);
-	surface.normal.x = (float)((normal_subsetIndex >> 0) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.normal.y = (float)((normal_subsetIndex >> 8) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.normal.z = (float)((normal_subsetIndex >> 16) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.subsetIndex = (normal_subsetIndex >> 24) & 0x000000FF;
-
 	return surface;
 }
 inline VertexSurface MakeVertexSurfaceFromInput(Input_Object_POS_TEX input)
 {
 	VertexSurface surface;
 
-	surface.position = float4(input.pos.xyz, 1);
+	float3 position;
+	load_vertex_pos(vertexBuffer_POS, xPositionStream, input.vertexID, position, surface.normal, surface.subsetIndex);
+	surface.position = float4(position, 1);
 
 	surface.color = g_xMaterial.baseColor * unpack_rgba(input.inst.userdata.x);
 
-	uint normal_subsetIndex = asuint(input.pos.w);
-	surface.normal.x = (float)((normal_subsetIndex >> 0) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.normal.y = (float)((normal_subsetIndex >> 8) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.normal.z = (float)((normal_subsetIndex >> 16) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.subsetIndex = (normal_subsetIndex >> 24) & 0x000000FF;
-
 	surface.uvsets = float4(input.uv0 * g_xMaterial.texMulAdd.xy + g_xMaterial.texMulAdd.zw, input.uv1);
 
 	return surface;
@@ -113,7 +108,9 @@ inline VertexSurface MakeVertexSurfaceFromInput(Input_Object_ALL input)
 {
 	VertexSurface surface;
 
-	surface.position = float4(input.pos.xyz, 1);
+	float3 position;
+	load_vertex_pos(vertexBuffer_POS, xPositionStream, input.vertexID, position, surface.normal, surface.subsetIndex);
+	surface.position = float4(position, 1);
 
 	surface.color = g_xMaterial.baseColor * unpack_rgba(input.inst.userdata.x);
 
@@ -122,17 +119,14 @@ inline VertexSurface MakeVertexSurfaceFromInput(Input_Object_ALL input)
 		surface.color *= input.col;
 	}
 
-	uint normal_subsetIndex = asuint(input.pos.w);
-	surface.normal.x = (float)((normal_subsetIndex >> 0) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.normal.y = (float)((normal_subsetIndex >> 8) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.normal.z = (float)((normal_subsetIndex >> 16) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	surface.subsetIndex = (normal_subsetIndex >> 24) & 0x000000FF;
-
 	surface.uvsets = float4(input.uv0 * g_xMaterial.texMulAdd.xy + g_xMaterial.texMulAdd.zw, input.uv1);
 
 	surface.atlas = input.atl * input.instAtlas.atlasMulAdd.xy + input.instAtlas.atlasMulAdd.zw;
 
-	surface.prevPos = float4(input.pre.xyz, 1);
+	float3 prevNormal;
+	uint prevSubsetIndex;
+	load_vertex_pos(vertexBuffer_PRE, xPrevPositionStream, input.vertexID, position, prevNormal, prevSubsetIndex);
+	surface.prevPos = float4(position, 1);
 
 	return surface;
 }
@@ -1,8 +1,14 @@
 #include "globals.hlsli"
+#include "objectInputLayoutHF.hlsli"
 
-float4 main(float4 inPos : POSITION_NORMAL_SUBSETINDEX) : SV_POSITION
+float4 main(uint vertexID : SV_VertexID) : SV_POSITION
 {
-	float4 pos = mul(g_xTransform, float4(inPos.xyz, 1));
+	float3 position;
+	float3 normal;
+	uint subsetIndex;
+	load_vertex_pos(vertexBuffer_POS, xPositionStream, vertexID, position, normal, subsetIndex);
+
+	float4 pos = mul(g_xTransform, float4(position, 1));
 
 	return pos;
 }
@@ -4,7 +4,7 @@
 
 struct Input
 {
-	float4 pos : POSITION_NORMAL_SUBSETINDEX;
+	uint vertexID : SV_VertexID;
 	float2 atl : ATLAS;
 	Input_InstancePrev instance;
 };
@@ -30,12 +30,11 @@ Output main(Input input)
 
 	output.uv = input.atl;
 
-	output.pos3D = mul(WORLD, float4(input.pos.xyz, 1)).xyz;
+	float3 position;
+	uint subsetIndex;
+	load_vertex_pos(vertexBuffer_POS, xPositionStream, input.vertexID, position, output.normal, subsetIndex);
 
-	uint normal_wind_matID = asuint(input.pos.w);
-	output.normal.x = (float)((normal_wind_matID >> 0) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	output.normal.y = (float)((normal_wind_matID >> 8) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-	output.normal.z = (float)((normal_wind_matID >> 16) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
+	output.pos3D = mul(WORLD, float4(position, 1)).xyz;
 
 	return output;
 }
\ No newline at end of file
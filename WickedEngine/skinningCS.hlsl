@@ -1,5 +1,6 @@
 #include "ResourceMapping.h"
 #include "ShaderInterop_Skinning.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 // This will make use of LDS to preload bones into local memory:
 // #define USE_LDS
@@ -67,43 +68,19 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
 	LDS_BoneList[GTid.x] = boneBuffer[GTid.x];
 #endif // USE_LDS
 
-	const uint stride_POS_NOR = 16;
-	const uint stride_BON_IND = 8;
-	const uint stride_BON_WEI = 8;
+	const uint fetchAddress_BON = DTid.x * VERTEX_BON_STRIDE;
 
-	const uint fetchAddress_POS_NOR = DTid.x * stride_POS_NOR;
-	const uint fetchAddress_BON = DTid.x * (stride_BON_IND + stride_BON_WEI);
-
-	// Manual type-conversion for pos:
-	uint4 pos_nor_u = vertexBuffer_POS.Load4(fetchAddress_POS_NOR);
-	float3 pos = asfloat(pos_nor_u.xyz);
-
-
-	// Manual type-conversion for normal:
-	float4 nor = 0;
-	{
-		nor.x = (float)((pos_nor_u.w >> 0) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-		nor.y = (float)((pos_nor_u.w >> 8) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-		nor.z = (float)((pos_nor_u.w >> 16) & 0x000000FF) / 255.0f * 2.0f - 1.0f;
-		nor.w = (float)((pos_nor_u.w >> 24) & 0x000000FF) / 255.0f; // subsetindex
-	}
+	// The source stream can be quantized, see xSkinningPositionStream:
+	float3 pos;
+	float3 nor;
+	uint subsetIndex;
+	load_vertex_pos(vertexBuffer_POS, xSkinningPositionStream, DTid.x, pos, nor, subsetIndex);
 
 
 	// Manual type-conversion for bone props:
 	uint4 ind_wei_u = vertexBuffer_BON.Load4(fetchAddress_BON);
-	float4 ind = 0;
-	float4 wei = 0;
-	{
-		ind.x = (float)((ind_wei_u.x >> 0) & 0x0000FFFF);
-		ind.y = (float)((ind_wei_u.x >> 16) & 0x0000FFFF);
-		ind.z = (float)((ind_wei_u.y >> 0) & 0x0000FFFF);
-		ind.w = (float)((ind_wei_u.y >> 16) & 0x0000FFFF);
-
-		wei.x = (float)((ind_wei_u.z >> 0) & 0x0000FFFF) / 65535.0f;
-		wei.y = (float)((ind_wei_u.z >> 16) & 0x0000FFFF) / 65535.0f;
-		wei.z = (float)((ind_wei_u.w >> 0) & 0x0000FFFF) / 65535.0f;
-		wei.w = (float)((ind_wei_u.w >> 16) & 0x0000FFFF) / 65535.0f;
-	}
+	float4 ind = (float4)decode_boneindices16(ind_wei_u.xy);
+	float4 wei = decode_boneweights16(ind_wei_u.zw);
 
 #ifdef USE_LDS
 	GroupMemoryBarrierWithGroupSync();
@@ -111,11 +88,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
 
 
 	// Perform skinning:
-	Skinning(pos, nor.xyz, ind, wei);
+	Skinning(pos, nor, ind, wei);
 
 
 
-	// Manual type-conversion for pos:
+	// The output is always full precision (MeshComponent::Vertex_POS):
+	uint4 pos_nor_u;
 	pos_nor_u.xyz = asuint(pos.xyz);
 
 
@@ -125,9 +103,9 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
 		pos_nor_u.w |= (uint)((nor.x * 0.5f + 0.5f) * 255.0f) << 0;
 		pos_nor_u.w |= (uint)((nor.y * 0.5f + 0.5f) * 255.0f) << 8;
 		pos_nor_u.w |= (uint)((nor.z * 0.5f + 0.5f) * 255.0f) << 16;
-		pos_nor_u.w |= (uint)(nor.w * 255.0f) << 24; // subsetindex
+		pos_nor_u.w |= (subsetIndex & 0xFF) << 24;
 	}
 
 	// Store data:
-	streamoutBuffer_POS.Store4(fetchAddress_POS_NOR, pos_nor_u);
+	streamoutBuffer_POS.Store4(DTid.x * VERTEX_POS_STRIDE, pos_nor_u);
 }
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include "wiAtlasAllocator.h"
+#include "wiMath.h"
+
+#include <algorithm>
+
+using namespace wiRectPacker;
+
+void wiAtlasAllocator::AddFreeRect(rect_xywh rect)
+{
+	// Merge with free neighbours that share a full edge, repeat until the rect can't grow anymore:
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (size_t i = 0; i < freeRects.size(); ++i)
+		{
+			const rect_xywh& other = freeRects[i];
+			if (other.y == rect.y && other.h == rect.h && (other.x + other.w == rect.x || rect.x + rect.w == other.x))
+			{
+				rect.x = std::min(rect.x, other.x);
+				rect.w += other.w;
+				merged = true;
+			}
+			else if (other.x == rect.x && other.w == rect.w && (other.y + other.h == rect.y || rect.y + rect.h == other.y))
+			{
+				rect.y = std::min(rect.y, other.y);
+				rect.h += other.h;
+				merged = true;
+			}
+
+			if (merged)
+			{
+				freeRects[i] = freeRects.back();
+				freeRects.pop_back();
+				break;
+			}
+		}
+	}
+	freeRects.push_back(rect);
+}
+
+void wiAtlasAllocator::Reset(uint32_t width, uint32_t height)
+{
+	this->width = width;
+	this->height = height;
+	allocatedArea = 0;
+	freeRects.clear();
+	if (width > 0 && height > 0)
+	{
+		freeRects.push_back(rect_xywh(0, 0, (int)width, (int)height));
+	}
+}
+
+bool wiAtlasAllocator::Allocate(rect_xywh& rect)
+{
+	if (rect.w <= 0 || rect.h <= 0)
+	{
+		return false;
+	}
+
+	// Best short side fit:
+	size_t best = freeRects.size();
+	int bestShortSide = INT_MAX;
+	int bestLongSide = INT_MAX;
+	for (size_t i = 0; i < freeRects.size(); ++i)
+	{
+		const rect_xywh& candidate = freeRects[i];
+		if (candidate.w >= rect.w && candidate.h >= rect.h)
+		{
+			const int leftoverX = candidate.w - rect.w;
+			const int leftoverY = candidate.h - rect.h;
+			const int shortSide = std::min(leftoverX, leftoverY);
+			const int longSide = std::max(leftoverX, leftoverY);
+			if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+			{
+				best = i;
+				bestShortSide = shortSide;
+				bestLongSide = longSide;
+				if (longSide == 0)
+				{
+					break; // perfect fit
+				}
+			}
+		}
+	}
+
+	if (best == freeRects.size())
+	{
+		return false;
+	}
+
+	const rect_xywh node = freeRects[best];
+	freeRects[best] = freeRects.back();
+	freeRects.pop_back();
+
+	rect.x = node.x;
+	rect.y = node.y;
+	allocatedArea += (uint64_t)rect.w * (uint64_t)rect.h;
+
+	// Guillotine split along the shorter leftover axis, so that the larger free rect remains as big as possible:
+	const int leftoverX = node.w - rect.w;
+	const int leftoverY = node.h - rect.h;
+	rect_xywh right, bottom;
+	if (leftoverX < leftoverY)
+	{
+		right = rect_xywh(node.x + rect.w, node.y, leftoverX, rect.h);
+		bottom = rect_xywh(node.x, node.y + rect.h, node.w, leftoverY);
+	}
+	else
+	{
+		right = rect_xywh(node.x + rect.w, node.y, leftoverX, node.h);
+		bottom = rect_xywh(node.x, node.y + rect.h, rect.w, leftoverY);
+	}
+	if (right.w > 0 && right.h > 0)
+	{
+		freeRects.push_back(right);
+	}
+	if (bottom.w > 0 && bottom.h > 0)
+	{
+		freeRects.push_back(bottom);
+	}
+
+	return true;
+}
+
+bool wiAtlasAllocator::Allocate(rect_xywh& rect, uint32_t maxSize)
+{
+	if (rect.w <= 0 || rect.h <= 0 || (uint32_t)rect.w > maxSize || (uint32_t)rect.h > maxSize)
+	{
+		return false;
+	}
+
+	if (width == 0 || height == 0)
+	{
+		Reset(wiMath::GetNextPowerOfTwo((uint32_t)rect.w), wiMath::GetNextPowerOfTwo((uint32_t)rect.h));
+	}
+
+	while (!Allocate(rect))
+	{
+		if (!Grow(maxSize))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void wiAtlasAllocator::Free(const rect_xywh& rect)
+{
+	assert(allocatedArea >= (uint64_t)rect.w * (uint64_t)rect.h);
+	allocatedArea -= (uint64_t)rect.w * (uint64_t)rect.h;
+	AddFreeRect(rect);
+}
+
+bool wiAtlasAllocator::Grow(uint32_t maxSize)
+{
+	if (width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	const bool canGrowX = width * 2 <= maxSize;
+	const bool canGrowY = height * 2 <= maxSize;
+	if (canGrowX && (width <= height || !canGrowY))
+	{
+		AddFreeRect(rect_xywh((int)width, 0, (int)width, (int)height));
+		width *= 2;
+		return true;
+	}
+	if (canGrowY)
+	{
+		AddFreeRect(rect_xywh(0, (int)height, (int)width, (int)height));
+		height *= 2;
+		return true;
+	}
+	return false;
+}
+
+bool wiAtlasAllocator::Defragment(rect_xywh* const* rects, size_t count, uint32_t maxSize)
+{
+	std::vector<rect_xywh*> sorted(rects, rects + count);
+	std::sort(sorted.begin(), sorted.end(), [](const rect_xywh* a, const rect_xywh* b) {
+		const int maxA = std::max(a->w, a->h);
+		const int maxB = std::max(b->w, b->h);
+		return maxA > maxB || (maxA == maxB && a->w * a->h > b->w * b->h);
+	});
+
+	// Start from the smallest power of two atlas that could hold everything:
+	uint32_t newWidth = 1;
+	uint32_t newHeight = 1;
+	uint64_t totalArea = 0;
+	for (const rect_xywh* rect : sorted)
+	{
+		if (rect->w <= 0 || rect->h <= 0 || (uint32_t)rect->w > maxSize || (uint32_t)rect->h > maxSize)
+		{
+			Reset(newWidth, newHeight);
+			return false;
+		}
+		newWidth = std::max(newWidth, wiMath::GetNextPowerOfTwo((uint32_t)rect->w));
+		newHeight = std::max(newHeight, wiMath::GetNextPowerOfTwo((uint32_t)rect->h));
+		totalArea += (uint64_t)rect->w * (uint64_t)rect->h;
+	}
+	while ((uint64_t)newWidth * (uint64_t)newHeight < totalArea)
+	{
+		if (newWidth <= newHeight && newWidth * 2 <= maxSize)
+		{
+			newWidth *= 2;
+		}
+		else if (newHeight * 2 <= maxSize)
+		{
+			newHeight *= 2;
+		}
+		else if (newWidth * 2 <= maxSize)
+		{
+			newWidth *= 2;
+		}
+		else
+		{
+			Reset(newWidth, newHeight);
+			return false;
+		}
+	}
+
+	while (true)
+	{
+		Reset(newWidth, newHeight);
+
+		bool success = true;
+		for (rect_xywh* rect : sorted)
+		{
+			if (!Allocate(*rect))
+			{
+				success = false;
+				break;
+			}
+		}
+		if (success)
+		{
+			return true;
+		}
+
+		if (newWidth <= newHeight && newWidth * 2 <= maxSize)
+		{
+			newWidth *= 2;
+		}
+		else if (newHeight * 2 <= maxSize)
+		{
+			newHeight *= 2;
+		}
+		else if (newWidth * 2 <= maxSize)
+		{
+			newWidth *= 2;
+		}
+		else
+		{
+			Reset(newWidth, newHeight);
+			return false;
+		}
+	}
+}
+
+
+bool wiAtlasCache::AddRef(const void* key, uint32_t width, uint32_t height)
+{
+	Entry& entry = entries[key];
+	entry.refCount++;
+	if (entry.allocated)
+	{
+		return true;
+	}
+
+	entry.rect = rect_xywh(0, 0, (int)(width + border * 2), (int)(height + border * 2));
+	return Allocate(key, entry);
+}
+
+void wiAtlasCache::Update()
+{
+	defragmented = false;
+
+	for (auto& it : entries)
+	{
+		if (!it.second.allocated)
+		{
+			Allocate(it.first, it.second);
+		}
+	}
+}
+
+bool wiAtlasCache::Allocate(const void* key, Entry& entry)
+{
+	entry.allocated = allocator.Allocate(entry.rect, maxSize);
+	if (entry.allocated)
+	{
+		dirtyEntries.push_back(key);
+		return true;
+	}
+
+	// Doesn't fit, defragment the allocated entries together with the new one, but only once per frame:
+	if (defragmented)
+	{
+		return false;
+	}
+	defragmented = true;
+
+	const wiAtlasAllocator previousAllocator = allocator;
+	std::vector<std::pair<Entry*, rect_xywh>> previousRects;
+	std::vector<rect_xywh*> rects;
+	previousRects.reserve(entries.size());
+	rects.reserve(entries.size());
+	for (auto& it : entries)
+	{
+		if (it.second.allocated || &it.second == &entry)
+		{
+			previousRects.push_back(std::make_pair(&it.second, it.second.rect));
+			rects.push_back(&it.second.rect);
+		}
+	}
+	if (allocator.Defragment(rects.data(), rects.size(), maxSize))
+	{
+		entry.allocated = true;
+		fullRefresh = true;
+		return true;
+	}
+
+	// Still doesn't fit, roll back to the previous layout, the new entry is left without region:
+	allocator = previousAllocator;
+	for (auto& x : previousRects)
+	{
+		x.first->rect = x.second;
+	}
+	return false;
+}
+
+void wiAtlasCache::Release(const void* key)
+{
+	auto it = entries.find(key);
+	if (it == entries.end())
+	{
+		return;
+	}
+
+	Entry& entry = it->second;
+	assert(entry.refCount > 0);
+	entry.refCount--;
+	if (entry.refCount == 0)
+	{
+		if (entry.allocated)
+		{
+			allocator.Free(entry.rect);
+		}
+		entries.erase(it);
+		dirtyEntries.erase(std::remove(dirtyEntries.begin(), dirtyEntries.end(), key), dirtyEntries.end());
+	}
+}
+
+void wiAtlasCache::Clear()
+{
+	entries.clear();
+	dirtyEntries.clear();
+	fullRefresh = false;
+	allocator.Reset(0, 0);
+}
+
+bool wiAtlasCache::GetRegion(const void* key, rect_xywh& rect) const
+{
+	auto it = entries.find(key);
+	if (it == entries.end() || !it->second.allocated)
+	{
+		return false;
+	}
+
+	// eliminate border expansion:
+	rect = it->second.rect;
+	rect.x += (int)border;
+	rect.y += (int)border;
+	rect.w -= (int)border * 2;
+	rect.h -= (int)border * 2;
+	return true;
+}
+
+XMFLOAT4 wiAtlasCache::GetMulAdd(const void* key) const
+{
+	rect_xywh rect;
+	if (!GetRegion(key, rect) || GetWidth() == 0 || GetHeight() == 0)
+	{
+		return XMFLOAT4(0, 0, 0, 0);
+	}
+	const float width = (float)GetWidth();
+	const float height = (float)GetHeight();
+	return XMFLOAT4((float)rect.w / width, (float)rect.h / height, (float)rect.x / width, (float)rect.y / height);
+}
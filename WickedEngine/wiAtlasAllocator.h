@@ -0,0 +1,118 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiRectPacker.h"
+
+#include <vector>
+#include <unordered_map>
+
+// Persistent 2D atlas allocator (guillotine packer with free rectangle coalescing)
+//	Unlike wiRectPacker::pack(), regions can be inserted and removed individually without moving the other regions.
+//	The atlas can grow while keeping existing regions in place, and it is only defragmented when explicitly requested.
+class wiAtlasAllocator
+{
+private:
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t allocatedArea = 0;
+	std::vector<wiRectPacker::rect_xywh> freeRects;
+
+	void AddFreeRect(wiRectPacker::rect_xywh rect);
+
+public:
+	// Remove all regions and set the atlas size
+	void Reset(uint32_t width, uint32_t height);
+
+	// Allocate a region inside the current atlas dimensions:
+	//	rect	: the w and h members specify the requested size, x and y will receive the position on success
+	//	returns false if the region doesn't fit
+	bool Allocate(wiRectPacker::rect_xywh& rect);
+
+	// Allocate a region, the atlas will grow if it doesn't fit (but not larger than maxSize):
+	//	rect	: the w and h members specify the requested size, x and y will receive the position on success
+	//	maxSize	: maximum width and height of the atlas
+	//	returns false if the region doesn't fit even into the maximum atlas size (consider Defragment() in this case)
+	bool Allocate(wiRectPacker::rect_xywh& rect, uint32_t maxSize);
+
+	// Release a region that was returned by Allocate(), the freed area is merged with neighbouring free areas
+	void Free(const wiRectPacker::rect_xywh& rect);
+
+	// Double the atlas size along its shorter side, the existing regions keep their positions:
+	//	maxSize	: maximum width and height of the atlas
+	//	returns false if the atlas would become larger than maxSize
+	bool Grow(uint32_t maxSize);
+
+	// Repack every region tightly into the smallest atlas that fits them, this invalidates all previous positions:
+	//	rects	: all regions of the atlas (including ones that failed to allocate), their x and y members will be overwritten
+	//	count	: number of regions
+	//	maxSize	: maximum width and height of the atlas
+	//	returns false if the regions don't fit into maxSize (the atlas will be empty in this case)
+	bool Defragment(wiRectPacker::rect_xywh* const* rects, size_t count, uint32_t maxSize);
+
+	inline uint32_t GetWidth() const { return width; }
+	inline uint32_t GetHeight() const { return height; }
+	inline uint64_t GetAllocatedArea() const { return allocatedArea; }
+	inline size_t GetFreeRectCount() const { return freeRects.size(); }
+	// Ratio of allocated area to the whole atlas area [0,1]
+	inline float GetOccupancy() const { return width * height > 0 ? float((double)allocatedArea / ((double)width * (double)height)) : 0.0f; }
+};
+
+// Reference counted atlas entries on top of wiAtlasAllocator, without any GPU resource
+//	Entries are identified by an arbitrary key (for example a texture pointer). An entry gets a region when it is first referenced,
+//	and it releases its region when the last reference is removed. The user copies the dirty entries into the atlas texture.
+class wiAtlasCache
+{
+public:
+	uint32_t border = 1;		// padding around every entry (in pixels)
+	uint32_t maxSize = 16384;	// maximum width and height of the atlas
+
+private:
+	struct Entry
+	{
+		wiRectPacker::rect_xywh rect;	// including border
+		uint32_t refCount = 0;
+		bool allocated = false;
+	};
+	std::unordered_map<const void*, Entry> entries;
+	std::vector<const void*> dirtyEntries;
+	bool fullRefresh = false;
+	bool defragmented = false;	// defragmentation was already tried since the last Update()
+	wiAtlasAllocator allocator;
+
+	bool Allocate(const void* key, Entry& entry);
+
+public:
+	// Add a reference to an entry, it will be allocated if this is the first reference:
+	//	key		: identifier of the entry
+	//	width	: width of the entry without border
+	//	height	: height of the entry without border
+	//	returns false if the entry couldn't be allocated (the reference is still added, the allocation is retried in Update())
+	bool AddRef(const void* key, uint32_t width, uint32_t height);
+
+	// Call once per frame: the atlas is defragmented at most once between two calls, and the entries that couldn't be allocated are retried
+	void Update();
+
+	// Remove a reference from an entry, its region is released when there are no more references
+	void Release(const void* key);
+
+	// Remove all entries
+	void Clear();
+
+	// Returns the region of an entry without the border, or false if the entry has no region
+	bool GetRegion(const void* key, wiRectPacker::rect_xywh& rect) const;
+
+	// Returns the atlas texture coordinate transform of an entry (xy: multiply, zw: add), zero if the entry has no region
+	XMFLOAT4 GetMulAdd(const void* key) const;
+
+	inline uint32_t GetRefCount(const void* key) const { auto it = entries.find(key); return it == entries.end() ? 0 : it->second.refCount; }
+	inline size_t GetEntryCount() const { return entries.size(); }
+	inline uint32_t GetWidth() const { return allocator.GetWidth(); }
+	inline uint32_t GetHeight() const { return allocator.GetHeight(); }
+	inline const wiAtlasAllocator& GetAllocator() const { return allocator; }
+
+	// Entries that were allocated since the last ClearDirty() and need to be copied into the atlas
+	inline const std::vector<const void*>& GetDirtyEntries() const { return dirtyEntries; }
+	// If true, every entry needs to be copied into the atlas (it was defragmented)
+	inline bool IsFullRefreshNeeded() const { return fullRefresh; }
+	// Call after the atlas texture was updated
+	inline void ClearDirty() { dirtyEntries.clear(); fullRefresh = false; }
+};
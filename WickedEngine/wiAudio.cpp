@@ -1,3 +1,4 @@
+#ifdef _WIN32
 #include "wiAudio.h"
 #include "wiBackLog.h"
 #include "wiHelper.h"
@@ -547,3 +548,4 @@ namespace wiAudio
 		assert(SUCCEEDED(hr));
 	}
 }
+#endif // _WIN32
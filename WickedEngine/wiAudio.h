@@ -129,5 +129,6 @@ namespace wiAudio
 		REVERB_PRESET_LARGEHALL,
 		REVERB_PRESET_PLATE,
 	};
+	// The software mixer (the platforms without XAudio2) doesn't have a reverb effect, the preset is ignored there
 	void SetReverb(REVERB_PRESET preset);
 }
@@ -0,0 +1,894 @@
+#include "wiAudioMixer.h"
+#include "wiHelper.h"
+#include "wiBackLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace wiAudioMixer_Internal
+{
+	static const float SPEED_OF_SOUND = 343.5f; // same as X3DAUDIO_SPEED_OF_SOUND
+
+	static const uint16_t WAVE_FORMAT_PCM = 0x0001;
+	static const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+	static const uint16_t WAVE_FORMAT_IMA_ADPCM = 0x0011;
+	static const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+	static const uint32_t ADPCM_BLOCK_ALIGN = 512;	// per channel, when encoding
+
+	static const int adpcmIndexTable[16] = {
+		-1, -1, -1, -1, 2, 4, 6, 8,
+		-1, -1, -1, -1, 2, 4, 6, 8,
+	};
+	static const int adpcmStepTable[89] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+		130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+		1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+		7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+	};
+
+	struct ADPCMState
+	{
+		int predictor = 0;
+		int index = 0;
+
+		int Decode(uint8_t nibble)
+		{
+			const int step = adpcmStepTable[index];
+			int diff = step >> 3;
+			if (nibble & 1) diff += step >> 2;
+			if (nibble & 2) diff += step >> 1;
+			if (nibble & 4) diff += step;
+			predictor += (nibble & 8) ? -diff : diff;
+			predictor = std::max(-32768, std::min(32767, predictor));
+			index = std::max(0, std::min(88, index + adpcmIndexTable[nibble]));
+			return predictor;
+		}
+		uint8_t Encode(int sample)
+		{
+			int diff = sample - predictor;
+			uint8_t nibble = 0;
+			if (diff < 0)
+			{
+				nibble = 8;
+				diff = -diff;
+			}
+			int step = adpcmStepTable[index];
+			if (diff >= step)
+			{
+				nibble |= 4;
+				diff -= step;
+			}
+			step >>= 1;
+			if (diff >= step)
+			{
+				nibble |= 2;
+				diff -= step;
+			}
+			step >>= 1;
+			if (diff >= step)
+			{
+				nibble |= 1;
+			}
+			Decode(nibble); // the encoder follows the state of the decoder
+			return nibble;
+		}
+	};
+
+	template<typename T>
+	inline T read_value(const uint8_t* data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+	template<typename T>
+	inline void write_value(std::vector<uint8_t>& wav, T value)
+	{
+		const uint8_t* data = (const uint8_t*)&value;
+		wav.insert(wav.end(), data, data + sizeof(T));
+	}
+	inline void write_fourcc(std::vector<uint8_t>& wav, const char* fourcc)
+	{
+		wav.insert(wav.end(), fourcc, fourcc + 4);
+	}
+}
+using namespace wiAudioMixer_Internal;
+
+wiAudioMixer::wiAudioMixer(uint32_t sampleRate) : sampleRate(sampleRate)
+{
+	for (uint32_t i = 0; i < wiAudio::SUBMIX_TYPE_COUNT; ++i)
+	{
+		submixVolumes[i] = 1;
+		submixBuffers[i].resize(BLOCK_SIZE / 2);
+	}
+	voiceBuffer.resize(BLOCK_SIZE / 2);
+}
+wiAudioMixer::~wiAudioMixer()
+{
+}
+
+wiAudioMixer* wiAudioMixer::GetGlobal()
+{
+	static wiAudioMixer* globalMixer = new wiAudioMixer;
+	return globalMixer;
+}
+
+wiAudioMixer::SoundID wiAudioMixer::AddSound(std::shared_ptr<SoundData> sound)
+{
+	locker.lock();
+	const SoundID id = nextSound++;
+	sounds[id] = std::move(sound);
+	locker.unlock();
+	return id;
+}
+
+wiAudioMixer::SoundID wiAudioMixer::LoadSound(const std::string& filename)
+{
+	std::vector<uint8_t> data;
+	if (!wiHelper::readByteData(filename, data))
+	{
+		wiBackLog::post(("wiAudioMixer: couldn't read " + filename).c_str());
+		return 0;
+	}
+	const SoundID id = LoadSound(data.data(), data.size());
+	if (id == 0)
+	{
+		wiBackLog::post(("wiAudioMixer: unsupported sound file " + filename).c_str());
+	}
+	return id;
+}
+wiAudioMixer::SoundID wiAudioMixer::LoadSound(const uint8_t* data, size_t dataSize)
+{
+	auto sound = std::make_shared<SoundData>();
+
+	if (dataSize >= 4 && memcmp(data, "OggS", 4) == 0)
+	{
+		wiVorbis::Decoder decoder;
+		if (!decoder.Open(data, dataSize))
+		{
+			return 0;
+		}
+		sound->format = FORMAT_VORBIS;
+		sound->channels = decoder.GetChannels();
+		sound->sampleRate = decoder.GetSampleRate();
+		sound->frameCount = decoder.GetFrameCount();
+		sound->data.assign(data, data + dataSize);
+		return AddSound(std::move(sound));
+	}
+
+	if (dataSize < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+	{
+		return 0;
+	}
+
+	uint16_t formatTag = 0;
+	uint16_t bitsPerSample = 0;
+	uint64_t factFrames = 0;
+	const uint8_t* samples = nullptr;
+	size_t samplesSize = 0;
+	size_t offset = 12;
+	while (offset + 8 <= dataSize)
+	{
+		const uint8_t* chunk = data + offset;
+		const size_t chunkSize = std::min((size_t)read_value<uint32_t>(chunk + 4), dataSize - offset - 8);
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			formatTag = read_value<uint16_t>(chunk + 8);
+			sound->channels = read_value<uint16_t>(chunk + 10);
+			sound->sampleRate = read_value<uint32_t>(chunk + 12);
+			sound->blockAlign = read_value<uint16_t>(chunk + 20);
+			bitsPerSample = read_value<uint16_t>(chunk + 22);
+			if (formatTag == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 26)
+			{
+				formatTag = read_value<uint16_t>(chunk + 8 + 24); // first two bytes of the sub format GUID
+			}
+		}
+		else if (memcmp(chunk, "fact", 4) == 0 && chunkSize >= 4)
+		{
+			factFrames = read_value<uint32_t>(chunk + 8);
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			samples = chunk + 8;
+			samplesSize = chunkSize;
+		}
+		offset += 8 + chunkSize + (chunkSize & 1);
+	}
+	if (samples == nullptr || sound->channels == 0 || sound->sampleRate == 0)
+	{
+		return 0;
+	}
+	const uint32_t channels = sound->channels;
+
+	if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 16)
+	{
+		sound->format = FORMAT_PCM16;
+		sound->frameCount = samplesSize / (2 * channels);
+		sound->samples.resize(size_t(sound->frameCount * channels));
+		for (size_t i = 0; i < sound->samples.size(); ++i)
+		{
+			sound->samples[i] = float(read_value<int16_t>(samples + i * 2)) / 32768.0f;
+		}
+	}
+	else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 32)
+	{
+		sound->format = FORMAT_FLOAT;
+		sound->frameCount = samplesSize / (4 * channels);
+		sound->samples.resize(size_t(sound->frameCount * channels));
+		memcpy(sound->samples.data(), samples, sound->samples.size() * sizeof(float));
+	}
+	else if (formatTag == WAVE_FORMAT_IMA_ADPCM && bitsPerSample == 4 && sound->blockAlign > 4 * channels)
+	{
+		sound->format = FORMAT_IMA_ADPCM;
+		sound->framesPerBlock = (sound->blockAlign - 4 * channels) * 2 / channels + 1;
+		const uint64_t fullBlocks = samplesSize / sound->blockAlign;
+		const size_t lastBlockSize = samplesSize % sound->blockAlign;
+		sound->frameCount = fullBlocks * sound->framesPerBlock;
+		if (lastBlockSize > 4 * channels)
+		{
+			sound->frameCount += (lastBlockSize - 4 * channels) * 2 / channels + 1;
+		}
+		if (factFrames > 0)
+		{
+			sound->frameCount = std::min(sound->frameCount, factFrames);
+		}
+		sound->data.assign(samples, samples + samplesSize);
+	}
+	else
+	{
+		return 0;
+	}
+
+	return AddSound(std::move(sound));
+}
+wiAudioMixer::SoundID wiAudioMixer::CreateSound(const float* samples, uint64_t frameCount, uint32_t channels, uint32_t sampleRate)
+{
+	if (channels == 0 || sampleRate == 0)
+	{
+		return 0;
+	}
+	auto sound = std::make_shared<SoundData>();
+	sound->format = FORMAT_FLOAT;
+	sound->channels = channels;
+	sound->sampleRate = sampleRate;
+	sound->frameCount = frameCount;
+	sound->samples.assign(samples, samples + frameCount * channels);
+	return AddSound(std::move(sound));
+}
+void wiAudioMixer::DestroySound(SoundID sound)
+{
+	locker.lock();
+	sounds.erase(sound);
+	locker.unlock();
+}
+uint64_t wiAudioMixer::GetFrameCount(SoundID sound)
+{
+	locker.lock();
+	auto it = sounds.find(sound);
+	const uint64_t frameCount = it == sounds.end() ? 0 : it->second->frameCount;
+	locker.unlock();
+	return frameCount;
+}
+uint32_t wiAudioMixer::GetSoundSampleRate(SoundID sound)
+{
+	locker.lock();
+	auto it = sounds.find(sound);
+	const uint32_t rate = it == sounds.end() ? 0 : it->second->sampleRate;
+	locker.unlock();
+	return rate;
+}
+
+bool wiAudioMixer::EncodeWAV(const int16_t* samples, uint64_t frameCount, uint32_t channels, uint32_t sampleRate, FORMAT format, std::vector<uint8_t>& wav)
+{
+	if (channels == 0 || (format != FORMAT_PCM16 && format != FORMAT_IMA_ADPCM))
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	uint16_t formatTag;
+	uint16_t blockAlign;
+	uint16_t bitsPerSample;
+	uint32_t framesPerBlock = 1;
+	if (format == FORMAT_PCM16)
+	{
+		formatTag = WAVE_FORMAT_PCM;
+		blockAlign = uint16_t(2 * channels);
+		bitsPerSample = 16;
+		data.resize(size_t(frameCount * channels * 2));
+		memcpy(data.data(), samples, data.size());
+	}
+	else
+	{
+		// Every block starts with the first sample and the step index of every channel, then the channels are interleaved in groups of 8 samples (4 bytes):
+		formatTag = WAVE_FORMAT_IMA_ADPCM;
+		blockAlign = uint16_t(ADPCM_BLOCK_ALIGN * channels);
+		bitsPerSample = 4;
+		framesPerBlock = (blockAlign - 4 * channels) * 2 / channels + 1;
+		std::vector<ADPCMState> states(channels);
+		for (uint64_t blockBegin = 0; blockBegin < frameCount; blockBegin += framesPerBlock)
+		{
+			auto sample = [&](uint64_t frame, uint32_t channel) {
+				return frame < frameCount ? (int)samples[frame * channels + channel] : 0;
+			};
+			for (uint32_t channel = 0; channel < channels; ++channel)
+			{
+				states[channel].predictor = sample(blockBegin, channel);
+				write_value<int16_t>(data, (int16_t)states[channel].predictor);
+				write_value<uint8_t>(data, (uint8_t)states[channel].index);
+				write_value<uint8_t>(data, 0);
+			}
+			for (uint64_t group = 0; group < (framesPerBlock - 1) / 8; ++group)
+			{
+				for (uint32_t channel = 0; channel < channels; ++channel)
+				{
+					for (uint64_t i = 0; i < 8; i += 2)
+					{
+						const uint64_t frame = blockBegin + 1 + group * 8 + i;
+						const uint8_t low = states[channel].Encode(sample(frame, channel));
+						const uint8_t high = states[channel].Encode(sample(frame + 1, channel));
+						data.push_back(uint8_t(low | (high << 4)));
+					}
+				}
+			}
+		}
+	}
+
+	const bool fact = format == FORMAT_IMA_ADPCM;
+	const uint32_t fmtSize = fact ? 20 : 16;
+	wav.clear();
+	write_fourcc(wav, "RIFF");
+	write_value<uint32_t>(wav, uint32_t(4 + 8 + fmtSize + (fact ? 12 : 0) + 8 + data.size() + (data.size() & 1)));
+	write_fourcc(wav, "WAVE");
+	write_fourcc(wav, "fmt ");
+	write_value<uint32_t>(wav, fmtSize);
+	write_value<uint16_t>(wav, formatTag);
+	write_value<uint16_t>(wav, (uint16_t)channels);
+	write_value<uint32_t>(wav, sampleRate);
+	write_value<uint32_t>(wav, uint32_t(uint64_t(sampleRate) * blockAlign / framesPerBlock));
+	write_value<uint16_t>(wav, blockAlign);
+	write_value<uint16_t>(wav, bitsPerSample);
+	if (fact)
+	{
+		write_value<uint16_t>(wav, 2);
+		write_value<uint16_t>(wav, (uint16_t)framesPerBlock);
+		write_fourcc(wav, "fact");
+		write_value<uint32_t>(wav, 4);
+		write_value<uint32_t>(wav, (uint32_t)frameCount);
+	}
+	write_fourcc(wav, "data");
+	write_value<uint32_t>(wav, (uint32_t)data.size());
+	wav.insert(wav.end(), data.begin(), data.end());
+	if (data.size() & 1)
+	{
+		wav.push_back(0);
+	}
+	return true;
+}
+
+wiAudioMixer::VoiceID wiAudioMixer::CreateVoice(SoundID sound, wiAudio::SUBMIX_TYPE submix)
+{
+	locker.lock();
+	VoiceID id = 0;
+	auto it = sounds.find(sound);
+	if (it != sounds.end())
+	{
+		id = nextVoice++;
+		Voice& voice = voices[id];
+		voice.sound = it->second;
+		voice.submix = submix;
+		voice.loopEnd = voice.sound->frameCount;
+		if (voice.sound->samples.empty() && voice.sound->frameCount > 0)
+		{
+			voice.stream.reset(new Stream);
+		}
+	}
+	locker.unlock();
+	return id;
+}
+void wiAudioMixer::DestroyVoice(VoiceID voice)
+{
+	locker.lock();
+	voices.erase(voice);
+	locker.unlock();
+}
+
+void wiAudioMixer::Play(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end() && !it->second.playing)
+	{
+		Voice& x = it->second;
+		x.playing = true;
+		for (uint32_t c = 0; c < CHANNEL_COUNT; ++c)
+		{
+			x.gain[c] = x.volume * x.pan[c];
+		}
+	}
+	locker.unlock();
+}
+void wiAudioMixer::Pause(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.playing = false;
+	}
+	locker.unlock();
+}
+void wiAudioMixer::Stop(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.playing = false;
+		it->second.position = 0;
+		it->second.fraction = 0;
+		it->second.seek++;
+	}
+	locker.unlock();
+}
+bool wiAudioMixer::IsPlaying(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	const bool playing = it != voices.end() && it->second.playing;
+	locker.unlock();
+	return playing;
+}
+void wiAudioMixer::SetVolume(VoiceID voice, float volume)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.volume = volume;
+	}
+	locker.unlock();
+}
+float wiAudioMixer::GetVolume(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	const float volume = it == voices.end() ? 0 : it->second.volume;
+	locker.unlock();
+	return volume;
+}
+void wiAudioMixer::SetLoop(VoiceID voice, bool enabled, float begin, float length)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		Voice& x = it->second;
+		const uint64_t frameCount = x.sound->frameCount;
+		x.looping = enabled && frameCount > 0;
+		x.loopBegin = std::min(uint64_t(std::max(0.0f, begin) * x.sound->sampleRate), frameCount);
+		x.loopEnd = length > 0 ? std::min(x.loopBegin + uint64_t(length * x.sound->sampleRate), frameCount) : frameCount;
+		if (x.loopEnd <= x.loopBegin)
+		{
+			x.loopBegin = 0;
+			x.loopEnd = frameCount;
+		}
+	}
+	locker.unlock();
+}
+void wiAudioMixer::ExitLoop(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.looping = false;
+	}
+	locker.unlock();
+}
+void wiAudioMixer::SetPitch(VoiceID voice, float pitch)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.pitch = std::max(0.0f, pitch);
+	}
+	locker.unlock();
+}
+void wiAudioMixer::Set3D(VoiceID voice, const wiAudio::SoundInstance3D& instance3D)
+{
+	const XMVECTOR listenerPos = XMLoadFloat3(&instance3D.listenerPos);
+	const XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&instance3D.listenerUp), XMLoadFloat3(&instance3D.listenerFront)));
+	const XMVECTOR offset = XMLoadFloat3(&instance3D.emitterPos) - listenerPos;
+	const float distance = XMVectorGetX(XMVector3Length(offset));
+
+	// Constant power panning by the direction of the emitter relative to the listener, inverse distance attenuation outside of the emitter radius:
+	float pan = 0;
+	float attenuation = 1;
+	float doppler = 1;
+	if (distance > 0.0001f)
+	{
+		const XMVECTOR direction = offset / distance;
+		const float radius = instance3D.emitterRadius;
+		pan = XMVectorGetX(XMVector3Dot(direction, right));
+		if (distance < radius)
+		{
+			pan *= distance / radius;
+		}
+		attenuation = std::min(1.0f, std::max(radius, 1.0f) / distance);
+
+		const float listenerSpeed = std::max(-SPEED_OF_SOUND * 0.5f, std::min(SPEED_OF_SOUND * 0.5f, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&instance3D.listenerVelocity), direction))));
+		const float emitterSpeed = std::max(-SPEED_OF_SOUND * 0.5f, std::min(SPEED_OF_SOUND * 0.5f, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&instance3D.emitterVelocity), direction))));
+		doppler = std::max(0.5f, std::min(2.0f, (SPEED_OF_SOUND + listenerSpeed) / (SPEED_OF_SOUND + emitterSpeed)));
+	}
+	const float angle = (std::max(-1.0f, std::min(1.0f, pan)) + 1) * XM_PIDIV4;
+
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.pan[0] = std::cos(angle) * attenuation;
+		it->second.pan[1] = std::sin(angle) * attenuation;
+		it->second.doppler = doppler;
+	}
+	locker.unlock();
+}
+void wiAudioMixer::Reset3D(VoiceID voice)
+{
+	locker.lock();
+	auto it = voices.find(voice);
+	if (it != voices.end())
+	{
+		it->second.pan[0] = 1;
+		it->second.pan[1] = 1;
+		it->second.doppler = 1;
+	}
+	locker.unlock();
+}
+
+void wiAudioMixer::SetSubmixVolume(wiAudio::SUBMIX_TYPE type, float volume)
+{
+	locker.lock();
+	submixVolumes[type] = volume;
+	locker.unlock();
+}
+void wiAudioMixer::SetMasterVolume(float volume)
+{
+	locker.lock();
+	masterVolume = volume;
+	locker.unlock();
+}
+
+void wiAudioMixer::DecodeChunk(const SoundData& sound, Stream& stream, uint64_t frame)
+{
+	const uint32_t channels = sound.channels;
+	stream.chunkBegin = frame;
+	stream.chunkFrames = 0;
+
+	switch (sound.format)
+	{
+	case FORMAT_IMA_ADPCM:
+	{
+		// The blocks can be decoded independently, the chunk starts with the block of the frame:
+		const uint64_t firstBlock = frame / sound.framesPerBlock;
+		const uint64_t blockCount = std::max(1u, STREAM_CHUNK_SIZE / sound.framesPerBlock);
+		stream.chunkBegin = firstBlock * sound.framesPerBlock;
+		stream.chunk.resize(size_t(blockCount * sound.framesPerBlock * channels));
+		ADPCMState states[CHANNEL_COUNT];
+		for (uint64_t block = firstBlock; block < firstBlock + blockCount; ++block)
+		{
+			const size_t offset = size_t(block * sound.blockAlign);
+			if (offset + 4 * channels > sound.data.size() || block * sound.framesPerBlock >= sound.frameCount)
+			{
+				break;
+			}
+			const uint8_t* data = sound.data.data() + offset;
+			const size_t blockSize = std::min((size_t)sound.blockAlign, sound.data.size() - offset);
+			const uint64_t blockFrames = std::min((uint64_t)sound.framesPerBlock, sound.frameCount - block * sound.framesPerBlock);
+			float* dst = stream.chunk.data() + (block - firstBlock) * sound.framesPerBlock * channels;
+			// Only the first two channels are decoded, the mixer is stereo:
+			for (uint32_t channel = 0; channel < std::min(channels, (uint32_t)CHANNEL_COUNT); ++channel)
+			{
+				ADPCMState& state = states[channel];
+				state.predictor = read_value<int16_t>(data + channel * 4);
+				state.index = std::min(88, (int)data[channel * 4 + 2]);
+				dst[channel] = float(state.predictor) / 32768.0f;
+				for (uint64_t i = 1; i < blockFrames; ++i)
+				{
+					const uint64_t group = (i - 1) / 8;
+					const uint64_t index = (i - 1) % 8;
+					const size_t byte = size_t(4 * channels + (group * channels + channel) * 4 + index / 2);
+					if (byte >= blockSize)
+					{
+						break;
+					}
+					const uint8_t nibble = (index & 1) ? (data[byte] >> 4) : (data[byte] & 0xF);
+					dst[i * channels + channel] = float(state.Decode(nibble)) / 32768.0f;
+				}
+			}
+			stream.chunkFrames += blockFrames;
+			if (blockFrames < sound.framesPerBlock)
+			{
+				break;
+			}
+		}
+	}
+	break;
+	case FORMAT_VORBIS:
+	{
+		wiVorbis::Decoder& decoder = stream.vorbis;
+		if (!decoder.IsValid() && !decoder.Open(sound.data.data(), sound.data.size()))
+		{
+			break;
+		}
+		if (decoder.GetPosition() != frame)
+		{
+			// Only seek when the playback isn't continuous, for example when the voice loops:
+			decoder.Seek(frame);
+		}
+		stream.chunk.resize(STREAM_CHUNK_SIZE * channels);
+		stream.chunkFrames = decoder.Decode(stream.chunk.data(), STREAM_CHUNK_SIZE);
+	}
+	break;
+	default:
+		break;
+	}
+}
+
+void wiAudioMixer::ReadFrames(Voice& voice, uint64_t frame, size_t count, float* dst)
+{
+	const SoundData& sound = *voice.sound;
+	const uint32_t channels = sound.channels;
+	while (count > 0)
+	{
+		const float* src = nullptr;
+		uint64_t available = 0;
+		if (frame < sound.frameCount)
+		{
+			if (voice.stream == nullptr)
+			{
+				src = sound.samples.data() + frame * channels;
+				available = sound.frameCount - frame;
+			}
+			else
+			{
+				Stream& stream = *voice.stream;
+				if (frame < stream.chunkBegin || frame >= stream.chunkBegin + stream.chunkFrames)
+				{
+					DecodeChunk(sound, stream, frame);
+				}
+				if (frame >= stream.chunkBegin && frame < stream.chunkBegin + stream.chunkFrames)
+				{
+					src = stream.chunk.data() + (frame - stream.chunkBegin) * channels;
+					available = stream.chunkBegin + stream.chunkFrames - frame;
+				}
+			}
+		}
+		if (src == nullptr)
+		{
+			std::fill(dst, dst + count * CHANNEL_COUNT, 0.0f);
+			return;
+		}
+
+		const size_t n = (size_t)std::min((uint64_t)count, available);
+		if (channels == 1)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				dst[i * 2 + 0] = src[i];
+				dst[i * 2 + 1] = src[i];
+			}
+		}
+		else if (channels == 2)
+		{
+			memcpy(dst, src, n * 2 * sizeof(float));
+		}
+		else
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				dst[i * 2 + 0] = src[i * channels + 0];
+				dst[i * 2 + 1] = src[i * channels + 1];
+			}
+		}
+		dst += n * CHANNEL_COUNT;
+		frame += n;
+		count -= n;
+	}
+}
+size_t wiAudioMixer::GatherFrames(Voice& voice, double step, size_t frameCount, float* dst)
+{
+	// The frames are gathered in playback order, so the interpolation is continuous across the end of the loop:
+	const size_t needed = step == 1 && voice.fraction == 0 ? frameCount : size_t(voice.fraction + (frameCount - 1) * step) + 2;
+	uint64_t frame = voice.position;
+	size_t gathered = 0;
+	while (gathered < needed)
+	{
+		if (voice.looping && frame >= voice.loopEnd)
+		{
+			frame = voice.loopBegin;
+		}
+		const uint64_t end = voice.looping ? voice.loopEnd : voice.sound->frameCount;
+		if (frame >= end)
+		{
+			std::fill(dst + gathered * CHANNEL_COUNT, dst + needed * CHANNEL_COUNT, 0.0f);
+			break;
+		}
+		const size_t count = (size_t)std::min((uint64_t)(needed - gathered), end - frame);
+		ReadFrames(voice, frame, count, dst + gathered * CHANNEL_COUNT);
+		gathered += count;
+		frame += count;
+	}
+	return needed;
+}
+bool wiAudioMixer::Advance(Voice& voice, double step, size_t frameCount)
+{
+	const double end = voice.fraction + frameCount * step;
+	const uint64_t frames = (uint64_t)end;
+	voice.fraction = end - (double)frames;
+
+	if (voice.looping)
+	{
+		const uint64_t begin = voice.position >= voice.loopEnd ? voice.loopBegin : voice.position;
+		voice.position = begin + frames;
+		if (voice.position >= voice.loopEnd)
+		{
+			voice.position = voice.loopBegin + (voice.position - voice.loopEnd) % (voice.loopEnd - voice.loopBegin);
+		}
+		return true;
+	}
+
+	voice.position += frames;
+	return voice.position < voice.sound->frameCount;
+}
+void wiAudioMixer::MixVoice(Voice& voice, size_t frameCount)
+{
+	const double step = double(voice.sound->sampleRate) / double(sampleRate) * voice.pitch * voice.doppler;
+	float* resampled = (float*)voiceBuffer.data();
+	const size_t vectorCount = (frameCount + 1) / 2;
+
+	if (step == 1 && voice.fraction == 0)
+	{
+		GatherFrames(voice, step, frameCount, resampled);
+	}
+	else
+	{
+		const size_t needed = size_t(voice.fraction + (frameCount - 1) * step) + 2;
+		if (sourceBuffer.size() < needed * CHANNEL_COUNT)
+		{
+			sourceBuffer.resize(needed * CHANNEL_COUNT);
+		}
+		GatherFrames(voice, step, frameCount, sourceBuffer.data());
+		const float* src = sourceBuffer.data();
+		for (size_t i = 0; i < frameCount; ++i)
+		{
+			const double position = voice.fraction + i * step;
+			const size_t index = (size_t)position;
+			const float t = float(position - (double)index);
+			const float* a = src + index * CHANNEL_COUNT;
+			const float* b = a + CHANNEL_COUNT;
+			resampled[i * 2 + 0] = a[0] + (b[0] - a[0]) * t;
+			resampled[i * 2 + 1] = a[1] + (b[1] - a[1]) * t;
+		}
+	}
+	if (frameCount & 1)
+	{
+		resampled[frameCount * 2 + 0] = 0;
+		resampled[frameCount * 2 + 1] = 0;
+	}
+
+	// The gain is ramped linearly from the previous block, two stereo frames are accumulated by one vector operation:
+	const float target[CHANNEL_COUNT] = { voice.volume * voice.pan[0], voice.volume * voice.pan[1] };
+	const XMVECTOR delta = XMVectorSet(
+		(target[0] - voice.gain[0]) / frameCount, (target[1] - voice.gain[1]) / frameCount,
+		(target[0] - voice.gain[0]) / frameCount, (target[1] - voice.gain[1]) / frameCount
+	);
+	XMVECTOR gain = XMVectorMultiplyAdd(delta, XMVectorSet(1, 1, 2, 2), XMVectorSet(voice.gain[0], voice.gain[1], voice.gain[0], voice.gain[1]));
+	const XMVECTOR increment = XMVectorAdd(delta, delta);
+	const XMVECTOR* src = voiceBuffer.data();
+	XMVECTOR* dst = submixBuffers[voice.submix].data();
+	for (size_t i = 0; i < vectorCount; ++i)
+	{
+		dst[i] = XMVectorMultiplyAdd(src[i], gain, dst[i]);
+		gain = XMVectorAdd(gain, increment);
+	}
+	voice.gain[0] = target[0];
+	voice.gain[1] = target[1];
+
+	if (!Advance(voice, step, frameCount))
+	{
+		voice.playing = false;
+		voice.position = 0;
+		voice.fraction = 0;
+	}
+}
+
+void wiAudioMixer::Render(float* output, size_t frameCount)
+{
+	// The playing voices are copied, so the decoding and mixing don't block the other threads that control the voices:
+	locker.lock();
+	renderVoices.clear();
+	for (auto& x : voices)
+	{
+		Voice& voice = x.second;
+		if (voice.playing)
+		{
+			if (voice.sound->frameCount == 0)
+			{
+				voice.playing = false;
+				continue;
+			}
+			renderVoices.emplace_back(x.first, voice);
+		}
+	}
+	float submixGains[wiAudio::SUBMIX_TYPE_COUNT];
+	for (uint32_t i = 0; i < wiAudio::SUBMIX_TYPE_COUNT; ++i)
+	{
+		submixGains[i] = submixVolumes[i] * masterVolume;
+	}
+	locker.unlock();
+
+	XMVECTOR submixVolume[wiAudio::SUBMIX_TYPE_COUNT];
+	for (uint32_t i = 0; i < wiAudio::SUBMIX_TYPE_COUNT; ++i)
+	{
+		submixVolume[i] = XMVectorReplicate(submixGains[i]);
+	}
+	while (frameCount > 0)
+	{
+		const size_t blockFrames = std::min(frameCount, (size_t)BLOCK_SIZE);
+		const size_t vectorCount = (blockFrames + 1) / 2;
+		for (auto& submix : submixBuffers)
+		{
+			std::fill(submix.begin(), submix.begin() + vectorCount, XMVectorZero());
+		}
+
+		for (auto& x : renderVoices)
+		{
+			if (x.second.playing)
+			{
+				MixVoice(x.second, blockFrames);
+			}
+		}
+
+		for (size_t i = 0; i < vectorCount; ++i)
+		{
+			XMVECTOR sum = XMVectorZero();
+			for (uint32_t j = 0; j < wiAudio::SUBMIX_TYPE_COUNT; ++j)
+			{
+				sum = XMVectorMultiplyAdd(submixBuffers[j][i], submixVolume[j], sum);
+			}
+			if (i * 2 + 1 < blockFrames)
+			{
+				XMStoreFloat4((XMFLOAT4*)(output + i * 4), sum);
+			}
+			else
+			{
+				XMStoreFloat2((XMFLOAT2*)(output + i * 4), sum);
+			}
+		}
+
+		output += blockFrames * CHANNEL_COUNT;
+		frameCount -= blockFrames;
+	}
+
+	// The positions are written back, unless the voice was destroyed or stopped in the meantime:
+	locker.lock();
+	for (auto& x : renderVoices)
+	{
+		auto it = voices.find(x.first);
+		if (it != voices.end() && it->second.seek == x.second.seek)
+		{
+			Voice& voice = it->second;
+			voice.position = x.second.position;
+			voice.fraction = x.second.fraction;
+			voice.gain[0] = x.second.gain[0];
+			voice.gain[1] = x.second.gain[1];
+			voice.playing = voice.playing && x.second.playing;
+		}
+	}
+	locker.unlock();
+	renderVoices.clear();
+}
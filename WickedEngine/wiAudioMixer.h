@@ -0,0 +1,158 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiAudio.h"
+#include "wiSpinLock.h"
+#include "wiVorbis.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+// Portable software mixer, it renders the playing voices into interleaved stereo float buffers
+//	The voices are resampled to the output sample rate, scaled by their volume, 3D panning and attenuation, and accumulated into the submix
+//	of their SUBMIX_TYPE with SIMD. The submixes are scaled by the submix volumes and summed into the output, which is scaled by the master volume.
+//	Compressed sounds (IMA ADPCM wav and Ogg Vorbis) are kept compressed in memory, every voice decodes them in chunks of STREAM_CHUNK_SIZE frames
+//	while it is playing, instead of decoding the entire file when it is loaded.
+//
+//	Render() doesn't need an audio device, it can be called by the audio callback of the platform, or offline to render into memory.
+//	It only holds the lock while it copies the playing voices and writes their positions back, the decoding and mixing run outside of it,
+//	so the functions that control the voices don't wait for the audio thread. Render() must not be called from multiple threads at once.
+//	It is the wiAudio implementation of the platforms that don't have XAudio2, with the global mixer (GetGlobal()).
+class wiAudioMixer
+{
+public:
+	static const uint32_t CHANNEL_COUNT = 2;			// the output is always stereo
+	static const uint32_t BLOCK_SIZE = 256;				// frames that are mixed at once
+	static const uint32_t STREAM_CHUNK_SIZE = 4096;		// frames that are decoded at once from a compressed sound
+
+	enum FORMAT
+	{
+		FORMAT_PCM16,
+		FORMAT_FLOAT,
+		FORMAT_IMA_ADPCM,
+		FORMAT_VORBIS,
+	};
+
+	typedef uint32_t SoundID;	// 0 is invalid
+	typedef uint32_t VoiceID;	// 0 is invalid
+
+private:
+	struct SoundData
+	{
+		FORMAT format = FORMAT_FLOAT;
+		uint32_t channels = 0;
+		uint32_t sampleRate = 0;
+		uint64_t frameCount = 0;
+		std::vector<float> samples;		// interleaved, for the uncompressed sounds
+		std::vector<uint8_t> data;		// the compressed data, for the streamed sounds
+		uint32_t blockAlign = 0;		// IMA ADPCM block size in bytes
+		uint32_t framesPerBlock = 0;	// IMA ADPCM frames in a block
+	};
+
+	struct Stream
+	{
+		std::vector<float> chunk;		// decoded frames, interleaved
+		uint64_t chunkBegin = 0;
+		uint64_t chunkFrames = 0;
+		wiVorbis::Decoder vorbis;		// continues from the end of the previous chunk
+	};
+
+	struct Voice
+	{
+		std::shared_ptr<const SoundData> sound;
+		wiAudio::SUBMIX_TYPE submix = wiAudio::SUBMIX_TYPE_SOUNDEFFECT;
+		bool playing = false;
+		bool looping = false;
+		uint64_t loopBegin = 0;
+		uint64_t loopEnd = 0;
+		uint64_t position = 0;			// source frame
+		double fraction = 0;			// position between the source frames
+		float volume = 1;
+		float pitch = 1;
+		float doppler = 1;
+		float pan[CHANNEL_COUNT] = { 1, 1 };	// 3D panning and attenuation
+		float gain[CHANNEL_COUNT] = {};			// the gain at the end of the previous block, the gain is ramped to avoid clicks
+		uint32_t seek = 0;						// incremented when the position is set, Render() doesn't write back an older position
+		std::shared_ptr<Stream> stream;			// only used by Render()
+	};
+
+	uint32_t sampleRate = 48000;
+	float masterVolume = 1;
+	float submixVolumes[wiAudio::SUBMIX_TYPE_COUNT];
+
+	std::unordered_map<SoundID, std::shared_ptr<const SoundData>> sounds;
+	std::unordered_map<VoiceID, Voice> voices;
+	SoundID nextSound = 1;
+	VoiceID nextVoice = 1;
+	wiSpinLock locker;
+
+	std::vector<std::pair<VoiceID, Voice>> renderVoices;	// the copies of the playing voices that Render() mixes outside of the lock
+	std::vector<XMVECTOR> submixBuffers[wiAudio::SUBMIX_TYPE_COUNT];	// two stereo frames per vector
+	std::vector<XMVECTOR> voiceBuffer;
+	std::vector<float> sourceBuffer;
+
+	SoundID AddSound(std::shared_ptr<SoundData> sound);
+	// Decode the chunk of the compressed sound that contains the frame
+	static void DecodeChunk(const SoundData& sound, Stream& stream, uint64_t frame);
+	// Write count frames of the sound from the source frame into dst as stereo, the frames after the end of the sound are silent
+	static void ReadFrames(Voice& voice, uint64_t frame, size_t count, float* dst);
+	// Write the source frames that are needed for the next frameCount output frames of the voice into dst as stereo, the loop is followed
+	static size_t GatherFrames(Voice& voice, double step, size_t frameCount, float* dst);
+	// Advance the voice by frameCount output frames, returns false if a sound without loop ended
+	static bool Advance(Voice& voice, double step, size_t frameCount);
+	void MixVoice(Voice& voice, size_t frameCount);
+
+public:
+	wiAudioMixer(uint32_t sampleRate = 48000);
+	~wiAudioMixer();
+
+	// Get the mixer that implements wiAudio on the platforms that don't have XAudio2
+	static wiAudioMixer* GetGlobal();
+
+	uint32_t GetSampleRate() const { return sampleRate; }
+
+	// Load a wav (PCM16, float or IMA ADPCM) or Ogg Vorbis file, returns 0 if the file can't be loaded
+	SoundID LoadSound(const std::string& filename);
+	SoundID LoadSound(const uint8_t* data, size_t dataSize);
+	// Create a sound from interleaved float samples
+	SoundID CreateSound(const float* samples, uint64_t frameCount, uint32_t channels, uint32_t sampleRate);
+	// The voices of the sound keep playing until they are destroyed
+	void DestroySound(SoundID sound);
+	uint64_t GetFrameCount(SoundID sound);
+	uint32_t GetSoundSampleRate(SoundID sound);
+
+	// Encode interleaved 16 bit samples as a wav file in the format (FORMAT_PCM16 or FORMAT_IMA_ADPCM)
+	static bool EncodeWAV(const int16_t* samples, uint64_t frameCount, uint32_t channels, uint32_t sampleRate, FORMAT format, std::vector<uint8_t>& wav);
+
+	// Returns 0 if the sound doesn't exist
+	VoiceID CreateVoice(SoundID sound, wiAudio::SUBMIX_TYPE submix = wiAudio::SUBMIX_TYPE_SOUNDEFFECT);
+	void DestroyVoice(VoiceID voice);
+
+	void Play(VoiceID voice);
+	// Preserves the position
+	void Pause(VoiceID voice);
+	// Rewinds to the beginning
+	void Stop(VoiceID voice);
+	bool IsPlaying(VoiceID voice);
+	void SetVolume(VoiceID voice, float volume);
+	float GetVolume(VoiceID voice);
+	// The loop region is in seconds of the sound, 0 length loops until the end
+	void SetLoop(VoiceID voice, bool enabled, float begin = 0, float length = 0);
+	// Plays on after the end of the loop region until the end of the sound
+	void ExitLoop(VoiceID voice);
+	// Frequency ratio, 2 is an octave higher
+	void SetPitch(VoiceID voice, float pitch);
+	// Set the panning, attenuation and doppler effect of the voice
+	void Set3D(VoiceID voice, const wiAudio::SoundInstance3D& instance3D);
+	// Remove the 3D effect of the voice
+	void Reset3D(VoiceID voice);
+
+	void SetSubmixVolume(wiAudio::SUBMIX_TYPE type, float volume);
+	float GetSubmixVolume(wiAudio::SUBMIX_TYPE type) const { return submixVolumes[type]; }
+	void SetMasterVolume(float volume);
+	float GetMasterVolume() const { return masterVolume; }
+
+	// Mix the playing voices into frameCount interleaved stereo frames
+	void Render(float* output, size_t frameCount);
+};
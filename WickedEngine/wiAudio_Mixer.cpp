@@ -0,0 +1,143 @@
+#ifndef _WIN32
+#include "wiAudio.h"
+#include "wiAudioMixer.h"
+#include "wiBackLog.h"
+
+// wiAudio on the software mixer, the audio callback of the platform pulls the output with wiAudioMixer::GetGlobal()->Render()
+namespace wiAudio
+{
+	static wiAudioMixer* mixer()
+	{
+		return wiAudioMixer::GetGlobal();
+	}
+
+	void Initialize()
+	{
+		mixer();
+		wiBackLog::post("wiAudio Initialized (software mixer)");
+	}
+
+	Sound::~Sound()
+	{
+		Destroy(this);
+	}
+	SoundInstance::~SoundInstance()
+	{
+		Destroy(this);
+	}
+
+	bool CreateSound(const std::string& filename, Sound* sound)
+	{
+		Destroy(sound);
+		const wiAudioMixer::SoundID id = mixer()->LoadSound(filename);
+		sound->handle = (wiCPUHandle)id;
+		return id != 0;
+	}
+	bool CreateSoundInstance(const Sound* sound, SoundInstance* instance)
+	{
+		Destroy(instance);
+		const wiAudioMixer::VoiceID id = mixer()->CreateVoice((wiAudioMixer::SoundID)sound->handle, instance->type);
+		if (id == 0)
+		{
+			return false;
+		}
+		// The instances loop infinitely like the XAudio2 implementation, until ExitLoop():
+		mixer()->SetLoop(id, true, instance->loop_begin, instance->loop_length);
+		instance->handle = (wiCPUHandle)id;
+		return true;
+	}
+	void Destroy(Sound* sound)
+	{
+		if (sound != nullptr && sound->handle != WI_NULL_HANDLE)
+		{
+			mixer()->DestroySound((wiAudioMixer::SoundID)sound->handle);
+			sound->handle = WI_NULL_HANDLE;
+		}
+	}
+	void Destroy(SoundInstance* instance)
+	{
+		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
+		{
+			mixer()->DestroyVoice((wiAudioMixer::VoiceID)instance->handle);
+			instance->handle = WI_NULL_HANDLE;
+		}
+	}
+
+	void Play(SoundInstance* instance)
+	{
+		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
+		{
+			mixer()->Play((wiAudioMixer::VoiceID)instance->handle);
+		}
+	}
+	void Pause(SoundInstance* instance)
+	{
+		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
+		{
+			mixer()->Pause((wiAudioMixer::VoiceID)instance->handle);
+		}
+	}
+	void Stop(SoundInstance* instance)
+	{
+		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
+		{
+			mixer()->Stop((wiAudioMixer::VoiceID)instance->handle);
+			mixer()->SetLoop((wiAudioMixer::VoiceID)instance->handle, true, instance->loop_begin, instance->loop_length);
+		}
+	}
+	void SetVolume(float volume, SoundInstance* instance)
+	{
+		if (instance == nullptr || instance->handle == WI_NULL_HANDLE)
+		{
+			mixer()->SetMasterVolume(volume);
+		}
+		else
+		{
+			mixer()->SetVolume((wiAudioMixer::VoiceID)instance->handle, volume);
+		}
+	}
+	float GetVolume(const SoundInstance* instance)
+	{
+		if (instance == nullptr || instance->handle == WI_NULL_HANDLE)
+		{
+			return mixer()->GetMasterVolume();
+		}
+		return mixer()->GetVolume((wiAudioMixer::VoiceID)instance->handle);
+	}
+	void ExitLoop(SoundInstance* instance)
+	{
+		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
+		{
+			mixer()->ExitLoop((wiAudioMixer::VoiceID)instance->handle);
+		}
+	}
+
+	void SetSubmixVolume(SUBMIX_TYPE type, float volume)
+	{
+		mixer()->SetSubmixVolume(type, volume);
+	}
+	float GetSubmixVolume(SUBMIX_TYPE type)
+	{
+		return mixer()->GetSubmixVolume(type);
+	}
+
+	void Update3D(SoundInstance* instance, const SoundInstance3D& instance3D)
+	{
+		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
+		{
+			mixer()->Set3D((wiAudioMixer::VoiceID)instance->handle, instance3D);
+		}
+	}
+
+	void SetReverb(REVERB_PRESET preset)
+	{
+		// The software mixer doesn't have a reverb effect, the presets other than the default are reported once:
+		static bool reported = false;
+		if (preset != REVERB_PRESET_DEFAULT && !reported)
+		{
+			reported = true;
+			wiBackLog::post("wiAudio: reverb is not supported by the software mixer, SetReverb() is ignored");
+		}
+	}
+}
+#endif // _WIN32
@@ -0,0 +1,860 @@
+#include "wiBlockCompression.h"
+#include "wiJobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+using namespace wiGraphics;
+
+namespace wiBlockCompression
+{
+	namespace bc1
+	{
+		inline uint16_t PackRGB565(const float* color)
+		{
+			const uint32_t r = (uint32_t)std::min(31.0f, std::max(0.0f, std::round(color[0] * 31.0f / 255.0f)));
+			const uint32_t g = (uint32_t)std::min(63.0f, std::max(0.0f, std::round(color[1] * 63.0f / 255.0f)));
+			const uint32_t b = (uint32_t)std::min(31.0f, std::max(0.0f, std::round(color[2] * 31.0f / 255.0f)));
+			return (uint16_t)((r << 11) | (g << 5) | b);
+		}
+		inline void UnpackRGB565(uint16_t value, int* color)
+		{
+			const int r = (value >> 11) & 31;
+			const int g = (value >> 5) & 63;
+			const int b = value & 31;
+			color[0] = (r << 3) | (r >> 2);
+			color[1] = (g << 2) | (g >> 4);
+			color[2] = (b << 3) | (b >> 2);
+		}
+		// fourColor	: BC1 blocks use 3 colors and transparency if c0 <= c1, the color block of BC3 is always 4 color
+		inline void ComputePalette(uint16_t c0, uint16_t c1, int palette[4][3], bool fourColor)
+		{
+			UnpackRGB565(c0, palette[0]);
+			UnpackRGB565(c1, palette[1]);
+			for (int i = 0; i < 3; ++i)
+			{
+				if (fourColor)
+				{
+					palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+					palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+				}
+				else
+				{
+					palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+					palette[3][i] = 0;
+				}
+			}
+		}
+
+		// Select the closest palette entries, returns the squared error
+		inline uint32_t ComputeIndices(const uint8_t* rgba, uint16_t c0, uint16_t c1, uint32_t& indices)
+		{
+			int palette[4][3];
+			ComputePalette(c0, c1, palette, c0 > c1);
+			const int paletteSize = c0 > c1 ? 4 : 3;
+
+			indices = 0;
+			uint32_t error = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				const uint8_t* pixel = rgba + i * 4;
+				int best = 0;
+				int bestError = INT_MAX;
+				for (int j = 0; j < paletteSize; ++j)
+				{
+					const int dr = pixel[0] - palette[j][0];
+					const int dg = pixel[1] - palette[j][1];
+					const int db = pixel[2] - palette[j][2];
+					const int e = dr * dr + dg * dg + db * db;
+					if (e < bestError)
+					{
+						bestError = e;
+						best = j;
+					}
+				}
+				indices |= (uint32_t)best << (i * 2);
+				error += (uint32_t)bestError;
+			}
+			return error;
+		}
+
+		// Least squares fit of the endpoints to the pixels with fixed indices, returns false if the system is singular
+		inline bool RefineEndpoints(const uint8_t* rgba, uint32_t indices, float* endpoint0, float* endpoint1)
+		{
+			static const float weights[] = { 0, 1, 1.0f / 3.0f, 2.0f / 3.0f };
+			float aa = 0, ab = 0, bb = 0;
+			float ax[3] = {}, bx[3] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				const float w = weights[(indices >> (i * 2)) & 3];
+				const float a = 1 - w;
+				aa += a * a;
+				ab += a * w;
+				bb += w * w;
+				for (int c = 0; c < 3; ++c)
+				{
+					ax[c] += a * rgba[i * 4 + c];
+					bx[c] += w * rgba[i * 4 + c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if (std::abs(det) < 1e-6f)
+			{
+				return false;
+			}
+			const float rcp = 1.0f / det;
+			for (int c = 0; c < 3; ++c)
+			{
+				endpoint0[c] = (ax[c] * bb - bx[c] * ab) * rcp;
+				endpoint1[c] = (bx[c] * aa - ax[c] * ab) * rcp;
+			}
+			return true;
+		}
+
+		// Writes an opaque 4 color block
+		inline uint32_t Encode(const uint8_t* rgba, uint8_t* block)
+		{
+			// Principal axis of the colors:
+			float mean[3] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					mean[c] += rgba[i * 4 + c];
+				}
+			}
+			for (int c = 0; c < 3; ++c)
+			{
+				mean[c] /= 16.0f;
+			}
+			float cov[6] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				const float r = rgba[i * 4 + 0] - mean[0];
+				const float g = rgba[i * 4 + 1] - mean[1];
+				const float b = rgba[i * 4 + 2] - mean[2];
+				cov[0] += r * r;
+				cov[1] += r * g;
+				cov[2] += r * b;
+				cov[3] += g * g;
+				cov[4] += g * b;
+				cov[5] += b * b;
+			}
+			float axis[3] = { 0.577f, 0.577f, 0.577f };
+			for (int iteration = 0; iteration < 8; ++iteration)
+			{
+				const float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+				const float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+				const float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+				const float len = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+				if (len < 1e-6f)
+				{
+					break;
+				}
+				axis[0] = x / len;
+				axis[1] = y / len;
+				axis[2] = z / len;
+			}
+
+			// Endpoints are the extremes of the colors along the axis:
+			float minT = FLT_MAX;
+			float maxT = -FLT_MAX;
+			for (int i = 0; i < 16; ++i)
+			{
+				const float t =
+					(rgba[i * 4 + 0] - mean[0]) * axis[0] +
+					(rgba[i * 4 + 1] - mean[1]) * axis[1] +
+					(rgba[i * 4 + 2] - mean[2]) * axis[2];
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			const float lenSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+			float endpoint0[3];
+			float endpoint1[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				endpoint0[c] = mean[c] + axis[c] * maxT / std::max(lenSq, 1e-6f);
+				endpoint1[c] = mean[c] + axis[c] * minT / std::max(lenSq, 1e-6f);
+			}
+
+			uint16_t c0 = PackRGB565(endpoint0);
+			uint16_t c1 = PackRGB565(endpoint1);
+			if (c0 < c1)
+			{
+				std::swap(c0, c1);
+			}
+			uint32_t indices;
+			uint32_t error = ComputeIndices(rgba, c0, c1, indices);
+
+			// Refine the endpoints with least squares, and keep them if they are better:
+			for (int iteration = 0; iteration < 2 && c0 != c1 && error > 0; ++iteration)
+			{
+				if (!RefineEndpoints(rgba, indices, endpoint0, endpoint1))
+				{
+					break;
+				}
+				uint16_t r0 = PackRGB565(endpoint0);
+				uint16_t r1 = PackRGB565(endpoint1);
+				if (r0 < r1)
+				{
+					std::swap(r0, r1);
+				}
+				if (r0 == r1)
+				{
+					break;
+				}
+				uint32_t refinedIndices;
+				const uint32_t refinedError = ComputeIndices(rgba, r0, r1, refinedIndices);
+				if (refinedError >= error)
+				{
+					break;
+				}
+				c0 = r0;
+				c1 = r1;
+				indices = refinedIndices;
+				error = refinedError;
+			}
+
+			if (c0 == c1)
+			{
+				// 3 color mode, but every pixel uses the first color:
+				indices = 0;
+			}
+
+			block[0] = (uint8_t)(c0 & 0xFF);
+			block[1] = (uint8_t)(c0 >> 8);
+			block[2] = (uint8_t)(c1 & 0xFF);
+			block[3] = (uint8_t)(c1 >> 8);
+			block[4] = (uint8_t)(indices >> 0);
+			block[5] = (uint8_t)(indices >> 8);
+			block[6] = (uint8_t)(indices >> 16);
+			block[7] = (uint8_t)(indices >> 24);
+			return error;
+		}
+
+		inline void Decode(const uint8_t* block, uint8_t* rgba, bool fourColor)
+		{
+			const uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+			const uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+			const uint32_t indices = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+			fourColor |= c0 > c1;
+			int palette[4][3];
+			ComputePalette(c0, c1, palette, fourColor);
+			for (int i = 0; i < 16; ++i)
+			{
+				const uint32_t index = (indices >> (i * 2)) & 3;
+				rgba[i * 4 + 0] = (uint8_t)palette[index][0];
+				rgba[i * 4 + 1] = (uint8_t)palette[index][1];
+				rgba[i * 4 + 2] = (uint8_t)palette[index][2];
+				rgba[i * 4 + 3] = (!fourColor && index == 3) ? 0 : 255;
+			}
+		}
+	}
+
+	namespace bc4
+	{
+		inline void ComputePalette(int a0, int a1, int palette[8])
+		{
+			palette[0] = a0;
+			palette[1] = a1;
+			if (a0 > a1)
+			{
+				for (int i = 1; i < 7; ++i)
+				{
+					palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+				}
+			}
+			else
+			{
+				for (int i = 1; i < 5; ++i)
+				{
+					palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+				}
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+		}
+		inline uint32_t ComputeIndices(const uint8_t* values, int a0, int a1, uint64_t& indices)
+		{
+			int palette[8];
+			ComputePalette(a0, a1, palette);
+
+			indices = 0;
+			uint32_t error = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				int best = 0;
+				int bestError = INT_MAX;
+				for (int j = 0; j < 8; ++j)
+				{
+					const int d = values[i] - palette[j];
+					if (d * d < bestError)
+					{
+						bestError = d * d;
+						best = j;
+					}
+				}
+				indices |= (uint64_t)best << (i * 3);
+				error += (uint32_t)bestError;
+			}
+			return error;
+		}
+		inline void Encode(const uint8_t* rgba, uint8_t* block, uint32_t channel)
+		{
+			uint8_t values[16];
+			int minValue = 255;
+			int maxValue = 0;
+			int minInner = 255; // without the 0 and 255 values
+			int maxInner = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				values[i] = rgba[i * 4 + channel];
+				minValue = std::min(minValue, (int)values[i]);
+				maxValue = std::max(maxValue, (int)values[i]);
+				if (values[i] > 0 && values[i] < 255)
+				{
+					minInner = std::min(minInner, (int)values[i]);
+					maxInner = std::max(maxInner, (int)values[i]);
+				}
+			}
+
+			// 8 value mode:
+			int a0 = maxValue;
+			int a1 = minValue;
+			uint64_t indices;
+			uint32_t error = ComputeIndices(values, a0, a1, indices);
+
+			// 6 value mode with explicit 0 and 255, it is better if there are outliers at the extremes:
+			if (error > 0 && minInner <= maxInner && (minValue == 0 || maxValue == 255))
+			{
+				uint64_t indices6;
+				const uint32_t error6 = ComputeIndices(values, minInner, maxInner, indices6);
+				if (error6 < error)
+				{
+					a0 = minInner;
+					a1 = maxInner;
+					indices = indices6;
+				}
+			}
+
+			block[0] = (uint8_t)a0;
+			block[1] = (uint8_t)a1;
+			for (int i = 0; i < 6; ++i)
+			{
+				block[2 + i] = (uint8_t)(indices >> (i * 8));
+			}
+		}
+		inline void Decode(const uint8_t* block, uint8_t* rgba, uint32_t channel)
+		{
+			int palette[8];
+			ComputePalette(block[0], block[1], palette);
+			uint64_t indices = 0;
+			for (int i = 0; i < 6; ++i)
+			{
+				indices |= (uint64_t)block[2 + i] << (i * 8);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				rgba[i * 4 + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+			}
+		}
+	}
+
+	namespace bc7
+	{
+		static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		inline int Interpolate(int e0, int e1, int index)
+		{
+			return ((64 - weights[index]) * e0 + weights[index] * e1 + 32) >> 6;
+		}
+
+		// Quantize an endpoint to 7 bits per channel with a fixed p-bit, the result is the expanded 8 bit value
+		inline void Quantize(const float* endpoint, int pbit, int* quantized, int* expanded)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				quantized[c] = std::min(127, std::max(0, (int)std::round((endpoint[c] - pbit) / 2.0f)));
+				expanded[c] = (quantized[c] << 1) | pbit;
+			}
+		}
+
+		inline uint32_t ComputeIndices(const uint8_t* rgba, const int* e0, const int* e1, uint8_t* indices)
+		{
+			int palette[16][4];
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					palette[i][c] = Interpolate(e0[c], e1[c], i);
+				}
+			}
+
+			uint32_t error = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				const uint8_t* pixel = rgba + i * 4;
+				int best = 0;
+				int bestError = INT_MAX;
+				for (int j = 0; j < 16; ++j)
+				{
+					const int dr = pixel[0] - palette[j][0];
+					const int dg = pixel[1] - palette[j][1];
+					const int db = pixel[2] - palette[j][2];
+					const int da = pixel[3] - palette[j][3];
+					const int e = dr * dr + dg * dg + db * db + da * da;
+					if (e < bestError)
+					{
+						bestError = e;
+						best = j;
+					}
+				}
+				indices[i] = (uint8_t)best;
+				error += (uint32_t)bestError;
+			}
+			return error;
+		}
+
+		struct Candidate
+		{
+			int q0[4], q1[4];
+			int p0, p1;
+			uint8_t indices[16];
+			uint32_t error = UINT_MAX;
+		};
+
+		// Try every p-bit combination for a pair of unquantized endpoints
+		inline void Evaluate(const uint8_t* rgba, const float* endpoint0, const float* endpoint1, Candidate& best)
+		{
+			for (int p0 = 0; p0 < 2; ++p0)
+			{
+				for (int p1 = 0; p1 < 2; ++p1)
+				{
+					Candidate candidate;
+					int e0[4], e1[4];
+					Quantize(endpoint0, p0, candidate.q0, e0);
+					Quantize(endpoint1, p1, candidate.q1, e1);
+					candidate.p0 = p0;
+					candidate.p1 = p1;
+					candidate.error = ComputeIndices(rgba, e0, e1, candidate.indices);
+					if (candidate.error < best.error)
+					{
+						best = candidate;
+					}
+				}
+			}
+		}
+
+		inline bool RefineEndpoints(const uint8_t* rgba, const uint8_t* indices, float* endpoint0, float* endpoint1)
+		{
+			float aa = 0, ab = 0, bb = 0;
+			float ax[4] = {}, bx[4] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				const float w = weights[indices[i]] / 64.0f;
+				const float a = 1 - w;
+				aa += a * a;
+				ab += a * w;
+				bb += w * w;
+				for (int c = 0; c < 4; ++c)
+				{
+					ax[c] += a * rgba[i * 4 + c];
+					bx[c] += w * rgba[i * 4 + c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if (std::abs(det) < 1e-6f)
+			{
+				return false;
+			}
+			const float rcp = 1.0f / det;
+			for (int c = 0; c < 4; ++c)
+			{
+				endpoint0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) * rcp));
+				endpoint1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) * rcp));
+			}
+			return true;
+		}
+
+		// Writes bits into a 128 bit block, LSB first
+		struct BitWriter
+		{
+			uint8_t* block;
+			uint32_t pos = 0;
+			inline void Write(uint32_t value, uint32_t count)
+			{
+				for (uint32_t i = 0; i < count; ++i, ++pos)
+				{
+					block[pos >> 3] |= (uint8_t)(((value >> i) & 1) << (pos & 7));
+				}
+			}
+		};
+		struct BitReader
+		{
+			const uint8_t* block;
+			uint32_t pos = 0;
+			inline uint32_t Read(uint32_t count)
+			{
+				uint32_t value = 0;
+				for (uint32_t i = 0; i < count; ++i, ++pos)
+				{
+					value |= (uint32_t)((block[pos >> 3] >> (pos & 7)) & 1) << i;
+				}
+				return value;
+			}
+		};
+
+		// Mode 6: one subset, 7777.1 RGBA endpoints with unique p-bits, 4 bit indices
+		inline void Encode(const uint8_t* rgba, uint8_t* block)
+		{
+			float mean[4] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					mean[c] += rgba[i * 4 + c];
+				}
+			}
+			for (int c = 0; c < 4; ++c)
+			{
+				mean[c] /= 16.0f;
+			}
+			float cov[4][4] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				float d[4];
+				for (int c = 0; c < 4; ++c)
+				{
+					d[c] = rgba[i * 4 + c] - mean[c];
+				}
+				for (int r = 0; r < 4; ++r)
+				{
+					for (int c = 0; c < 4; ++c)
+					{
+						cov[r][c] += d[r] * d[c];
+					}
+				}
+			}
+			float axis[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+			for (int iteration = 0; iteration < 8; ++iteration)
+			{
+				float next[4] = {};
+				float len = 0;
+				for (int r = 0; r < 4; ++r)
+				{
+					for (int c = 0; c < 4; ++c)
+					{
+						next[r] += cov[r][c] * axis[c];
+					}
+					len = std::max(len, std::abs(next[r]));
+				}
+				if (len < 1e-6f)
+				{
+					break;
+				}
+				for (int c = 0; c < 4; ++c)
+				{
+					axis[c] = next[c] / len;
+				}
+			}
+			float lenSq = 0;
+			for (int c = 0; c < 4; ++c)
+			{
+				lenSq += axis[c] * axis[c];
+			}
+			lenSq = std::max(lenSq, 1e-6f);
+
+			float minT = FLT_MAX;
+			float maxT = -FLT_MAX;
+			for (int i = 0; i < 16; ++i)
+			{
+				float t = 0;
+				for (int c = 0; c < 4; ++c)
+				{
+					t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+				}
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			float endpoint0[4];
+			float endpoint1[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				endpoint0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT / lenSq));
+				endpoint1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT / lenSq));
+			}
+
+			Candidate best;
+			Evaluate(rgba, endpoint0, endpoint1, best);
+			for (int iteration = 0; iteration < 2 && best.error > 0; ++iteration)
+			{
+				if (!RefineEndpoints(rgba, best.indices, endpoint0, endpoint1))
+				{
+					break;
+				}
+				const uint32_t error = best.error;
+				Evaluate(rgba, endpoint0, endpoint1, best);
+				if (best.error >= error)
+				{
+					break;
+				}
+			}
+
+			// The most significant bit of the first index is implicitly zero, swap the endpoints if needed:
+			if (best.indices[0] >= 8)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					std::swap(best.q0[c], best.q1[c]);
+				}
+				std::swap(best.p0, best.p1);
+				for (int i = 0; i < 16; ++i)
+				{
+					best.indices[i] = 15 - best.indices[i];
+				}
+			}
+
+			std::fill(block, block + 16, (uint8_t)0);
+			BitWriter writer = { block };
+			writer.Write(1 << 6, 7);
+			for (int c = 0; c < 4; ++c)
+			{
+				writer.Write((uint32_t)best.q0[c], 7);
+				writer.Write((uint32_t)best.q1[c], 7);
+			}
+			writer.Write((uint32_t)best.p0, 1);
+			writer.Write((uint32_t)best.p1, 1);
+			writer.Write(best.indices[0], 3);
+			for (int i = 1; i < 16; ++i)
+			{
+				writer.Write(best.indices[i], 4);
+			}
+		}
+
+		inline bool Decode(const uint8_t* block, uint8_t* rgba)
+		{
+			BitReader reader = { block };
+			if (reader.Read(7) != (1 << 6))
+			{
+				std::fill(rgba, rgba + 64, (uint8_t)0);
+				return false;
+			}
+			int e0[4], e1[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				e0[c] = (int)reader.Read(7) << 1;
+				e1[c] = (int)reader.Read(7) << 1;
+			}
+			const int p0 = (int)reader.Read(1);
+			const int p1 = (int)reader.Read(1);
+			for (int c = 0; c < 4; ++c)
+			{
+				e0[c] |= p0;
+				e1[c] |= p1;
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				const int index = (int)reader.Read(i == 0 ? 3 : 4);
+				for (int c = 0; c < 4; ++c)
+				{
+					rgba[i * 4 + c] = (uint8_t)Interpolate(e0[c], e1[c], index);
+				}
+			}
+			return true;
+		}
+	}
+
+
+	void EncodeBC1(const uint8_t* rgba, uint8_t* block)
+	{
+		bc1::Encode(rgba, block);
+	}
+	void EncodeBC3(const uint8_t* rgba, uint8_t* block)
+	{
+		bc4::Encode(rgba, block, 3);
+		bc1::Encode(rgba, block + 8);
+	}
+	void EncodeBC4(const uint8_t* rgba, uint8_t* block, uint32_t channel)
+	{
+		bc4::Encode(rgba, block, channel);
+	}
+	void EncodeBC5(const uint8_t* rgba, uint8_t* block)
+	{
+		bc4::Encode(rgba, block, 0);
+		bc4::Encode(rgba, block + 8, 1);
+	}
+	void EncodeBC7(const uint8_t* rgba, uint8_t* block)
+	{
+		bc7::Encode(rgba, block);
+	}
+
+	void DecodeBC1(const uint8_t* block, uint8_t* rgba)
+	{
+		bc1::Decode(block, rgba, false);
+	}
+	void DecodeBC3(const uint8_t* block, uint8_t* rgba)
+	{
+		bc1::Decode(block + 8, rgba, true);
+		bc4::Decode(block, rgba, 3);
+	}
+	void DecodeBC4(const uint8_t* block, uint8_t* rgba, uint32_t channel)
+	{
+		bc4::Decode(block, rgba, channel);
+	}
+	void DecodeBC5(const uint8_t* block, uint8_t* rgba)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		bc4::Decode(block, rgba, 0);
+		bc4::Decode(block + 8, rgba, 1);
+	}
+	bool DecodeBC7(const uint8_t* block, uint8_t* rgba)
+	{
+		return bc7::Decode(block, rgba);
+	}
+
+	bool IsFormatSupported(FORMAT format)
+	{
+		return GetBlockSize(format) > 0;
+	}
+	uint32_t GetBlockSize(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_BC1_UNORM:
+		case FORMAT_BC1_UNORM_SRGB:
+		case FORMAT_BC4_UNORM:
+			return 8;
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC3_UNORM_SRGB:
+		case FORMAT_BC5_UNORM:
+		case FORMAT_BC7_UNORM:
+		case FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+	size_t GetCompressedSize(FORMAT format, uint32_t width, uint32_t height)
+	{
+		const size_t blocksX = std::max(1u, (width + 3) / 4);
+		const size_t blocksY = std::max(1u, (height + 3) / 4);
+		return blocksX * blocksY * GetBlockSize(format);
+	}
+
+	bool CompressImage(FORMAT format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* dest)
+	{
+		const uint32_t blockSize = GetBlockSize(format);
+		if (blockSize == 0 || width == 0 || height == 0)
+		{
+			return false;
+		}
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, blocksY, 1, [&](wiJobDispatchArgs args) {
+			const uint32_t blockY = args.jobIndex;
+			uint8_t* dst = dest + (size_t)blockY * blocksX * blockSize;
+			for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+			{
+				// Gather the block, partial blocks are padded by repeating the edge pixels:
+				uint8_t pixels[64];
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const uint32_t py = std::min(blockY * 4 + y, height - 1);
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						const uint32_t px = std::min(blockX * 4 + x, width - 1);
+						memcpy(pixels + (y * 4 + x) * 4, rgba + ((size_t)py * width + px) * 4, 4);
+					}
+				}
+
+				switch (format)
+				{
+				case FORMAT_BC1_UNORM:
+				case FORMAT_BC1_UNORM_SRGB:
+					EncodeBC1(pixels, dst);
+					break;
+				case FORMAT_BC3_UNORM:
+				case FORMAT_BC3_UNORM_SRGB:
+					EncodeBC3(pixels, dst);
+					break;
+				case FORMAT_BC4_UNORM:
+					EncodeBC4(pixels, dst);
+					break;
+				case FORMAT_BC5_UNORM:
+					EncodeBC5(pixels, dst);
+					break;
+				default:
+					EncodeBC7(pixels, dst);
+					break;
+				}
+				dst += blockSize;
+			}
+		});
+		wiJobSystem::Wait(ctx);
+
+		return true;
+	}
+
+	bool DecompressImage(FORMAT format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* rgba)
+	{
+		const uint32_t blockSize = GetBlockSize(format);
+		if (blockSize == 0)
+		{
+			return false;
+		}
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+
+		bool success = true;
+		for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+		{
+			for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+			{
+				uint8_t pixels[64];
+				switch (format)
+				{
+				case FORMAT_BC1_UNORM:
+				case FORMAT_BC1_UNORM_SRGB:
+					DecodeBC1(src, pixels);
+					break;
+				case FORMAT_BC3_UNORM:
+				case FORMAT_BC3_UNORM_SRGB:
+					DecodeBC3(src, pixels);
+					break;
+				case FORMAT_BC4_UNORM:
+					for (int i = 0; i < 16; ++i)
+					{
+						pixels[i * 4 + 1] = 0;
+						pixels[i * 4 + 2] = 0;
+						pixels[i * 4 + 3] = 255;
+					}
+					DecodeBC4(src, pixels);
+					break;
+				case FORMAT_BC5_UNORM:
+					DecodeBC5(src, pixels);
+					break;
+				default:
+					success &= DecodeBC7(src, pixels);
+					break;
+				}
+				src += blockSize;
+
+				for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y)
+				{
+					for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x)
+					{
+						memcpy(rgba + ((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4, pixels + (y * 4 + x) * 4, 4);
+					}
+				}
+			}
+		}
+		return success;
+	}
+}
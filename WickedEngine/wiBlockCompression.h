@@ -0,0 +1,46 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiGraphicsDescriptors.h"
+
+// CPU block compression (BC1, BC3, BC4, BC5, BC7), it doesn't need a graphics device
+//	Block functions work on 4x4 pixel blocks: 16 RGBA8 pixels in row major order (64 bytes)
+//	BC1 and BC4 blocks are 8 bytes, BC3, BC5 and BC7 blocks are 16 bytes
+namespace wiBlockCompression
+{
+	// RGB with 1 bit alpha (alpha is ignored by the encoder, the result is opaque)
+	void EncodeBC1(const uint8_t* rgba, uint8_t* block);
+	// BC1 color + BC4 alpha
+	void EncodeBC3(const uint8_t* rgba, uint8_t* block);
+	// Single channel:
+	//	channel	: which channel of the input to compress (0: red, 1: green, 2: blue, 3: alpha)
+	void EncodeBC4(const uint8_t* rgba, uint8_t* block, uint32_t channel = 0);
+	// Two channels (red and green), for example normal maps
+	void EncodeBC5(const uint8_t* rgba, uint8_t* block);
+	// RGBA with higher quality than BC3 (the encoder only writes mode 6 blocks)
+	void EncodeBC7(const uint8_t* rgba, uint8_t* block);
+
+	void DecodeBC1(const uint8_t* block, uint8_t* rgba);
+	void DecodeBC3(const uint8_t* block, uint8_t* rgba);
+	// Writes only the specified channel of the output
+	void DecodeBC4(const uint8_t* block, uint8_t* rgba, uint32_t channel = 0);
+	// The output blue channel is zero, alpha is 255
+	void DecodeBC5(const uint8_t* block, uint8_t* rgba);
+	// Only decodes mode 6 blocks (as written by EncodeBC7), returns false for other modes
+	bool DecodeBC7(const uint8_t* block, uint8_t* rgba);
+
+	// Returns true for the formats that can be compressed by CompressImage()
+	bool IsFormatSupported(wiGraphics::FORMAT format);
+	// Returns the size of one block in bytes, or zero if the format is not supported
+	uint32_t GetBlockSize(wiGraphics::FORMAT format);
+	// Returns the compressed size of an image in bytes (partial blocks at the edges are padded)
+	size_t GetCompressedSize(wiGraphics::FORMAT format, uint32_t width, uint32_t height);
+
+	// Compress an RGBA8 image, the rows of blocks are compressed in parallel with the wiJobSystem
+	//	format	: BC1, BC3, BC4, BC5 or BC7 (UNORM or SRGB, the data is not converted between color spaces)
+	//	rgba	: source image with width * height * 4 bytes
+	//	dest	: destination, it must be able to hold GetCompressedSize(format, width, height) bytes
+	//	returns false if the format is not supported
+	bool CompressImage(wiGraphics::FORMAT format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* dest);
+	// Decompress an image into RGBA8, rgba must be able to hold width * height * 4 bytes
+	bool DecompressImage(wiGraphics::FORMAT format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* rgba);
+}
@@ -0,0 +1,327 @@
+#include "wiClusteredCulling.h"
+#include "wiJobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace wiClusteredCulling
+{
+	// Tile boundaries along a screen axis are planes going through the camera position: p - tangent * depth = 0
+	//	tangents is sorted ascending (tileCount + 1 elements), and this returns the tile range that the sphere can touch
+	inline bool ComputeTileRange(float center, float depth, float radius, const float* tangents, const float* invNorms, uint32_t tileCount, uint32_t& first, uint32_t& last)
+	{
+		first = tileCount;
+		for (uint32_t i = 0; i < tileCount; ++i)
+		{
+			// sphere is not fully on the positive side of the tile's upper boundary:
+			if ((center - tangents[i + 1] * depth) * invNorms[i + 1] <= radius)
+			{
+				first = i;
+				break;
+			}
+		}
+		last = 0;
+		bool found = false;
+		for (uint32_t i = tileCount; i > 0; --i)
+		{
+			// sphere is not fully on the negative side of the tile's lower boundary:
+			if ((center - tangents[i - 1] * depth) * invNorms[i - 1] >= -radius)
+			{
+				last = i - 1;
+				found = true;
+				break;
+			}
+		}
+		return found && first <= last;
+	}
+
+	const uint32_t* ClusterGrid::GetItems(uint32_t clusterIndex, ENTITY_CATEGORY category) const
+	{
+		const Cluster& cluster = clusters[clusterIndex];
+		uint32_t offset = cluster.offset;
+		for (int i = 0; i < category; ++i)
+		{
+			offset += cluster.count[i];
+		}
+		return items.data() + offset;
+	}
+	uint32_t ClusterGrid::GetSlice(float viewDepth) const
+	{
+		if (viewDepth <= minSliceDepth)
+		{
+			return 0;
+		}
+		const float slice = std::floor(std::log(viewDepth) * sliceScale - sliceBias);
+		return (uint32_t)std::max(0.0f, std::min(float(sliceCount - 1), slice));
+	}
+
+	void Build(
+		ClusterGrid& grid,
+		const XMFLOAT4X4& view,
+		const XMFLOAT4X4& projection,
+		float zNearP,
+		float zFarP,
+		const EntityList entities[CATEGORY_COUNT]
+	)
+	{
+		wiJobSystem::context ctx;
+
+		const uint32_t tileCount = grid.tileCountX * grid.tileCountY;
+		const uint32_t clusterCount = grid.GetClusterCount();
+		grid.clusters.resize(clusterCount);
+		grid.bounds.resize(clusterCount);
+		grid.bins.resize(grid.sliceCount);
+
+		// Depth slices are distributed exponentially from minSliceDepth to zFarP:
+		const float sliceNear = std::max(grid.minSliceDepth, 0.001f);
+		const float sliceFar = std::max(zFarP, sliceNear * 2);
+		const float logRatio = std::log(sliceFar / sliceNear);
+		grid.sliceScale = float(grid.sliceCount) / logRatio;
+		grid.sliceBias = float(grid.sliceCount) * std::log(sliceNear) / logRatio;
+
+		// Tile boundary planes in view space from the projection (jitter offsets are in _31, _32):
+		std::vector<float> tangentsX(grid.tileCountX + 1);
+		std::vector<float> invNormsX(grid.tileCountX + 1);
+		std::vector<float> tangentsY(grid.tileCountY + 1);
+		std::vector<float> invNormsY(grid.tileCountY + 1);
+		for (uint32_t i = 0; i <= grid.tileCountX; ++i)
+		{
+			const float ndc = -1.0f + 2.0f * float(i) / float(grid.tileCountX);
+			tangentsX[i] = (ndc - projection._31) / projection._11;
+			invNormsX[i] = 1.0f / std::sqrt(1 + tangentsX[i] * tangentsX[i]);
+		}
+		for (uint32_t i = 0; i <= grid.tileCountY; ++i)
+		{
+			const float ndc = -1.0f + 2.0f * float(i) / float(grid.tileCountY);
+			tangentsY[i] = (ndc - projection._32) / projection._22;
+			invNormsY[i] = 1.0f / std::sqrt(1 + tangentsY[i] * tangentsY[i]);
+		}
+
+		// Cluster bounds only need to be recomputed when the projection changes:
+		if (grid.boundsClusterCount != clusterCount || grid.boundsNear != zNearP || grid.boundsFar != zFarP ||
+			memcmp(&grid.boundsProjection, &projection, sizeof(projection)) != 0)
+		{
+			grid.boundsClusterCount = clusterCount;
+			grid.boundsNear = zNearP;
+			grid.boundsFar = zFarP;
+			grid.boundsProjection = projection;
+
+			wiJobSystem::Dispatch(ctx, clusterCount, 64, [&](wiJobDispatchArgs args) {
+				const uint32_t x = args.jobIndex % grid.tileCountX;
+				const uint32_t y = (args.jobIndex / grid.tileCountX) % grid.tileCountY;
+				const uint32_t slice = args.jobIndex / tileCount;
+
+				const float z0 = slice == 0 ? std::min(zNearP, sliceNear) : std::exp((float(slice) + grid.sliceBias) / grid.sliceScale);
+				const float z1 = std::exp((float(slice + 1) + grid.sliceBias) / grid.sliceScale);
+
+				// rows are counted from the top of the screen, but ndc tangents from the bottom:
+				const uint32_t row = grid.tileCountY - 1 - y;
+
+				const float xs[] = { tangentsX[x] * z0, tangentsX[x] * z1, tangentsX[x + 1] * z0, tangentsX[x + 1] * z1 };
+				const float ys[] = { tangentsY[row] * z0, tangentsY[row] * z1, tangentsY[row + 1] * z0, tangentsY[row + 1] * z1 };
+
+				AABB& box = grid.bounds[args.jobIndex];
+				box._min = XMFLOAT3(*std::min_element(xs, xs + 4), *std::min_element(ys, ys + 4), z0);
+				box._max = XMFLOAT3(*std::max_element(xs, xs + 4), *std::max_element(ys, ys + 4), z1);
+			});
+		}
+
+		// Compute the conservative cluster range of every entity:
+		const XMMATRIX V = XMLoadFloat4x4(&view);
+		for (int category = 0; category < CATEGORY_COUNT; ++category)
+		{
+			const EntityList& list = entities[category];
+			std::vector<ClusterGrid::EntityRange>& ranges = grid.ranges[category];
+			ranges.resize(list.count);
+
+			wiJobSystem::Dispatch(ctx, list.count, 64, [&grid, &list, &ranges, &tangentsX, &invNormsX, &tangentsY, &invNormsY, V, zNearP, zFarP](wiJobDispatchArgs args) {
+				const SPHERE& sphere = list.spheres[args.jobIndex];
+				ClusterGrid::EntityRange& range = ranges[args.jobIndex];
+
+				XMStoreFloat3(&range.center, XMVector3Transform(XMLoadFloat3(&sphere.center), V));
+				range.radius = sphere.radius;
+
+				if (sphere.radius == UNBOUNDED_RADIUS)
+				{
+					range.minX = 0;
+					range.maxX = uint16_t(grid.tileCountX - 1);
+					range.minY = 0;
+					range.maxY = uint16_t(grid.tileCountY - 1);
+					range.minZ = 0;
+					range.maxZ = uint16_t(grid.sliceCount - 1);
+					return;
+				}
+
+				// Empty range by default (culled):
+				range.minX = range.minY = range.minZ = 1;
+				range.maxX = range.maxY = range.maxZ = 0;
+
+				const float zMin = range.center.z - sphere.radius;
+				const float zMax = range.center.z + sphere.radius;
+				if (zMax < zNearP || zMin > zFarP)
+				{
+					return;
+				}
+
+				uint32_t minX = 0, maxX = grid.tileCountX - 1;
+				uint32_t minY = 0, maxY = grid.tileCountY - 1;
+				if (zMin > 0)
+				{
+					// Sphere is fully in front of the camera, the tile planes can reject it:
+					if (!ComputeTileRange(range.center.x, range.center.z, sphere.radius, tangentsX.data(), invNormsX.data(), grid.tileCountX, minX, maxX))
+					{
+						return;
+					}
+					uint32_t first, last;
+					if (!ComputeTileRange(range.center.y, range.center.z, sphere.radius, tangentsY.data(), invNormsY.data(), grid.tileCountY, first, last))
+					{
+						return;
+					}
+					minY = grid.tileCountY - 1 - last;
+					maxY = grid.tileCountY - 1 - first;
+				}
+
+				range.minX = uint16_t(minX);
+				range.maxX = uint16_t(maxX);
+				range.minY = uint16_t(minY);
+				range.maxY = uint16_t(maxY);
+				range.minZ = uint16_t(grid.GetSlice(std::max(0.0f, zMin)));
+				range.maxZ = uint16_t(grid.GetSlice(zMax));
+			});
+		}
+		wiJobSystem::Wait(ctx);
+
+		// Bin entities into clusters, every depth slice is processed by a separate job:
+		wiJobSystem::Dispatch(ctx, grid.sliceCount, 1, [&grid, tileCount](wiJobDispatchArgs args) {
+			const uint32_t slice = args.jobIndex;
+			ClusterGrid::SliceBin& bin = grid.bins[slice];
+			bin.counts.assign(tileCount * CATEGORY_COUNT, 0);
+			bin.entries.clear();
+
+			const AABB* sliceBounds = grid.bounds.data() + slice * tileCount;
+
+			for (int category = 0; category < CATEGORY_COUNT; ++category)
+			{
+				const std::vector<ClusterGrid::EntityRange>& ranges = grid.ranges[category];
+				for (uint32_t entityIndex = 0; entityIndex < (uint32_t)ranges.size(); ++entityIndex)
+				{
+					const ClusterGrid::EntityRange& range = ranges[entityIndex];
+					if (slice < range.minZ || slice > range.maxZ)
+					{
+						continue;
+					}
+
+					const bool unbounded = range.radius == UNBOUNDED_RADIUS;
+					const XMVECTOR C = XMLoadFloat3(&range.center);
+					const XMVECTOR R2 = XMVectorReplicate(range.radius * range.radius);
+
+					for (uint32_t y = range.minY; y <= range.maxY; ++y)
+					{
+						for (uint32_t x = range.minX; x <= range.maxX; ++x)
+						{
+							const uint32_t local = x + y * grid.tileCountX;
+
+							if (!unbounded)
+							{
+								// Exact sphere-box test against the cluster bounds:
+								const AABB& box = sliceBounds[local];
+								const XMVECTOR closest = XMVectorClamp(C, XMLoadFloat3(&box._min), XMLoadFloat3(&box._max));
+								const XMVECTOR distanceSq = XMVector3LengthSq(XMVectorSubtract(C, closest));
+								if (XMVector3Greater(distanceSq, R2))
+								{
+									continue;
+								}
+							}
+
+							bin.counts[local * CATEGORY_COUNT + category]++;
+							bin.entries.push_back(local);
+							bin.entries.push_back(entityIndex);
+						}
+					}
+				}
+			}
+
+			// Counting sort by cluster, categories remain ordered because they were binned in order
+			//	(cluster offsets are used as slice-local write cursors here, they are finalized when merging)
+			bin.items.resize(bin.entries.size() / 2);
+			uint32_t offset = 0;
+			for (uint32_t local = 0; local < tileCount; ++local)
+			{
+				const uint32_t* counts = &bin.counts[local * CATEGORY_COUNT];
+				grid.clusters[slice * tileCount + local].offset = offset;
+				offset += counts[CATEGORY_LIGHT] + counts[CATEGORY_DECAL] + counts[CATEGORY_ENVPROBE];
+			}
+			for (size_t i = 0; i < bin.entries.size(); i += 2)
+			{
+				Cluster& cluster = grid.clusters[slice * tileCount + bin.entries[i]];
+				bin.items[cluster.offset++] = bin.entries[i + 1];
+			}
+		});
+		wiJobSystem::Wait(ctx);
+
+		// Merge slices into the flat item list:
+		std::vector<uint32_t> sliceOffsets(grid.sliceCount);
+		uint32_t itemCount = 0;
+		for (uint32_t slice = 0; slice < grid.sliceCount; ++slice)
+		{
+			sliceOffsets[slice] = itemCount;
+			itemCount += (uint32_t)grid.bins[slice].items.size();
+		}
+		grid.items.resize(itemCount);
+
+		wiJobSystem::Dispatch(ctx, grid.sliceCount, 1, [&grid, &sliceOffsets, tileCount](wiJobDispatchArgs args) {
+			const uint32_t slice = args.jobIndex;
+			const ClusterGrid::SliceBin& bin = grid.bins[slice];
+			if (!bin.items.empty())
+			{
+				memcpy(grid.items.data() + sliceOffsets[slice], bin.items.data(), sizeof(uint32_t) * bin.items.size());
+			}
+
+			uint32_t offset = sliceOffsets[slice];
+			for (uint32_t local = 0; local < tileCount; ++local)
+			{
+				Cluster& cluster = grid.clusters[slice * tileCount + local];
+				cluster.offset = offset;
+				for (int category = 0; category < CATEGORY_COUNT; ++category)
+				{
+					cluster.count[category] = bin.counts[local * CATEGORY_COUNT + category];
+					offset += cluster.count[category];
+				}
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	void WriteEntityBuckets(
+		const ClusterGrid& grid,
+		uint32_t bucketCount,
+		const uint32_t entityOffsets[CATEGORY_COUNT],
+		uint32_t* buckets
+	)
+	{
+		wiJobSystem::context ctx;
+
+		const uint32_t maxEntityCount = bucketCount * 32;
+
+		wiJobSystem::Dispatch(ctx, grid.GetClusterCount(), 64, [&](wiJobDispatchArgs args) {
+			const Cluster& cluster = grid.clusters[args.jobIndex];
+			uint32_t* clusterBuckets = buckets + args.jobIndex * bucketCount;
+			memset(clusterBuckets, 0, sizeof(uint32_t) * bucketCount);
+
+			const uint32_t* items = grid.items.data() + cluster.offset;
+			for (int category = 0; category < CATEGORY_COUNT; ++category)
+			{
+				for (uint32_t i = 0; i < cluster.count[category]; ++i)
+				{
+					const uint32_t entityIndex = entityOffsets[category] + items[i];
+					if (entityIndex < maxEntityCount)
+					{
+						clusterBuckets[entityIndex / 32] |= 1u << (entityIndex % 32);
+					}
+				}
+				items += cluster.count[category];
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+}
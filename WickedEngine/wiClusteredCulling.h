@@ -0,0 +1,106 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiIntersect.h"
+
+#include <vector>
+
+// CPU clustered culling of lights, decals and environment probes
+//	The view frustum is divided into a froxel grid (screen tiles x exponential depth slices),
+//	and every cluster receives the list of entities that can affect it. There is no upper limit on the entity count per cluster.
+namespace wiClusteredCulling
+{
+	enum ENTITY_CATEGORY
+	{
+		CATEGORY_LIGHT,
+		CATEGORY_DECAL,
+		CATEGORY_ENVPROBE,
+		CATEGORY_COUNT
+	};
+
+	// An entity bounding sphere with this radius affects all clusters (for example directional lights)
+	static const float UNBOUNDED_RADIUS = FLT_MAX;
+
+	struct Cluster
+	{
+		uint32_t offset = 0;					// first item in ClusterGrid::items
+		uint32_t count[CATEGORY_COUNT] = {};	// item count per entity category, items are ordered by category
+	};
+
+	struct ClusterGrid
+	{
+		// Grid setup, can be modified before Build():
+		uint32_t tileCountX = 16;
+		uint32_t tileCountY = 9;
+		uint32_t sliceCount = 24;
+		float minSliceDepth = 0.5f;		// depth slices start from here, everything closer falls into the first slice
+
+		// Results of the last Build():
+		std::vector<Cluster> clusters;
+		std::vector<uint32_t> items;	// entity indices, relative to the input entity list of the category
+		std::vector<AABB> bounds;		// view space bounding box of every cluster
+		float sliceScale = 0;			// slice = floor(log(viewDepth) * sliceScale - sliceBias)
+		float sliceBias = 0;
+
+		// Internal state that is kept between builds to avoid reallocations:
+		struct EntityRange
+		{
+			XMFLOAT3 center;
+			float radius;
+			uint16_t minX, maxX, minY, maxY, minZ, maxZ;
+		};
+		std::vector<EntityRange> ranges[CATEGORY_COUNT];
+		struct SliceBin
+		{
+			std::vector<uint32_t> counts;	// per cluster and category
+			std::vector<uint32_t> entries;	// (local cluster index, entity index) pairs
+			std::vector<uint32_t> items;	// entity indices sorted by cluster
+		};
+		std::vector<SliceBin> bins;
+		XMFLOAT4X4 boundsProjection = {};
+		float boundsNear = 0;
+		float boundsFar = 0;
+		uint32_t boundsClusterCount = 0;
+
+		inline uint32_t GetClusterCount() const { return tileCountX * tileCountY * sliceCount; }
+		inline uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t slice) const { return x + tileCountX * (y + tileCountY * slice); }
+		inline uint32_t GetItemCount(uint32_t clusterIndex, ENTITY_CATEGORY category) const { return clusters[clusterIndex].count[category]; }
+		// Returns the entity list of a category inside a cluster, the size is GetItemCount()
+		const uint32_t* GetItems(uint32_t clusterIndex, ENTITY_CATEGORY category) const;
+		// Returns the depth slice of a positive view space depth
+		uint32_t GetSlice(float viewDepth) const;
+	};
+
+	struct EntityList
+	{
+		const SPHERE* spheres = nullptr;	// world space bounding spheres
+		uint32_t count = 0;
+	};
+
+	// Assign entities to clusters, the work is distributed over wiJobSystem:
+	//	grid		: cluster grid that will receive the results
+	//	view		: camera view matrix
+	//	projection	: camera projection matrix (left handed, reversed Z, as in CameraComponent)
+	//	zNearP		: camera near plane distance
+	//	zFarP		: camera far plane distance
+	//	entities	: input bounding spheres for every entity category
+	void Build(
+		ClusterGrid& grid,
+		const XMFLOAT4X4& view,
+		const XMFLOAT4X4& projection,
+		float zNearP,
+		float zFarP,
+		const EntityList entities[CATEGORY_COUNT]
+	);
+
+	// Write the cluster item lists as entity bitmask buckets (same layout as the EntityTiles of the GPU tiled culling)
+	//	grid			: cluster grid after Build()
+	//	bucketCount		: number of uint32_t buckets per cluster
+	//	entityOffsets	: index of the first entity of each category in the shader entity array
+	//	buckets			: destination array, it must hold GetClusterCount() * bucketCount elements
+	void WriteEntityBuckets(
+		const ClusterGrid& grid,
+		uint32_t bucketCount,
+		const uint32_t entityOffsets[CATEGORY_COUNT],
+		uint32_t* buckets
+	);
+}
@@ -194,11 +194,16 @@ void wiEmittedParticle::CreateSelfBuffers()
 
 uint32_t wiEmittedParticle::GetMemorySizeInBytes() const
 {
-	if (particleBuffer == nullptr)
-		return 0;
-
 	uint32_t retVal = 0;
 
+	if (cpuSimulation != nullptr)
+	{
+		retVal += (uint32_t)cpuSimulation->GetMemorySizeInBytes();
+	}
+
+	if (particleBuffer == nullptr)
+		return retVal;
+
 	retVal += particleBuffer->GetDesc().ByteWidth;
 	retVal += aliveList[0]->GetDesc().ByteWidth;
 	retVal += aliveList[1]->GetDesc().ByteWidth;
@@ -221,7 +226,12 @@ void wiEmittedParticle::UpdateCPU(const TransformComponent& transform, float dt)
 
 	emit = std::max(0.0f, emit - floorf(emit));
 
-	CreateSelfBuffers();
+	// The CPU simulation can run without a graphics device, the buffers are only needed for drawing:
+	GraphicsDevice* device = wiRenderer::GetDevice();
+	if (device != nullptr)
+	{
+		CreateSelfBuffers();
+	}
 
 	center = transform.GetPosition();
 
@@ -234,11 +244,29 @@ void wiEmittedParticle::UpdateCPU(const TransformComponent& transform, float dt)
 	aliveList[0].swap(aliveList[1]);
 
 
-	if (IsDebug())
+	if (IsDebug() && device != nullptr && !IsCPUSimulationEnabled())
 	{
-		wiRenderer::GetDevice()->DownloadResource(counterBuffer.get(), debugDataReadbackBuffer.get(), &debugData);
+		device->DownloadResource(counterBuffer.get(), debugDataReadbackBuffer.get(), &debugData);
 	}
 }
+void wiEmittedParticle::UpdateSimulationCPU(const TransformComponent& transform, const MeshComponent* mesh, const wiEmittedParticleCPU::Environment& environment, float dt)
+{
+	if (IsPaused() || !IsCPUSimulationEnabled())
+		return;
+
+	if (cpuSimulation == nullptr || cpuSimulation->GetMaxCount() != MAX_PARTICLES)
+	{
+		cpuSimulation.reset(new wiEmittedParticleCPU);
+		cpuSimulation->Initialize(MAX_PARTICLES);
+	}
+
+	const uint32_t emitCount = cpuSimulation->Update(*this, transform.world, mesh, environment, (uint32_t)emit, dt);
+
+	debugData.aliveCount = cpuSimulation->GetAliveCount();
+	debugData.deadCount = MAX_PARTICLES - debugData.aliveCount;
+	debugData.realEmitCount = emitCount;
+	debugData.aliveCount_afterSimulation = debugData.aliveCount;
+}
 void wiEmittedParticle::Burst(int num)
 {
 	if (IsPaused())
@@ -249,6 +277,7 @@ void wiEmittedParticle::Burst(int num)
 void wiEmittedParticle::Restart()
 {
 	buffersUpToDate = false;
+	cpuSimulation.reset();
 	SetPaused(false);
 }
 
@@ -269,9 +298,9 @@ void wiEmittedParticle::UpdateGPU(const TransformComponent& transform, const Mat
 		EmittedParticleCB cb;
 		cb.xEmitterWorld = transform.world;
 		cb.xEmitCount = (uint32_t)emit;
-		cb.xEmitterMeshIndexCount = mesh == nullptr ? 0 : (uint32_t)mesh->indices.size();
-		cb.xEmitterMeshVertexPositionStride = sizeof(MeshComponent::Vertex_POS);
+		cb.xEmitterMeshIndexCount = mesh == nullptr ? 0 : mesh->GetBaseIndexCount();
 		cb.xEmitterRandomness = wiRandom::getRandom(0, 1000) * 0.001f;
+		const GPUBuffer* meshPositionStream = mesh == nullptr ? nullptr : mesh->GetPositionStream(cb.xEmitterMeshPositionStream);
 		cb.xParticleLifeSpan = life;
 		cb.xParticleLifeSpanRandomness = random_life;
 		cb.xParticleNormalFactor = normal_factor;
@@ -302,6 +331,78 @@ void wiEmittedParticle::UpdateGPU(const TransformComponent& transform, const Mat
 		cb.xSPH_ENABLED = IsSPHEnabled() ? 1 : 0;
 
 		device->UpdateBuffer(constantBuffer.get(), &cb, cmd);
+
+		if (IsCPUSimulationEnabled())
+		{
+			// The buffers are updated with copies, which begin and end in the GENERAL state, but the GPU simulation and Draw() expect
+			//	the particle buffers and counters in UNORDERED_ACCESS and the indirect arguments in INDIRECT_ARGUMENT:
+			{
+				GPUBarrier barriers[] = {
+					GPUBarrier::Buffer(particleBuffer.get(), BUFFER_STATE_UNORDERED_ACCESS, BUFFER_STATE_GENERAL),
+					GPUBarrier::Buffer(aliveList[1].get(), BUFFER_STATE_UNORDERED_ACCESS, BUFFER_STATE_GENERAL),
+					GPUBarrier::Buffer(counterBuffer.get(), BUFFER_STATE_UNORDERED_ACCESS, BUFFER_STATE_GENERAL),
+					GPUBarrier::Buffer(indirectBuffers.get(), BUFFER_STATE_INDIRECT_ARGUMENT, BUFFER_STATE_GENERAL),
+				};
+				device->Barrier(barriers, arraysize(barriers), cmd);
+			}
+
+			// The particles were simulated on the CPU, they are uploaded into the particle buffer and the NEW alive list:
+			const uint32_t aliveCount = cpuSimulation == nullptr ? 0 : cpuSimulation->GetAliveCount();
+			if (aliveCount > 0)
+			{
+				vector<Particle> particles(aliveCount);
+				cpuSimulation->WriteParticles(particles.data(), cb.xParticleColor);
+				vector<uint32_t> indices(aliveCount);
+				for (uint32_t i = 0; i < aliveCount; ++i)
+				{
+					indices[i] = i;
+				}
+				if (IsSorted())
+				{
+					// back to front from the main camera:
+					const XMVECTOR eye = wiRenderer::GetCamera().GetEye();
+					vector<float> distances(aliveCount);
+					for (uint32_t i = 0; i < aliveCount; ++i)
+					{
+						distances[i] = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&particles[i].position), eye)));
+					}
+					std::sort(indices.begin(), indices.end(), [&](uint32_t a, uint32_t b) {
+						return distances[a] > distances[b];
+					});
+				}
+				device->UpdateBuffer(particleBuffer.get(), particles.data(), cmd, (int)(sizeof(Particle) * aliveCount));
+				device->UpdateBuffer(aliveList[1].get(), indices.data(), cmd, (int)(sizeof(uint32_t) * aliveCount));
+			}
+
+			ParticleCounters counters;
+			counters.aliveCount = 0;
+			counters.deadCount = MAX_PARTICLES - aliveCount;
+			counters.realEmitCount = 0;
+			counters.aliveCount_afterSimulation = aliveCount;
+			device->UpdateBuffer(counterBuffer.get(), &counters, cmd);
+
+			// Dispatch arguments are not used, draw arguments (VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation):
+			const uint32_t args[] = {
+				0, 0, 0,
+				0, 0, 0,
+				aliveCount * 6, 1, 0, 0,
+			};
+			device->UpdateBuffer(indirectBuffers.get(), args, cmd, sizeof(args));
+
+			{
+				GPUBarrier barriers[] = {
+					GPUBarrier::Buffer(particleBuffer.get(), BUFFER_STATE_GENERAL, BUFFER_STATE_UNORDERED_ACCESS),
+					GPUBarrier::Buffer(aliveList[1].get(), BUFFER_STATE_GENERAL, BUFFER_STATE_UNORDERED_ACCESS),
+					GPUBarrier::Buffer(counterBuffer.get(), BUFFER_STATE_GENERAL, BUFFER_STATE_UNORDERED_ACCESS),
+					GPUBarrier::Buffer(indirectBuffers.get(), BUFFER_STATE_GENERAL, BUFFER_STATE_INDIRECT_ARGUMENT),
+				};
+				device->Barrier(barriers, arraysize(barriers), cmd);
+			}
+
+			device->EventEnd(cmd);
+			return;
+		}
+
 		device->BindConstantBuffer(CS, constantBuffer.get(), CB_GETBINDSLOT(EmittedParticleCB), cmd);
 
 		GPUResource* uavs[] = {
@@ -315,9 +416,9 @@ void wiEmittedParticle::UpdateGPU(const TransformComponent& transform, const Mat
 		};
 		device->BindUAVs(CS, uavs, 0, arraysize(uavs), cmd);
 
-		GPUResource* resources[] = {
+		const GPUResource* resources[] = {
 			mesh == nullptr ? nullptr : mesh->indexBuffer.get(),
-			mesh == nullptr ? nullptr : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS.get() : mesh->vertexBuffer_POS.get()),
+			meshPositionStream,
 		};
 		device->BindResources(CS, resources, TEXSLOT_ONDEMAND0, arraysize(resources), cmd);
 
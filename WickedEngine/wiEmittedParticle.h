@@ -6,6 +6,7 @@
 #include "wiEnums.h"
 #include "wiScene_Decl.h"
 #include "wiECS.h"
+#include "wiEmittedParticle_CPU.h"
 
 #include <memory>
 
@@ -47,6 +48,8 @@ private:
 	float emit = 0.0f;
 	int burst = 0;
 
+	std::unique_ptr<wiEmittedParticleCPU> cpuSimulation;
+
 	bool buffersUpToDate = false;
 	uint32_t MAX_PARTICLES = 1000;
 
@@ -55,6 +58,13 @@ public:
 	void Burst(int num);
 	void Restart();
 
+	// Simulate the emitter on the CPU, if the CPU simulation is enabled (it must be called after UpdateCPU)
+	//	mesh		: emitter mesh, or nullptr to emit from the center
+	//	environment	: force fields, and bounding boxes for the collisions (if depth collision is enabled)
+	void UpdateSimulationCPU(const TransformComponent& transform, const MeshComponent* mesh, const wiEmittedParticleCPU::Environment& environment, float dt);
+	// The CPU simulation state, or nullptr if the CPU simulation was not used yet
+	const wiEmittedParticleCPU* GetSimulationCPU() const { return cpuSimulation.get(); }
+
 	// Must have a transform and material component, but mesh is optional
 	void UpdateGPU(const TransformComponent& transform, const MaterialComponent& material, const MeshComponent* mesh, wiGraphics::CommandList cmd) const;
 	void Draw(const CameraComponent& camera, const MaterialComponent& material, wiGraphics::CommandList cmd) const;
@@ -69,6 +79,7 @@ public:
 		SORTING = 1 << 2,
 		DEPTHCOLLISION = 1 << 3,
 		SPH_FLUIDSIMULATION = 1 << 4,
+		CPU_SIMULATION = 1 << 5,
 	};
 	uint32_t _flags = EMPTY;
 
@@ -107,12 +118,16 @@ public:
 	inline bool IsSorted() const { return _flags & SORTING; }
 	inline bool IsDepthCollisionEnabled() const { return _flags & DEPTHCOLLISION; }
 	inline bool IsSPHEnabled() const { return _flags & SPH_FLUIDSIMULATION; }
+	inline bool IsCPUSimulationEnabled() const { return _flags & CPU_SIMULATION; }
 
 	inline void SetDebug(bool value) { if (value) { _flags |= DEBUG; } else { _flags &= ~DEBUG; } }
 	inline void SetPaused(bool value) { if (value) { _flags |= PAUSED; } else { _flags &= ~PAUSED; } }
 	inline void SetSorted(bool value) { if (value) { _flags |= SORTING; } else { _flags &= ~SORTING; } }
 	inline void SetDepthCollisionEnabled(bool value) { if (value) { _flags |= DEPTHCOLLISION; } else { _flags &= ~DEPTHCOLLISION; } }
 	inline void SetSPHEnabled(bool value) { if (value) { _flags |= SPH_FLUIDSIMULATION; } else { _flags &= ~SPH_FLUIDSIMULATION; } }
+	// The CPU simulation doesn't need a graphics device, the particles are uploaded for drawing in UpdateGPU
+	//	Changing the backend removes the existing particles
+	inline void SetCPUSimulationEnabled(bool value) { if (value != IsCPUSimulationEnabled()) { buffersUpToDate = false; cpuSimulation.reset(); } if (value) { _flags |= CPU_SIMULATION; } else { _flags &= ~CPU_SIMULATION; } }
 
 	void Serialize(wiArchive& archive, uint32_t seed = 0);
 
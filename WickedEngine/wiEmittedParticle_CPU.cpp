@@ -0,0 +1,753 @@
+#include "wiEmittedParticle_CPU.h"
+#include "wiEmittedParticle.h"
+#include "wiScene.h"
+#include "wiJobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+using namespace std;
+
+namespace wiScene
+{
+
+static const uint32_t BLOCK_SIZE = 256; // particles per job, must be a multiple of 4
+
+static inline XMVECTOR XM_CALLCONV LoadStream(const vector<float>& stream, uint32_t index)
+{
+	return XMLoadFloat4((const XMFLOAT4*)&stream[index]);
+}
+static inline void XM_CALLCONV StoreStream(vector<float>& stream, uint32_t index, FXMVECTOR value)
+{
+	XMStoreFloat4((XMFLOAT4*)&stream[index], value);
+}
+static inline float XM_CALLCONV HorizontalSum(FXMVECTOR value)
+{
+	return XMVectorGetX(XMVector4Dot(value, XMVectorSplatOne()));
+}
+// Mask of the lanes of a vector that starts at index, the lanes at end and after are cleared
+static inline XMVECTOR XM_CALLCONV LaneMask(uint32_t index, uint32_t end)
+{
+	return XMVectorLess(XMVectorAdd(XMVectorReplicate((float)index), XMVectorSet(0, 1, 2, 3)), XMVectorReplicate((float)end));
+}
+static inline float XM_CALLCONV ReduceMin(FXMVECTOR value)
+{
+	XMFLOAT4 v;
+	XMStoreFloat4(&v, value);
+	return std::min(std::min(v.x, v.y), std::min(v.z, v.w));
+}
+static inline float XM_CALLCONV ReduceMax(FXMVECTOR value)
+{
+	XMFLOAT4 v;
+	XMStoreFloat4(&v, value);
+	return std::max(std::max(v.x, v.y), std::max(v.z, v.w));
+}
+// Bounding box from the per lane minimums and maximums of the axes
+static inline AABB XM_CALLCONV ReduceBounds(FXMVECTOR minX, FXMVECTOR minY, FXMVECTOR minZ, GXMVECTOR maxX, HXMVECTOR maxY, HXMVECTOR maxZ)
+{
+	return AABB(
+		XMFLOAT3(ReduceMin(minX), ReduceMin(minY), ReduceMin(minZ)),
+		XMFLOAT3(ReduceMax(maxX), ReduceMax(maxY), ReduceMax(maxZ))
+	);
+}
+// Same as SPH_GridHash() in the shaders, but for a power of two bucket count
+static inline uint32_t GridHash(int x, int y, int z, uint32_t bucketMask)
+{
+	const uint32_t p1 = 73856093;   // some large primes
+	const uint32_t p2 = 19349663;
+	const uint32_t p3 = 83492791;
+	return ((p1 * (uint32_t)x) ^ (p2 * (uint32_t)y) ^ (p3 * (uint32_t)z)) & bucketMask;
+}
+// Buckets of the 27 neighbor cells, without duplicates because hash collisions can put neighbor cells into the same bucket
+static inline uint32_t GatherNeighborBuckets(int x, int y, int z, uint32_t bucketMask, uint32_t* buckets)
+{
+	uint32_t count = 0;
+	for (int i = -1; i <= 1; ++i)
+	{
+		for (int j = -1; j <= 1; ++j)
+		{
+			for (int k = -1; k <= 1; ++k)
+			{
+				const uint32_t bucket = GridHash(x + i, y + j, z + k, bucketMask);
+				if (std::find(buckets, buckets + count, bucket) == buckets + count)
+				{
+					buckets[count++] = bucket;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+void wiEmittedParticleCPU::Initialize(uint32_t maxCount)
+{
+	this->maxCount = maxCount;
+	aliveCount = 0;
+	bounds = AABB();
+
+	// The neighbor search loads 4 particles from any starting index, so 3 more elements are needed:
+	const size_t capacity = (size_t)maxCount + 3;
+	for (auto& stream : streams)
+	{
+		stream.clear();
+		stream.resize(capacity, 0.0f);
+	}
+	reorderTemp.clear();
+	reorderTemp.resize(capacity, 0.0f);
+}
+
+size_t wiEmittedParticleCPU::GetMemorySizeInBytes() const
+{
+	size_t size = 0;
+	for (auto& stream : streams)
+	{
+		size += stream.capacity() * sizeof(float);
+	}
+	size += reorderTemp.capacity() * sizeof(float);
+	size += cellHashes.capacity() * sizeof(uint32_t);
+	size += cellOffsets.capacity() * sizeof(uint32_t);
+	size += order.capacity() * sizeof(uint32_t);
+	size += blockBounds.capacity() * sizeof(AABB);
+	return size;
+}
+
+float wiEmittedParticleCPU::Random()
+{
+	// PCG hash, returns a number in [0, 1):
+	randomState = randomState * 747796405u + 2891336453u;
+	uint32_t word = ((randomState >> ((randomState >> 28u) + 4u)) ^ randomState) * 277803737u;
+	word = (word >> 22u) ^ word;
+	return (word >> 8) * (1.0f / 16777216.0f);
+}
+
+void wiEmittedParticleCPU::RemoveDeadParticles()
+{
+	// The particles whose life ran out in the last update are removed, the order of the others is kept:
+	const vector<float>& life = streams[LIFE];
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < aliveCount; ++i)
+	{
+		if (life[i] > 0)
+		{
+			if (count != i)
+			{
+				for (auto& stream : streams)
+				{
+					stream[count] = stream[i];
+				}
+			}
+			count++;
+		}
+	}
+	aliveCount = count;
+}
+
+uint32_t wiEmittedParticleCPU::Emit(const wiEmittedParticle& emitter, const XMFLOAT4X4& world, const MeshComponent* mesh, uint32_t emitCount)
+{
+	// we can not emit more than there are free slots:
+	emitCount = std::min(emitCount, maxCount - aliveCount);
+
+	const XMMATRIX W = XMLoadFloat4x4(&world);
+	const uint32_t triangleCount = mesh == nullptr ? 0 : mesh->GetBaseIndexCount() / 3;
+	const bool normals = mesh != nullptr && mesh->vertex_normals.size() == mesh->vertex_positions.size();
+
+	for (uint32_t i = 0; i < emitCount; ++i)
+	{
+		XMVECTOR P;
+		XMVECTOR N;
+		if (triangleCount > 0)
+		{
+			// random triangle on emitter surface:
+			const uint32_t tri = std::min(triangleCount - 1, (uint32_t)(triangleCount * Random()));
+			const uint32_t i0 = mesh->indices[tri * 3 + 0];
+			const uint32_t i1 = mesh->indices[tri * 3 + 1];
+			const uint32_t i2 = mesh->indices[tri * 3 + 2];
+
+			// random barycentric coords:
+			float f = Random();
+			float g = Random();
+			if (f + g > 1)
+			{
+				f = 1 - f;
+				g = 1 - g;
+			}
+
+			// compute final surface position on triangle from barycentric coords:
+			const XMVECTOR P0 = XMLoadFloat3(&mesh->vertex_positions[i0]);
+			const XMVECTOR P1 = XMLoadFloat3(&mesh->vertex_positions[i1]);
+			const XMVECTOR P2 = XMLoadFloat3(&mesh->vertex_positions[i2]);
+			P = XMVectorAdd(P0, XMVectorAdd(XMVectorScale(XMVectorSubtract(P1, P0), f), XMVectorScale(XMVectorSubtract(P2, P0), g)));
+			P = XMVector3Transform(P, W);
+
+			N = XMVectorZero();
+			if (normals)
+			{
+				const XMVECTOR N0 = XMLoadFloat3(&mesh->vertex_normals[i0]);
+				const XMVECTOR N1 = XMLoadFloat3(&mesh->vertex_normals[i1]);
+				const XMVECTOR N2 = XMLoadFloat3(&mesh->vertex_normals[i2]);
+				N = XMVectorAdd(N0, XMVectorAdd(XMVectorScale(XMVectorSubtract(N1, N0), f), XMVectorScale(XMVectorSubtract(N2, N0), g)));
+				N = XMVector3Normalize(XMVector3TransformNormal(N, W));
+			}
+		}
+		else
+		{
+			// Just emit from center point:
+			P = XMVector3Transform(XMVectorZero(), W);
+			N = XMVectorZero();
+		}
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+		XMStoreFloat3(&position, P);
+		XMStoreFloat3(&normal, N);
+
+		const float particleStartingSize = emitter.size + emitter.size * (Random() - 0.5f) * emitter.random_factor;
+
+		// create new particle:
+		const uint32_t index = aliveCount++;
+		streams[POSITION_X][index] = position.x;
+		streams[POSITION_Y][index] = position.y;
+		streams[POSITION_Z][index] = position.z;
+		streams[VELOCITY_X][index] = (normal.x + (Random() - 0.5f) * emitter.random_factor) * emitter.normal_factor;
+		streams[VELOCITY_Y][index] = (normal.y + (Random() - 0.5f) * emitter.random_factor) * emitter.normal_factor;
+		streams[VELOCITY_Z][index] = (normal.z + (Random() - 0.5f) * emitter.random_factor) * emitter.normal_factor;
+		streams[FORCE_X][index] = 0;
+		streams[FORCE_Y][index] = 0;
+		streams[FORCE_Z][index] = 0;
+		streams[MASS][index] = emitter.mass;
+		streams[ROTATIONAL_VELOCITY][index] = emitter.rotation * XM_PI * 60 + (Random() - 0.5f) * emitter.random_factor;
+		const float maxLife = emitter.life + emitter.life * (Random() - 0.5f) * emitter.random_life;
+		streams[MAXLIFE][index] = maxLife;
+		streams[LIFE][index] = maxLife;
+		streams[SIZE_BEGIN][index] = particleStartingSize;
+		streams[SIZE_END][index] = particleStartingSize * emitter.scaleX;
+		streams[DENSITY][index] = 0;
+	}
+	return emitCount;
+}
+
+void wiEmittedParticleCPU::SortIntoGrid(float h)
+{
+	// Grid cell is of size [SPH smoothing radius], the cells are hashed into a power of two bucket count:
+	uint32_t bucketCount = 64;
+	while (bucketCount < aliveCount * 2)
+	{
+		bucketCount *= 2;
+	}
+	const uint32_t bucketMask = bucketCount - 1;
+	const float h_rcp = 1.0f / h;
+	const uint32_t blockCount = (aliveCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	wiJobSystem::context ctx;
+
+	cellHashes.resize(aliveCount);
+	wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * BLOCK_SIZE;
+		const uint32_t end = std::min(begin + BLOCK_SIZE, aliveCount);
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			cellHashes[i] = GridHash(
+				(int)std::floor(streams[POSITION_X][i] * h_rcp),
+				(int)std::floor(streams[POSITION_Y][i] * h_rcp),
+				(int)std::floor(streams[POSITION_Z][i] * h_rcp),
+				bucketMask
+			);
+		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	// Counting sort of the particles by bucket, cellOffsets[bucket]..cellOffsets[bucket + 1] will be the particles of a bucket:
+	cellOffsets.assign(bucketCount + 1, 0);
+	for (uint32_t i = 0; i < aliveCount; ++i)
+	{
+		cellOffsets[cellHashes[i] + 1]++;
+	}
+	for (uint32_t bucket = 0; bucket < bucketCount; ++bucket)
+	{
+		cellOffsets[bucket + 1] += cellOffsets[bucket];
+	}
+	order.resize(aliveCount);
+	for (uint32_t i = 0; i < aliveCount; ++i)
+	{
+		order[cellOffsets[cellHashes[i]]++] = i;
+	}
+	for (uint32_t bucket = bucketCount; bucket > 0; --bucket)
+	{
+		cellOffsets[bucket] = cellOffsets[bucket - 1];
+	}
+	cellOffsets[0] = 0;
+
+	// The particle storage itself is reordered, so the particles of a bucket can be loaded as vectors:
+	for (auto& stream : streams)
+	{
+		wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobDispatchArgs args) {
+			const uint32_t begin = args.jobIndex * BLOCK_SIZE;
+			const uint32_t end = std::min(begin + BLOCK_SIZE, aliveCount);
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				reorderTemp[i] = stream[order[i]];
+			}
+		});
+		wiJobSystem::Wait(ctx);
+		stream.swap(reorderTemp);
+	}
+}
+
+void wiEmittedParticleCPU::SimulateSPH(const wiEmittedParticle& emitter)
+{
+	// SPH params:
+	const float h = emitter.SPH_h;		// smoothing radius
+	const float h2 = h * h;				// smoothing radius ^ 2
+	const float h3 = h2 * h;			// smoothing radius ^ 3
+	const float h6 = h2 * h2 * h2;
+	const float h9 = h6 * h3;
+	const float poly6_constant = 315.0f / (64.0f * XM_PI * h9);
+	const float spiky_constant = -45.0f / (XM_PI * h6);
+	const float K = emitter.SPH_K;		// pressure constant
+	const float p0 = emitter.SPH_p0;	// reference density
+	const float e = emitter.SPH_e;		// viscosity constant
+	const float h_rcp = 1.0f / h;
+
+	SortIntoGrid(h);
+
+	const uint32_t bucketMask = (uint32_t)cellOffsets.size() - 2;
+	const uint32_t blockCount = (aliveCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	wiJobSystem::context ctx;
+
+	// Compute density field:
+	wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * BLOCK_SIZE;
+		const uint32_t end = std::min(begin + BLOCK_SIZE, aliveCount);
+
+		const XMVECTOR H2 = XMVectorReplicate(h2);
+		const XMVECTOR POLY6 = XMVectorReplicate(poly6_constant);
+
+		uint32_t buckets[27];
+		uint32_t bucketCount = 0;
+		XMINT3 cell = XMINT3(INT_MAX, INT_MAX, INT_MAX);
+
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const float x = streams[POSITION_X][i];
+			const float y = streams[POSITION_Y][i];
+			const float z = streams[POSITION_Z][i];
+			const XMINT3 cellA = XMINT3((int)std::floor(x * h_rcp), (int)std::floor(y * h_rcp), (int)std::floor(z * h_rcp));
+			if (cellA.x != cell.x || cellA.y != cell.y || cellA.z != cell.z)
+			{
+				// The particles are sorted by cell, so consecutive particles mostly have the same neighbors:
+				cell = cellA;
+				bucketCount = GatherNeighborBuckets(cell.x, cell.y, cell.z, bucketMask, buckets);
+			}
+
+			const XMVECTOR XA = XMVectorReplicate(x);
+			const XMVECTOR YA = XMVectorReplicate(y);
+			const XMVECTOR ZA = XMVectorReplicate(z);
+			XMVECTOR density = XMVectorZero(); // (p)
+
+			for (uint32_t b = 0; b < bucketCount; ++b)
+			{
+				const uint32_t neighborEnd = cellOffsets[buckets[b] + 1];
+				for (uint32_t j = cellOffsets[buckets[b]]; j < neighborEnd; j += 4)
+				{
+					const XMVECTOR DX = XMVectorSubtract(XA, LoadStream(streams[POSITION_X], j));
+					const XMVECTOR DY = XMVectorSubtract(YA, LoadStream(streams[POSITION_Y], j));
+					const XMVECTOR DZ = XMVectorSubtract(ZA, LoadStream(streams[POSITION_Z], j));
+					const XMVECTOR R2 = XMVectorMultiplyAdd(DX, DX, XMVectorMultiplyAdd(DY, DY, XMVectorMultiply(DZ, DZ))); // distance squared
+					const XMVECTOR mask = XMVectorAndInt(XMVectorLess(R2, H2), LaneMask(j, neighborEnd));
+
+					// poly6 smoothing kernel:
+					const XMVECTOR T = XMVectorSubtract(H2, R2);
+					const XMVECTOR W = XMVectorMultiply(POLY6, XMVectorMultiply(T, XMVectorMultiply(T, T)));
+					density = XMVectorAdd(density, XMVectorSelect(XMVectorZero(), XMVectorMultiply(LoadStream(streams[MASS], j), W), mask));
+				}
+			}
+
+			// Can't be lower than reference density to avoid negative pressure!
+			streams[DENSITY][i] = std::max(p0, HorizontalSum(density));
+		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	// Compute particle pressure forces:
+	wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * BLOCK_SIZE;
+		const uint32_t end = std::min(begin + BLOCK_SIZE, aliveCount);
+
+		const XMVECTOR H = XMVectorReplicate(h);
+		const XMVECTOR H2_rcp = XMVectorReplicate(1.0f / h2);
+		const XMVECTOR H3_2_rcp = XMVectorReplicate(1.0f / (2 * h3));
+		const XMVECTOR SPIKY = XMVectorReplicate(spiky_constant);
+		const XMVECTOR P0 = XMVectorReplicate(p0);
+		const XMVECTOR KV = XMVectorReplicate(K);
+		const XMVECTOR ONE = XMVectorSplatOne();
+		const XMVECTOR HALF = XMVectorReplicate(0.5f);
+
+		uint32_t buckets[27];
+		uint32_t bucketCount = 0;
+		XMINT3 cell = XMINT3(INT_MAX, INT_MAX, INT_MAX);
+
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const float x = streams[POSITION_X][i];
+			const float y = streams[POSITION_Y][i];
+			const float z = streams[POSITION_Z][i];
+			const XMINT3 cellA = XMINT3((int)std::floor(x * h_rcp), (int)std::floor(y * h_rcp), (int)std::floor(z * h_rcp));
+			if (cellA.x != cell.x || cellA.y != cell.y || cellA.z != cell.z)
+			{
+				cell = cellA;
+				bucketCount = GatherNeighborBuckets(cell.x, cell.y, cell.z, bucketMask, buckets);
+			}
+
+			const float densityA = streams[DENSITY][i];
+			const float pressureA = K * (densityA - p0);
+			const XMVECTOR XA = XMVectorReplicate(x);
+			const XMVECTOR YA = XMVectorReplicate(y);
+			const XMVECTOR ZA = XMVectorReplicate(z);
+			const XMVECTOR VXA = XMVectorReplicate(streams[VELOCITY_X][i]);
+			const XMVECTOR VYA = XMVectorReplicate(streams[VELOCITY_Y][i]);
+			const XMVECTOR VZA = XMVectorReplicate(streams[VELOCITY_Z][i]);
+			const XMVECTOR MA_rcp = XMVectorReplicate(1.0f / streams[MASS][i]);
+			const XMVECTOR PA = XMVectorReplicate(pressureA);
+			const XMVECTOR DA = XMVectorReplicate(densityA);
+			const XMVECTOR IA = XMVectorReplicate((float)i);
+
+			// Compute acceleration:
+			XMVECTOR FAX = XMVectorZero(), FAY = XMVectorZero(), FAZ = XMVectorZero();		// pressure force
+			XMVECTOR FAVX = XMVectorZero(), FAVY = XMVectorZero(), FAVZ = XMVectorZero();	// viscosity force
+
+			for (uint32_t b = 0; b < bucketCount; ++b)
+			{
+				const uint32_t neighborEnd = cellOffsets[buckets[b] + 1];
+				for (uint32_t j = cellOffsets[buckets[b]]; j < neighborEnd; j += 4)
+				{
+					const XMVECTOR DX = XMVectorSubtract(XA, LoadStream(streams[POSITION_X], j));
+					const XMVECTOR DY = XMVectorSubtract(YA, LoadStream(streams[POSITION_Y], j));
+					const XMVECTOR DZ = XMVectorSubtract(ZA, LoadStream(streams[POSITION_Z], j));
+					const XMVECTOR R2 = XMVectorMultiplyAdd(DX, DX, XMVectorMultiplyAdd(DY, DY, XMVectorMultiply(DZ, DZ))); // distance squared
+					const XMVECTOR R = XMVectorSqrt(R2);
+
+					// avoid division by zero, and skip the particle itself:
+					XMVECTOR mask = XMVectorAndInt(XMVectorGreater(R, XMVectorZero()), XMVectorLess(R, H));
+					mask = XMVectorAndInt(mask, LaneMask(j, neighborEnd));
+					mask = XMVectorAndCInt(mask, XMVectorEqual(XMVectorAdd(XMVectorReplicate((float)j), XMVectorSet(0, 1, 2, 3)), IA));
+					if (XMVector4EqualInt(mask, XMVectorFalseInt()))
+					{
+						continue;
+					}
+					const XMVECTOR R_rcp = XMVectorReciprocal(XMVectorSelect(ONE, R, mask));
+
+					const XMVECTOR DB = XMVectorSelect(ONE, LoadStream(streams[DENSITY], j), mask);
+					const XMVECTOR PB = XMVectorMultiply(KV, XMVectorSubtract(DB, P0));
+					const XMVECTOR mass = XMVectorMultiply(LoadStream(streams[MASS], j), MA_rcp);
+
+					const XMVECTOR NX = XMVectorMultiply(DX, R_rcp);
+					const XMVECTOR NY = XMVectorMultiply(DY, R_rcp);
+					const XMVECTOR NZ = XMVectorMultiply(DZ, R_rcp);
+
+					// spiky kernel smoothing function:
+					const XMVECTOR HR = XMVectorSubtract(H, R);
+					XMVECTOR W = XMVectorMultiply(SPIKY, XMVectorMultiply(HR, HR));
+					XMVECTOR S = XMVectorMultiply(mass, XMVectorMultiply(XMVectorDivide(XMVectorAdd(PA, PB), XMVectorMultiply(XMVectorAdd(DA, DA), DB)), W));
+					S = XMVectorSelect(XMVectorZero(), S, mask);
+					FAX = XMVectorMultiplyAdd(S, NX, FAX);
+					FAY = XMVectorMultiplyAdd(S, NY, FAY);
+					FAZ = XMVectorMultiplyAdd(S, NZ, FAZ);
+
+					// laplacian smoothing function:
+					const XMVECTOR R3 = XMVectorMultiply(R2, R);
+					W = XMVectorSubtract(XMVectorAdd(XMVectorMultiply(R2, H2_rcp), XMVectorMultiply(XMVectorMultiply(H, HALF), R_rcp)), XMVectorAdd(XMVectorMultiply(R3, H3_2_rcp), ONE));
+					S = XMVectorMultiply(XMVectorMultiply(mass, XMVectorReciprocal(DB)), W);
+					S = XMVectorSelect(XMVectorZero(), S, mask);
+					FAVX = XMVectorMultiplyAdd(XMVectorMultiply(S, XMVectorSubtract(LoadStream(streams[VELOCITY_X], j), VXA)), NX, FAVX);
+					FAVY = XMVectorMultiplyAdd(XMVectorMultiply(S, XMVectorSubtract(LoadStream(streams[VELOCITY_Y], j), VYA)), NY, FAVY);
+					FAVZ = XMVectorMultiplyAdd(XMVectorMultiply(S, XMVectorSubtract(LoadStream(streams[VELOCITY_Z], j), VZA)), NZ, FAVZ);
+				}
+			}
+
+			// apply all forces with gravity:
+			const float densityA_rcp = 1.0f / densityA;
+			streams[FORCE_X][i] += (-HorizontalSum(FAX) + e * HorizontalSum(FAVX)) * densityA_rcp;
+			streams[FORCE_Y][i] += (-HorizontalSum(FAY) + e * HorizontalSum(FAVY)) * densityA_rcp - 9.8f * 2;
+			streams[FORCE_Z][i] += (-HorizontalSum(FAZ) + e * HorizontalSum(FAVZ)) * densityA_rcp;
+		}
+	});
+	wiJobSystem::Wait(ctx);
+}
+
+void wiEmittedParticleCPU::Simulate(const wiEmittedParticle& emitter, const Environment& environment, float dt)
+{
+	const bool sph = emitter.IsSPHEnabled();
+	const bool collisions = emitter.IsDepthCollisionEnabled() && environment.colliderCount > 0;
+	const uint32_t blockCount = (aliveCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	blockBounds.resize(blockCount);
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * BLOCK_SIZE;
+		const uint32_t end = std::min(begin + BLOCK_SIZE, aliveCount);
+
+		const XMVECTOR ZERO = XMVectorZero();
+		const XMVECTOR ONE = XMVectorSplatOne();
+		const XMVECTOR DT = XMVectorReplicate(dt);
+		const XMVECTOR FLTMAX = XMVectorReplicate(FLT_MAX);
+
+		// Force fields:
+		XMVECTOR blockMinX = FLTMAX, blockMinY = FLTMAX, blockMinZ = FLTMAX;
+		XMVECTOR blockMaxX = XMVectorNegate(FLTMAX), blockMaxY = XMVectorNegate(FLTMAX), blockMaxZ = XMVectorNegate(FLTMAX);
+		for (uint32_t i = begin; i < end; i += 4)
+		{
+			const XMVECTOR X = LoadStream(streams[POSITION_X], i);
+			const XMVECTOR Y = LoadStream(streams[POSITION_Y], i);
+			const XMVECTOR Z = LoadStream(streams[POSITION_Z], i);
+			XMVECTOR FX = LoadStream(streams[FORCE_X], i);
+			XMVECTOR FY = LoadStream(streams[FORCE_Y], i);
+			XMVECTOR FZ = LoadStream(streams[FORCE_Z], i);
+
+			for (uint32_t f = 0; f < environment.forceFieldCount; ++f)
+			{
+				const ForceField& forceField = environment.forceFields[f];
+				XMVECTOR DX, DY, DZ, dist;
+				if (forceField.planar)
+				{
+					DX = XMVectorReplicate(forceField.normal.x);
+					DY = XMVectorReplicate(forceField.normal.y);
+					DZ = XMVectorReplicate(forceField.normal.z);
+					dist = XMVectorMultiply(DX, XMVectorSubtract(XMVectorReplicate(forceField.position.x), X));
+					dist = XMVectorMultiplyAdd(DY, XMVectorSubtract(XMVectorReplicate(forceField.position.y), Y), dist);
+					dist = XMVectorMultiplyAdd(DZ, XMVectorSubtract(XMVectorReplicate(forceField.position.z), Z), dist);
+				}
+				else
+				{
+					DX = XMVectorSubtract(XMVectorReplicate(forceField.position.x), X);
+					DY = XMVectorSubtract(XMVectorReplicate(forceField.position.y), Y);
+					DZ = XMVectorSubtract(XMVectorReplicate(forceField.position.z), Z);
+					dist = XMVectorSqrt(XMVectorMultiplyAdd(DX, DX, XMVectorMultiplyAdd(DY, DY, XMVectorMultiply(DZ, DZ))));
+				}
+				const XMVECTOR S = XMVectorMultiply(XMVectorReplicate(forceField.gravity), XMVectorSubtract(ONE, XMVectorSaturate(XMVectorScale(dist, forceField.range_inverse))));
+				FX = XMVectorMultiplyAdd(DX, S, FX);
+				FY = XMVectorMultiplyAdd(DY, S, FY);
+				FZ = XMVectorMultiplyAdd(DZ, S, FZ);
+			}
+
+			StoreStream(streams[FORCE_X], i, FX);
+			StoreStream(streams[FORCE_Y], i, FY);
+			StoreStream(streams[FORCE_Z], i, FZ);
+
+			if (collisions)
+			{
+				const XMVECTOR size = XMVectorMax(LoadStream(streams[SIZE_BEGIN], i), LoadStream(streams[SIZE_END], i));
+				const XMVECTOR mask = LaneMask(i, end);
+				blockMinX = XMVectorSelect(blockMinX, XMVectorMin(blockMinX, XMVectorSubtract(X, size)), mask);
+				blockMinY = XMVectorSelect(blockMinY, XMVectorMin(blockMinY, XMVectorSubtract(Y, size)), mask);
+				blockMinZ = XMVectorSelect(blockMinZ, XMVectorMin(blockMinZ, XMVectorSubtract(Z, size)), mask);
+				blockMaxX = XMVectorSelect(blockMaxX, XMVectorMax(blockMaxX, XMVectorAdd(X, size)), mask);
+				blockMaxY = XMVectorSelect(blockMaxY, XMVectorMax(blockMaxY, XMVectorAdd(Y, size)), mask);
+				blockMaxZ = XMVectorSelect(blockMaxZ, XMVectorMax(blockMaxZ, XMVectorAdd(Z, size)), mask);
+			}
+		}
+
+		// Collisions with the bounding boxes, only the boxes that are near the block are checked:
+		if (collisions)
+		{
+			const AABB block = ReduceBounds(blockMinX, blockMinY, blockMinZ, blockMaxX, blockMaxY, blockMaxZ);
+
+			const XMVECTOR restitution = XMVectorReplicate(0.98f);
+			for (uint32_t c = 0; c < environment.colliderCount; ++c)
+			{
+				const AABB& box = environment.colliders[c];
+				if (block.intersects(box) == AABB::OUTSIDE)
+				{
+					continue;
+				}
+				const XMFLOAT3 center = box.getCenter();
+				const XMFLOAT3 halfWidth = box.getHalfWidth();
+				const XMVECTOR minX = XMVectorReplicate(box._min.x), maxX = XMVectorReplicate(box._max.x);
+				const XMVECTOR minY = XMVectorReplicate(box._min.y), maxY = XMVectorReplicate(box._max.y);
+				const XMVECTOR minZ = XMVectorReplicate(box._min.z), maxZ = XMVectorReplicate(box._max.z);
+				const XMVECTOR CX = XMVectorReplicate(center.x), CY = XMVectorReplicate(center.y), CZ = XMVectorReplicate(center.z);
+				const XMVECTOR SX = XMVectorReplicate(1.0f / std::max(0.0001f, halfWidth.x));
+				const XMVECTOR SY = XMVectorReplicate(1.0f / std::max(0.0001f, halfWidth.y));
+				const XMVECTOR SZ = XMVectorReplicate(1.0f / std::max(0.0001f, halfWidth.z));
+
+				for (uint32_t i = begin; i < end; i += 4)
+				{
+					const XMVECTOR X = LoadStream(streams[POSITION_X], i);
+					const XMVECTOR Y = LoadStream(streams[POSITION_Y], i);
+					const XMVECTOR Z = LoadStream(streams[POSITION_Z], i);
+
+					const XMVECTOR lifeLerp = XMVectorSubtract(ONE, XMVectorDivide(LoadStream(streams[LIFE], i), LoadStream(streams[MAXLIFE], i)));
+					const XMVECTOR particleSize = XMVectorLerpV(LoadStream(streams[SIZE_BEGIN], i), LoadStream(streams[SIZE_END], i), lifeLerp);
+
+					// check if the particle sphere intersects the box:
+					const XMVECTOR DX = XMVectorSubtract(X, XMVectorClamp(X, minX, maxX));
+					const XMVECTOR DY = XMVectorSubtract(Y, XMVectorClamp(Y, minY, maxY));
+					const XMVECTOR DZ = XMVectorSubtract(Z, XMVectorClamp(Z, minZ, maxZ));
+					const XMVECTOR dist2 = XMVectorMultiplyAdd(DX, DX, XMVectorMultiplyAdd(DY, DY, XMVectorMultiply(DZ, DZ)));
+					const XMVECTOR hit = XMVectorLess(dist2, XMVectorMultiply(particleSize, particleSize));
+					if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+					{
+						continue;
+					}
+
+					// The surface normal is the dominant axis of the particle position relative to the box:
+					const XMVECTOR QX = XMVectorMultiply(XMVectorSubtract(X, CX), SX);
+					const XMVECTOR QY = XMVectorMultiply(XMVectorSubtract(Y, CY), SY);
+					const XMVECTOR QZ = XMVectorMultiply(XMVectorSubtract(Z, CZ), SZ);
+					const XMVECTOR AX = XMVectorAbs(QX);
+					const XMVECTOR AY = XMVectorAbs(QY);
+					const XMVECTOR AZ = XMVectorAbs(QZ);
+					const XMVECTOR axisX = XMVectorAndInt(XMVectorGreaterOrEqual(AX, AY), XMVectorGreaterOrEqual(AX, AZ));
+					const XMVECTOR axisY = XMVectorAndCInt(XMVectorGreaterOrEqual(AY, AZ), axisX);
+					const XMVECTOR axisZ = XMVectorAndCInt(XMVectorAndCInt(XMVectorTrueInt(), axisX), axisY);
+					const XMVECTOR NX = XMVectorSelect(ZERO, XMVectorSelect(XMVectorNegate(ONE), ONE, XMVectorGreaterOrEqual(QX, ZERO)), axisX);
+					const XMVECTOR NY = XMVectorSelect(ZERO, XMVectorSelect(XMVectorNegate(ONE), ONE, XMVectorGreaterOrEqual(QY, ZERO)), axisY);
+					const XMVECTOR NZ = XMVectorSelect(ZERO, XMVectorSelect(XMVectorNegate(ONE), ONE, XMVectorGreaterOrEqual(QZ, ZERO)), axisZ);
+
+					// bounce off the particle if it moves into the surface:
+					XMVECTOR VX = LoadStream(streams[VELOCITY_X], i);
+					XMVECTOR VY = LoadStream(streams[VELOCITY_Y], i);
+					XMVECTOR VZ = LoadStream(streams[VELOCITY_Z], i);
+					const XMVECTOR VN = XMVectorMultiplyAdd(VX, NX, XMVectorMultiplyAdd(VY, NY, XMVectorMultiply(VZ, NZ)));
+					const XMVECTOR bounce = XMVectorAndInt(hit, XMVectorLess(VN, ZERO));
+					const XMVECTOR VN2 = XMVectorAdd(VN, VN);
+					VX = XMVectorSelect(VX, XMVectorMultiply(XMVectorNegativeMultiplySubtract(VN2, NX, VX), restitution), bounce);
+					VY = XMVectorSelect(VY, XMVectorMultiply(XMVectorNegativeMultiplySubtract(VN2, NY, VY), restitution), bounce);
+					VZ = XMVectorSelect(VZ, XMVectorMultiply(XMVectorNegativeMultiplySubtract(VN2, NZ, VZ), restitution), bounce);
+					StoreStream(streams[VELOCITY_X], i, VX);
+					StoreStream(streams[VELOCITY_Y], i, VY);
+					StoreStream(streams[VELOCITY_Z], i, VZ);
+				}
+			}
+		}
+
+		// Integrate:
+		XMVECTOR boundsMinX = FLTMAX, boundsMinY = FLTMAX, boundsMinZ = FLTMAX;
+		XMVECTOR boundsMaxX = XMVectorNegate(FLTMAX), boundsMaxY = XMVectorNegate(FLTMAX), boundsMaxZ = XMVectorNegate(FLTMAX);
+		const XMVECTOR drag = XMVectorReplicate(0.98f);
+		const XMVECTOR elastic = XMVectorReplicate(-0.6f);
+		const XMVECTOR extentX = XMVectorReplicate(40);
+		const XMVECTOR extentZ = XMVectorReplicate(22);
+		for (uint32_t i = begin; i < end; i += 4)
+		{
+			XMVECTOR X = LoadStream(streams[POSITION_X], i);
+			XMVECTOR Y = LoadStream(streams[POSITION_Y], i);
+			XMVECTOR Z = LoadStream(streams[POSITION_Z], i);
+			XMVECTOR VX = LoadStream(streams[VELOCITY_X], i);
+			XMVECTOR VY = LoadStream(streams[VELOCITY_Y], i);
+			XMVECTOR VZ = LoadStream(streams[VELOCITY_Z], i);
+			const XMVECTOR life = LoadStream(streams[LIFE], i);
+
+			VX = XMVectorMultiplyAdd(LoadStream(streams[FORCE_X], i), DT, VX);
+			VY = XMVectorMultiplyAdd(LoadStream(streams[FORCE_Y], i), DT, VY);
+			VZ = XMVectorMultiplyAdd(LoadStream(streams[FORCE_Z], i), DT, VZ);
+			X = XMVectorMultiplyAdd(VX, DT, X);
+			Y = XMVectorMultiplyAdd(VY, DT, Y);
+			Z = XMVectorMultiplyAdd(VZ, DT, Z);
+
+			// reset force for next frame:
+			StoreStream(streams[FORCE_X], i, ZERO);
+			StoreStream(streams[FORCE_Y], i, ZERO);
+			StoreStream(streams[FORCE_Z], i, ZERO);
+
+			const XMVECTOR lifeLerp = XMVectorSubtract(ONE, XMVectorDivide(life, LoadStream(streams[MAXLIFE], i)));
+			const XMVECTOR particleSize = XMVectorLerpV(LoadStream(streams[SIZE_BEGIN], i), LoadStream(streams[SIZE_END], i), lifeLerp);
+
+			if (sph)
+			{
+				// drag:
+				VX = XMVectorMultiply(VX, drag);
+				VY = XMVectorMultiply(VY, drag);
+				VZ = XMVectorMultiply(VZ, drag);
+
+				// floor collision:
+				XMVECTOR collide = XMVectorLess(XMVectorSubtract(Y, particleSize), ZERO);
+				Y = XMVectorSelect(Y, particleSize, collide);
+				VY = XMVectorSelect(VY, XMVectorMultiply(VY, elastic), collide);
+
+				// box collision:
+				collide = XMVectorGreater(XMVectorAdd(X, particleSize), extentX);
+				X = XMVectorSelect(X, XMVectorSubtract(extentX, particleSize), collide);
+				VX = XMVectorSelect(VX, XMVectorMultiply(VX, elastic), collide);
+				collide = XMVectorLess(XMVectorSubtract(X, particleSize), XMVectorNegate(extentX));
+				X = XMVectorSelect(X, XMVectorSubtract(particleSize, extentX), collide);
+				VX = XMVectorSelect(VX, XMVectorMultiply(VX, elastic), collide);
+				collide = XMVectorGreater(XMVectorAdd(Z, particleSize), extentZ);
+				Z = XMVectorSelect(Z, XMVectorSubtract(extentZ, particleSize), collide);
+				VZ = XMVectorSelect(VZ, XMVectorMultiply(VZ, elastic), collide);
+				collide = XMVectorLess(XMVectorSubtract(Z, particleSize), XMVectorNegate(extentZ));
+				Z = XMVectorSelect(Z, XMVectorSubtract(particleSize, extentZ), collide);
+				VZ = XMVectorSelect(VZ, XMVectorMultiply(VZ, elastic), collide);
+			}
+
+			StoreStream(streams[POSITION_X], i, X);
+			StoreStream(streams[POSITION_Y], i, Y);
+			StoreStream(streams[POSITION_Z], i, Z);
+			StoreStream(streams[VELOCITY_X], i, VX);
+			StoreStream(streams[VELOCITY_Y], i, VY);
+			StoreStream(streams[VELOCITY_Z], i, VZ);
+			StoreStream(streams[LIFE], i, XMVectorSubtract(life, DT));
+
+			const XMVECTOR mask = LaneMask(i, end);
+			boundsMinX = XMVectorSelect(boundsMinX, XMVectorMin(boundsMinX, XMVectorSubtract(X, particleSize)), mask);
+			boundsMinY = XMVectorSelect(boundsMinY, XMVectorMin(boundsMinY, XMVectorSubtract(Y, particleSize)), mask);
+			boundsMinZ = XMVectorSelect(boundsMinZ, XMVectorMin(boundsMinZ, XMVectorSubtract(Z, particleSize)), mask);
+			boundsMaxX = XMVectorSelect(boundsMaxX, XMVectorMax(boundsMaxX, XMVectorAdd(X, particleSize)), mask);
+			boundsMaxY = XMVectorSelect(boundsMaxY, XMVectorMax(boundsMaxY, XMVectorAdd(Y, particleSize)), mask);
+			boundsMaxZ = XMVectorSelect(boundsMaxZ, XMVectorMax(boundsMaxZ, XMVectorAdd(Z, particleSize)), mask);
+		}
+
+		blockBounds[args.jobIndex] = ReduceBounds(boundsMinX, boundsMinY, boundsMinZ, boundsMaxX, boundsMaxY, boundsMaxZ);
+	});
+	wiJobSystem::Wait(ctx);
+
+	bounds = AABB();
+	for (auto& block : blockBounds)
+	{
+		bounds = AABB::Merge(bounds, block);
+	}
+}
+
+uint32_t wiEmittedParticleCPU::Update(const wiEmittedParticle& emitter, const XMFLOAT4X4& world, const MeshComponent* mesh, const Environment& environment, uint32_t emitCount, float dt)
+{
+	// simulation can be either fixed or variable timestep:
+	dt = emitter.FIXED_TIMESTEP >= 0 ? emitter.FIXED_TIMESTEP : dt;
+
+	RemoveDeadParticles();
+
+	emitCount = Emit(emitter, world, mesh, emitCount);
+
+	if (emitter.IsSPHEnabled() && aliveCount > 0)
+	{
+		SimulateSPH(emitter);
+	}
+
+	Simulate(emitter, environment, dt);
+
+	return emitCount;
+}
+
+Particle wiEmittedParticleCPU::GetParticle(uint32_t index) const
+{
+	Particle particle;
+	particle.position = XMFLOAT3(streams[POSITION_X][index], streams[POSITION_Y][index], streams[POSITION_Z][index]);
+	particle.mass = streams[MASS][index];
+	particle.force = XMFLOAT3(streams[FORCE_X][index], streams[FORCE_Y][index], streams[FORCE_Z][index]);
+	particle.rotationalVelocity = streams[ROTATIONAL_VELOCITY][index];
+	particle.velocity = XMFLOAT3(streams[VELOCITY_X][index], streams[VELOCITY_Y][index], streams[VELOCITY_Z][index]);
+	particle.maxLife = streams[MAXLIFE][index];
+	particle.sizeBeginEnd = XMFLOAT2(streams[SIZE_BEGIN][index], streams[SIZE_END][index]);
+	particle.life = streams[LIFE][index];
+	particle.color_mirror = 0;
+	return particle;
+}
+
+void wiEmittedParticleCPU::WriteParticles(Particle* dest, uint32_t color) const
+{
+	for (uint32_t i = 0; i < aliveCount; ++i)
+	{
+		dest[i] = GetParticle(i);
+		dest[i].color_mirror = color & 0x00FFFFFF;
+	}
+}
+
+}
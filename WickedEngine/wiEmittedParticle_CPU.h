@@ -0,0 +1,107 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiIntersect.h"
+#include "wiScene_Decl.h"
+#include "ShaderInterop_EmittedParticle.h"
+
+#include <vector>
+
+namespace wiScene
+{
+
+class wiEmittedParticle;
+
+// CPU simulation backend of wiEmittedParticle, it doesn't need a graphics device
+//	It implements the emission and simulation model of the emittedparticle compute shaders (force fields, collisions, SPH with a hashed grid).
+//	The particles are stored as a structure of arrays and they are processed four at a time with DirectXMath vectors, in wiJobSystem jobs.
+//	The depth buffer collision of the GPU simulation is replaced by collision with a list of bounding boxes (for example the object AABBs of the scene).
+class wiEmittedParticleCPU
+{
+public:
+	struct ForceField
+	{
+		bool planar = false;					// point force fields pull towards the position, planar ones along the normal
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 normal = XMFLOAT3(0, -1, 0);
+		float gravity = 0;						// negative = deflector, positive = attractor
+		float range_inverse = 0;				// 1 / range, 0 means that the force doesn't fall off
+	};
+	struct Environment
+	{
+		const ForceField* forceFields = nullptr;
+		uint32_t forceFieldCount = 0;
+		const AABB* colliders = nullptr;		// used when the depth collision of the emitter is enabled
+		uint32_t colliderCount = 0;
+	};
+
+private:
+	enum STREAM
+	{
+		POSITION_X,
+		POSITION_Y,
+		POSITION_Z,
+		VELOCITY_X,
+		VELOCITY_Y,
+		VELOCITY_Z,
+		FORCE_X,
+		FORCE_Y,
+		FORCE_Z,
+		MASS,
+		LIFE,
+		MAXLIFE,
+		SIZE_BEGIN,
+		SIZE_END,
+		ROTATIONAL_VELOCITY,
+		DENSITY,
+		STREAM_COUNT
+	};
+	std::vector<float> streams[STREAM_COUNT];	// the arrays are padded to a multiple of 4, so the last vector can be loaded whole
+	uint32_t maxCount = 0;
+	uint32_t aliveCount = 0;
+	uint32_t randomState = 0;
+	AABB bounds;
+
+	// SPH grid:
+	std::vector<uint32_t> cellHashes;	// bucket of every particle
+	std::vector<uint32_t> cellOffsets;	// first particle of every bucket, the particles are sorted by bucket
+	std::vector<uint32_t> order;
+	std::vector<float> reorderTemp;
+	std::vector<AABB> blockBounds;
+
+	float Random();
+	void RemoveDeadParticles();
+	uint32_t Emit(const wiEmittedParticle& emitter, const XMFLOAT4X4& world, const MeshComponent* mesh, uint32_t emitCount);
+	void SortIntoGrid(float h);
+	void SimulateSPH(const wiEmittedParticle& emitter);
+	void Simulate(const wiEmittedParticle& emitter, const Environment& environment, float dt);
+
+public:
+	// Remove every particle and allocate storage for at most maxCount particles
+	void Initialize(uint32_t maxCount);
+	// Seed of the random numbers of the emission, the simulation is deterministic for the same seed and inputs
+	void SetSeed(uint32_t seed) { randomState = seed; }
+
+	// Emit and simulate one frame in the same order as wiEmittedParticle::UpdateGPU()
+	//	emitter		: the emission and simulation parameters are read from it
+	//	world		: world matrix of the emitter
+	//	mesh		: if not nullptr, the particles are emitted from the surface of the mesh (CPU side positions, normals and indices)
+	//	emitCount	: number of new particles, it is limited by the free space
+	//	dt			: frame time, it is overridden by the fixed timestep of the emitter
+	//	returns the number of emitted particles
+	uint32_t Update(const wiEmittedParticle& emitter, const XMFLOAT4X4& world, const MeshComponent* mesh, const Environment& environment, uint32_t emitCount, float dt);
+
+	uint32_t GetMaxCount() const { return maxCount; }
+	uint32_t GetAliveCount() const { return aliveCount; }
+	// Bounding box of the alive particles with their sizes after the last update
+	const AABB& GetBounds() const { return bounds; }
+	size_t GetMemorySizeInBytes() const;
+
+	// Particle in the GPU layout, index < GetAliveCount(). The order of the particles changes with every update.
+	Particle GetParticle(uint32_t index) const;
+	// SPH density of a particle from the last update
+	float GetDensity(uint32_t index) const { return streams[DENSITY][index]; }
+	// Write the alive particles in the GPU layout, with the color of the emitter
+	void WriteParticles(Particle* dest, uint32_t color) const;
+};
+
+}
@@ -74,6 +74,8 @@ enum CBTYPES
 	CBTYPE_FORWARDENTITYMASK,
 	CBTYPE_POSTPROCESS,
 	CBTYPE_LENSFLARE,
+	CBTYPE_VERTEXSTREAM,
+	CBTYPE_SKINNING,
 	CBTYPE_COUNT
 };
 
@@ -83,6 +85,7 @@ enum RBTYPES
 	RBTYPE_ENTITYARRAY,
 	RBTYPE_ENTITYTILES_OPAQUE,
 	RBTYPE_ENTITYTILES_TRANSPARENT,
+	RBTYPE_ENTITYCLUSTERS,
 	RBTYPE_VOXELSCENE,
 	RBTYPE_MATRIXARRAY,
 	RBTYPE_COUNT
@@ -334,7 +337,6 @@ enum CSTYPES
 // vertex layouts
 enum VLTYPES
 {
-	VLTYPE_OBJECT_DEBUG,
 	VLTYPE_OBJECT_POS,
 	VLTYPE_OBJECT_POS_TEX,
 	VLTYPE_OBJECT_ALL,
@@ -0,0 +1,146 @@
+#include "wiFrameGovernor.h"
+
+void wiFrameGovernor::AddLevel(const std::string& name, const std::function<bool()>& reduce, const std::function<void()>& restore)
+{
+	Level x;
+	x.name = name;
+	x.reduce = reduce;
+	x.restore = restore;
+	levels.push_back(x);
+}
+
+void wiFrameGovernor::ClearLevels()
+{
+	RestoreLevels();
+	levels.clear();
+}
+
+void wiFrameGovernor::RestoreLevels()
+{
+	if (level > 0 && onChange)
+	{
+		onChange();
+	}
+	while (level > 0)
+	{
+		Level& x = levels[--level];
+		if (x.reduced)
+		{
+			x.restore();
+			x.reduced = false;
+		}
+	}
+
+	sum = 0;
+	count = 0;
+	reducedLastWindow = false;
+}
+
+void wiFrameGovernor::SetBudget(double milliseconds)
+{
+	budget = milliseconds;
+	if (budget <= 0)
+	{
+		RestoreLevels();
+	}
+	sum = 0;
+	count = 0;
+	reducedLastWindow = false;
+}
+
+void wiFrameGovernor::Reduce()
+{
+	if (onChange)
+	{
+		onChange();
+	}
+
+	// The levels that have nothing to reduce are passed, until one reduces something:
+	while (level < levels.size())
+	{
+		Level& x = levels[level++];
+		x.reduced = x.reduce();
+		if (x.reduced)
+		{
+			x.savedTime = -1;
+			return;
+		}
+	}
+
+	// Nothing was reduced, the passed levels are tried again in the next window:
+	while (level > 0 && !levels[level - 1].reduced)
+	{
+		level--;
+	}
+}
+
+void wiFrameGovernor::Restore()
+{
+	if (onChange)
+	{
+		onChange();
+	}
+
+	// Restore the last level that reduced something, then the level stops after the previous one that did:
+	while (level > 0)
+	{
+		Level& x = levels[--level];
+		if (x.reduced)
+		{
+			x.restore();
+			x.reduced = false;
+			break;
+		}
+	}
+	while (level > 0 && !levels[level - 1].reduced)
+	{
+		level--;
+	}
+}
+
+bool wiFrameGovernor::Update(double workTime)
+{
+	if (budget <= 0)
+	{
+		return false;
+	}
+
+	sum += workTime;
+	count++;
+	if (count < window)
+	{
+		return false;
+	}
+
+	const double previous = average;
+	average = sum / count;
+	sum = 0;
+	count = 0;
+
+	if (reducedLastWindow)
+	{
+		// This window ran with the level that was reduced at the end of the previous window:
+		levels[level - 1].savedTime = std::max(0.0, previous - average);
+	}
+	reducedLastWindow = false;
+
+	if (average > budget * reduceThreshold && level < levels.size())
+	{
+		const size_t before = level;
+		Reduce();
+		reducedLastWindow = level > before;
+		return reducedLastWindow;
+	}
+
+	if (level > 0)
+	{
+		const Level& last = levels[level - 1];
+		if (last.savedTime >= 0 && average + last.savedTime <= budget * restoreThreshold)
+		{
+			Restore();
+			return true;
+		}
+	}
+
+	return false;
+}
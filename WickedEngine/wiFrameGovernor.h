@@ -0,0 +1,70 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+// Keeps the CPU work of the frames in a time budget by reducing optional work
+//	The levels are the optional work in the order they are reduced: level 0 is full quality, reducing calls the reduce function of the next
+//	level, restoring calls the restore function of the last reduced level. A reduce function returns false if there was nothing to reduce
+//	(for example the feature is already disabled), then the governor continues with the next level at once.
+//	The work times are averaged over windows of frames, and the level changes at most once per window, so every window measures one level:
+//		reduce	: the average is over budget * reduceThreshold
+//		restore	: the average plus the time that reducing the last level saved (measured in the window after it) is under budget * restoreThreshold
+class wiFrameGovernor
+{
+private:
+	struct Level
+	{
+		std::string name;
+		std::function<bool()> reduce;
+		std::function<void()> restore;
+		bool reduced = false;	// the reduce function did reduce something
+		double savedTime = -1;	// work time saved by reducing, < 0 until it is measured
+	};
+	std::vector<Level> levels;
+	size_t level = 0;
+	double budget = 0;
+	double reduceThreshold = 1.0;
+	double restoreThreshold = 0.85;
+	uint32_t window = 30;
+
+	double sum = 0;
+	uint32_t count = 0;
+	double average = 0;
+	bool reducedLastWindow = false;
+
+	void Reduce();
+	void Restore();
+
+public:
+	// Called before a level is reduced or restored, for example to synchronize with a render thread that reads the state that the level modifies
+	std::function<void()> onChange;
+
+	// Add optional work as the next level. The functions are called from Update(), RestoreLevels() and ClearLevels()
+	void AddLevel(const std::string& name, const std::function<bool()>& reduce, const std::function<void()>& restore);
+	// Restore every reduced level and remove the levels
+	void ClearLevels();
+	// Restore every reduced level
+	void RestoreLevels();
+
+	// Set the budget of the work time of a frame in milliseconds (default = 0, the governor is disabled and restores every level)
+	void SetBudget(double milliseconds);
+	double GetBudget() const { return budget; }
+	// Set the fractions of the budget that reduce and restore the levels (default = 1.0, 0.85)
+	void SetThresholds(double reduce, double restore) { reduceThreshold = reduce; restoreThreshold = restore; }
+	// Set the number of frames that are averaged before the level can change (default = 30)
+	void SetWindow(uint32_t frames) { window = std::max(1u, frames); }
+
+	// Call it once per frame with the work time of the frame in milliseconds, returns true if the level changed
+	bool Update(double workTime);
+
+	// The number of reduced levels, 0 is full quality
+	size_t GetLevel() const { return level; }
+	size_t GetLevelCount() const { return levels.size(); }
+	const std::string& GetLevelName(size_t index) const { return levels[index].name; }
+	// The average work time of the last window
+	double GetAverageWorkTime() const { return average; }
+};
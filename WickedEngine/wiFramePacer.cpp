@@ -0,0 +1,95 @@
+#include "wiFramePacer.h"
+#include "wiHelper.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wiFramePacer_Internal
+{
+	// Weight of the last frame in the moving averages
+	static const double AVERAGE_WEIGHT = 0.1;
+	// The oversleep estimate jumps to a longer oversleep immediately, but returns to shorter ones slowly
+	static const double OVERSLEEP_RECOVERY = 0.05;
+}
+using namespace wiFramePacer_Internal;
+
+wiFramePacer::wiFramePacer()
+{
+	frameBegin = wiTimer::TotalTime();
+	deadline = frameBegin;
+}
+
+void wiFramePacer::SetTargetFrameTime(double milliseconds)
+{
+	targetTime = std::max(0.0, milliseconds);
+
+	// The deadlines restart from the current frame:
+	deadline = frameBegin;
+}
+
+void wiFramePacer::Wait()
+{
+	const double workEnd = wiTimer::TotalTime();
+	double sleepTime = 0;
+	double spinTime = 0;
+
+	if (targetTime > 0)
+	{
+		deadline += targetTime;
+		if (deadline < workEnd)
+		{
+			deadline = workEnd;
+			statistics.missedFrames++;
+		}
+
+		while (true)
+		{
+			const double now = wiTimer::TotalTime();
+			const double sleep = std::floor(deadline - now - spinThreshold - oversleep);
+			if (sleep < 1)
+			{
+				break;
+			}
+			wiHelper::Sleep(float(sleep));
+			const double slept = wiTimer::TotalTime() - now;
+			sleepTime += slept;
+
+			const double measured = std::max(0.0, slept - sleep);
+			oversleep = measured > oversleep ? measured : oversleep + (measured - oversleep) * OVERSLEEP_RECOVERY;
+		}
+
+		const double spinBegin = wiTimer::TotalTime();
+		if (spinBegin < deadline)
+		{
+			wiHelper::Spin(float(deadline - spinBegin));
+		}
+		spinTime = wiTimer::TotalTime() - spinBegin;
+	}
+
+	const double frameEnd = wiTimer::TotalTime();
+	if (targetTime <= 0)
+	{
+		deadline = frameEnd;
+	}
+
+	statistics.targetTime = targetTime;
+	statistics.workTime = std::max(0.0, workEnd - frameBegin - idleTime);
+	statistics.sleepTime = sleepTime;
+	statistics.spinTime = spinTime;
+	statistics.frameTime = frameEnd - frameBegin;
+	statistics.error = targetTime > 0 ? statistics.frameTime - targetTime : 0;
+	if (statistics.frame == 0)
+	{
+		statistics.averageWorkTime = statistics.workTime;
+		statistics.averageFrameTime = statistics.frameTime;
+	}
+	else
+	{
+		statistics.averageWorkTime += (statistics.workTime - statistics.averageWorkTime) * AVERAGE_WEIGHT;
+		statistics.averageFrameTime += (statistics.frameTime - statistics.averageFrameTime) * AVERAGE_WEIGHT;
+	}
+	statistics.frame++;
+
+	frameBegin = frameEnd;
+	idleTime = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiTimer.h"
+
+// Shapes the frames to a target frame time, by waiting at the end of every frame until the deadline of the frame
+//	The wait sleeps while the remaining time is longer than the spin threshold plus how much the sleeps of the OS overshoot (measured),
+//	then spins until the deadline. The thread gives up the CPU core for most of the wait, but the frame still ends close to the deadline.
+//	The deadlines follow each other by the target frame time, so the frame rate doesn't drift. A frame that misses its deadline doesn't wait,
+//	and the deadlines restart from it instead of hurrying the next frames to catch up.
+//	When the OS sleep granularity is coarse (for example 15.6 ms by default on Windows), the measured oversleep is large and the wait spins more.
+class wiFramePacer
+{
+public:
+	// Milliseconds
+	struct Statistics
+	{
+		uint64_t frame = 0;				// frames that completed Wait()
+		double targetTime = 0;			// target frame time, 0 if the frame rate is not limited
+		double workTime = 0;			// the frame without the wait and the idle time (AddIdleTime())
+		double sleepTime = 0;
+		double spinTime = 0;
+		double frameTime = 0;			// actual frame time, between the ends of two Wait()
+		double error = 0;				// frameTime - targetTime
+		double averageWorkTime = 0;		// exponential moving averages
+		double averageFrameTime = 0;
+		uint64_t missedFrames = 0;		// frames whose work took longer than the target frame time
+	};
+
+private:
+	double targetTime = 0;
+	double spinThreshold = 1;
+	double oversleep = 1;	// estimate of how much longer a sleep takes than requested
+	double frameBegin = 0;
+	double deadline = 0;
+	double idleTime = 0;
+	Statistics statistics;
+	wiTimer timer;	// the timestamps are wiTimer::TotalTime()
+
+public:
+	wiFramePacer();
+
+	// Set the target frame time in milliseconds (default = 0, the frame rate is not limited)
+	void SetTargetFrameTime(double milliseconds);
+	double GetTargetFrameTime() const { return targetTime; }
+	// Set the target frame time as frames per second (0: the frame rate is not limited)
+	void SetTargetFrameRate(float fps) { SetTargetFrameTime(fps > 0 ? 1000.0 / fps : 0); }
+	float GetTargetFrameRate() const { return targetTime > 0 ? float(1000.0 / targetTime) : 0; }
+	// The last part of the wait that always spins, in milliseconds (default = 1)
+	void SetSpinThreshold(double milliseconds) { spinThreshold = milliseconds; }
+	double GetSpinThreshold() const { return spinThreshold; }
+
+	// Time in the frame that the thread was blocked instead of working (for example in the present, waiting for the vertical blank)
+	//	It is not counted in the work time of the frame
+	void AddIdleTime(double milliseconds) { idleTime += milliseconds; }
+
+	// End of the frame: waits until the deadline of the frame, the next frame begins when it returns
+	void Wait();
+
+	const Statistics& GetStatistics() const { return statistics; }
+};
@@ -0,0 +1,155 @@
+#include "wiFramePipeline.h"
+
+wiFramePipeline::~wiFramePipeline()
+{
+	SetEnabled(false);
+}
+
+void wiFramePipeline::SetRenderCallback(const RenderCallback& callback)
+{
+	// The render thread only reads the callback after a submission, which happens after this
+	Sync();
+	render = callback;
+}
+
+void wiFramePipeline::SetEnabled(bool value)
+{
+	if (value == enabled)
+	{
+		return;
+	}
+
+	if (value)
+	{
+		exiting = false;
+		thread = std::thread([this] { RenderThread(); });
+	}
+	else
+	{
+		// The render thread exits after it rendered every submitted frame:
+		{
+			std::lock_guard<std::mutex> lock(locker);
+			exiting = true;
+		}
+		submittedCondition.notify_one();
+		thread.join();
+	}
+	enabled = value;
+}
+
+void wiFramePipeline::RenderThread()
+{
+	while (true)
+	{
+		uint64_t frame;
+		{
+			std::unique_lock<std::mutex> lock(locker);
+			submittedCondition.wait(lock, [this] { return exiting || rendered < submitted; });
+			if (rendered == submitted)
+			{
+				break;
+			}
+			frame = rendered;
+		}
+
+		const uint32_t buffer = uint32_t(frame % BUFFER_COUNT);
+		const double renderBegin = wiTimer::TotalTime();
+		if (render)
+		{
+			render(frame, buffer);
+		}
+		const double renderEnd = wiTimer::TotalTime();
+
+		{
+			std::lock_guard<std::mutex> lock(locker);
+			rendered++;
+			statistics.frame = frame;
+			statistics.renderTime = renderEnd - renderBegin;
+			statistics.latency = renderEnd - beginTimes[buffer];
+		}
+		renderedCondition.notify_all();
+	}
+}
+
+double wiFramePipeline::WaitInFlight(uint64_t maxInFlight)
+{
+	const double begin = wiTimer::TotalTime();
+	std::unique_lock<std::mutex> lock(locker);
+	renderedCondition.wait(lock, [&] { return submitted - rendered <= maxInFlight; });
+	return wiTimer::TotalTime() - begin;
+}
+
+void wiFramePipeline::BeginFrame()
+{
+	frameBegin = wiTimer::TotalTime();
+	frameWait = 0;
+
+	if (enabled && pacing == PACING_LATENCY)
+	{
+		frameWait += WaitInFlight(1);
+	}
+}
+
+void wiFramePipeline::Submit(const CaptureCallback& capture)
+{
+	const double updateEnd = wiTimer::TotalTime();
+
+	// The buffer of this frame was used BUFFER_COUNT frames ago, that frame must be rendered before it is overwritten:
+	double wait = 0;
+	if (enabled)
+	{
+		wait = WaitInFlight(BUFFER_COUNT - 1);
+	}
+
+	const uint64_t frame = submitted;
+	const uint32_t buffer = uint32_t(frame % BUFFER_COUNT);
+	const double captureBegin = wiTimer::TotalTime();
+	if (capture)
+	{
+		capture(buffer);
+	}
+	const double captureEnd = wiTimer::TotalTime();
+	beginTimes[buffer] = frameBegin;
+
+	{
+		std::lock_guard<std::mutex> lock(locker);
+		statistics.updateTime = updateEnd - frameBegin - frameWait;
+		statistics.waitTime = frameWait + wait;
+		statistics.captureTime = captureEnd - captureBegin;
+		submitted++;
+	}
+
+	if (enabled)
+	{
+		submittedCondition.notify_one();
+	}
+	else
+	{
+		// Serial: the frame is rendered before the update of the next frame
+		if (render)
+		{
+			render(frame, buffer);
+		}
+		const double renderEnd = wiTimer::TotalTime();
+
+		std::lock_guard<std::mutex> lock(locker);
+		rendered++;
+		statistics.frame = frame;
+		statistics.renderTime = renderEnd - captureEnd;
+		statistics.latency = renderEnd - frameBegin;
+	}
+}
+
+void wiFramePipeline::Sync()
+{
+	if (enabled)
+	{
+		frameWait += WaitInFlight(0);
+	}
+}
+
+wiFramePipeline::Statistics wiFramePipeline::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(locker);
+	return statistics;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiTimer.h"
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Overlaps the update stage of a frame with the render stage of the previous frame
+//	The update stage runs on the calling thread and ends with Submit(), which captures the render state of the frame into one of the
+//	BUFFER_COUNT buffers of the caller. The render thread renders the frames in order, while the calling thread continues with the update of the next frame.
+//	The render stage must only read its buffer and the state that the update stage doesn't modify, or the update stage must call Sync() before
+//	modifying the state that the render stage reads.
+//
+//	Synchronization points:
+//		BeginFrame()	: start of the update stage, waits according to the PACING
+//		Submit()		: end of the update stage, waits until a buffer is free, captures into it and hands it to the render thread
+//		Sync()			: waits until every submitted frame was rendered, after this the update stage can modify anything
+//
+//	When it is not enabled, Submit() renders the frame immediately on the calling thread.
+class wiFramePipeline
+{
+public:
+	enum PACING
+	{
+		PACING_LATENCY,		// the update of a frame waits until the render thread has at most one frame in flight, the input is at most one frame old when rendered
+		PACING_THROUGHPUT,	// the update of a frame doesn't wait, only the capture waits for a free buffer, the render thread can be two frames behind
+	};
+
+	// Milliseconds, of the last frame that completed the stage
+	struct Statistics
+	{
+		uint64_t frame = 0;		// the last rendered frame
+		double updateTime = 0;	// BeginFrame() -> Submit(), without the waits
+		double waitTime = 0;	// update stage blocked on the render thread
+		double captureTime = 0;
+		double renderTime = 0;
+		double latency = 0;		// BeginFrame() -> the frame is rendered
+	};
+
+	// The number of buffers that the caller needs for the render state, a frame uses the buffer frame % BUFFER_COUNT
+	static const uint32_t BUFFER_COUNT = 2;
+
+	// Copies the render state of the frame into the buffer, on the calling thread
+	typedef std::function<void(uint32_t buffer)> CaptureCallback;
+	// Renders the frame from the buffer that was captured for it
+	typedef std::function<void(uint64_t frame, uint32_t buffer)> RenderCallback;
+
+private:
+	double beginTimes[BUFFER_COUNT] = {};
+	RenderCallback render;
+	bool enabled = false;
+	PACING pacing = PACING_LATENCY;
+
+	std::thread thread;
+	std::mutex locker;
+	std::condition_variable submittedCondition;
+	std::condition_variable renderedCondition;
+	uint64_t submitted = 0;		// frames handed to the render thread
+	uint64_t rendered = 0;		// frames that the render thread finished
+	bool exiting = false;
+
+	Statistics statistics;
+	wiTimer timer;	// the timestamps are wiTimer::TotalTime()
+	double frameBegin = 0;
+	double frameWait = 0;
+
+	void RenderThread();
+	// Waits until the render thread has at most maxInFlight frames that are not rendered, returns the milliseconds that it waited
+	double WaitInFlight(uint64_t maxInFlight);
+
+public:
+	wiFramePipeline() = default;
+	~wiFramePipeline();
+
+	// The render stage, it is called in the order of the frames
+	void SetRenderCallback(const RenderCallback& callback);
+
+	// Start or stop the render thread, the submitted frames are rendered first
+	void SetEnabled(bool value);
+	bool IsEnabled() const { return enabled; }
+	void SetPacing(PACING value) { pacing = value; }
+	PACING GetPacing() const { return pacing; }
+
+	void BeginFrame();
+	void Submit(const CaptureCallback& capture);
+	void Sync();
+
+	uint64_t GetSubmittedFrameCount() const { return submitted; }
+	Statistics GetStatistics();
+};
@@ -33,14 +33,11 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene, CommandList cmd
 {
 	GraphicsDevice* device = wiRenderer::GetDevice();
 
-	using namespace wiRectPacker;
-
-	if (sceneTextures.empty())
-	{
-		sceneTextures.insert(wiTextureHelper::getWhite());
-		sceneTextures.insert(wiTextureHelper::getNormalMapDefault());
-	}
-
+	// Count the texture references of the scene materials:
+	unordered_map<const Texture*, uint32_t> textureRefs;
+	textureRefs[wiTextureHelper::getWhite()]++;
+	textureRefs[wiTextureHelper::getNormalMapDefault()]++;
+	unordered_set<Entity> sceneMaterials;
 	for (size_t i = 0; i < scene.objects.GetCount(); ++i)
 	{
 		const ObjectComponent& object = scene.objects[i];
@@ -51,77 +48,109 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene, CommandList cmd
 
 			for (auto& subset : mesh.subsets)
 			{
+				if (!sceneMaterials.insert(subset.materialID).second)
+				{
+					continue;
+				}
+
 				const MaterialComponent& material = *scene.materials.GetComponent(subset.materialID);
 
-				sceneTextures.insert(material.GetBaseColorMap());
-				sceneTextures.insert(material.GetSurfaceMap());
-				sceneTextures.insert(material.GetEmissiveMap());
-				sceneTextures.insert(material.GetNormalMap());
+				const Texture* textures[] = {
+					material.GetBaseColorMap(),
+					material.GetSurfaceMap(),
+					material.GetEmissiveMap(),
+					material.GetNormalMap(),
+				};
+				for (const Texture* tex : textures)
+				{
+					if (tex != nullptr)
+					{
+						textureRefs[tex]++;
+					}
+				}
 			}
 		}
 
 	}
 
-	bool repackAtlas = false;
-	const int atlasWrapBorder = 1;
-	for (const Texture* tex : sceneTextures)
+	// Apply the reference count changes to the persistent atlas, only new textures will be allocated and copied
+	//	The releases come first, so the new textures and the retried ones can use the space that was freed in this frame:
+	for (auto it = sceneTextures.begin(); it != sceneTextures.end();)
 	{
-		if (tex == nullptr)
+		auto ref = textureRefs.find(it->first);
+		const uint32_t newRefCount = ref == textureRefs.end() ? 0 : ref->second;
+		while (it->second > newRefCount)
 		{
-			continue;
+			materialAtlas.Release(it->first);
+			it->second--;
 		}
-
-		if (storedTextures.find(tex) == storedTextures.end())
+		if (it->second == 0)
 		{
-			// we need to pack this texture into the atlas
-			rect_xywh newRect = rect_xywh(0, 0, tex->GetDesc().Width + atlasWrapBorder * 2, tex->GetDesc().Height + atlasWrapBorder * 2);
-			storedTextures[tex] = newRect;
-
-			repackAtlas = true;
+			it = sceneTextures.erase(it);
+		}
+		else
+		{
+			++it;
 		}
-
 	}
-
-	if (repackAtlas)
+	materialAtlas.Update();
+	for (auto& it : textureRefs)
 	{
-		vector<rect_xywh*> out_rects(storedTextures.size());
-		int i = 0;
-		for (auto& it : storedTextures)
+		uint32_t& refCount = sceneTextures[it.first];
+		while (refCount < it.second)
 		{
-			out_rects[i] = &it.second;
-			i++;
+			materialAtlas.AddRef(it.first, it.first->GetDesc().Width, it.first->GetDesc().Height);
+			refCount++;
 		}
+	}
+
+	bool repackAtlas = materialAtlas.IsFullRefreshNeeded();
+	if (materialAtlas.GetWidth() > 0 && (!globalMaterialAtlas.IsValid() || globalMaterialAtlas.GetDesc().Width != materialAtlas.GetWidth() || globalMaterialAtlas.GetDesc().Height != materialAtlas.GetHeight()))
+	{
+		TextureDesc desc;
+		desc.Width = materialAtlas.GetWidth();
+		desc.Height = materialAtlas.GetHeight();
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.Format = FORMAT_R8G8B8A8_UNORM;
+		desc.SampleCount = 1;
+		desc.Usage = USAGE_DEFAULT;
+		desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
 
-		std::vector<bin> bins;
-		if (pack(out_rects.data(), (int)storedTextures.size(), 16384, bins))
+		device->CreateTexture(&desc, nullptr, &globalMaterialAtlas);
+		device->SetName(&globalMaterialAtlas, "globalMaterialAtlas");
+
+		repackAtlas = true;
+	}
+
+	if (repackAtlas)
+	{
+		// The atlas was recreated or defragmented, copy every texture:
+		for (auto& it : sceneTextures)
 		{
-			assert(bins.size() == 1 && "The regions won't fit into the texture!");
-
-			TextureDesc desc;
-			desc.Width = (uint32_t)bins[0].size.w;
-			desc.Height = (uint32_t)bins[0].size.h;
-			desc.MipLevels = 1;
-			desc.ArraySize = 1;
-			desc.Format = FORMAT_R8G8B8A8_UNORM;
-			desc.SampleCount = 1;
-			desc.Usage = USAGE_DEFAULT;
-			desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-
-			device->CreateTexture(&desc, nullptr, &globalMaterialAtlas);
-			device->SetName(&globalMaterialAtlas, "globalMaterialAtlas");
-
-			for (auto& it : storedTextures)
+			wiRectPacker::rect_xywh rect;
+			if (materialAtlas.GetRegion(it.first, rect))
 			{
-				wiRenderer::CopyTexture2D(globalMaterialAtlas, 0, it.second.x + atlasWrapBorder, it.second.y + atlasWrapBorder, *it.first, 0, cmd, wiRenderer::BORDEREXPAND_WRAP);
+				wiRenderer::CopyTexture2D(globalMaterialAtlas, 0, rect.x, rect.y, *it.first, 0, cmd, wiRenderer::BORDEREXPAND_WRAP);
 			}
 		}
-		else
+	}
+	else
+	{
+		// Only copy textures that were newly inserted:
+		for (const void* key : materialAtlas.GetDirtyEntries())
 		{
-			wiBackLog::post("Tracing atlas packing failed!");
+			const Texture* tex = (const Texture*)key;
+			wiRectPacker::rect_xywh rect;
+			if (materialAtlas.GetRegion(tex, rect))
+			{
+				wiRenderer::CopyTexture2D(globalMaterialAtlas, 0, rect.x, rect.y, *tex, 0, cmd, wiRenderer::BORDEREXPAND_WRAP);
+			}
 		}
 	}
+	materialAtlas.ClearDirty();
 
 	materialArray.clear();
 
@@ -134,85 +163,25 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene, CommandList cmd
 		{
 			const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 
-			for (auto& subset : mesh.subsets)
+			// Only the full detail mesh is traced, LOD subsets are skipped:
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			mesh.GetLODSubsetRange(0, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 				const MaterialComponent& material = *scene.materials.GetComponent(subset.materialID);
 				ShaderMaterial global_material = material.CreateShaderMaterial();
 
 				// Add extended properties:
-				const TextureDesc& desc = globalMaterialAtlas.GetDesc();
-				rect_xywh rect;
-
-
-				if (material.GetBaseColorMap() != nullptr)
-				{
-					rect = storedTextures[material.GetBaseColorMap()];
-				}
-				else
-				{
-					rect = storedTextures[wiTextureHelper::getWhite()];
-				}
-				// eliminate border expansion:
-				rect.x += atlasWrapBorder;
-				rect.y += atlasWrapBorder;
-				rect.w -= atlasWrapBorder * 2;
-				rect.h -= atlasWrapBorder * 2;
-				global_material.baseColorAtlasMulAdd = XMFLOAT4((float)rect.w / (float)desc.Width, (float)rect.h / (float)desc.Height,
-					(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
-
-
-
-				if (material.GetSurfaceMap() != nullptr)
-				{
-					rect = storedTextures[material.GetSurfaceMap()];
-				}
-				else
-				{
-					rect = storedTextures[wiTextureHelper::getWhite()];
-				}
-				// eliminate border expansion:
-				rect.x += atlasWrapBorder;
-				rect.y += atlasWrapBorder;
-				rect.w -= atlasWrapBorder * 2;
-				rect.h -= atlasWrapBorder * 2;
-				global_material.surfaceMapAtlasMulAdd = XMFLOAT4((float)rect.w / (float)desc.Width, (float)rect.h / (float)desc.Height,
-					(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
-
-
-
-				if (material.GetEmissiveMap() != nullptr)
-				{
-					rect = storedTextures[material.GetEmissiveMap()];
-				}
-				else
-				{
-					rect = storedTextures[wiTextureHelper::getWhite()];
-				}
-				// eliminate border expansion:
-				rect.x += atlasWrapBorder;
-				rect.y += atlasWrapBorder;
-				rect.w -= atlasWrapBorder * 2;
-				rect.h -= atlasWrapBorder * 2;
-				global_material.emissiveMapAtlasMulAdd = XMFLOAT4((float)rect.w / (float)desc.Width, (float)rect.h / (float)desc.Height,
-					(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
-
-
-
-				if (material.GetNormalMap() != nullptr)
-				{
-					rect = storedTextures[material.GetNormalMap()];
-				}
-				else
-				{
-					rect = storedTextures[wiTextureHelper::getNormalMapDefault()];
-				}
-				// eliminate border expansion:
-				rect.x += atlasWrapBorder;
-				rect.y += atlasWrapBorder;
-				rect.w -= atlasWrapBorder * 2;
-				rect.h -= atlasWrapBorder * 2;
-				global_material.normalMapAtlasMulAdd = XMFLOAT4((float)rect.w / (float)desc.Width, (float)rect.h / (float)desc.Height,
-					(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
+				const Texture* baseColorMap = material.GetBaseColorMap();
+				const Texture* surfaceMap = material.GetSurfaceMap();
+				const Texture* emissiveMap = material.GetEmissiveMap();
+				const Texture* normalMap = material.GetNormalMap();
+				global_material.baseColorAtlasMulAdd = materialAtlas.GetMulAdd(baseColorMap != nullptr ? baseColorMap : wiTextureHelper::getWhite());
+				global_material.surfaceMapAtlasMulAdd = materialAtlas.GetMulAdd(surfaceMap != nullptr ? surfaceMap : wiTextureHelper::getWhite());
+				global_material.emissiveMapAtlasMulAdd = materialAtlas.GetMulAdd(emissiveMap != nullptr ? emissiveMap : wiTextureHelper::getWhite());
+				global_material.normalMapAtlasMulAdd = materialAtlas.GetMulAdd(normalMap != nullptr ? normalMap : wiTextureHelper::getNormalMapDefault());
 
 				materialArray.push_back(global_material);
 			}
@@ -282,7 +251,7 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 		{
 			const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 
-			totalTriangles += (uint)mesh.indices.size() / 3;
+			totalTriangles += mesh.GetBaseIndexCount() / 3;
 		}
 	}
 
@@ -395,8 +364,8 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 				cb.xBVHInstanceColor = object.color;
 				cb.xBVHMaterialOffset = materialCount;
 				cb.xBVHMeshTriangleOffset = primitiveCount;
-				cb.xBVHMeshTriangleCount = (uint)mesh.indices.size() / 3;
-				cb.xBVHMeshVertexPOSStride = sizeof(MeshComponent::Vertex_POS);
+				cb.xBVHMeshTriangleCount = mesh.GetBaseIndexCount() / 3;
+				const GPUBuffer* meshPositionStream = mesh.GetPositionStream(cb.xBVHMeshPositionStream);
 
 				device->UpdateBuffer(&constantBuffer, &cb, cmd);
 
@@ -404,10 +373,10 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 
 				device->BindConstantBuffer(CS, &constantBuffer, CB_GETBINDSLOT(BVHCB), cmd);
 
-				GPUResource* res[] = {
+				const GPUResource* res[] = {
 					&globalMaterialBuffer,
 					mesh.indexBuffer.get(),
-					mesh.streamoutBuffer_POS.get() != nullptr ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
+					meshPositionStream,
 					mesh.vertexBuffer_UV0.get(),
 					mesh.vertexBuffer_UV1.get(),
 					mesh.vertexBuffer_COL.get(),
@@ -416,10 +385,10 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 
 				device->Dispatch((cb.xBVHMeshTriangleCount + BVH_BUILDER_GROUPSIZE - 1) / BVH_BUILDER_GROUPSIZE, 1, 1, cmd);
 
-				for (auto& subset : mesh.subsets)
-				{
-					materialCount++;
-				}
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				materialCount += last_subset - first_subset;
 			}
 		}
 
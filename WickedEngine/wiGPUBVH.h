@@ -2,7 +2,7 @@
 #include "CommonInclude.h"
 #include "wiGraphicsDevice.h"
 #include "wiScene_Decl.h"
-#include "wiRectPacker.h"
+#include "wiAtlasAllocator.h"
 #include "ShaderInterop_Renderer.h"
 
 #include <vector>
@@ -28,8 +28,8 @@ private:
 	wiGraphics::GPUBuffer globalMaterialBuffer;
 	wiGraphics::Texture globalMaterialAtlas;
 	std::vector<ShaderMaterial> materialArray;
-	std::unordered_map<const wiGraphics::Texture*, wiRectPacker::rect_xywh> storedTextures;
-	std::unordered_set<const wiGraphics::Texture*> sceneTextures;
+	wiAtlasCache materialAtlas;
+	std::unordered_map<const wiGraphics::Texture*, uint32_t> sceneTextures; // reference count of textures in the scene materials
 	void UpdateGlobalMaterialResources(const wiScene::Scene& scene, wiGraphics::CommandList cmd);
 
 public:
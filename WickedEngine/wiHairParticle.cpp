@@ -33,6 +33,8 @@ static BlendState bs[2];
 static PipelineState PSO[RENDERPASS_COUNT][2];
 static PipelineState PSO_wire;
 
+static const uint32_t HAIR_LOD_COUNT = 4;
+
 void wiHairParticle::UpdateCPU(const TransformComponent& transform, const MeshComponent& mesh, float dt)
 {
 	world = transform.world;
@@ -51,7 +53,20 @@ void wiHairParticle::UpdateCPU(const TransformComponent& transform, const MeshCo
 	aabb = AABB(_min, _max);
 	aabb = aabb.transform(world);
 
-	if (dt > 0)
+	lods.clear();
+	if (IsDensityLODEnabled() && strandCount > 0)
+	{
+		for (uint32_t i = 0; i < HAIR_LOD_COUNT; ++i)
+		{
+			LOD lod;
+			lod.distance = viewDistance / float(1u << (HAIR_LOD_COUNT - 1 - i));
+			lod.strandCount = std::max(strandCount >> i, 1u);
+			lods.push_back(lod);
+		}
+	}
+
+	// The CPU simulation can run without a graphics device, the buffers are only needed for drawing:
+	if (dt > 0 && wiRenderer::GetDevice() != nullptr)
 	{
 		_flags &= ~REGENERATE_FRAME;
 		if (cb == nullptr || (strandCount * segmentCount) != particleBuffer->GetDesc().ByteWidth / sizeof(Patch))
@@ -89,6 +104,43 @@ void wiHairParticle::UpdateCPU(const TransformComponent& transform, const MeshCo
 	}
 
 }
+void wiHairParticle::UpdateSimulationCPU(const TransformComponent& transform, const MeshComponent& mesh, const wiHairParticleCPU::Environment& environment, const XMFLOAT3& eye, float dt)
+{
+	if (!IsCPUSimulationEnabled())
+		return;
+
+	if (cpuSimulation == nullptr || !cpuSimulation->IsUpToDate(*this))
+	{
+		if (cpuSimulation == nullptr)
+		{
+			cpuSimulation.reset(new wiHairParticleCPU);
+		}
+		cpuSimulation->Generate(*this, mesh);
+	}
+
+	cpuSimulation->Update(*this, transform.world, environment, GetLODStrandCount(GetDistance(eye)), dt);
+}
+uint32_t wiHairParticle::GetLODStrandCount(float distance) const
+{
+	if (!IsDensityLODEnabled() || lods.empty())
+	{
+		return strandCount;
+	}
+	for (auto& lod : lods)
+	{
+		if (distance <= lod.distance)
+		{
+			return lod.strandCount;
+		}
+	}
+	return 0; // faded out
+}
+float wiHairParticle::GetDistance(const XMFLOAT3& eye) const
+{
+	const XMVECTOR P = XMLoadFloat3(&eye);
+	const XMVECTOR closest = XMVectorClamp(P, XMLoadFloat3(&aabb._min), XMLoadFloat3(&aabb._max));
+	return XMVectorGetX(XMVector3Length(XMVectorSubtract(P, closest)));
+}
 void wiHairParticle::UpdateGPU(const MeshComponent& mesh, const MaterialComponent& material, CommandList cmd) const
 {
 	if (strandCount == 0 || particleBuffer == nullptr)
@@ -113,12 +165,29 @@ void wiHairParticle::UpdateGPU(const MeshComponent& mesh, const MaterialComponen
 	hcb.xHairParticleCount = hcb.xHairStrandCount * hcb.xHairSegmentCount;
 	hcb.xHairRandomSeed = randomSeed;
 	hcb.xHairViewDistance = viewDistance;
-	hcb.xHairBaseMeshIndexCount = (uint)mesh.indices.size();
-	hcb.xHairBaseMeshVertexPositionStride = sizeof(MeshComponent::Vertex_POS);
+	hcb.xHairBaseMeshIndexCount = mesh.GetBaseIndexCount();
+	const GPUBuffer* meshPositionStream = mesh.GetPositionStream(hcb.xHairBaseMeshPositionStream);
 	// segmentCount will be loop in the shader, not a threadgroup so we don't need it here:
 	hcb.xHairNumDispatchGroups = (uint)ceilf((float)strandCount / (float)THREADCOUNT_SIMULATEHAIR);
 	device->UpdateBuffer(cb.get(), &hcb, cmd);
 
+	if (IsCPUSimulationEnabled())
+	{
+		// The strands were generated and simulated on the CPU, the patches are uploaded into the particle buffer:
+		if (cpuSimulation != nullptr)
+		{
+			const uint32_t patchCount = cpuSimulation->GetStrandCount() * cpuSimulation->GetSegmentCount();
+			if (patchCount > 0 && patchCount * sizeof(Patch) <= particleBuffer->GetDesc().ByteWidth)
+			{
+				vector<Patch> patches(patchCount);
+				cpuSimulation->WritePatches(patches.data());
+				device->UpdateBuffer(particleBuffer.get(), patches.data(), cmd, (int)(sizeof(Patch) * patchCount));
+			}
+		}
+		device->EventEnd(cmd);
+		return;
+	}
+
 	device->BindConstantBuffer(CS, cb.get(), CB_GETBINDSLOT(HairParticleCB), cmd);
 
 	GPUResource* uavs[] = {
@@ -127,9 +196,9 @@ void wiHairParticle::UpdateGPU(const MeshComponent& mesh, const MaterialComponen
 	};
 	device->BindUAVs(CS, uavs, 0, arraysize(uavs), cmd);
 
-	GPUResource* res[] = {
+	const GPUResource* res[] = {
 		mesh.indexBuffer.get(),
-		mesh.streamoutBuffer_POS != nullptr ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
+		meshPositionStream,
 	};
 	device->BindResources(CS, res, TEXSLOT_ONDEMAND0, arraysize(res), cmd);
 
@@ -177,7 +246,14 @@ void wiHairParticle::Draw(const CameraComponent& camera, const MaterialComponent
 
 	device->BindResource(VS, particleBuffer.get(), 0, cmd);
 
-	device->Draw(strandCount * 12 * std::max(segmentCount, 1u), 0, cmd);
+	// The first strands are spread over the whole surface, so the density LOD draws less of them:
+	uint32_t drawStrandCount = GetLODStrandCount(GetDistance(camera.Eye));
+	if (IsCPUSimulationEnabled())
+	{
+		drawStrandCount = cpuSimulation == nullptr ? 0 : std::min(drawStrandCount, cpuSimulation->GetStrandCount());
+	}
+
+	device->Draw(drawStrandCount * 12 * std::max(segmentCount, 1u), 0, cmd);
 
 	device->EventEnd(cmd);
 }
@@ -196,6 +272,11 @@ void wiHairParticle::Serialize(wiArchive& archive, uint32_t seed)
 		archive >> stiffness;
 		archive >> randomness;
 		archive >> viewDistance;
+
+		if (archive.GetVersion() >= 37)
+		{
+			archive >> vertex_weights;
+		}
 	}
 	else
 	{
@@ -208,6 +289,11 @@ void wiHairParticle::Serialize(wiArchive& archive, uint32_t seed)
 		archive << stiffness;
 		archive << randomness;
 		archive << viewDistance;
+
+		if (archive.GetVersion() >= 37)
+		{
+			archive << vertex_weights;
+		}
 	}
 }
 
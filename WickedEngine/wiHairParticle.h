@@ -5,8 +5,10 @@
 #include "wiECS.h"
 #include "wiScene_Decl.h"
 #include "wiIntersect.h"
+#include "wiHairParticle_CPU.h"
 
 #include <memory>
+#include <vector>
 
 class wiArchive;
 
@@ -19,9 +21,16 @@ private:
 	std::unique_ptr<wiGraphics::GPUBuffer> cb;
 	std::unique_ptr<wiGraphics::GPUBuffer> particleBuffer;
 	std::unique_ptr<wiGraphics::GPUBuffer> simulationBuffer;
+	std::unique_ptr<wiHairParticleCPU> cpuSimulation;
 public:
 
 	void UpdateCPU(const TransformComponent& transform, const MeshComponent& mesh, float dt);
+	// Generate and simulate the strands on the CPU, if the CPU simulation is enabled (it must be called after UpdateCPU)
+	//	environment	: force fields, gravity and wind
+	//	eye			: the density LOD of the simulation is selected by the distance from this point
+	void UpdateSimulationCPU(const TransformComponent& transform, const MeshComponent& mesh, const wiHairParticleCPU::Environment& environment, const XMFLOAT3& eye, float dt);
+	// The CPU simulation state, or nullptr if the CPU simulation was not used yet
+	const wiHairParticleCPU* GetSimulationCPU() const { return cpuSimulation.get(); }
 	void UpdateGPU(const MeshComponent& mesh, const MaterialComponent& material, wiGraphics::CommandList cmd) const;
 	void Draw(const CameraComponent& camera, const MaterialComponent& material, RENDERPASS renderPass, bool transparent, wiGraphics::CommandList cmd) const;
 
@@ -29,6 +38,8 @@ public:
 	{
 		EMPTY = 0,
 		REGENERATE_FRAME = 1 << 0,
+		CPU_SIMULATION = 1 << 1,
+		DENSITY_LOD = 1 << 2,
 	};
 	uint32_t _flags = EMPTY;
 
@@ -41,12 +52,33 @@ public:
 	float stiffness = 10.0f;
 	float randomness = 0.2f;
 	float viewDistance = 200;
+	std::vector<float> vertex_weights; // strand density of the mesh vertices for the CPU strand generation, empty means uniform density
 
 	// Non-serialized attributes:
 	XMFLOAT4X4 world;
 	XMFLOAT4X4 worldPrev;
 	AABB aabb;
 
+	// Density LOD: the strand count is halved at every level, the level distances double up to the view distance
+	struct LOD
+	{
+		float distance;			// the level is used up to this distance from the camera
+		uint32_t strandCount;	// the first strandCount strands are drawn and simulated
+	};
+	std::vector<LOD> lods;		// filled by UpdateCPU() if the density LOD is enabled
+
+	// Number of strands to draw and simulate at a distance from the camera, all strands if the density LOD is disabled
+	uint32_t GetLODStrandCount(float distance) const;
+	// Distance of a point from the bounding box
+	float GetDistance(const XMFLOAT3& eye) const;
+
+	inline bool IsCPUSimulationEnabled() const { return _flags & CPU_SIMULATION; }
+	inline bool IsDensityLODEnabled() const { return _flags & DENSITY_LOD; }
+
+	inline void SetCPUSimulationEnabled(bool value) { if (value != IsCPUSimulationEnabled()) { cpuSimulation.reset(); } if (value) { _flags |= CPU_SIMULATION; } else { _flags &= ~CPU_SIMULATION; } }
+	inline void SetDensityLODEnabled(bool value) { if (value) { _flags |= DENSITY_LOD; } else { _flags &= ~DENSITY_LOD; } }
+
+
 	void Serialize(wiArchive& archive, uint32_t seed = 0);
 
 	static void LoadShaders();
@@ -0,0 +1,463 @@
+#include "wiHairParticle_CPU.h"
+#include "wiHairParticle.h"
+#include "wiScene.h"
+#include "wiJobSystem.h"
+#include "wiRandom.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace wiScene
+{
+
+static const uint32_t BLOCK_SIZE = 64; // strands per job, must be a multiple of 4
+
+static inline XMVECTOR XM_CALLCONV LoadStream(const vector<float>& stream, uint32_t index)
+{
+	return XMLoadFloat4((const XMFLOAT4*)&stream[index]);
+}
+static inline void XM_CALLCONV StoreStream(vector<float>& stream, uint32_t index, FXMVECTOR value)
+{
+	XMStoreFloat4((XMFLOAT4*)&stream[index], value);
+}
+static inline float XM_CALLCONV ReduceMin(FXMVECTOR value)
+{
+	XMFLOAT4 v;
+	XMStoreFloat4(&v, value);
+	return std::min(std::min(v.x, v.y), std::min(v.z, v.w));
+}
+static inline float XM_CALLCONV ReduceMax(FXMVECTOR value)
+{
+	XMFLOAT4 v;
+	XMStoreFloat4(&v, value);
+	return std::max(std::max(v.x, v.y), std::max(v.z, v.w));
+}
+static inline void XM_CALLCONV Normalize(XMVECTOR& X, XMVECTOR& Y, XMVECTOR& Z)
+{
+	const XMVECTOR length_rcp = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(X, X, XMVectorMultiplyAdd(Y, Y, XMVectorMultiply(Z, Z))));
+	X = XMVectorMultiply(X, length_rcp);
+	Y = XMVectorMultiply(Y, length_rcp);
+	Z = XMVectorMultiply(Z, length_rcp);
+}
+// Random number in [0, 1), the state is advanced
+static inline float Random(uint32_t& state)
+{
+	state = wiRandom::hash(state);
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+// Van der Corput sequence in base 2, every leading range of it is evenly spread in [0, 1)
+static inline float RadicalInverse(uint32_t index)
+{
+	index = (index << 16u) | (index >> 16u);
+	index = ((index & 0x55555555u) << 1u) | ((index & 0xAAAAAAAAu) >> 1u);
+	index = ((index & 0x33333333u) << 2u) | ((index & 0xCCCCCCCCu) >> 2u);
+	index = ((index & 0x0F0F0F0Fu) << 4u) | ((index & 0xF0F0F0F0u) >> 4u);
+	index = ((index & 0x00FF00FFu) << 8u) | ((index & 0xFF00FF00u) >> 8u);
+	return (index >> 8) * (1.0f / 16777216.0f);
+}
+// Same packing as in hairparticle_simulateCS
+static inline uint32_t PackDirection(const XMFLOAT3& value, float w)
+{
+	uint32_t retVal = 0;
+	retVal |= (uint32_t)(value.x * 127.5f + 127.5f) << 0;
+	retVal |= (uint32_t)(value.y * 127.5f + 127.5f) << 8;
+	retVal |= (uint32_t)(value.z * 127.5f + 127.5f) << 16;
+	retVal |= (uint32_t)(w * 255) << 24;
+	return retVal;
+}
+
+void wiHairParticleCPU::Generate(const wiHairParticle& hair, const MeshComponent& mesh)
+{
+	requestedStrandCount = hair.strandCount;
+	randomSeed = hair.randomSeed;
+	randomness = hair.randomness;
+	weightCount = hair.vertex_weights.size();
+	segmentCount = std::max(hair.segmentCount, 1u);
+	activeStrandCount = 0;
+	time = 0;
+	resetPending = true;
+	bounds = AABB();
+
+	// Triangles are chosen with a probability that is proportional to their area and the average of their vertex weights:
+	const uint32_t triangleCount = (uint32_t)std::min((size_t)mesh.GetBaseIndexCount(), mesh.indices.size()) / 3;
+	const bool weights = hair.vertex_weights.size() == mesh.vertex_positions.size();
+	const bool normals = mesh.vertex_normals.size() == mesh.vertex_positions.size();
+	vector<float> cdf(triangleCount);
+	float total = 0;
+	for (uint32_t tri = 0; tri < triangleCount; ++tri)
+	{
+		const uint32_t i0 = mesh.indices[tri * 3 + 0];
+		const uint32_t i1 = mesh.indices[tri * 3 + 1];
+		const uint32_t i2 = mesh.indices[tri * 3 + 2];
+		const XMVECTOR P0 = XMLoadFloat3(&mesh.vertex_positions[i0]);
+		const XMVECTOR P1 = XMLoadFloat3(&mesh.vertex_positions[i1]);
+		const XMVECTOR P2 = XMLoadFloat3(&mesh.vertex_positions[i2]);
+		float weight = 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(XMVectorSubtract(P1, P0), XMVectorSubtract(P2, P0))));
+		if (weights)
+		{
+			weight *= std::max(0.0f, hair.vertex_weights[i0] + hair.vertex_weights[i1] + hair.vertex_weights[i2]) / 3.0f;
+		}
+		total += weight;
+		cdf[tri] = total;
+	}
+
+	strandCount = total > 0 ? hair.strandCount : 0;
+	strandStride = (strandCount + 3) & ~3u;
+	for (auto& stream : strandStreams)
+	{
+		stream.clear();
+		stream.resize(strandStride, 0.0f);
+	}
+	for (auto& stream : segmentStreams)
+	{
+		stream.clear();
+		stream.resize((size_t)strandStride * segmentCount, 0.0f);
+	}
+	tangent_random.clear();
+	tangent_random.resize(strandCount);
+	binormal_length.clear();
+	binormal_length.resize(strandCount);
+
+	// The strands follow a low discrepancy sequence over the triangle distribution, which is rotated by the random seed.
+	//	This way the first strands of any count are spread over the whole surface.
+	const float rotation = (wiRandom::hash(randomSeed) >> 8) * (1.0f / 16777216.0f);
+	for (uint32_t i = 0; i < strandCount; ++i)
+	{
+		uint32_t state = wiRandom::hash(randomSeed ^ wiRandom::hash(i));
+
+		float u = RadicalInverse(i) + rotation;
+		u = u >= 1 ? u - 1 : u;
+		const uint32_t tri = std::min(triangleCount - 1, (uint32_t)(std::upper_bound(cdf.begin(), cdf.end(), u * total) - cdf.begin()));
+		const uint32_t i0 = mesh.indices[tri * 3 + 0];
+		const uint32_t i1 = mesh.indices[tri * 3 + 1];
+		const uint32_t i2 = mesh.indices[tri * 3 + 2];
+		const XMVECTOR P0 = XMLoadFloat3(&mesh.vertex_positions[i0]);
+		const XMVECTOR P1 = XMLoadFloat3(&mesh.vertex_positions[i1]);
+		const XMVECTOR P2 = XMLoadFloat3(&mesh.vertex_positions[i2]);
+
+		// random barycentric coords:
+		float f = Random(state);
+		float g = Random(state);
+		if (f + g > 1)
+		{
+			f = 1 - f;
+			g = 1 - g;
+		}
+
+		// compute final surface position on triangle from barycentric coords:
+		const XMVECTOR P = XMVectorAdd(P0, XMVectorAdd(XMVectorScale(XMVectorSubtract(P1, P0), f), XMVectorScale(XMVectorSubtract(P2, P0), g)));
+		XMVECTOR N;
+		if (normals)
+		{
+			const XMVECTOR N0 = XMLoadFloat3(&mesh.vertex_normals[i0]);
+			const XMVECTOR N1 = XMLoadFloat3(&mesh.vertex_normals[i1]);
+			const XMVECTOR N2 = XMLoadFloat3(&mesh.vertex_normals[i2]);
+			N = XMVectorAdd(N0, XMVectorAdd(XMVectorScale(XMVectorSubtract(N1, N0), f), XMVectorScale(XMVectorSubtract(N2, N0), g)));
+		}
+		else
+		{
+			N = XMVector3Cross(XMVectorSubtract(P1, P0), XMVectorSubtract(P2, P0));
+		}
+		N = XMVector3Normalize(N);
+		const XMVECTOR T = XMVector3Normalize(XMVectorSubtract(Random(state) < 0.5f ? P0 : P2, P1));
+		const XMVECTOR B = XMVector3Cross(N, T);
+
+		XMFLOAT3 position, target, tangent, binormal;
+		XMStoreFloat3(&position, P);
+		XMStoreFloat3(&target, N);
+		XMStoreFloat3(&tangent, T);
+		XMStoreFloat3(&binormal, B);
+
+		tangent_random[i] = PackDirection(tangent, Random(state));
+		binormal_length[i] = PackDirection(binormal, Random(state) * std::min(std::max(randomness, 0.0f), 1.0f));
+
+		strandStreams[ROOT_X][i] = position.x;
+		strandStreams[ROOT_Y][i] = position.y;
+		strandStreams[ROOT_Z][i] = position.z;
+		strandStreams[TARGET_X][i] = target.x;
+		strandStreams[TARGET_Y][i] = target.y;
+		strandStreams[TARGET_Z][i] = target.z;
+		strandStreams[LENGTH][i] = ((binormal_length[i] >> 24) & 0xFF) / 255.0f + 1;
+		strandStreams[PHASE][i] = Random(state);
+	}
+
+	// The padding strands are kept valid, so the simulation doesn't need to mask them:
+	for (uint32_t i = strandCount; i < strandStride; ++i)
+	{
+		strandStreams[TARGET_Y][i] = 1;
+		strandStreams[LENGTH][i] = 1;
+	}
+}
+
+bool wiHairParticleCPU::IsUpToDate(const wiHairParticle& hair) const
+{
+	return
+		requestedStrandCount == hair.strandCount &&
+		segmentCount == std::max(hair.segmentCount, 1u) &&
+		randomSeed == hair.randomSeed &&
+		randomness == hair.randomness &&
+		weightCount == hair.vertex_weights.size();
+}
+
+size_t wiHairParticleCPU::GetMemorySizeInBytes() const
+{
+	size_t size = 0;
+	for (auto& stream : strandStreams)
+	{
+		size += stream.capacity() * sizeof(float);
+	}
+	for (auto& stream : segmentStreams)
+	{
+		size += stream.capacity() * sizeof(float);
+	}
+	size += tangent_random.capacity() * sizeof(uint32_t);
+	size += binormal_length.capacity() * sizeof(uint32_t);
+	size += blockBounds.capacity() * sizeof(AABB);
+	return size;
+}
+
+void wiHairParticleCPU::ResetStrands(const XMFLOAT4X4& world, float length, uint32_t begin, uint32_t end)
+{
+	// The segments are stacked straight along the rest direction, without velocity:
+	const XMMATRIX W = XMLoadFloat4x4(&world);
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		XMVECTOR base = XMVector3Transform(XMVectorSet(strandStreams[ROOT_X][i], strandStreams[ROOT_Y][i], strandStreams[ROOT_Z][i], 1), W);
+		const XMVECTOR target = XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(strandStreams[TARGET_X][i], strandStreams[TARGET_Y][i], strandStreams[TARGET_Z][i], 0), W));
+		const float len = strandStreams[LENGTH][i] * length;
+
+		for (uint32_t segment = 0; segment < segmentCount; ++segment)
+		{
+			const size_t index = (size_t)segment * strandStride + i;
+			XMFLOAT3 position, normal;
+			XMStoreFloat3(&position, base);
+			XMStoreFloat3(&normal, target);
+			segmentStreams[POSITION_X][index] = position.x;
+			segmentStreams[POSITION_Y][index] = position.y;
+			segmentStreams[POSITION_Z][index] = position.z;
+			segmentStreams[NORMAL_X][index] = normal.x;
+			segmentStreams[NORMAL_Y][index] = normal.y;
+			segmentStreams[NORMAL_Z][index] = normal.z;
+			segmentStreams[VELOCITY_X][index] = 0;
+			segmentStreams[VELOCITY_Y][index] = 0;
+			segmentStreams[VELOCITY_Z][index] = 0;
+			base = XMVectorAdd(base, XMVectorScale(target, len));
+		}
+	}
+}
+
+void wiHairParticleCPU::Update(const wiHairParticle& hair, const XMFLOAT4X4& world, const Environment& environment, uint32_t activeStrandCount, float dt)
+{
+	activeStrandCount = std::min(activeStrandCount, strandCount);
+	if (resetPending)
+	{
+		// The inactive strands are also initialized, because all of them can be drawn:
+		ResetStrands(world, hair.length, 0, strandCount);
+		resetPending = false;
+	}
+	else if (activeStrandCount > this->activeStrandCount)
+	{
+		// These strands were not simulated, so their state is out of date:
+		ResetStrands(world, hair.length, this->activeStrandCount, activeStrandCount);
+	}
+	this->activeStrandCount = activeStrandCount;
+	time += dt;
+
+	const uint32_t blockCount = (activeStrandCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	blockBounds.resize(blockCount);
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * BLOCK_SIZE;
+		const uint32_t end = std::min(begin + BLOCK_SIZE, activeStrandCount);
+
+		const XMVECTOR ONE = XMVectorSplatOne();
+		const XMVECTOR DT = XMVectorReplicate(dt);
+		const XMVECTOR DRAG = XMVectorReplicate(0.98f);
+		const XMVECTOR STIFFNESS = XMVectorReplicate(hair.stiffness);
+		const XMVECTOR LENGTH_SCALE = XMVectorReplicate(hair.length);
+		const XMVECTOR FLTMAX = XMVectorReplicate(FLT_MAX);
+
+		// World matrix elements:
+		const XMVECTOR M11 = XMVectorReplicate(world._11), M12 = XMVectorReplicate(world._12), M13 = XMVectorReplicate(world._13);
+		const XMVECTOR M21 = XMVectorReplicate(world._21), M22 = XMVectorReplicate(world._22), M23 = XMVectorReplicate(world._23);
+		const XMVECTOR M31 = XMVectorReplicate(world._31), M32 = XMVectorReplicate(world._32), M33 = XMVectorReplicate(world._33);
+		const XMVECTOR M41 = XMVectorReplicate(world._41), M42 = XMVectorReplicate(world._42), M43 = XMVectorReplicate(world._43);
+
+		XMVECTOR minX = FLTMAX, minY = FLTMAX, minZ = FLTMAX;
+		XMVECTOR maxX = XMVectorNegate(FLTMAX), maxY = XMVectorNegate(FLTMAX), maxZ = XMVectorNegate(FLTMAX);
+
+		for (uint32_t i = begin; i < end; i += 4)
+		{
+			// Transform the strand roots and rest directions by the emitter matrix:
+			const XMVECTOR RX = LoadStream(strandStreams[ROOT_X], i);
+			const XMVECTOR RY = LoadStream(strandStreams[ROOT_Y], i);
+			const XMVECTOR RZ = LoadStream(strandStreams[ROOT_Z], i);
+			XMVECTOR BX = XMVectorMultiplyAdd(RX, M11, XMVectorMultiplyAdd(RY, M21, XMVectorMultiplyAdd(RZ, M31, M41)));
+			XMVECTOR BY = XMVectorMultiplyAdd(RX, M12, XMVectorMultiplyAdd(RY, M22, XMVectorMultiplyAdd(RZ, M32, M42)));
+			XMVECTOR BZ = XMVectorMultiplyAdd(RX, M13, XMVectorMultiplyAdd(RY, M23, XMVectorMultiplyAdd(RZ, M33, M43)));
+
+			const XMVECTOR TX = LoadStream(strandStreams[TARGET_X], i);
+			const XMVECTOR TY = LoadStream(strandStreams[TARGET_Y], i);
+			const XMVECTOR TZ = LoadStream(strandStreams[TARGET_Z], i);
+			XMVECTOR targetX = XMVectorMultiplyAdd(TX, M11, XMVectorMultiplyAdd(TY, M21, XMVectorMultiply(TZ, M31)));
+			XMVECTOR targetY = XMVectorMultiplyAdd(TX, M12, XMVectorMultiplyAdd(TY, M22, XMVectorMultiply(TZ, M32)));
+			XMVECTOR targetZ = XMVectorMultiplyAdd(TX, M13, XMVectorMultiplyAdd(TY, M23, XMVectorMultiply(TZ, M33)));
+			Normalize(targetX, targetY, targetZ);
+
+			const XMVECTOR LEN = XMVectorMultiply(LoadStream(strandStreams[LENGTH], i), LENGTH_SCALE);
+
+			// Constant forces of the strand, the wind gusts travel along the world position:
+			XMVECTOR phase = XMVectorAdd(XMVectorAdd(BX, BY), BZ);
+			phase = XMVectorScale(phase, 1.0f / std::max(environment.windWaveSize, 0.001f));
+			phase = XMVectorMultiplyAdd(LoadStream(strandStreams[PHASE], i), XMVectorReplicate(environment.windRandomness), phase);
+			const XMVECTOR gust = XMVectorMultiplyAdd(XMVectorSin(XMVectorAdd(phase, XMVectorReplicate(time))), XMVectorReplicate(0.5f), XMVectorReplicate(0.5f));
+			const XMVECTOR CFX = XMVectorMultiplyAdd(XMVectorReplicate(environment.wind.x), gust, XMVectorReplicate(environment.gravity.x));
+			const XMVECTOR CFY = XMVectorMultiplyAdd(XMVectorReplicate(environment.wind.y), gust, XMVectorReplicate(environment.gravity.y));
+			const XMVECTOR CFZ = XMVectorMultiplyAdd(XMVectorReplicate(environment.wind.z), gust, XMVectorReplicate(environment.gravity.z));
+
+			// The padding lanes of the last vector are excluded from the bounds:
+			const XMVECTOR mask = XMVectorLess(XMVectorAdd(XMVectorReplicate((float)i), XMVectorSet(0, 1, 2, 3)), XMVectorReplicate((float)end));
+
+			XMVECTOR NX = XMVectorZero(), NY = XMVectorZero(), NZ = XMVectorZero();
+			for (uint32_t segment = 0; segment < segmentCount; ++segment)
+			{
+				const uint32_t index = segment * strandStride + i;
+
+				const XMVECTOR oldNX = LoadStream(segmentStreams[NORMAL_X], index);
+				const XMVECTOR oldNY = LoadStream(segmentStreams[NORMAL_Y], index);
+				const XMVECTOR oldNZ = LoadStream(segmentStreams[NORMAL_Z], index);
+				NX = XMVectorAdd(NX, oldNX);
+				NY = XMVectorAdd(NY, oldNY);
+				NZ = XMVectorAdd(NZ, oldNZ);
+				Normalize(NX, NY, NZ);
+
+				const XMVECTOR tipX = XMVectorMultiplyAdd(NX, LEN, BX);
+				const XMVECTOR tipY = XMVectorMultiplyAdd(NY, LEN, BY);
+				const XMVECTOR tipZ = XMVectorMultiplyAdd(NZ, LEN, BZ);
+
+				// Accumulate forces:
+				XMVECTOR FX = CFX, FY = CFY, FZ = CFZ;
+				for (uint32_t f = 0; f < environment.forceFieldCount; ++f)
+				{
+					const ForceField& forceField = environment.forceFields[f];
+					XMVECTOR DX, DY, DZ, dist;
+					if (forceField.planar)
+					{
+						DX = XMVectorReplicate(forceField.normal.x);
+						DY = XMVectorReplicate(forceField.normal.y);
+						DZ = XMVectorReplicate(forceField.normal.z);
+						dist = XMVectorMultiply(DX, XMVectorSubtract(XMVectorReplicate(forceField.position.x), tipX));
+						dist = XMVectorMultiplyAdd(DY, XMVectorSubtract(XMVectorReplicate(forceField.position.y), tipY), dist);
+						dist = XMVectorMultiplyAdd(DZ, XMVectorSubtract(XMVectorReplicate(forceField.position.z), tipZ), dist);
+					}
+					else
+					{
+						DX = XMVectorSubtract(XMVectorReplicate(forceField.position.x), tipX);
+						DY = XMVectorSubtract(XMVectorReplicate(forceField.position.y), tipY);
+						DZ = XMVectorSubtract(XMVectorReplicate(forceField.position.z), tipZ);
+						dist = XMVectorSqrt(XMVectorMultiplyAdd(DX, DX, XMVectorMultiplyAdd(DY, DY, XMVectorMultiply(DZ, DZ))));
+					}
+					const XMVECTOR S = XMVectorMultiply(XMVectorReplicate(forceField.gravity), XMVectorSubtract(ONE, XMVectorSaturate(XMVectorScale(dist, forceField.range_inverse))));
+					FX = XMVectorMultiplyAdd(DX, S, FX);
+					FY = XMVectorMultiplyAdd(DY, S, FY);
+					FZ = XMVectorMultiplyAdd(DZ, S, FZ);
+				}
+
+				// Pull back to rest position:
+				FX = XMVectorMultiplyAdd(XMVectorSubtract(targetX, NX), STIFFNESS, FX);
+				FY = XMVectorMultiplyAdd(XMVectorSubtract(targetY, NY), STIFFNESS, FY);
+				FZ = XMVectorMultiplyAdd(XMVectorSubtract(targetZ, NZ), STIFFNESS, FZ);
+
+				// Apply surface-movement-based velocity:
+				const XMVECTOR oldTipX = XMVectorMultiplyAdd(oldNX, LEN, LoadStream(segmentStreams[POSITION_X], index));
+				const XMVECTOR oldTipY = XMVectorMultiplyAdd(oldNY, LEN, LoadStream(segmentStreams[POSITION_Y], index));
+				const XMVECTOR oldTipZ = XMVectorMultiplyAdd(oldNZ, LEN, LoadStream(segmentStreams[POSITION_Z], index));
+				XMVECTOR VX = XMVectorAdd(LoadStream(segmentStreams[VELOCITY_X], index), XMVectorSubtract(oldTipX, tipX));
+				XMVECTOR VY = XMVectorAdd(LoadStream(segmentStreams[VELOCITY_Y], index), XMVectorSubtract(oldTipY, tipY));
+				XMVECTOR VZ = XMVectorAdd(LoadStream(segmentStreams[VELOCITY_Z], index), XMVectorSubtract(oldTipZ, tipZ));
+
+				// Apply forces:
+				VX = XMVectorMultiplyAdd(FX, DT, VX);
+				VY = XMVectorMultiplyAdd(FY, DT, VY);
+				VZ = XMVectorMultiplyAdd(FZ, DT, VZ);
+				NX = XMVectorMultiplyAdd(VX, DT, NX);
+				NY = XMVectorMultiplyAdd(VY, DT, NY);
+				NZ = XMVectorMultiplyAdd(VZ, DT, NZ);
+
+				// Drag:
+				VX = XMVectorMultiply(VX, DRAG);
+				VY = XMVectorMultiply(VY, DRAG);
+				VZ = XMVectorMultiply(VZ, DRAG);
+
+				// Store segment:
+				XMVECTOR storeNX = NX, storeNY = NY, storeNZ = NZ;
+				Normalize(storeNX, storeNY, storeNZ);
+				StoreStream(segmentStreams[POSITION_X], index, BX);
+				StoreStream(segmentStreams[POSITION_Y], index, BY);
+				StoreStream(segmentStreams[POSITION_Z], index, BZ);
+				StoreStream(segmentStreams[NORMAL_X], index, storeNX);
+				StoreStream(segmentStreams[NORMAL_Y], index, storeNY);
+				StoreStream(segmentStreams[NORMAL_Z], index, storeNZ);
+				StoreStream(segmentStreams[VELOCITY_X], index, VX);
+				StoreStream(segmentStreams[VELOCITY_Y], index, VY);
+				StoreStream(segmentStreams[VELOCITY_Z], index, VZ);
+
+				minX = XMVectorSelect(minX, XMVectorMin(minX, XMVectorMin(BX, tipX)), mask);
+				minY = XMVectorSelect(minY, XMVectorMin(minY, XMVectorMin(BY, tipY)), mask);
+				minZ = XMVectorSelect(minZ, XMVectorMin(minZ, XMVectorMin(BZ, tipZ)), mask);
+				maxX = XMVectorSelect(maxX, XMVectorMax(maxX, XMVectorMax(BX, tipX)), mask);
+				maxY = XMVectorSelect(maxY, XMVectorMax(maxY, XMVectorMax(BY, tipY)), mask);
+				maxZ = XMVectorSelect(maxZ, XMVectorMax(maxZ, XMVectorMax(BZ, tipZ)), mask);
+
+				// Offset next segment root to current tip:
+				BX = tipX;
+				BY = tipY;
+				BZ = tipZ;
+			}
+		}
+
+		blockBounds[args.jobIndex] = AABB(
+			XMFLOAT3(ReduceMin(minX), ReduceMin(minY), ReduceMin(minZ)),
+			XMFLOAT3(ReduceMax(maxX), ReduceMax(maxY), ReduceMax(maxZ))
+		);
+	});
+	wiJobSystem::Wait(ctx);
+
+	bounds = AABB();
+	for (auto& block : blockBounds)
+	{
+		bounds = AABB::Merge(bounds, block);
+	}
+}
+
+XMFLOAT3 wiHairParticleCPU::GetStrandRoot(uint32_t strand) const
+{
+	return XMFLOAT3(strandStreams[ROOT_X][strand], strandStreams[ROOT_Y][strand], strandStreams[ROOT_Z][strand]);
+}
+
+Patch wiHairParticleCPU::GetPatch(uint32_t strand, uint32_t segment) const
+{
+	const size_t index = (size_t)segment * strandStride + strand;
+	Patch patch;
+	patch.position = XMFLOAT3(segmentStreams[POSITION_X][index], segmentStreams[POSITION_Y][index], segmentStreams[POSITION_Z][index]);
+	patch.tangent_random = tangent_random[strand];
+	patch.normal = XMFLOAT3(segmentStreams[NORMAL_X][index], segmentStreams[NORMAL_Y][index], segmentStreams[NORMAL_Z][index]);
+	patch.binormal_length = binormal_length[strand];
+	return patch;
+}
+
+void wiHairParticleCPU::WritePatches(Patch* dest) const
+{
+	for (uint32_t strand = 0; strand < strandCount; ++strand)
+	{
+		for (uint32_t segment = 0; segment < segmentCount; ++segment)
+		{
+			*dest++ = GetPatch(strand, segment);
+		}
+	}
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiIntersect.h"
+#include "wiScene_Decl.h"
+#include "wiEmittedParticle_CPU.h"
+#include "ShaderInterop_HairParticle.h"
+
+#include <vector>
+
+namespace wiScene
+{
+
+class wiHairParticle;
+
+// CPU strand generation and simulation of wiHairParticle, it doesn't need a graphics device
+//	The strands are placed on the emitter mesh deterministically, the density follows the vertex weights of the hair particle system.
+//	Every leading range of the strands covers the surface evenly, so a density LOD only needs to draw and simulate fewer strands.
+//	The simulation is the same as hairparticle_simulateCS with gravity and wind added, it processes four strands at a time with DirectXMath vectors.
+class wiHairParticleCPU
+{
+public:
+	typedef wiEmittedParticleCPU::ForceField ForceField;
+	struct Environment
+	{
+		const ForceField* forceFields = nullptr;
+		uint32_t forceFieldCount = 0;
+		XMFLOAT3 gravity = XMFLOAT3(0, -1, 0);	// pull on the strand directions, the stiffness works against it
+		XMFLOAT3 wind = XMFLOAT3(0, 0, 0);		// wind direction and strength
+		float windWaveSize = 1;					// distance between the wind gusts
+		float windRandomness = 5;				// how much the gusts are shifted between strands
+	};
+
+private:
+	enum STRAND_STREAM
+	{
+		ROOT_X,				// local space root position on the mesh surface
+		ROOT_Y,
+		ROOT_Z,
+		TARGET_X,			// local space rest direction
+		TARGET_Y,
+		TARGET_Z,
+		LENGTH,				// length multiplier, the same as in binormal_length
+		PHASE,				// random wind gust offset
+		STRAND_STREAM_COUNT
+	};
+	enum SEGMENT_STREAM
+	{
+		POSITION_X,			// world space segment root
+		POSITION_Y,
+		POSITION_Z,
+		NORMAL_X,			// world space segment direction
+		NORMAL_Y,
+		NORMAL_Z,
+		VELOCITY_X,
+		VELOCITY_Y,
+		VELOCITY_Z,
+		SEGMENT_STREAM_COUNT
+	};
+	std::vector<float> strandStreams[STRAND_STREAM_COUNT];		// strandStride elements
+	std::vector<float> segmentStreams[SEGMENT_STREAM_COUNT];	// segmentCount * strandStride elements, the strands of a segment are consecutive
+	std::vector<uint32_t> tangent_random;						// per strand, in the Patch format
+	std::vector<uint32_t> binormal_length;
+	std::vector<AABB> blockBounds;
+
+	uint32_t strandCount = 0;
+	uint32_t strandStride = 0;		// strandCount rounded up to a multiple of 4
+	uint32_t segmentCount = 0;
+	uint32_t activeStrandCount = 0;
+	float time = 0;
+	bool resetPending = false;	// every strand is put into rest state at the next update
+	AABB bounds;
+
+	// Parameters of the last generation:
+	uint32_t requestedStrandCount = 0;
+	uint32_t randomSeed = 0;
+	float randomness = 0;
+	size_t weightCount = 0;
+
+	void ResetStrands(const XMFLOAT4X4& world, float length, uint32_t begin, uint32_t end);
+
+public:
+	// Place the strands of the hair particle system on the mesh, they are put into rest state by the next Update()
+	//	The strand count, segment count, random seed, randomness and vertex weights of the hair are used
+	//	The triangles whose vertex weights are all zero don't get strands, if there are no such triangles, no strands are placed
+	void Generate(const wiHairParticle& hair, const MeshComponent& mesh);
+	// Returns false if the generation parameters of the hair have changed since the last Generate()
+	bool IsUpToDate(const wiHairParticle& hair) const;
+
+	// Simulate one frame
+	//	world				: world matrix of the emitter mesh
+	//	activeStrandCount	: only the first strands are simulated (density LOD), strands that become active again are restarted from rest
+	void Update(const wiHairParticle& hair, const XMFLOAT4X4& world, const Environment& environment, uint32_t activeStrandCount, float dt);
+
+	uint32_t GetStrandCount() const { return strandCount; }
+	uint32_t GetSegmentCount() const { return segmentCount; }
+	uint32_t GetActiveStrandCount() const { return activeStrandCount; }
+	// Bounding box of the active strands after the last update
+	const AABB& GetBounds() const { return bounds; }
+	size_t GetMemorySizeInBytes() const;
+
+	// Local space root position of a strand on the mesh
+	XMFLOAT3 GetStrandRoot(uint32_t strand) const;
+	// Patch in the GPU layout
+	Patch GetPatch(uint32_t strand, uint32_t segment) const;
+	// Write the patches of every strand in the GPU layout: strand after strand, segmentCount patches per strand
+	void WritePatches(Patch* dest) const;
+};
+
+}
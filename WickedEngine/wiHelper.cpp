@@ -12,6 +12,9 @@
 #include <fstream>
 #include <sstream>
 #include <codecvt> // string conversion
+#include <sys/stat.h>
+#include <atomic>
+#include <cstdio>
 
 #include <Commdlg.h> // openfile
 #include <WinBase.h>
@@ -49,6 +52,52 @@ namespace wiHelper
 		return false;
 	}
 
+	bool WriteFileAtomic(const std::string& fileName, const void* data, size_t size, bool replace)
+	{
+		const string directory = GetDirectoryFromPath(fileName);
+		if (!directory.empty())
+		{
+			MakeDirectory(directory);
+		}
+
+		static std::atomic<uint32_t> tempCounter{ 0 };
+		stringstream tempFileName;
+		tempFileName << fileName << "." << tempCounter.fetch_add(1) << ".tmp";
+		ofstream file(tempFileName.str(), ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.write((const char*)data, (std::streamsize)size);
+		file.close();
+		if (file.fail())
+		{
+			std::remove(tempFileName.str().c_str());
+			return false;
+		}
+		if (replace)
+		{
+			std::remove(fileName.c_str()); // rename doesn't overwrite on every platform
+		}
+		if (std::rename(tempFileName.str().c_str(), fileName.c_str()) != 0)
+		{
+			std::remove(tempFileName.str().c_str()); // the file was written by someone else in the meantime
+			return false;
+		}
+		return true;
+	}
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
 	void messageBox(const std::string& msg, const std::string& caption)
 	{
 #ifndef WINSTORE_SUPPORT
@@ -63,7 +112,7 @@ namespace wiHelper
 
 	void screenshot(const std::string& name)
 	{
-		CreateDirectoryA("screenshots", 0);
+		MakeDirectory("screenshots");
 		stringstream ss("");
 		if (name.length() <= 0)
 			ss << GetOriginalWorkingDirectory() << "screenshots/sc_" << getCurrentDateTimeAsString() << ".jpg";
@@ -331,6 +380,54 @@ namespace wiHelper
 		return exists;
 	}
 
+	bool GetFileInfo(const std::string& fileName, uint64_t& size, uint64_t& modifiedTime)
+	{
+#ifdef _WIN32
+		struct _stat64 info;
+		if (_stat64(fileName.c_str(), &info) != 0 || (info.st_mode & _S_IFREG) == 0)
+#else
+		struct stat info;
+		if (stat(fileName.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+#endif // _WIN32
+		{
+			return false;
+		}
+		size = (uint64_t)info.st_size;
+		modifiedTime = (uint64_t)info.st_mtime;
+		return true;
+	}
+
+	bool MakeDirectory(const std::string& path)
+	{
+		// The stat of the MSVC runtime fails on directory names with a trailing separator:
+		std::string directory = path;
+		while (directory.length() > 1 && (directory.back() == '/' || directory.back() == '\\'))
+		{
+			directory.pop_back();
+		}
+
+		// Every parent directory is created first, the ones that already exist are skipped by the OS:
+		for (size_t i = 1; i <= directory.length(); ++i)
+		{
+			if (i == directory.length() || directory[i] == '/' || directory[i] == '\\')
+			{
+#ifdef _WIN32
+				_mkdir(directory.substr(0, i).c_str());
+#else
+				mkdir(directory.substr(0, i).c_str(), 0755);
+#endif // _WIN32
+			}
+		}
+
+#ifdef _WIN32
+		struct _stat64 info;
+		return _stat64(directory.c_str(), &info) == 0 && (info.st_mode & _S_IFDIR) != 0;
+#else
+		struct stat info;
+		return stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif // _WIN32
+	}
+
 	void FileDialog(const FileDialogParams& params, FileDialogResult& result)
 	{
 #ifdef _WIN32
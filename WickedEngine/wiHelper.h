@@ -18,6 +18,15 @@ namespace wiHelper
 
 	bool readByteData(const std::string& fileName, std::vector<uint8_t>& data);
 
+	// Writes the file into a temporary file first and renames it at the end, so that an other thread or process never reads a partial file
+	//	The directory of the file is created if it doesn't exist
+	//	replace	: an existing file is overwritten, otherwise the file that is already there is kept
+	//	returns true if the data was written
+	bool WriteFileAtomic(const std::string& fileName, const void* data, size_t size, bool replace);
+
+	// 64-bit FNV-1a hash, the hash of a previous call can be continued with more data
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
 	void messageBox(const std::string& msg, const std::string& caption = "Warning!");
 
 	void screenshot(const std::string& name = "");
@@ -50,6 +59,12 @@ namespace wiHelper
 
 	bool FileExists(const std::string& fileName);
 
+	// Size in bytes and last modification time (seconds since the epoch) of a file, returns false if the file doesn't exist
+	bool GetFileInfo(const std::string& fileName, uint64_t& size, uint64_t& modifiedTime);
+
+	// Creates the directory and its missing parent directories, returns true if the directory exists afterwards
+	bool MakeDirectory(const std::string& path);
+
 	struct FileDialogParams
 	{
 		enum TYPE
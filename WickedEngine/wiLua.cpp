@@ -24,6 +24,8 @@
 #include "wiBackLog_BindLua.h"
 #include "wiNetwork_BindLua.h"
 #include "wiIntersect_BindLua.h"
+#include "wiPhysicsEngine_BindLua.h"
+#include "wiLuaScriptPool_BindLua.h"
 
 #include <sstream>
 
@@ -75,6 +77,8 @@ wiLua* wiLua::GetGlobal()
 		wiBackLog_BindLua::Bind();
 		wiNetwork_BindLua::Bind();
 		wiIntersect_BindLua::Bind();
+		wiPhysicsEngine_BindLua::Bind();
+		wiLuaScriptPool_BindLua::Bind();
 
 	}
 	return globalLua;
@@ -0,0 +1,84 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiSpinLock.h"
+
+#include <vector>
+#include <cassert>
+
+// Free list allocator for the binding objects that scripts create in large numbers (Vector, Matrix, components)
+//	Luna creates a new C++ object for every value that is returned to Lua and deletes it when the userdata is collected.
+//	The freed objects are kept for reuse, so a script that creates the same amount of objects every frame doesn't touch the heap for them.
+//	The objects are 16 byte aligned like with ALIGN_16.
+template<typename T>
+class wiLuaAllocator
+{
+	static const size_t ALIGNMENT = 16;
+	static const size_t STRIDE = (sizeof(T) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	static const size_t BLOCK_OBJECT_COUNT = 256;
+
+	struct Pool
+	{
+		void* freeList = nullptr;
+		std::vector<uint8_t*> blocks;
+		size_t allocatedCount = 0;
+		wiSpinLock lock;
+
+		~Pool()
+		{
+			for (uint8_t* block : blocks)
+			{
+				_mm_free(block);
+			}
+		}
+	};
+	static Pool& GetPool()
+	{
+		static Pool pool;
+		return pool;
+	}
+
+public:
+	static void* Allocate(size_t size)
+	{
+		assert(size <= STRIDE);
+		Pool& pool = GetPool();
+		pool.lock.lock();
+		if (pool.freeList == nullptr)
+		{
+			uint8_t* block = (uint8_t*)_mm_malloc(STRIDE * BLOCK_OBJECT_COUNT, ALIGNMENT);
+			pool.blocks.push_back(block);
+			for (size_t i = BLOCK_OBJECT_COUNT; i > 0; --i)
+			{
+				void* slot = block + (i - 1) * STRIDE;
+				*(void**)slot = pool.freeList;
+				pool.freeList = slot;
+			}
+		}
+		void* slot = pool.freeList;
+		pool.freeList = *(void**)slot;
+		pool.allocatedCount++;
+		pool.lock.unlock();
+		return slot;
+	}
+	static void Free(void* ptr)
+	{
+		if (ptr == nullptr)
+		{
+			return;
+		}
+		Pool& pool = GetPool();
+		pool.lock.lock();
+		*(void**)ptr = pool.freeList;
+		pool.freeList = ptr;
+		pool.allocatedCount--;
+		pool.lock.unlock();
+	}
+
+	// Number of live objects
+	static size_t GetAllocatedCount() { return GetPool().allocatedCount; }
+	// Number of objects that fit into the allocated blocks
+	static size_t GetCapacity() { return GetPool().blocks.size() * BLOCK_OBJECT_COUNT; }
+};
+
+// Put this into the binding class instead of ALIGN_16 to allocate its objects from a wiLuaAllocator
+#define WILUA_POOLED(T) void* operator new(size_t size){ return wiLuaAllocator<T>::Allocate(size); } void operator delete(void* p){ wiLuaAllocator<T>::Free(p); }
@@ -0,0 +1,471 @@
+#include "wiLuaScriptPool.h"
+#include "wiJobSystem.h"
+#include "wiBackLog.h"
+
+#include <algorithm>
+#include <sstream>
+#include <iterator>
+
+using namespace std;
+using namespace wiECS;
+using namespace wiScene;
+
+// Script instances of the entities of one state, loaded after wiLua_Globals
+static const char* wiLuaScriptPool_Runner = R"(
+local scripts = {} -- in the order of adding, this is the update order
+local instances = {} -- entity -> instance
+local metatables = {} -- behaviour -> metatable of its instances
+
+function __pool_add(entity, order, behaviourName)
+	local behaviour = _G[behaviourName]
+	if type(behaviour) ~= "table" then
+		return false
+	end
+	local metatable = metatables[behaviour]
+	if metatable == nil then
+		metatable = { __index = behaviour }
+		metatables[behaviour] = metatable
+	end
+	local instance = setmetatable({ entity = entity, __order = order, __started = false }, metatable)
+	table.insert(scripts, instance)
+	instances[entity] = instance
+	return true
+end
+
+function __pool_remove(entity)
+	local instance = instances[entity]
+	if instance == nil then return end
+	instances[entity] = nil
+	for i = 1, #scripts do
+		if scripts[i] == instance then
+			table.remove(scripts, i)
+			break
+		end
+	end
+end
+
+local function call(instance, func, ...)
+	__pool_begin(instance.entity, instance.__order)
+	local success, errorMsg = pcall(func, instance, ...)
+	if not success then
+		__pool_error(errorMsg)
+	end
+end
+
+function __pool_update(dt, fixed)
+	for i = 1, #scripts do
+		local instance = scripts[i]
+		if not instance.__started then
+			instance.__started = true
+			if instance.start ~= nil then
+				call(instance, instance.start)
+			end
+		end
+		local func
+		if fixed then
+			func = instance.fixedUpdate
+		else
+			func = instance.update
+		end
+		if func ~= nil then
+			call(instance, func, dt)
+		end
+	end
+end
+
+function __pool_message(receiver, sender, name, value)
+	if receiver == 0 then
+		for i = 1, #scripts do
+			local instance = scripts[i]
+			if instance.message ~= nil then
+				call(instance, instance.message, sender, name, value)
+			end
+		end
+	else
+		local instance = instances[receiver]
+		if instance ~= nil and instance.message ~= nil then
+			call(instance, instance.message, sender, name, value)
+		end
+	end
+end
+)";
+
+#define WILUA_ERROR_PREFIX "[Lua Error] "
+
+static inline void PostLuaError(lua_State* L)
+{
+	stringstream ss("");
+	ss << WILUA_ERROR_PREFIX << wiLua::SGetString(L, -1);
+	lua_pop(L, 1);
+	wiBackLog::post(ss.str().c_str());
+}
+
+wiLuaScriptPool* wiLuaScriptPool::GetGlobal()
+{
+	static wiLuaScriptPool* globalPool = new wiLuaScriptPool;
+	return globalPool;
+}
+
+void wiLuaScriptPool::RegisterStateFunctions(State& state)
+{
+	lua_State* L = state.lua->GetLuaState();
+	auto add = [&](const char* name, lua_CFunction function) {
+		lua_pushlightuserdata(L, &state);
+		lua_pushcclosure(L, function, 1);
+		lua_setglobal(L, name);
+	};
+	add("GetPosition", LuaGetPosition);
+	add("SetPosition", LuaSetPosition);
+	add("Translate", LuaTranslate);
+	add("Rotate", LuaRotate);
+	add("SetScale", LuaSetScale);
+	add("SendMessage", LuaSendMessage);
+	add("BroadcastMessage", LuaBroadcastMessage);
+	add("__pool_error", LuaPostError);
+	add("__pool_begin", [](lua_State* L) {
+		State* state = (State*)lua_touserdata(L, lua_upvalueindex(1));
+		state->currentEntity = (Entity)wiLua::SGetLongLong(L, 1);
+		state->currentOrder = (uint32_t)wiLua::SGetLongLong(L, 2);
+		return 0;
+	});
+}
+
+void wiLuaScriptPool::Initialize(uint32_t stateCount)
+{
+	states.clear();
+	entities.clear();
+	nextOrder = 1;
+	hostSequence = 0;
+
+	for (uint32_t i = 0; i < stateCount; ++i)
+	{
+		states.push_back(std::make_unique<State>());
+		State& state = *states.back();
+		state.pool = this;
+		state.lua = std::make_unique<wiLua>();
+		RegisterStateFunctions(state);
+		state.lua->RunText(wiLuaScriptPool_Runner);
+	}
+}
+
+bool wiLuaScriptPool::RunText(const std::string& script)
+{
+	bool success = !states.empty();
+	for (auto& state : states)
+	{
+		success &= state->lua->RunText(script);
+	}
+	return success;
+}
+bool wiLuaScriptPool::RunFile(const std::string& filename)
+{
+	bool success = !states.empty();
+	for (auto& state : states)
+	{
+		success &= state->lua->RunFile(filename);
+	}
+	return success;
+}
+
+bool wiLuaScriptPool::AddEntity(Entity entity, const std::string& behaviour)
+{
+	if (states.empty() || entity == INVALID_ENTITY || HasEntity(entity))
+	{
+		return false;
+	}
+
+	ScriptedEntity scripted;
+	scripted.order = nextOrder;
+	scripted.state = (nextOrder - 1) % (uint32_t)states.size();
+
+	lua_State* L = states[scripted.state]->lua->GetLuaState();
+	lua_getglobal(L, "__pool_add");
+	lua_pushinteger(L, (lua_Integer)entity);
+	lua_pushinteger(L, (lua_Integer)scripted.order);
+	wiLua::SSetString(L, behaviour);
+	if (lua_pcall(L, 3, 1, 0) != LUA_OK)
+	{
+		PostLuaError(L);
+		return false;
+	}
+	const bool success = wiLua::SGetBool(L, -1);
+	lua_pop(L, 1);
+
+	if (success)
+	{
+		entities[entity] = scripted;
+		nextOrder++;
+	}
+	return success;
+}
+void wiLuaScriptPool::RemoveEntity(Entity entity)
+{
+	auto it = entities.find(entity);
+	if (it == entities.end())
+	{
+		return;
+	}
+	lua_State* L = states[it->second.state]->lua->GetLuaState();
+	lua_getglobal(L, "__pool_remove");
+	lua_pushinteger(L, (lua_Integer)entity);
+	if (lua_pcall(L, 1, 0, 0) != LUA_OK)
+	{
+		PostLuaError(L);
+	}
+	entities.erase(it);
+}
+
+void wiLuaScriptPool::RouteMessage(Message&& message)
+{
+	if (message.receiver == INVALID_ENTITY)
+	{
+		for (auto& state : states)
+		{
+			state->inbox.push_back(message);
+		}
+	}
+	else
+	{
+		auto it = entities.find(message.receiver);
+		if (it != entities.end())
+		{
+			states[it->second.state]->inbox.push_back(std::move(message));
+		}
+	}
+}
+void wiLuaScriptPool::SendScriptMessage(Entity receiver, const std::string& name, double value)
+{
+	Message message;
+	message.receiver = receiver;
+	message.name = name;
+	message.number = value;
+	message.order = hostSequence++;
+	RouteMessage(std::move(message));
+}
+void wiLuaScriptPool::SendScriptMessage(Entity receiver, const std::string& name, const std::string& value)
+{
+	Message message;
+	message.receiver = receiver;
+	message.name = name;
+	message.isString = true;
+	message.text = value;
+	message.order = hostSequence++;
+	RouteMessage(std::move(message));
+}
+
+void wiLuaScriptPool::Update(Scene& scene, float dt)
+{
+	if (states.empty())
+	{
+		return;
+	}
+	this->scene = &scene;
+	RunStates(dt, false);
+	this->scene = nullptr;
+	Commit(scene);
+}
+void wiLuaScriptPool::FixedUpdate(Scene& scene, float dt)
+{
+	if (states.empty())
+	{
+		return;
+	}
+	this->scene = &scene;
+	RunStates(dt, true);
+	this->scene = nullptr;
+	Commit(scene);
+}
+
+void wiLuaScriptPool::RunStates(float dt, bool fixed)
+{
+	// Every state is used by only one job, the states are not locked:
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)states.size(), 1, [&](wiJobDispatchArgs args) {
+		State& state = *states[args.jobIndex];
+		lua_State* L = state.lua->GetLuaState();
+		state.sequence = 0;
+
+		for (auto& message : state.inbox)
+		{
+			lua_getglobal(L, "__pool_message");
+			lua_pushinteger(L, (lua_Integer)message.receiver);
+			lua_pushinteger(L, (lua_Integer)message.sender);
+			wiLua::SSetString(L, message.name);
+			if (message.isString)
+			{
+				wiLua::SSetString(L, message.text);
+			}
+			else
+			{
+				wiLua::SSetDouble(L, message.number);
+			}
+			if (lua_pcall(L, 4, 0, 0) != LUA_OK)
+			{
+				PostLuaError(L);
+			}
+		}
+		state.inbox.clear();
+
+		lua_getglobal(L, "__pool_update");
+		wiLua::SSetDouble(L, (double)dt);
+		wiLua::SSetBool(L, fixed);
+		if (lua_pcall(L, 2, 0, 0) != LUA_OK)
+		{
+			PostLuaError(L);
+		}
+	});
+	wiJobSystem::Wait(ctx);
+}
+
+void wiLuaScriptPool::Commit(Scene& scene)
+{
+	// The order keys are unique, so sorting gives the same sequence for any state count:
+	commitCommands.clear();
+	commitMessages.clear();
+	for (auto& state : states)
+	{
+		commitCommands.insert(commitCommands.end(), state->commands.begin(), state->commands.end());
+		state->commands.clear();
+		std::move(state->outbox.begin(), state->outbox.end(), std::back_inserter(commitMessages));
+		state->outbox.clear();
+	}
+	std::sort(commitCommands.begin(), commitCommands.end(), [](const Command& a, const Command& b) {
+		return a.order < b.order;
+	});
+	std::sort(commitMessages.begin(), commitMessages.end(), [](const Message& a, const Message& b) {
+		return a.order < b.order;
+	});
+
+	for (auto& command : commitCommands)
+	{
+		TransformComponent* transform = scene.transforms.GetComponent(command.entity);
+		if (transform == nullptr)
+		{
+			continue;
+		}
+		switch (command.type)
+		{
+		case Command::SET_POSITION:
+			transform->translation_local = command.value;
+			transform->SetDirty();
+			break;
+		case Command::TRANSLATE:
+			transform->Translate(command.value);
+			break;
+		case Command::ROTATE:
+			transform->RotateRollPitchYaw(command.value);
+			break;
+		case Command::SET_SCALE:
+			transform->scale_local = command.value;
+			transform->SetDirty();
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (auto& message : commitMessages)
+	{
+		RouteMessage(std::move(message));
+	}
+	commitMessages.clear();
+}
+
+
+int wiLuaScriptPool::LuaPostError(lua_State* L)
+{
+	PostLuaError(L);
+	return 0;
+}
+
+int wiLuaScriptPool::LuaGetPosition(lua_State* L)
+{
+	State* state = (State*)lua_touserdata(L, lua_upvalueindex(1));
+	if (wiLua::SGetArgCount(L) < 1)
+	{
+		wiLua::SError(L, "GetPosition(int entity) not enough arguments!");
+		return 0;
+	}
+	XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+	const Scene* scene = state->pool->scene;
+	if (scene != nullptr)
+	{
+		const TransformComponent* transform = scene->transforms.GetComponent((Entity)wiLua::SGetLongLong(L, 1));
+		if (transform != nullptr)
+		{
+			position = transform->translation_local;
+		}
+	}
+	wiLua::SSetFloat(L, position.x);
+	wiLua::SSetFloat(L, position.y);
+	wiLua::SSetFloat(L, position.z);
+	return 3;
+}
+
+int wiLuaScriptPool::PushCommand(lua_State* L, Command::TYPE type, const char* signature)
+{
+	State* state = (State*)lua_touserdata(L, lua_upvalueindex(1));
+	if (wiLua::SGetArgCount(L) < 4)
+	{
+		wiLua::SError(L, std::string(signature) + " not enough arguments!");
+		return 0;
+	}
+	Command command;
+	command.type = type;
+	command.entity = (Entity)wiLua::SGetLongLong(L, 1);
+	command.value = wiLua::SGetFloat3(L, 2);
+	command.order = (uint64_t(state->currentOrder) << 32) | state->sequence++;
+	state->commands.push_back(command);
+	return 0;
+}
+int wiLuaScriptPool::LuaSetPosition(lua_State* L)
+{
+	return PushCommand(L, Command::SET_POSITION, "SetPosition(int entity, float x,y,z)");
+}
+int wiLuaScriptPool::LuaTranslate(lua_State* L)
+{
+	return PushCommand(L, Command::TRANSLATE, "Translate(int entity, float x,y,z)");
+}
+int wiLuaScriptPool::LuaRotate(lua_State* L)
+{
+	return PushCommand(L, Command::ROTATE, "Rotate(int entity, float roll,pitch,yaw)");
+}
+int wiLuaScriptPool::LuaSetScale(lua_State* L)
+{
+	return PushCommand(L, Command::SET_SCALE, "SetScale(int entity, float x,y,z)");
+}
+
+int wiLuaScriptPool::PushMessage(lua_State* L, bool broadcast)
+{
+	State* state = (State*)lua_touserdata(L, lua_upvalueindex(1));
+	const int first = broadcast ? 1 : 2;
+	if (wiLua::SGetArgCount(L) < first)
+	{
+		wiLua::SError(L, broadcast ? "BroadcastMessage(string name, opt value) not enough arguments!" : "SendMessage(int entity, string name, opt value) not enough arguments!");
+		return 0;
+	}
+	Message message;
+	message.sender = state->currentEntity;
+	message.receiver = broadcast ? INVALID_ENTITY : (Entity)wiLua::SGetLongLong(L, 1);
+	message.name = wiLua::SGetString(L, first);
+	if (lua_type(L, first + 1) == LUA_TSTRING)
+	{
+		message.isString = true;
+		message.text = wiLua::SGetString(L, first + 1);
+	}
+	else
+	{
+		message.number = wiLua::SGetDouble(L, first + 1);
+	}
+	message.order = (uint64_t(state->currentOrder) << 32) | state->sequence++;
+	state->outbox.push_back(std::move(message));
+	return 0;
+}
+int wiLuaScriptPool::LuaSendMessage(lua_State* L)
+{
+	return PushMessage(L, false);
+}
+int wiLuaScriptPool::LuaBroadcastMessage(lua_State* L)
+{
+	return PushMessage(L, true);
+}
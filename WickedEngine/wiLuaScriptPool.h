@@ -0,0 +1,126 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiLua.h"
+#include "wiECS.h"
+#include "wiScene.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+// Pool of independent Lua states that run the scripts of entities in parallel on wiJobSystem
+//	Every scripted entity is owned by one state, the states don't share any Lua data and are updated by separate jobs.
+//	While the scripts are running, the scene is read-only: the scene mutations are recorded as commands and applied after every state finished.
+//	The commands and the messages between the entities are ordered by the order in which the entities were added, so the result
+//	doesn't depend on the number of states or on which thread runs which state.
+//
+//	A behaviour is a global Lua table that is loaded into every state with RunText() or RunFile(), its methods are called with a per-entity instance table:
+//		Rotator = {
+//			speed = 1,
+//			start = function(self) end,											-- before the first update of the entity
+//			update = function(self, dt) Rotate(self.entity, 0, self.speed * dt, 0) end,
+//			fixedUpdate = function(self, dt) end,
+//			message = function(self, sender, name, value) end,					-- a message was sent to the entity or broadcast
+//		}
+//	Scripts of different entities must communicate with messages, Lua globals are only shared by the entities of the same state.
+class wiLuaScriptPool
+{
+public:
+	struct Message
+	{
+		wiECS::Entity sender = wiECS::INVALID_ENTITY;	// INVALID_ENTITY if it was sent from C++
+		wiECS::Entity receiver = wiECS::INVALID_ENTITY;	// INVALID_ENTITY if it is broadcast to every scripted entity
+		std::string name;
+		bool isString = false;
+		double number = 0;
+		std::string text;
+		uint64_t order = 0;		// (add order of the sending entity << 32) | sequence, the messages of the scripts are delivered in this order
+	};
+
+private:
+	struct Command
+	{
+		enum TYPE
+		{
+			SET_POSITION,
+			TRANSLATE,
+			ROTATE,
+			SET_SCALE,
+		} type;
+		wiECS::Entity entity;
+		XMFLOAT3 value;
+		uint64_t order;		// same as Message::order
+	};
+
+	struct State
+	{
+		wiLuaScriptPool* pool = nullptr;
+		std::unique_ptr<wiLua> lua;
+		std::vector<Command> commands;
+		std::vector<Message> outbox;	// sent during the current update
+		std::vector<Message> inbox;		// delivered at the beginning of the next update
+		wiECS::Entity currentEntity = wiECS::INVALID_ENTITY;
+		uint32_t currentOrder = 0;
+		uint32_t sequence = 0;
+	};
+	std::vector<std::unique_ptr<State>> states;
+
+	struct ScriptedEntity
+	{
+		uint32_t state;
+		uint32_t order;
+	};
+	std::unordered_map<wiECS::Entity, ScriptedEntity> entities;
+	uint32_t nextOrder = 1;		// 0 is the order of the messages sent from C++
+	uint32_t hostSequence = 0;	// sequence of the messages sent from C++
+
+	const wiScene::Scene* scene = nullptr;	// read by the scripts during the update
+	std::vector<Command> commitCommands;
+	std::vector<Message> commitMessages;
+
+	static void RegisterStateFunctions(State& state);
+	void RunStates(float dt, bool fixed);
+	void Commit(wiScene::Scene& scene);
+	// Append the message to the inbox of the receiver, or to every inbox if it is broadcast
+	void RouteMessage(Message&& message);
+
+	static int LuaGetPosition(lua_State* L);
+	static int LuaSetPosition(lua_State* L);
+	static int LuaTranslate(lua_State* L);
+	static int LuaRotate(lua_State* L);
+	static int LuaSetScale(lua_State* L);
+	static int LuaSendMessage(lua_State* L);
+	static int LuaBroadcastMessage(lua_State* L);
+	static int LuaPostError(lua_State* L);
+	static int PushMessage(lua_State* L, bool broadcast);
+	static int PushCommand(lua_State* L, Command::TYPE type, const char* signature);
+
+public:
+	// Get the script pool that is updated by MainComponent
+	static wiLuaScriptPool* GetGlobal();
+
+	// Create the Lua states, this removes every scripted entity and loaded script
+	void Initialize(uint32_t stateCount);
+	uint32_t GetStateCount() const { return (uint32_t)states.size(); }
+	uint32_t GetEntityCount() const { return (uint32_t)entities.size(); }
+
+	// Load behaviours into every state
+	bool RunText(const std::string& script);
+	bool RunFile(const std::string& filename);
+
+	// Attach a behaviour to the entity, the entity is assigned to the states round-robin
+	//	returns false if the entity already has a script or the behaviour doesn't exist
+	bool AddEntity(wiECS::Entity entity, const std::string& behaviour);
+	void RemoveEntity(wiECS::Entity entity);
+	bool HasEntity(wiECS::Entity entity) const { return entities.count(entity) > 0; }
+
+	// Send a message from C++, it is delivered at the beginning of the next update
+	//	receiver	: INVALID_ENTITY to broadcast to every scripted entity
+	void SendScriptMessage(wiECS::Entity receiver, const std::string& name, double value = 0);
+	void SendScriptMessage(wiECS::Entity receiver, const std::string& name, const std::string& value);
+
+	// Deliver the messages, run the update() (or fixedUpdate()) of every script in parallel, then apply the scene mutations in a deterministic order
+	void Update(wiScene::Scene& scene, float dt);
+	void FixedUpdate(wiScene::Scene& scene, float dt);
+};
@@ -0,0 +1,114 @@
+#include "wiLuaScriptPool_BindLua.h"
+#include "wiLuaScriptPool.h"
+
+using namespace std;
+using namespace wiECS;
+
+namespace wiLuaScriptPool_BindLua
+{
+
+int ScriptPoolInitialize(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiLuaScriptPool::GetGlobal()->Initialize((uint32_t)wiLua::SGetInt(L, 1));
+	}
+	else
+	{
+		wiLua::SError(L, "ScriptPoolInitialize(int stateCount) not enough arguments!");
+	}
+	return 0;
+}
+int ScriptPoolGetStateCount(lua_State* L)
+{
+	wiLua::SSetInt(L, (int)wiLuaScriptPool::GetGlobal()->GetStateCount());
+	return 1;
+}
+int ScriptPoolRunFile(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiLua::SSetBool(L, wiLuaScriptPool::GetGlobal()->RunFile(wiLua::SGetString(L, 1)));
+		return 1;
+	}
+	wiLua::SError(L, "ScriptPoolRunFile(string filename) not enough arguments!");
+	return 0;
+}
+int ScriptPoolRunText(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiLua::SSetBool(L, wiLuaScriptPool::GetGlobal()->RunText(wiLua::SGetString(L, 1)));
+		return 1;
+	}
+	wiLua::SError(L, "ScriptPoolRunText(string script) not enough arguments!");
+	return 0;
+}
+int ScriptPoolAddEntity(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		wiLua::SSetBool(L, wiLuaScriptPool::GetGlobal()->AddEntity((Entity)wiLua::SGetLongLong(L, 1), wiLua::SGetString(L, 2)));
+		return 1;
+	}
+	wiLua::SError(L, "ScriptPoolAddEntity(int entity, string behaviour) not enough arguments!");
+	return 0;
+}
+int ScriptPoolRemoveEntity(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiLuaScriptPool::GetGlobal()->RemoveEntity((Entity)wiLua::SGetLongLong(L, 1));
+	}
+	else
+	{
+		wiLua::SError(L, "ScriptPoolRemoveEntity(int entity) not enough arguments!");
+	}
+	return 0;
+}
+int ScriptPoolSendMessage(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		Entity receiver = (Entity)wiLua::SGetLongLong(L, 1);
+		string name = wiLua::SGetString(L, 2);
+		if (argc > 2 && lua_type(L, 3) == LUA_TSTRING)
+		{
+			wiLuaScriptPool::GetGlobal()->SendScriptMessage(receiver, name, wiLua::SGetString(L, 3));
+		}
+		else
+		{
+			wiLuaScriptPool::GetGlobal()->SendScriptMessage(receiver, name, argc > 2 ? wiLua::SGetDouble(L, 3) : 0.0);
+		}
+	}
+	else
+	{
+		wiLua::SError(L, "ScriptPoolSendMessage(int entity, string name, opt value) not enough arguments!");
+	}
+	return 0;
+}
+
+void Bind()
+{
+	static bool initialized = false;
+	if (!initialized)
+	{
+		initialized = true;
+
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolInitialize", ScriptPoolInitialize);
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolGetStateCount", ScriptPoolGetStateCount);
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolRunFile", ScriptPoolRunFile);
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolRunText", ScriptPoolRunText);
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolAddEntity", ScriptPoolAddEntity);
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolRemoveEntity", ScriptPoolRemoveEntity);
+		wiLua::GetGlobal()->RegisterFunc("ScriptPoolSendMessage", ScriptPoolSendMessage);
+	}
+}
+
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "wiLua.h"
+#include "wiLuna.h"
+
+namespace wiLuaScriptPool_BindLua
+{
+	void Bind();
+}
@@ -447,4 +447,93 @@ namespace wiMath
 
 		return retval;
 	}
+
+	uint32_t EncodeOctahedral(const XMFLOAT3& normal)
+	{
+		const float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (l1 <= 0)
+		{
+			return 0;
+		}
+		float x = normal.x / l1;
+		float y = normal.y / l1;
+		if (normal.z < 0)
+		{
+			// fold the lower hemisphere over the diagonals:
+			const float fx = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+			const float fy = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+			x = fx;
+			y = fy;
+		}
+
+		const int16_t qx = (int16_t)std::round(Clamp(x, -1, 1) * 32767.0f);
+		const int16_t qy = (int16_t)std::round(Clamp(y, -1, 1) * 32767.0f);
+		return (uint32_t)(uint16_t)qx | ((uint32_t)(uint16_t)qy << 16);
+	}
+	XMFLOAT3 DecodeOctahedral(uint32_t value)
+	{
+		XMFLOAT3 normal;
+		normal.x = std::max((float)(int16_t)(value & 0xFFFF) / 32767.0f, -1.0f);
+		normal.y = std::max((float)(int16_t)(value >> 16) / 32767.0f, -1.0f);
+		normal.z = 1 - std::abs(normal.x) - std::abs(normal.y);
+		const float t = std::max(-normal.z, 0.0f);
+		normal.x += normal.x >= 0 ? -t : t;
+		normal.y += normal.y >= 0 ? -t : t;
+
+		XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&normal)));
+		return normal;
+	}
+	void QuantizePosition(const XMFLOAT3& position, const XMFLOAT3& aabb_min, const XMFLOAT3& aabb_max, uint16_t result[3])
+	{
+		const float p[] = { position.x, position.y, position.z };
+		const float mi[] = { aabb_min.x, aabb_min.y, aabb_min.z };
+		const float ma[] = { aabb_max.x, aabb_max.y, aabb_max.z };
+		for (int i = 0; i < 3; ++i)
+		{
+			const float extent = ma[i] - mi[i];
+			result[i] = extent > 0 ? (uint16_t)std::round(saturate((p[i] - mi[i]) / extent) * 65535.0f) : 0;
+		}
+	}
+	XMFLOAT3 DequantizePosition(const uint16_t value[3], const XMFLOAT3& aabb_min, const XMFLOAT3& aabb_max)
+	{
+		return XMFLOAT3(
+			aabb_min.x + (float)value[0] / 65535.0f * (aabb_max.x - aabb_min.x),
+			aabb_min.y + (float)value[1] / 65535.0f * (aabb_max.y - aabb_min.y),
+			aabb_min.z + (float)value[2] / 65535.0f * (aabb_max.z - aabb_min.z)
+		);
+	}
+	uint32_t QuantizeBoneWeights(const XMFLOAT4& weights)
+	{
+		float w[] = { std::max(weights.x, 0.0f), std::max(weights.y, 0.0f), std::max(weights.z, 0.0f), std::max(weights.w, 0.0f) };
+		const float sum = w[0] + w[1] + w[2] + w[3];
+		if (sum <= 0)
+		{
+			return 0;
+		}
+
+		int q[4];
+		int total = 0;
+		int largest = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			q[i] = (int)std::round(w[i] / sum * 255.0f);
+			total += q[i];
+			if (w[i] > w[largest])
+			{
+				largest = i;
+			}
+		}
+		q[largest] = std::max(0, std::min(255, q[largest] + 255 - total));
+
+		return (uint32_t)q[0] | ((uint32_t)q[1] << 8) | ((uint32_t)q[2] << 16) | ((uint32_t)q[3] << 24);
+	}
+	XMFLOAT4 DequantizeBoneWeights(uint32_t value)
+	{
+		return XMFLOAT4(
+			(float)((value >> 0) & 0xFF) / 255.0f,
+			(float)((value >> 8) & 0xFF) / 255.0f,
+			(float)((value >> 16) & 0xFF) / 255.0f,
+			(float)((value >> 24) & 0xFF) / 255.0f
+		);
+	}
 }
@@ -166,5 +166,17 @@ namespace wiMath
 	uint32_t CompressNormal(const XMFLOAT3& normal);
 	uint32_t CompressColor(const XMFLOAT3& color);
 	uint32_t CompressColor(const XMFLOAT4& color);
+
+	// Vertex quantization of the serialized meshes, the layouts are described in ShaderInterop_VertexQuantization.h
+
+	// Octahedral encoding of a unit vector into two 16-bit snorm values (x: low bits, y: high bits)
+	uint32_t EncodeOctahedral(const XMFLOAT3& normal);
+	XMFLOAT3 DecodeOctahedral(uint32_t value);
+	// Map a position inside the [aabb_min, aabb_max] box to three 16-bit unorm values
+	void QuantizePosition(const XMFLOAT3& position, const XMFLOAT3& aabb_min, const XMFLOAT3& aabb_max, uint16_t result[3]);
+	XMFLOAT3 DequantizePosition(const uint16_t value[3], const XMFLOAT3& aabb_min, const XMFLOAT3& aabb_max);
+	// Quantize bone weights into four 8-bit unorm values, the rounding error is moved to the largest weight so that the sum stays exactly 1
+	uint32_t QuantizeBoneWeights(const XMFLOAT4& weights);
+	XMFLOAT4 DequantizeBoneWeights(uint32_t value);
 };
 
@@ -0,0 +1,1135 @@
+#include "wiMeshOptimizer.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+namespace wiMeshOptimizer
+{
+	namespace simplifier
+	{
+		// Symmetric 4x4 matrix of the plane distance error, with the accumulated weight:
+		struct Quadric
+		{
+			double a00 = 0, a11 = 0, a22 = 0;
+			double a01 = 0, a02 = 0, a12 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double w = 0;
+
+			void AddPlane(double nx, double ny, double nz, double d, double weight)
+			{
+				a00 += nx * nx * weight;
+				a11 += ny * ny * weight;
+				a22 += nz * nz * weight;
+				a01 += nx * ny * weight;
+				a02 += nx * nz * weight;
+				a12 += ny * nz * weight;
+				b0 += nx * d * weight;
+				b1 += ny * d * weight;
+				b2 += nz * d * weight;
+				c += d * d * weight;
+				w += weight;
+			}
+			void Add(const Quadric& other)
+			{
+				a00 += other.a00;
+				a11 += other.a11;
+				a22 += other.a22;
+				a01 += other.a01;
+				a02 += other.a02;
+				a12 += other.a12;
+				b0 += other.b0;
+				b1 += other.b1;
+				b2 += other.b2;
+				c += other.c;
+				w += other.w;
+			}
+			// Returns the weighted average squared distance of the point from the accumulated planes
+			double Error(double x, double y, double z) const
+			{
+				double result =
+					a00 * x * x + a11 * y * y + a22 * z * z +
+					2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+					2 * (b0 * x + b1 * y + b2 * z) +
+					c;
+				return w > 0 ? std::abs(result) / w : 0;
+			}
+		};
+
+		struct Vec3
+		{
+			double x, y, z;
+		};
+		inline Vec3 Sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		inline Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		inline double Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		inline double Length(const Vec3& a) { return std::sqrt(Dot(a, a)); }
+
+		enum VERTEX_KIND : uint8_t
+		{
+			VERTEX_MANIFOLD,	// interior vertex, can collapse to any neighbour
+			VERTEX_BORDER,		// vertex on an open border, can collapse along the border
+			VERTEX_LOCKED,		// seam or complex vertex, never collapses
+		};
+
+		struct Collapse
+		{
+			uint32_t source;
+			uint32_t target;
+			double error;
+		};
+
+		inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+		{
+			return ((uint64_t)a << 32) | (uint64_t)b;
+		}
+	}
+
+	size_t Simplify(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		const XMFLOAT3* positions,
+		size_t vertex_count,
+		size_t target_index_count,
+		float target_error,
+		float* result_error
+	)
+	{
+		using namespace simplifier;
+
+		assert(index_count % 3 == 0);
+
+		std::vector<uint32_t> result(indices, indices + index_count);
+		double max_error = 0;
+
+		// Positions are normalized to the unit cube, so that errors are relative to the mesh extents:
+		Vec3 minimum = { DBL_MAX, DBL_MAX, DBL_MAX };
+		Vec3 maximum = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (uint32_t index : result)
+		{
+			const XMFLOAT3& p = positions[index];
+			minimum = { std::min(minimum.x, (double)p.x), std::min(minimum.y, (double)p.y), std::min(minimum.z, (double)p.z) };
+			maximum = { std::max(maximum.x, (double)p.x), std::max(maximum.y, (double)p.y), std::max(maximum.z, (double)p.z) };
+		}
+		const double extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+		const double scale = extent > 0 ? 1.0 / extent : 0;
+		std::vector<Vec3> points(vertex_count);
+		for (size_t i = 0; i < vertex_count; ++i)
+		{
+			points[i] = { (positions[i].x - minimum.x) * scale, (positions[i].y - minimum.y) * scale, (positions[i].z - minimum.z) * scale };
+		}
+
+		// Vertices with identical positions are welded for topology, these mark attribute seams:
+		std::vector<uint32_t> remap(vertex_count);
+		std::vector<uint32_t> wedgeCount(vertex_count, 0);
+		{
+			struct PositionHasher
+			{
+				size_t operator()(const XMFLOAT3& p) const
+				{
+					uint32_t h[3];
+					memcpy(h, &p, sizeof(h));
+					return (size_t)(h[0] * 73856093u ^ h[1] * 19349663u ^ h[2] * 83492791u);
+				}
+			};
+			struct PositionEqual
+			{
+				bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+				{
+					return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+				}
+			};
+			std::unordered_map<XMFLOAT3, uint32_t, PositionHasher, PositionEqual> positionToVertex;
+			std::vector<uint8_t> referenced(vertex_count, 0);
+			for (uint32_t index : result)
+			{
+				referenced[index] = 1;
+			}
+			for (uint32_t i = 0; i < (uint32_t)vertex_count; ++i)
+			{
+				remap[i] = i;
+				if (referenced[i])
+				{
+					auto it = positionToVertex.find(positions[i]);
+					if (it == positionToVertex.end())
+					{
+						positionToVertex[positions[i]] = i;
+					}
+					else
+					{
+						remap[i] = it->second;
+					}
+					wedgeCount[remap[i]]++;
+				}
+			}
+		}
+
+		// Classify vertices by the welded topology:
+		std::vector<uint8_t> kind(vertex_count, VERTEX_MANIFOLD);
+		std::vector<Quadric> quadrics(vertex_count);
+		{
+			std::unordered_map<uint64_t, uint32_t> halfEdges;
+			halfEdges.reserve(index_count);
+			for (size_t i = 0; i < index_count; i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint32_t a = remap[result[i + e]];
+					const uint32_t b = remap[result[i + (e + 1) % 3]];
+					halfEdges[EdgeKey(a, b)]++;
+				}
+			}
+
+			std::vector<uint32_t> borderEdgeCount(vertex_count, 0);
+			for (size_t i = 0; i < index_count; i += 3)
+			{
+				const Vec3& p0 = points[result[i + 0]];
+				const Vec3& p1 = points[result[i + 1]];
+				const Vec3& p2 = points[result[i + 2]];
+				Vec3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+				const double area = Length(normal);
+				if (area > 0)
+				{
+					normal = { normal.x / area, normal.y / area, normal.z / area };
+				}
+
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint32_t va = result[i + e];
+					const uint32_t vb = result[i + (e + 1) % 3];
+					const uint32_t a = remap[va];
+					const uint32_t b = remap[vb];
+					const uint32_t count = halfEdges[EdgeKey(a, b)];
+					auto opposite = halfEdges.find(EdgeKey(b, a));
+					const uint32_t oppositeCount = opposite == halfEdges.end() ? 0 : opposite->second;
+
+					if (count > 1 || oppositeCount > 1)
+					{
+						// non-manifold edge
+						kind[a] = VERTEX_LOCKED;
+						kind[b] = VERTEX_LOCKED;
+					}
+					else if (oppositeCount == 0)
+					{
+						borderEdgeCount[a]++;
+						borderEdgeCount[b]++;
+
+						// Border edges get a perpendicular plane, so that the border shape is kept:
+						const Vec3 edge = Sub(points[vb], points[va]);
+						Vec3 border_normal = Cross(edge, normal);
+						const double length = Length(border_normal);
+						if (length > 0)
+						{
+							border_normal = { border_normal.x / length, border_normal.y / length, border_normal.z / length };
+							const double d = -Dot(border_normal, points[va]);
+							const double weight = Dot(edge, edge) * 10;
+							quadrics[a].AddPlane(border_normal.x, border_normal.y, border_normal.z, d, weight);
+							quadrics[b].AddPlane(border_normal.x, border_normal.y, border_normal.z, d, weight);
+						}
+					}
+				}
+
+				if (area > 0)
+				{
+					const double d = -Dot(normal, p0);
+					quadrics[remap[result[i + 0]]].AddPlane(normal.x, normal.y, normal.z, d, area);
+					quadrics[remap[result[i + 1]]].AddPlane(normal.x, normal.y, normal.z, d, area);
+					quadrics[remap[result[i + 2]]].AddPlane(normal.x, normal.y, normal.z, d, area);
+				}
+			}
+
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				if (remap[i] != i)
+				{
+					continue;
+				}
+				if (wedgeCount[i] > 1)
+				{
+					kind[i] = VERTEX_LOCKED;
+				}
+				else if (kind[i] != VERTEX_LOCKED && borderEdgeCount[i] > 0)
+				{
+					kind[i] = borderEdgeCount[i] == 2 ? VERTEX_BORDER : VERTEX_LOCKED;
+				}
+			}
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				kind[i] = kind[remap[i]];
+				quadrics[i] = quadrics[remap[i]];
+			}
+		}
+
+		const double error_limit = (double)target_error * (double)target_error;
+
+		std::vector<uint32_t> adjacencyOffsets(vertex_count + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<Collapse> collapses;
+		std::vector<Collapse> bestCollapses(vertex_count);
+		std::vector<uint32_t> collapseRemap(vertex_count);
+		std::vector<uint8_t> collapseLocked(vertex_count);
+		std::vector<uint32_t> neighbours_source;
+		std::vector<uint32_t> neighbours_target;
+
+		while (result.size() > target_index_count)
+		{
+			// Build vertex -> triangle adjacency:
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t index : result)
+			{
+				adjacencyOffsets[index + 1]++;
+			}
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+			}
+			adjacency.resize(result.size());
+			{
+				std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); ++i)
+				{
+					adjacency[cursor[result[i]]++] = (uint32_t)(i / 3);
+				}
+			}
+
+			// Find the cheapest collapse of every vertex, a vertex can only collapse into one of its neighbours (the error is measured at the neighbour position):
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				bestCollapses[i] = { (uint32_t)i, (uint32_t)i, DBL_MAX };
+			}
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint32_t a = result[i + e];
+					const uint32_t b = result[i + (e + 1) % 3];
+					const uint32_t pair[2][2] = { { a, b }, { b, a } };
+					for (auto& p : pair)
+					{
+						const uint32_t source = p[0];
+						const uint32_t target = p[1];
+						if (kind[source] == VERTEX_LOCKED)
+						{
+							continue;
+						}
+						if (kind[source] == VERTEX_BORDER && kind[target] == VERTEX_MANIFOLD)
+						{
+							continue;
+						}
+						const Vec3& t = points[target];
+						const double error = quadrics[source].Error(t.x, t.y, t.z);
+						Collapse& best = bestCollapses[source];
+						if (error < best.error || (error == best.error && target < best.target))
+						{
+							best = { source, target, error };
+						}
+					}
+				}
+			}
+			collapses.clear();
+			for (const Collapse& collapse : bestCollapses)
+			{
+				if (collapse.error <= error_limit)
+				{
+					collapses.push_back(collapse);
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				if (a.error != b.error)
+					return a.error < b.error;
+				if (a.source != b.source)
+					return a.source < b.source;
+				return a.target < b.target;
+			});
+
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				collapseRemap[i] = (uint32_t)i;
+			}
+			std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+			const size_t triangle_goal = (result.size() - target_index_count) / 3;
+			size_t triangles_removed = 0;
+			size_t collapse_count = 0;
+			double pass_error = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.error > error_limit)
+				{
+					break;
+				}
+				const uint32_t source = collapse.source;
+				const uint32_t target = collapse.target;
+				if (collapseLocked[source] || collapseLocked[target])
+				{
+					continue;
+				}
+
+				// Count the triangles sharing the edge, gather the one-ring neighbours of both vertices:
+				uint32_t shared = 0;
+				neighbours_source.clear();
+				neighbours_target.clear();
+				for (uint32_t k = adjacencyOffsets[source]; k < adjacencyOffsets[source + 1]; ++k)
+				{
+					const uint32_t* tri = &result[adjacency[k] * 3];
+					if (tri[0] == target || tri[1] == target || tri[2] == target)
+					{
+						shared++;
+					}
+					for (int c = 0; c < 3; ++c)
+					{
+						if (tri[c] != source)
+						{
+							neighbours_source.push_back(remap[tri[c]]);
+						}
+					}
+				}
+				for (uint32_t k = adjacencyOffsets[target]; k < adjacencyOffsets[target + 1]; ++k)
+				{
+					const uint32_t* tri = &result[adjacency[k] * 3];
+					for (int c = 0; c < 3; ++c)
+					{
+						if (tri[c] != target)
+						{
+							neighbours_target.push_back(remap[tri[c]]);
+						}
+					}
+				}
+
+				// Manifold edges have two triangles, border edges have one, and border vertices must slide along border edges:
+				if (shared == 0 || shared > 2 || (kind[source] == VERTEX_BORDER && shared != 1) || (kind[source] == VERTEX_MANIFOLD && shared != 2))
+				{
+					continue;
+				}
+
+				// Link condition: the two vertices can only share the neighbours opposite to the collapsing edge:
+				std::sort(neighbours_source.begin(), neighbours_source.end());
+				neighbours_source.erase(std::unique(neighbours_source.begin(), neighbours_source.end()), neighbours_source.end());
+				std::sort(neighbours_target.begin(), neighbours_target.end());
+				neighbours_target.erase(std::unique(neighbours_target.begin(), neighbours_target.end()), neighbours_target.end());
+				uint32_t common = 0;
+				for (size_t a = 0, b = 0; a < neighbours_source.size() && b < neighbours_target.size();)
+				{
+					if (neighbours_source[a] < neighbours_target[b])
+					{
+						a++;
+					}
+					else if (neighbours_source[a] > neighbours_target[b])
+					{
+						b++;
+					}
+					else
+					{
+						common++;
+						a++;
+						b++;
+					}
+				}
+				if (common != shared)
+				{
+					continue;
+				}
+
+				// Reject collapses that would flip or severely rotate triangles:
+				bool flip = false;
+				for (uint32_t k = adjacencyOffsets[source]; k < adjacencyOffsets[source + 1] && !flip; ++k)
+				{
+					const uint32_t* tri = &result[adjacency[k] * 3];
+					if (tri[0] == target || tri[1] == target || tri[2] == target)
+					{
+						continue;
+					}
+					const int c = tri[0] == source ? 0 : (tri[1] == source ? 1 : 2);
+					const Vec3& p1 = points[tri[(c + 1) % 3]];
+					const Vec3& p2 = points[tri[(c + 2) % 3]];
+					const Vec3 before = Cross(Sub(p1, points[source]), Sub(p2, points[source]));
+					const Vec3 after = Cross(Sub(p1, points[target]), Sub(p2, points[target]));
+					flip = Dot(before, after) <= 0.25 * Length(before) * Length(after);
+				}
+				if (flip)
+				{
+					continue;
+				}
+
+				collapseRemap[source] = target;
+				pass_error = std::max(pass_error, collapse.error);
+				collapse_count++;
+				triangles_removed += shared;
+
+				// Lock the whole neighbourhood, the adjacency and flip tests are only valid for the current topology:
+				for (uint32_t k = adjacencyOffsets[source]; k < adjacencyOffsets[source + 1]; ++k)
+				{
+					const uint32_t* tri = &result[adjacency[k] * 3];
+					collapseLocked[tri[0]] = 1;
+					collapseLocked[tri[1]] = 1;
+					collapseLocked[tri[2]] = 1;
+				}
+				collapseLocked[target] = 1;
+
+				if (triangles_removed >= triangle_goal)
+				{
+					break;
+				}
+			}
+
+			if (collapse_count == 0)
+			{
+				break;
+			}
+			max_error = std::max(max_error, pass_error);
+
+			// Apply collapses, remove degenerate triangles:
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				if (collapseRemap[i] != i)
+				{
+					quadrics[collapseRemap[i]].Add(quadrics[i]);
+				}
+			}
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				const uint32_t a = collapseRemap[result[i + 0]];
+				const uint32_t b = collapseRemap[result[i + 1]];
+				const uint32_t c = collapseRemap[result[i + 2]];
+				if (a != b && a != c && b != c)
+				{
+					result[write++] = a;
+					result[write++] = b;
+					result[write++] = c;
+				}
+			}
+			result.resize(write);
+		}
+
+		if (result_error != nullptr)
+		{
+			*result_error = (float)std::sqrt(max_error);
+		}
+		std::copy(result.begin(), result.end(), destination);
+		return result.size();
+	}
+
+	namespace vertexcache
+	{
+		// Triangles referencing each vertex, in compressed row storage:
+		struct TriangleAdjacency
+		{
+			std::vector<uint32_t> counts;
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> triangles;
+
+			void Create(const uint32_t* indices, size_t index_count, size_t vertex_count)
+			{
+				counts.assign(vertex_count, 0);
+				for (size_t i = 0; i < index_count; ++i)
+				{
+					counts[indices[i]]++;
+				}
+				offsets.resize(vertex_count + 1);
+				offsets[0] = 0;
+				for (size_t i = 0; i < vertex_count; ++i)
+				{
+					offsets[i + 1] = offsets[i] + counts[i];
+				}
+				triangles.resize(index_count);
+				std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < index_count; ++i)
+				{
+					triangles[fill[indices[i]]++] = uint32_t(i / 3);
+				}
+			}
+		};
+
+		// FIFO cache simulation: a vertex is in the cache if it was one of the last cache_size vertices that were inserted
+		struct FIFOCache
+		{
+			std::vector<uint32_t> timestamps;
+			uint32_t time = 0;
+			uint32_t cache_size = 0;
+
+			void Reset(size_t vertex_count, uint32_t size)
+			{
+				timestamps.assign(vertex_count, 0);
+				cache_size = size;
+				time = cache_size + 1;
+			}
+			// Returns true if the vertex was not in the cache
+			inline bool Access(uint32_t vertex)
+			{
+				if (time - timestamps[vertex] > cache_size)
+				{
+					timestamps[vertex] = time++;
+					return true;
+				}
+				return false;
+			}
+			// Flush the cache without clearing every timestamp
+			inline void Flush()
+			{
+				time += cache_size + 1;
+			}
+		};
+	}
+
+	void OptimizeVertexCache(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		size_t vertex_count,
+		uint32_t cache_size
+	)
+	{
+		using namespace vertexcache;
+
+		assert(index_count % 3 == 0);
+		if (index_count == 0)
+		{
+			return;
+		}
+
+		TriangleAdjacency adjacency;
+		adjacency.Create(indices, index_count, vertex_count);
+
+		std::vector<uint32_t> live = adjacency.counts; // triangles not yet emitted per vertex
+		std::vector<uint8_t> emitted(index_count / 3, 0);
+		std::vector<uint32_t> deadEnd;
+		deadEnd.reserve(index_count);
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> result;
+		result.reserve(index_count);
+
+		FIFOCache cache;
+		cache.Reset(vertex_count, cache_size);
+		const std::vector<uint32_t>& timestamps = cache.timestamps;
+
+		uint32_t cursor = 0;
+		uint32_t current = indices[0];
+		while (current != ~0u)
+		{
+			// Emit every remaining triangle of the fanning vertex:
+			candidates.clear();
+			for (uint32_t k = adjacency.offsets[current]; k < adjacency.offsets[current + 1]; ++k)
+			{
+				const uint32_t triangle = adjacency.triangles[k];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+				emitted[triangle] = 1;
+
+				for (int c = 0; c < 3; ++c)
+				{
+					const uint32_t vertex = indices[triangle * 3 + c];
+					result.push_back(vertex);
+					deadEnd.push_back(vertex);
+					candidates.push_back(vertex);
+					live[vertex]--;
+					cache.Access(vertex);
+				}
+			}
+
+			// The next fanning vertex is the one that is in the cache for the longest time, but will remain there after its triangles are emitted:
+			uint32_t best = ~0u;
+			int bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (live[vertex] == 0)
+				{
+					continue;
+				}
+				int priority = 0;
+				const uint32_t age = cache.time - timestamps[vertex];
+				if (age + 2 * live[vertex] <= cache_size)
+				{
+					priority = (int)age;
+				}
+				if (priority > bestPriority)
+				{
+					best = vertex;
+					bestPriority = priority;
+				}
+			}
+
+			if (best == ~0u)
+			{
+				// Dead end, continue with a recently used vertex, or the next one in input order:
+				while (!deadEnd.empty())
+				{
+					const uint32_t vertex = deadEnd.back();
+					deadEnd.pop_back();
+					if (live[vertex] > 0)
+					{
+						best = vertex;
+						break;
+					}
+				}
+				if (best == ~0u)
+				{
+					while (cursor < vertex_count && live[cursor] == 0)
+					{
+						cursor++;
+					}
+					if (cursor < vertex_count)
+					{
+						best = cursor;
+					}
+				}
+			}
+
+			current = best;
+		}
+
+		assert(result.size() == index_count);
+		std::copy(result.begin(), result.end(), destination);
+	}
+
+	void OptimizeOverdraw(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		const XMFLOAT3* positions,
+		size_t vertex_count,
+		float threshold,
+		uint32_t cache_size
+	)
+	{
+		using namespace vertexcache;
+
+		assert(index_count % 3 == 0);
+		const size_t triangle_count = index_count / 3;
+		if (triangle_count == 0)
+		{
+			return;
+		}
+
+		FIFOCache cache;
+		cache.Reset(vertex_count, cache_size);
+
+		// Hard cluster boundaries are where the cache simulation misses every vertex of a triangle, splitting there doesn't cost anything:
+		std::vector<uint32_t> hardClusters;
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			uint32_t misses = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				misses += cache.Access(indices[t * 3 + c]) ? 1 : 0;
+			}
+			if (t == 0 || misses == 3)
+			{
+				hardClusters.push_back((uint32_t)t);
+			}
+		}
+		hardClusters.push_back((uint32_t)triangle_count);
+
+		// Soft cluster boundaries are where the cache efficiency of the cluster so far is close enough to the efficiency of the whole hard cluster:
+		std::vector<uint32_t> clusters;
+		for (size_t h = 0; h + 1 < hardClusters.size(); ++h)
+		{
+			const uint32_t start = hardClusters[h];
+			const uint32_t end = hardClusters[h + 1];
+
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = start; t < end; ++t)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					clusterMisses += cache.Access(indices[t * 3 + c]) ? 1 : 0;
+				}
+			}
+			const float clusterACMR = float(clusterMisses) / float(end - start);
+
+			cache.Flush();
+			clusters.push_back(start);
+			uint32_t misses = 0;
+			uint32_t triangles = 0;
+			for (uint32_t t = start; t < end; ++t)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					misses += cache.Access(indices[t * 3 + c]) ? 1 : 0;
+				}
+				triangles++;
+				if (t + 1 < end && float(misses) / float(triangles) <= threshold * clusterACMR)
+				{
+					clusters.push_back(t + 1);
+					cache.Flush();
+					misses = 0;
+					triangles = 0;
+				}
+			}
+		}
+		const size_t cluster_count = clusters.size();
+		clusters.push_back((uint32_t)triangle_count);
+
+		// Cluster centroids and normals are area weighted:
+		struct ClusterInfo
+		{
+			XMFLOAT3 centroid;
+			XMFLOAT3 normal;
+			float area;
+		};
+		std::vector<ClusterInfo> infos(cluster_count);
+		XMVECTOR meshCentroid = XMVectorZero();
+		float meshArea = 0;
+		for (size_t i = 0; i < cluster_count; ++i)
+		{
+			XMVECTOR centroid = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+			float area = 0;
+			for (uint32_t t = clusters[i]; t < clusters[i + 1]; ++t)
+			{
+				const XMVECTOR p0 = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+				const XMVECTOR p1 = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+				const XMVECTOR p2 = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+				// Same winding as MeshComponent::ComputeNormals(), the length is twice the triangle area:
+				const XMVECTOR N = XMVector3Cross(p2 - p0, p1 - p0);
+				const float triangleArea = XMVectorGetX(XMVector3Length(N));
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += N;
+				area += triangleArea;
+			}
+			meshCentroid += centroid;
+			meshArea += area;
+			XMStoreFloat3(&infos[i].centroid, area > 0 ? centroid / area : XMVectorZero());
+			XMStoreFloat3(&infos[i].normal, XMVector3Normalize(normal));
+			infos[i].area = area;
+		}
+		meshCentroid = meshArea > 0 ? meshCentroid / meshArea : XMVectorZero();
+
+		// Clusters that are facing away from the mesh center are drawn first, because they are more likely to occlude the rest:
+		std::vector<float> sortKeys(cluster_count);
+		std::vector<uint32_t> order(cluster_count);
+		for (size_t i = 0; i < cluster_count; ++i)
+		{
+			const XMVECTOR offset = XMLoadFloat3(&infos[i].centroid) - meshCentroid;
+			sortKeys[i] = infos[i].area > 0 ? XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&infos[i].normal))) : 0;
+			order[i] = (uint32_t)i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		std::vector<uint32_t> result;
+		result.reserve(index_count);
+		for (uint32_t cluster : order)
+		{
+			result.insert(result.end(), indices + clusters[cluster] * 3, indices + clusters[cluster + 1] * 3);
+		}
+		std::copy(result.begin(), result.end(), destination);
+	}
+
+	size_t OptimizeVertexFetchRemap(
+		uint32_t* remap,
+		const uint32_t* indices,
+		size_t index_count,
+		size_t vertex_count
+	)
+	{
+		std::fill(remap, remap + vertex_count, ~0u);
+		uint32_t next = 0;
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			const uint32_t index = indices[i];
+			assert(index < vertex_count);
+			if (remap[index] == ~0u)
+			{
+				remap[index] = next++;
+			}
+		}
+		return next;
+	}
+
+	void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t index_count, const uint32_t* remap)
+	{
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			destination[i] = remap[indices[i]];
+		}
+	}
+
+	void BuildMeshlets(
+		std::vector<Meshlet>& meshlets,
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		const XMFLOAT3* positions,
+		size_t vertex_count,
+		uint32_t max_vertices,
+		uint32_t max_triangles
+	)
+	{
+		using namespace vertexcache;
+
+		assert(index_count % 3 == 0);
+		assert(max_vertices >= 3 && max_triangles > 0);
+		assert(destination != indices);
+		meshlets.clear();
+		const size_t triangle_count = index_count / 3;
+		if (triangle_count == 0)
+		{
+			return;
+		}
+
+		TriangleAdjacency adjacency;
+		adjacency.Create(indices, index_count, vertex_count);
+
+		std::vector<uint8_t> emitted(triangle_count, 0);
+		std::vector<uint32_t> vertexMeshlet(vertex_count, ~0u); // the last meshlet that referenced the vertex
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(max_vertices);
+
+		Meshlet meshlet;
+		uint32_t meshletIndex = 0;
+		XMFLOAT3 centroidSum = XMFLOAT3(0, 0, 0);
+		uint32_t lastTriangle = ~0u;
+		uint32_t seedCursor = 0;
+		size_t write = 0;
+
+		auto triangleCentroid = [&](uint32_t triangle) {
+			const XMFLOAT3& p0 = positions[indices[triangle * 3 + 0]];
+			const XMFLOAT3& p1 = positions[indices[triangle * 3 + 1]];
+			const XMFLOAT3& p2 = positions[indices[triangle * 3 + 2]];
+			return XMFLOAT3((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+		};
+		auto newVertexCount = [&](uint32_t triangle) {
+			const uint32_t a = indices[triangle * 3 + 0];
+			const uint32_t b = indices[triangle * 3 + 1];
+			const uint32_t c = indices[triangle * 3 + 2];
+			uint32_t count = vertexMeshlet[a] != meshletIndex ? 1 : 0;
+			count += vertexMeshlet[b] != meshletIndex && b != a ? 1 : 0;
+			count += vertexMeshlet[c] != meshletIndex && c != a && c != b ? 1 : 0;
+			return count;
+		};
+		auto finishMeshlet = [&]() {
+			if (meshlet.index_count > 0)
+			{
+				meshlets.push_back(meshlet);
+				meshletIndex++;
+			}
+			meshlet = Meshlet();
+			meshlet.index_offset = (uint32_t)write;
+			centroidSum = XMFLOAT3(0, 0, 0);
+		};
+
+		// Best triangle to add: the fewest new vertices, then the closest to the meshlet centroid
+		uint32_t best = ~0u;
+		uint32_t bestNewVertices = ~0u;
+		float bestDistance = FLT_MAX;
+		auto consider = [&](uint32_t triangle) {
+			if (emitted[triangle])
+			{
+				return;
+			}
+			const uint32_t newVertices = newVertexCount(triangle);
+			if (meshlet.vertex_count + newVertices > max_vertices)
+			{
+				return;
+			}
+			const XMFLOAT3 c = triangleCentroid(triangle);
+			const float invCount = 1.0f / float(meshlet.index_count / 3);
+			const float dx = c.x - centroidSum.x * invCount;
+			const float dy = c.y - centroidSum.y * invCount;
+			const float dz = c.z - centroidSum.z * invCount;
+			const float distance = dx * dx + dy * dy + dz * dz;
+			if (newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance))
+			{
+				best = triangle;
+				bestNewVertices = newVertices;
+				bestDistance = distance;
+			}
+		};
+
+		for (size_t emitted_count = 0; emitted_count < triangle_count;)
+		{
+			best = ~0u;
+			bestNewVertices = ~0u;
+			bestDistance = FLT_MAX;
+
+			if (meshlet.index_count > 0)
+			{
+				// Neighbours of the last triangle, then neighbours of the whole meshlet:
+				for (int c = 0; c < 3; ++c)
+				{
+					const uint32_t vertex = indices[lastTriangle * 3 + c];
+					for (uint32_t k = adjacency.offsets[vertex]; k < adjacency.offsets[vertex + 1]; ++k)
+					{
+						consider(adjacency.triangles[k]);
+					}
+				}
+				if (best == ~0u)
+				{
+					for (uint32_t vertex : meshletVertices)
+					{
+						for (uint32_t k = adjacency.offsets[vertex]; k < adjacency.offsets[vertex + 1]; ++k)
+						{
+							consider(adjacency.triangles[k]);
+						}
+					}
+				}
+
+				if (best == ~0u)
+				{
+					// The meshlet can't grow further, the next one is seeded next to it to keep locality:
+					for (size_t i = 0; i < meshletVertices.size() && best == ~0u; ++i)
+					{
+						const uint32_t vertex = meshletVertices[i];
+						for (uint32_t k = adjacency.offsets[vertex]; k < adjacency.offsets[vertex + 1]; ++k)
+						{
+							if (!emitted[adjacency.triangles[k]])
+							{
+								best = adjacency.triangles[k];
+								break;
+							}
+						}
+					}
+					finishMeshlet();
+					meshletVertices.clear();
+				}
+			}
+
+			if (best == ~0u)
+			{
+				while (emitted[seedCursor])
+				{
+					seedCursor++;
+				}
+				best = seedCursor;
+			}
+
+			// Add the triangle to the meshlet:
+			emitted[best] = 1;
+			emitted_count++;
+			for (int c = 0; c < 3; ++c)
+			{
+				const uint32_t vertex = indices[best * 3 + c];
+				if (vertexMeshlet[vertex] != meshletIndex)
+				{
+					vertexMeshlet[vertex] = meshletIndex;
+					meshletVertices.push_back(vertex);
+					meshlet.vertex_count++;
+				}
+				destination[write++] = vertex;
+			}
+			meshlet.index_count += 3;
+			const XMFLOAT3 c = triangleCentroid(best);
+			centroidSum.x += c.x;
+			centroidSum.y += c.y;
+			centroidSum.z += c.z;
+			lastTriangle = best;
+
+			if (meshlet.index_count / 3 >= max_triangles)
+			{
+				finishMeshlet();
+				meshletVertices.clear();
+			}
+		}
+		finishMeshlet();
+	}
+
+	ClusterBounds ComputeClusterBounds(const uint32_t* indices, size_t index_count, const XMFLOAT3* positions)
+	{
+		ClusterBounds bounds;
+		if (index_count == 0)
+		{
+			return bounds;
+		}
+
+		XMVECTOR _min = XMVectorReplicate(FLT_MAX);
+		XMVECTOR _max = XMVectorReplicate(-FLT_MAX);
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			const XMVECTOR P = XMLoadFloat3(&positions[indices[i]]);
+			_min = XMVectorMin(_min, P);
+			_max = XMVectorMax(_max, P);
+		}
+		const XMVECTOR center = (_min + _max) * 0.5f;
+		float radius = 0;
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			radius = std::max(radius, XMVectorGetX(XMVector3Length(XMLoadFloat3(&positions[indices[i]]) - center)));
+		}
+		XMStoreFloat3(&bounds.center, center);
+		bounds.radius = radius;
+
+		// The cone axis is the average triangle normal, the cutoff is derived from the largest deviation from it:
+		XMVECTOR axis = XMVectorZero();
+		for (size_t i = 0; i < index_count; i += 3)
+		{
+			const XMVECTOR p0 = XMLoadFloat3(&positions[indices[i + 0]]);
+			const XMVECTOR p1 = XMLoadFloat3(&positions[indices[i + 1]]);
+			const XMVECTOR p2 = XMLoadFloat3(&positions[indices[i + 2]]);
+			const XMVECTOR N = XMVector3Cross(p2 - p0, p1 - p0); // same winding as MeshComponent::ComputeNormals()
+			if (XMVectorGetX(XMVector3LengthSq(N)) > 0)
+			{
+				axis += XMVector3Normalize(N);
+			}
+		}
+		if (XMVectorGetX(XMVector3LengthSq(axis)) <= 0)
+		{
+			return bounds;
+		}
+		axis = XMVector3Normalize(axis);
+
+		float minDot = 1;
+		for (size_t i = 0; i < index_count; i += 3)
+		{
+			const XMVECTOR p0 = XMLoadFloat3(&positions[indices[i + 0]]);
+			const XMVECTOR p1 = XMLoadFloat3(&positions[indices[i + 1]]);
+			const XMVECTOR p2 = XMLoadFloat3(&positions[indices[i + 2]]);
+			const XMVECTOR N = XMVector3Cross(p2 - p0, p1 - p0);
+			if (XMVectorGetX(XMVector3LengthSq(N)) > 0)
+			{
+				minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMVector3Normalize(N), axis)));
+			}
+		}
+
+		XMStoreFloat3(&bounds.cone_axis, axis);
+		// A cone wider than about 85 degrees can't be culled conservatively:
+		bounds.cone_cutoff = minDot <= 0.1f ? 1 : std::sqrt(1 - minDot * minDot);
+		return bounds;
+	}
+
+	VertexCacheStatistics AnalyzeVertexCache(
+		const uint32_t* indices,
+		size_t index_count,
+		size_t vertex_count,
+		uint32_t cache_size
+	)
+	{
+		using namespace vertexcache;
+
+		VertexCacheStatistics statistics;
+		if (index_count == 0)
+		{
+			return statistics;
+		}
+
+		FIFOCache cache;
+		cache.Reset(vertex_count, cache_size);
+		std::vector<uint8_t> referenced(vertex_count, 0);
+		uint32_t unique_vertices = 0;
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			const uint32_t index = indices[i];
+			if (cache.Access(index))
+			{
+				statistics.vertices_transformed++;
+			}
+			if (!referenced[index])
+			{
+				referenced[index] = 1;
+				unique_vertices++;
+			}
+		}
+
+		statistics.acmr = float(statistics.vertices_transformed) / float(index_count / 3);
+		statistics.atvr = float(statistics.vertices_transformed) / float(unique_vertices);
+		return statistics;
+	}
+}
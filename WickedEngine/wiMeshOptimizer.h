@@ -0,0 +1,147 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+// Mesh processing utilities that work on plain index and vertex arrays, so they can be used on any mesh format.
+//	None of them use global state, they can run in parallel for multiple meshes.
+namespace wiMeshOptimizer
+{
+	// Simplify a triangle list with quadric error metric driven edge collapses.
+	//	Vertices are only removed, never moved or created, so the result can be drawn with the original vertex buffer.
+	//	Vertices on attribute seams (vertices sharing the same position) are kept, border vertices can only slide along the border.
+	//	The result is deterministic for the same input.
+	//	destination			: output index buffer, it must be able to hold index_count elements (can be the same as indices)
+	//	indices				: input index buffer (triangle list)
+	//	index_count			: number of input indices
+	//	positions			: vertex positions
+	//	vertex_count		: number of vertices
+	//	target_index_count	: simplification stops when the index count is reduced to this
+	//	target_error		: simplification stops before the geometric error would exceed this (relative to the mesh extents)
+	//	result_error		: optional, receives the geometric error of the result (relative to the mesh extents)
+	//	returns the index count of the result
+	size_t Simplify(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		const XMFLOAT3* positions,
+		size_t vertex_count,
+		size_t target_index_count,
+		float target_error,
+		float* result_error = nullptr
+	);
+
+	// Reorder triangles to improve the hit rate of the post transform vertex cache (Tipsify algorithm)
+	//	destination	: output index buffer, it must be able to hold index_count elements (can be the same as indices)
+	//	indices		: input index buffer (triangle list)
+	//	index_count	: number of indices
+	//	vertex_count: number of vertices
+	//	cache_size	: the simulated vertex cache size, the result is not sensitive to the exact hardware value
+	void OptimizeVertexCache(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		size_t vertex_count,
+		uint32_t cache_size = 16
+	);
+
+	// Reorder triangle clusters to reduce overdraw, outward facing clusters are moved to the front so they can occlude the rest
+	//	The input should be optimized with OptimizeVertexCache() first, clusters are only split where the cache efficiency allows it
+	//	destination	: output index buffer, it must be able to hold index_count elements (can be the same as indices)
+	//	indices		: input index buffer (triangle list)
+	//	index_count	: number of indices
+	//	positions	: vertex positions
+	//	vertex_count: number of vertices
+	//	threshold	: how much the vertex cache efficiency can degrade in exchange for less overdraw (1.05 = 5% worse ACMR)
+	//	cache_size	: the simulated vertex cache size
+	void OptimizeOverdraw(
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		const XMFLOAT3* positions,
+		size_t vertex_count,
+		float threshold = 1.05f,
+		uint32_t cache_size = 16
+	);
+
+	// Create a vertex remap table that orders vertices by their first use in the index buffer, which improves vertex fetch locality
+	//	Unreferenced vertices are removed, their remap value will be ~0u.
+	//	remap		: output, it must be able to hold vertex_count elements
+	//	indices		: index buffer (triangle list)
+	//	index_count	: number of indices
+	//	vertex_count: number of vertices
+	//	returns the number of vertices after remapping
+	size_t OptimizeVertexFetchRemap(
+		uint32_t* remap,
+		const uint32_t* indices,
+		size_t index_count,
+		size_t vertex_count
+	);
+
+	// Apply a remap table to an index buffer (destination can be the same as indices)
+	void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t index_count, const uint32_t* remap);
+
+	// Apply a remap table to a vertex attribute array, destination must be able to hold every remapped vertex and can't be the same as vertices
+	template<typename T>
+	inline void RemapVertexBuffer(T* destination, const T* vertices, size_t vertex_count, const uint32_t* remap)
+	{
+		for (size_t i = 0; i < vertex_count; ++i)
+		{
+			if (remap[i] != ~0u)
+			{
+				destination[remap[i]] = vertices[i];
+			}
+		}
+	}
+
+	struct Meshlet
+	{
+		uint32_t index_offset = 0;	// offset into the output index buffer
+		uint32_t index_count = 0;
+		uint32_t vertex_count = 0;	// number of unique vertices
+	};
+	// Split a triangle list into meshlets (small clusters of nearby triangles), the triangles of every meshlet will be contiguous in the output
+	//	meshlets		: output, receives the meshlets
+	//	destination		: output index buffer, it must be able to hold index_count elements (can't be the same as indices)
+	//	indices			: input index buffer (triangle list)
+	//	index_count		: number of indices
+	//	positions		: vertex positions
+	//	vertex_count	: number of vertices
+	//	max_vertices	: maximum number of unique vertices in a meshlet
+	//	max_triangles	: maximum number of triangles in a meshlet
+	void BuildMeshlets(
+		std::vector<Meshlet>& meshlets,
+		uint32_t* destination,
+		const uint32_t* indices,
+		size_t index_count,
+		const XMFLOAT3* positions,
+		size_t vertex_count,
+		uint32_t max_vertices = 64,
+		uint32_t max_triangles = 124
+	);
+
+	struct ClusterBounds
+	{
+		XMFLOAT3 center = XMFLOAT3(0, 0, 0);	// bounding sphere
+		float radius = 0;
+		XMFLOAT3 cone_axis = XMFLOAT3(0, 0, 0);	// average facing direction of the triangles
+		float cone_cutoff = 1;					// 1 if the cluster can't be backface culled
+	};
+	// Compute the bounding sphere and normal cone of a triangle cluster
+	//	The cluster is back facing if: dot(center - eye, cone_axis) >= cone_cutoff * length(center - eye) + radius
+	ClusterBounds ComputeClusterBounds(const uint32_t* indices, size_t index_count, const XMFLOAT3* positions);
+
+	struct VertexCacheStatistics
+	{
+		uint32_t vertices_transformed = 0;
+		float acmr = 0;	// average cache miss ratio: transformed vertices per triangle (best: 0.5, worst: 3)
+		float atvr = 0;	// average transformed vertex ratio: transformed vertices per referenced vertex (best: 1)
+	};
+	// Simulate a FIFO post transform vertex cache for an index buffer
+	VertexCacheStatistics AnalyzeVertexCache(
+		const uint32_t* indices,
+		size_t index_count,
+		size_t vertex_count,
+		uint32_t cache_size = 16
+	);
+}
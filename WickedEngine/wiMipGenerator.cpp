@@ -0,0 +1,229 @@
+#include "wiMipGenerator.h"
+#include "wiJobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wiMipGenerator
+{
+	// Number of rows that are processed by one job:
+	static const uint32_t groupSize = 16;
+
+	// Separable downsampling kernel, the source taps of destination pixel x are: x * scale + offset + [0, count)
+	struct Kernel
+	{
+		uint32_t scale = 1;
+		int offset = 0;
+		int count = 1;
+		float weights[6] = { 1 };
+	};
+
+	// Modified Bessel function of the first kind, order zero (power series)
+	inline float BesselI0(float x)
+	{
+		float sum = 1;
+		float term = 1;
+		for (int k = 1; k < 16; ++k)
+		{
+			const float t = x / (2.0f * k);
+			term *= t * t;
+			sum += term;
+		}
+		return sum;
+	}
+
+	Kernel CreateKernel(FILTER filter)
+	{
+		Kernel kernel;
+		kernel.scale = 2;
+		if (filter == FILTER_KAISER)
+		{
+			const float alpha = 4;
+			const float radius = 1.5f; // in destination pixels
+			kernel.offset = -2;
+			kernel.count = 6;
+			float sum = 0;
+			for (int i = 0; i < kernel.count; ++i)
+			{
+				// distance of the source pixel center from the destination pixel center, in destination pixels:
+				const float t = (kernel.offset + i - 0.5f) * 0.5f;
+				const float x = t / radius;
+				const float window = BesselI0(alpha * std::sqrt(std::max(0.0f, 1 - x * x))) / BesselI0(alpha);
+				const float sinc = std::sin(XM_PI * t) / (XM_PI * t);
+				kernel.weights[i] = sinc * window;
+				sum += kernel.weights[i];
+			}
+			for (int i = 0; i < kernel.count; ++i)
+			{
+				kernel.weights[i] /= sum;
+			}
+		}
+		else
+		{
+			kernel.offset = 0;
+			kernel.count = 2;
+			kernel.weights[0] = 0.5f;
+			kernel.weights[1] = 0.5f;
+		}
+		return kernel;
+	}
+
+	struct SRGBTables
+	{
+		float toLinear[256];
+		uint8_t fromLinear[4096];
+
+		SRGBTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				const float srgb = i / 255.0f;
+				toLinear[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 4096; ++i)
+			{
+				const float linear = i / 4095.0f;
+				const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+				fromLinear[i] = (uint8_t)std::min(255.0f, srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+	const SRGBTables& GetSRGBTables()
+	{
+		static const SRGBTables tables;
+		return tables;
+	}
+
+	uint32_t GetMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t mipCount = 1;
+		while (width > 1 || height > 1)
+		{
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			mipCount++;
+		}
+		return mipCount;
+	}
+
+	size_t GetMipChainSize(uint32_t width, uint32_t height)
+	{
+		size_t size = 0;
+		const uint32_t mipCount = GetMipCount(width, height);
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			size += (size_t)width * height * 4;
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+		}
+		return size;
+	}
+
+	void GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& result, FILTER filter, bool srgb)
+	{
+		result.resize(GetMipChainSize(width, height));
+		memcpy(result.data(), rgba, (size_t)width * height * 4);
+		if (width <= 1 && height <= 1)
+		{
+			return;
+		}
+
+		const SRGBTables& tables = GetSRGBTables();
+		const Kernel kernel = CreateKernel(filter);
+		const Kernel identity = Kernel(); // for a dimension that is already 1 pixel
+
+		wiJobSystem::context ctx;
+
+		// Mip 0 to floating point:
+		std::vector<XMFLOAT4A> src((size_t)width * height);
+		wiJobSystem::Dispatch(ctx, height, groupSize, [&](wiJobDispatchArgs args) {
+			const size_t begin = (size_t)args.jobIndex * width;
+			for (size_t i = begin; i < begin + width; ++i)
+			{
+				const uint8_t* pixel = rgba + i * 4;
+				if (srgb)
+				{
+					src[i] = XMFLOAT4A(tables.toLinear[pixel[0]], tables.toLinear[pixel[1]], tables.toLinear[pixel[2]], pixel[3] / 255.0f);
+				}
+				else
+				{
+					src[i] = XMFLOAT4A(pixel[0] / 255.0f, pixel[1] / 255.0f, pixel[2] / 255.0f, pixel[3] / 255.0f);
+				}
+			}
+		});
+		wiJobSystem::Wait(ctx);
+
+		std::vector<XMFLOAT4A> temp;
+		std::vector<XMFLOAT4A> dst;
+		size_t dstOffset = (size_t)width * height * 4;
+		uint32_t srcWidth = width;
+		uint32_t srcHeight = height;
+		while (srcWidth > 1 || srcHeight > 1)
+		{
+			const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+			const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+			const Kernel& kernelX = dstWidth < srcWidth ? kernel : identity;
+			const Kernel& kernelY = dstHeight < srcHeight ? kernel : identity;
+			temp.resize((size_t)dstWidth * srcHeight);
+			dst.resize((size_t)dstWidth * dstHeight);
+
+			// Horizontal pass, source taps outside the image are clamped to the edge:
+			wiJobSystem::Dispatch(ctx, srcHeight, groupSize, [&](wiJobDispatchArgs args) {
+				const XMFLOAT4A* row = src.data() + (size_t)args.jobIndex * srcWidth;
+				XMFLOAT4A* output = temp.data() + (size_t)args.jobIndex * dstWidth;
+				for (uint32_t x = 0; x < dstWidth; ++x)
+				{
+					XMVECTOR sum = XMVectorZero();
+					for (int i = 0; i < kernelX.count; ++i)
+					{
+						const int sx = std::min(std::max((int)(x * kernelX.scale) + kernelX.offset + i, 0), (int)srcWidth - 1);
+						sum = XMVectorMultiplyAdd(XMLoadFloat4A(&row[sx]), XMVectorReplicate(kernelX.weights[i]), sum);
+					}
+					XMStoreFloat4A(&output[x], sum);
+				}
+			});
+			wiJobSystem::Wait(ctx);
+
+			// Vertical pass, the result is also written to the 8-bit mip chain:
+			uint8_t* mip = result.data() + dstOffset;
+			wiJobSystem::Dispatch(ctx, dstHeight, groupSize, [&](wiJobDispatchArgs args) {
+				const uint32_t y = args.jobIndex;
+				for (uint32_t x = 0; x < dstWidth; ++x)
+				{
+					XMVECTOR sum = XMVectorZero();
+					for (int i = 0; i < kernelY.count; ++i)
+					{
+						const int sy = std::min(std::max((int)(y * kernelY.scale) + kernelY.offset + i, 0), (int)srcHeight - 1);
+						sum = XMVectorMultiplyAdd(XMLoadFloat4A(&temp[(size_t)sy * dstWidth + x]), XMVectorReplicate(kernelY.weights[i]), sum);
+					}
+					sum = XMVectorSaturate(sum); // the Kaiser filter has negative lobes
+
+					XMFLOAT4A& value = dst[(size_t)y * dstWidth + x];
+					XMStoreFloat4A(&value, sum);
+
+					uint8_t* pixel = mip + ((size_t)y * dstWidth + x) * 4;
+					if (srgb)
+					{
+						const float scale = 4095.0f;
+						pixel[0] = tables.fromLinear[(int)(value.x * scale + 0.5f)];
+						pixel[1] = tables.fromLinear[(int)(value.y * scale + 0.5f)];
+						pixel[2] = tables.fromLinear[(int)(value.z * scale + 0.5f)];
+					}
+					else
+					{
+						pixel[0] = (uint8_t)(value.x * 255.0f + 0.5f);
+						pixel[1] = (uint8_t)(value.y * 255.0f + 0.5f);
+						pixel[2] = (uint8_t)(value.z * 255.0f + 0.5f);
+					}
+					pixel[3] = (uint8_t)(value.w * 255.0f + 0.5f);
+				}
+			});
+			wiJobSystem::Wait(ctx);
+
+			std::swap(src, dst);
+			dstOffset += (size_t)dstWidth * dstHeight * 4;
+			srcWidth = dstWidth;
+			srcHeight = dstHeight;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+// CPU mip chain generation for RGBA8 images
+//	The filtering is done in floating point with one SIMD vector per pixel, rows are processed in parallel with the wiJobSystem
+//	Every mip level is computed from the previous one, without quantizing the intermediate results to 8 bits
+namespace wiMipGenerator
+{
+	enum FILTER
+	{
+		FILTER_BOX,		// 2x2 average, the same as a linear filtered GPU downsample
+		FILTER_KAISER,	// Kaiser windowed sinc (6 taps per dimension), sharper than the box filter
+	};
+
+	// Returns the number of mip levels of a full mip chain
+	uint32_t GetMipCount(uint32_t width, uint32_t height);
+	// Returns the size of a full RGBA8 mip chain in bytes (including mip 0)
+	size_t GetMipChainSize(uint32_t width, uint32_t height);
+
+	// Generate a full mip chain, the mip levels are written one after the other into result (including mip 0)
+	//	rgba	: source image with width * height * 4 bytes
+	//	filter	: downsampling filter
+	//	srgb	: if true, the color channels are converted to linear space for filtering and back to sRGB for storing (alpha is always linear)
+	void GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& result, FILTER filter = FILTER_BOX, bool srgb = false);
+}
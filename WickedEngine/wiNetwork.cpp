@@ -0,0 +1,53 @@
+#include "wiNetwork.h"
+#include "wiSpinLock.h"
+
+#include <vector>
+#include <memory>
+
+namespace wiNetwork
+{
+	// Packet buffers are allocated in blocks and never freed, the free list keeps the buffers that are not in use:
+	struct PacketPool
+	{
+		static const size_t BLOCK_PACKET_COUNT = 64;
+		std::vector<std::unique_ptr<uint8_t[]>> blocks;
+		std::vector<uint8_t*> freeList;
+		wiSpinLock lock;
+	};
+	static PacketPool packetPool;
+
+	void AllocatePackets(Packet* packets, size_t count)
+	{
+		packetPool.lock.lock();
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (packetPool.freeList.empty())
+			{
+				packetPool.blocks.emplace_back(new uint8_t[PACKET_CAPACITY * PacketPool::BLOCK_PACKET_COUNT]);
+				uint8_t* block = packetPool.blocks.back().get();
+				for (size_t j = PacketPool::BLOCK_PACKET_COUNT; j > 0; --j)
+				{
+					packetPool.freeList.push_back(block + (j - 1) * PACKET_CAPACITY);
+				}
+			}
+			packets[i].data = packetPool.freeList.back();
+			packets[i].dataSize = 0;
+			packetPool.freeList.pop_back();
+		}
+		packetPool.lock.unlock();
+	}
+	void FreePackets(Packet* packets, size_t count)
+	{
+		packetPool.lock.lock();
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (packets[i].data != nullptr)
+			{
+				packetPool.freeList.push_back(packets[i].data);
+				packets[i].data = nullptr;
+				packets[i].dataSize = 0;
+			}
+		}
+		packetPool.lock.unlock();
+	}
+}
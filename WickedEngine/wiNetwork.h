@@ -5,14 +5,21 @@
 
 namespace wiNetwork
 {
+#ifdef __linux__
+	// The file descriptor 0 is valid on Linux, so the invalid handle is not WI_NULL_HANDLE
+	static const wiCPUHandle INVALID_HANDLE = ~0ull;
+#else
+	static const wiCPUHandle INVALID_HANDLE = WI_NULL_HANDLE;
+#endif // __linux__
+
 	struct Socket
 	{
-		wiCPUHandle handle = WI_NULL_HANDLE;
+		wiCPUHandle handle = INVALID_HANDLE;
 
 		void operator=(Socket&& other)
 		{
 			handle = other.handle;
-			other.handle = WI_NULL_HANDLE;
+			other.handle = INVALID_HANDLE;
 		}
 
 		Socket() {}
@@ -20,7 +27,7 @@ namespace wiNetwork
 		{
 			handle = other.handle;
 
-			other.handle = WI_NULL_HANDLE;
+			other.handle = INVALID_HANDLE;
 		}
 		~Socket();
 	};
@@ -63,5 +70,68 @@ namespace wiNetwork
 	//	connection	:	sender's connection data will be written to it when the function returns
 	//	data		:	buffer to hold received data, must be already allocated to a sufficient size
 	//	dataSize	:	expected data size in bytes
+	//	returns false if there was an error, or if the packet was larger than dataSize (the packet is dropped)
 	bool Receive(const Socket* sock, Connection* connection, void* data, size_t dataSize);
+
+
+	// Batched packet interface, it moves many packets with few system calls where the platform supports it (sendmmsg/recvmmsg on Linux)
+
+	// Payload capacity of a pooled packet buffer, a UDP datagram of this size fits into an ethernet frame without fragmentation
+	static const size_t PACKET_CAPACITY = 1472;
+	struct Packet
+	{
+		Connection connection;		// receiver when sending, sender when receiving
+		size_t dataSize = 0;		// size of the valid data in bytes
+		uint8_t* data = nullptr;	// buffer of PACKET_CAPACITY bytes from AllocatePackets()
+	};
+
+	// Takes packet buffers from the packet pool, the buffers are reused after FreePackets() without heap allocations
+	void AllocatePackets(Packet* packets, size_t count);
+	// Returns the packet buffers to the packet pool
+	void FreePackets(Packet* packets, size_t count);
+
+	// Makes the send and receive calls of the socket return immediately instead of waiting
+	bool SetNonBlocking(const Socket* sock, bool enabled = true);
+
+	// Sends many packets, returns the number of packets sent
+	//	With a non-blocking socket, it returns early if the send buffer of the socket is full
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count);
+
+	// Receives the packets that are already waiting, it doesn't block
+	//	packets		:	packets with buffers from AllocatePackets(), their dataSize and connection are written
+	//	returns the number of received packets, at most count. Packets larger than PACKET_CAPACITY are dropped
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count);
+
+	// Waits for incoming data on many sockets at once (epoll on Linux)
+	struct Poller
+	{
+		wiCPUHandle handle = INVALID_HANDLE;
+
+		Poller() {}
+		Poller(const Poller&) = delete;
+		~Poller();
+	};
+	bool CreatePoller(Poller* poller);
+	bool Destroy(Poller* poller);
+	// Adds a socket to the poller, the socket must stay alive while it is in the poller
+	bool PollerAdd(const Poller* poller, const Socket* sock);
+	bool PollerRemove(const Poller* poller, const Socket* sock);
+	// Waits until some of the sockets can receive data or the timeout period is over
+	//	ready		:	the sockets that can receive are written to it
+	//	readyCapacity : size of the ready array
+	//	timeout_microseconds : 0 returns immediately, negative waits without timeout
+	//	returns the number of ready sockets
+	size_t PollerWait(const Poller* poller, const Socket** ready, size_t readyCapacity, long timeout_microseconds);
+
+	// Counters of the network activity, for measuring the system call overhead
+	struct Statistics
+	{
+		uint64_t packetsSent = 0;
+		uint64_t packetsReceived = 0;
+		uint64_t bytesSent = 0;
+		uint64_t bytesReceived = 0;
+		uint64_t systemCalls = 0;	// send, receive and readiness calls
+	};
+	Statistics GetStatistics();
+	void ResetStatistics();
 }
@@ -0,0 +1,460 @@
+#ifdef __linux__
+#include "wiNetwork.h"
+#include "wiBackLog.h"
+
+#include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+namespace wiNetwork
+{
+	// Maximum number of packets in one sendmmsg/recvmmsg/epoll_wait call, the message headers are on the stack
+	static const size_t BATCH_SIZE = 64;
+
+	static std::atomic<uint64_t> packetsSent{ 0 };
+	static std::atomic<uint64_t> packetsReceived{ 0 };
+	static std::atomic<uint64_t> bytesSent{ 0 };
+	static std::atomic<uint64_t> bytesReceived{ 0 };
+	static std::atomic<uint64_t> systemCalls{ 0 };
+
+	static void PostError(const char* function)
+	{
+		const int error = errno;
+		std::stringstream ss;
+		ss << "wiNetwork error in " << function << ": " << error << " (" << strerror(error) << ")";
+		wiBackLog::post(ss.str().c_str());
+	}
+	static inline bool WouldBlock()
+	{
+		return errno == EAGAIN || errno == EWOULDBLOCK;
+	}
+	static inline int GetDescriptor(wiCPUHandle handle)
+	{
+		return (int)handle;
+	}
+	static inline void ToAddress(const Connection& connection, sockaddr_in& address)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(connection.port); // reverse byte order from host to network
+		memcpy(&address.sin_addr.s_addr, connection.ipaddress.data(), 4); // the address bytes are already in network order
+	}
+	static inline void FromAddress(const sockaddr_in& address, Connection& connection)
+	{
+		connection.port = ntohs(address.sin_port); // reverse byte order from network to host
+		memcpy(connection.ipaddress.data(), &address.sin_addr.s_addr, 4);
+	}
+
+	Socket::~Socket()
+	{
+		Destroy(this);
+	}
+	Poller::~Poller()
+	{
+		Destroy(this);
+	}
+
+	void Initialize()
+	{
+		wiBackLog::post("wiNetwork Initialized");
+	}
+
+	bool CreateSocket(Socket* sock)
+	{
+		Destroy(sock);
+
+		int handle = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+		if (handle < 0)
+		{
+			PostError("CreateSocket");
+			return false;
+		}
+
+		sock->handle = (wiCPUHandle)handle;
+
+		return true;
+	}
+	bool Destroy(Socket* sock)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			int result = close(GetDescriptor(sock->handle));
+			sock->handle = INVALID_HANDLE;
+			if (result < 0)
+			{
+				PostError("Destroy");
+				return false;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	bool Send(const Socket* sock, const Connection* connection, const void* data, size_t dataSize)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			sockaddr_in target;
+			ToAddress(*connection, target);
+
+			ssize_t result = sendto(GetDescriptor(sock->handle), data, dataSize, 0, (const sockaddr*)&target, sizeof(target));
+			systemCalls++;
+			if (result < 0)
+			{
+				PostError("Send");
+				return false;
+			}
+
+			packetsSent++;
+			bytesSent += (uint64_t)result;
+			return true;
+		}
+		return false;
+	}
+
+	bool ListenPort(const Socket* sock, uint16_t port)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			sockaddr_in target;
+			memset(&target, 0, sizeof(target));
+			target.sin_family = AF_INET;
+			target.sin_port = htons(port);
+			target.sin_addr.s_addr = htonl(INADDR_ANY);
+
+			int result = bind(GetDescriptor(sock->handle), (const sockaddr*)&target, sizeof(target));
+			if (result < 0)
+			{
+				PostError("ListenPort");
+				return false;
+			}
+
+			return true;
+		}
+		return false;
+	}
+
+	bool CanReceive(const Socket* sock, long timeout_microseconds)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			pollfd fd;
+			fd.fd = GetDescriptor(sock->handle);
+			fd.events = POLLIN;
+			fd.revents = 0;
+			timespec timeout;
+			timeout.tv_sec = timeout_microseconds / 1000000;
+			timeout.tv_nsec = (timeout_microseconds % 1000000) * 1000;
+			int result = ppoll(&fd, 1, &timeout, nullptr);
+			systemCalls++;
+			if (result < 0)
+			{
+				if (errno != EINTR)
+				{
+					PostError("CanReceive");
+				}
+				return false;
+			}
+
+			return result > 0 && (fd.revents & POLLIN) != 0;
+		}
+		return false;
+	}
+
+	bool Receive(const Socket* sock, Connection* connection, void* data, size_t dataSize)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			sockaddr_in sender;
+			socklen_t targetsize = sizeof(sender);
+			// MSG_TRUNC makes recvfrom return the real size of the datagram, even if it didn't fit into the buffer:
+			ssize_t result = recvfrom(GetDescriptor(sock->handle), data, dataSize, MSG_TRUNC, (sockaddr*)&sender, &targetsize);
+			systemCalls++;
+			if (result < 0)
+			{
+				if (!WouldBlock())
+				{
+					PostError("Receive");
+				}
+				return false;
+			}
+			if ((size_t)result > dataSize)
+			{
+				return false; // the rest of the datagram was discarded, it is dropped instead of being returned incomplete
+			}
+
+			FromAddress(sender, *connection);
+			packetsReceived++;
+			bytesReceived += (uint64_t)result;
+			return true;
+		}
+		return false;
+	}
+
+	bool SetNonBlocking(const Socket* sock, bool enabled)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			const int handle = GetDescriptor(sock->handle);
+			int flags = fcntl(handle, F_GETFL, 0);
+			if (flags < 0)
+			{
+				PostError("SetNonBlocking");
+				return false;
+			}
+			flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+			if (fcntl(handle, F_SETFL, flags) < 0)
+			{
+				PostError("SetNonBlocking");
+				return false;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count)
+	{
+		if (sock == nullptr || sock->handle == INVALID_HANDLE)
+		{
+			return 0;
+		}
+
+		mmsghdr messages[BATCH_SIZE];
+		iovec buffers[BATCH_SIZE];
+		sockaddr_in targets[BATCH_SIZE];
+
+		size_t sent = 0;
+		while (sent < count)
+		{
+			const size_t batch = std::min(count - sent, BATCH_SIZE);
+			for (size_t i = 0; i < batch; ++i)
+			{
+				const Packet& packet = packets[sent + i];
+				ToAddress(packet.connection, targets[i]);
+				buffers[i].iov_base = packet.data;
+				buffers[i].iov_len = packet.dataSize;
+				memset(&messages[i], 0, sizeof(mmsghdr));
+				messages[i].msg_hdr.msg_name = &targets[i];
+				messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+				messages[i].msg_hdr.msg_iov = &buffers[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int result = sendmmsg(GetDescriptor(sock->handle), messages, (unsigned int)batch, 0);
+			systemCalls++;
+			if (result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (!WouldBlock())
+				{
+					PostError("SendBatch");
+				}
+				break;
+			}
+			if (result == 0)
+			{
+				break;
+			}
+
+			for (int i = 0; i < result; ++i)
+			{
+				bytesSent += messages[i].msg_len;
+			}
+			packetsSent += (uint64_t)result;
+			sent += (size_t)result;
+		}
+		return sent;
+	}
+
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count)
+	{
+		if (sock == nullptr || sock->handle == INVALID_HANDLE)
+		{
+			return 0;
+		}
+
+		mmsghdr messages[BATCH_SIZE];
+		iovec buffers[BATCH_SIZE];
+		sockaddr_in senders[BATCH_SIZE];
+
+		size_t received = 0;
+		while (received < count)
+		{
+			const size_t batch = std::min(count - received, BATCH_SIZE);
+			for (size_t i = 0; i < batch; ++i)
+			{
+				buffers[i].iov_base = packets[received + i].data;
+				buffers[i].iov_len = PACKET_CAPACITY;
+				memset(&messages[i], 0, sizeof(mmsghdr));
+				messages[i].msg_hdr.msg_name = &senders[i];
+				messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+				messages[i].msg_hdr.msg_iov = &buffers[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int result = recvmmsg(GetDescriptor(sock->handle), messages, (unsigned int)batch, MSG_DONTWAIT, nullptr);
+			systemCalls++;
+			if (result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (!WouldBlock())
+				{
+					PostError("ReceiveBatch");
+				}
+				break;
+			}
+
+			// The datagrams that didn't fit into the packet buffer are dropped, the packets after them are moved
+			//	forward by swapping the buffers, so the dropped buffers are reused by the next batch:
+			size_t kept = 0;
+			for (int i = 0; i < result; ++i)
+			{
+				if (messages[i].msg_hdr.msg_flags & MSG_TRUNC)
+				{
+					continue;
+				}
+				Packet& packet = packets[received + kept];
+				if (kept != (size_t)i)
+				{
+					std::swap(packet.data, packets[received + i].data);
+				}
+				packet.dataSize = messages[i].msg_len;
+				FromAddress(senders[i], packet.connection);
+				bytesReceived += messages[i].msg_len;
+				kept++;
+			}
+			packetsReceived += (uint64_t)kept;
+			received += kept;
+
+			if ((size_t)result < batch)
+			{
+				break; // the queue is empty
+			}
+		}
+		return received;
+	}
+
+	bool CreatePoller(Poller* poller)
+	{
+		Destroy(poller);
+
+		int handle = epoll_create1(EPOLL_CLOEXEC);
+		if (handle < 0)
+		{
+			PostError("CreatePoller");
+			return false;
+		}
+
+		poller->handle = (wiCPUHandle)handle;
+		return true;
+	}
+	bool Destroy(Poller* poller)
+	{
+		if (poller != nullptr && poller->handle != INVALID_HANDLE)
+		{
+			int result = close(GetDescriptor(poller->handle));
+			poller->handle = INVALID_HANDLE;
+			if (result < 0)
+			{
+				PostError("Destroy");
+				return false;
+			}
+			return true;
+		}
+		return false;
+	}
+	bool PollerAdd(const Poller* poller, const Socket* sock)
+	{
+		if (poller != nullptr && poller->handle != INVALID_HANDLE && sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.ptr = (void*)sock;
+			if (epoll_ctl(GetDescriptor(poller->handle), EPOLL_CTL_ADD, GetDescriptor(sock->handle), &event) < 0)
+			{
+				PostError("PollerAdd");
+				return false;
+			}
+			return true;
+		}
+		return false;
+	}
+	bool PollerRemove(const Poller* poller, const Socket* sock)
+	{
+		if (poller != nullptr && poller->handle != INVALID_HANDLE && sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			epoll_event event = {};
+			if (epoll_ctl(GetDescriptor(poller->handle), EPOLL_CTL_DEL, GetDescriptor(sock->handle), &event) < 0)
+			{
+				PostError("PollerRemove");
+				return false;
+			}
+			return true;
+		}
+		return false;
+	}
+	size_t PollerWait(const Poller* poller, const Socket** ready, size_t readyCapacity, long timeout_microseconds)
+	{
+		if (poller == nullptr || poller->handle == INVALID_HANDLE || readyCapacity == 0)
+		{
+			return 0;
+		}
+
+		// epoll_wait has millisecond resolution, the timeout is rounded up:
+		const int timeout = timeout_microseconds < 0 ? -1 : int((timeout_microseconds + 999) / 1000);
+		epoll_event events[BATCH_SIZE];
+		int result = epoll_wait(GetDescriptor(poller->handle), events, (int)std::min(readyCapacity, BATCH_SIZE), timeout);
+		systemCalls++;
+		if (result < 0)
+		{
+			if (errno != EINTR)
+			{
+				PostError("PollerWait");
+			}
+			return 0;
+		}
+
+		for (int i = 0; i < result; ++i)
+		{
+			ready[i] = (const Socket*)events[i].data.ptr;
+		}
+		return (size_t)result;
+	}
+
+	Statistics GetStatistics()
+	{
+		Statistics statistics;
+		statistics.packetsSent = packetsSent.load();
+		statistics.packetsReceived = packetsReceived.load();
+		statistics.bytesSent = bytesSent.load();
+		statistics.bytesReceived = bytesReceived.load();
+		statistics.systemCalls = systemCalls.load();
+		return statistics;
+	}
+	void ResetStatistics()
+	{
+		packetsSent.store(0);
+		packetsReceived.store(0);
+		bytesSent.store(0);
+		bytesReceived.store(0);
+		systemCalls.store(0);
+	}
+}
+
+#endif // __linux__
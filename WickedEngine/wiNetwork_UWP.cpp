@@ -7,6 +7,9 @@ namespace wiNetwork
 	Socket::~Socket()
 	{
 	}
+	Poller::~Poller()
+	{
+	}
 
 	void Initialize()
 	{
@@ -42,6 +45,50 @@ namespace wiNetwork
 		return false;
 	}
 
+	bool SetNonBlocking(const Socket* sock, bool enabled)
+	{
+		return false;
+	}
+
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count)
+	{
+		return 0;
+	}
+
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count)
+	{
+		return 0;
+	}
+
+	bool CreatePoller(Poller* poller)
+	{
+		return false;
+	}
+	bool Destroy(Poller* poller)
+	{
+		return false;
+	}
+	bool PollerAdd(const Poller* poller, const Socket* sock)
+	{
+		return false;
+	}
+	bool PollerRemove(const Poller* poller, const Socket* sock)
+	{
+		return false;
+	}
+	size_t PollerWait(const Poller* poller, const Socket** ready, size_t readyCapacity, long timeout_microseconds)
+	{
+		return 0;
+	}
+
+	Statistics GetStatistics()
+	{
+		return Statistics();
+	}
+	void ResetStatistics()
+	{
+	}
+
 }
 
 #endif // WINSTORE_SUPPORT
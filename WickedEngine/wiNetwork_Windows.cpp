@@ -1,8 +1,11 @@
-#ifndef WINSTORE_SUPPORT
+#if defined(_WIN32) && !defined(WINSTORE_SUPPORT)
 #include "wiNetwork.h"
 #include "wiBackLog.h"
 
 #include <sstream>
+#include <atomic>
+#include <vector>
+#include <algorithm>
 
 #include <winsock.h>
 #pragma comment(lib,"ws2_32.lib")
@@ -21,10 +24,20 @@ namespace wiNetwork
 		}
 	} cleanup;
 
+	static std::atomic<uint64_t> packetsSent{ 0 };
+	static std::atomic<uint64_t> packetsReceived{ 0 };
+	static std::atomic<uint64_t> bytesSent{ 0 };
+	static std::atomic<uint64_t> bytesReceived{ 0 };
+	static std::atomic<uint64_t> systemCalls{ 0 };
+
 	Socket::~Socket()
 	{
 		Destroy(this);
 	}
+	Poller::~Poller()
+	{
+		Destroy(this);
+	}
 
 	void Initialize()
 	{
@@ -65,7 +78,7 @@ namespace wiNetwork
 	}
 	bool Destroy(Socket* sock)
 	{
-		if (socket != nullptr && sock->handle != WI_NULL_HANDLE)
+		if (socket != nullptr && sock->handle != INVALID_HANDLE)
 		{
 			int result = closesocket((SOCKET)sock->handle);
 			if (result == SOCKET_ERROR)
@@ -77,7 +90,7 @@ namespace wiNetwork
 				return false;
 			}
 
-			sock->handle = WI_NULL_HANDLE;
+			sock->handle = INVALID_HANDLE;
 			return true;
 		}
 		return false;
@@ -85,7 +98,7 @@ namespace wiNetwork
 
 	bool Send(const Socket* sock, const Connection* connection, const void* data, size_t dataSize)
 	{
-		if (socket != nullptr && sock->handle != WI_NULL_HANDLE)
+		if (socket != nullptr && sock->handle != INVALID_HANDLE)
 		{
 			sockaddr_in target;
 			target.sin_family = AF_INET;
@@ -96,6 +109,7 @@ namespace wiNetwork
 			target.sin_addr.S_un.S_un_b.s_b4 = connection->ipaddress[3];
 
 			int result = sendto((SOCKET)sock->handle, (const char*)data, (int)dataSize, 0, (const sockaddr*)& target, sizeof(target));
+			systemCalls++;
 			if (result == SOCKET_ERROR)
 			{
 				int error = WSAGetLastError();
@@ -105,6 +119,8 @@ namespace wiNetwork
 				return false;
 			}
 
+			packetsSent++;
+			bytesSent += (uint64_t)result;
 			return true;
 		}
 		return false;
@@ -112,7 +128,7 @@ namespace wiNetwork
 
 	bool ListenPort(const Socket* sock, uint16_t port)
 	{
-		if (socket != nullptr && sock->handle != WI_NULL_HANDLE)
+		if (socket != nullptr && sock->handle != INVALID_HANDLE)
 		{
 			sockaddr_in target;
 			target.sin_family = AF_INET;
@@ -136,7 +152,7 @@ namespace wiNetwork
 
 	bool CanReceive(const Socket* sock, long timeout_microseconds)
 	{
-		if (socket != nullptr && sock->handle != WI_NULL_HANDLE)
+		if (socket != nullptr && sock->handle != INVALID_HANDLE)
 		{
 			fd_set readfds;
 			FD_ZERO(&readfds);
@@ -145,6 +161,7 @@ namespace wiNetwork
 			timeout.tv_sec = 0;
 			timeout.tv_usec = timeout_microseconds;
 			int result = select(0, &readfds, NULL, NULL, &timeout);
+			systemCalls++;
 			if (result < 0)
 			{
 				std::stringstream ss;
@@ -161,11 +178,12 @@ namespace wiNetwork
 
 	bool Receive(const Socket* sock, Connection* connection, void* data, size_t dataSize)
 	{
-		if (socket != nullptr && sock->handle != WI_NULL_HANDLE)
+		if (socket != nullptr && sock->handle != INVALID_HANDLE)
 		{
 			sockaddr_in sender;
 			int targetsize = sizeof(sender);
 			int result = recvfrom((SOCKET)sock->handle, (char*)data, (int)dataSize, 0, (sockaddr*)& sender, &targetsize);
+			systemCalls++;
 			if (result == SOCKET_ERROR)
 			{
 				int error = WSAGetLastError();
@@ -181,11 +199,222 @@ namespace wiNetwork
 			connection->ipaddress[2] = sender.sin_addr.S_un.S_un_b.s_b3;
 			connection->ipaddress[3] = sender.sin_addr.S_un.S_un_b.s_b4;
 
+			packetsReceived++;
+			bytesReceived += (uint64_t)result;
+			return true;
+		}
+		return false;
+	}
+
+	bool SetNonBlocking(const Socket* sock, bool enabled)
+	{
+		if (sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			u_long mode = enabled ? 1 : 0;
+			int result = ioctlsocket((SOCKET)sock->handle, FIONBIO, &mode);
+			if (result == SOCKET_ERROR)
+			{
+				int error = WSAGetLastError();
+				std::stringstream ss;
+				ss << "wiNetwork error in SetNonBlocking: " << error;
+				wiBackLog::post(ss.str().c_str());
+				return false;
+			}
 			return true;
 		}
 		return false;
 	}
 
+	// Winsock has no batched datagram calls, the packets are sent and received one by one:
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count)
+	{
+		if (sock == nullptr || sock->handle == INVALID_HANDLE)
+		{
+			return 0;
+		}
+
+		size_t sent = 0;
+		for (; sent < count; ++sent)
+		{
+			const Packet& packet = packets[sent];
+			sockaddr_in target;
+			target.sin_family = AF_INET;
+			target.sin_port = htons(packet.connection.port);
+			target.sin_addr.S_un.S_un_b.s_b1 = packet.connection.ipaddress[0];
+			target.sin_addr.S_un.S_un_b.s_b2 = packet.connection.ipaddress[1];
+			target.sin_addr.S_un.S_un_b.s_b3 = packet.connection.ipaddress[2];
+			target.sin_addr.S_un.S_un_b.s_b4 = packet.connection.ipaddress[3];
+
+			int result = sendto((SOCKET)sock->handle, (const char*)packet.data, (int)packet.dataSize, 0, (const sockaddr*)& target, sizeof(target));
+			systemCalls++;
+			if (result == SOCKET_ERROR)
+			{
+				int error = WSAGetLastError();
+				if (error != WSAEWOULDBLOCK)
+				{
+					std::stringstream ss;
+					ss << "wiNetwork error in SendBatch: " << error;
+					wiBackLog::post(ss.str().c_str());
+				}
+				break;
+			}
+			packetsSent++;
+			bytesSent += (uint64_t)result;
+		}
+		return sent;
+	}
+
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count)
+	{
+		if (sock == nullptr || sock->handle == INVALID_HANDLE)
+		{
+			return 0;
+		}
+
+		size_t received = 0;
+		for (; received < count; ++received)
+		{
+			// The socket can be in blocking mode, so check that a packet is waiting before reading it:
+			if (!CanReceive(sock, 0))
+			{
+				break;
+			}
+
+			Packet& packet = packets[received];
+			sockaddr_in sender;
+			int targetsize = sizeof(sender);
+			int result = recvfrom((SOCKET)sock->handle, (char*)packet.data, (int)PACKET_CAPACITY, 0, (sockaddr*)& sender, &targetsize);
+			systemCalls++;
+			if (result == SOCKET_ERROR)
+			{
+				int error = WSAGetLastError();
+				if (error != WSAEWOULDBLOCK)
+				{
+					std::stringstream ss;
+					ss << "wiNetwork error in ReceiveBatch: " << error;
+					wiBackLog::post(ss.str().c_str());
+				}
+				break;
+			}
+
+			packet.dataSize = (size_t)result;
+			packet.connection.port = htons(sender.sin_port);
+			packet.connection.ipaddress[0] = sender.sin_addr.S_un.S_un_b.s_b1;
+			packet.connection.ipaddress[1] = sender.sin_addr.S_un.S_un_b.s_b2;
+			packet.connection.ipaddress[2] = sender.sin_addr.S_un.S_un_b.s_b3;
+			packet.connection.ipaddress[3] = sender.sin_addr.S_un.S_un_b.s_b4;
+			packetsReceived++;
+			bytesReceived += (uint64_t)result;
+		}
+		return received;
+	}
+
+	// The poller keeps the list of sockets and waits on them with select():
+	bool CreatePoller(Poller* poller)
+	{
+		Destroy(poller);
+		poller->handle = (wiCPUHandle)new std::vector<const Socket*>;
+		return true;
+	}
+	bool Destroy(Poller* poller)
+	{
+		if (poller != nullptr && poller->handle != INVALID_HANDLE)
+		{
+			delete (std::vector<const Socket*>*)poller->handle;
+			poller->handle = INVALID_HANDLE;
+			return true;
+		}
+		return false;
+	}
+	bool PollerAdd(const Poller* poller, const Socket* sock)
+	{
+		if (poller != nullptr && poller->handle != INVALID_HANDLE && sock != nullptr && sock->handle != INVALID_HANDLE)
+		{
+			auto& sockets = *(std::vector<const Socket*>*)poller->handle;
+			if (sockets.size() >= FD_SETSIZE || std::find(sockets.begin(), sockets.end(), sock) != sockets.end())
+			{
+				return false;
+			}
+			sockets.push_back(sock);
+			return true;
+		}
+		return false;
+	}
+	bool PollerRemove(const Poller* poller, const Socket* sock)
+	{
+		if (poller != nullptr && poller->handle != INVALID_HANDLE)
+		{
+			auto& sockets = *(std::vector<const Socket*>*)poller->handle;
+			auto it = std::find(sockets.begin(), sockets.end(), sock);
+			if (it != sockets.end())
+			{
+				sockets.erase(it);
+				return true;
+			}
+		}
+		return false;
+	}
+	size_t PollerWait(const Poller* poller, const Socket** ready, size_t readyCapacity, long timeout_microseconds)
+	{
+		if (poller == nullptr || poller->handle == INVALID_HANDLE)
+		{
+			return 0;
+		}
+		const auto& sockets = *(const std::vector<const Socket*>*)poller->handle;
+		if (sockets.empty())
+		{
+			return 0;
+		}
+
+		fd_set readfds;
+		FD_ZERO(&readfds);
+		for (const Socket* sock : sockets)
+		{
+			FD_SET((SOCKET)sock->handle, &readfds);
+		}
+		timeval timeout;
+		timeout.tv_sec = timeout_microseconds / 1000000;
+		timeout.tv_usec = timeout_microseconds % 1000000;
+		int result = select(0, &readfds, NULL, NULL, timeout_microseconds < 0 ? NULL : &timeout);
+		systemCalls++;
+		if (result == SOCKET_ERROR)
+		{
+			std::stringstream ss;
+			ss << "wiNetwork error in PollerWait: " << WSAGetLastError();
+			wiBackLog::post(ss.str().c_str());
+			return 0;
+		}
+
+		size_t count = 0;
+		for (const Socket* sock : sockets)
+		{
+			if (count < readyCapacity && FD_ISSET((SOCKET)sock->handle, &readfds))
+			{
+				ready[count++] = sock;
+			}
+		}
+		return count;
+	}
+
+	Statistics GetStatistics()
+	{
+		Statistics statistics;
+		statistics.packetsSent = packetsSent.load();
+		statistics.packetsReceived = packetsReceived.load();
+		statistics.bytesSent = bytesSent.load();
+		statistics.bytesReceived = bytesReceived.load();
+		statistics.systemCalls = systemCalls.load();
+		return statistics;
+	}
+	void ResetStatistics()
+	{
+		packetsSent.store(0);
+		packetsReceived.store(0);
+		bytesSent.store(0);
+		bytesReceived.store(0);
+		systemCalls.store(0);
+	}
+
 }
 
 #endif // WINSTORE_SUPPORT
@@ -1,4 +1,5 @@
 #include "wiOcean.h"
+#include "wiOcean_CPU.h"
 #include "wiRenderer.h"
 #include "wiResourceManager.h"
 #include "ShaderInterop_Ocean.h"
@@ -33,40 +34,6 @@ namespace wiOcean_Internal
 using namespace wiOcean_Internal;
 
 
-#define HALF_SQRT_2	0.7071068f
-#define GRAV_ACCEL	981.0f	// The acceleration of gravity, cm/s^2
-
-// Generating gaussian random number with mean 0 and standard deviation 1.
-float Gauss()
-{
-	float u1 = rand() / (float)RAND_MAX;
-	float u2 = rand() / (float)RAND_MAX;
-	if (u1 < 1e-6f)
-		u1 = 1e-6f;
-	return sqrtf(-2 * logf(u1)) * cosf(2 * XM_PI * u2);
-}
-
-// Phillips Spectrum
-// K: normalized wave vector, W: wind direction, v: wind velocity, a: amplitude constant
-float Phillips(XMFLOAT2 K, XMFLOAT2 W, float v, float a, float dir_depend)
-{
-	// largest possible wave from constant wind of velocity v
-	float l = v * v / GRAV_ACCEL;
-	// damp out waves with very small length w << l
-	float w = l / 1000;
-
-	float Ksqr = K.x * K.x + K.y * K.y;
-	float Kcos = K.x * W.x + K.y * W.y;
-	float phillips = a * expf(-1 / (l * l * Ksqr)) / (Ksqr * Ksqr * Ksqr) * (Kcos * Kcos);
-
-	// filter out waves moving opposite to wind
-	if (Kcos < 0)
-		phillips *= dir_depend;
-
-	// damp out waves with very small length w << l
-	return phillips * expf(-Ksqr * w * w);
-}
-
 void createBufferAndUAV(void* data, uint32_t byte_width, uint32_t byte_stride, GPUBuffer* pBuffer)
 {
 	// Create buffer
@@ -197,50 +164,10 @@ wiOcean::~wiOcean()
 
 
 // Initialize the vector field.
-// wlen_x: width of wave tile, in meters
-// wlen_y: length of wave tile, in meters
+// The spectrum is shared with the CPU simulation, so wiOceanCPU with the same seed computes the same waves.
 void wiOcean::initHeightMap(const WeatherComponent& weather, XMFLOAT2* out_h0, float* out_omega)
 {
-	auto& params = weather.oceanParameters;
-
-	int i, j;
-	XMFLOAT2 K;
-
-	XMFLOAT2 wind_dir;
-	XMStoreFloat2(&wind_dir, XMVector2Normalize(XMLoadFloat2(&params.wind_dir)));
-	float a = params.wave_amplitude * 1e-7f;	// It is too small. We must scale it for editing.
-	float v = params.wind_speed;
-	float dir_depend = params.wind_dependency;
-
-	int height_map_dim = params.dmap_dim;
-	float patch_length = params.patch_length;
-
-
-	for (i = 0; i <= height_map_dim; i++)
-	{
-		// K is wave-vector, range [-|DX/W, |DX/W], [-|DY/H, |DY/H]
-		K.y = (-height_map_dim / 2.0f + i) * (2 * XM_PI / patch_length);
-
-		for (j = 0; j <= height_map_dim; j++)
-		{
-			K.x = (-height_map_dim / 2.0f + j) * (2 * XM_PI / patch_length);
-
-			float phil = (K.x == 0 && K.y == 0) ? 0 : sqrtf(Phillips(K, wind_dir, v, a, dir_depend));
-
-			out_h0[i * (height_map_dim + 4) + j].x = float(phil * Gauss() * HALF_SQRT_2);
-			out_h0[i * (height_map_dim + 4) + j].y = float(phil * Gauss() * HALF_SQRT_2);
-
-			// The angular frequency is following the dispersion relation:
-			//            out_omega^2 = g*k
-			// The equation of Gerstner wave:
-			//            x = x0 - K/k * A * sin(dot(K, x0) - sqrt(g * k) * t), x is a 2D vector.
-			//            z = A * cos(dot(K, x0) - sqrt(g * k) * t)
-			// Gerstner wave shows that a point on a simple sinusoid wave is doing a uniform circular
-			// motion with the center (x0, y0, z0), radius A, and the circular plane is parallel to
-			// vector K.
-			out_omega[i * (height_map_dim + 4) + j] = sqrtf(GRAV_ACCEL * sqrtf(K.x * K.x + K.y * K.y));
-		}
-	}
+	wiOceanCPU::InitHeightMap(weather.oceanParameters, 0, out_h0, out_omega);
 }
 
 void wiOcean::UpdateDisplacementMap(const WeatherComponent& weather, float time, CommandList cmd) const
@@ -0,0 +1,543 @@
+#include "wiOcean_CPU.h"
+#include "wiJobSystem.h"
+#include "wiRandom.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace wiScene;
+
+#define HALF_SQRT_2	0.7071068f
+#define GRAV_ACCEL	981.0f	// The acceleration of gravity, cm/s^2
+
+static const uint32_t STRIP_WIDTH = 16;		// columns per FFT job, must be a multiple of 4
+static const uint32_t QUERY_GROUP_SIZE = 256;
+
+// Random number in [0, 1), the state is advanced
+static inline float Random(uint32_t& state)
+{
+	state = wiRandom::hash(state);
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+// Generating gaussian random number with mean 0 and standard deviation 1.
+static float Gauss(uint32_t& state)
+{
+	float u1 = Random(state);
+	float u2 = Random(state);
+	if (u1 < 1e-6f)
+		u1 = 1e-6f;
+	return sqrtf(-2 * logf(u1)) * cosf(2 * XM_PI * u2);
+}
+
+// Phillips Spectrum
+// K: normalized wave vector, W: wind direction, v: wind velocity, a: amplitude constant
+static float Phillips(XMFLOAT2 K, XMFLOAT2 W, float v, float a, float dir_depend)
+{
+	// largest possible wave from constant wind of velocity v
+	float l = v * v / GRAV_ACCEL;
+	// damp out waves with very small length w << l
+	float w = l / 1000;
+
+	float Ksqr = K.x * K.x + K.y * K.y;
+	float Kcos = K.x * W.x + K.y * W.y;
+	float phillips = a * expf(-1 / (l * l * Ksqr)) / (Ksqr * Ksqr * Ksqr) * (Kcos * Kcos);
+
+	// filter out waves moving opposite to wind
+	if (Kcos < 0)
+		phillips *= dir_depend;
+
+	// damp out waves with very small length w << l
+	return phillips * expf(-Ksqr * w * w);
+}
+
+// H(0) and angular frequency of the wave at row i, column j of the GPU height map
+static void InitialWave(const wiOceanCPU::OceanParameters& params, uint32_t seed, int i, int j, XMFLOAT2& h0, float& omega)
+{
+	XMFLOAT2 wind_dir;
+	XMStoreFloat2(&wind_dir, XMVector2Normalize(XMLoadFloat2(&params.wind_dir)));
+	float a = params.wave_amplitude * 1e-7f;	// It is too small. We must scale it for editing.
+	float v = params.wind_speed;
+	float dir_depend = params.wind_dependency;
+
+	int height_map_dim = params.dmap_dim;
+	float patch_length = params.patch_length;
+
+	// K is wave-vector, range [-|DX/W, |DX/W], [-|DY/H, |DY/H]
+	XMFLOAT2 K;
+	K.y = (-height_map_dim / 2.0f + i) * (2 * XM_PI / patch_length);
+	K.x = (-height_map_dim / 2.0f + j) * (2 * XM_PI / patch_length);
+
+	float phil = (K.x == 0 && K.y == 0) ? 0 : sqrtf(Phillips(K, wind_dir, v, a, dir_depend));
+
+	uint32_t state = seed ^ wiRandom::hash(uint32_t(i * (height_map_dim + 4) + j));
+	h0.x = float(phil * Gauss(state) * HALF_SQRT_2);
+	h0.y = float(phil * Gauss(state) * HALF_SQRT_2);
+
+	// The angular frequency is following the dispersion relation:
+	//            out_omega^2 = g*k
+	// The equation of Gerstner wave:
+	//            x = x0 - K/k * A * sin(dot(K, x0) - sqrt(g * k) * t), x is a 2D vector.
+	//            z = A * cos(dot(K, x0) - sqrt(g * k) * t)
+	// Gerstner wave shows that a point on a simple sinusoid wave is doing a uniform circular
+	// motion with the center (x0, y0, z0), radius A, and the circular plane is parallel to
+	// vector K.
+	omega = sqrtf(GRAV_ACCEL * sqrtf(K.x * K.x + K.y * K.y));
+}
+
+void wiOceanCPU::InitHeightMap(const OceanParameters& params, uint32_t seed, XMFLOAT2* out_h0, float* out_omega)
+{
+	int height_map_dim = params.dmap_dim;
+	for (int i = 0; i <= height_map_dim; i++)
+	{
+		for (int j = 0; j <= height_map_dim; j++)
+		{
+			const int index = i * (height_map_dim + 4) + j;
+			InitialWave(params, seed, i, j, out_h0[index], out_omega[index]);
+		}
+	}
+}
+
+
+void wiOceanCPU::Initialize(const OceanParameters& params, uint32_t resolution, uint32_t seed)
+{
+	this->params = params;
+	this->seed = seed;
+
+	// Power of two between 4 and the GPU map size:
+	const uint32_t dmap_dim = (uint32_t)std::max(4, params.dmap_dim);
+	resolution = std::max(4u, std::min(resolution, dmap_dim));
+	uint32_t pow2 = 4;
+	while (pow2 * 2 <= resolution)
+	{
+		pow2 *= 2;
+	}
+	this->resolution = pow2;
+
+	const uint32_t M = this->resolution;
+	const uint32_t size = M * M;
+	for (auto& stream : spectrum)
+	{
+		stream.resize(size);
+	}
+	heightDX_re.resize(size);
+	heightDX_im.resize(size);
+	DZ_re.resize(size);
+	DZ_im.resize(size);
+	temp_re.resize(size);
+	temp_im.resize(size);
+	displacementMap.resize(size);
+
+	// The waves of the frequency range [-M/2, M/2) are taken from the GPU height map, they are stored with the zero frequency first:
+	const int N = params.dmap_dim;
+	for (uint32_t row = 0; row < M; ++row)
+	{
+		const int kz = row < M / 2 ? int(row) : int(row) - int(M);
+		const int i = kz + N / 2;
+		for (uint32_t column = 0; column < M; ++column)
+		{
+			const int kx = column < M / 2 ? int(column) : int(column) - int(M);
+			const int j = kx + N / 2;
+			const uint32_t index = row * M + column;
+
+			XMFLOAT2 h0, h0_minus;
+			float omega, omega_minus;
+			InitialWave(params, seed, i, j, h0, omega);
+			InitialWave(params, seed, N - i, N - j, h0_minus, omega_minus);
+
+			spectrum[H0_RE][index] = h0.x;
+			spectrum[H0_IM][index] = h0.y;
+			spectrum[H0_MINUS_RE][index] = h0_minus.x;
+			spectrum[H0_MINUS_IM][index] = h0_minus.y;
+			spectrum[OMEGA][index] = omega;
+
+			// Same as in oceanSimulatorCS:
+			float dir_x = float(kx);
+			float dir_z = float(kz);
+			float sqr_k = dir_x * dir_x + dir_z * dir_z;
+			float rsqr_k = 0;
+			if (sqr_k > 1e-12f)
+				rsqr_k = 1 / sqrtf(sqr_k);
+			spectrum[DIRECTION_X][index] = dir_x * rsqr_k;
+			spectrum[DIRECTION_Z][index] = dir_z * rsqr_k;
+		}
+	}
+
+	twiddle_re.resize(M / 2);
+	twiddle_im.resize(M / 2);
+	for (uint32_t k = 0; k < M / 2; ++k)
+	{
+		// Same direction as the GPU FFT (negative phase):
+		const double phase = -2.0 * 3.14159265358979323846 * double(k) / double(M);
+		twiddle_re[k] = float(std::cos(phase));
+		twiddle_im[k] = float(std::sin(phase));
+	}
+
+	bitReverse.resize(M);
+	uint32_t bits = 0;
+	while ((1u << bits) < M)
+	{
+		bits++;
+	}
+	for (uint32_t i = 0; i < M; ++i)
+	{
+		uint32_t reversed = 0;
+		for (uint32_t b = 0; b < bits; ++b)
+		{
+			reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+		}
+		bitReverse[i] = reversed;
+	}
+
+	time = 0;
+	valid = false;
+}
+
+bool wiOceanCPU::IsUpToDate(const OceanParameters& params) const
+{
+	return
+		resolution > 0 &&
+		this->params.dmap_dim == params.dmap_dim &&
+		this->params.patch_length == params.patch_length &&
+		this->params.time_scale == params.time_scale &&
+		this->params.wave_amplitude == params.wave_amplitude &&
+		this->params.wind_dir.x == params.wind_dir.x &&
+		this->params.wind_dir.y == params.wind_dir.y &&
+		this->params.wind_speed == params.wind_speed &&
+		this->params.wind_dependency == params.wind_dependency &&
+		this->params.choppy_scale == params.choppy_scale &&
+		this->params.waterHeight == params.waterHeight;
+}
+
+// H(0) -> H(t), D(x, t), D(z, t) like oceanSimulatorCS, but the inputs of the FFT are packed:
+//	The GPU only keeps the real part of the FFT results. That is the FFT of the hermitian part of the input, which has a real result,
+//	so the height and the x displacement can be transformed together as (height + i * x displacement).
+void wiOceanCPU::ComputeSpectrum(float simulationTime)
+{
+	const uint32_t M = resolution;
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, M, 1, [&](wiJobDispatchArgs args) {
+		const XMVECTOR ONE = XMVectorSplatOne();
+		const XMVECTOR TIME = XMVectorReplicate(simulationTime);
+
+		const uint32_t begin = args.jobIndex * M;
+		const uint32_t end = begin + M;
+		for (uint32_t i = begin; i < end; i += 4)
+		{
+			const XMVECTOR h0_re = XMLoadFloat4((const XMFLOAT4*)&spectrum[H0_RE][i]);
+			const XMVECTOR h0_im = XMLoadFloat4((const XMFLOAT4*)&spectrum[H0_IM][i]);
+			const XMVECTOR h0_minus_re = XMLoadFloat4((const XMFLOAT4*)&spectrum[H0_MINUS_RE][i]);
+			const XMVECTOR h0_minus_im = XMLoadFloat4((const XMFLOAT4*)&spectrum[H0_MINUS_IM][i]);
+			const XMVECTOR omega = XMLoadFloat4((const XMFLOAT4*)&spectrum[OMEGA][i]);
+			const XMVECTOR dir_x = XMLoadFloat4((const XMFLOAT4*)&spectrum[DIRECTION_X][i]);
+			const XMVECTOR dir_z = XMLoadFloat4((const XMFLOAT4*)&spectrum[DIRECTION_Z][i]);
+
+			XMVECTOR sin_v, cos_v;
+			XMVectorSinCos(&sin_v, &cos_v, XMVectorMultiply(omega, TIME));
+
+			const XMVECTOR ht_re = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(h0_re, h0_minus_re), cos_v), XMVectorMultiply(XMVectorAdd(h0_im, h0_minus_im), sin_v));
+			const XMVECTOR ht_im = XMVectorAdd(XMVectorMultiply(XMVectorSubtract(h0_re, h0_minus_re), sin_v), XMVectorMultiply(XMVectorSubtract(h0_im, h0_minus_im), cos_v));
+
+			// D(x) = -i * dir_x * H, so H + i * D(x) = (1 + dir_x) * H
+			const XMVECTOR scale = XMVectorAdd(ONE, dir_x);
+			XMStoreFloat4((XMFLOAT4*)&heightDX_re[i], XMVectorMultiply(ht_re, scale));
+			XMStoreFloat4((XMFLOAT4*)&heightDX_im[i], XMVectorMultiply(ht_im, scale));
+			XMStoreFloat4((XMFLOAT4*)&DZ_re[i], XMVectorMultiply(ht_im, dir_z));
+			XMStoreFloat4((XMFLOAT4*)&DZ_im[i], XMVectorNegate(XMVectorMultiply(ht_re, dir_z)));
+		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	// The inputs are already hermitian, except on the lines of the lowest frequency (-M/2), whose opposite waves are not simulated.
+	//	The hermitian part is computed for them explicitly:
+	auto wave = [&](uint32_t i, XMFLOAT2& ht, XMFLOAT2& dx, XMFLOAT2& dz) {
+		const float h0_re = spectrum[H0_RE][i];
+		const float h0_im = spectrum[H0_IM][i];
+		const float h0_minus_re = spectrum[H0_MINUS_RE][i];
+		const float h0_minus_im = spectrum[H0_MINUS_IM][i];
+		const float sin_v = sinf(spectrum[OMEGA][i] * simulationTime);
+		const float cos_v = cosf(spectrum[OMEGA][i] * simulationTime);
+		ht.x = (h0_re + h0_minus_re) * cos_v - (h0_im + h0_minus_im) * sin_v;
+		ht.y = (h0_re - h0_minus_re) * sin_v + (h0_im - h0_minus_im) * cos_v;
+		dx = XMFLOAT2(ht.y * spectrum[DIRECTION_X][i], -ht.x * spectrum[DIRECTION_X][i]);
+		dz = XMFLOAT2(ht.y * spectrum[DIRECTION_Z][i], -ht.x * spectrum[DIRECTION_Z][i]);
+	};
+	auto symmetrize = [&](uint32_t row, uint32_t column) {
+		const uint32_t i = row * M + column;
+		const uint32_t mirror = ((M - row) & (M - 1)) * M + ((M - column) & (M - 1));
+		XMFLOAT2 ht, dx, dz, ht_mirror, dx_mirror, dz_mirror;
+		wave(i, ht, dx, dz);
+		wave(mirror, ht_mirror, dx_mirror, dz_mirror);
+		const XMFLOAT2 height = XMFLOAT2((ht.x + ht_mirror.x) * 0.5f, (ht.y - ht_mirror.y) * 0.5f);
+		const XMFLOAT2 disp_x = XMFLOAT2((dx.x + dx_mirror.x) * 0.5f, (dx.y - dx_mirror.y) * 0.5f);
+		heightDX_re[i] = height.x - disp_x.y;
+		heightDX_im[i] = height.y + disp_x.x;
+		DZ_re[i] = (dz.x + dz_mirror.x) * 0.5f;
+		DZ_im[i] = (dz.y - dz_mirror.y) * 0.5f;
+	};
+	const uint32_t nyquist = M / 2;
+	for (uint32_t j = 0; j < M; ++j)
+	{
+		symmetrize(nyquist, j);
+		if (j != nyquist)
+		{
+			symmetrize(j, nyquist);
+		}
+	}
+}
+
+// Radix-2 FFT of the columns, four columns are processed at once. A job transforms a strip of columns.
+void wiOceanCPU::FFT(vector<float>& re, vector<float>& im)
+{
+	const uint32_t M = resolution;
+	const uint32_t stripWidth = std::min(STRIP_WIDTH, M);
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, M / stripWidth, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * stripWidth;
+		const uint32_t end = begin + stripWidth;
+
+		for (uint32_t row = 0; row < M; ++row)
+		{
+			const uint32_t reversed = bitReverse[row];
+			if (reversed > row)
+			{
+				for (uint32_t column = begin; column < end; column += 4)
+				{
+					XMFLOAT4* a_re = (XMFLOAT4*)&re[row * M + column];
+					XMFLOAT4* a_im = (XMFLOAT4*)&im[row * M + column];
+					XMFLOAT4* b_re = (XMFLOAT4*)&re[reversed * M + column];
+					XMFLOAT4* b_im = (XMFLOAT4*)&im[reversed * M + column];
+					std::swap(*a_re, *b_re);
+					std::swap(*a_im, *b_im);
+				}
+			}
+		}
+
+		for (uint32_t size = 2; size <= M; size *= 2)
+		{
+			const uint32_t half = size / 2;
+			const uint32_t step = M / size;
+			for (uint32_t start = 0; start < M; start += size)
+			{
+				for (uint32_t k = 0; k < half; ++k)
+				{
+					const XMVECTOR W_RE = XMVectorReplicate(twiddle_re[k * step]);
+					const XMVECTOR W_IM = XMVectorReplicate(twiddle_im[k * step]);
+					const uint32_t a = (start + k) * M;
+					const uint32_t b = (start + k + half) * M;
+					for (uint32_t column = begin; column < end; column += 4)
+					{
+						const XMVECTOR A_re = XMLoadFloat4((const XMFLOAT4*)&re[a + column]);
+						const XMVECTOR A_im = XMLoadFloat4((const XMFLOAT4*)&im[a + column]);
+						const XMVECTOR B_re = XMLoadFloat4((const XMFLOAT4*)&re[b + column]);
+						const XMVECTOR B_im = XMLoadFloat4((const XMFLOAT4*)&im[b + column]);
+						const XMVECTOR T_re = XMVectorSubtract(XMVectorMultiply(B_re, W_RE), XMVectorMultiply(B_im, W_IM));
+						const XMVECTOR T_im = XMVectorAdd(XMVectorMultiply(B_re, W_IM), XMVectorMultiply(B_im, W_RE));
+						XMStoreFloat4((XMFLOAT4*)&re[a + column], XMVectorAdd(A_re, T_re));
+						XMStoreFloat4((XMFLOAT4*)&im[a + column], XMVectorAdd(A_im, T_im));
+						XMStoreFloat4((XMFLOAT4*)&re[b + column], XMVectorSubtract(A_re, T_re));
+						XMStoreFloat4((XMFLOAT4*)&im[b + column], XMVectorSubtract(A_im, T_im));
+					}
+				}
+			}
+		}
+	});
+	wiJobSystem::Wait(ctx);
+}
+
+void wiOceanCPU::Transpose(vector<float>& re, vector<float>& im)
+{
+	const uint32_t M = resolution;
+	const uint32_t stripWidth = std::min(STRIP_WIDTH, M);
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, M / stripWidth, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t begin = args.jobIndex * stripWidth;
+		const uint32_t end = begin + stripWidth;
+		for (uint32_t column = 0; column < M; column += stripWidth)
+		{
+			for (uint32_t row = begin; row < end; ++row)
+			{
+				for (uint32_t i = column; i < column + stripWidth; ++i)
+				{
+					temp_re[i * M + row] = re[row * M + i];
+					temp_im[i * M + row] = im[row * M + i];
+				}
+			}
+		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	re.swap(temp_re);
+	im.swap(temp_im);
+}
+
+void wiOceanCPU::Update(float time)
+{
+	if (resolution == 0)
+	{
+		return;
+	}
+	this->time = time;
+
+	ComputeSpectrum(time * params.time_scale);
+
+	// The zero frequency is in the first element, so the results don't need the sign correction of the GPU simulation:
+	FFT(heightDX_re, heightDX_im);
+	FFT(DZ_re, DZ_im);
+	Transpose(heightDX_re, heightDX_im);
+	Transpose(DZ_re, DZ_im);
+	FFT(heightDX_re, heightDX_im);
+	FFT(DZ_re, DZ_im);
+
+	// The results are transposed (row = x), they are written to the displacement map in the (row = z) layout:
+	const uint32_t M = resolution;
+	const float choppy_scale = params.choppy_scale;
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, M, 1, [&](wiJobDispatchArgs args) {
+		const uint32_t x = args.jobIndex;
+		for (uint32_t z = 0; z < M; ++z)
+		{
+			const uint32_t i = x * M + z;
+			displacementMap[z * M + x] = XMFLOAT4(heightDX_im[i] * choppy_scale, heightDX_re[i], DZ_re[i] * choppy_scale, 0);
+		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	valid = true;
+}
+
+size_t wiOceanCPU::GetMemorySizeInBytes() const
+{
+	size_t size = 0;
+	for (auto& stream : spectrum)
+	{
+		size += stream.capacity() * sizeof(float);
+	}
+	size += heightDX_re.capacity() * sizeof(float);
+	size += heightDX_im.capacity() * sizeof(float);
+	size += DZ_re.capacity() * sizeof(float);
+	size += DZ_im.capacity() * sizeof(float);
+	size += temp_re.capacity() * sizeof(float);
+	size += temp_im.capacity() * sizeof(float);
+	size += twiddle_re.capacity() * sizeof(float);
+	size += twiddle_im.capacity() * sizeof(float);
+	size += bitReverse.capacity() * sizeof(uint32_t);
+	size += displacementMap.capacity() * sizeof(XMFLOAT4);
+	return size;
+}
+
+XMVECTOR XM_CALLCONV wiOceanCPU::Bilinear(float x, float z, XMVECTOR* ddx, XMVECTOR* ddz) const
+{
+	// Texel (i, j) is at world position (i, j) * patch_length / resolution:
+	const uint32_t M = resolution;
+	const float scale = M / params.patch_length;
+	const float u = x * scale;
+	const float v = z * scale;
+	const float u_floor = floorf(u);
+	const float v_floor = floorf(v);
+	const float fu = u - u_floor;
+	const float fv = v - v_floor;
+	const uint32_t x0 = uint32_t(int64_t(u_floor)) & (M - 1);
+	const uint32_t z0 = uint32_t(int64_t(v_floor)) & (M - 1);
+	const uint32_t x1 = (x0 + 1) & (M - 1);
+	const uint32_t z1 = (z0 + 1) & (M - 1);
+
+	const XMVECTOR d00 = XMLoadFloat4(&displacementMap[z0 * M + x0]);
+	const XMVECTOR d10 = XMLoadFloat4(&displacementMap[z0 * M + x1]);
+	const XMVECTOR d01 = XMLoadFloat4(&displacementMap[z1 * M + x0]);
+	const XMVECTOR d11 = XMLoadFloat4(&displacementMap[z1 * M + x1]);
+
+	const XMVECTOR d0 = XMVectorLerp(d00, d10, fu);
+	const XMVECTOR d1 = XMVectorLerp(d01, d11, fu);
+	if (ddx != nullptr)
+	{
+		*ddx = XMVectorScale(XMVectorLerp(XMVectorSubtract(d10, d00), XMVectorSubtract(d11, d01), fv), scale);
+		*ddz = XMVectorScale(XMVectorSubtract(d1, d0), scale);
+	}
+	return XMVectorLerp(d0, d1, fv);
+}
+
+XMFLOAT3 wiOceanCPU::GetDisplacement(float x, float z) const
+{
+	if (!valid)
+	{
+		return XMFLOAT3(0, 0, 0);
+	}
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, Bilinear(x, z, nullptr, nullptr));
+	return result;
+}
+
+XMFLOAT2 wiOceanCPU::FindSurfacePoint(float x, float z) const
+{
+	if (!valid)
+	{
+		return XMFLOAT2(x, z);
+	}
+
+	// Solve p + displacement(p) = (x, z) with Newton iteration, the derivatives of the bilinear filter give the Jacobian.
+	//	Where the surface is nearly folded, the Jacobian can't be inverted reliably and a fixed point step is taken instead.
+	float px = x;
+	float pz = z;
+	for (int iteration = 0; iteration < 4; ++iteration)
+	{
+		XMVECTOR ddx, ddz;
+		XMFLOAT3 d, d_dx, d_dz;
+		XMStoreFloat3(&d, Bilinear(px, pz, &ddx, &ddz));
+		XMStoreFloat3(&d_dx, ddx);
+		XMStoreFloat3(&d_dz, ddz);
+
+		const float fx = px + d.x - x;
+		const float fz = pz + d.z - z;
+		const float j11 = 1 + d_dx.x;
+		const float j12 = d_dz.x;
+		const float j21 = d_dx.z;
+		const float j22 = 1 + d_dz.z;
+		const float det = j11 * j22 - j12 * j21;
+		if (det > 0.1f)
+		{
+			px -= (j22 * fx - j12 * fz) / det;
+			pz -= (j11 * fz - j21 * fx) / det;
+		}
+		else
+		{
+			px -= fx;
+			pz -= fz;
+		}
+	}
+	return XMFLOAT2(px, pz);
+}
+
+float wiOceanCPU::SampleHeight(float x, float z) const
+{
+	const XMFLOAT2 p = FindSurfacePoint(x, z);
+	return params.waterHeight + GetDisplacement(p.x, p.y).y;
+}
+
+float wiOceanCPU::SampleHeight(float x, float z, float time)
+{
+	if (!valid || time != this->time)
+	{
+		Update(time);
+	}
+	return SampleHeight(x, z);
+}
+
+void wiOceanCPU::SampleHeight(const XMFLOAT2* positions, float* heights, uint32_t count, float time)
+{
+	if (!valid || time != this->time)
+	{
+		Update(time);
+	}
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, count, QUERY_GROUP_SIZE, [&](wiJobDispatchArgs args) {
+		const XMFLOAT2& position = positions[args.jobIndex];
+		heights[args.jobIndex] = SampleHeight(position.x, position.y);
+	});
+	wiJobSystem::Wait(ctx);
+}
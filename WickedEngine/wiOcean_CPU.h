@@ -0,0 +1,92 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiScene.h"
+
+#include <vector>
+
+// CPU ocean simulation with the same spectrum and FFT formulation as wiOcean, it doesn't need a graphics device
+//	The displacement map can be computed at a lower resolution than the GPU map, in that case only the low frequency waves are simulated.
+//	The spectrum is evaluated four waves at a time with DirectXMath vectors, the FFT passes are split into wiJobSystem jobs.
+//	Gameplay code (buoyancy, boats) and servers can query the height of the water surface at any position.
+class wiOceanCPU
+{
+public:
+	typedef wiScene::WeatherComponent::OceanParameters OceanParameters;
+
+	// Fill the initial spectrum H(0) and the angular frequencies in the layout of the GPU simulation
+	//	out_h0 and out_omega have (dmap_dim + 1) rows with a pitch of (dmap_dim + 4) elements
+	//	The random numbers are derived from the seed and the wave index, so every subset of the waves can be regenerated the same way
+	static void InitHeightMap(const OceanParameters& params, uint32_t seed, XMFLOAT2* out_h0, float* out_omega);
+
+private:
+	enum SPECTRUM_STREAM
+	{
+		H0_RE,				// H(0) of the wave
+		H0_IM,
+		H0_MINUS_RE,		// H(0) of the opposite wave
+		H0_MINUS_IM,
+		OMEGA,				// angular frequency
+		DIRECTION_X,		// normalized wave vector
+		DIRECTION_Z,
+		SPECTRUM_STREAM_COUNT
+	};
+	std::vector<float> spectrum[SPECTRUM_STREAM_COUNT];	// resolution * resolution elements, the zero frequency is in the first element
+
+	// FFT work planes, resolution * resolution elements:
+	std::vector<float> heightDX_re;		// height + i * x displacement
+	std::vector<float> heightDX_im;
+	std::vector<float> DZ_re;			// z displacement
+	std::vector<float> DZ_im;
+	std::vector<float> temp_re;
+	std::vector<float> temp_im;
+	std::vector<float> twiddle_re;
+	std::vector<float> twiddle_im;
+	std::vector<uint32_t> bitReverse;
+
+	std::vector<XMFLOAT4> displacementMap;	// world space displacement (x, height, z) of every texel
+
+	OceanParameters params;
+	uint32_t resolution = 0;
+	uint32_t seed = 0;
+	float time = 0;
+	bool valid = false;		// the displacement map is computed for the current time
+
+	void ComputeSpectrum(float simulationTime);
+	void FFT(std::vector<float>& re, std::vector<float>& im);
+	void Transpose(std::vector<float>& re, std::vector<float>& im);
+	// Bilinear lookup of the displacement map, optionally with the derivatives along x and z
+	XMVECTOR XM_CALLCONV Bilinear(float x, float z, XMVECTOR* ddx, XMVECTOR* ddz) const;
+
+public:
+	// Prepare the simulation of the ocean
+	//	resolution	: size of the displacement map, power of two between 4 and dmap_dim
+	//	seed		: must be the same as the seed of the GPU simulation to get the same waves
+	void Initialize(const OceanParameters& params, uint32_t resolution = 64, uint32_t seed = 0);
+	// Returns false if the parameters have changed since Initialize()
+	bool IsUpToDate(const OceanParameters& params) const;
+
+	// Compute the displacement map, time is the same as the time given to wiOcean::UpdateDisplacementMap()
+	void Update(float time);
+
+	uint32_t GetResolution() const { return resolution; }
+	float GetTime() const { return time; }
+	size_t GetMemorySizeInBytes() const;
+
+	// The queries below read the displacement map of the last Update()
+	//	The GPU surface also fades out the displacement far from the camera, that is not applied here
+
+	// Displacement of the point of the undisturbed water plane at (x, z), bilinear filtered and wrapped like the GPU texture lookup
+	XMFLOAT3 GetDisplacement(float x, float z) const;
+	// Position on the undisturbed water plane whose displaced surface point is over (x, z)
+	XMFLOAT2 FindSurfacePoint(float x, float z) const;
+	// Height of the displaced water surface above the position (x, z)
+	//	The horizontal displacement is taken into account with FindSurfacePoint()
+	float SampleHeight(float x, float z) const;
+	// Update the simulation if the time is different from the last update, then query the height
+	float SampleHeight(float x, float z, float time);
+	// Batch query: heights[i] is the water height above positions[i] (x, z), the queries run in parallel on wiJobSystem
+	void SampleHeight(const XMFLOAT2* positions, float* heights, uint32_t count, float time);
+
+	// Texel of the displacement map (x displacement, height, z displacement, 0)
+	const XMFLOAT4& GetDisplacementTexel(uint32_t x, uint32_t z) const { return displacementMap[z * resolution + x]; }
+};
@@ -2,6 +2,10 @@
 #include "wiECS.h"
 #include "wiScene_Decl.h"
 #include "wiJobSystem.h"
+#include "wiIntersect.h"
+
+#include <string>
+#include <vector>
 
 namespace wiPhysicsEngine
 {
@@ -10,6 +14,99 @@ namespace wiPhysicsEngine
 	bool IsEnabled();
 	void SetEnabled(bool value);
 
+	// Multithreaded simulation: collision detection, constraint solving and integration are split into wiJobSystem jobs (disabled by default)
+	//	Simulation islands are solved in parallel, so the results are not the same as with the single threaded simulation,
+	//	but they don't depend on the number of threads
+	bool IsMultithreaded();
+	void SetMultithreaded(bool value);
+
+	// Fixed timestep: the frame times are collected in an accumulator, and the simulation always advances in whole fixed steps (default: false)
+	//	The simulation result only depends on the total simulated time, not on the frame rate
+	//	The rigid body transforms are interpolated between the last two simulation steps, soft bodies use the last step
+	bool IsFixedTimestepEnabled();
+	void SetFixedTimestepEnabled(bool value);
+	// Length of a simulation step in seconds (default: 1/60)
+	float GetFixedTimestep();
+	void SetFixedTimestep(float seconds);
+	// At most this many steps are simulated in one update, the remaining time is carried over as physics debt (default: 4)
+	uint32_t GetMaxSubsteps();
+	void SetMaxSubsteps(uint32_t value);
+	struct FixedStepStats
+	{
+		uint32_t steps = 0;		// number of simulation steps in the last update
+		float alpha = 0;		// interpolation factor between the last two simulation steps
+		float debt = 0;			// simulation time in seconds that is behind because of the substep budget, it is at most maxSubsteps steps
+		float droppedTime = 0;	// total simulation time in seconds that was dropped because the debt was over the limit
+	};
+	FixedStepStats GetFixedStepStats();
+
+	// Collision shape cache: rigid bodies with the same mesh, shape type and scale share the same collision shape (default: true)
+	//	Scaled triangle meshes share the BVH of the unscaled mesh, and scaled convex hulls share the simplified hull
+	void SetShapeCacheEnabled(bool value);
+	bool IsShapeCacheEnabled();
+	// Convex hulls are simplified to at most this many vertices (default: 64)
+	void SetConvexHullVertexLimit(uint32_t value);
+	uint32_t GetConvexHullVertexLimit();
+	// Cooked shapes: simplified convex hulls and triangle mesh BVHs are stored in the cooked shape directory,
+	//	and they are loaded from there instead of computing them again (default: false)
+	//	The files are identified by the hash of the mesh data and the cooking settings
+	void SetCookedShapesEnabled(bool value);
+	bool IsCookedShapesEnabled();
+	// Set the directory where the cooked shapes are stored (default: "shapecache/")
+	void SetCookedShapeDirectory(const std::string& path);
+	std::string GetCookedShapeDirectory();
+
+	struct ShapeStats
+	{
+		uint32_t shapeCount = 0;	// number of collision shapes that are alive
+		size_t memory = 0;			// approximate memory used by the collision shapes, vertices, indices and BVHs in bytes
+	};
+	ShapeStats GetShapeStats();
+
+	// Queries against the physics world:
+	//	The queries use a read-only snapshot of the world that is taken at the first query after a physics update,
+	//	so any number of queries can run at the same time on multiple threads, but not together with RunPhysicsUpdateSystem
+	//	The batched queries are processed in parallel by the wiJobSystem
+	struct QueryHit
+	{
+		wiECS::Entity entity = wiECS::INVALID_ENTITY;	// INVALID_ENTITY if nothing was hit
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 normal = XMFLOAT3(0, 0, 0);
+		float distance = FLT_MAX;
+	};
+	struct QueryShape
+	{
+		enum TYPE
+		{
+			SPHERE,
+			BOX,
+		} type = SPHERE;
+		float radius = 0.5f;							// sphere radius
+		XMFLOAT3 halfExtents = XMFLOAT3(0.5f, 0.5f, 0.5f);	// box half extents
+		XMFLOAT4 rotation = XMFLOAT4(0, 0, 0, 1);		// box rotation
+	};
+	struct SweepQuery
+	{
+		QueryShape shape;
+		XMFLOAT3 from = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 to = XMFLOAT3(0, 0, 0);
+	};
+	struct OverlapQuery
+	{
+		QueryShape shape;
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+	};
+
+	// Closest hit of a ray within maxDistance
+	QueryHit RayCast(const RAY& ray, float maxDistance = 1000);
+	void RayCastBatch(const RAY* rays, uint32_t count, QueryHit* results, float maxDistance = 1000);
+	// Closest hit of a sphere or box that is moved from one position to an other, the distance is measured along the sweep
+	QueryHit Sweep(const SweepQuery& query);
+	void SweepBatch(const SweepQuery* queries, uint32_t count, QueryHit* results);
+	// Entities whose collision shapes overlap with a sphere or box, the results are appended to the entities
+	void Overlap(const OverlapQuery& query, std::vector<wiECS::Entity>& entities);
+	void OverlapBatch(const OverlapQuery* queries, uint32_t count, std::vector<wiECS::Entity>* results);
+
 	void RunPhysicsUpdateSystem(
 		wiJobSystem::context& ctx,
 		const wiScene::WeatherComponent& weather,
@@ -21,4 +118,30 @@ namespace wiPhysicsEngine
 		wiECS::ComponentManager<wiScene::SoftBodyPhysicsComponent>& softbodies,
 		float dt
 	);
+
+	struct BenchmarkResult
+	{
+		double stepTime = 0;	// average time of a simulation step in milliseconds
+		uint64_t hash = 0;		// hash of the final box transforms
+	};
+	// Headless benchmark in a separate physics world, the scene is not used
+	//	boxCount boxes are dropped onto a ground plane in columns, then simulated for stepCount fixed 60 Hz steps
+	//	threadCount	: the simulation work is split into this many jobs, 0 uses the single threaded simulation
+	//	The simulation is deterministic, the hash is the same for every threadCount > 0
+	BenchmarkResult RunBenchmark(uint32_t boxCount, uint32_t stepCount, uint32_t threadCount);
+
+	struct FrameBenchmarkResult
+	{
+		double averageFrameTime = 0;	// average time of the physics update in a frame in milliseconds
+		double maxFrameTime = 0;		// longest physics update in milliseconds
+		uint32_t stepCount = 0;			// total number of simulation steps
+		uint32_t maxSteps = 0;			// most simulation steps in a frame
+		float maxDebt = 0;				// largest physics debt in seconds (fixed timestep only)
+		uint64_t hash = 0;				// hash of the final box transforms of the simulation (not interpolated)
+	};
+	// Headless benchmark with the boxes of RunBenchmark(), the simulation is advanced by a sequence of frame times
+	//	fixedTimestep	: use the fixed timestep accumulator with the current fixed timestep and substep budget,
+	//					  otherwise the frame time is simulated with the variable timestep (up to 10 internal substeps)
+	//	With the fixed timestep, the hash is the same for every frame time sequence that adds up to the same total time
+	FrameBenchmarkResult RunFrameBenchmark(uint32_t boxCount, const float* frameTimes, uint32_t frameCount, bool fixedTimestep);
 }
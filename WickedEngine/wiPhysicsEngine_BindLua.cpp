@@ -0,0 +1,237 @@
+#include "wiPhysicsEngine_BindLua.h"
+#include "wiPhysicsEngine.h"
+#include "Vector_BindLua.h"
+#include "wiIntersect_BindLua.h"
+
+#include <vector>
+
+using namespace std;
+using namespace wiECS;
+using namespace wiPhysicsEngine;
+using namespace wiIntersect_BindLua;
+
+namespace wiPhysicsEngine_BindLua
+{
+
+int PushHit(lua_State* L, const QueryHit& hit)
+{
+	wiLua::SSetInt(L, (int)hit.entity);
+	Luna<Vector_BindLua>::push(L, new Vector_BindLua(XMLoadFloat3(&hit.position)));
+	Luna<Vector_BindLua>::push(L, new Vector_BindLua(XMLoadFloat3(&hit.normal)));
+	wiLua::SSetFloat(L, hit.distance);
+	return 4;
+}
+int PushEntities(lua_State* L, const vector<Entity>& entities)
+{
+	lua_createtable(L, (int)entities.size(), 0);
+	int newTable = lua_gettop(L);
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		wiLua::SSetInt(L, (int)entities[i]);
+		lua_rawseti(L, newTable, lua_Integer(i + 1));
+	}
+	return 1;
+}
+
+int PhysicsRayCast(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		Ray_BindLua* ray = Luna<Ray_BindLua>::lightcheck(L, 1);
+		if (ray != nullptr)
+		{
+			float maxDistance = 1000;
+			if (argc > 1)
+			{
+				maxDistance = wiLua::SGetFloat(L, 2);
+			}
+			return PushHit(L, RayCast(ray->ray, maxDistance));
+		}
+		wiLua::SError(L, "PhysicsRayCast(Ray ray, opt float maxDistance) first argument must be of Ray type!");
+	}
+	else
+	{
+		wiLua::SError(L, "PhysicsRayCast(Ray ray, opt float maxDistance) not enough arguments!");
+	}
+	return 0;
+}
+int PhysicsRayCastBatch(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0 && lua_istable(L, 1))
+	{
+		float maxDistance = 1000;
+		if (argc > 1)
+		{
+			maxDistance = wiLua::SGetFloat(L, 2);
+		}
+
+		vector<RAY> rays(lua_rawlen(L, 1));
+		for (size_t i = 0; i < rays.size(); ++i)
+		{
+			lua_rawgeti(L, 1, lua_Integer(i + 1));
+			Ray_BindLua* ray = Luna<Ray_BindLua>::lightcheck(L, -1);
+			lua_pop(L, 1);
+			if (ray == nullptr)
+			{
+				wiLua::SError(L, "PhysicsRayCastBatch(table rays, opt float maxDistance) every element of the table must be of Ray type!");
+				return 0;
+			}
+			rays[i] = ray->ray;
+		}
+
+		vector<QueryHit> hits(rays.size());
+		RayCastBatch(rays.data(), (uint32_t)rays.size(), hits.data(), maxDistance);
+
+		lua_createtable(L, (int)hits.size(), 0);
+		int entities = lua_gettop(L);
+		lua_createtable(L, (int)hits.size(), 0);
+		int distances = lua_gettop(L);
+		for (size_t i = 0; i < hits.size(); ++i)
+		{
+			wiLua::SSetInt(L, (int)hits[i].entity);
+			lua_rawseti(L, entities, lua_Integer(i + 1));
+			wiLua::SSetFloat(L, hits[i].distance);
+			lua_rawseti(L, distances, lua_Integer(i + 1));
+		}
+		return 2;
+	}
+	else
+	{
+		wiLua::SError(L, "PhysicsRayCastBatch(table rays, opt float maxDistance) first argument must be a table of Rays!");
+	}
+	return 0;
+}
+int PhysicsSweepSphere(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 2)
+	{
+		Vector_BindLua* from = Luna<Vector_BindLua>::lightcheck(L, 1);
+		Vector_BindLua* to = Luna<Vector_BindLua>::lightcheck(L, 2);
+		if (from != nullptr && to != nullptr)
+		{
+			SweepQuery query;
+			query.shape.type = QueryShape::SPHERE;
+			query.shape.radius = wiLua::SGetFloat(L, 3);
+			XMStoreFloat3(&query.from, from->vector);
+			XMStoreFloat3(&query.to, to->vector);
+			return PushHit(L, Sweep(query));
+		}
+		wiLua::SError(L, "PhysicsSweepSphere(Vector from,to, float radius) first two arguments must be of Vector type!");
+	}
+	else
+	{
+		wiLua::SError(L, "PhysicsSweepSphere(Vector from,to, float radius) not enough arguments!");
+	}
+	return 0;
+}
+int PhysicsSweepBox(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 2)
+	{
+		Vector_BindLua* from = Luna<Vector_BindLua>::lightcheck(L, 1);
+		Vector_BindLua* to = Luna<Vector_BindLua>::lightcheck(L, 2);
+		Vector_BindLua* halfExtents = Luna<Vector_BindLua>::lightcheck(L, 3);
+		if (from != nullptr && to != nullptr && halfExtents != nullptr)
+		{
+			SweepQuery query;
+			query.shape.type = QueryShape::BOX;
+			XMStoreFloat3(&query.shape.halfExtents, halfExtents->vector);
+			if (argc > 3)
+			{
+				Vector_BindLua* rotation = Luna<Vector_BindLua>::lightcheck(L, 4);
+				if (rotation != nullptr)
+				{
+					XMStoreFloat4(&query.shape.rotation, rotation->vector);
+				}
+			}
+			XMStoreFloat3(&query.from, from->vector);
+			XMStoreFloat3(&query.to, to->vector);
+			return PushHit(L, Sweep(query));
+		}
+		wiLua::SError(L, "PhysicsSweepBox(Vector from,to,halfExtents, opt Vector rotationQuaternion) first three arguments must be of Vector type!");
+	}
+	else
+	{
+		wiLua::SError(L, "PhysicsSweepBox(Vector from,to,halfExtents, opt Vector rotationQuaternion) not enough arguments!");
+	}
+	return 0;
+}
+int PhysicsOverlapSphere(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		Vector_BindLua* center = Luna<Vector_BindLua>::lightcheck(L, 1);
+		if (center != nullptr)
+		{
+			OverlapQuery query;
+			query.shape.type = QueryShape::SPHERE;
+			query.shape.radius = wiLua::SGetFloat(L, 2);
+			XMStoreFloat3(&query.position, center->vector);
+			vector<Entity> entities;
+			Overlap(query, entities);
+			return PushEntities(L, entities);
+		}
+		wiLua::SError(L, "PhysicsOverlapSphere(Vector center, float radius) first argument must be of Vector type!");
+	}
+	else
+	{
+		wiLua::SError(L, "PhysicsOverlapSphere(Vector center, float radius) not enough arguments!");
+	}
+	return 0;
+}
+int PhysicsOverlapBox(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		Vector_BindLua* center = Luna<Vector_BindLua>::lightcheck(L, 1);
+		Vector_BindLua* halfExtents = Luna<Vector_BindLua>::lightcheck(L, 2);
+		if (center != nullptr && halfExtents != nullptr)
+		{
+			OverlapQuery query;
+			query.shape.type = QueryShape::BOX;
+			XMStoreFloat3(&query.shape.halfExtents, halfExtents->vector);
+			if (argc > 2)
+			{
+				Vector_BindLua* rotation = Luna<Vector_BindLua>::lightcheck(L, 3);
+				if (rotation != nullptr)
+				{
+					XMStoreFloat4(&query.shape.rotation, rotation->vector);
+				}
+			}
+			XMStoreFloat3(&query.position, center->vector);
+			vector<Entity> entities;
+			Overlap(query, entities);
+			return PushEntities(L, entities);
+		}
+		wiLua::SError(L, "PhysicsOverlapBox(Vector center,halfExtents, opt Vector rotationQuaternion) first two arguments must be of Vector type!");
+	}
+	else
+	{
+		wiLua::SError(L, "PhysicsOverlapBox(Vector center,halfExtents, opt Vector rotationQuaternion) not enough arguments!");
+	}
+	return 0;
+}
+
+void Bind()
+{
+	static bool initialized = false;
+	if (!initialized)
+	{
+		initialized = true;
+
+		wiLua::GetGlobal()->RegisterFunc("PhysicsRayCast", PhysicsRayCast);
+		wiLua::GetGlobal()->RegisterFunc("PhysicsRayCastBatch", PhysicsRayCastBatch);
+		wiLua::GetGlobal()->RegisterFunc("PhysicsSweepSphere", PhysicsSweepSphere);
+		wiLua::GetGlobal()->RegisterFunc("PhysicsSweepBox", PhysicsSweepBox);
+		wiLua::GetGlobal()->RegisterFunc("PhysicsOverlapSphere", PhysicsOverlapSphere);
+		wiLua::GetGlobal()->RegisterFunc("PhysicsOverlapBox", PhysicsOverlapBox);
+	}
+}
+
+}
@@ -3,15 +3,33 @@
 #include "wiProfiler.h"
 #include "wiBackLog.h"
 #include "wiJobSystem.h"
+#include "wiTimer.h"
+#include "wiHelper.h"
 
 #include "btBulletDynamicsCommon.h"
 #include "BulletSoftBody/btSoftBodyHelpers.h"
 #include "BulletSoftBody/btDefaultSoftBodySolver.h"
 #include "BulletSoftBody/btSoftRigidDynamicsWorld.h"
 #include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
+#include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
+#include "BulletCollision/CollisionShapes/btTriangleShape.h"
+#include "LinearMath/btConvexHull.h"
 
 #include <mutex>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
 
 using namespace std;
 using namespace wiECS;
@@ -20,48 +38,606 @@ using namespace wiScene;
 
 namespace wiPhysicsEngine
 {
+	// The Bullet version in the engine doesn't have a task scheduler, so the multithreaded simulation is implemented here
+	//	on top of the virtual functions of the collision dispatcher and the dynamics world, the work is done by the wiJobSystem.
+	//	The statistics counters of Bullet (gNumGjkChecks, gNumAlignedAllocs...) are not atomic, they are not exact with multithreading.
+
+	// Split [0, count) into at most threadCount ranges of consecutive items, and process every range in a separate job
+	//	The ranges only depend on the parameters, not on which thread executes them
+	//	func : void(uint32_t rangeIndex, uint32_t begin, uint32_t end)
+	template<typename F>
+	void ParallelFor(uint32_t threadCount, uint32_t count, uint32_t minRangeSize, const F& func)
+	{
+		const uint32_t rangeCount = std::min(threadCount, (count + minRangeSize - 1) / minRangeSize);
+		if (rangeCount <= 1)
+		{
+			if (count > 0)
+			{
+				func(0u, 0u, count);
+			}
+			return;
+		}
+		const uint32_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, rangeCount, 1, [&](wiJobDispatchArgs args) {
+			const uint32_t begin = args.jobIndex * rangeSize;
+			const uint32_t end = std::min(begin + rangeSize, count);
+			if (begin < end)
+			{
+				func(args.jobIndex, begin, end);
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	// The convex-convex algorithm of Bullet uses the same simplex solver for every pair,
+	//	this one has its own simplex solver, so different pairs can be processed at the same time
+	class ConvexConvexAlgorithmMT : public btConvexConvexAlgorithm
+	{
+	private:
+		btVoronoiSimplexSolver simplexSolver; // only its address is used by the base class constructor
+	public:
+		ConvexConvexAlgorithmMT(btPersistentManifold* mf, const btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap,
+			btConvexPenetrationDepthSolver* pdSolver, int numPerturbationIterations, int minimumPointsPerturbationThreshold)
+			: btConvexConvexAlgorithm(mf, ci, body0Wrap, body1Wrap, &simplexSolver, pdSolver, numPerturbationIterations, minimumPointsPerturbationThreshold)
+		{
+		}
+
+		struct CreateFunc : public btConvexConvexAlgorithm::CreateFunc
+		{
+			CreateFunc(btConvexPenetrationDepthSolver* pdSolver) : btConvexConvexAlgorithm::CreateFunc(nullptr, pdSolver) {}
+
+			virtual btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap) override
+			{
+				void* mem = ci.m_dispatcher1->allocateCollisionAlgorithm(sizeof(ConvexConvexAlgorithmMT));
+				return new(mem) ConvexConvexAlgorithmMT(ci.m_manifold, ci, body0Wrap, body1Wrap, m_pdSolver, m_numPerturbationIterations, m_minimumPointsPerturbationThreshold);
+			}
+		};
+	};
+
+	class CollisionConfigurationMT : public btSoftBodyRigidBodyCollisionConfiguration
+	{
+	private:
+		ConvexConvexAlgorithmMT::CreateFunc convexConvexCreateFunc;
+
+		static btDefaultCollisionConstructionInfo GetConstructionInfo()
+		{
+			btDefaultCollisionConstructionInfo info;
+			// The collision algorithm pool must be able to hold the larger convex-convex algorithm:
+			info.m_customCollisionAlgorithmMaxElementSize = (int)sizeof(ConvexConvexAlgorithmMT);
+			return info;
+		}
+	public:
+		CollisionConfigurationMT() : btSoftBodyRigidBodyCollisionConfiguration(GetConstructionInfo()), convexConvexCreateFunc(m_pdSolver) {}
+
+		virtual btCollisionAlgorithmCreateFunc* getCollisionAlgorithmCreateFunc(int proxyType0, int proxyType1) override
+		{
+			btCollisionAlgorithmCreateFunc* createFunc = btSoftBodyRigidBodyCollisionConfiguration::getCollisionAlgorithmCreateFunc(proxyType0, proxyType1);
+			if (createFunc == m_convexConvexCreateFunc)
+			{
+				return &convexConvexCreateFunc;
+			}
+			return createFunc;
+		}
+	};
+
+	// Processes the overlapping pairs in parallel (narrow phase)
+	//	The manifold and collision algorithm pools are shared, they are locked
+	class CollisionDispatcherMT : public btCollisionDispatcher
+	{
+	private:
+		std::mutex locker;
+		bool manifoldsChanged = false;
+		btAlignedObjectArray<btBroadphasePair*> parallelPairs;
+		btAlignedObjectArray<btBroadphasePair*> serialPairs;
+
+		// Manifolds are ordered by the broadphase IDs of their bodies:
+		struct ManifoldOrder
+		{
+			static uint64_t GetKey(const btPersistentManifold* manifold)
+			{
+				uint64_t uid0 = (uint64_t)manifold->getBody0()->getBroadphaseHandle()->getUid();
+				uint64_t uid1 = (uint64_t)manifold->getBody1()->getBroadphaseHandle()->getUid();
+				return (std::min(uid0, uid1) << 32ull) | std::max(uid0, uid1);
+			}
+			bool operator()(const btPersistentManifold* a, const btPersistentManifold* b) const
+			{
+				return GetKey(a) < GetKey(b);
+			}
+		};
+	public:
+		uint32_t threadCount = 0;
+
+		CollisionDispatcherMT(btCollisionConfiguration* collisionConfiguration) : btCollisionDispatcher(collisionConfiguration) {}
+
+		virtual btPersistentManifold* getNewManifold(const btCollisionObject* body0, const btCollisionObject* body1) override
+		{
+			std::lock_guard<std::mutex> lock(locker);
+			manifoldsChanged = true;
+			return btCollisionDispatcher::getNewManifold(body0, body1);
+		}
+		virtual void releaseManifold(btPersistentManifold* manifold) override
+		{
+			std::lock_guard<std::mutex> lock(locker);
+			manifoldsChanged = true;
+			btCollisionDispatcher::releaseManifold(manifold);
+		}
+		virtual void* allocateCollisionAlgorithm(int size) override
+		{
+			std::lock_guard<std::mutex> lock(locker);
+			return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+		}
+		virtual void freeCollisionAlgorithm(void* ptr) override
+		{
+			std::lock_guard<std::mutex> lock(locker);
+			btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+		}
+
+		virtual void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo, btDispatcher* dispatcher) override
+		{
+			// Continuous collision detection writes the time of impact into the dispatch info, that is done serially:
+			if (threadCount == 0 || dispatchInfo.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE)
+			{
+				btCollisionDispatcher::dispatchAllCollisionPairs(pairCache, dispatchInfo, dispatcher);
+				return;
+			}
+
+			// Soft body collision algorithms write into the soft bodies, so pairs with soft bodies are processed serially:
+			parallelPairs.resize(0);
+			serialPairs.resize(0);
+			btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+			const int pairCount = pairCache->getNumOverlappingPairs();
+			for (int i = 0; i < pairCount; ++i)
+			{
+				btBroadphasePair& pair = pairs[i];
+				const btCollisionObject* colObj0 = (const btCollisionObject*)pair.m_pProxy0->m_clientObject;
+				const btCollisionObject* colObj1 = (const btCollisionObject*)pair.m_pProxy1->m_clientObject;
+				if (colObj0->getInternalType() == btCollisionObject::CO_SOFT_BODY || colObj1->getInternalType() == btCollisionObject::CO_SOFT_BODY)
+				{
+					serialPairs.push_back(&pair);
+				}
+				else
+				{
+					parallelPairs.push_back(&pair);
+				}
+			}
+
+			manifoldsChanged = false;
+			btNearCallback nearCallback = getNearCallback();
+			ParallelFor(threadCount, (uint32_t)parallelPairs.size(), 64, [&](uint32_t rangeIndex, uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					nearCallback(*parallelPairs[i], *this, dispatchInfo);
+				}
+			});
+			for (int i = 0; i < serialPairs.size(); ++i)
+			{
+				nearCallback(*serialPairs[i], *this, dispatchInfo);
+			}
+
+			// The order of the manifolds depends on which thread created them first, and the
+			//	constraint solver processes them in this order. Sorting keeps the simulation deterministic:
+			if (manifoldsChanged)
+			{
+				m_manifoldsPtr.quickSort(ManifoldOrder());
+				for (int i = 0; i < m_manifoldsPtr.size(); ++i)
+				{
+					m_manifoldsPtr[i]->m_index1a = i;
+				}
+			}
+		}
+	};
+
+	// Collects the simulation islands into batches that can be solved in parallel
+	//	Small islands are merged into one batch until it has enough contacts and constraints, like btDiscreteDynamicsWorld does it.
+	//	The solver writes into kinematic bodies too, and they can touch multiple islands, so the islands with kinematic bodies are put in the same batch.
+	struct IslandBatcher : public btSimulationIslandManager::IslandCallback
+	{
+		struct Batch
+		{
+			int bodyOffset = 0;
+			int bodyCount = 0;
+			int manifoldOffset = 0;
+			int manifoldCount = 0;
+			int constraintOffset = 0;
+			int constraintCount = 0;
+		};
+		std::vector<Batch> batches;
+		btAlignedObjectArray<btCollisionObject*> bodies;
+		btAlignedObjectArray<btPersistentManifold*> manifolds;
+		btAlignedObjectArray<btTypedConstraint*> constraints;
+		btAlignedObjectArray<btCollisionObject*> kinematicBodies;
+		btAlignedObjectArray<btPersistentManifold*> kinematicManifolds;
+		btAlignedObjectArray<btTypedConstraint*> kinematicConstraints;
+		Batch open;
+
+		btTypedConstraint** sortedConstraints = nullptr;
+		int numConstraints = 0;
+		int minimumBatchSize = 0;
+
+		static int GetConstraintIslandId(const btTypedConstraint* constraint)
+		{
+			const btCollisionObject& colObj0 = constraint->getRigidBodyA();
+			const btCollisionObject& colObj1 = constraint->getRigidBodyB();
+			return colObj0.getIslandTag() >= 0 ? colObj0.getIslandTag() : colObj1.getIslandTag();
+		}
+		struct ConstraintOrder
+		{
+			bool operator()(const btTypedConstraint* a, const btTypedConstraint* b) const
+			{
+				return GetConstraintIslandId(a) < GetConstraintIslandId(b);
+			}
+		};
+
+		void Begin(btTypedConstraint** sortedConstraints, int numConstraints, int minimumBatchSize)
+		{
+			this->sortedConstraints = sortedConstraints;
+			this->numConstraints = numConstraints;
+			this->minimumBatchSize = minimumBatchSize;
+			batches.clear();
+			bodies.resize(0);
+			manifolds.resize(0);
+			constraints.resize(0);
+			kinematicBodies.resize(0);
+			kinematicManifolds.resize(0);
+			kinematicConstraints.resize(0);
+			open = Batch();
+		}
+
+		void Flush()
+		{
+			open.bodyCount = bodies.size() - open.bodyOffset;
+			open.manifoldCount = manifolds.size() - open.manifoldOffset;
+			open.constraintCount = constraints.size() - open.constraintOffset;
+			if (open.bodyCount > 0 || open.manifoldCount > 0 || open.constraintCount > 0)
+			{
+				batches.push_back(open);
+			}
+			open.bodyOffset = bodies.size();
+			open.manifoldOffset = manifolds.size();
+			open.constraintOffset = constraints.size();
+		}
+
+		void End()
+		{
+			Flush();
+			for (int i = 0; i < kinematicBodies.size(); ++i)
+			{
+				bodies.push_back(kinematicBodies[i]);
+			}
+			for (int i = 0; i < kinematicManifolds.size(); ++i)
+			{
+				manifolds.push_back(kinematicManifolds[i]);
+			}
+			for (int i = 0; i < kinematicConstraints.size(); ++i)
+			{
+				constraints.push_back(kinematicConstraints[i]);
+			}
+			Flush();
+		}
+
+		virtual void processIsland(btCollisionObject** islandBodies, int numBodies, btPersistentManifold** islandManifolds, int numManifolds, int islandId) override
+		{
+			btTypedConstraint** islandConstraints = sortedConstraints;
+			int numIslandConstraints = numConstraints;
+			if (islandId >= 0)
+			{
+				// The constraints are sorted by island:
+				islandConstraints = nullptr;
+				numIslandConstraints = 0;
+				for (int i = 0; i < numConstraints; ++i)
+				{
+					if (GetConstraintIslandId(sortedConstraints[i]) == islandId)
+					{
+						if (islandConstraints == nullptr)
+						{
+							islandConstraints = &sortedConstraints[i];
+						}
+						numIslandConstraints++;
+					}
+				}
+			}
+
+			bool kinematic = false;
+			for (int i = 0; i < numManifolds && !kinematic; ++i)
+			{
+				kinematic = islandManifolds[i]->getBody0()->isKinematicObject() || islandManifolds[i]->getBody1()->isKinematicObject();
+			}
+			for (int i = 0; i < numIslandConstraints && !kinematic; ++i)
+			{
+				kinematic = islandConstraints[i]->getRigidBodyA().isKinematicObject() || islandConstraints[i]->getRigidBodyB().isKinematicObject();
+			}
+
+			btAlignedObjectArray<btCollisionObject*>& dstBodies = kinematic ? kinematicBodies : bodies;
+			btAlignedObjectArray<btPersistentManifold*>& dstManifolds = kinematic ? kinematicManifolds : manifolds;
+			btAlignedObjectArray<btTypedConstraint*>& dstConstraints = kinematic ? kinematicConstraints : constraints;
+			for (int i = 0; i < numBodies; ++i)
+			{
+				dstBodies.push_back(islandBodies[i]);
+			}
+			for (int i = 0; i < numManifolds; ++i)
+			{
+				dstManifolds.push_back(islandManifolds[i]);
+			}
+			for (int i = 0; i < numIslandConstraints; ++i)
+			{
+				dstConstraints.push_back(islandConstraints[i]);
+			}
+
+			if (!kinematic && (manifolds.size() - open.manifoldOffset) + (constraints.size() - open.constraintOffset) > minimumBatchSize)
+			{
+				Flush();
+			}
+		}
+	};
+
+	// Dynamics world that splits its work into wiJobSystem jobs when the thread count is not zero
+	//	The soft bodies are simulated the same way as in btSoftRigidDynamicsWorld.
+	class DynamicsWorldMT : public btSoftRigidDynamicsWorld
+	{
+	private:
+		uint32_t threadCount = 0;
+		CollisionDispatcherMT* dispatcherMT = nullptr;
+		IslandBatcher islandBatcher;
+		std::vector<std::unique_ptr<btSequentialImpulseConstraintSolver>> solverPool; // one solver for every job
+		btAlignedObjectArray<btVector3> aabbs;
+
+	protected:
+		virtual void predictUnconstraintMotion(btScalar timeStep) override
+		{
+			if (threadCount == 0)
+			{
+				btSoftRigidDynamicsWorld::predictUnconstraintMotion(timeStep);
+				return;
+			}
+
+			ParallelFor(threadCount, (uint32_t)m_nonStaticRigidBodies.size(), 256, [&](uint32_t rangeIndex, uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					btRigidBody* body = m_nonStaticRigidBodies[i];
+					if (!body->isStaticOrKinematicObject())
+					{
+						body->applyDamping(timeStep);
+						body->predictIntegratedTransform(timeStep, body->getInterpolationWorldTransform());
+					}
+				}
+			});
+
+			// Same as btDefaultSoftBodySolver::predictMotion():
+			btSoftBodyArray& softBodies = getSoftBodyArray();
+			for (int i = 0; i < softBodies.size(); ++i)
+			{
+				if (softBodies[i]->isActive())
+				{
+					softBodies[i]->predictMotion(timeStep);
+				}
+			}
+		}
+
+		virtual void solveConstraints(btContactSolverInfo& solverInfo) override
+		{
+			if (threadCount == 0)
+			{
+				btSoftRigidDynamicsWorld::solveConstraints(solverInfo);
+				return;
+			}
+
+			m_sortedConstraints.resize(m_constraints.size());
+			for (int i = 0; i < m_constraints.size(); ++i)
+			{
+				m_sortedConstraints[i] = m_constraints[i];
+			}
+			m_sortedConstraints.quickSort(IslandBatcher::ConstraintOrder());
+
+			islandBatcher.Begin(m_sortedConstraints.size() > 0 ? &m_sortedConstraints[0] : nullptr, m_sortedConstraints.size(), solverInfo.m_minimumSolverBatchSize);
+			m_islandManager->buildAndProcessIslands(getDispatcher(), this, &islandBatcher);
+			islandBatcher.End();
+
+			while (solverPool.size() < threadCount)
+			{
+				solverPool.push_back(std::make_unique<btSequentialImpulseConstraintSolver>());
+			}
+
+			ParallelFor(threadCount, (uint32_t)islandBatcher.batches.size(), 1, [&](uint32_t rangeIndex, uint32_t begin, uint32_t end) {
+				btSequentialImpulseConstraintSolver* solver = solverPool[rangeIndex].get();
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					const IslandBatcher::Batch& batch = islandBatcher.batches[i];
+					// The solver randomizes the order of the constraint rows, every batch starts from the same seed to be deterministic:
+					solver->setRandSeed(0);
+					solver->solveGroup(
+						batch.bodyCount > 0 ? &islandBatcher.bodies[batch.bodyOffset] : nullptr, batch.bodyCount,
+						batch.manifoldCount > 0 ? &islandBatcher.manifolds[batch.manifoldOffset] : nullptr, batch.manifoldCount,
+						batch.constraintCount > 0 ? &islandBatcher.constraints[batch.constraintOffset] : nullptr, batch.constraintCount,
+						solverInfo, m_debugDrawer, getDispatcher()
+					);
+				}
+			});
+		}
+
+		virtual void integrateTransforms(btScalar timeStep) override
+		{
+			bool serial = threadCount == 0 || m_applySpeculativeContactRestitution;
+			if (!serial && getDispatchInfo().m_useContinuous)
+			{
+				// The motion clamping of continuous collision detection performs sweep tests against the whole world:
+				for (int i = 0; i < m_nonStaticRigidBodies.size() && !serial; ++i)
+				{
+					serial = m_nonStaticRigidBodies[i]->getCcdSquareMotionThreshold() > 0;
+				}
+			}
+			if (serial)
+			{
+				btSoftRigidDynamicsWorld::integrateTransforms(timeStep);
+				return;
+			}
+
+			ParallelFor(threadCount, (uint32_t)m_nonStaticRigidBodies.size(), 256, [&](uint32_t rangeIndex, uint32_t begin, uint32_t end) {
+				btTransform predictedTrans;
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					btRigidBody* body = m_nonStaticRigidBodies[i];
+					body->setHitFraction(1);
+					if (body->isActive() && !body->isStaticOrKinematicObject())
+					{
+						body->predictIntegratedTransform(timeStep, predictedTrans);
+						body->proceedToTransform(predictedTrans);
+					}
+				}
+			});
+		}
+
+	public:
+		DynamicsWorldMT(CollisionDispatcherMT* dispatcher, btBroadphaseInterface* pairCache, btConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration)
+			: btSoftRigidDynamicsWorld(dispatcher, pairCache, constraintSolver, collisionConfiguration), dispatcherMT(dispatcher)
+		{
+		}
+
+		// The simulation work is split into at most this many jobs, 0 means single threaded simulation
+		void SetThreadCount(uint32_t value)
+		{
+			threadCount = value;
+			dispatcherMT->threadCount = value;
+		}
+
+		// Simulate stepCount steps of timeStep like stepSimulation(), but without its time accumulator and motion state interpolation,
+		//	the motion states receive the transforms after the last step. beforeStep() is called before every step.
+		template<typename F>
+		void StepFixed(btScalar timeStep, uint32_t stepCount, const F& beforeStep)
+		{
+			m_localTime = 0;
+			m_fixedTimeStep = 0;
+			if (stepCount == 0)
+			{
+				return;
+			}
+
+			saveKinematicState(timeStep * stepCount);
+			applyGravity();
+			for (uint32_t i = 0; i < stepCount; ++i)
+			{
+				beforeStep();
+				internalSingleStepSimulation(timeStep);
+			}
+			synchronizeMotionStates();
+			clearForces();
+		}
+
+		// The bounding boxes are computed in parallel, but the broadphase is updated serially
+		virtual void updateAabbs() override
+		{
+			if (threadCount == 0)
+			{
+				btSoftRigidDynamicsWorld::updateAabbs();
+				return;
+			}
+
+			const bool continuous = getDispatchInfo().m_useContinuous;
+			const btVector3 contactThreshold(gContactBreakingThreshold, gContactBreakingThreshold, gContactBreakingThreshold);
+			aabbs.resize(m_collisionObjects.size() * 2);
+			ParallelFor(threadCount, (uint32_t)m_collisionObjects.size(), 256, [&](uint32_t rangeIndex, uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					btCollisionObject* colObj = m_collisionObjects[i];
+					if (m_forceUpdateAllAabbs || colObj->isActive())
+					{
+						btVector3& minAabb = aabbs[i * 2 + 0];
+						btVector3& maxAabb = aabbs[i * 2 + 1];
+						colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(), minAabb, maxAabb);
+						minAabb -= contactThreshold;
+						maxAabb += contactThreshold;
+
+						if (continuous && colObj->getInternalType() == btCollisionObject::CO_RIGID_BODY && !colObj->isStaticOrKinematicObject())
+						{
+							btVector3 minAabb2, maxAabb2;
+							colObj->getCollisionShape()->getAabb(colObj->getInterpolationWorldTransform(), minAabb2, maxAabb2);
+							minAabb2 -= contactThreshold;
+							maxAabb2 += contactThreshold;
+							minAabb.setMin(minAabb2);
+							maxAabb.setMax(maxAabb2);
+						}
+					}
+				}
+			});
+
+			for (int i = 0; i < m_collisionObjects.size(); ++i)
+			{
+				btCollisionObject* colObj = m_collisionObjects[i];
+				if (m_forceUpdateAllAabbs || colObj->isActive())
+				{
+					const btVector3& minAabb = aabbs[i * 2 + 0];
+					const btVector3& maxAabb = aabbs[i * 2 + 1];
+					// Same as btCollisionWorld::updateSingleAabb(), objects with too large bounds are removed from the simulation:
+					if (colObj->isStaticObject() || (maxAabb - minAabb).length2() < btScalar(1e12))
+					{
+						m_broadphasePairCache->setAabb(colObj->getBroadphaseHandle(), minAabb, maxAabb, m_dispatcher1);
+					}
+					else
+					{
+						colObj->setActivationState(DISABLE_SIMULATION);
+					}
+				}
+			}
+		}
+	};
+
+	struct World
+	{
+		std::unique_ptr<CollisionConfigurationMT> collisionConfiguration;
+		std::unique_ptr<CollisionDispatcherMT> dispatcher;
+		std::unique_ptr<btBroadphaseInterface> overlappingPairCache;
+		std::unique_ptr<btSequentialImpulseConstraintSolver> solver;
+		std::unique_ptr<DynamicsWorldMT> dynamicsWorld;
+		double accumulator = 0; // frame time that is not simulated yet in fixed timestep mode
+		FixedStepStats stats;
+	};
+
 	bool ENABLED = true;
+	bool MULTITHREADED = false;
+	bool FIXED_TIMESTEP = false;
+	float fixedTimestep = 1.0f / 60.0f;
+	uint32_t maxSubsteps = 4;
 	std::mutex physicsLock;
 
 	btVector3 gravity(0, -10, 0);
 	int softbodyIterationCount = 5;
-	std::unique_ptr<btCollisionConfiguration> collisionConfiguration;
-	std::unique_ptr<btCollisionDispatcher> dispatcher;
-	std::unique_ptr<btBroadphaseInterface> overlappingPairCache;
-	std::unique_ptr<btSequentialImpulseConstraintSolver> solver;
-	std::unique_ptr<btDynamicsWorld> dynamicsWorld;
-
+	World world;
 
-	void Initialize()
+	void CreateWorld(World& world)
 	{
-		// collision configuration contains default setup for memory, collision setup. Advanced users can create their own configuration.
-		collisionConfiguration = std::make_unique<btSoftBodyRigidBodyCollisionConfiguration>();
+		// collision configuration contains default setup for memory, collision setup. It replaces the convex-convex algorithm with one that can run on multiple threads.
+		world.collisionConfiguration = std::make_unique<CollisionConfigurationMT>();
 
-		// use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
-		dispatcher = std::make_unique<btCollisionDispatcher>(collisionConfiguration.get());
+		// the collision dispatcher processes the overlapping pairs on multiple threads when multithreading is enabled
+		world.dispatcher = std::make_unique<CollisionDispatcherMT>(world.collisionConfiguration.get());
 
 		// btDbvtBroadphase is a good general purpose broadphase. You can also try out btAxis3Sweep.
-		overlappingPairCache = std::make_unique<btDbvtBroadphase>();
+		world.overlappingPairCache = std::make_unique<btDbvtBroadphase>();
 
-		// the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
-		solver = std::make_unique<btSequentialImpulseConstraintSolver>();
+		// the default constraint solver. With multithreading, the world solves the simulation islands with its own pool of solvers
+		world.solver = std::make_unique<btSequentialImpulseConstraintSolver>();
 
-		dynamicsWorld = std::make_unique<btSoftRigidDynamicsWorld>(dispatcher.get(), overlappingPairCache.get(), solver.get(), collisionConfiguration.get());
+		world.dynamicsWorld = std::make_unique<DynamicsWorldMT>(world.dispatcher.get(), world.overlappingPairCache.get(), world.solver.get(), world.collisionConfiguration.get());
 
-		dynamicsWorld->getSolverInfo().m_solverMode |= SOLVER_RANDMIZE_ORDER;
-		dynamicsWorld->getDispatchInfo().m_enableSatConvex = true;
-		dynamicsWorld->getSolverInfo().m_splitImpulse = true;
+		world.dynamicsWorld->getSolverInfo().m_solverMode |= SOLVER_RANDMIZE_ORDER;
+		world.dynamicsWorld->getDispatchInfo().m_enableSatConvex = true;
+		world.dynamicsWorld->getSolverInfo().m_splitImpulse = true;
 
-		dynamicsWorld->setGravity(gravity);
+		world.dynamicsWorld->setGravity(gravity);
 
-		btSoftRigidDynamicsWorld* softRigidWorld = (btSoftRigidDynamicsWorld*)dynamicsWorld.get();
-		btSoftBodyWorldInfo& softWorldInfo = softRigidWorld->getWorldInfo();
+		btSoftBodyWorldInfo& softWorldInfo = world.dynamicsWorld->getWorldInfo();
 		softWorldInfo.air_density = btScalar(1.2f);
 		softWorldInfo.water_density = 0;
 		softWorldInfo.water_offset = 0;
 		softWorldInfo.water_normal = btVector3(0, 0, 0);
 		softWorldInfo.m_gravity.setValue(gravity.x(), gravity.y(), gravity.z());
 		softWorldInfo.m_sparsesdf.Initialize();
+	}
+
+	void Initialize()
+	{
+		CreateWorld(world);
 
 		wiBackLog::post("wiPhysicsEngine_Bullet Initialized");
 	}
@@ -69,75 +645,463 @@ namespace wiPhysicsEngine
 	bool IsEnabled() { return ENABLED; }
 	void SetEnabled(bool value) { ENABLED = value; }
 
-	void AddRigidBody(Entity entity, wiScene::RigidBodyPhysicsComponent& physicscomponent, const wiScene::MeshComponent& mesh, const wiScene::TransformComponent& transform)
+	bool IsMultithreaded() { return MULTITHREADED; }
+	void SetMultithreaded(bool value) { MULTITHREADED = value; }
+
+	bool IsFixedTimestepEnabled() { return FIXED_TIMESTEP; }
+	void SetFixedTimestepEnabled(bool value) { FIXED_TIMESTEP = value; }
+	float GetFixedTimestep() { return fixedTimestep; }
+	void SetFixedTimestep(float seconds) { fixedTimestep = std::max(0.0001f, seconds); }
+	uint32_t GetMaxSubsteps() { return maxSubsteps; }
+	void SetMaxSubsteps(uint32_t value) { maxSubsteps = std::max(1u, value); }
+	FixedStepStats GetFixedStepStats() { return world.stats; }
+
+	// Collision shape cache:
+	//	Shapes are shared by every rigid body with the same mesh, shape type and scale. The cache only holds weak references,
+	//	a shape is destroyed when the last rigid body that uses it is removed.
+	//	Bullet shapes can't be scaled per body, so there is an entry for every scale, but the scaled entries only hold a small
+	//	shape that refers to the data of the unscaled entry (hull points are copied, BVHs are shared with btScaledBvhTriangleMeshShape)
+	bool SHAPE_CACHE = true;
+	bool COOKED_SHAPES = false;
+	uint32_t convexHullVertexLimit = 64;
+	std::string cookedShapeDirectory = "shapecache/";
+
+	// Increment this when the cooked shape format or the cooking changes, so that old cooked shapes are not used anymore:
+	static const uint32_t COOKED_SHAPE_VERSION = 1;
+
+	std::atomic<uint32_t> shapeCount{ 0 };
+	std::atomic<size_t> shapeMemory{ 0 };
+
+	struct ShapeKey
+	{
+		Entity meshID = INVALID_ENTITY; // INVALID_ENTITY for primitive shapes
+		uint64_t meshHash = 0; // content hash of the mesh data that the shape is built from, so a modified mesh gets a new shape
+		int type = 0;
+		float scale[3] = {};
+
+		bool operator==(const ShapeKey& other) const
+		{
+			return meshID == other.meshID && meshHash == other.meshHash && type == other.type && scale[0] == other.scale[0] && scale[1] == other.scale[1] && scale[2] == other.scale[2];
+		}
+	};
+	struct ShapeKeyHasher
+	{
+		size_t operator()(const ShapeKey& key) const
+		{
+			size_t hash = std::hash<Entity>()(key.meshID) ^ ((size_t)key.type << 1);
+			hash = hash * 31 + std::hash<uint64_t>()(key.meshHash);
+			for (int i = 0; i < 3; ++i)
+			{
+				hash = hash * 31 + std::hash<float>()(key.scale[i]);
+			}
+			return hash;
+		}
+	};
+
+	struct CollisionShape;
+	std::mutex shapeCacheLock;
+	std::unordered_map<ShapeKey, std::weak_ptr<CollisionShape>, ShapeKeyHasher> shapeCache;
+
+	// The members are destroyed in reverse order, the Bullet shape goes first, then the data that it refers to
+	struct CollisionShape
+	{
+		std::mutex locker;
+		ShapeKey key;
+		bool cached = false;
+		size_t memory = 0;
+		std::shared_ptr<CollisionShape> base; // unscaled entry, scaled entries refer to its data
+		btAlignedObjectArray<btVector3> vertices;
+		btAlignedObjectArray<int> indices;
+		std::unique_ptr<btTriangleIndexVertexArray> meshInterface;
+		btAlignedObjectArray<unsigned char> bvhData; // cooked BVH, deserialized in place
+		std::unique_ptr<btCollisionShape> shape;
+
+		~CollisionShape()
+		{
+			shapeCount.fetch_sub(1);
+			shapeMemory.fetch_sub(memory);
+			if (cached)
+			{
+				std::lock_guard<std::mutex> lock(shapeCacheLock);
+				auto it = shapeCache.find(key);
+				if (it != shapeCache.end() && it->second.expired())
+				{
+					shapeCache.erase(it);
+				}
+			}
+		}
+	};
+
+	// Hash of the mesh data that a shape type is built from, LODs are not used for collision
+	uint64_t ComputeMeshHash(const MeshComponent& mesh, int type)
+	{
+		uint64_t hash = wiHelper::HashBytes(mesh.vertex_positions.data(), mesh.vertex_positions.size() * sizeof(XMFLOAT3));
+		if (type == RigidBodyPhysicsComponent::CollisionShape::TRIANGLE_MESH)
+		{
+			hash = wiHelper::HashBytes(mesh.indices.data(), mesh.GetBaseIndexCount() * sizeof(uint32_t), hash);
+		}
+		return hash;
+	}
+
+	// Cooked shape file: "WISH", version, shape type, element count, then the hull points (float3) or the serialized BVH
+	std::string GetCookedShapeFileName(uint64_t meshHash, int type)
+	{
+		const uint32_t settings[] = { COOKED_SHAPE_VERSION, (uint32_t)type, type == RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL ? convexHullVertexLimit : 0u };
+		const uint64_t hash = wiHelper::HashBytes(settings, sizeof(settings), meshHash);
+
+		std::stringstream ss;
+		ss << cookedShapeDirectory << std::hex << std::setw(16) << std::setfill('0') << hash << ".shape";
+		return ss.str();
+	}
+	bool LoadCookedShape(const std::string& fileName, int type, std::vector<uint8_t>& payload)
+	{
+		std::vector<uint8_t> fileData;
+		if (!wiHelper::FileExists(fileName) || !wiHelper::readByteData(fileName, fileData) || fileData.size() < 16)
+		{
+			return false;
+		}
+		uint32_t header[4];
+		memcpy(header, fileData.data(), sizeof(header));
+		if (header[0] != 0x48534957 || header[1] != COOKED_SHAPE_VERSION || header[2] != (uint32_t)type) // "WISH"
+		{
+			return false;
+		}
+		payload.assign(fileData.begin() + sizeof(header), fileData.end());
+		return type != RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL || payload.size() == header[3] * sizeof(XMFLOAT3);
+	}
+	void SaveCookedShape(const std::string& fileName, int type, uint32_t count, const void* payload, size_t size)
+	{
+		const uint32_t header[] = { 0x48534957, COOKED_SHAPE_VERSION, (uint32_t)type, count };
+		std::vector<uint8_t> fileData(sizeof(header) + size);
+		memcpy(fileData.data(), header, sizeof(header));
+		memcpy(fileData.data() + sizeof(header), payload, size);
+		wiHelper::WriteFileAtomic(fileName, fileData.data(), fileData.size(), false);
+	}
+
+	// Simplified convex hull of the mesh vertices with at most convexHullVertexLimit vertices
+	void ComputeConvexHull(const MeshComponent& mesh, btAlignedObjectArray<btVector3>& points)
 	{
-		btVector3 S(transform.scale_local.x, transform.scale_local.y, transform.scale_local.z);
+		points.resize(0);
+		btAlignedObjectArray<btVector3> vertices;
+		vertices.resize((int)mesh.vertex_positions.size());
+		for (int i = 0; i < vertices.size(); ++i)
+		{
+			const XMFLOAT3& pos = mesh.vertex_positions[i];
+			vertices[i] = btVector3(pos.x, pos.y, pos.z);
+		}
+		if (vertices.size() > 0)
+		{
+			HullDesc desc(QF_TRIANGLES, (unsigned int)vertices.size(), &vertices[0]);
+			desc.mMaxVertices = std::max(4u, convexHullVertexLimit);
+			HullLibrary hullLibrary;
+			HullResult result;
+			if (hullLibrary.CreateConvexHull(desc, result) == QE_OK)
+			{
+				points = result.m_OutputVertices;
+				points.resize(result.mNumOutputVertices);
+				hullLibrary.ReleaseResult(result);
+			}
+		}
+		if (points.size() == 0)
+		{
+			points = vertices; // degenerate mesh (flat, too few vertices), use every vertex like without simplification
+		}
+	}
+
+	std::shared_ptr<CollisionShape> AcquireCollisionShape(Entity meshID, int type, const btVector3& scale, const MeshComponent* mesh);
 
-		btCollisionShape* shape = nullptr;
+	void BuildCollisionShape(CollisionShape& entry, int type, const btVector3& S, const MeshComponent* mesh)
+	{
+		const bool unscaled = (S - btVector3(1, 1, 1)).length2() <= SIMD_EPSILON;
+		const bool cook = COOKED_SHAPES && unscaled;
 
-		switch (physicscomponent.shape)
+		switch (type)
 		{
 		case RigidBodyPhysicsComponent::CollisionShape::BOX:
-			shape = new btBoxShape(S);
+			entry.shape = std::make_unique<btBoxShape>(S);
+			entry.memory = sizeof(btBoxShape);
 			break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::SPHERE:
-			shape = new btSphereShape(btScalar(S.x()));
+			entry.shape = std::make_unique<btSphereShape>(btScalar(S.x()));
+			entry.memory = sizeof(btSphereShape);
 			break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::CAPSULE:
-			shape = new btCapsuleShape(btScalar(S.x()), btScalar(S.y()));
+			entry.shape = std::make_unique<btCapsuleShape>(btScalar(S.x()), btScalar(S.y()));
+			entry.memory = sizeof(btCapsuleShape);
 			break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL:
 			{
-				shape = new btConvexHullShape();
-				for (auto& pos : mesh.vertex_positions)
+				if (entry.cached && !unscaled)
 				{
-					((btConvexHullShape*)shape)->addPoint(btVector3(pos.x, pos.y, pos.z));
+					entry.base = AcquireCollisionShape(entry.key.meshID, type, btVector3(1, 1, 1), mesh);
+					const btConvexHullShape* hull = (const btConvexHullShape*)entry.base->shape.get();
+					entry.shape = std::make_unique<btConvexHullShape>(&hull->getUnscaledPoints()->x(), hull->getNumPoints());
 				}
-				shape->setLocalScaling(S);
+				else
+				{
+					btAlignedObjectArray<btVector3> points;
+					std::string fileName;
+					std::vector<uint8_t> payload;
+					if (cook)
+					{
+						fileName = GetCookedShapeFileName(entry.key.meshHash, type);
+					}
+					if (cook && LoadCookedShape(fileName, type, payload))
+					{
+						const XMFLOAT3* src = (const XMFLOAT3*)payload.data();
+						points.resize(int(payload.size() / sizeof(XMFLOAT3)));
+						for (int i = 0; i < points.size(); ++i)
+						{
+							points[i] = btVector3(src[i].x, src[i].y, src[i].z);
+						}
+					}
+					else
+					{
+						ComputeConvexHull(*mesh, points);
+						if (cook)
+						{
+							std::vector<XMFLOAT3> dst(points.size());
+							for (int i = 0; i < points.size(); ++i)
+							{
+								dst[i] = XMFLOAT3(points[i].x(), points[i].y(), points[i].z());
+							}
+							SaveCookedShape(fileName, type, (uint32_t)dst.size(), dst.data(), dst.size() * sizeof(XMFLOAT3));
+						}
+					}
+					entry.shape = std::make_unique<btConvexHullShape>(points.size() > 0 ? &points[0].x() : nullptr, points.size());
+				}
+				entry.shape->setLocalScaling(S);
+				entry.memory = sizeof(btConvexHullShape) + ((btConvexHullShape*)entry.shape.get())->getNumPoints() * sizeof(btVector3);
 			}
 			break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::TRIANGLE_MESH:
 			{
-				int totalVerts = (int)mesh.vertex_positions.size();
-				int totalTriangles = (int)mesh.indices.size() / 3;
-
-				btVector3* btVerts = new btVector3[totalVerts];
-				size_t i = 0;
-				for (auto& pos : mesh.vertex_positions)
+				if (entry.cached && !unscaled)
 				{
-					btVerts[i++] = btVector3(pos.x, pos.y, pos.z);
+					entry.base = AcquireCollisionShape(entry.key.meshID, type, btVector3(1, 1, 1), mesh);
+					entry.shape = std::make_unique<btScaledBvhTriangleMeshShape>((btBvhTriangleMeshShape*)entry.base->shape.get(), S);
+					entry.memory = sizeof(btScaledBvhTriangleMeshShape);
+					break;
 				}
 
-				int* btInd = new int[mesh.indices.size()];
-				i = 0;
-				for (auto& ind : mesh.indices)
+				const uint32_t indexCount = mesh->GetBaseIndexCount(); // LODs are not used for collision
+				entry.vertices.resize((int)mesh->vertex_positions.size());
+				for (int i = 0; i < entry.vertices.size(); ++i)
 				{
-					btInd[i++] = ind;
+					const XMFLOAT3& pos = mesh->vertex_positions[i];
+					entry.vertices[i] = btVector3(pos.x, pos.y, pos.z);
+				}
+				entry.indices.resize((int)indexCount);
+				for (int i = 0; i < entry.indices.size(); ++i)
+				{
+					entry.indices[i] = (int)mesh->indices[i];
 				}
 
-				int vertStride = sizeof(btVector3);
-				int indexStride = 3 * sizeof(int);
-
-				btTriangleIndexVertexArray* indexVertexArrays = new btTriangleIndexVertexArray(
-					totalTriangles,
-					btInd,
-					indexStride,
-					totalVerts,
-					(btScalar*)&btVerts[0].x(),
-					vertStride
+				entry.meshInterface = std::make_unique<btTriangleIndexVertexArray>(
+					(int)indexCount / 3,
+					entry.indices.size() > 0 ? &entry.indices[0] : nullptr,
+					3 * sizeof(int),
+					entry.vertices.size(),
+					entry.vertices.size() > 0 ? (btScalar*)&entry.vertices[0].x() : nullptr,
+					sizeof(btVector3)
 				);
 
 				bool useQuantizedAabbCompression = true;
-				shape = new btBvhTriangleMeshShape(indexVertexArrays, useQuantizedAabbCompression);
+				btOptimizedBvh* bvh = nullptr;
+				std::string fileName;
+				if (cook)
+				{
+					fileName = GetCookedShapeFileName(entry.key.meshHash, type);
+					std::vector<uint8_t> payload;
+					if (LoadCookedShape(fileName, type, payload))
+					{
+						// the BVH is used directly from the loaded data, it must be 16 byte aligned:
+						entry.bvhData.resize((int)payload.size());
+						memcpy(&entry.bvhData[0], payload.data(), payload.size());
+						bvh = btOptimizedBvh::deSerializeInPlace(&entry.bvhData[0], (unsigned)payload.size(), false);
+						if (bvh == nullptr)
+						{
+							entry.bvhData.clear();
+						}
+					}
+				}
+
+				btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(entry.meshInterface.get(), useQuantizedAabbCompression, bvh == nullptr);
+				entry.shape.reset(shape);
+				if (bvh != nullptr)
+				{
+					shape->setOptimizedBvh(bvh);
+				}
+				else if (cook)
+				{
+					btAlignedObjectArray<unsigned char> data;
+					data.resize((int)shape->getOptimizedBvh()->calculateSerializeBufferSize());
+					if (shape->getOptimizedBvh()->serializeInPlace(&data[0], (unsigned)data.size(), false))
+					{
+						SaveCookedShape(fileName, type, (uint32_t)data.size(), &data[0], data.size());
+					}
+				}
 				shape->setLocalScaling(S);
+
+				entry.memory = sizeof(btBvhTriangleMeshShape) + sizeof(btTriangleIndexVertexArray) +
+					entry.vertices.size() * sizeof(btVector3) + entry.indices.size() * sizeof(int) +
+					shape->getOptimizedBvh()->calculateSerializeBufferSize();
 			}
 			break;
 		}
 
+		shapeMemory.fetch_add(entry.memory);
+	}
+
+	// Returns the shared collision shape for a mesh, shape type and scale, it is created if it doesn't exist
+	//	The shape is built outside of the cache lock, so different shapes can be built on multiple threads
+	std::shared_ptr<CollisionShape> AcquireCollisionShape(Entity meshID, int type, const btVector3& scale, const MeshComponent* mesh)
+	{
+		const bool primitive =
+			type == RigidBodyPhysicsComponent::CollisionShape::BOX ||
+			type == RigidBodyPhysicsComponent::CollisionShape::SPHERE ||
+			type == RigidBodyPhysicsComponent::CollisionShape::CAPSULE;
+
+		if (!primitive && mesh == nullptr)
+		{
+			return nullptr;
+		}
+
+		ShapeKey key;
+		key.meshID = primitive ? INVALID_ENTITY : meshID;
+		key.meshHash = primitive ? 0 : ComputeMeshHash(*mesh, type);
+		key.type = type;
+		key.scale[0] = scale.x();
+		key.scale[1] = scale.y();
+		key.scale[2] = scale.z();
+
+		std::shared_ptr<CollisionShape> entry;
+		if (SHAPE_CACHE)
+		{
+			std::lock_guard<std::mutex> lock(shapeCacheLock);
+			std::weak_ptr<CollisionShape>& cached = shapeCache[key];
+			entry = cached.lock();
+			if (entry == nullptr)
+			{
+				entry = std::make_shared<CollisionShape>();
+				entry->key = key;
+				entry->cached = true;
+				cached = entry;
+				shapeCount.fetch_add(1);
+			}
+		}
+		else
+		{
+			entry = std::make_shared<CollisionShape>();
+			entry->key = key;
+			shapeCount.fetch_add(1);
+		}
+
+		std::lock_guard<std::mutex> lock(entry->locker);
+		if (entry->shape == nullptr)
+		{
+			BuildCollisionShape(*entry, type, scale, mesh);
+		}
+		return entry;
+	}
+
+	void SetShapeCacheEnabled(bool value) { SHAPE_CACHE = value; }
+	bool IsShapeCacheEnabled() { return SHAPE_CACHE; }
+	void SetConvexHullVertexLimit(uint32_t value) { convexHullVertexLimit = value; }
+	uint32_t GetConvexHullVertexLimit() { return convexHullVertexLimit; }
+	void SetCookedShapesEnabled(bool value) { COOKED_SHAPES = value; }
+	bool IsCookedShapesEnabled() { return COOKED_SHAPES; }
+	void SetCookedShapeDirectory(const std::string& path)
+	{
+		cookedShapeDirectory = path;
+		if (!cookedShapeDirectory.empty() && cookedShapeDirectory.back() != '/' && cookedShapeDirectory.back() != '\\')
+		{
+			cookedShapeDirectory += "/";
+		}
+	}
+	std::string GetCookedShapeDirectory() { return cookedShapeDirectory; }
+
+	ShapeStats GetShapeStats()
+	{
+		ShapeStats stats;
+		stats.shapeCount = shapeCount.load();
+		stats.memory = shapeMemory.load();
+		return stats;
+	}
+
+	// Rigid body that keeps its collision shape and motion state alive
+	struct RigidBody : public btRigidBody
+	{
+		std::shared_ptr<CollisionShape> collisionShape;
+		btTransform previousTransform; // transform before the last fixed step, for the interpolation
+
+		RigidBody(const btRigidBodyConstructionInfo& info, std::shared_ptr<CollisionShape> collisionShape) : btRigidBody(info), collisionShape(collisionShape)
+		{
+			previousTransform = getWorldTransform();
+		}
+		~RigidBody()
+		{
+			delete getMotionState();
+		}
+	};
+
+	// Advance the simulation of a world by the frame time
+	//	fixed: the frame time is collected in the accumulator of the world, and whole fixed steps are simulated, at most maxSubsteps of them.
+	//		The time that is left over after the substep budget is carried over to the next frames as physics debt,
+	//		the debt is limited to maxSubsteps steps and the rest is dropped, so the simulation can't spiral out of control.
+	//		The rigid bodies keep their transforms from before the last step, for the interpolation.
+	//	otherwise the variable frame time is simulated with the internal substeps of Bullet
+	//	returns the number of simulation steps
+	uint32_t StepWorld(World& world, float dt, bool fixed)
+	{
+		const int maxVariableSubsteps = 10;
+		if (!fixed)
+		{
+			world.accumulator = 0;
+			world.stats = FixedStepStats();
+			return (uint32_t)std::min(world.dynamicsWorld->stepSimulation(dt, maxVariableSubsteps), maxVariableSubsteps);
+		}
+
+		const double step = (double)fixedTimestep;
+		world.accumulator += (double)dt;
+		const uint32_t stepCount = (uint32_t)std::min((double)maxSubsteps, std::floor(world.accumulator / step));
+		world.accumulator -= stepCount * step;
+
+		const double maxDebt = maxSubsteps * step;
+		double debt = std::floor(world.accumulator / step) * step;
+		if (debt > maxDebt)
+		{
+			world.stats.droppedTime += float(debt - maxDebt);
+			world.accumulator -= debt - maxDebt;
+			debt = maxDebt;
+		}
+
+		world.dynamicsWorld->StepFixed(btScalar(step), stepCount, [&] {
+			const btCollisionObjectArray& collisionObjects = world.dynamicsWorld->getCollisionObjectArray();
+			for (int i = 0; i < collisionObjects.size(); ++i)
+			{
+				btRigidBody* rigidbody = btRigidBody::upcast(collisionObjects[i]);
+				if (rigidbody != nullptr)
+				{
+					((RigidBody*)rigidbody)->previousTransform = rigidbody->getWorldTransform();
+				}
+			}
+		});
+
+		world.stats.steps = stepCount;
+		world.stats.debt = float(debt);
+		world.stats.alpha = float((world.accumulator - debt) / step);
+		return stepCount;
+	}
+
+	void AddRigidBody(Entity entity, wiScene::RigidBodyPhysicsComponent& physicscomponent, std::shared_ptr<CollisionShape> collisionShape, const wiScene::TransformComponent& transform)
+	{
+		btCollisionShape* shape = collisionShape != nullptr ? collisionShape->shape.get() : nullptr;
+
 		if (shape != nullptr)
 		{
 			// Use default margin for now
@@ -170,7 +1134,7 @@ namespace wiPhysicsEngine
 			//rbInfo.m_linearDamping = physicscomponent.damping;
 			//rbInfo.m_angularDamping = physicscomponent.damping;
 
-			btRigidBody* rigidbody = new btRigidBody(rbInfo);
+			btRigidBody* rigidbody = new RigidBody(rbInfo, collisionShape);
 			rigidbody->setUserIndex(*(int*)&entity);
 
 			if (physicscomponent.IsKinematic())
@@ -182,7 +1146,7 @@ namespace wiPhysicsEngine
 				rigidbody->setActivationState(DISABLE_DEACTIVATION);
 			}
 
-			dynamicsWorld->addRigidBody(rigidbody);
+			world.dynamicsWorld->addRigidBody(rigidbody);
 			physicscomponent.physicsobject = rigidbody;
 		}
 	}
@@ -208,7 +1172,7 @@ namespace wiPhysicsEngine
 			btVerts[i * 3 + 2] = btScalar(position.z);
 		}
 
-		const int iCount = (int)mesh.indices.size();
+		const int iCount = (int)mesh.GetBaseIndexCount();
 		const int tCount = iCount / 3;
 		int* btInd = new int[iCount];
 		for (int i = 0; i < iCount; ++i) 
@@ -219,7 +1183,7 @@ namespace wiPhysicsEngine
 		}
 
 		btSoftBody* softbody = btSoftBodyHelpers::CreateFromTriMesh(
-			((btSoftRigidDynamicsWorld*)dynamicsWorld.get())->getWorldInfo()
+			world.dynamicsWorld->getWorldInfo()
 			, btVerts
 			, btInd
 			, tCount
@@ -278,11 +1242,308 @@ namespace wiPhysicsEngine
 
 			softbody->setPose(true, true);
 
-			((btSoftRigidDynamicsWorld*)dynamicsWorld.get())->addSoftBody(softbody);
+			world.dynamicsWorld->addSoftBody(softbody);
 			physicscomponent.physicsobject = softbody;
 		}
 	}
 
+	// Read-only snapshot of the world for the queries:
+	//	The broadphase of the world can't be used from multiple threads (its ray test uses a shared stack),
+	//	so the snapshot has its own bounding volume tree of the collision objects, with their shapes and transforms
+	struct QueryObject
+	{
+		btCollisionObject* object = nullptr;
+		btTransform transform;
+		Entity entity = INVALID_ENTITY;
+	};
+	struct QuerySnapshot
+	{
+		std::mutex locker;
+		bool dirty = true;
+		btDbvt tree;
+		std::vector<QueryObject> objects;
+	};
+	QuerySnapshot snapshot;
+
+	const QuerySnapshot& GetQuerySnapshot()
+	{
+		std::lock_guard<std::mutex> lock(snapshot.locker);
+		if (snapshot.dirty && world.dynamicsWorld != nullptr)
+		{
+			snapshot.dirty = false;
+			snapshot.tree.clear();
+			snapshot.objects.clear();
+
+			const btCollisionObjectArray& collisionObjects = world.dynamicsWorld->getCollisionObjectArray();
+			snapshot.objects.reserve(collisionObjects.size());
+			for (int i = 0; i < collisionObjects.size(); ++i)
+			{
+				btCollisionObject* collisionobject = collisionObjects[i];
+				const btBroadphaseProxy* proxy = collisionobject->getBroadphaseHandle();
+				if (proxy == nullptr)
+				{
+					continue;
+				}
+				QueryObject object;
+				object.object = collisionobject;
+				object.transform = collisionobject->getWorldTransform();
+				int userIndex = collisionobject->getUserIndex();
+				object.entity = *(Entity*)&userIndex;
+
+				btDbvtNode* node = snapshot.tree.insert(btDbvtVolume::FromMM(proxy->m_aabbMin, proxy->m_aabbMax), nullptr);
+				node->dataAsInt = (int)snapshot.objects.size();
+				snapshot.objects.push_back(object);
+			}
+		}
+		return snapshot;
+	}
+
+	struct QueryShapeInstance
+	{
+		btSphereShape sphere;
+		btBoxShape box;
+		btConvexShape* shape = nullptr;
+		btTransform transform;
+
+		QueryShapeInstance(const QueryShape& desc, const btVector3& position) :
+			sphere(desc.radius),
+			box(btVector3(desc.halfExtents.x, desc.halfExtents.y, desc.halfExtents.z))
+		{
+			transform.setIdentity();
+			transform.setOrigin(position);
+			if (desc.type == QueryShape::BOX)
+			{
+				shape = &box;
+				transform.setRotation(btQuaternion(desc.rotation.x, desc.rotation.y, desc.rotation.z, desc.rotation.w));
+			}
+			else
+			{
+				shape = &sphere;
+			}
+		}
+	};
+
+	struct QueryCollector : public btDbvt::ICollide
+	{
+		const QuerySnapshot& snapshot;
+		btAlignedObjectArray<int> results;
+
+		QueryCollector(const QuerySnapshot& snapshot) : snapshot(snapshot) {}
+		void Process(const btDbvtNode* leaf) override
+		{
+			results.push_back(leaf->dataAsInt);
+		}
+	};
+
+	QueryHit RayCast(const RAY& ray, float maxDistance)
+	{
+		const QuerySnapshot& snapshot = GetQuerySnapshot();
+
+		const btVector3 direction = btVector3(ray.direction.x, ray.direction.y, ray.direction.z).normalized();
+		const btVector3 from(ray.origin.x, ray.origin.y, ray.origin.z);
+		const btVector3 to = from + direction * maxDistance;
+		btTransform fromTransform, toTransform;
+		fromTransform.setIdentity();
+		fromTransform.setOrigin(from);
+		toTransform.setIdentity();
+		toTransform.setOrigin(to);
+
+		QueryCollector collector(snapshot);
+		btDbvt::rayTest(snapshot.tree.m_root, from, to, collector);
+
+		QueryHit result;
+		btCollisionWorld::ClosestRayResultCallback callback(from, to);
+		for (int i = 0; i < collector.results.size(); ++i)
+		{
+			const QueryObject& object = snapshot.objects[collector.results[i]];
+			const btCollisionObject* previous = callback.m_collisionObject;
+			btSoftRigidDynamicsWorld::rayTestSingle(fromTransform, toTransform, object.object, object.object->getCollisionShape(), object.transform, callback);
+			if (callback.m_collisionObject != previous)
+			{
+				result.entity = object.entity;
+			}
+		}
+		if (callback.hasHit())
+		{
+			result.position = XMFLOAT3(callback.m_hitPointWorld.x(), callback.m_hitPointWorld.y(), callback.m_hitPointWorld.z());
+			const btVector3 normal = callback.m_hitNormalWorld.normalized();
+			result.normal = XMFLOAT3(normal.x(), normal.y(), normal.z());
+			result.distance = callback.m_closestHitFraction * maxDistance;
+		}
+		else
+		{
+			result.entity = INVALID_ENTITY;
+		}
+		return result;
+	}
+	void RayCastBatch(const RAY* rays, uint32_t count, QueryHit* results, float maxDistance)
+	{
+		GetQuerySnapshot(); // the snapshot is updated before the jobs start
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, count, 256, [&](wiJobDispatchArgs args) {
+			results[args.jobIndex] = RayCast(rays[args.jobIndex], maxDistance);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	QueryHit Sweep(const SweepQuery& query)
+	{
+		const QuerySnapshot& snapshot = GetQuerySnapshot();
+
+		const btVector3 from(query.from.x, query.from.y, query.from.z);
+		const btVector3 to(query.to.x, query.to.y, query.to.z);
+		QueryShapeInstance shape(query.shape, from);
+		btTransform fromTransform = shape.transform;
+		btTransform toTransform = shape.transform;
+		toTransform.setOrigin(to);
+
+		// The bounding volume of the whole sweep:
+		btVector3 aabbMin, aabbMax, aabbMin2, aabbMax2;
+		shape.shape->getAabb(fromTransform, aabbMin, aabbMax);
+		shape.shape->getAabb(toTransform, aabbMin2, aabbMax2);
+		aabbMin.setMin(aabbMin2);
+		aabbMax.setMax(aabbMax2);
+
+		QueryCollector collector(snapshot);
+		snapshot.tree.collideTV(snapshot.tree.m_root, btDbvtVolume::FromMM(aabbMin, aabbMax), collector);
+
+		QueryHit result;
+		btCollisionWorld::ClosestConvexResultCallback callback(from, to);
+		for (int i = 0; i < collector.results.size(); ++i)
+		{
+			const QueryObject& object = snapshot.objects[collector.results[i]];
+			if (object.object->getCollisionShape()->isSoftBody())
+			{
+				continue;
+			}
+			const btCollisionObject* previous = callback.m_hitCollisionObject;
+			btCollisionWorld::objectQuerySingle(shape.shape, fromTransform, toTransform, object.object, object.object->getCollisionShape(), object.transform, callback, 0);
+			if (callback.m_hitCollisionObject != previous)
+			{
+				result.entity = object.entity;
+			}
+		}
+		if (callback.hasHit())
+		{
+			result.position = XMFLOAT3(callback.m_hitPointWorld.x(), callback.m_hitPointWorld.y(), callback.m_hitPointWorld.z());
+			const btVector3 normal = callback.m_hitNormalWorld.normalized();
+			result.normal = XMFLOAT3(normal.x(), normal.y(), normal.z());
+			result.distance = callback.m_closestHitFraction * (to - from).length();
+		}
+		else
+		{
+			result.entity = INVALID_ENTITY;
+		}
+		return result;
+	}
+	void SweepBatch(const SweepQuery* queries, uint32_t count, QueryHit* results)
+	{
+		GetQuerySnapshot(); // the snapshot is updated before the jobs start
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, count, 64, [&](wiJobDispatchArgs args) {
+			results[args.jobIndex] = Sweep(queries[args.jobIndex]);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	bool IsOverlapping(const btConvexShape* a, const btTransform& transformA, const btConvexShape* b, const btTransform& transformB)
+	{
+		btVoronoiSimplexSolver simplexSolver;
+		btGjkEpaPenetrationDepthSolver penetrationSolver;
+		btGjkPairDetector detector(a, b, &simplexSolver, &penetrationSolver);
+		btGjkPairDetector::ClosestPointInput input;
+		input.m_transformA = transformA;
+		input.m_transformB = transformB;
+		btPointCollector output;
+		detector.getClosestPoints(input, output, nullptr);
+		return output.m_hasResult && output.m_distance <= 0;
+	}
+	// Triangles of a concave shape are tested one by one, the query shape is in the local space of the concave shape
+	struct OverlapTriangleCallback : public btTriangleCallback
+	{
+		const btConvexShape* shape;
+		btTransform transform;
+		bool overlapping = false;
+
+		void processTriangle(btVector3* triangle, int partId, int triangleIndex) override
+		{
+			if (!overlapping)
+			{
+				btTriangleShape triangleShape(triangle[0], triangle[1], triangle[2]);
+				btTransform identity;
+				identity.setIdentity();
+				overlapping = IsOverlapping(shape, transform, &triangleShape, identity);
+			}
+		}
+	};
+	bool IsOverlapping(const QueryShapeInstance& query, const btCollisionShape* shape, const btTransform& transform)
+	{
+		if (shape->isConvex())
+		{
+			return IsOverlapping(query.shape, query.transform, (const btConvexShape*)shape, transform);
+		}
+		if (shape->isCompound())
+		{
+			const btCompoundShape* compound = (const btCompoundShape*)shape;
+			for (int i = 0; i < compound->getNumChildShapes(); ++i)
+			{
+				if (IsOverlapping(query, compound->getChildShape(i), transform * compound->getChildTransform(i)))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+		if (shape->isSoftBody())
+		{
+			return true; // soft bodies only use the bounding box
+		}
+		if (shape->isConcave())
+		{
+			OverlapTriangleCallback callback;
+			callback.shape = query.shape;
+			callback.transform = transform.inverse() * query.transform;
+			btVector3 aabbMin, aabbMax;
+			query.shape->getAabb(callback.transform, aabbMin, aabbMax);
+			((const btConcaveShape*)shape)->processAllTriangles(&callback, aabbMin, aabbMax);
+			return callback.overlapping;
+		}
+		return false;
+	}
+
+	void Overlap(const OverlapQuery& query, std::vector<wiECS::Entity>& entities)
+	{
+		const QuerySnapshot& snapshot = GetQuerySnapshot();
+
+		QueryShapeInstance shape(query.shape, btVector3(query.position.x, query.position.y, query.position.z));
+		btVector3 aabbMin, aabbMax;
+		shape.shape->getAabb(shape.transform, aabbMin, aabbMax);
+
+		QueryCollector collector(snapshot);
+		snapshot.tree.collideTV(snapshot.tree.m_root, btDbvtVolume::FromMM(aabbMin, aabbMax), collector);
+
+		for (int i = 0; i < collector.results.size(); ++i)
+		{
+			const QueryObject& object = snapshot.objects[collector.results[i]];
+			if (IsOverlapping(shape, object.object->getCollisionShape(), object.transform))
+			{
+				entities.push_back(object.entity);
+			}
+		}
+	}
+	void OverlapBatch(const OverlapQuery* queries, uint32_t count, std::vector<wiECS::Entity>* results)
+	{
+		GetQuerySnapshot(); // the snapshot is updated before the jobs start
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, count, 64, [&](wiJobDispatchArgs args) {
+			Overlap(queries[args.jobIndex], results[args.jobIndex]);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
 	void RunPhysicsUpdateSystem(
 		wiJobSystem::context& ctx,
 		const WeatherComponent& weather,
@@ -316,9 +1577,11 @@ namespace wiPhysicsEngine
 			{
 				TransformComponent& transform = *transforms.GetComponent(entity);
 				const ObjectComponent& object = *objects.GetComponent(entity);
-				const MeshComponent& mesh = *meshes.GetComponent(object.meshID);
+				const MeshComponent* mesh = meshes.GetComponent(object.meshID);
+				const btVector3 scale(transform.scale_local.x, transform.scale_local.y, transform.scale_local.z);
+				auto collisionShape = AcquireCollisionShape(object.meshID, physicscomponent.shape, scale, mesh);
 				physicsLock.lock();
-				AddRigidBody(entity, physicscomponent, mesh, transform);
+				AddRigidBody(entity, physicscomponent, collisionShape, transform);
 				physicsLock.unlock();
 			}
 
@@ -403,12 +1666,13 @@ namespace wiPhysicsEngine
 		wiJobSystem::Wait(ctx);
 
 		// Perform internal simulation step:
-		dynamicsWorld->stepSimulation(dt, 10);
+		world.dynamicsWorld->SetThreadCount(IsMultithreaded() ? wiJobSystem::GetThreadCount() + 1 : 0); // the worker threads and this thread
+		StepWorld(world, dt, IsFixedTimestepEnabled());
 
 		// Feedback physics engine state to system:
-		for (int i = 0; i < dynamicsWorld->getCollisionObjectArray().size(); ++i)
+		for (int i = 0; i < world.dynamicsWorld->getCollisionObjectArray().size(); ++i)
 		{
-			btCollisionObject* collisionobject = dynamicsWorld->getCollisionObjectArray()[i];
+			btCollisionObject* collisionobject = world.dynamicsWorld->getCollisionObjectArray()[i];
 			int userIndex = collisionobject->getUserIndex();
 			Entity entity = *(Entity*)&userIndex;
 
@@ -418,7 +1682,8 @@ namespace wiPhysicsEngine
 				RigidBodyPhysicsComponent* physicscomponent = rigidbodies.GetComponent(entity);
 				if (physicscomponent == nullptr)
 				{
-					dynamicsWorld->removeRigidBody(rigidbody);
+					world.dynamicsWorld->removeRigidBody(rigidbody);
+					delete rigidbody;
 					i--;
 					continue;
 				}
@@ -428,12 +1693,26 @@ namespace wiPhysicsEngine
 				{
 					TransformComponent& transform = *transforms.GetComponent(entity);
 
-					btMotionState* motionState = rigidbody->getMotionState();
-					btTransform physicsTransform;
+					btVector3 T;
+					btQuaternion R;
+					if (IsFixedTimestepEnabled())
+					{
+						// Interpolate between the last two simulation steps:
+						const btTransform& previousTransform = ((RigidBody*)rigidbody)->previousTransform;
+						const btTransform& currentTransform = rigidbody->getWorldTransform();
+						const btScalar alpha = btScalar(world.stats.alpha);
+						T = previousTransform.getOrigin().lerp(currentTransform.getOrigin(), alpha);
+						R = previousTransform.getRotation().slerp(currentTransform.getRotation(), alpha);
+					}
+					else
+					{
+						btMotionState* motionState = rigidbody->getMotionState();
+						btTransform physicsTransform;
 
-					motionState->getWorldTransform(physicsTransform);
-					btVector3 T = physicsTransform.getOrigin();
-					btQuaternion R = physicsTransform.getRotation();
+						motionState->getWorldTransform(physicsTransform);
+						T = physicsTransform.getOrigin();
+						R = physicsTransform.getRotation();
+					}
 
 					transform.translation_local = XMFLOAT3(T.x(), T.y(), T.z());
 					transform.rotation_local = XMFLOAT4(R.x(), R.y(), R.z(), R.w());
@@ -449,7 +1728,7 @@ namespace wiPhysicsEngine
 					SoftBodyPhysicsComponent* physicscomponent = softbodies.GetComponent(entity);
 					if (physicscomponent == nullptr)
 					{
-						((btSoftRigidDynamicsWorld*)dynamicsWorld.get())->removeSoftBody(softbody);
+						world.dynamicsWorld->removeSoftBody(softbody);
 						i--;
 						continue;
 					}
@@ -487,6 +1766,117 @@ namespace wiPhysicsEngine
 			}
 		}
 
+		// The queries will take a new snapshot of the world:
+		snapshot.locker.lock();
+		snapshot.dirty = true;
+		snapshot.locker.unlock();
+
 		wiProfiler::EndRange(range); // Physics
 	}
+
+	// Boxes in a separate physics world for the benchmarks
+	struct BenchmarkScene
+	{
+		World world;
+		btStaticPlaneShape groundShape = btStaticPlaneShape(btVector3(0, 1, 0), 0);
+		btBoxShape boxShape = btBoxShape(btVector3(0.5f, 0.5f, 0.5f));
+		std::vector<std::unique_ptr<RigidBody>> bodies;
+
+		BenchmarkScene(uint32_t boxCount)
+		{
+			CreateWorld(world);
+
+			btVector3 boxInertia;
+			boxShape.calculateLocalInertia(1, boxInertia);
+
+			bodies.reserve(boxCount + 1);
+			bodies.push_back(std::make_unique<RigidBody>(btRigidBody::btRigidBodyConstructionInfo(0, nullptr, &groundShape), nullptr));
+			world.dynamicsWorld->addRigidBody(bodies.back().get());
+
+			// The boxes are placed in columns on a square grid, with a gap between them in every column, so they fall and stack up:
+			const uint32_t gridSize = 32;
+			const float spacing = 1.5f;
+			for (uint32_t i = 0; i < boxCount; ++i)
+			{
+				const uint32_t x = i % gridSize;
+				const uint32_t z = (i / gridSize) % gridSize;
+				const uint32_t y = i / (gridSize * gridSize);
+				btTransform transform;
+				transform.setIdentity();
+				transform.setOrigin(btVector3((x - gridSize * 0.5f) * spacing, 1 + y * spacing, (z - gridSize * 0.5f) * spacing));
+				transform.setRotation(btQuaternion(btVector3(0, 1, 0), i * 0.1f));
+
+				btRigidBody::btRigidBodyConstructionInfo info(1, nullptr, &boxShape, boxInertia);
+				info.m_startWorldTransform = transform;
+				bodies.push_back(std::make_unique<RigidBody>(info, nullptr));
+				world.dynamicsWorld->addRigidBody(bodies.back().get());
+			}
+		}
+		~BenchmarkScene()
+		{
+			for (auto& body : bodies)
+			{
+				world.dynamicsWorld->removeRigidBody(body.get());
+			}
+		}
+
+		// FNV-1a hash of the transforms:
+		uint64_t ComputeHash() const
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (auto& body : bodies)
+			{
+				const btTransform& transform = body->getWorldTransform();
+				const btQuaternion rotation = transform.getRotation();
+				const float values[] = {
+					(float)transform.getOrigin().x(), (float)transform.getOrigin().y(), (float)transform.getOrigin().z(),
+					(float)rotation.x(), (float)rotation.y(), (float)rotation.z(), (float)rotation.w(),
+				};
+				hash = wiHelper::HashBytes(values, sizeof(values), hash);
+			}
+			return hash;
+		}
+	};
+
+	BenchmarkResult RunBenchmark(uint32_t boxCount, uint32_t stepCount, uint32_t threadCount)
+	{
+		BenchmarkScene scene(boxCount);
+		scene.world.dynamicsWorld->SetThreadCount(threadCount);
+
+		BenchmarkResult result;
+		const btScalar timeStep = btScalar(1.0 / 60.0);
+		wiTimer timer;
+		timer.record();
+		for (uint32_t step = 0; step < stepCount; ++step)
+		{
+			scene.world.dynamicsWorld->stepSimulation(timeStep, 1, timeStep);
+		}
+		result.stepTime = stepCount > 0 ? timer.elapsed() / stepCount : 0;
+		result.hash = scene.ComputeHash();
+		return result;
+	}
+
+	FrameBenchmarkResult RunFrameBenchmark(uint32_t boxCount, const float* frameTimes, uint32_t frameCount, bool fixedTimestep)
+	{
+		BenchmarkScene scene(boxCount);
+		scene.world.dynamicsWorld->SetThreadCount(IsMultithreaded() ? wiJobSystem::GetThreadCount() + 1 : 0);
+
+		FrameBenchmarkResult result;
+		wiTimer timer;
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			timer.record();
+			const uint32_t steps = StepWorld(scene.world, frameTimes[frame], fixedTimestep);
+			const double time = timer.elapsed();
+
+			result.stepCount += steps;
+			result.maxSteps = std::max(result.maxSteps, steps);
+			result.averageFrameTime += time;
+			result.maxFrameTime = std::max(result.maxFrameTime, time);
+			result.maxDebt = std::max(result.maxDebt, scene.world.stats.debt);
+		}
+		result.averageFrameTime = frameCount > 0 ? result.averageFrameTime / frameCount : 0;
+		result.hash = scene.ComputeHash();
+		return result;
+	}
 }
@@ -1,18 +1,314 @@
 #include "wiRandom.h"
+
 #include <random>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
 
 namespace wiRandom
 {
-	std::random_device           rand_dev;
-	std::mt19937                 generator(rand_dev());
+	static inline uint32_t rotl(uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+	static inline uint64_t splitmix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+	// Four numbers with 23 random bits in the mantissa, converted to [0, 1)
+	static inline XMVECTOR XM_CALLCONV toFloat4(const uint32_t* bits)
+	{
+		uint32_t mantissa[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			mantissa[i] = (bits[i] >> 9) | 0x3F800000u;
+		}
+		return XMVectorSubtract(XMLoadInt4(mantissa), XMVectorSplatOne());
+	}
+
+	void Generator::next4(uint32_t* dest)
+	{
+		uint32_t* s0 = state[0];
+		uint32_t* s1 = state[1];
+		uint32_t* s2 = state[2];
+		uint32_t* s3 = state[3];
+		for (int i = 0; i < 4; ++i)
+		{
+			dest[i] = rotl(s1[i] * 5, 7) * 9;
+			const uint32_t t = s1[i] << 9;
+			s2[i] ^= s0[i];
+			s3[i] ^= s1[i];
+			s1[i] ^= s2[i];
+			s0[i] ^= s3[i];
+			s2[i] ^= t;
+			s3[i] = rotl(s3[i], 11);
+		}
+	}
+
+	void Generator::seed(uint64_t seed)
+	{
+		// The state must not be all zeroes, splitmix64 makes it practically impossible:
+		for (int stream = 0; stream < 4; ++stream)
+		{
+			const uint64_t a = splitmix64(seed);
+			const uint64_t b = splitmix64(seed);
+			state[0][stream] = uint32_t(a);
+			state[1][stream] = uint32_t(a >> 32);
+			state[2][stream] = uint32_t(b);
+			state[3][stream] = uint32_t(b >> 32) | 1u;
+		}
+		bufferIndex = 4;
+	}
+
+	uint32_t Generator::nextUint()
+	{
+		if (bufferIndex >= 4)
+		{
+			next4(buffer);
+			bufferIndex = 0;
+		}
+		return buffer[bufferIndex++];
+	}
+	float Generator::nextFloat()
+	{
+		return (nextUint() >> 8) * (1.0f / 16777216.0f);
+	}
+	int Generator::nextInt(int minValue, int maxValue)
+	{
+		const uint64_t range = uint64_t(int64_t(maxValue) - int64_t(minValue)) + 1;
+		if (range > 0xFFFFFFFFull)
+		{
+			return int(uint32_t(minValue) + nextUint());
+		}
+
+		// Lemire's multiply and shift, the few values that would cause bias are rejected:
+		uint64_t m = uint64_t(nextUint()) * range;
+		uint32_t low = uint32_t(m);
+		if (low < range)
+		{
+			const uint32_t threshold = uint32_t((0x100000000ull - range) % range);
+			while (low < threshold)
+			{
+				m = uint64_t(nextUint()) * range;
+				low = uint32_t(m);
+			}
+		}
+		return int(int64_t(minValue) + int64_t(m >> 32));
+	}
+	float Generator::nextGaussian()
+	{
+		// Box-Muller transform:
+		const float u1 = 1 - nextFloat();
+		const float u2 = nextFloat();
+		return sqrtf(-2 * logf(u1)) * cosf(XM_2PI * u2);
+	}
+	XMFLOAT3 Generator::nextUnitVector()
+	{
+		const float z = nextFloat() * 2 - 1;
+		const float phi = nextFloat() * XM_2PI;
+		const float r = sqrtf(std::max(0.0f, 1 - z * z));
+		return XMFLOAT3(r * cosf(phi), r * sinf(phi), z);
+	}
+
+	void Generator::fillUint(uint32_t* dest, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			next4(dest + i);
+		}
+		for (; i < count; ++i)
+		{
+			dest[i] = nextUint();
+		}
+	}
+	void Generator::fillFloat(float* dest, size_t count, float minValue, float maxValue)
+	{
+		const XMVECTOR MIN = XMVectorReplicate(minValue);
+		const XMVECTOR SCALE = XMVectorReplicate(maxValue - minValue);
+		uint32_t bits[4];
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			next4(bits);
+			XMStoreFloat4((XMFLOAT4*)(dest + i), XMVectorMultiplyAdd(toFloat4(bits), SCALE, MIN));
+		}
+		for (; i < count; ++i)
+		{
+			dest[i] = nextFloat(minValue, maxValue);
+		}
+	}
+	void Generator::fillInt(int* dest, size_t count, int minValue, int maxValue)
+	{
+		const uint64_t range = uint64_t(int64_t(maxValue) - int64_t(minValue)) + 1;
+		if (range > 0xFFFFFFFFull)
+		{
+			fillUint((uint32_t*)dest, count);
+			return;
+		}
+		const uint32_t threshold = uint32_t((0x100000000ull - range) % range);
+
+		uint32_t bits[4];
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			next4(bits);
+			for (int j = 0; j < 4; ++j)
+			{
+				uint64_t m = uint64_t(bits[j]) * range;
+				while (uint32_t(m) < threshold)
+				{
+					m = uint64_t(nextUint()) * range;
+				}
+				dest[i + j] = int(int64_t(minValue) + int64_t(m >> 32));
+			}
+		}
+		for (; i < count; ++i)
+		{
+			dest[i] = nextInt(minValue, maxValue);
+		}
+	}
+	void Generator::fillGaussian(float* dest, size_t count, float mean, float deviation)
+	{
+		// Box-Muller transform, four pairs at a time:
+		const XMVECTOR ONE = XMVectorSplatOne();
+		const XMVECTOR MINUS_TWO_LN2 = XMVectorReplicate(-2 * 0.69314718f);
+		const XMVECTOR TWO_PI = XMVectorReplicate(XM_2PI);
+		const XMVECTOR MEAN = XMVectorReplicate(mean);
+		const XMVECTOR DEVIATION = XMVectorReplicate(deviation);
+		uint32_t bits[4];
+		XMFLOAT4 result[2];
+		for (size_t i = 0; i < count; i += 8)
+		{
+			next4(bits);
+			const XMVECTOR u1 = XMVectorSubtract(ONE, toFloat4(bits)); // (0, 1]
+			next4(bits);
+			const XMVECTOR u2 = toFloat4(bits);
+
+			const XMVECTOR r = XMVectorMultiply(XMVectorSqrt(XMVectorMultiply(XMVectorLog2(u1), MINUS_TWO_LN2)), DEVIATION);
+			XMVECTOR s, c;
+			XMVectorSinCos(&s, &c, XMVectorMultiply(u2, TWO_PI));
+
+			if (i + 8 <= count)
+			{
+				XMStoreFloat4((XMFLOAT4*)(dest + i), XMVectorMultiplyAdd(r, c, MEAN));
+				XMStoreFloat4((XMFLOAT4*)(dest + i + 4), XMVectorMultiplyAdd(r, s, MEAN));
+			}
+			else
+			{
+				XMStoreFloat4(&result[0], XMVectorMultiplyAdd(r, c, MEAN));
+				XMStoreFloat4(&result[1], XMVectorMultiplyAdd(r, s, MEAN));
+				for (size_t j = i; j < count; ++j)
+				{
+					dest[j] = ((const float*)result)[j - i];
+				}
+			}
+		}
+	}
+	void Generator::fillUnitVector(XMFLOAT3* dest, size_t count)
+	{
+		const XMVECTOR ONE = XMVectorSplatOne();
+		const XMVECTOR TWO = XMVectorReplicate(2);
+		const XMVECTOR TWO_PI = XMVectorReplicate(XM_2PI);
+		uint32_t bits[4];
+		XMFLOAT4 x, y, z;
+		for (size_t i = 0; i < count; i += 4)
+		{
+			next4(bits);
+			const XMVECTOR Z = XMVectorSubtract(XMVectorMultiply(toFloat4(bits), TWO), ONE);
+			next4(bits);
+			const XMVECTOR phi = XMVectorMultiply(toFloat4(bits), TWO_PI);
+
+			const XMVECTOR r = XMVectorSqrt(XMVectorMax(XMVectorZero(), XMVectorNegativeMultiplySubtract(Z, Z, ONE)));
+			XMVECTOR s, c;
+			XMVectorSinCos(&s, &c, phi);
+			XMStoreFloat4(&x, XMVectorMultiply(r, c));
+			XMStoreFloat4(&y, XMVectorMultiply(r, s));
+			XMStoreFloat4(&z, Z);
+
+			const size_t end = std::min(count - i, size_t(4));
+			for (size_t j = 0; j < end; ++j)
+			{
+				dest[i + j] = XMFLOAT3((&x.x)[j], (&y.x)[j], (&z.x)[j]);
+			}
+		}
+	}
+
+
+	static std::atomic<uint64_t> globalSeed{ 0 };
+	static std::atomic<uint32_t> seedGeneration{ 0 };	// 0 = not seeded
+	static std::atomic<uint32_t> threadCounter{ 0 };	// order of the threads since the last seed
+
+	struct ThreadGenerator
+	{
+		Generator generator;
+		uint32_t generation = ~0u;
+	};
+	static thread_local ThreadGenerator threadGenerator;
+
+	void seed(uint64_t seed)
+	{
+		globalSeed.store(seed);
+		threadCounter.store(0);
+		seedGeneration.fetch_add(1);
+		getThreadGenerator();
+	}
 
-	int wiRandom::getRandom(int minValue, int maxValue)
+	Generator& getThreadGenerator()
 	{
-		std::uniform_int_distribution<int>  distr(minValue, maxValue);
-		return distr(generator);
+		ThreadGenerator& local = threadGenerator;
+		const uint32_t generation = seedGeneration.load();
+		if (local.generation != generation)
+		{
+			local.generation = generation;
+			if (generation == 0)
+			{
+				std::random_device rand_dev;
+				local.generator.seed((uint64_t(rand_dev()) << 32) | rand_dev());
+			}
+			else
+			{
+				const uint64_t stream = threadCounter.fetch_add(1);
+				local.generator.seed(globalSeed.load() + stream * 0xD1B54A32D192ED03ull);
+			}
+		}
+		return local.generator;
 	}
-	int wiRandom::getRandom(int maxValue)
+
+	int getRandom(int minValue, int maxValue)
+	{
+		return getThreadGenerator().nextInt(minValue, maxValue);
+	}
+	int getRandom(int maxValue)
 	{
 		return getRandom(0, maxValue);
 	}
+	float getRandomFloat()
+	{
+		return getThreadGenerator().nextFloat();
+	}
+	float getRandomFloat(float minValue, float maxValue)
+	{
+		return getThreadGenerator().nextFloat(minValue, maxValue);
+	}
+
+	void fillFloat(float* dest, size_t count, float minValue, float maxValue)
+	{
+		getThreadGenerator().fillFloat(dest, count, minValue, maxValue);
+	}
+	void fillInt(int* dest, size_t count, int minValue, int maxValue)
+	{
+		getThreadGenerator().fillInt(dest, count, minValue, maxValue);
+	}
+	void fillGaussian(float* dest, size_t count, float mean, float deviation)
+	{
+		getThreadGenerator().fillGaussian(dest, count, mean, deviation);
+	}
+	void fillUnitVector(XMFLOAT3* dest, size_t count)
+	{
+		getThreadGenerator().fillUnitVector(dest, count);
+	}
 }
@@ -1,8 +1,86 @@
 #pragma once
+#include "CommonInclude.h"
+
+#include <cstddef>
 
 namespace wiRandom
 {
+	// Random number generator (xoshiro128**), it runs four independent streams side by side
+	//	The batch fill functions consume all four streams at once and convert the numbers with DirectXMath vectors.
+	//	A generator is not thread safe, every thread or system should have its own. The same seed gives the same sequence on every platform.
+	class Generator
+	{
+		uint32_t state[4][4];	// [word][stream]
+		uint32_t buffer[4];		// output of the last step that is not consumed yet
+		uint32_t bufferIndex = 4;
+
+		// Advance the four streams, write one number of each
+		void next4(uint32_t* dest);
+
+	public:
+		Generator(uint64_t seed = 0) { this->seed(seed); }
+		void seed(uint64_t seed);
+
+		// Uniform in [0, 2^32)
+		uint32_t nextUint();
+		// Uniform in [0, 1)
+		float nextFloat();
+		// Uniform in [minValue, maxValue)
+		float nextFloat(float minValue, float maxValue) { return minValue + (maxValue - minValue) * nextFloat(); }
+		// Uniform in [minValue, maxValue], without modulo bias
+		int nextInt(int minValue, int maxValue);
+		// Normal distribution with mean 0 and standard deviation 1
+		float nextGaussian();
+		// Uniform on the unit sphere
+		XMFLOAT3 nextUnitVector();
+
+		void fillUint(uint32_t* dest, size_t count);
+		void fillFloat(float* dest, size_t count, float minValue = 0, float maxValue = 1);
+		void fillInt(int* dest, size_t count, int minValue, int maxValue);
+		void fillGaussian(float* dest, size_t count, float mean = 0, float deviation = 1);
+		void fillUnitVector(XMFLOAT3* dest, size_t count);
+	};
+
+	// Seed the random streams of the threads
+	//	The calling thread's stream is reseeded immediately, the other threads reseed their streams when they first use wiRandom after this.
+	//	The streams are derived from the seed and the order in which the threads use them, so the sequence of a single thread is reproducible.
+	//	Without seeding, the streams are seeded from std::random_device.
+	void seed(uint64_t seed);
+	// Random stream of the calling thread, it can be used from any thread without locking
+	Generator& getThreadGenerator();
+
+	// Uniform int in [minValue, maxValue] from the stream of the calling thread
 	int getRandom(int minValue, int maxValue);
 	int getRandom(int maxValue);
-};
+	// Uniform float in [0, 1) from the stream of the calling thread
+	float getRandomFloat();
+	float getRandomFloat(float minValue, float maxValue);
 
+	// Batch fills from the stream of the calling thread
+	void fillFloat(float* dest, size_t count, float minValue = 0, float maxValue = 1);
+	void fillInt(int* dest, size_t count, int minValue, int maxValue);
+	void fillGaussian(float* dest, size_t count, float mean = 0, float deviation = 1);
+	void fillUnitVector(XMFLOAT3* dest, size_t count);
+
+	// Stateless random numbers (PCG hash), for parallel jobs where the result must not depend on which thread runs which item:
+	//	for example hashToFloat(itemIndex, seed)
+	inline uint32_t hash(uint32_t value)
+	{
+		const uint32_t state = value * 747796405u + 2891336453u;
+		const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+	inline uint32_t hash(uint32_t value, uint32_t seed)
+	{
+		return hash(value ^ hash(seed));
+	}
+	// Uniform in [0, 1)
+	inline float hashToFloat(uint32_t value)
+	{
+		return (hash(value) >> 8) * (1.0f / 16777216.0f);
+	}
+	inline float hashToFloat(uint32_t value, uint32_t seed)
+	{
+		return (hash(value, seed) >> 8) * (1.0f / 16777216.0f);
+	}
+};
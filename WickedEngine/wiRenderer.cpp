@@ -26,7 +26,10 @@
 #include "wiAllocators.h"
 #include "wiGPUBVH.h"
 #include "wiJobSystem.h"
+#include "wiClusteredCulling.h"
+#include "wiAtlasAllocator.h"
 #include "wiSpinLock.h"
+#include "wiVirtualTexture.h"
 
 #include <algorithm>
 #include <unordered_set>
@@ -58,6 +61,7 @@ BlendState				blendStates[BSTYPE_COUNT];
 GPUBuffer				constantBuffers[CBTYPE_COUNT];
 GPUBuffer				resourceBuffers[RBTYPE_COUNT];
 Sampler					samplers[SSLOT_COUNT];
+wiVirtualTexture::FeedbackBuffer virtualTextureFeedback;
 
 string SHADERPATH = wiHelper::GetOriginalWorkingDirectory() + "../WickedEngine/shaders/";
 
@@ -100,6 +104,7 @@ bool gridHelper = false;
 bool voxelHelper = false;
 bool requestReflectionRendering = false;
 bool advancedLightCulling = true;
+bool clusteredLightCulling = false;
 bool advancedRefractions = false;
 bool ldsSkinningEnabled = true;
 bool scene_bvh_invalid = true;
@@ -118,6 +123,8 @@ uint32_t entityArrayOffset_ForceFields = 0;
 uint32_t entityArrayCount_ForceFields = 0;
 uint32_t entityArrayOffset_EnvProbes = 0;
 uint32_t entityArrayCount_EnvProbes = 0;
+wiClusteredCulling::ClusterGrid entityClusters;
+bool entityClustersValid = false;
 float GameSpeed = 1;
 bool debugLightCulling = false;
 bool occlusionCulling = false;
@@ -125,6 +132,8 @@ bool temporalAA = false;
 bool temporalAADEBUG = false;
 uint32_t raytraceBounceCount = 2;
 bool raytraceDebugVisualizer = false;
+float LODPixelThreshold = 128;
+bool meshletCulling = true;
 Entity cameraTransform = INVALID_ENTITY;
 
 
@@ -168,12 +177,17 @@ wiGPUBVH sceneBVH;
 
 
 static const int atlasClampBorder = 1;
+static const uint32_t atlasMaxSize = 16384;
 
 static Texture decalAtlas;
 static unordered_map<const Texture*, wiRectPacker::rect_xywh> packedDecals;
+static wiAtlasAllocator decalAtlasAllocator;
+static unordered_set<const Texture*> failedDecals; // don't fit into the atlas, only retried after regions were freed
 
 Texture globalLightmap;
 unordered_map<const Texture*, wiRectPacker::rect_xywh> packedLightmaps;
+wiAtlasAllocator lightmapAtlasAllocator;
+static unordered_set<const Texture*> failedLightmaps; // don't fit into the atlas, only retried after regions were freed
 
 
 
@@ -194,12 +208,14 @@ struct RenderBatch
 	uint32_t instance;
 	float distance;
 
-	inline void Create(size_t meshIndex, size_t instanceIndex, float _distance)
+	inline void Create(size_t meshIndex, size_t instanceIndex, float _distance, uint32_t lod = 0)
 	{
 		hash = 0;
 
-		assert(meshIndex < 0x00FFFFFF);
-		hash |= (uint32_t)(meshIndex & 0x00FFFFFF) << 8;
+		assert(meshIndex < 0x000FFFFF);
+		assert(lod < 0x0F);
+		hash |= (uint32_t)(meshIndex & 0x000FFFFF) << 12;
+		hash |= (lod & 0x0F) << 8;
 		hash |= ((uint32_t)(_distance)) & 0xFF;
 
 		instance = (uint32_t)instanceIndex;
@@ -208,7 +224,11 @@ struct RenderBatch
 
 	inline uint32_t GetMeshIndex() const
 	{
-		return (hash >> 8) & 0x00FFFFFF;
+		return (hash >> 12) & 0x000FFFFF;
+	}
+	inline uint32_t GetLOD() const
+	{
+		return (hash >> 8) & 0x0F;
 	}
 	inline uint32_t GetInstanceIndex() const
 	{
@@ -271,6 +291,34 @@ struct RenderQueue
 	}
 };
 
+// Projected size of one world unit at unit distance, in pixels:
+//	VP			: view projection matrix of the render pass
+//	resolution	: vertical resolution of the render target
+inline float GetLODPixelScale(const XMMATRIX& VP, uint32_t resolution)
+{
+	XMFLOAT4X4 vp;
+	XMStoreFloat4x4(&vp, VP);
+	return 0.5f * (float)resolution * std::sqrt(vp._12 * vp._12 + vp._22 * vp._22 + vp._32 * vp._32);
+}
+// Select the level of detail of an object by its projected radius. Every LOD is used for half the size of the previous one:
+//	distance	: distance to the camera (1 for orthographic projections)
+//	pixelScale	: value returned by GetLODPixelScale()
+inline uint32_t ComputeObjectLOD(const MeshComponent& mesh, const AABB& aabb, float distance, float pixelScale)
+{
+	const uint32_t lodCount = mesh.GetLODCount();
+	if (lodCount < 2 || LODPixelThreshold <= 0)
+	{
+		return 0;
+	}
+	const float pixels = aabb.getRadius() * pixelScale / std::max(distance, 0.001f);
+	if (pixels >= LODPixelThreshold)
+	{
+		return 0;
+	}
+	const uint32_t lod = 1 + (uint32_t)std::log2(LODPixelThreshold / std::max(pixels, 0.001f));
+	return std::min(lod, std::min(lodCount - 1, 0x0Eu));
+}
+
 // This is a storage for component indices inside the camera frustum. These can directly index the corresponding ComponentManagers:
 struct FrameCulling
 {
@@ -1081,33 +1129,24 @@ void LoadShaders()
 	GraphicsDevice* device = GetDevice();
 	wiJobSystem::context ctx;
 
-	wiJobSystem::Execute(ctx, [device] {
-		VertexLayoutDesc layout[] =
-		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-		};
-		LoadVertexShader(vertexShaders[VSTYPE_OBJECT_DEBUG], "objectVS_debug.cso");
-		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_OBJECT_DEBUG].code, &vertexLayouts[VLTYPE_OBJECT_DEBUG]);
-		});
+	wiJobSystem::Execute(ctx, []{ LoadVertexShader(vertexShaders[VSTYPE_OBJECT_DEBUG], "objectVS_debug.cso"); });
 
 	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "UVSET",					0, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "UVSET",					1, MeshComponent::Vertex_TEX::FORMAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "ATLAS",					0, MeshComponent::Vertex_TEX::FORMAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "COLOR",					0, MeshComponent::Vertex_COL::FORMAT, 4, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "PREVPOS",				0, MeshComponent::Vertex_POS::FORMAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-
-			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIXPREV",		0, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIXPREV",		1, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIXPREV",		2, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEATLAS",			0, FORMAT_R32G32B32A32_FLOAT, 6, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "UVSET",					0, MeshComponent::Vertex_TEX::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "UVSET",					1, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "ATLAS",					0, MeshComponent::Vertex_TEX::FORMAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "COLOR",					0, MeshComponent::Vertex_COL::FORMAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+
+			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIXPREV",		0, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIXPREV",		1, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIXPREV",		2, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEATLAS",			0, FORMAT_R32G32B32A32_FLOAT, 5, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
 		};
 		LoadVertexShader(vertexShaders[VSTYPE_OBJECT_COMMON], "objectVS_common.cso");
 		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_OBJECT_COMMON].code, &vertexLayouts[VLTYPE_OBJECT_ALL]);
@@ -1116,12 +1155,10 @@ void LoadShaders()
 	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-
-			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
 		};
 		LoadVertexShader(vertexShaders[VSTYPE_OBJECT_POSITIONSTREAM], "objectVS_positionstream.cso");
 		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_OBJECT_POSITIONSTREAM].code, &vertexLayouts[VLTYPE_OBJECT_POS]);
@@ -1131,14 +1168,13 @@ void LoadShaders()
 	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "UVSET",					0, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "UVSET",					1, MeshComponent::Vertex_TEX::FORMAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "UVSET",					0, MeshComponent::Vertex_TEX::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "UVSET",					1, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
 
-			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
 		};
 		LoadVertexShader(vertexShaders[VSTYPE_OBJECT_SIMPLE], "objectVS_simple.cso");
 		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_OBJECT_SIMPLE].code, &vertexLayouts[VLTYPE_OBJECT_POS_TEX]);
@@ -1148,12 +1184,10 @@ void LoadShaders()
 	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-
-			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
 		};
 		LoadVertexShader(vertexShaders[VSTYPE_SHADOW], "shadowVS.cso");
 		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_SHADOW].code, &vertexLayouts[VLTYPE_SHADOW_POS]);
@@ -1163,14 +1197,13 @@ void LoadShaders()
 	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "UVSET",					0, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "UVSET",					1, MeshComponent::Vertex_TEX::FORMAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "UVSET",					0, MeshComponent::Vertex_TEX::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "UVSET",					1, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
 
-			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 3, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			0, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			1, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIX",			2, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEUSERDATA",		0, FORMAT_R32G32B32A32_UINT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
 		};
 		LoadVertexShader(vertexShaders[VSTYPE_SHADOW_ALPHATEST], "shadowVS_alphatest.cso");
 		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_SHADOW_ALPHATEST].code, &vertexLayouts[VLTYPE_SHADOW_POS_TEX]);
@@ -1203,12 +1236,11 @@ void LoadShaders()
 	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
-			{ "POSITION_NORMAL_SUBSETINDEX",	0, MeshComponent::Vertex_POS::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
-			{ "ATLAS",						0, MeshComponent::Vertex_TEX::FORMAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
+			{ "ATLAS",						0, MeshComponent::Vertex_TEX::FORMAT, 0, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
 
-			{ "INSTANCEMATRIXPREV",			0, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIXPREV",			1, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
-			{ "INSTANCEMATRIXPREV",			2, FORMAT_R32G32B32A32_FLOAT, 2, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIXPREV",			0, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIXPREV",			1, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEMATRIXPREV",			2, FORMAT_R32G32B32A32_FLOAT, 1, VertexLayoutDesc::APPEND_ALIGNED_ELEMENT, INPUT_PER_INSTANCE_DATA, 1 },
 		};
 		LoadVertexShader(vertexShaders[VSTYPE_RENDERLIGHTMAP], "renderlightmapVS.cso");
 		device->CreateInputLayout(layout, arraysize(layout), &vertexShaders[VSTYPE_RENDERLIGHTMAP].code, &vertexLayouts[VLTYPE_RENDERLIGHTMAP]);
@@ -1968,7 +2000,6 @@ void LoadShaders()
 		case DEBUGRENDERING_EMITTER:
 			desc.vs = &vertexShaders[VSTYPE_OBJECT_DEBUG];
 			desc.ps = &pixelShaders[PSTYPE_OBJECT_DEBUG];
-			desc.il = &vertexLayouts[VLTYPE_OBJECT_DEBUG];
 			desc.dss = &depthStencils[DSSTYPE_DEPTHREAD];
 			desc.rs = &rasterizers[RSTYPE_WIRE_DOUBLESIDED_SMOOTH];
 			desc.bs = &blendStates[BSTYPE_OPAQUE];
@@ -2144,6 +2175,14 @@ void LoadBuffers()
 	device->CreateBuffer(&bd, nullptr, &constantBuffers[CBTYPE_LENSFLARE]);
 	device->SetName(&constantBuffers[CBTYPE_LENSFLARE], "LensFlareCB");
 
+	bd.ByteWidth = sizeof(VertexStreamCB);
+	device->CreateBuffer(&bd, nullptr, &constantBuffers[CBTYPE_VERTEXSTREAM]);
+	device->SetName(&constantBuffers[CBTYPE_VERTEXSTREAM], "VertexStreamCB");
+
+	bd.ByteWidth = sizeof(SkinningCB);
+	device->CreateBuffer(&bd, nullptr, &constantBuffers[CBTYPE_SKINNING]);
+	device->SetName(&constantBuffers[CBTYPE_SKINNING], "SkinningCB");
+
 
 }
 void SetUpStates()
@@ -2700,6 +2739,10 @@ void ClearWorld()
 
 	packedDecals.clear();
 	packedLightmaps.clear();
+	failedDecals.clear();
+	failedLightmaps.clear();
+	decalAtlasAllocator.Reset(0, 0);
+	lightmapAtlasAllocator.Reset(0, 0);
 }
 
 static const uint32_t CASCADE_COUNT = 3;
@@ -2980,6 +3023,8 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 		struct InstancedBatch
 		{
 			uint32_t meshIndex;
+			uint32_t lod;
+			uint32_t firstInstance;
 			int instanceCount;
 			uint32_t dataOffset;
 			uint8_t userStencilRefOverride;
@@ -2990,25 +3035,30 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 		int instancedBatchCount = 0;
 
 		size_t prevMeshIndex = ~0;
+		uint32_t prevLOD = ~0u;
 		uint8_t prevUserStencilRefOverride = 0;
 		uint32_t instanceCount = 0;
 		for (uint32_t batchID = 0; batchID < renderQueue.batchCount; ++batchID) // Do not break out of this loop!
 		{
 			const RenderBatch& batch = renderQueue.batchArray[batchID];
 			const uint32_t meshIndex = batch.GetMeshIndex();
+			const uint32_t lod = batch.GetLOD();
 			const uint32_t instanceIndex = batch.GetInstanceIndex();
 			const ObjectComponent& instance = scene.objects[instanceIndex];
 			const uint8_t userStencilRefOverride = instance.userStencilRef;
 
-			// When we encounter a new mesh inside the global instance array, we begin a new InstancedBatch:
-			if (meshIndex != prevMeshIndex || userStencilRefOverride != prevUserStencilRefOverride)
+			// When we encounter a new mesh or LOD inside the global instance array, we begin a new InstancedBatch:
+			if (meshIndex != prevMeshIndex || lod != prevLOD || userStencilRefOverride != prevUserStencilRefOverride)
 			{
 				prevMeshIndex = meshIndex;
+				prevLOD = lod;
 				prevUserStencilRefOverride = userStencilRefOverride;
 
 				instancedBatchCount++;
 				InstancedBatch* instancedBatch = (InstancedBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(InstancedBatch));
 				instancedBatch->meshIndex = meshIndex;
+				instancedBatch->lod = lod;
+				instancedBatch->firstInstance = instanceIndex;
 				instancedBatch->instanceCount = 0;
 				instancedBatch->dataOffset = instances.offset + instanceCount * instanceDataSize;
 				instancedBatch->userStencilRefOverride = userStencilRefOverride;
@@ -3106,6 +3156,16 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 
 			device->BindIndexBuffer(mesh.indexBuffer.get(), mesh.GetIndexFormat(), 0, cmd);
 
+			// The positions are fetched by the vertex shaders, so quantized and full precision streams can use the same pipeline states:
+			VertexStreamCB vscb;
+			const GPUResource* vertexStreams[] = {
+				mesh.GetPositionStream(vscb.xPositionStream),
+				mesh.GetPrevPositionStream(vscb.xPrevPositionStream),
+			};
+			device->UpdateBuffer(&constantBuffers[CBTYPE_VERTEXSTREAM], &vscb, cmd);
+			device->BindConstantBuffer(VS, &constantBuffers[CBTYPE_VERTEXSTREAM], CB_GETBINDSLOT(VertexStreamCB), cmd);
+			device->BindResources(VS, vertexStreams, TEXSLOT_RENDERER_VERTEX_POS, arraysize(vertexStreams), cmd);
+
 			enum class BOUNDVERTEXBUFFERTYPE
 			{
 				NOTHING,
@@ -3115,8 +3175,12 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 			};
 			BOUNDVERTEXBUFFERTYPE boundVBType_Prev = BOUNDVERTEXBUFFERTYPE::NOTHING;
 
-			for (const MeshComponent::MeshSubset& subset : mesh.subsets)
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			mesh.GetLODSubsetRange(instancedBatch.lod, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 				if (subset.indexCount == 0)
 				{
 					continue;
@@ -3207,15 +3271,12 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 					case BOUNDVERTEXBUFFERTYPE::POSITION:
 					{
 						const GPUBuffer* vbs[] = {
-							mesh.streamoutBuffer_POS.get() != nullptr ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
 							instances.buffer
 						};
 						uint32_t strides[] = {
-							sizeof(MeshComponent::Vertex_POS),
 							instanceDataSize
 						};
 						uint32_t offsets[] = {
-							0,
 							instancedBatch.dataOffset
 						};
 						device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, offsets, cmd);
@@ -3224,19 +3285,16 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 					case BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD:
 					{
 						const GPUBuffer* vbs[] = {
-							mesh.streamoutBuffer_POS.get() != nullptr ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
 							mesh.vertexBuffer_UV0.get(),
 							mesh.vertexBuffer_UV1.get(),
 							instances.buffer
 						};
 						uint32_t strides[] = {
-							sizeof(MeshComponent::Vertex_POS),
 							sizeof(MeshComponent::Vertex_TEX),
 							sizeof(MeshComponent::Vertex_TEX),
 							instanceDataSize
 						};
 						uint32_t offsets[] = {
-							0,
 							0,
 							0,
 							instancedBatch.dataOffset
@@ -3247,21 +3305,17 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 					case BOUNDVERTEXBUFFERTYPE::EVERYTHING:
 					{
 						const GPUBuffer* vbs[] = {
-							mesh.streamoutBuffer_POS.get() != nullptr ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
 							mesh.vertexBuffer_UV0.get(),
 							mesh.vertexBuffer_UV1.get(),
 							mesh.vertexBuffer_ATL.get(),
 							mesh.vertexBuffer_COL.get(),
-							mesh.vertexBuffer_PRE.get() != nullptr ? mesh.vertexBuffer_PRE.get() : mesh.vertexBuffer_POS.get(),
 							instances.buffer
 						};
 						uint32_t strides[] = {
-							sizeof(MeshComponent::Vertex_POS),
 							sizeof(MeshComponent::Vertex_TEX),
 							sizeof(MeshComponent::Vertex_TEX),
 							sizeof(MeshComponent::Vertex_TEX),
 							sizeof(MeshComponent::Vertex_COL),
-							sizeof(MeshComponent::Vertex_POS),
 							instanceDataSize
 						};
 						uint32_t offsets[] = {
@@ -3269,8 +3323,6 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 							0,
 							0,
 							0,
-							0,
-							0,
 							instancedBatch.dataOffset
 						};
 						device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, offsets, cmd);
@@ -3315,6 +3367,12 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 					device->BindResources(PS, res, TEXSLOT_RENDERER_BASECOLORMAP, arraysize(res), cmd);
 				}
 
+				if (material.virtualTexture != nullptr)
+				{
+					device->BindResource(PS, material.virtualTexture->GetPhysicalTexture(), TEXSLOT_RENDERER_VIRTUALTEXTURE, cmd);
+					device->BindResource(PS, material.virtualTexture->GetPageTableBuffer(), SBSLOT_RENDERER_VIRTUALTEXTURE_PAGETABLE, cmd);
+				}
+
 				if (tessellatorRequested)
 				{
 					const GPUResource* res[] = {
@@ -3324,7 +3382,25 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, uint32_
 					device->BindConstantBuffer(DS, material.constantBuffer.get(), CB_GETBINDSLOT(MaterialCB), cmd);
 				}
 
-				device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, subset.indexOffset, 0, 0, cmd);
+				// A single instance of a static mesh can cull its meshlets, the visible ones are drawn as compacted index ranges:
+				if (meshletCulling && subset.meshletCount > 0 && instancedBatch.instanceCount == 1 && renderQueue.camera != nullptr &&
+					!cubemapRenderRequest && !tessellatorRequested && mesh.streamoutBuffer_POS == nullptr)
+				{
+					const ObjectComponent& instance = scene.objects[instancedBatch.firstInstance];
+					const XMMATRIX W = instance.transform_index >= 0 ? XMLoadFloat4x4(&scene.transforms[instance.transform_index].world) : XMMatrixIdentity();
+					const size_t rangesSize = sizeof(MeshComponent::IndexRange) * subset.meshletCount;
+					MeshComponent::IndexRange* ranges = (MeshComponent::IndexRange*)GetRenderFrameAllocator(cmd).allocate(rangesSize);
+					const uint32_t rangeCount = mesh.CullMeshlets(subset, W, renderQueue.camera->frustum, renderQueue.camera->Eye, !mesh.IsDoubleSided(), ranges);
+					for (uint32_t rangeIndex = 0; rangeIndex < rangeCount; ++rangeIndex)
+					{
+						device->DrawIndexedInstanced(ranges[rangeIndex].indexCount, 1, ranges[rangeIndex].indexOffset, 0, 0, cmd);
+					}
+					GetRenderFrameAllocator(cmd).free(rangesSize);
+				}
+				else
+				{
+					device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, subset.indexOffset, 0, 0, cmd);
+				}
 			}
 		}
 
@@ -3508,6 +3584,20 @@ void UpdatePerFrameData(float dt, uint32_t layerMask)
 				device->CreateBuffer(&mesh.vertexBuffer_POS->GetDesc(), nullptr, mesh.vertexBuffer_PRE.get());
 			}
 			mesh.vertexBuffer_POS.swap(mesh.vertexBuffer_PRE);
+
+			// A quantized stream is decoded with the box it was encoded with, the new one will be fitted to the simulated vertices:
+			std::swap(mesh.vertexBox_POS, mesh.vertexBox_PRE);
+			if (mesh.vertexQuantized_POS)
+			{
+				XMFLOAT3 _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+				XMFLOAT3 _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+				for (auto& pos : mesh.vertex_positions)
+				{
+					_min = wiMath::Min(_min, pos);
+					_max = wiMath::Max(_max, pos);
+				}
+				mesh.vertexBox_POS = AABB(_min, _max);
+			}
 		}
 	});
 
@@ -3813,6 +3903,27 @@ void UpdateRenderData(CommandList cmd)
 		}
 	}
 
+	// Stream the virtual texture pages that the object shaders requested in an earlier frame:
+	bool virtualTextureFeedbackUpdated = false;
+	for (size_t i = 0; i < scene.materials.GetCount(); ++i)
+	{
+		const MaterialComponent& material = scene.materials[i];
+		if (material.virtualTexture == nullptr)
+		{
+			continue;
+		}
+		if (!virtualTextureFeedbackUpdated)
+		{
+			if (!virtualTextureFeedback.IsValid())
+			{
+				virtualTextureFeedback.Create();
+			}
+			virtualTextureFeedback.Update(cmd);
+			virtualTextureFeedbackUpdated = true;
+		}
+		material.virtualTexture->Update(virtualTextureFeedback, cmd);
+	}
+
 
 	const FrameCulling& mainCameraCulling = frameCullings.at(&GetCamera());
 
@@ -4050,6 +4161,78 @@ void UpdateRenderData(CommandList cmd)
 		GetRenderFrameAllocator(cmd).free(sizeof(XMMATRIX)*MATRIXARRAY_COUNT);
 	}
 
+	// Clustered entity culling on the CPU for the forward pass of the main camera:
+	entityClustersValid = false;
+	if (GetClusteredLightCullingEnabled())
+	{
+		auto range = wiProfiler::BeginRangeCPU("Entity Clustering");
+
+		// The cluster entity lists must match the entity array layout, so the same entities are collected here in the same order:
+		std::vector<SPHERE> spheres[wiClusteredCulling::CATEGORY_COUNT];
+		for (size_t i = 0; i < mainCameraCulling.culledDecals.size() && spheres[wiClusteredCulling::CATEGORY_DECAL].size() < entityArrayCount_Decals; ++i)
+		{
+			const uint32_t decalIndex = mainCameraCulling.culledDecals[mainCameraCulling.culledDecals.size() - 1 - i];
+			const AABB& aabb = scene.aabb_decals[decalIndex];
+			const XMFLOAT3 halfwidth = aabb.getHalfWidth();
+			spheres[wiClusteredCulling::CATEGORY_DECAL].push_back(SPHERE(aabb.getCenter(), XMVectorGetX(XMVector3Length(XMLoadFloat3(&halfwidth)))));
+		}
+		for (size_t i = 0; i < mainCameraCulling.culledEnvProbes.size() && spheres[wiClusteredCulling::CATEGORY_ENVPROBE].size() < entityArrayCount_EnvProbes; ++i)
+		{
+			const uint32_t probeIndex = mainCameraCulling.culledEnvProbes[mainCameraCulling.culledEnvProbes.size() - 1 - i];
+			if (scene.probes[probeIndex].textureIndex < 0)
+			{
+				continue;
+			}
+			const AABB& aabb = scene.aabb_probes[probeIndex];
+			const XMFLOAT3 halfwidth = aabb.getHalfWidth();
+			spheres[wiClusteredCulling::CATEGORY_ENVPROBE].push_back(SPHERE(aabb.getCenter(), XMVectorGetX(XMVector3Length(XMLoadFloat3(&halfwidth)))));
+		}
+		for (size_t i = 0; i < mainCameraCulling.culledLights.size() && spheres[wiClusteredCulling::CATEGORY_LIGHT].size() < entityArrayCount_Lights; ++i)
+		{
+			const LightComponent& light = scene.lights[mainCameraCulling.culledLights[i]];
+			const float radius = light.GetType() == LightComponent::DIRECTIONAL ? wiClusteredCulling::UNBOUNDED_RADIUS : light.GetRange();
+			spheres[wiClusteredCulling::CATEGORY_LIGHT].push_back(SPHERE(light.position, radius));
+		}
+
+		wiClusteredCulling::EntityList entities[wiClusteredCulling::CATEGORY_COUNT];
+		for (int i = 0; i < wiClusteredCulling::CATEGORY_COUNT; ++i)
+		{
+			entities[i].spheres = spheres[i].data();
+			entities[i].count = (uint32_t)spheres[i].size();
+		}
+
+		const CameraComponent& camera = GetCamera();
+		wiClusteredCulling::Build(entityClusters, camera.View, camera.Projection, camera.zNearP, camera.zFarP, entities);
+
+		const uint32_t clusterCount = entityClusters.GetClusterCount();
+		const uint32_t bufferSize = clusterCount * SHADER_ENTITY_TILE_BUCKET_COUNT * sizeof(uint32_t);
+		if (!resourceBuffers[RBTYPE_ENTITYCLUSTERS].IsValid() || resourceBuffers[RBTYPE_ENTITYCLUSTERS].GetDesc().ByteWidth != bufferSize)
+		{
+			GPUBufferDesc bd;
+			bd.StructureByteStride = sizeof(uint);
+			bd.ByteWidth = bufferSize;
+			bd.Usage = USAGE_DEFAULT;
+			bd.BindFlags = BIND_SHADER_RESOURCE;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = RESOURCE_MISC_BUFFER_STRUCTURED;
+			device->CreateBuffer(&bd, nullptr, &resourceBuffers[RBTYPE_ENTITYCLUSTERS]);
+			device->SetName(&resourceBuffers[RBTYPE_ENTITYCLUSTERS], "EntityClusters");
+		}
+
+		const uint32_t entityOffsets[] = { entityArrayOffset_Lights, entityArrayOffset_Decals, entityArrayOffset_EnvProbes };
+		static_assert(arraysize(entityOffsets) == wiClusteredCulling::CATEGORY_COUNT, "entity offset for every category");
+		uint32_t* buckets = (uint32_t*)GetRenderFrameAllocator(cmd).allocate(bufferSize);
+		if (buckets != nullptr)
+		{
+			wiClusteredCulling::WriteEntityBuckets(entityClusters, SHADER_ENTITY_TILE_BUCKET_COUNT, entityOffsets, buckets);
+			device->UpdateBuffer(&resourceBuffers[RBTYPE_ENTITYCLUSTERS], buckets, cmd, bufferSize);
+			GetRenderFrameAllocator(cmd).free(bufferSize);
+			entityClustersValid = true;
+		}
+
+		wiProfiler::EndRange(range); // Entity Clustering
+	}
+
 	UpdateFrameCB(cmd);
 
 	GetPrevCamera() = GetCamera();
@@ -4100,11 +4283,14 @@ void UpdateRenderData(CommandList cmd)
 				device->UpdateBuffer(armature.boneBuffer.get(), armature.boneData.data(), cmd, (int)(sizeof(ArmatureComponent::ShaderBoneType) * armature.boneData.size()));
 				device->BindResource(CS, armature.boneBuffer.get(), SKINNINGSLOT_IN_BONEBUFFER, cmd);
 
-				// Do the skinning
-				GPUResource* vbs[] = {
-					mesh.vertexBuffer_POS.get(),
+				// Do the skinning, the source positions can be quantized:
+				SkinningCB skinningcb;
+				const GPUResource* vbs[] = {
+					mesh.GetBasePositionStream(skinningcb.xSkinningPositionStream),
 					mesh.vertexBuffer_BON.get(),
 				};
+				device->UpdateBuffer(&constantBuffers[CBTYPE_SKINNING], &skinningcb, cmd);
+				device->BindConstantBuffer(CS, &constantBuffers[CBTYPE_SKINNING], CB_GETBINDSLOT(SkinningCB), cmd);
 				GPUResource* so[] = {
 					mesh.streamoutBuffer_POS.get(),
 				};
@@ -4135,22 +4321,20 @@ void UpdateRenderData(CommandList cmd)
 		Entity entity = scene.softbodies.GetEntity(i);
 		const MeshComponent& mesh = *scene.meshes.GetComponent(entity);
 
-		// Copy new simulation data to vertex buffer
-		const size_t vb_size = sizeof(MeshComponent::Vertex_POS) * mesh.vertex_positions.size();
-		MeshComponent::Vertex_POS* vb = (MeshComponent::Vertex_POS*)GetRenderFrameAllocator(cmd).allocate(vb_size);
+		// Copy new simulation data to vertex buffer, in the format that CreateRenderData() chose for the mesh:
+		const size_t vb_size = (mesh.vertexQuantized_POS ? sizeof(MeshComponent::Vertex_POS16) : sizeof(MeshComponent::Vertex_POS)) * mesh.vertex_positions.size();
+		uint8_t* vb = (uint8_t*)GetRenderFrameAllocator(cmd).allocate(vb_size);
 
-		if (mesh.vertex_normals.empty())
+		for (size_t ind = 0; ind < mesh.vertex_positions.size(); ++ind)
 		{
-			for (size_t ind = 0; ind < mesh.vertex_positions.size(); ++ind)
+			const XMFLOAT3 nor = mesh.vertex_normals.empty() ? XMFLOAT3(0, 0, 0) : mesh.vertex_normals[ind];
+			if (mesh.vertexQuantized_POS)
 			{
-				vb[ind].FromFULL(mesh.vertex_positions[ind], XMFLOAT3(0, 0, 0), 0); // subsetindex??
+				((MeshComponent::Vertex_POS16*)vb)[ind].FromFULL(mesh.vertexBox_POS, mesh.vertex_positions[ind], nor, 0); // subsetindex??
 			}
-		}
-		else
-		{
-			for (size_t ind = 0; ind < mesh.vertex_positions.size(); ++ind)
+			else
 			{
-				vb[ind].FromFULL(mesh.vertex_positions[ind], mesh.vertex_normals[ind], 0); // subsetindex??
+				((MeshComponent::Vertex_POS*)vb)[ind].FromFULL(mesh.vertex_positions[ind], nor, 0); // subsetindex??
 			}
 		}
 
@@ -4980,6 +5164,8 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 				for (uint32_t cascade = 0; cascade < CASCADE_COUNT; ++cascade)
 				{
+					const float lodPixelScale = GetLODPixelScale(shcams[cascade].VP, SHADOWRES_2D);
+
 					RenderQueue renderQueue;
 					bool transparentShadowsRequested = false;
 					for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
@@ -4999,7 +5185,8 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 								RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 								size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-								batch->Create(meshIndex, i, 0);
+								const uint32_t lod = ComputeObjectLOD(scene.meshes[meshIndex], aabb, 1, lodPixelScale);
+								batch->Create(meshIndex, i, 0, lod);
 								renderQueue.add(batch);
 
 								if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
@@ -5046,6 +5233,7 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 			{
 				SHCAM shcam;
 				CreateSpotLightShadowCam(light, shcam);
+				const float lodPixelScale = GetLODPixelScale(shcam.VP, SHADOWRES_2D);
 
 				RenderQueue renderQueue;
 				bool transparentShadowsRequested = false;
@@ -5066,7 +5254,9 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 							RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 							size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-							batch->Create(meshIndex, i, 0);
+							const float distance = wiMath::Distance(light.position, object.center);
+							const uint32_t lod = ComputeObjectLOD(scene.meshes[meshIndex], aabb, distance, lodPixelScale);
+							batch->Create(meshIndex, i, 0, lod);
 							renderQueue.add(batch);
 
 							if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
@@ -5117,6 +5307,7 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 				assert(device->CheckCapability(GraphicsDevice::GRAPHICSDEVICE_CAPABILITY_RENDERTARGET_AND_VIEWPORT_ARRAYINDEX_WITHOUT_GS));
 
 				SPHERE boundingsphere = SPHERE(light.position, light.GetRange());
+				const float lodPixelScale = 0.5f * (float)SHADOWRES_CUBE; // 90 degree field of view
 
 				RenderQueue renderQueue;
 				for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
@@ -5136,7 +5327,9 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 							RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 							size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-							batch->Create(meshIndex, i, 0);
+							const float distance = wiMath::Distance(light.position, object.center);
+							const uint32_t lod = ComputeObjectLOD(scene.meshes[meshIndex], aabb, distance, lodPixelScale);
+							batch->Create(meshIndex, i, 0, lod);
 							renderQueue.add(batch);
 						}
 					}
@@ -5219,6 +5412,10 @@ void DrawScene(const CameraComponent& camera, bool tessellation, CommandList cmd
 	{
 		device->BindResource(PS, &resourceBuffers[RBTYPE_ENTITYTILES_OPAQUE], SBSLOT_ENTITYTILES, cmd);
 	}
+	else if (renderPass == RENDERPASS_FORWARD && entityClustersValid)
+	{
+		device->BindResource(PS, &resourceBuffers[RBTYPE_ENTITYCLUSTERS], SBSLOT_ENTITYTILES, cmd);
+	}
 
 	if (grass)
 	{
@@ -5251,6 +5448,8 @@ void DrawScene(const CameraComponent& camera, bool tessellation, CommandList cmd
 
 	RenderImpostors(camera, renderPass, cmd);
 
+	const float lodPixelScale = GetLODPixelScale(camera.GetViewProjection(), GetInternalResolution().y);
+
 	RenderQueue renderQueue;
 	renderQueue.camera = &camera;
 	for (uint32_t instanceIndex : culling.culledObjects)
@@ -5269,7 +5468,8 @@ void DrawScene(const CameraComponent& camera, bool tessellation, CommandList cmd
 			}
 			RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 			size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-			batch->Create(meshIndex, instanceIndex, distance);
+			const uint32_t lod = ComputeObjectLOD(scene.meshes[meshIndex], scene.aabb_objects[instanceIndex], distance, lodPixelScale);
+			batch->Create(meshIndex, instanceIndex, distance, lod);
 			renderQueue.add(batch);
 		}
 	}
@@ -5310,6 +5510,10 @@ void DrawScene_Transparent(const CameraComponent& camera, const Texture& lineard
 	{
 		device->BindResource(PS, &resourceBuffers[RBTYPE_ENTITYTILES_TRANSPARENT], SBSLOT_ENTITYTILES, cmd);
 	}
+	else if (renderPass == RENDERPASS_FORWARD && entityClustersValid)
+	{
+		device->BindResource(PS, &resourceBuffers[RBTYPE_ENTITYCLUSTERS], SBSLOT_ENTITYTILES, cmd);
+	}
 
 	if (ocean != nullptr)
 	{
@@ -5341,6 +5545,8 @@ void DrawScene_Transparent(const CameraComponent& camera, const Texture& lineard
 		}
 	}
 
+	const float lodPixelScale = GetLODPixelScale(camera.GetViewProjection(), GetInternalResolution().y);
+
 	RenderQueue renderQueue;
 	renderQueue.camera = &camera;
 	for (uint32_t instanceIndex : culling.culledObjects)
@@ -5354,7 +5560,9 @@ void DrawScene_Transparent(const CameraComponent& camera, const Texture& lineard
 		{
 			RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 			size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-			batch->Create(meshIndex, instanceIndex, wiMath::DistanceEstimated(camera.Eye, object.center));
+			const float distance = wiMath::DistanceEstimated(camera.Eye, object.center);
+			const uint32_t lod = ComputeObjectLOD(scene.meshes[meshIndex], scene.aabb_objects[instanceIndex], distance, lodPixelScale);
+			batch->Create(meshIndex, instanceIndex, distance, lod);
 			renderQueue.add(batch);
 		}
 	}
@@ -5914,16 +6122,17 @@ void DrawDebugWorld(const CameraComponent& camera, CommandList cmd)
 			{
 				// Draw mesh wireframe:
 				device->BindPipelineState(&PSO_debug[DEBUGRENDERING_EMITTER], cmd);
-				GPUBuffer* vbs[] = {
-					mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS.get() : mesh->vertexBuffer_POS.get(),
-				};
-				const uint32_t strides[] = {
-					sizeof(MeshComponent::Vertex_POS),
+				VertexStreamCB vscb;
+				const GPUResource* vertexStreams[] = {
+					mesh->GetPositionStream(vscb.xPositionStream),
 				};
-				device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, nullptr, cmd);
+				vscb.xPrevPositionStream = vscb.xPositionStream;
+				device->UpdateBuffer(&constantBuffers[CBTYPE_VERTEXSTREAM], &vscb, cmd);
+				device->BindConstantBuffer(VS, &constantBuffers[CBTYPE_VERTEXSTREAM], CB_GETBINDSLOT(VertexStreamCB), cmd);
+				device->BindResources(VS, vertexStreams, TEXSLOT_RENDERER_VERTEX_POS, arraysize(vertexStreams), cmd);
 				device->BindIndexBuffer(mesh->indexBuffer.get(), mesh->GetIndexFormat(), 0, cmd);
 
-				device->DrawIndexed((uint32_t)mesh->indices.size(), 0, 0, cmd);
+				device->DrawIndexed(mesh->GetBaseIndexCount(), 0, 0, cmd);
 			}
 		}
 
@@ -6291,6 +6500,7 @@ void RefreshEnvProbes(CommandList cmd)
 		const uint32_t layerMask = probe_layer == nullptr ?  ~0 : probe_layer->GetLayerMask();
 
 		SPHERE culler = SPHERE(probe.position, zFarP);
+		const float lodPixelScale = 0.5f * (float)envmapRes; // 90 degree field of view
 
 		RenderQueue renderQueue;
 		for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
@@ -6310,7 +6520,9 @@ void RefreshEnvProbes(CommandList cmd)
 				{
 					RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 					size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-					batch->Create(meshIndex, i, 0);
+					const float distance = wiMath::Distance(probe.position, object.center);
+					const uint32_t lod = ComputeObjectLOD(scene.meshes[meshIndex], aabb, distance, lodPixelScale);
+					batch->Create(meshIndex, i, 0, lod);
 					renderQueue.add(batch);
 				}
 			}
@@ -6493,22 +6705,29 @@ void RefreshImpostors(CommandList cmd)
 		const AABB& bbox = mesh.aabb;
 		const XMFLOAT3 extents = bbox.getHalfWidth();
 
+		VertexStreamCB vscb;
+		const GPUBuffer* positionStream = mesh.GetPositionStream(vscb.xPositionStream);
+		vscb.xPrevPositionStream = vscb.xPositionStream;
+		const GPUResource* vertexStreams[] = {
+			positionStream,
+			positionStream,
+		};
+		device->UpdateBuffer(&constantBuffers[CBTYPE_VERTEXSTREAM], &vscb, cmd);
+		device->BindConstantBuffer(VS, &constantBuffers[CBTYPE_VERTEXSTREAM], CB_GETBINDSLOT(VertexStreamCB), cmd);
+		device->BindResources(VS, vertexStreams, TEXSLOT_RENDERER_VERTEX_POS, arraysize(vertexStreams), cmd);
+
 		const GPUBuffer* vbs[] = {
-			mesh.IsSkinned() ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
 			mesh.vertexBuffer_UV0.get(),
 			mesh.vertexBuffer_UV1.get(),
 			mesh.vertexBuffer_ATL.get(),
 			mesh.vertexBuffer_COL.get(),
-			mesh.IsSkinned() ? mesh.streamoutBuffer_POS.get() : mesh.vertexBuffer_POS.get(),
 			mem.buffer
 		};
 		uint32_t strides[] = {
-			sizeof(MeshComponent::Vertex_POS),
 			sizeof(MeshComponent::Vertex_TEX),
 			sizeof(MeshComponent::Vertex_TEX),
 			sizeof(MeshComponent::Vertex_TEX),
 			sizeof(MeshComponent::Vertex_COL),
-			sizeof(MeshComponent::Vertex_POS),
 			sizeof(InstBuf)
 		};
 		uint32_t offsets[] = {
@@ -6516,8 +6735,6 @@ void RefreshImpostors(CommandList cmd)
 			0,
 			0,
 			0,
-			0,
-			0,
 			mem.offset
 		};
 		device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, offsets, cmd);
@@ -6565,8 +6782,13 @@ void RefreshImpostors(CommandList cmd)
 				impostorcamera.UpdateCamera();
 				UpdateCameraCB(impostorcamera, cmd);
 
-				for (auto& subset : mesh.subsets)
+				// Only the full detail mesh is captured, LOD subsets are skipped:
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					if (subset.indexCount == 0)
 					{
 						continue;
@@ -7601,76 +7823,154 @@ void RayTraceSceneBVH(CommandList cmd)
 }
 
 
+// Insert a new region into a persistent atlas. If it doesn't fit even after growing the atlas, all regions are defragmented, but only once per frame.
+//	A region that doesn't fit leaves the atlas as it was, it is added to the failed regions and reported once
+//	Returns true if the previous region placements were invalidated (defragmentation happened)
+static bool InsertAtlasRegion(wiAtlasAllocator& allocator, unordered_map<const Texture*, wiRectPacker::rect_xywh>& packed, unordered_set<const Texture*>& failed, bool& defragmented, const Texture* texture)
+{
+	wiRectPacker::rect_xywh rect = wiRectPacker::rect_xywh(0, 0, texture->GetDesc().Width + atlasClampBorder * 2, texture->GetDesc().Height + atlasClampBorder * 2);
+	const wiAtlasAllocator previousAllocator = allocator;
+	if (allocator.Allocate(rect, atlasMaxSize))
+	{
+		packed[texture] = rect;
+		failed.erase(texture);
+		return false;
+	}
+	// The failed allocation could have grown the atlas up to the maximum size:
+	allocator = previousAllocator;
+
+	if (!defragmented)
+	{
+		defragmented = true;
+
+		vector<pair<wiRectPacker::rect_xywh*, wiRectPacker::rect_xywh>> previousRects;
+		vector<wiRectPacker::rect_xywh*> rects;
+		previousRects.reserve(packed.size());
+		rects.reserve(packed.size() + 1);
+		for (auto& it : packed)
+		{
+			previousRects.push_back(make_pair(&it.second, it.second));
+			rects.push_back(&it.second);
+		}
+		rects.push_back(&rect);
+		if (allocator.Defragment(rects.data(), rects.size(), atlasMaxSize))
+		{
+			packed[texture] = rect;
+			failed.erase(texture);
+			return true;
+		}
+
+		// Doesn't fit even after defragmentation, the other regions keep their previous places:
+		allocator = previousAllocator;
+		for (auto& x : previousRects)
+		{
+			*x.first = x.second;
+		}
+	}
+
+	if (failed.insert(texture).second)
+	{
+		wiBackLog::post("Atlas packing failed, the region doesn't fit into the texture!");
+	}
+	return false;
+}
+
 bool repackAtlas_Decal = false;
+vector<const Texture*> decalsToRefresh;
 void ManageDecalAtlas()
 {
 	repackAtlas_Decal = false;
+	decalsToRefresh.clear();
+	bool defragmented = false;
+	bool freed = false;
 
 	Scene& scene = GetScene();
 
 	using namespace wiRectPacker;
 
 	// Gather all decal textures:
+	unordered_set<const Texture*> usedDecalTextures;
 	for (size_t i = 0; i < scene.decals.GetCount(); ++i)
 	{
 		const DecalComponent& decal = scene.decals[i];
 
 		if (decal.texture != nullptr)
 		{
-			if (packedDecals.find(decal.texture) == packedDecals.end())
-			{
-				// we need to pack this decal texture into the atlas
-				rect_xywh newRect = rect_xywh(0, 0, decal.texture->GetDesc().Width + atlasClampBorder * 2, decal.texture->GetDesc().Height + atlasClampBorder * 2);
-				packedDecals[decal.texture] = newRect;
-
-				repackAtlas_Decal = true;
-			}
+			usedDecalTextures.insert(decal.texture);
 		}
 	}
 
-	// Update atlas texture if it is invalidated:
-	GraphicsDevice* device = GetDevice();
-	if (repackAtlas_Decal)
+	// Release atlas regions of decal textures that are no longer used:
+	for (auto it = packedDecals.begin(); it != packedDecals.end();)
 	{
-		vector<rect_xywh*> out_rects(packedDecals.size());
-		int i = 0;
-		for (auto& it : packedDecals)
+		if (usedDecalTextures.count(it->first) == 0)
 		{
-			out_rects[i] = &it.second;
-			i++;
+			decalAtlasAllocator.Free(it->second);
+			it = packedDecals.erase(it);
+			freed = true;
 		}
-
-		std::vector<bin> bins;
-		if (pack(out_rects.data(), (int)packedDecals.size(), 16384, bins))
+		else
 		{
-			assert(bins.size() == 1 && "The regions won't fit into the texture!");
-
-			TextureDesc desc;
-			desc.Width = (uint32_t)bins[0].size.w;
-			desc.Height = (uint32_t)bins[0].size.h;
-			desc.MipLevels = 0;
-			desc.ArraySize = 1;
-			desc.Format = FORMAT_R8G8B8A8_UNORM;
-			desc.SampleCount = 1;
-			desc.Usage = USAGE_DEFAULT;
-			desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-
-			device->CreateTexture(&desc, nullptr, &decalAtlas);
-			device->SetName(&decalAtlas, "decalAtlas");
+			++it;
+		}
+	}
+	for (auto it = failedDecals.begin(); it != failedDecals.end();)
+	{
+		if (usedDecalTextures.count(*it) == 0)
+		{
+			it = failedDecals.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
 
-			for (uint32_t i = 0; i < decalAtlas.GetDesc().MipLevels; ++i)
+	// Allocate atlas regions for new decal textures, only these will need to be copied into the atlas
+	//	The ones that didn't fit before are only retried when regions were freed:
+	for (const Texture* texture : usedDecalTextures)
+	{
+		if (packedDecals.find(texture) == packedDecals.end() && (freed || failedDecals.count(texture) == 0))
+		{
+			if (InsertAtlasRegion(decalAtlasAllocator, packedDecals, failedDecals, defragmented, texture))
+			{
+				repackAtlas_Decal = true;
+			}
+			else if (packedDecals.count(texture) > 0)
 			{
-				int subresource_index;
-				subresource_index = device->CreateSubresource(&decalAtlas, UAV, 0, 1, i, 1);
-				assert(subresource_index == i);
+				decalsToRefresh.push_back(texture);
 			}
 		}
-		else
+	}
+
+	// Update atlas texture if it needs to be resized:
+	GraphicsDevice* device = GetDevice();
+	if (!packedDecals.empty() && (!decalAtlas.IsValid() || decalAtlas.GetDesc().Width != decalAtlasAllocator.GetWidth() || decalAtlas.GetDesc().Height != decalAtlasAllocator.GetHeight()))
+	{
+		TextureDesc desc;
+		desc.Width = decalAtlasAllocator.GetWidth();
+		desc.Height = decalAtlasAllocator.GetHeight();
+		desc.MipLevels = 0;
+		desc.ArraySize = 1;
+		desc.Format = FORMAT_R8G8B8A8_UNORM;
+		desc.SampleCount = 1;
+		desc.Usage = USAGE_DEFAULT;
+		desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+
+		device->CreateTexture(&desc, nullptr, &decalAtlas);
+		device->SetName(&decalAtlas, "decalAtlas");
+
+		for (uint32_t i = 0; i < decalAtlas.GetDesc().MipLevels; ++i)
 		{
-			wiBackLog::post("Decal atlas packing failed!");
+			int subresource_index;
+			subresource_index = device->CreateSubresource(&decalAtlas, UAV, 0, 1, i, 1);
+			assert(subresource_index == i);
 		}
+
+		// The new atlas texture is empty, so every region must be copied:
+		repackAtlas_Decal = true;
 	}
 
 	// Assign atlas buckets to decals:
@@ -7678,11 +7978,12 @@ void ManageDecalAtlas()
 	{
 		DecalComponent& decal = scene.decals[i];
 
-		if (decal.texture != nullptr)
+		auto it = decal.texture == nullptr ? packedDecals.end() : packedDecals.find(decal.texture);
+		if (it != packedDecals.end())
 		{
 			const TextureDesc& desc = decalAtlas.GetDesc();
 
-			rect_xywh rect = packedDecals[decal.texture];
+			rect_xywh rect = it->second;
 
 			// eliminate border expansion:
 			rect.x += atlasClampBorder;
@@ -7709,6 +8010,7 @@ void RefreshDecalAtlas(CommandList cmd)
 
 	if (repackAtlas_Decal)
 	{
+		// If atlas was recreated or defragmented, we copy every decal texture:
 		for (uint32_t mip = 0; mip < decalAtlas.GetDesc().MipLevels; ++mip)
 		{
 			for (auto& it : packedDecals)
@@ -7720,14 +8022,44 @@ void RefreshDecalAtlas(CommandList cmd)
 			}
 		}
 	}
+	else if (!decalsToRefresh.empty())
+	{
+		// Otherwise only the newly inserted decal textures are copied:
+		for (uint32_t mip = 0; mip < decalAtlas.GetDesc().MipLevels; ++mip)
+		{
+			for (const Texture* texture : decalsToRefresh)
+			{
+				const rect_xywh& rect = packedDecals.at(texture);
+				if (mip < texture->GetDesc().MipLevels)
+				{
+					CopyTexture2D(decalAtlas, mip, (rect.x >> mip) + atlasClampBorder, (rect.y >> mip) + atlasClampBorder, *texture, mip, cmd, BORDEREXPAND_CLAMP);
+				}
+			}
+		}
+	}
 }
 
 bool repackAtlas_Lightmap = false;
 vector<uint32_t> lightmapsToRefresh;
+static bool lightmapAtlasFreed = false; // regions were freed, the failed lightmaps are retried in the next frame
+static void RemoveLightmapAtlasRegion(const Texture* lightmap)
+{
+	auto it = packedLightmaps.find(lightmap);
+	if (it != packedLightmaps.end())
+	{
+		lightmapAtlasAllocator.Free(it->second);
+		packedLightmaps.erase(it);
+		lightmapAtlasFreed = true;
+	}
+	failedLightmaps.erase(lightmap);
+}
 void ManageLightmapAtlas()
 {
 	lightmapsToRefresh.clear(); 
 	repackAtlas_Lightmap = false;
+	bool defragmented = false;
+	const bool retryFailed = lightmapAtlasFreed;
+	lightmapAtlasFreed = false;
 
 	Scene& scene = GetScene();
 	GraphicsDevice* device = GetDevice();
@@ -7744,9 +8076,8 @@ void ManageLightmapAtlas()
 		{
 			// If we get here, it means that the lightmap GPU texture contains the rendered lightmap, but the CPU-side data was erased.
 			//	In this case, we delete the GPU side lightmap data from the object and the atlas too.
-			packedLightmaps.erase(object.lightmap.get());
+			RemoveLightmapAtlasRegion(object.lightmap.get());
 			object.lightmap.reset(nullptr);
-			repackAtlas_Lightmap = true;
 			refresh = false;
 		}
 
@@ -7758,7 +8089,7 @@ void ManageLightmapAtlas()
 			{
 				if (object.lightmap != nullptr)
 				{
-					packedLightmaps.erase(object.lightmap.get());
+					RemoveLightmapAtlasRegion(object.lightmap.get());
 				}
 
 				{
@@ -7804,13 +8135,14 @@ void ManageLightmapAtlas()
 
 		if (object.lightmap != nullptr)
 		{
-			if (packedLightmaps.find(object.lightmap.get()) == packedLightmaps.end())
+			if (packedLightmaps.find(object.lightmap.get()) == packedLightmaps.end() && (retryFailed || failedLightmaps.count(object.lightmap.get()) == 0))
 			{
-				// we need to pack this lightmap texture into the atlas
-				rect_xywh newRect = rect_xywh(0, 0, object.lightmap->GetDesc().Width + atlasClampBorder * 2, object.lightmap->GetDesc().Height + atlasClampBorder * 2);
-				packedLightmaps[object.lightmap.get()] = newRect;
-
-				repackAtlas_Lightmap = true;
+				// we need to pack this lightmap texture into the atlas, other lightmaps keep their place unless the atlas had to be defragmented
+				//	the ones that didn't fit before are only retried when regions were freed
+				if (InsertAtlasRegion(lightmapAtlasAllocator, packedLightmaps, failedLightmaps, defragmented, object.lightmap.get()))
+				{
+					repackAtlas_Lightmap = true;
+				}
 				refresh = true;
 			}
 		}
@@ -7823,44 +8155,62 @@ void ManageLightmapAtlas()
 
 	}
 
-	// Update atlas texture if it is invalidated:
-	using namespace wiRectPacker;
-	if (repackAtlas_Lightmap && !packedLightmaps.empty())
+	// Release atlas regions of lightmaps whose objects were removed:
+	if (!packedLightmaps.empty() || !failedLightmaps.empty())
 	{
-		vector<rect_xywh*> out_rects(packedLightmaps.size());
-		int i = 0;
-		for (auto& it : packedLightmaps)
+		unordered_set<const Texture*> usedLightmaps;
+		for (size_t i = 0; i < scene.objects.GetCount(); ++i)
 		{
-			out_rects[i] = &it.second;
-			i++;
+			usedLightmaps.insert(scene.objects[i].lightmap.get());
 		}
-
-		std::vector<bin> bins;
-		if (pack(out_rects.data(), (int)packedLightmaps.size(), 16384, bins))
+		for (auto it = packedLightmaps.begin(); it != packedLightmaps.end();)
 		{
-			assert(bins.size() == 1 && "The regions won't fit into the texture!");
-
-			TextureDesc desc;
-			desc.Width = (uint32_t)bins[0].size.w;
-			desc.Height = (uint32_t)bins[0].size.h;
-			desc.MipLevels = 1;
-			desc.ArraySize = 1;
-			desc.Format = FORMAT_R11G11B10_FLOAT;
-			desc.SampleCount = 1;
-			desc.Usage = USAGE_DEFAULT;
-			desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
-			desc.CPUAccessFlags = 0;
-			desc.MiscFlags = 0;
-
-			device->CreateTexture(&desc, nullptr, &globalLightmap);
-			device->SetName(&globalLightmap, "globalLightmap");
+			if (usedLightmaps.count(it->first) == 0)
+			{
+				lightmapAtlasAllocator.Free(it->second);
+				it = packedLightmaps.erase(it);
+				lightmapAtlasFreed = true;
+			}
+			else
+			{
+				++it;
+			}
 		}
-		else
+		for (auto it = failedLightmaps.begin(); it != failedLightmaps.end();)
 		{
-			wiBackLog::post("Global Lightmap atlas packing failed!");
+			if (usedLightmaps.count(*it) == 0)
+			{
+				it = failedLightmaps.erase(it);
+			}
+			else
+			{
+				++it;
+			}
 		}
 	}
 
+	// Update atlas texture if it needs to be resized:
+	if (!packedLightmaps.empty() && (!globalLightmap.IsValid() || globalLightmap.GetDesc().Width != lightmapAtlasAllocator.GetWidth() || globalLightmap.GetDesc().Height != lightmapAtlasAllocator.GetHeight()))
+	{
+		TextureDesc desc;
+		desc.Width = lightmapAtlasAllocator.GetWidth();
+		desc.Height = lightmapAtlasAllocator.GetHeight();
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.Format = FORMAT_R11G11B10_FLOAT;
+		desc.SampleCount = 1;
+		desc.Usage = USAGE_DEFAULT;
+		desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+
+		device->CreateTexture(&desc, nullptr, &globalLightmap);
+		device->SetName(&globalLightmap, "globalLightmap");
+
+		// The new atlas texture is empty, so every lightmap must be copied:
+		repackAtlas_Lightmap = true;
+	}
+
 	// Assign atlas buckets to objects:
 	if (!packedLightmaps.empty())
 	{
@@ -7925,18 +8275,24 @@ void RenderObjectLightMap(const ObjectComponent& object, CommandList cmd)
 	volatile InstancePrev* instance = (volatile InstancePrev*)mem.data;
 	instance->Create(transform.world);
 
+	VertexStreamCB vscb;
+	const GPUResource* vertexStreams[] = {
+		mesh.GetBasePositionStream(vscb.xPositionStream),
+	};
+	vscb.xPrevPositionStream = vscb.xPositionStream;
+	device->UpdateBuffer(&constantBuffers[CBTYPE_VERTEXSTREAM], &vscb, cmd);
+	device->BindConstantBuffer(VS, &constantBuffers[CBTYPE_VERTEXSTREAM], CB_GETBINDSLOT(VertexStreamCB), cmd);
+	device->BindResources(VS, vertexStreams, TEXSLOT_RENDERER_VERTEX_POS, arraysize(vertexStreams), cmd);
+
 	const GPUBuffer* vbs[] = {
-		mesh.vertexBuffer_POS.get(),
 		mesh.vertexBuffer_ATL.get(),
 		mem.buffer,
 	};
 	uint32_t strides[] = {
-		sizeof(MeshComponent::Vertex_POS),
 		sizeof(MeshComponent::Vertex_TEX),
 		sizeof(InstancePrev),
 	};
 	uint32_t offsets[] = {
-		0,
 		0,
 		mem.offset,
 	};
@@ -7961,7 +8317,7 @@ void RenderObjectLightMap(const ObjectComponent& object, CommandList cmd)
 	device->BindConstantBuffer(PS, &constantBuffers[CBTYPE_RAYTRACE], CB_GETBINDSLOT(RaytracingCB), cmd);
 
 	device->BindPipelineState(&PSO_renderlightmap, cmd);
-	device->DrawIndexedInstanced((uint32_t)mesh.indices.size(), 1, 0, 0, 0, cmd);
+	device->DrawIndexedInstanced(mesh.GetBaseIndexCount(), 1, 0, 0, 0, cmd);
 
 	device->RenderPassEnd(cmd);
 
@@ -8002,11 +8358,11 @@ void RefreshLightmapAtlas(CommandList cmd)
 			device->EventBegin("PackGlobalLightmap", cmd);
 			if (repackAtlas_Lightmap)
 			{
-				// If atlas was repacked, we copy every object lightmap:
+				// If atlas was recreated or defragmented, we copy every object lightmap:
 				for (size_t i = 0; i < scene.objects.GetCount(); ++i)
 				{
 					const ObjectComponent& object = scene.objects[i];
-					if (object.lightmap != nullptr)
+					if (object.lightmap != nullptr && packedLightmaps.count(object.lightmap.get()) > 0)
 					{
 						const auto& rec = packedLightmaps.at(object.lightmap.get());
 						CopyTexture2D(globalLightmap, 0, rec.x + atlasClampBorder, rec.y + atlasClampBorder, *object.lightmap.get(), 0, cmd);
@@ -8019,8 +8375,11 @@ void RefreshLightmapAtlas(CommandList cmd)
 				for (uint32_t objectIndex : lightmapsToRefresh)
 				{
 					const ObjectComponent& object = scene.objects[objectIndex];
-					const auto& rec = packedLightmaps.at(object.lightmap.get());
-					CopyTexture2D(globalLightmap, 0, rec.x + atlasClampBorder, rec.y + atlasClampBorder, *object.lightmap.get(), 0, cmd);
+					if (object.lightmap != nullptr && packedLightmaps.count(object.lightmap.get()) > 0)
+					{
+						const auto& rec = packedLightmaps.at(object.lightmap.get());
+						CopyTexture2D(globalLightmap, 0, rec.x + atlasClampBorder, rec.y + atlasClampBorder, *object.lightmap.get(), 0, cmd);
+					}
 				}
 			}
 			device->EventEnd(cmd);
@@ -8040,6 +8399,13 @@ const Texture* GetGlobalLightmap()
 	return wiTextureHelper::getTransparent();
 }
 
+void BindVirtualTextureFeedback(CommandList cmd)
+{
+	if (virtualTextureFeedback.IsValid())
+	{
+		GetDevice()->BindUAV(PS, virtualTextureFeedback.GetBuffer(), UAVSLOT_RENDERER_VIRTUALTEXTURE_FEEDBACK, cmd);
+	}
+}
 void BindCommonResources(CommandList cmd)
 {
 	GraphicsDevice* device = GetDevice();
@@ -8182,6 +8548,18 @@ void UpdateFrameCB(CommandList cmd)
 	cb.g_xFrame_WorldBoundsExtents_rcp.y = 1.0f / cb.g_xFrame_WorldBoundsExtents.y;
 	cb.g_xFrame_WorldBoundsExtents_rcp.z = 1.0f / cb.g_xFrame_WorldBoundsExtents.z;
 
+	cb.g_xFrame_EntityClusterCount = XMUINT3(0, 0, 0);
+	cb.g_xFrame_EntityClusterSliceScale = 0;
+	cb.g_xFrame_EntityClusterSliceBias = 0;
+	cb.g_xFrame_EntityClusterTileSize_rcp = float2(0, 0);
+	if (entityClustersValid)
+	{
+		cb.g_xFrame_EntityClusterCount = XMUINT3(entityClusters.tileCountX, entityClusters.tileCountY, entityClusters.sliceCount);
+		cb.g_xFrame_EntityClusterSliceScale = entityClusters.sliceScale;
+		cb.g_xFrame_EntityClusterSliceBias = entityClusters.sliceBias;
+		cb.g_xFrame_EntityClusterTileSize_rcp = float2((float)entityClusters.tileCountX / cb.g_xFrame_InternalResolution.x, (float)entityClusters.tileCountY / cb.g_xFrame_InternalResolution.y);
+	}
+
 	GetDevice()->UpdateBuffer(&constantBuffers[CBTYPE_FRAME], &cb, cmd);
 }
 void UpdateCameraCB(const CameraComponent& camera, CommandList cmd)
@@ -9954,6 +10332,8 @@ void SetDebugLightCulling(bool enabled) { debugLightCulling = enabled; }
 bool GetDebugLightCulling() { return debugLightCulling; }
 void SetAdvancedLightCulling(bool enabled) { advancedLightCulling = enabled; }
 bool GetAdvancedLightCulling() { return advancedLightCulling; }
+void SetClusteredLightCullingEnabled(bool enabled) { clusteredLightCulling = enabled; }
+bool GetClusteredLightCullingEnabled() { return clusteredLightCulling; }
 void SetAlphaCompositionEnabled(bool enabled) { ALPHACOMPOSITIONENABLED = enabled; }
 bool GetAlphaCompositionEnabled() { return ALPHACOMPOSITIONENABLED; }
 void SetOcclusionCullingEnabled(bool value)
@@ -10034,5 +10414,21 @@ bool GetRaytraceDebugBVHVisualizerEnabled()
 {
 	return raytraceDebugVisualizer;
 }
+void SetLODPixelThreshold(float pixels)
+{
+	LODPixelThreshold = pixels;
+}
+float GetLODPixelThreshold()
+{
+	return LODPixelThreshold;
+}
+void SetMeshletCullingEnabled(bool value)
+{
+	meshletCulling = value;
+}
+bool GetMeshletCullingEnabled()
+{
+	return meshletCulling;
+}
 
 }
@@ -73,6 +73,8 @@ namespace wiRenderer
 
 	// Binds all common constant buffers and samplers that may be used in all shaders
 	void BindCommonResources(wiGraphics::CommandList cmd);
+	// Binds the virtual texture feedback buffer for the object pixel shaders, call it before beginning the render pass of the main scene
+	void BindVirtualTextureFeedback(wiGraphics::CommandList cmd);
 	// Updates the per frame constant buffer (need to call at least once per frame)
 	void UpdateFrameCB(wiGraphics::CommandList cmd);
 	// Updates the per camera constant buffer need to call for each different camera that is used when calling DrawScene() and the like
@@ -419,6 +421,9 @@ namespace wiRenderer
 	bool GetDebugLightCulling();
 	void SetAdvancedLightCulling(bool enabled);
 	bool GetAdvancedLightCulling();
+	// Forward rendering will use entity clusters computed on the CPU instead of per draw call entity masks (lifts the 64 light limit)
+	void SetClusteredLightCullingEnabled(bool enabled);
+	bool GetClusteredLightCullingEnabled();
 	void SetAlphaCompositionEnabled(bool enabled);
 	bool GetAlphaCompositionEnabled();
 	void SetOcclusionCullingEnabled(bool enabled);
@@ -459,6 +464,12 @@ namespace wiRenderer
 	uint32_t GetRaytraceBounceCount();
 	void SetRaytraceDebugBVHVisualizerEnabled(bool value);
 	bool GetRaytraceDebugBVHVisualizerEnabled();
+	// Meshes with LODs switch to LOD1 when their projected radius is smaller than this (in pixels), every further LOD halves the size (0: disable LODs)
+	void SetLODPixelThreshold(float pixels);
+	float GetLODPixelThreshold();
+	// Cull the meshlets of single instanced meshes on the CPU (meshlets can be created with MeshComponent::CreateMeshlets())
+	void SetMeshletCullingEnabled(bool value);
+	bool GetMeshletCullingEnabled();
 
 	const wiGraphics::Texture* GetGlobalLightmap();
 
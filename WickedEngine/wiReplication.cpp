@@ -0,0 +1,859 @@
+#include "wiReplication.h"
+#include "wiNetwork.h"
+#include "wiTimer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace wiECS;
+using namespace wiScene;
+
+namespace wiReplication
+{
+	// Every datagram is a bit stream that starts with the type and the tick:
+	//	snapshot	: for every slice a 1 bit, the slice index delta, full bit or baseline tick delta, then the slice; a 0 bit at the end
+	//	ack			: the acknowledged slices, then the slices that the client couldn't decode and need a full update
+	enum DATAGRAM_TYPE
+	{
+		DATAGRAM_SNAPSHOT = 1,
+		DATAGRAM_ACK = 2,
+	};
+	static const size_t DATAGRAM_BITS = wiNetwork::PACKET_CAPACITY * 8;
+	static const uint32_t COMPONENT_BITS = 2;
+	static const uint32_t SLICE_OFFSET_BITS = 4;	// log2(SLICE_SIZE)
+	static const uint32_t SLICE_COUNT_BITS = 5;		// log2(SLICE_SIZE) + 1
+	static_assert((1u << SLICE_OFFSET_BITS) == SLICE_SIZE, "SLICE_OFFSET_BITS must match SLICE_SIZE");
+	// Slice index delta, baseline tick delta and the flags, the upper bound of what is written before a slice:
+	static const size_t SLICE_HEADER_BITS = 1 + 34 + 1 + 34;
+	// The client doesn't accept slice indices above this, a corrupted datagram can't make it allocate too much
+	static const uint32_t MAX_SLICES = 1u << 20;
+
+	// Bit packing, the values are written from the least significant bit:
+	class BitWriter
+	{
+		std::vector<uint8_t>& data;
+		uint64_t buffer = 0;
+		uint32_t bitCount = 0;
+	public:
+		BitWriter(std::vector<uint8_t>& data) : data(data) { data.clear(); }
+
+		size_t GetBitCount() const { return data.size() * 8 + bitCount; }
+		void Reset()
+		{
+			data.clear();
+			buffer = 0;
+			bitCount = 0;
+		}
+
+		inline void Write(uint32_t value, uint32_t bits)
+		{
+			buffer |= (uint64_t(value) & ((1ull << bits) - 1)) << bitCount;
+			bitCount += bits;
+			while (bitCount >= 8)
+			{
+				data.push_back(uint8_t(buffer));
+				buffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+		inline void Flush()
+		{
+			if (bitCount > 0)
+			{
+				data.push_back(uint8_t(buffer));
+				buffer = 0;
+				bitCount = 0;
+			}
+		}
+		// Appends the first bits of an other bit stream
+		inline void Append(const std::vector<uint8_t>& other, size_t bits)
+		{
+			size_t i = 0;
+			for (; bits >= 8; bits -= 8)
+			{
+				Write(other[i++], 8);
+			}
+			if (bits > 0)
+			{
+				Write(other[i], (uint32_t)bits);
+			}
+		}
+	};
+	class BitReader
+	{
+		const uint8_t* data;
+		size_t dataSize;
+		size_t pos = 0;
+		uint64_t buffer = 0;
+		uint32_t bitCount = 0;
+	public:
+		bool overflow = false;
+
+		BitReader(const uint8_t* data, size_t dataSize) : data(data), dataSize(dataSize) {}
+
+		inline uint32_t Read(uint32_t bits)
+		{
+			while (bitCount < bits)
+			{
+				uint64_t byte = 0;
+				if (pos < dataSize)
+				{
+					byte = data[pos++];
+				}
+				else
+				{
+					overflow = true;
+				}
+				buffer |= byte << bitCount;
+				bitCount += 8;
+			}
+			const uint32_t value = uint32_t(buffer & ((1ull << bits) - 1));
+			buffer >>= bits;
+			bitCount -= bits;
+			return value;
+		}
+	};
+
+	// Small values take less bits, a 2 bit prefix selects the width:
+	static const uint32_t VARIABLE_BITS[] = { 4, 8, 16, 32 };
+	static inline void WriteVariable(BitWriter& writer, uint32_t value)
+	{
+		uint32_t width = 0;
+		while (width < 3 && uint64_t(value) >= (1ull << VARIABLE_BITS[width]))
+		{
+			width++;
+		}
+		writer.Write(width, 2);
+		writer.Write(value, VARIABLE_BITS[width]);
+	}
+	static inline uint32_t ReadVariable(BitReader& reader)
+	{
+		return reader.Read(VARIABLE_BITS[reader.Read(2)]);
+	}
+	// The difference is computed with wrap-around and zigzag encoded, so small negative values are small too:
+	static inline void WriteDelta(BitWriter& writer, int32_t value, int32_t baseline)
+	{
+		const int32_t delta = int32_t(uint32_t(value) - uint32_t(baseline));
+		WriteVariable(writer, (uint32_t(delta) << 1) ^ uint32_t(delta >> 31));
+	}
+	static inline int32_t ReadDelta(BitReader& reader, int32_t baseline)
+	{
+		const uint32_t zigzag = ReadVariable(reader);
+		const int32_t delta = int32_t(zigzag >> 1) ^ -int32_t(zigzag & 1);
+		return int32_t(uint32_t(baseline) + uint32_t(delta));
+	}
+
+	static inline int32_t QuantizePosition(float value)
+	{
+		const float scaled = std::max(-2.0e9f, std::min(2.0e9f, value / POSITION_PRECISION));
+		return (int32_t)std::floor(scaled + 0.5f);
+	}
+	static inline float DequantizePosition(int32_t value)
+	{
+		return value * POSITION_PRECISION;
+	}
+
+	// "Smallest three": the largest component is left out and recomputed from the other three which are in [-1/sqrt(2), 1/sqrt(2)]
+	//	2 bits of index and 3 * 10 bits of components
+	static const float ROTATION_RANGE = 0.707107f;
+	static const float ROTATION_STEPS = 1023.0f;
+	static uint32_t QuantizeRotation(const XMFLOAT4& rotation)
+	{
+		float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+		const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		if (length < 1e-6f)
+		{
+			q[0] = q[1] = q[2] = 0;
+			q[3] = 1;
+		}
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < 4; ++i)
+		{
+			if (std::abs(q[i]) > std::abs(q[largest]))
+			{
+				largest = i;
+			}
+		}
+		// q and -q are the same rotation, so the left out component is always positive:
+		const float sign = q[largest] < 0 ? -1.0f : 1.0f;
+		const float scale = length < 1e-6f ? 1 : sign / length;
+		uint32_t result = largest << 30;
+		uint32_t shift = 20;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+			{
+				continue;
+			}
+			const float normalized = std::max(-1.0f, std::min(1.0f, q[i] * scale / ROTATION_RANGE));
+			result |= uint32_t((normalized * 0.5f + 0.5f) * ROTATION_STEPS + 0.5f) << shift;
+			shift -= 10;
+		}
+		return result;
+	}
+	static XMFLOAT4 DequantizeRotation(uint32_t value)
+	{
+		const uint32_t largest = value >> 30;
+		float q[4];
+		float sum = 0;
+		uint32_t shift = 20;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+			{
+				continue;
+			}
+			q[i] = (((value >> shift) & 1023) / ROTATION_STEPS * 2 - 1) * ROTATION_RANGE;
+			sum += q[i] * q[i];
+			shift -= 10;
+		}
+		q[largest] = std::sqrt(std::max(0.0f, 1 - sum));
+		return XMFLOAT4(q[0], q[1], q[2], q[3]);
+	}
+
+	static inline uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	static inline float BitsFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// The baseline of a new entity, the default values cost only a few bits:
+	static const EntityState& GetDefaultState()
+	{
+		static EntityState state = []() {
+			EntityState state;
+			state.rotation = QuantizeRotation(XMFLOAT4(0, 0, 0, 1));
+			state.scale[0] = state.scale[1] = state.scale[2] = QuantizePosition(1);
+			return state;
+		}();
+		return state;
+	}
+
+	static inline bool IsEqual(const EntityState& a, const EntityState& b)
+	{
+		return
+			a.components == b.components &&
+			a.position[0] == b.position[0] && a.position[1] == b.position[1] && a.position[2] == b.position[2] &&
+			a.rotation == b.rotation &&
+			a.scale[0] == b.scale[0] && a.scale[1] == b.scale[1] && a.scale[2] == b.scale[2] &&
+			memcmp(a.light, b.light, sizeof(a.light)) == 0;
+	}
+
+	// Entity record: components, then for every component group a changed bit and the new values
+	static void EncodeEntity(BitWriter& writer, const EntityState& state, const EntityState& baseline)
+	{
+		writer.Write(state.components, COMPONENT_BITS);
+		if (state.components & COMPONENT_TRANSFORM)
+		{
+			const bool position = memcmp(state.position, baseline.position, sizeof(state.position)) != 0;
+			writer.Write(position ? 1 : 0, 1);
+			if (position)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					WriteDelta(writer, state.position[i], baseline.position[i]);
+				}
+			}
+			const bool rotation = state.rotation != baseline.rotation;
+			writer.Write(rotation ? 1 : 0, 1);
+			if (rotation)
+			{
+				writer.Write(state.rotation, 32);
+			}
+			const bool scale = memcmp(state.scale, baseline.scale, sizeof(state.scale)) != 0;
+			writer.Write(scale ? 1 : 0, 1);
+			if (scale)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					WriteDelta(writer, state.scale[i], baseline.scale[i]);
+				}
+			}
+		}
+		if (state.components & COMPONENT_LIGHT)
+		{
+			const bool light = memcmp(state.light, baseline.light, sizeof(state.light)) != 0;
+			writer.Write(light ? 1 : 0, 1);
+			if (light)
+			{
+				for (uint32_t x : state.light)
+				{
+					writer.Write(x, 32);
+				}
+			}
+		}
+	}
+	static void DecodeEntity(BitReader& reader, EntityState& state, const EntityState& baseline)
+	{
+		const uint32_t id = state.id;
+		state = baseline;
+		state.id = id;
+		state.components = reader.Read(COMPONENT_BITS);
+		if (state.components & COMPONENT_TRANSFORM)
+		{
+			if (reader.Read(1))
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					state.position[i] = ReadDelta(reader, baseline.position[i]);
+				}
+			}
+			if (reader.Read(1))
+			{
+				state.rotation = reader.Read(32);
+			}
+			if (reader.Read(1))
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					state.scale[i] = ReadDelta(reader, baseline.scale[i]);
+				}
+			}
+		}
+		if (state.components & COMPONENT_LIGHT)
+		{
+			if (reader.Read(1))
+			{
+				for (uint32_t& x : state.light)
+				{
+					x = reader.Read(32);
+				}
+			}
+		}
+	}
+
+	// Returns the range of the entities of a slice in a sorted entity array
+	static inline std::pair<const EntityState*, const EntityState*> FindSlice(const std::vector<EntityState>& entities, uint32_t slice)
+	{
+		auto compare = [](const EntityState& state, uint32_t id) { return state.id < id; };
+		const EntityState* begin = entities.data();
+		const EntityState* end = begin + entities.size();
+		const EntityState* first = std::lower_bound(begin, end, slice * SLICE_SIZE, compare);
+		const EntityState* last = std::lower_bound(first, end, (slice + 1) * SLICE_SIZE, compare);
+		return std::make_pair(first, last);
+	}
+
+	// Slice: mask of the removed entities, then the records of the new and changed entities with their offset in the slice
+	//	returns false without writing anything if the slice is the same as the baseline
+	static bool EncodeSlice(BitWriter& writer, uint32_t slice, const EntityState* state, const EntityState* state_end, const EntityState* base, const EntityState* base_end)
+	{
+		uint32_t removedMask = 0;
+		uint32_t changedCount = 0;
+		std::pair<const EntityState*, const EntityState*> changed[SLICE_SIZE];
+		for (; state != state_end; ++state)
+		{
+			while (base != base_end && base->id < state->id)
+			{
+				removedMask |= 1u << (base->id - slice * SLICE_SIZE);
+				base++;
+			}
+			if (base != base_end && base->id == state->id)
+			{
+				if (!IsEqual(*state, *base))
+				{
+					changed[changedCount++] = std::make_pair(state, base);
+				}
+				base++;
+			}
+			else
+			{
+				changed[changedCount++] = std::make_pair(state, &GetDefaultState());
+			}
+		}
+		for (; base != base_end; ++base)
+		{
+			removedMask |= 1u << (base->id - slice * SLICE_SIZE);
+		}
+		if (removedMask == 0 && changedCount == 0)
+		{
+			return false;
+		}
+
+		writer.Write(removedMask != 0 ? 1 : 0, 1);
+		if (removedMask != 0)
+		{
+			writer.Write(removedMask, SLICE_SIZE);
+		}
+		writer.Write(changedCount, SLICE_COUNT_BITS);
+		for (uint32_t i = 0; i < changedCount; ++i)
+		{
+			writer.Write(changed[i].first->id - slice * SLICE_SIZE, SLICE_OFFSET_BITS);
+			EncodeEntity(writer, *changed[i].first, *changed[i].second);
+		}
+		return true;
+	}
+	// The baseline can be null for a full slice
+	static void DecodeSlice(BitReader& reader, uint32_t slice, const std::vector<EntityState>* baseline, std::vector<EntityState>& result)
+	{
+		result.clear();
+		const uint32_t removedMask = reader.Read(1) ? reader.Read(SLICE_SIZE) : 0;
+		const uint32_t changedCount = std::min(SLICE_SIZE, reader.Read(SLICE_COUNT_BITS));
+
+		const EntityState* base = baseline == nullptr ? nullptr : baseline->data();
+		const EntityState* base_end = baseline == nullptr ? nullptr : base + baseline->size();
+		auto copy_until = [&](uint32_t id) {
+			for (; base != base_end && base->id < id; ++base)
+			{
+				if ((removedMask & (1u << (base->id - slice * SLICE_SIZE))) == 0)
+				{
+					result.push_back(*base);
+				}
+			}
+		};
+
+		for (uint32_t i = 0; i < changedCount; ++i)
+		{
+			const uint32_t id = slice * SLICE_SIZE + reader.Read(SLICE_OFFSET_BITS);
+			copy_until(id);
+			const EntityState* entityBaseline = &GetDefaultState();
+			if (base != base_end && base->id == id)
+			{
+				entityBaseline = base;
+				base++;
+			}
+			result.emplace_back();
+			result.back().id = id;
+			DecodeEntity(reader, result.back(), *entityBaseline);
+		}
+		copy_until((slice + 1) * SLICE_SIZE);
+	}
+
+
+	bool Server::AddEntity(Entity entity)
+	{
+		if (entities.count(entity) > 0)
+		{
+			return false;
+		}
+		const uint32_t id = nextID++;
+		entities[entity] = id;
+		replicated.push_back(std::make_pair(id, entity)); // ids are increasing, it stays sorted
+		return true;
+	}
+	void Server::RemoveEntity(Entity entity)
+	{
+		auto it = entities.find(entity);
+		if (it != entities.end())
+		{
+			auto x = std::lower_bound(replicated.begin(), replicated.end(), std::make_pair(it->second, INVALID_ENTITY));
+			replicated.erase(x);
+			entities.erase(it);
+		}
+	}
+	uint32_t Server::GetID(Entity entity) const
+	{
+		auto it = entities.find(entity);
+		return it == entities.end() ? 0 : it->second;
+	}
+
+	uint32_t Server::AddClient()
+	{
+		for (uint32_t i = 0; i < (uint32_t)clients.size(); ++i)
+		{
+			if (!clients[i].active)
+			{
+				clients[i] = ClientState();
+				clients[i].active = true;
+				return i;
+			}
+		}
+		clients.emplace_back();
+		clients.back().active = true;
+		return (uint32_t)clients.size() - 1;
+	}
+	void Server::RemoveClient(uint32_t client)
+	{
+		if (client < clients.size())
+		{
+			clients[client] = ClientState();
+		}
+	}
+
+	void Server::Capture(const Scene& scene)
+	{
+		tick++;
+		Snapshot& snapshot = history[tick % SNAPSHOT_HISTORY];
+		snapshot.tick = tick;
+		snapshot.entities.clear();
+		snapshot.entities.reserve(replicated.size());
+
+		for (auto& x : replicated)
+		{
+			EntityState state;
+			state.id = x.first;
+			if (components & COMPONENT_TRANSFORM)
+			{
+				const TransformComponent* transform = scene.transforms.GetComponent(x.second);
+				if (transform != nullptr)
+				{
+					state.components |= COMPONENT_TRANSFORM;
+					state.position[0] = QuantizePosition(transform->translation_local.x);
+					state.position[1] = QuantizePosition(transform->translation_local.y);
+					state.position[2] = QuantizePosition(transform->translation_local.z);
+					state.rotation = QuantizeRotation(transform->rotation_local);
+					state.scale[0] = QuantizePosition(transform->scale_local.x);
+					state.scale[1] = QuantizePosition(transform->scale_local.y);
+					state.scale[2] = QuantizePosition(transform->scale_local.z);
+				}
+			}
+			if (components & COMPONENT_LIGHT)
+			{
+				const LightComponent* light = scene.lights.GetComponent(x.second);
+				if (light != nullptr)
+				{
+					state.components |= COMPONENT_LIGHT;
+					state.light[0] = FloatBits(light->color.x);
+					state.light[1] = FloatBits(light->color.y);
+					state.light[2] = FloatBits(light->color.z);
+					state.light[3] = FloatBits(light->energy);
+					state.light[4] = FloatBits(light->range_local);
+				}
+			}
+			if (state.components != 0)
+			{
+				snapshot.entities.push_back(state);
+			}
+		}
+	}
+
+	void Server::Send(uint32_t client, const SendCallback& send)
+	{
+		if (client >= clients.size() || !clients[client].active || tick == 0)
+		{
+			return;
+		}
+		ClientState& state = clients[client];
+
+		wiTimer timer;
+		timer.record();
+
+		const Snapshot& snapshot = history[tick % SNAPSHOT_HISTORY];
+		const uint32_t sliceCount = snapshot.entities.empty() ? 0 : snapshot.entities.back().id / SLICE_SIZE + 1;
+		if (state.slices.size() < sliceCount)
+		{
+			state.slices.resize(sliceCount);
+		}
+
+		BitWriter writer(datagram);
+		uint32_t prevSlice = 0;
+		auto begin_datagram = [&]() {
+			writer.Reset();
+			writer.Write(DATAGRAM_SNAPSHOT, 8);
+			writer.Write(tick, 32);
+			prevSlice = 0;
+		};
+		auto end_datagram = [&]() {
+			writer.Write(0, 1);
+			writer.Flush();
+			send(datagram.data(), datagram.size());
+			state.statistics.datagrams++;
+			state.statistics.bytes += datagram.size();
+		};
+		begin_datagram();
+		bool empty = true;
+
+		const EntityState* state_begin = snapshot.entities.data();
+		const EntityState* state_end = state_begin + snapshot.entities.size();
+		for (uint32_t i = 0; i < (uint32_t)state.slices.size(); ++i)
+		{
+			// The entities of the slice are consecutive in the sorted snapshot:
+			const EntityState* slice_end = state_begin;
+			while (slice_end != state_end && slice_end->id < (i + 1) * SLICE_SIZE)
+			{
+				slice_end++;
+			}
+			const SliceBaseline& baseline = state.slices[i];
+			const EntityState* base = baseline.entities.data();
+			BitWriter sliceWriter(slice);
+			const bool changed = EncodeSlice(sliceWriter, i, state_begin, slice_end, base, base + baseline.entities.size());
+			state_begin = slice_end;
+			if (!changed)
+			{
+				continue;
+			}
+			const size_t sliceBits = sliceWriter.GetBitCount();
+			sliceWriter.Flush();
+
+			if (writer.GetBitCount() + SLICE_HEADER_BITS + sliceBits + 1 > DATAGRAM_BITS)
+			{
+				end_datagram();
+				begin_datagram();
+			}
+			writer.Write(1, 1);
+			WriteVariable(writer, i - prevSlice);
+			prevSlice = i;
+			writer.Write(baseline.tick == 0 ? 1 : 0, 1);
+			if (baseline.tick != 0)
+			{
+				WriteVariable(writer, tick - baseline.tick);
+			}
+			writer.Append(slice, sliceBits);
+			empty = false;
+
+			state.statistics.slices++;
+			if (baseline.tick == 0)
+			{
+				state.statistics.fullSlices++;
+			}
+		}
+		if (!empty)
+		{
+			end_datagram();
+		}
+
+		state.statistics.time += timer.elapsed();
+	}
+
+	void Server::Receive(uint32_t client, const void* data, size_t dataSize)
+	{
+		if (client >= clients.size() || !clients[client].active)
+		{
+			return;
+		}
+		ClientState& state = clients[client];
+
+		BitReader reader((const uint8_t*)data, dataSize);
+		if (reader.Read(8) != DATAGRAM_ACK)
+		{
+			return;
+		}
+		const uint32_t ackedTick = reader.Read(32);
+		const Snapshot& snapshot = history[ackedTick % SNAPSHOT_HISTORY];
+		const bool known = ackedTick != 0 && snapshot.tick == ackedTick;
+
+		// The acknowledged slice versions become the new baselines:
+		uint32_t slice = 0;
+		const uint32_t acknowledgedCount = ReadVariable(reader);
+		for (uint32_t i = 0; i < acknowledgedCount && !reader.overflow; ++i)
+		{
+			slice += ReadVariable(reader);
+			if (known && slice < state.slices.size() && ackedTick > state.slices[slice].tick)
+			{
+				SliceBaseline& baseline = state.slices[slice];
+				auto range = FindSlice(snapshot.entities, slice);
+				baseline.tick = ackedTick;
+				baseline.entities.assign(range.first, range.second);
+			}
+		}
+
+		// The client lost the baseline of these slices, they are sent in full:
+		slice = 0;
+		const uint32_t resetCount = ReadVariable(reader);
+		for (uint32_t i = 0; i < resetCount && !reader.overflow; ++i)
+		{
+			slice += ReadVariable(reader);
+			if (slice < state.slices.size())
+			{
+				state.slices[slice] = SliceBaseline();
+			}
+		}
+	}
+
+
+	void Client::Receive(const void* data, size_t dataSize, const SendCallback& send)
+	{
+		BitReader reader((const uint8_t*)data, dataSize);
+		if (dataSize < 5 || reader.Read(8) != DATAGRAM_SNAPSHOT)
+		{
+			return;
+		}
+		const uint32_t tick = reader.Read(32);
+
+		statistics.datagrams++;
+		statistics.bytes += dataSize;
+
+		wiTimer timer;
+		timer.record();
+
+		acknowledged.clear();
+		resets.clear();
+		uint32_t sliceIndex = 0;
+		while (reader.Read(1) != 0 && !reader.overflow)
+		{
+			sliceIndex += ReadVariable(reader);
+			const bool full = reader.Read(1) != 0;
+			const uint32_t baselineTick = full ? 0 : tick - ReadVariable(reader);
+			if (reader.overflow || sliceIndex >= MAX_SLICES)
+			{
+				break;
+			}
+			if (slices.size() <= sliceIndex)
+			{
+				slices.resize(sliceIndex + 1);
+			}
+			Slice& slice = slices[sliceIndex];
+
+			// The slice is always decoded, because its size is only known after reading it:
+			const std::vector<EntityState>* baseline = nullptr;
+			bool valid = tick > slice.latestTick;
+			if (!full)
+			{
+				auto it = std::find_if(slice.versions.begin(), slice.versions.end(), [&](const SliceVersion& x) {
+					return x.tick == baselineTick;
+				});
+				if (it == slice.versions.end())
+				{
+					if (valid)
+					{
+						resets.push_back(sliceIndex);
+					}
+					valid = false;
+				}
+				else
+				{
+					baseline = &it->entities;
+				}
+			}
+			DecodeSlice(reader, sliceIndex, baseline, decoded);
+			if (reader.overflow || !valid)
+			{
+				continue;
+			}
+
+			// The server never goes back to an older baseline, so the versions before it are not needed any more:
+			auto first = std::find_if(slice.versions.begin(), slice.versions.end(), [&](const SliceVersion& x) {
+				return x.tick >= baselineTick;
+			});
+			slice.versions.erase(slice.versions.begin(), first);
+			if (slice.versions.size() >= SNAPSHOT_HISTORY)
+			{
+				slice.versions.erase(slice.versions.begin());
+			}
+			slice.versions.emplace_back();
+			slice.versions.back().tick = tick;
+			std::swap(slice.versions.back().entities, decoded);
+			slice.latestTick = tick;
+			if (!slice.dirty)
+			{
+				slice.dirty = true;
+				dirtySlices.push_back(sliceIndex);
+			}
+			acknowledged.push_back(sliceIndex);
+
+			statistics.slices++;
+			if (full)
+			{
+				statistics.fullSlices++;
+			}
+		}
+		latestTick = std::max(latestTick, tick);
+		statistics.time += timer.elapsed();
+
+		if (!acknowledged.empty() || !resets.empty())
+		{
+			BitWriter writer(datagram);
+			writer.Write(DATAGRAM_ACK, 8);
+			writer.Write(tick, 32);
+			uint32_t prev = 0;
+			WriteVariable(writer, (uint32_t)acknowledged.size());
+			for (uint32_t x : acknowledged)
+			{
+				WriteVariable(writer, x - prev);
+				prev = x;
+			}
+			prev = 0;
+			WriteVariable(writer, (uint32_t)resets.size());
+			for (uint32_t x : resets)
+			{
+				WriteVariable(writer, x - prev);
+				prev = x;
+			}
+			writer.Flush();
+			send(datagram.data(), datagram.size());
+		}
+	}
+
+	void Client::Apply(Scene& scene)
+	{
+		for (uint32_t sliceIndex : dirtySlices)
+		{
+			Slice& slice = slices[sliceIndex];
+			slice.dirty = false;
+			const std::vector<EntityState>& states = slice.versions.back().entities;
+
+			// Remove the entities that are not in the slice any more, and the components that the entities don't have any more
+			//	(the component mask of an entity is part of its delta, so the removals arrive with the other changes):
+			auto it = states.begin();
+			for (auto& x : slice.applied)
+			{
+				while (it != states.end() && it->id < x.first)
+				{
+					it++;
+				}
+				auto entity = entities.find(x.first);
+				if (entity == entities.end())
+				{
+					continue;
+				}
+				if (it == states.end() || it->id != x.first)
+				{
+					scene.Entity_Remove(entity->second);
+					entities.erase(entity);
+					continue;
+				}
+				const uint32_t removed = x.second & ~it->components;
+				if (removed & COMPONENT_TRANSFORM)
+				{
+					scene.transforms.Remove(entity->second);
+					scene.prev_transforms.Remove(entity->second);
+				}
+				if (removed & COMPONENT_LIGHT)
+				{
+					scene.lights.Remove(entity->second);
+					scene.aabb_lights.Remove(entity->second);
+				}
+			}
+			slice.applied.clear();
+
+			for (const EntityState& state : states)
+			{
+				Entity& entity = entities[state.id];
+				if (entity == INVALID_ENTITY)
+				{
+					entity = CreateEntity();
+				}
+				slice.applied.push_back(std::make_pair(state.id, state.components));
+
+				if (state.components & COMPONENT_TRANSFORM)
+				{
+					TransformComponent* transform = scene.transforms.GetComponent(entity);
+					if (transform == nullptr)
+					{
+						transform = &scene.transforms.Create(entity);
+					}
+					transform->translation_local = XMFLOAT3(DequantizePosition(state.position[0]), DequantizePosition(state.position[1]), DequantizePosition(state.position[2]));
+					transform->rotation_local = DequantizeRotation(state.rotation);
+					transform->scale_local = XMFLOAT3(DequantizePosition(state.scale[0]), DequantizePosition(state.scale[1]), DequantizePosition(state.scale[2]));
+					transform->SetDirty();
+				}
+				if (state.components & COMPONENT_LIGHT)
+				{
+					LightComponent* light = scene.lights.GetComponent(entity);
+					if (light == nullptr)
+					{
+						scene.aabb_lights.Create(entity);
+						light = &scene.lights.Create(entity);
+					}
+					light->color = XMFLOAT3(BitsFloat(state.light[0]), BitsFloat(state.light[1]), BitsFloat(state.light[2]));
+					light->energy = BitsFloat(state.light[3]);
+					light->range_local = BitsFloat(state.light[4]);
+				}
+			}
+		}
+		dirtySlices.clear();
+	}
+
+	Entity Client::GetEntity(uint32_t id) const
+	{
+		auto it = entities.find(id);
+		return it == entities.end() ? INVALID_ENTITY : it->second;
+	}
+}
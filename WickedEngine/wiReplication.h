@@ -0,0 +1,162 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiECS.h"
+#include "wiScene.h"
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+// Scene state replication from a server to many clients over unreliable datagrams (wiNetwork)
+//	The server captures a snapshot of the replicated entities every tick. The entities are grouped into slices by their network id, and every
+//	slice is delta encoded against the last version of that slice which the client acknowledged, so only the changes since then are sent.
+//	The values are quantized and bit packed. A snapshot is split into datagrams of whole slices, every datagram can be decoded on its own,
+//	so a lost datagram only delays the slices that were in it. A lost datagram is never resent, the next snapshot is encoded against
+//	the same older baseline and contains its changes too.
+//
+//	Usage:
+//		server.AddEntity(entity);							// for every entity that should be replicated
+//		server.Capture(scene);								// every tick
+//		server.Send(client, send);							// for every client, send is called with the datagrams
+//		server.Receive(client, data, size);					// with the datagrams that were received from the client (acknowledgements)
+//
+//		client.Receive(data, size, send);					// with the datagrams that were received from the server
+//		client.Apply(scene);								// writes the latest state into the scene of the client
+namespace wiReplication
+{
+	// The component managers that can be replicated:
+	enum COMPONENTS
+	{
+		COMPONENT_TRANSFORM = 1 << 0,	// translation_local, rotation_local, scale_local
+		COMPONENT_LIGHT = 1 << 1,		// color, energy, range_local
+		COMPONENT_ALL = COMPONENT_TRANSFORM | COMPONENT_LIGHT,
+	};
+
+	// Quantization of the positions and scales in world units, the rotations are sent as 32 bit "smallest three" quaternions:
+	static const float POSITION_PRECISION = 1.0f / 1024.0f;
+	// Number of entities in a slice, the entities of a slice always fit into one datagram
+	static const uint32_t SLICE_SIZE = 16;
+	// Number of snapshots that the server keeps for the acknowledgements, and the number of slice versions that the client keeps as baselines
+	static const uint32_t SNAPSHOT_HISTORY = 32;
+
+	// Sends one datagram, for example with wiNetwork::Send() to the connection of the client or server
+	typedef std::function<void(const void* data, size_t dataSize)> SendCallback;
+
+	// Quantized state of one replicated entity
+	struct EntityState
+	{
+		uint32_t id = 0;			// network id, assigned by the server, increasing in the snapshot
+		uint32_t components = 0;	// COMPONENTS that the entity has
+		int32_t position[3] = {};
+		uint32_t rotation = 0;
+		int32_t scale[3] = {};
+		uint32_t light[5] = {};		// color, energy and range, bitwise copies of the floats
+	};
+	struct Snapshot
+	{
+		uint32_t tick = 0;			// 0 is an invalid snapshot
+		std::vector<EntityState> entities;
+	};
+
+	struct Statistics
+	{
+		uint64_t datagrams = 0;
+		uint64_t bytes = 0;
+		uint64_t slices = 0;		// slices that were sent (server) or decoded (client)
+		uint64_t fullSlices = 0;	// slices that had no baseline
+		double time = 0;			// time of encoding (server) or decoding (client) in milliseconds
+	};
+
+	class Server
+	{
+		struct SliceBaseline
+		{
+			uint32_t tick = 0;		// 0 if the client doesn't have the slice
+			std::vector<EntityState> entities;
+		};
+		struct ClientState
+		{
+			bool active = false;
+			std::vector<SliceBaseline> slices;	// the last acknowledged version of every slice
+			Statistics statistics;
+		};
+		std::vector<ClientState> clients;
+
+		std::unordered_map<wiECS::Entity, uint32_t> entities;	// entity -> network id
+		std::vector<std::pair<uint32_t, wiECS::Entity>> replicated;	// sorted by network id, the ids are not reused
+		uint32_t nextID = 1;
+
+		uint32_t tick = 0;
+		Snapshot history[SNAPSHOT_HISTORY];
+		std::vector<uint8_t> datagram;
+		std::vector<uint8_t> slice;
+
+	public:
+		uint32_t components = COMPONENT_ALL;	// the replicated component managers
+
+		// Starts replicating the entity, returns false if it is already replicated
+		bool AddEntity(wiECS::Entity entity);
+		// Stops replicating the entity, it is removed on the clients
+		void RemoveEntity(wiECS::Entity entity);
+		size_t GetEntityCount() const { return entities.size(); }
+		// Returns the network id of a replicated entity, or 0
+		uint32_t GetID(wiECS::Entity entity) const;
+
+		// Returns the index of the new client, it starts with full slices
+		uint32_t AddClient();
+		void RemoveClient(uint32_t client);
+
+		// Takes a snapshot of the replicated entities, it is the next tick
+		//	An entity that doesn't have any of the replicated components (for example because it was removed from the scene) is removed on the clients
+		void Capture(const wiScene::Scene& scene);
+		uint32_t GetTick() const { return tick; }
+
+		// Sends the slices of the latest snapshot that are different from the versions that the client acknowledged
+		void Send(uint32_t client, const SendCallback& send);
+		// Processes a datagram that was received from the client
+		void Receive(uint32_t client, const void* data, size_t dataSize);
+
+		const Statistics& GetStatistics(uint32_t client) const { return clients[client].statistics; }
+	};
+
+	class Client
+	{
+		struct SliceVersion
+		{
+			uint32_t tick = 0;
+			std::vector<EntityState> entities;
+		};
+		struct Slice
+		{
+			uint32_t latestTick = 0;
+			bool dirty = false;					// changed since the last Apply()
+			std::vector<SliceVersion> versions;	// sorted by tick, the last one is the latest
+			std::vector<std::pair<uint32_t, uint32_t>> applied;	// network id and COMPONENTS of the entities that were applied, sorted by id
+		};
+		std::vector<Slice> slices;
+		std::vector<uint32_t> dirtySlices;
+		uint32_t latestTick = 0;
+		std::unordered_map<uint32_t, wiECS::Entity> entities;	// network id -> entity of the client scene
+
+		std::vector<uint32_t> acknowledged;
+		std::vector<uint32_t> resets;
+		std::vector<uint8_t> datagram;
+		std::vector<EntityState> decoded;
+		Statistics statistics;
+
+	public:
+		// Processes a datagram that was received from the server, the acknowledgements are sent back with the send callback
+		void Receive(const void* data, size_t dataSize, const SendCallback& send);
+
+		// Writes the latest received state into the scene, the replicated entities are created and removed as needed
+		//	A component that the server stopped replicating on an entity (for example a removed light) is removed from the entity
+		void Apply(wiScene::Scene& scene);
+
+		// The latest tick that the client received any slice of
+		uint32_t GetLatestTick() const { return latestTick; }
+		// Returns the entity of the client scene that replicates the network id, or INVALID_ENTITY
+		wiECS::Entity GetEntity(uint32_t id) const;
+
+		const Statistics& GetStatistics() const { return statistics; }
+	};
+}
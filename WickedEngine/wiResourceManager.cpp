@@ -2,6 +2,9 @@
 #include "wiRenderer.h"
 #include "wiHelper.h"
 #include "wiTextureHelper.h"
+#include "wiTextureCache.h"
+#include "wiMipGenerator.h"
+#include "wiJobSystem.h"
 
 #include "Utility/stb_image.h"
 #include "Utility/tinyddsloader.h"
@@ -39,7 +42,7 @@ namespace wiResourceManager
 		std::make_pair("WAV", wiResource::SOUND)
 	};
 
-	std::shared_ptr<wiResource> Load(const wiHashString& name)
+	std::shared_ptr<wiResource> Load(const wiHashString& name, uint32_t flags)
 	{
 		locker.lock();
 		std::weak_ptr<wiResource>& weak_resource = resources[name];
@@ -81,12 +84,18 @@ namespace wiResourceManager
 		{
 		case wiResource::IMAGE:
 		{
-			if (!ext.compare(std::string("DDS")))
+			const bool srgb = (flags & LOAD_COLOR) != 0;
+
+			// Image files can be replaced by their block compressed version from the texture cache:
+			//	if the image was decoded by the cache, but it couldn't be block compressed, it is not decoded again below
+			std::vector<uint8_t> ddsData;
+			wiTextureCache::Image decoded;
+			if (!ext.compare(std::string("DDS")) || (wiTextureCache::IsEnabled() && wiTextureCache::GetDDS(nameStr, ddsData, srgb, &decoded)))
 			{
 				// Load dds
 
 				tinyddsloader::DDSFile dds;
-				auto result = dds.Load(nameStr.c_str());
+				auto result = ddsData.empty() ? dds.Load(nameStr.c_str()) : dds.Load(std::move(ddsData));
 
 				if (result == tinyddsloader::Result::Success)
 				{
@@ -94,8 +103,8 @@ namespace wiResourceManager
 					desc.ArraySize = 1;
 					desc.BindFlags = BIND_SHADER_RESOURCE;
 					desc.CPUAccessFlags = 0;
-					desc.Height = dds.GetWidth();
-					desc.Width = dds.GetHeight();
+					desc.Width = dds.GetWidth();
+					desc.Height = dds.GetHeight();
 					desc.Depth = dds.GetDepth();
 					desc.MipLevels = dds.GetMipCount();
 					desc.ArraySize = dds.GetArraySize();
@@ -227,7 +236,16 @@ namespace wiResourceManager
 
 				const int channelCount = 4;
 				int width, height, bpp;
-				unsigned char* rgb = stbi_load(nameStr.c_str(), &width, &height, &bpp, channelCount);
+				unsigned char* rgb = decoded.rgba;
+				if (rgb != nullptr)
+				{
+					width = (int)decoded.width;
+					height = (int)decoded.height;
+				}
+				else
+				{
+					rgb = stbi_load(nameStr.c_str(), &width, &height, &bpp, channelCount);
+				}
 
 				if (rgb != nullptr)
 				{
@@ -240,17 +258,25 @@ namespace wiResourceManager
 					desc.Format = FORMAT_R8G8B8A8_UNORM;
 					desc.Height = static_cast<uint32_t>(height);
 					desc.Width = static_cast<uint32_t>(width);
-					desc.MipLevels = (uint32_t)log2(std::max(width, height));
+					desc.MipLevels = wiMipGenerator::GetMipCount(desc.Width, desc.Height);
 					desc.MiscFlags = 0;
 					desc.Usage = USAGE_DEFAULT;
 
-					uint32_t mipwidth = width;
+					// The full mip chain is generated on the CPU, so the texture is complete when it is created:
+					std::vector<uint8_t> mips;
+					wiMipGenerator::GenerateMipChain(rgb, desc.Width, desc.Height, mips, wiMipGenerator::FILTER_BOX, srgb);
+
+					uint32_t mipwidth = desc.Width;
+					uint32_t mipheight = desc.Height;
+					size_t mipoffset = 0;
 					std::vector<SubresourceData> InitData(desc.MipLevels);
 					for (uint32_t mip = 0; mip < desc.MipLevels; ++mip)
 					{
-						InitData[mip].pSysMem = rgb; // attention! we don't fill the mips here correctly, just always point to the mip0 data by default. Mip levels will be created using compute shader when needed!
+						InitData[mip].pSysMem = mips.data() + mipoffset;
 						InitData[mip].SysMemPitch = static_cast<uint32_t>(mipwidth * channelCount);
+						mipoffset += (size_t)mipwidth * mipheight * channelCount;
 						mipwidth = std::max(1u, mipwidth / 2);
+						mipheight = std::max(1u, mipheight / 2);
 					}
 
 					Texture* image = new Texture;
@@ -266,11 +292,6 @@ namespace wiResourceManager
 						assert(subresource_index == i);
 					}
 
-					if (image != nullptr && image->GetDesc().MipLevels > 1)
-					{
-						wiRenderer::AddDeferredMIPGen(image);
-					}
-
 					success = image;
 				}
 
@@ -299,6 +320,20 @@ namespace wiResourceManager
 		return nullptr;
 	}
 
+	std::vector<std::shared_ptr<wiResource>> LoadBatch(const std::vector<wiHashString>& names, const std::vector<uint32_t>& flags)
+	{
+		std::vector<std::shared_ptr<wiResource>> result(names.size());
+
+		// Load() is thread safe, the file decoding and mip generation of every resource runs on a separate job:
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)names.size(), 1, [&](wiJobDispatchArgs args) {
+			result[args.jobIndex] = Load(names[args.jobIndex], flags.empty() ? LOAD_DEFAULT : flags[args.jobIndex]);
+		});
+		wiJobSystem::Wait(ctx);
+
+		return result;
+	}
+
 	bool Contains(const wiHashString& name)
 	{
 		bool result = false;
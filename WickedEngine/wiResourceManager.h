@@ -7,6 +7,7 @@
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 struct wiResource
 {
@@ -29,8 +30,19 @@ struct wiResource
 
 namespace wiResourceManager
 {
+	enum LOAD_FLAGS
+	{
+		LOAD_DEFAULT = 0,
+		LOAD_COLOR = 1 << 0,	// the image contains sRGB encoded color (base color, emissive...), its mips are filtered in linear space
+	};
+
 	// Load a resource
-	std::shared_ptr<wiResource> Load(const wiHashString& name);
+	//	flags	: combination of LOAD_FLAGS, they are only used when the resource is not loaded yet
+	std::shared_ptr<wiResource> Load(const wiHashString& name, uint32_t flags = LOAD_DEFAULT);
+	// Load multiple resources in parallel with the wiJobSystem
+	//	flags	: LOAD_FLAGS for every name, or empty to use LOAD_DEFAULT for all of them
+	//	returns the resources in the same order as the names (nullptr if a resource couldn't be loaded)
+	std::vector<std::shared_ptr<wiResource>> LoadBatch(const std::vector<wiHashString>& names, const std::vector<uint32_t>& flags = {});
 	// Check if a resource is currently loaded
 	bool Contains(const wiHashString& name);
 	// Register a pre-created resource
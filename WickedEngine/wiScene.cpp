@@ -7,6 +7,8 @@
 #include "wiRenderer.h"
 #include "wiJobSystem.h"
 #include "wiSpinlock.h"
+#include "wiMeshOptimizer.h"
+#include "ShaderInterop_VertexQuantization.h"
 
 #include <functional>
 #include <unordered_map>
@@ -290,7 +292,7 @@ namespace wiScene
 		retVal.parallaxOcclusionMapping = parallaxOcclusionMapping;
 		retVal.displacementMapping = displacementMapping;
 		retVal.useVertexColors = IsUsingVertexColors() ? 1 : 0;
-		retVal.uvset_baseColorMap = baseColorMap == nullptr ? -1 : (int)uvset_baseColorMap;
+		retVal.uvset_baseColorMap = baseColorMap == nullptr && virtualTexture == nullptr ? -1 : (int)uvset_baseColorMap;
 		retVal.uvset_surfaceMap = surfaceMap == nullptr ? -1 : (int)uvset_surfaceMap;
 		retVal.uvset_normalMap = normalMap == nullptr ? -1 : (int)uvset_normalMap;
 		retVal.uvset_displacementMap = displacementMap == nullptr ? -1 : (int)uvset_displacementMap;
@@ -299,6 +301,23 @@ namespace wiScene
 		retVal.specularGlossinessWorkflow = IsUsingSpecularGlossinessWorkflow() ? 1 : 0;
 		retVal.occlusion_primary = IsOcclusionEnabled_Primary() ? 1 : 0;
 		retVal.occlusion_secondary = IsOcclusionEnabled_Secondary() ? 1 : 0;
+		retVal.virtualTextureID = 0;
+		retVal.virtualTextureSize = XMUINT2(0, 0);
+		retVal.virtualTexturePageSize = 0;
+		retVal.virtualTextureBorder = 0;
+		retVal.virtualTexturePhysicalSizeRcp = XMFLOAT2(0, 0);
+		retVal.virtualTextureMipCount = 0;
+		if (virtualTexture != nullptr)
+		{
+			const wiVirtualTexture::TiledImageDesc& desc = virtualTexture->GetPageTable().GetDesc();
+			const TextureDesc& physicalDesc = virtualTexture->GetPhysicalTexture()->GetDesc();
+			retVal.virtualTextureID = virtualTexture->GetID();
+			retVal.virtualTextureSize = XMUINT2(desc.width, desc.height);
+			retVal.virtualTexturePageSize = desc.pageSize;
+			retVal.virtualTextureBorder = desc.border;
+			retVal.virtualTexturePhysicalSizeRcp = XMFLOAT2(1.0f / physicalDesc.Width, 1.0f / physicalDesc.Height);
+			retVal.virtualTextureMipCount = desc.mipCount;
+		}
 		return retVal;
 	}
 
@@ -306,6 +325,16 @@ namespace wiScene
 	{
 		GraphicsDevice* device = wiRenderer::GetDevice();
 
+		// Meshlet bounds depend on the vertex positions and winding:
+		for (Meshlet& meshlet : meshlets)
+		{
+			const wiMeshOptimizer::ClusterBounds bounds = wiMeshOptimizer::ComputeClusterBounds(&indices[meshlet.indexOffset], meshlet.indexCount, vertex_positions.data());
+			meshlet.center = bounds.center;
+			meshlet.radius = bounds.radius;
+			meshlet.coneAxis = bounds.cone_axis;
+			meshlet.coneCutoff = bounds.cone_cutoff;
+		}
+
 		// Create index buffer GPU data:
 		{
 			uint32_t counter = 0;
@@ -360,36 +389,55 @@ namespace wiScene
 		{
 			std::vector<uint8_t> vertex_subsetindices(vertex_positions.size());
 
-			uint32_t subsetCounter = 0;
-			for (auto& subset : subsets)
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			GetLODSubsetRange(0, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshSubset& subset = subsets[subsetIndex];
 				for (uint32_t i = 0; i < subset.indexCount; ++i)
 				{
 					uint32_t index = indices[subset.indexOffset + i];
-					vertex_subsetindices[index] = subsetCounter;
+					vertex_subsetindices[index] = subsetIndex;
 				}
-				subsetCounter++;
 			}
 
-			std::vector<Vertex_POS> vertices(vertex_positions.size());
-			for (size_t i = 0; i < vertices.size(); ++i)
+			for (size_t i = 0; i < vertex_positions.size(); ++i)
+			{
+				const XMFLOAT3& pos = vertex_positions[i];
+				_min = wiMath::Min(_min, pos);
+				_max = wiMath::Max(_max, pos);
+			}
+
+			// Quantized meshes store 16-bit positions relative to the AABB:
+			vertexQuantized_POS = IsQuantized();
+			vertexBox_POS = AABB(_min, _max);
+			vertexBox_PRE = vertexBox_POS;
+			static_assert(sizeof(Vertex_POS) == VERTEX_POS_STRIDE && sizeof(Vertex_POS16) == VERTEX_POS16_STRIDE, "The shaders must be updated when the position vertex layouts change!");
+			const size_t stride = vertexQuantized_POS ? sizeof(Vertex_POS16) : sizeof(Vertex_POS);
+			std::vector<uint8_t> vertices(stride * vertex_positions.size());
+			for (size_t i = 0; i < vertex_positions.size(); ++i)
 			{
 				const XMFLOAT3& pos = vertex_positions[i];
 				XMFLOAT3& nor = vertex_normals.empty() ? XMFLOAT3(1, 1, 1) : vertex_normals[i];
 				XMStoreFloat3(&nor, XMVector3Normalize(XMLoadFloat3(&nor)));
 				uint32_t subsetIndex = vertex_subsetindices[i];
-				vertices[i].FromFULL(pos, nor, subsetIndex);
-
-				_min = wiMath::Min(_min, pos);
-				_max = wiMath::Max(_max, pos);
+				if (vertexQuantized_POS)
+				{
+					((Vertex_POS16*)vertices.data())[i].FromFULL(vertexBox_POS, pos, nor, subsetIndex);
+				}
+				else
+				{
+					((Vertex_POS*)vertices.data())[i].FromFULL(pos, nor, subsetIndex);
+				}
 			}
 
 			GPUBufferDesc bd;
 			bd.Usage = USAGE_DEFAULT;
 			bd.CPUAccessFlags = 0;
-			bd.BindFlags = BIND_VERTEX_BUFFER | BIND_SHADER_RESOURCE;
+			bd.BindFlags = BIND_SHADER_RESOURCE;
 			bd.MiscFlags = RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
-			bd.ByteWidth = (uint32_t)(sizeof(Vertex_POS) * vertices.size());
+			bd.ByteWidth = (uint32_t)vertices.size();
 
 			SubresourceData InitData;
 			InitData.pSysMem = vertices.data();
@@ -402,6 +450,7 @@ namespace wiScene
 		// skinning buffers:
 		if (!vertex_boneindices.empty())
 		{
+			static_assert(sizeof(Vertex_BON) == VERTEX_BON_STRIDE, "The skinning shader must be updated when the bone vertex layout changes!");
 			std::vector<Vertex_BON> vertices(vertex_boneindices.size());
 			for (size_t i = 0; i < vertices.size(); ++i)
 			{
@@ -431,7 +480,7 @@ namespace wiScene
 			device->CreateBuffer(&bd, &InitData, vertexBuffer_BON.get());
 
 			bd.Usage = USAGE_DEFAULT;
-			bd.BindFlags = BIND_VERTEX_BUFFER | BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+			bd.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
 			bd.CPUAccessFlags = 0;
 			bd.MiscFlags = RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
 
@@ -534,8 +583,45 @@ namespace wiScene
 		vertexBuffer_PRE.release();
 
 	}
+	inline ShaderPositionStream MakePositionStream(bool quantized, const AABB& box)
+	{
+		ShaderPositionStream stream;
+		stream.quantized = quantized ? 1 : 0;
+		stream.boxMin = quantized ? box.getMin() : XMFLOAT3(0, 0, 0);
+		stream.boxExtent = quantized ? XMFLOAT3(box._max.x - box._min.x, box._max.y - box._min.y, box._max.z - box._min.z) : XMFLOAT3(0, 0, 0);
+		stream.padding = 0;
+		return stream;
+	}
+	const GPUBuffer* MeshComponent::GetPositionStream(ShaderPositionStream& stream) const
+	{
+		if (streamoutBuffer_POS != nullptr)
+		{
+			// The skinning output is full precision:
+			stream = MakePositionStream(false, AABB());
+			return streamoutBuffer_POS.get();
+		}
+		return GetBasePositionStream(stream);
+	}
+	const GPUBuffer* MeshComponent::GetPrevPositionStream(ShaderPositionStream& stream) const
+	{
+		if (vertexBuffer_PRE == nullptr)
+		{
+			return GetPositionStream(stream);
+		}
+		// Skinned meshes keep the previous skinning output here, soft bodies swap it with vertexBuffer_POS so it has the same format:
+		stream = MakePositionStream(streamoutBuffer_POS == nullptr && vertexQuantized_POS, vertexBox_PRE);
+		return vertexBuffer_PRE.get();
+	}
+	const GPUBuffer* MeshComponent::GetBasePositionStream(ShaderPositionStream& stream) const
+	{
+		stream = MakePositionStream(vertexQuantized_POS, vertexBox_POS);
+		return vertexBuffer_POS.get();
+	}
 	void MeshComponent::ComputeNormals(bool smooth)
 	{
+		// The vertices can be rebuilt, so LODs would be invalid:
+		ClearLODs();
+
 		// Start recalculating normals:
 
 		if (smooth)
@@ -849,6 +935,248 @@ namespace wiScene
 
 		CreateRenderData();
 	}
+	void MeshComponent::GenerateLODs(uint32_t lodCount, float reduction, float targetError)
+	{
+		ClearLODs();
+		if (lodCount < 2 || subsets.empty() || vertex_positions.empty())
+		{
+			return;
+		}
+
+		const uint32_t subsetCount = (uint32_t)subsets.size();
+		std::vector<uint32_t> lodIndices;
+
+		float lodReduction = 1;
+		for (uint32_t lod = 1; lod < lodCount; ++lod)
+		{
+			// Every LOD is simplified from the full detail mesh, so the errors of the LODs don't add up, the allowed error grows with the LOD instead:
+			const size_t previousSubsetOffset = (lod - 1) * subsetCount;
+			const float lodError = targetError * lod;
+			lodReduction *= reduction;
+			bool reduced = false;
+
+			for (uint32_t subsetIndex = 0; subsetIndex < subsetCount; ++subsetIndex)
+			{
+				MeshSubset subset = subsets[subsetIndex];
+				const uint32_t previousIndexCount = subsets[previousSubsetOffset + subsetIndex].indexCount;
+				const size_t targetIndexCount = size_t(subset.indexCount * lodReduction) / 3 * 3;
+
+				lodIndices.resize(subset.indexCount);
+				size_t lodIndexCount = 0;
+				if (subset.indexCount > 0)
+				{
+					// Simplify() normalizes the positions that the subset references, so the error is relative to the extents of the subset:
+					lodIndexCount = wiMeshOptimizer::Simplify(
+						lodIndices.data(),
+						&indices[subset.indexOffset],
+						subset.indexCount,
+						vertex_positions.data(),
+						vertex_positions.size(),
+						targetIndexCount,
+						lodError
+					);
+				}
+				reduced |= lodIndexCount < previousIndexCount;
+
+				subset.indexOffset = (uint32_t)indices.size();
+				subset.indexCount = (uint32_t)lodIndexCount;
+				indices.insert(indices.end(), lodIndices.begin(), lodIndices.begin() + lodIndexCount);
+				subsets.push_back(subset);
+			}
+
+			if (!reduced)
+			{
+				// Couldn't simplify further within the error limit, the last LOD would be the same as the previous:
+				indices.resize(subsets[lod * subsetCount].indexOffset);
+				subsets.resize(lod * subsetCount);
+				break;
+			}
+		}
+
+		if (subsets.size() > subsetCount)
+		{
+			subsets_per_lod = subsetCount;
+		}
+
+		if (!meshlets.empty())
+		{
+			CreateMeshlets(); // the new subsets need meshlets too, this also creates render data
+		}
+		else
+		{
+			CreateRenderData();
+		}
+	}
+	void MeshComponent::Optimize(std::vector<uint32_t>* vertexRemap)
+	{
+		if (indices.empty() || vertex_positions.empty())
+		{
+			return;
+		}
+
+		// LOD subsets are optimized separately as well, they are drawn on their own:
+		for (const MeshSubset& subset : subsets)
+		{
+			if (subset.indexCount == 0)
+			{
+				continue;
+			}
+			uint32_t* subsetIndices = &indices[subset.indexOffset];
+			wiMeshOptimizer::OptimizeVertexCache(subsetIndices, subsetIndices, subset.indexCount, vertex_positions.size());
+			wiMeshOptimizer::OptimizeOverdraw(subsetIndices, subsetIndices, subset.indexCount, vertex_positions.data(), vertex_positions.size());
+		}
+
+		// The full detail mesh comes first in the index buffer, so its vertices will be the most coherent:
+		std::vector<uint32_t> remap(vertex_positions.size());
+		const size_t vertexCount = wiMeshOptimizer::OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertex_positions.size());
+		wiMeshOptimizer::RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+		auto remapVertices = [&](auto& vertices) {
+			if (vertices.size() == remap.size())
+			{
+				std::remove_reference_t<decltype(vertices)> remapped(vertexCount);
+				wiMeshOptimizer::RemapVertexBuffer(remapped.data(), vertices.data(), vertices.size(), remap.data());
+				vertices = std::move(remapped);
+			}
+		};
+		remapVertices(vertex_positions);
+		remapVertices(vertex_normals);
+		remapVertices(vertex_uvset_0);
+		remapVertices(vertex_uvset_1);
+		remapVertices(vertex_boneindices);
+		remapVertices(vertex_boneweights);
+		remapVertices(vertex_atlas);
+		remapVertices(vertex_colors);
+
+		if (vertexRemap != nullptr)
+		{
+			*vertexRemap = std::move(remap);
+		}
+
+		if (!meshlets.empty())
+		{
+			CreateMeshlets(); // the triangle order changed, this also creates render data
+		}
+		else
+		{
+			CreateRenderData();
+		}
+	}
+	void MeshComponent::ClearLODs()
+	{
+		if (subsets_per_lod == 0)
+		{
+			return;
+		}
+
+		if (!meshlets.empty() && subsets.size() > subsets_per_lod)
+		{
+			meshlets.resize(subsets[subsets_per_lod].meshletOffset);
+		}
+		indices.resize(GetBaseIndexCount());
+		subsets.resize(std::min((size_t)subsets_per_lod, subsets.size()));
+		subsets_per_lod = 0;
+
+		CreateRenderData();
+	}
+	void MeshComponent::CreateMeshlets(uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		meshlets.clear();
+
+		std::vector<wiMeshOptimizer::Meshlet> subsetMeshlets;
+		std::vector<uint32_t> subsetIndices;
+		for (MeshSubset& subset : subsets)
+		{
+			subset.meshletOffset = (uint32_t)meshlets.size();
+			subset.meshletCount = 0;
+			if (subset.indexCount == 0)
+			{
+				continue;
+			}
+
+			subsetIndices.resize(subset.indexCount);
+			wiMeshOptimizer::BuildMeshlets(
+				subsetMeshlets,
+				subsetIndices.data(),
+				&indices[subset.indexOffset],
+				subset.indexCount,
+				vertex_positions.data(),
+				vertex_positions.size(),
+				maxVertices,
+				maxTriangles
+			);
+			std::copy(subsetIndices.begin(), subsetIndices.end(), indices.begin() + subset.indexOffset);
+
+			for (const wiMeshOptimizer::Meshlet& x : subsetMeshlets)
+			{
+				Meshlet meshlet;
+				meshlet.indexOffset = subset.indexOffset + x.index_offset;
+				meshlet.indexCount = x.index_count;
+				meshlets.push_back(meshlet);
+			}
+			subset.meshletCount = (uint32_t)subsetMeshlets.size();
+		}
+
+		CreateRenderData();
+	}
+	void MeshComponent::ClearMeshlets()
+	{
+		meshlets.clear();
+		for (MeshSubset& subset : subsets)
+		{
+			subset.meshletOffset = 0;
+			subset.meshletCount = 0;
+		}
+	}
+	uint32_t MeshComponent::CullMeshlets(const MeshSubset& subset, const XMMATRIX& world, const Frustum& frustum, const XMFLOAT3& eye, bool coneCulling, IndexRange* ranges) const
+	{
+		// The bounding spheres are scaled by the largest axis, the normal cones are only valid if the transform keeps angles and winding:
+		const float scaleX = XMVectorGetX(XMVector3Length(world.r[0]));
+		const float scaleY = XMVectorGetX(XMVector3Length(world.r[1]));
+		const float scaleZ = XMVectorGetX(XMVector3Length(world.r[2]));
+		const float maxScale = std::max(scaleX, std::max(scaleY, scaleZ));
+		const float minScale = std::min(scaleX, std::min(scaleY, scaleZ));
+		coneCulling = coneCulling && minScale >= maxScale * 0.99f && XMVectorGetX(XMMatrixDeterminant(world)) > 0;
+
+		const XMVECTOR E = XMLoadFloat3(&eye);
+		uint32_t rangeCount = 0;
+		for (uint32_t i = subset.meshletOffset; i < subset.meshletOffset + subset.meshletCount; ++i)
+		{
+			const Meshlet& meshlet = meshlets[i];
+
+			const XMVECTOR C = XMVector3Transform(XMLoadFloat3(&meshlet.center), world);
+			const float radius = meshlet.radius * maxScale;
+			XMFLOAT3 center;
+			XMStoreFloat3(&center, C);
+			if (!frustum.CheckSphere(center, radius))
+			{
+				continue;
+			}
+
+			if (coneCulling && meshlet.coneCutoff < 1)
+			{
+				const XMVECTOR axis = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&meshlet.coneAxis), world));
+				const XMVECTOR D = C - E;
+				if (XMVectorGetX(XMVector3Dot(D, axis)) >= meshlet.coneCutoff * XMVectorGetX(XMVector3Length(D)) + radius)
+				{
+					continue;
+				}
+			}
+
+			// Meshlets are contiguous in the index buffer, so neighbouring visible meshlets are merged:
+			if (rangeCount > 0 && ranges[rangeCount - 1].indexOffset + ranges[rangeCount - 1].indexCount == meshlet.indexOffset)
+			{
+				ranges[rangeCount - 1].indexCount += meshlet.indexCount;
+			}
+			else
+			{
+				ranges[rangeCount].indexOffset = meshlet.indexOffset;
+				ranges[rangeCount].indexCount = meshlet.indexCount;
+				rangeCount++;
+			}
+		}
+		return rangeCount;
+	}
 
 	void ObjectComponent::ClearLightmap()
 	{
@@ -1060,6 +1388,8 @@ namespace wiScene
 
 		wiJobSystem::Wait(ctx); // dependecies
 
+		RunParticleSimulationSystemCPU(transforms, meshes, forces, aabb_objects, weather, emitters, hairs, dt);
+
 		RunWeatherUpdateSystem(ctx, weathers, lights, weather);
 
 		RunSoundUpdateSystem(ctx, transforms, sounds);
@@ -1317,7 +1647,7 @@ namespace wiScene
 		if (!textureName.empty())
 		{
 			material.baseColorMapName = textureName;
-			material.baseColorMap = wiResourceManager::Load(material.baseColorMapName);
+			material.baseColorMap = wiResourceManager::Load(material.baseColorMapName, wiResourceManager::LOAD_COLOR);
 		}
 		if (!normalMapName.empty())
 		{
@@ -1509,6 +1839,45 @@ namespace wiScene
 	}
 
 
+	bool Scene::OptimizeMesh(Entity entity)
+	{
+		MeshComponent* mesh = meshes.GetComponent(entity);
+		if (mesh == nullptr || softbodies.Contains(entity))
+		{
+			return false;
+		}
+
+		std::vector<uint32_t> remap;
+		mesh->Optimize(&remap);
+
+		// The hair particle systems that grow on this mesh have per vertex strand density:
+		for (size_t i = 0; i < hairs.GetCount(); ++i)
+		{
+			wiHairParticle& hair = hairs[i];
+			if (hair.meshID == entity && hair.vertex_weights.size() == remap.size())
+			{
+				std::vector<float> vertex_weights(mesh->vertex_positions.size());
+				wiMeshOptimizer::RemapVertexBuffer(vertex_weights.data(), hair.vertex_weights.data(), hair.vertex_weights.size(), remap.data());
+				hair.vertex_weights = std::move(vertex_weights);
+			}
+		}
+
+		return true;
+	}
+	size_t Scene::OptimizeMeshes()
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < meshes.GetCount(); ++i)
+		{
+			if (OptimizeMesh(meshes.GetEntity(i)))
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+
+
 	const uint32_t small_subtask_groupsize = 1024;
 
 	void RunPreviousFrameTransformUpdateSystem(
@@ -2107,6 +2476,88 @@ namespace wiScene
 
 		});
 	}
+	void RunParticleSimulationSystemCPU(
+		const ComponentManager<TransformComponent>& transforms,
+		const ComponentManager<MeshComponent>& meshes,
+		const ComponentManager<ForceFieldComponent>& forces,
+		const ComponentManager<AABB>& aabb_objects,
+		const WeatherComponent& weather,
+		ComponentManager<wiEmittedParticle>& emitters,
+		ComponentManager<wiHairParticle>& hairs,
+		float dt
+	)
+	{
+		std::vector<wiEmittedParticleCPU::ForceField> forceFields;
+		bool forceFieldsReady = false;
+		auto get_forcefields = [&]() -> const std::vector<wiEmittedParticleCPU::ForceField>& {
+			if (!forceFieldsReady)
+			{
+				forceFieldsReady = true;
+
+				// Same as the force fields in the GPU entity array:
+				forceFields.resize(forces.GetCount());
+				for (size_t j = 0; j < forces.GetCount(); ++j)
+				{
+					const ForceFieldComponent& force = forces[j];
+					forceFields[j].planar = force.type == ENTITY_TYPE_FORCEFIELD_PLANE;
+					forceFields[j].position = force.position;
+					forceFields[j].normal = force.direction;
+					forceFields[j].gravity = force.gravity;
+					forceFields[j].range_inverse = 1.0f / std::max(0.0001f, force.GetRange());
+				}
+			}
+			return forceFields;
+		};
+
+		for (size_t i = 0; i < emitters.GetCount(); ++i)
+		{
+			wiEmittedParticle& emitter = emitters[i];
+			if (!emitter.IsCPUSimulationEnabled())
+			{
+				continue;
+			}
+
+			wiEmittedParticleCPU::Environment environment;
+			environment.forceFields = get_forcefields().data();
+			environment.forceFieldCount = (uint32_t)forceFields.size();
+			if (aabb_objects.GetCount() > 0)
+			{
+				environment.colliders = &aabb_objects[0];
+				environment.colliderCount = (uint32_t)aabb_objects.GetCount();
+			}
+
+			Entity entity = emitters.GetEntity(i);
+			const TransformComponent& transform = *transforms.GetComponent(entity);
+			const MeshComponent* mesh = meshes.GetComponent(emitter.meshID);
+			emitter.UpdateSimulationCPU(transform, mesh, environment, dt);
+		}
+
+		const XMFLOAT3 eye = wiRenderer::GetCamera().Eye;
+		for (size_t i = 0; i < hairs.GetCount(); ++i)
+		{
+			wiHairParticle& hair = hairs[i];
+			if (!hair.IsCPUSimulationEnabled() || hair.meshID == INVALID_ENTITY)
+			{
+				continue;
+			}
+			const MeshComponent* mesh = meshes.GetComponent(hair.meshID);
+			if (mesh == nullptr)
+			{
+				continue;
+			}
+
+			wiHairParticleCPU::Environment environment;
+			environment.forceFields = get_forcefields().data();
+			environment.forceFieldCount = (uint32_t)forceFields.size();
+			environment.wind = weather.windDirection;
+			environment.windWaveSize = weather.windWaveSize;
+			environment.windRandomness = weather.windRandomness;
+
+			Entity entity = hairs.GetEntity(i);
+			const TransformComponent& transform = *transforms.GetComponent(entity);
+			hair.UpdateSimulationCPU(transform, *mesh, environment, eye, dt);
+		}
+	}
 	void RunWeatherUpdateSystem(
 		wiJobSystem::context& ctx,
 		const ComponentManager<WeatherComponent>& weathers,
@@ -2268,9 +2719,12 @@ namespace wiScene
 
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
-				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					for (size_t i = 0; i < subset.indexCount; i += 3)
 					{
 						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
@@ -2329,14 +2783,13 @@ namespace wiScene
 								XMStoreFloat3(&result.position, pos);
 								XMStoreFloat3(&result.normal, nor);
 								result.distance = distance;
-								result.subsetIndex = subsetCounter;
+								result.subsetIndex = (int)subsetIndex;
 								result.vertexID0 = (int)i0;
 								result.vertexID1 = (int)i1;
 								result.vertexID2 = (int)i2;
 							}
 						}
 					}
-					subsetCounter++;
 				}
 
 			}
@@ -2,6 +2,7 @@
 #include "CommonInclude.h"
 #include "wiEnums.h"
 #include "wiIntersect.h"
+#include "wiMath.h"
 #include "wiEmittedParticle.h"
 #include "wiHairParticle.h"
 #include "ShaderInterop_Renderer.h"
@@ -9,6 +10,7 @@
 #include "wiAudio.h"
 #include "wiRenderer.h"
 #include "wiResourceManager.h"
+#include "wiVirtualTexture.h"
 
 #include "wiECS.h"
 #include "wiScene_Decl.h"
@@ -144,6 +146,7 @@ namespace wiScene
 		std::string displacementMapName;
 		std::string emissiveMapName;
 		std::string occlusionMapName;
+		std::string virtualTextureName; // tiled image file (wiVirtualTexture::CreateTiledImage), it is sampled instead of the base color map with the base color uv set
 
 		uint32_t uvset_baseColorMap = 0;
 		uint32_t uvset_surfaceMap = 0;
@@ -159,6 +162,7 @@ namespace wiScene
 		std::shared_ptr<wiResource> displacementMap;
 		std::shared_ptr<wiResource> emissiveMap;
 		std::shared_ptr<wiResource> occlusionMap;
+		std::shared_ptr<wiVirtualTexture::VirtualTexture> virtualTexture;
 		std::unique_ptr<wiGraphics::GPUBuffer> constantBuffer;
 
 		int customShaderID = -1; // for now, this is not serialized; need to consider actual proper use case first
@@ -245,6 +249,7 @@ namespace wiScene
 			RENDERABLE = 1 << 0,
 			DOUBLE_SIDED = 1 << 1,
 			DYNAMIC = 1 << 2,
+			QUANTIZED = 1 << 3,
 		};
 		uint32_t _flags = RENDERABLE;
 
@@ -263,12 +268,31 @@ namespace wiScene
 			wiECS::Entity materialID = wiECS::INVALID_ENTITY;
 			uint32_t indexOffset = 0;
 			uint32_t indexCount = 0;
+			uint32_t meshletOffset = 0;
+			uint32_t meshletCount = 0;
 		};
 		std::vector<MeshSubset>		subsets;
 
+		// Small clusters of triangles that are contiguous in the index buffer, they can be culled individually:
+		struct Meshlet
+		{
+			uint32_t indexOffset = 0;
+			uint32_t indexCount = 0;
+
+			// Non-serialized attributes, they are computed by CreateRenderData():
+			XMFLOAT3 center = XMFLOAT3(0, 0, 0);	// bounding sphere
+			float radius = 0;
+			XMFLOAT3 coneAxis = XMFLOAT3(0, 0, 0);	// normal cone for backface culling
+			float coneCutoff = 1;
+		};
+		std::vector<Meshlet> meshlets;
+
 		float tessellationFactor = 0.0f;
 		wiECS::Entity armatureID = wiECS::INVALID_ENTITY;
 
+		// Subsets are stored for every level of detail one after the other, this is zero if there are no LODs:
+		uint32_t subsets_per_lod = 0;
+
 		// Non-serialized attributes:
 		AABB aabb;
 		std::unique_ptr<wiGraphics::GPUBuffer>	indexBuffer;
@@ -280,26 +304,88 @@ namespace wiScene
 		std::unique_ptr<wiGraphics::GPUBuffer>	vertexBuffer_ATL;
 		std::unique_ptr<wiGraphics::GPUBuffer>	vertexBuffer_PRE;
 		std::unique_ptr<wiGraphics::GPUBuffer>	streamoutBuffer_POS;
+		// Quantized meshes store vertexBuffer_POS as Vertex_POS16 relative to vertexBox_POS, the boxes are swapped together with the buffers:
+		bool vertexQuantized_POS = false;
+		AABB vertexBox_POS;
+		AABB vertexBox_PRE;
 
 
 		inline void SetRenderable(bool value) { if (value) { _flags |= RENDERABLE; } else { _flags &= ~RENDERABLE; } }
 		inline void SetDoubleSided(bool value) { if (value) { _flags |= DOUBLE_SIDED; } else { _flags &= ~DOUBLE_SIDED; } }
 		inline void SetDynamic(bool value) { if (value) { _flags |= DYNAMIC; } else { _flags &= ~DYNAMIC; } }
+		// Quantized meshes are serialized with 16-bit positions, octahedral normals, 8-bit bone weights and 16-bit indices where possible
+		//	Their GPU position stream also uses 16-bit positions and octahedral normals (Vertex_POS16), it is applied by CreateRenderData()
+		inline void SetQuantized(bool value) { if (value) { _flags |= QUANTIZED; } else { _flags &= ~QUANTIZED; } }
 
 		inline bool IsRenderable() const { return _flags & RENDERABLE; }
 		inline bool IsDoubleSided() const { return _flags & DOUBLE_SIDED; }
 		inline bool IsDynamic() const { return _flags & DYNAMIC; }
+		inline bool IsQuantized() const { return _flags & QUANTIZED; }
 
 		inline float GetTessellationFactor() const { return tessellationFactor; }
+		inline uint32_t GetLODCount() const { return subsets_per_lod == 0 ? 1 : ((uint32_t)subsets.size() / subsets_per_lod); }
+		// Returns the subsets of a level of detail in the [first_subset, last_subset) range
+		inline void GetLODSubsetRange(uint32_t lod, uint32_t& first_subset, uint32_t& last_subset) const
+		{
+			first_subset = 0;
+			last_subset = (uint32_t)subsets.size();
+			if (subsets_per_lod > 0)
+			{
+				lod = std::min(lod, GetLODCount() - 1);
+				first_subset = lod * subsets_per_lod;
+				last_subset = first_subset + subsets_per_lod;
+			}
+		}
+		// Returns the number of indices that belong to the full detail mesh (LOD indices are stored after these)
+		inline uint32_t GetBaseIndexCount() const { return subsets_per_lod == 0 || subsets.size() <= subsets_per_lod ? (uint32_t)indices.size() : subsets[subsets_per_lod].indexOffset; }
 		inline wiGraphics::INDEXBUFFER_FORMAT GetIndexFormat() const { return vertex_positions.size() > 65535 ? wiGraphics::INDEXFORMAT_32BIT : wiGraphics::INDEXFORMAT_16BIT; }
 		inline bool IsSkinned() const { return armatureID != wiECS::INVALID_ENTITY; }
 
 		void CreateRenderData();
+		// The shaders read the positions from these buffers, stream receives how they are encoded:
+		//	GetPositionStream		: current positions, this is the skinning output for skinned meshes
+		//	GetPrevPositionStream	: previous frame positions, for motion vectors
+		//	GetBasePositionStream	: positions before skinning
+		const wiGraphics::GPUBuffer* GetPositionStream(ShaderPositionStream& stream) const;
+		const wiGraphics::GPUBuffer* GetPrevPositionStream(ShaderPositionStream& stream) const;
+		const wiGraphics::GPUBuffer* GetBasePositionStream(ShaderPositionStream& stream) const;
 		void ComputeNormals(bool smooth);
 		void FlipCulling();
 		void FlipNormals();
 		void Recenter();
 		void RecenterToBottom();
+		// Generate lower levels of detail with the mesh simplifier, they will be stored as additional subsets:
+		//	lodCount	: the number of LODs, including the full detail mesh
+		//	reduction	: triangle count ratio between subsequent LODs
+		//	targetError	: maximum allowed geometric error of LOD 1 relative to the extents of each subset, LOD n allows n times this.
+		//				  Every LOD is simplified from the full detail mesh, so the error is measured from it. Simplification stops when it would exceed this
+		void GenerateLODs(uint32_t lodCount, float reduction = 0.5f, float targetError = 0.05f);
+		// Remove all LODs, only the full detail mesh is kept
+		void ClearLODs();
+		// Split every subset into meshlets for cluster culling, this reorders the triangles within subsets
+		void CreateMeshlets(uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+		// Remove meshlets, the triangle order is kept
+		void ClearMeshlets();
+
+		struct IndexRange
+		{
+			uint32_t indexOffset;
+			uint32_t indexCount;
+		};
+		// Cull the meshlets of a subset against a frustum and the back facing normal cones, visible meshlets are merged into index ranges:
+		//	subset		: the subset to cull, it must have meshlets
+		//	world		: world matrix of the instance
+		//	frustum		: world space frustum
+		//	eye			: world space camera position
+		//	coneCulling	: enable back facing cluster culling (only correct for single sided materials)
+		//	ranges		: output, must be able to hold subset.meshletCount elements
+		//	returns the number of index ranges written
+		uint32_t CullMeshlets(const MeshSubset& subset, const XMMATRIX& world, const Frustum& frustum, const XMFLOAT3& eye, bool coneCulling, IndexRange* ranges) const;
+
+		// Reorder triangles for the post transform vertex cache and for less overdraw (per subset), then reorder vertices for fetch locality
+		//	The vertex order changes and unreferenced vertices are removed, so external per vertex data (for example wiHairParticle::vertex_weights) must be remapped
+		//	vertexRemap	: optional, receives the remap table (new index of every old vertex, ~0u if it was removed), use it with wiMeshOptimizer::RemapVertexBuffer()
+		void Optimize(std::vector<uint32_t>* vertexRemap = nullptr);
 
 		void Serialize(wiArchive& archive, uint32_t seed = 0);
 
@@ -360,6 +446,37 @@ namespace wiScene
 
 			static const wiGraphics::FORMAT FORMAT = wiGraphics::FORMAT::FORMAT_R32G32B32A32_FLOAT;
 		};
+		// Position stream of quantized meshes: 16-bit positions relative to a box, octahedral normals, the layout is decoded in ShaderInterop_VertexQuantization.h
+		struct Vertex_POS16
+		{
+			uint32_t pos_xy = 0;
+			uint32_t pos_z_subsetIndex = 0;
+			uint32_t normal = 0;
+
+			void FromFULL(const AABB& box, const XMFLOAT3& _pos, const XMFLOAT3& _nor, uint32_t subsetIndex)
+			{
+				assert(subsetIndex < 256); // subsetIndex is packed onto 8 bits
+
+				uint16_t q[3];
+				wiMath::QuantizePosition(_pos, box.getMin(), box.getMax(), q);
+				pos_xy = (uint32_t)q[0] | ((uint32_t)q[1] << 16);
+				pos_z_subsetIndex = (uint32_t)q[2] | ((subsetIndex & 0x000000FF) << 16);
+				normal = wiMath::EncodeOctahedral(_nor);
+			}
+			inline XMFLOAT3 GetPos_FULL(const AABB& box) const
+			{
+				const uint16_t q[] = { uint16_t(pos_xy & 0xFFFF), uint16_t(pos_xy >> 16), uint16_t(pos_z_subsetIndex & 0xFFFF) };
+				return wiMath::DequantizePosition(q, box.getMin(), box.getMax());
+			}
+			inline XMFLOAT3 GetNor_FULL() const
+			{
+				return wiMath::DecodeOctahedral(normal);
+			}
+			inline uint32_t GetMaterialIndex() const
+			{
+				return (pos_z_subsetIndex >> 16) & 0x000000FF;
+			}
+		};
 		struct Vertex_TEX
 		{
 			XMHALF2 tex = XMHALF2(0.0f, 0.0f);
@@ -371,47 +488,36 @@ namespace wiScene
 
 			static const wiGraphics::FORMAT FORMAT = wiGraphics::FORMAT::FORMAT_R16G16_FLOAT;
 		};
+		// 16-bit bone indices and 16-bit bone weights, the layout is decoded in ShaderInterop_VertexQuantization.h
+		//	The weights of quantized meshes are already 8-bit precision after loading, the GPU stream doesn't reduce them further
 		struct Vertex_BON
 		{
-			uint64_t ind = 0;
-			uint64_t wei = 0;
+			uint32_t ind_xy = 0;
+			uint32_t ind_zw = 0;
+			uint32_t wei_xy = 0;
+			uint32_t wei_zw = 0;
 
 			void FromFULL(const XMUINT4& boneIndices, const XMFLOAT4& boneWeights)
 			{
-				ind = 0;
-				wei = 0;
-
-				ind |= (uint64_t)boneIndices.x << 0;
-				ind |= (uint64_t)boneIndices.y << 16;
-				ind |= (uint64_t)boneIndices.z << 32;
-				ind |= (uint64_t)boneIndices.w << 48;
-
-				wei |= (uint64_t)(boneWeights.x * 65535.0f) << 0;
-				wei |= (uint64_t)(boneWeights.y * 65535.0f) << 16;
-				wei |= (uint64_t)(boneWeights.z * 65535.0f) << 32;
-				wei |= (uint64_t)(boneWeights.w * 65535.0f) << 48;
+				assert(boneIndices.x < 65536 && boneIndices.y < 65536 && boneIndices.z < 65536 && boneIndices.w < 65536);
+
+				ind_xy = (boneIndices.x & 0xFFFF) | (boneIndices.y << 16);
+				ind_zw = (boneIndices.z & 0xFFFF) | (boneIndices.w << 16);
+				wei_xy = uint32_t(wiMath::Clamp(boneWeights.x, 0, 1) * 65535.0f + 0.5f) | (uint32_t(wiMath::Clamp(boneWeights.y, 0, 1) * 65535.0f + 0.5f) << 16);
+				wei_zw = uint32_t(wiMath::Clamp(boneWeights.z, 0, 1) * 65535.0f + 0.5f) | (uint32_t(wiMath::Clamp(boneWeights.w, 0, 1) * 65535.0f + 0.5f) << 16);
 			}
 			inline XMUINT4 GetInd_FULL() const
 			{
-				XMUINT4 ind_FULL(0, 0, 0, 0);
-
-				ind_FULL.x = ((ind >> 0) & 0x0000FFFF);
-				ind_FULL.y = ((ind >> 16) & 0x0000FFFF);
-				ind_FULL.z = ((ind >> 32) & 0x0000FFFF);
-				ind_FULL.w = ((ind >> 48) & 0x0000FFFF);
-
-				return ind_FULL;
+				return XMUINT4(ind_xy & 0xFFFF, ind_xy >> 16, ind_zw & 0xFFFF, ind_zw >> 16);
 			}
 			inline XMFLOAT4 GetWei_FULL() const
 			{
-				XMFLOAT4 wei_FULL(0, 0, 0, 0);
-
-				wei_FULL.x = (float)((wei >> 0) & 0x0000FFFF) / 65535.0f;
-				wei_FULL.y = (float)((wei >> 16) & 0x0000FFFF) / 65535.0f;
-				wei_FULL.z = (float)((wei >> 32) & 0x0000FFFF) / 65535.0f;
-				wei_FULL.w = (float)((wei >> 48) & 0x0000FFFF) / 65535.0f;
-
-				return wei_FULL;
+				return XMFLOAT4(
+					(float)(wei_xy & 0xFFFF) / 65535.0f,
+					(float)(wei_xy >> 16) / 65535.0f,
+					(float)(wei_zw & 0xFFFF) / 65535.0f,
+					(float)(wei_zw >> 16) / 65535.0f
+				);
 			}
 		};
 		struct Vertex_COL
@@ -1090,6 +1196,13 @@ namespace wiScene
 		// Detaches all children from an entity (if there are any):
 		void Component_DetachChildren(wiECS::Entity parent);
 
+		// Optimizes a mesh with MeshComponent::Optimize() and remaps the hair particle vertex weights that depend on its vertex order.
+		//	Meshes with soft body physics are not optimized, because the physics engine already simulates their vertices in the current order
+		//	returns false if the mesh was not optimized
+		bool OptimizeMesh(wiECS::Entity entity);
+		// Optimizes every mesh of the scene with OptimizeMesh(), returns the number of optimized meshes
+		size_t OptimizeMeshes();
+
 		void Serialize(wiArchive& archive);
 	};
 
@@ -1177,6 +1290,19 @@ namespace wiScene
 		wiECS::ComponentManager<wiHairParticle>& hairs,
 		float dt
 	);
+	// Simulates the emitters and hair particle systems that use the CPU simulation, the particles of every system are processed in parallel
+	//	The force fields affect the particles, and the object bounding boxes are the colliders for depth collision
+	//	The hair strands also get the wind of the weather, and their density LOD is selected by the distance from the main camera
+	void RunParticleSimulationSystemCPU(
+		const wiECS::ComponentManager<TransformComponent>& transforms,
+		const wiECS::ComponentManager<MeshComponent>& meshes,
+		const wiECS::ComponentManager<ForceFieldComponent>& forces,
+		const wiECS::ComponentManager<AABB>& aabb_objects,
+		const WeatherComponent& weather,
+		wiECS::ComponentManager<wiEmittedParticle>& emitters,
+		wiECS::ComponentManager<wiHairParticle>& hairs,
+		float dt
+	);
 	void RunWeatherUpdateSystem(
 		wiJobSystem::context& ctx,
 		const wiECS::ComponentManager<WeatherComponent>& weathers,
@@ -140,6 +140,150 @@ int Pick(lua_State* L)
 	return 0;
 }
 
+// Component fields of the bulk accessors, the values are stored in flat number arrays:
+enum COMPONENT_FIELD
+{
+	TRANSFORM_TRANSLATION,
+	TRANSFORM_ROTATION,
+	TRANSFORM_SCALE,
+	TRANSFORM_WORLD_POSITION,
+	TRANSFORM_WORLD_MATRIX,
+	LIGHT_COLOR,
+	LIGHT_ENERGY,
+	LIGHT_RANGE,
+	OBJECT_COLOR,
+	COMPONENT_FIELD_COUNT
+};
+struct ComponentFieldInfo
+{
+	const char* name;
+	uint32_t valueCount;	// numbers per component
+	bool writable;
+};
+static const ComponentFieldInfo componentFields[COMPONENT_FIELD_COUNT] = {
+	{ "TRANSFORM_TRANSLATION", 3, true },
+	{ "TRANSFORM_ROTATION", 4, true },
+	{ "TRANSFORM_SCALE", 3, true },
+	{ "TRANSFORM_WORLD_POSITION", 3, false },
+	{ "TRANSFORM_WORLD_MATRIX", 16, false },
+	{ "LIGHT_COLOR", 3, true },
+	{ "LIGHT_ENERGY", 1, true },
+	{ "LIGHT_RANGE", 1, true },
+	{ "OBJECT_COLOR", 4, true },
+};
+
+// Copies the values of one component between the components and a flat Lua table, without creating Lua objects
+struct FieldCopy
+{
+	lua_State* L;
+	int table;				// stack index of the values
+	uint32_t valueCount;
+	bool write;
+
+	void operator()(size_t index, float* data) const
+	{
+		const lua_Integer first = lua_Integer(index * valueCount + 1);
+		for (uint32_t j = 0; j < valueCount; ++j)
+		{
+			if (write)
+			{
+				if (data != nullptr)
+				{
+					lua_rawgeti(L, table, first + j);
+					data[j] = (float)lua_tonumber(L, -1);
+					lua_pop(L, 1);
+				}
+			}
+			else
+			{
+				lua_pushnumber(L, data != nullptr ? (lua_Number)data[j] : 0);
+				lua_rawseti(L, table, first + j);
+			}
+		}
+	}
+	// Called with the number of components before they are visited, returns false if they can't be copied
+	//	The values to write must be exactly as many as the components, the missing ones would be written as zeroes
+	//	A result table that is filled again is cut to the length of the read values, so it can be written back
+	bool Begin(size_t count) const
+	{
+		const size_t length = (size_t)lua_rawlen(L, table);
+		const size_t expected = count * valueCount;
+		if (write)
+		{
+			if (length != expected)
+			{
+				wiLua::SError(L, "Scene::Component_WriteArray(opt table entities, int field, table values) values has " + to_string(length) + " numbers, but the components need " + to_string(expected) + "!");
+				return false;
+			}
+			return true;
+		}
+		for (size_t i = length; i > expected; --i)
+		{
+			lua_pushnil(L);
+			lua_rawseti(L, table, lua_Integer(i));
+		}
+		return true;
+	}
+};
+// Visits the components of the entities in the table, or every component of the manager if there is no table
+//	Returns the number of visited elements
+template<typename T, typename Accessor>
+size_t CopyComponentField(lua_State* L, int entities, ComponentManager<T>& manager, const FieldCopy& copy, Accessor accessor)
+{
+	if (lua_istable(L, entities))
+	{
+		const size_t count = (size_t)lua_rawlen(L, entities);
+		if (!copy.Begin(count))
+		{
+			return 0;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			lua_rawgeti(L, entities, lua_Integer(i + 1));
+			T* component = manager.GetComponent((Entity)lua_tointeger(L, -1));
+			lua_pop(L, 1);
+			copy(i, component != nullptr ? accessor(*component) : nullptr);
+		}
+		return count;
+	}
+	if (!copy.Begin(manager.GetCount()))
+	{
+		return 0;
+	}
+	for (size_t i = 0; i < manager.GetCount(); ++i)
+	{
+		copy(i, accessor(manager[i]));
+	}
+	return manager.GetCount();
+}
+size_t CopyComponentField(lua_State* L, Scene& scene, int entities, int field, const FieldCopy& copy)
+{
+	const bool write = copy.write;
+	switch (field)
+	{
+	case TRANSFORM_TRANSLATION:
+		return CopyComponentField(L, entities, scene.transforms, copy, [write](TransformComponent& x) { if (write) { x.SetDirty(); } return &x.translation_local.x; });
+	case TRANSFORM_ROTATION:
+		return CopyComponentField(L, entities, scene.transforms, copy, [write](TransformComponent& x) { if (write) { x.SetDirty(); } return &x.rotation_local.x; });
+	case TRANSFORM_SCALE:
+		return CopyComponentField(L, entities, scene.transforms, copy, [write](TransformComponent& x) { if (write) { x.SetDirty(); } return &x.scale_local.x; });
+	case TRANSFORM_WORLD_POSITION:
+		return CopyComponentField(L, entities, scene.transforms, copy, [](TransformComponent& x) { return &x.world._41; });
+	case TRANSFORM_WORLD_MATRIX:
+		return CopyComponentField(L, entities, scene.transforms, copy, [](TransformComponent& x) { return &x.world._11; });
+	case LIGHT_COLOR:
+		return CopyComponentField(L, entities, scene.lights, copy, [](LightComponent& x) { return &x.color.x; });
+	case LIGHT_ENERGY:
+		return CopyComponentField(L, entities, scene.lights, copy, [](LightComponent& x) { return &x.energy; });
+	case LIGHT_RANGE:
+		return CopyComponentField(L, entities, scene.lights, copy, [](LightComponent& x) { return &x.range_local; });
+	case OBJECT_COLOR:
+		return CopyComponentField(L, entities, scene.objects, copy, [](ObjectComponent& x) { return &x.color.x; });
+	default:
+		return 0;
+	}
+}
+
 void Bind()
 {
 	static bool initialized = false;
@@ -165,6 +309,11 @@ void Bind()
 		wiLua::GetGlobal()->RunText("STENCILREF_DEFAULT = 2");
 		wiLua::GetGlobal()->RunText("STENCILREF_SKIN = 3");
 
+		for (int i = 0; i < COMPONENT_FIELD_COUNT; ++i)
+		{
+			wiLua::GetGlobal()->RunText(string(componentFields[i].name) + " = " + to_string(i));
+		}
+
 		wiLua::GetGlobal()->RegisterFunc("GetScene", GetScene);
 		wiLua::GetGlobal()->RegisterFunc("LoadModel", LoadModel);
 		wiLua::GetGlobal()->RegisterFunc("Pick", Pick);
@@ -232,6 +381,9 @@ Luna<Scene_BindLua>::FunctionType Scene_BindLua::methods[] = {
 	lunamethod(Scene_BindLua, Component_Attach),
 	lunamethod(Scene_BindLua, Component_Detach),
 	lunamethod(Scene_BindLua, Component_DetachChildren),
+
+	lunamethod(Scene_BindLua, Component_ReadArray),
+	lunamethod(Scene_BindLua, Component_WriteArray),
 	{ NULL, NULL }
 };
 Luna<Scene_BindLua>::PropertyType Scene_BindLua::properties[] = {
@@ -880,6 +1032,71 @@ int Scene_BindLua::Component_DetachChildren(lua_State* L)
 	}
 	return 0;
 }
+int Scene_BindLua::Component_ReadArray(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		int field = wiLua::SGetInt(L, 2);
+		if (field < 0 || field >= COMPONENT_FIELD_COUNT)
+		{
+			wiLua::SError(L, "Scene::Component_ReadArray(opt table entities, int field, opt table result) unknown field!");
+			return 0;
+		}
+		if (argc > 2 && lua_istable(L, 3))
+		{
+			// fill the table of the previous frame, there is no new allocation if it is already big enough:
+			lua_pushvalue(L, 3);
+		}
+		else
+		{
+			const size_t count = lua_istable(L, 1) ? (size_t)lua_rawlen(L, 1) : 0;
+			lua_createtable(L, int(count * componentFields[field].valueCount), 0);
+		}
+		FieldCopy copy;
+		copy.L = L;
+		copy.table = lua_gettop(L);
+		copy.valueCount = componentFields[field].valueCount;
+		copy.write = false;
+		size_t count = CopyComponentField(L, *scene, 1, field, copy);
+		wiLua::SSetInt(L, (int)count);
+		return 2;
+	}
+	else
+	{
+		wiLua::SError(L, "Scene::Component_ReadArray(opt table entities, int field, opt table result) not enough arguments!");
+	}
+	return 0;
+}
+int Scene_BindLua::Component_WriteArray(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 2)
+	{
+		int field = wiLua::SGetInt(L, 2);
+		if (field < 0 || field >= COMPONENT_FIELD_COUNT || !componentFields[field].writable)
+		{
+			wiLua::SError(L, "Scene::Component_WriteArray(opt table entities, int field, table values) the field is unknown or read only!");
+			return 0;
+		}
+		if (!lua_istable(L, 3))
+		{
+			wiLua::SError(L, "Scene::Component_WriteArray(opt table entities, int field, table values) values must be a table!");
+			return 0;
+		}
+		FieldCopy copy;
+		copy.L = L;
+		copy.table = 3;
+		copy.valueCount = componentFields[field].valueCount;
+		copy.write = true;
+		CopyComponentField(L, *scene, 1, field, copy);
+	}
+	else
+	{
+		wiLua::SError(L, "Scene::Component_WriteArray(opt table entities, int field, table values) not enough arguments!");
+	}
+	return 0;
+}
 
 
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "wiLua.h"
 #include "wiLuna.h"
+#include "wiLuaAllocator.h"
 #include "wiScene_Decl.h"
 
 namespace wiScene_BindLua
@@ -68,6 +69,9 @@ namespace wiScene_BindLua
 		int Component_Attach(lua_State* L);
 		int Component_Detach(lua_State* L);
 		int Component_DetachChildren(lua_State* L);
+
+		int Component_ReadArray(lua_State* L);
+		int Component_WriteArray(lua_State* L);
 	};
 
 	class NameComponent_BindLua
@@ -132,6 +136,8 @@ namespace wiScene_BindLua
 		int GetPosition(lua_State* L);
 		int GetRotation(lua_State* L);
 		int GetScale(lua_State* L);
+
+		WILUA_POOLED(TransformComponent_BindLua)
 	};
 
 	class CameraComponent_BindLua
@@ -8,6 +8,32 @@ using namespace wiECS;
 
 namespace wiScene
 {
+	// Quantized vertex streams are stored as byte arrays:
+	template<typename T>
+	void WriteQuantizedStream(wiArchive& archive, const std::vector<T>& data)
+	{
+		std::vector<uint8_t> bytes(data.size() * sizeof(T));
+		if (!bytes.empty())
+		{
+			memcpy(bytes.data(), data.data(), bytes.size());
+		}
+		archive << bytes;
+	}
+	template<typename T>
+	void ReadQuantizedStream(wiArchive& archive, std::vector<T>& data)
+	{
+		std::vector<uint8_t> bytes;
+		archive >> bytes;
+		data.resize(bytes.size() / sizeof(T));
+		if (!data.empty())
+		{
+			memcpy(data.data(), bytes.data(), data.size() * sizeof(T));
+		}
+	}
+	struct QuantizedPosition
+	{
+		uint16_t value[3];
+	};
 
 	void NameComponent::Serialize(wiArchive& archive, uint32_t seed)
 	{
@@ -127,31 +153,39 @@ namespace wiScene
 				archive >> displacementMapping;
 			}
 
-			SetDirty();
-
-			if (!baseColorMapName.empty())
-			{
-				baseColorMap = wiResourceManager::Load(dir + baseColorMapName);
-			}
-			if (!surfaceMapName.empty())
+			if (archive.GetVersion() >= 38)
 			{
-				surfaceMap = wiResourceManager::Load(dir + surfaceMapName);
+				archive >> virtualTextureName;
 			}
-			if (!normalMapName.empty())
-			{
-				normalMap = wiResourceManager::Load(dir + normalMapName);
-			}
-			if (!displacementMapName.empty())
+
+			SetDirty();
+
+			// The textures are decoded in parallel:
+			const std::string* mapNames[] = { &baseColorMapName, &surfaceMapName, &normalMapName, &displacementMapName, &emissiveMapName, &occlusionMapName };
+			std::shared_ptr<wiResource>* maps[] = { &baseColorMap, &surfaceMap, &normalMap, &displacementMap, &emissiveMap, &occlusionMap };
+			const uint32_t mapFlags[] = { wiResourceManager::LOAD_COLOR, 0, 0, 0, wiResourceManager::LOAD_COLOR, 0 };
+			std::vector<wiHashString> names;
+			std::vector<uint32_t> flags;
+			for (size_t i = 0; i < arraysize(mapNames); ++i)
 			{
-				displacementMap = wiResourceManager::Load(dir + displacementMapName);
+				if (!mapNames[i]->empty())
+				{
+					names.push_back(dir + *mapNames[i]);
+					flags.push_back(mapFlags[i]);
+				}
 			}
-			if (!emissiveMapName.empty())
+			auto resources = wiResourceManager::LoadBatch(names, flags);
+			for (size_t i = 0, j = 0; i < arraysize(mapNames); ++i)
 			{
-				emissiveMap = wiResourceManager::Load(dir + emissiveMapName);
+				if (!mapNames[i]->empty())
+				{
+					*maps[i] = resources[j++];
+				}
 			}
-			if (!occlusionMapName.empty())
+
+			if (!virtualTextureName.empty())
 			{
-				occlusionMap = wiResourceManager::Load(dir + occlusionMapName);
+				virtualTexture = wiVirtualTexture::Load(dir + virtualTextureName);
 			}
 
 		}
@@ -215,6 +249,12 @@ namespace wiScene
 				{
 					emissiveMapName = emissiveMapName.substr(found + dir.length());
 				}
+
+				found = virtualTextureName.rfind(dir);
+				if (found != std::string::npos)
+				{
+					virtualTextureName = virtualTextureName.substr(found + dir.length());
+				}
 			}
 
 			archive << baseColorMapName;
@@ -240,6 +280,11 @@ namespace wiScene
 
 				archive << displacementMapping;
 			}
+
+			if (archive.GetVersion() >= 38)
+			{
+				archive << virtualTextureName;
+			}
 		}
 	}
 	void MeshComponent::Serialize(wiArchive& archive, uint32_t seed)
@@ -248,14 +293,71 @@ namespace wiScene
 		if (archive.IsReadMode())
 		{
 			archive >> _flags;
-			archive >> vertex_positions;
-			archive >> vertex_normals;
-			archive >> vertex_uvset_0;
-			archive >> vertex_boneindices;
-			archive >> vertex_boneweights;
-			archive >> vertex_atlas;
-			archive >> vertex_colors;
-			archive >> indices;
+			if (archive.GetVersion() >= 36 && IsQuantized())
+			{
+				XMFLOAT3 aabb_min, aabb_max;
+				archive >> aabb_min;
+				archive >> aabb_max;
+
+				std::vector<QuantizedPosition> positions;
+				ReadQuantizedStream(archive, positions);
+				vertex_positions.resize(positions.size());
+				for (size_t i = 0; i < positions.size(); ++i)
+				{
+					vertex_positions[i] = wiMath::DequantizePosition(positions[i].value, aabb_min, aabb_max);
+				}
+
+				std::vector<uint32_t> normals;
+				ReadQuantizedStream(archive, normals);
+				vertex_normals.resize(normals.size());
+				for (size_t i = 0; i < normals.size(); ++i)
+				{
+					vertex_normals[i] = wiMath::DecodeOctahedral(normals[i]);
+				}
+
+				archive >> vertex_uvset_0;
+
+				std::vector<uint16_t> boneindices;
+				ReadQuantizedStream(archive, boneindices);
+				vertex_boneindices.resize(boneindices.size() / 4);
+				for (size_t i = 0; i < vertex_boneindices.size(); ++i)
+				{
+					vertex_boneindices[i] = XMUINT4(boneindices[i * 4 + 0], boneindices[i * 4 + 1], boneindices[i * 4 + 2], boneindices[i * 4 + 3]);
+				}
+
+				std::vector<uint32_t> boneweights;
+				ReadQuantizedStream(archive, boneweights);
+				vertex_boneweights.resize(boneweights.size());
+				for (size_t i = 0; i < boneweights.size(); ++i)
+				{
+					vertex_boneweights[i] = wiMath::DequantizeBoneWeights(boneweights[i]);
+				}
+
+				archive >> vertex_atlas;
+				archive >> vertex_colors;
+
+				if (vertex_positions.size() <= 65536)
+				{
+					std::vector<uint16_t> indices16;
+					ReadQuantizedStream(archive, indices16);
+					indices.assign(indices16.begin(), indices16.end());
+				}
+				else
+				{
+					ReadQuantizedStream(archive, indices);
+				}
+			}
+			else
+			{
+				archive >> vertex_positions;
+				archive >> vertex_normals;
+				archive >> vertex_uvset_0;
+				archive >> vertex_boneindices;
+				archive >> vertex_boneweights;
+				archive >> vertex_atlas;
+				archive >> vertex_colors;
+				archive >> indices;
+			}
 
 			size_t subsetCount;
 			archive >> subsetCount;
@@ -275,19 +377,108 @@ namespace wiScene
 				archive >> vertex_uvset_1;
 			}
 
+			if (archive.GetVersion() >= 34)
+			{
+				archive >> subsets_per_lod;
+			}
+
+			if (archive.GetVersion() >= 35)
+			{
+				for (auto& subset : subsets)
+				{
+					archive >> subset.meshletOffset;
+					archive >> subset.meshletCount;
+				}
+				size_t meshletCount;
+				archive >> meshletCount;
+				meshlets.resize(meshletCount);
+				for (auto& meshlet : meshlets)
+				{
+					archive >> meshlet.indexOffset;
+					archive >> meshlet.indexCount;
+				}
+			}
+
 			CreateRenderData();
 		}
 		else
 		{
 			archive << _flags;
-			archive << vertex_positions;
-			archive << vertex_normals;
-			archive << vertex_uvset_0;
-			archive << vertex_boneindices;
-			archive << vertex_boneweights;
-			archive << vertex_atlas;
-			archive << vertex_colors;
-			archive << indices;
+			if (IsQuantized())
+			{
+				XMFLOAT3 aabb_min = XMFLOAT3(0, 0, 0);
+				XMFLOAT3 aabb_max = XMFLOAT3(0, 0, 0);
+				if (!vertex_positions.empty())
+				{
+					aabb_min = vertex_positions[0];
+					aabb_max = vertex_positions[0];
+					for (auto& pos : vertex_positions)
+					{
+						aabb_min = wiMath::Min(aabb_min, pos);
+						aabb_max = wiMath::Max(aabb_max, pos);
+					}
+				}
+				archive << aabb_min;
+				archive << aabb_max;
+
+				std::vector<QuantizedPosition> positions(vertex_positions.size());
+				for (size_t i = 0; i < positions.size(); ++i)
+				{
+					wiMath::QuantizePosition(vertex_positions[i], aabb_min, aabb_max, positions[i].value);
+				}
+				WriteQuantizedStream(archive, positions);
+
+				std::vector<uint32_t> normals(vertex_normals.size());
+				for (size_t i = 0; i < normals.size(); ++i)
+				{
+					normals[i] = wiMath::EncodeOctahedral(vertex_normals[i]);
+				}
+				WriteQuantizedStream(archive, normals);
+
+				archive << vertex_uvset_0;
+
+				std::vector<uint16_t> boneindices(vertex_boneindices.size() * 4);
+				for (size_t i = 0; i < vertex_boneindices.size(); ++i)
+				{
+					assert(vertex_boneindices[i].x < 65536 && vertex_boneindices[i].y < 65536 && vertex_boneindices[i].z < 65536 && vertex_boneindices[i].w < 65536);
+					boneindices[i * 4 + 0] = (uint16_t)vertex_boneindices[i].x;
+					boneindices[i * 4 + 1] = (uint16_t)vertex_boneindices[i].y;
+					boneindices[i * 4 + 2] = (uint16_t)vertex_boneindices[i].z;
+					boneindices[i * 4 + 3] = (uint16_t)vertex_boneindices[i].w;
+				}
+				WriteQuantizedStream(archive, boneindices);
+
+				std::vector<uint32_t> boneweights(vertex_boneweights.size());
+				for (size_t i = 0; i < boneweights.size(); ++i)
+				{
+					boneweights[i] = wiMath::QuantizeBoneWeights(vertex_boneweights[i]);
+				}
+				WriteQuantizedStream(archive, boneweights);
+
+				archive << vertex_atlas;
+				archive << vertex_colors;
+
+				if (vertex_positions.size() <= 65536)
+				{
+					std::vector<uint16_t> indices16(indices.begin(), indices.end());
+					WriteQuantizedStream(archive, indices16);
+				}
+				else
+				{
+					WriteQuantizedStream(archive, indices);
+				}
+			}
+			else
+			{
+				archive << vertex_positions;
+				archive << vertex_normals;
+				archive << vertex_uvset_0;
+				archive << vertex_boneindices;
+				archive << vertex_boneweights;
+				archive << vertex_atlas;
+				archive << vertex_colors;
+				archive << indices;
+			}
 
 			archive << subsets.size();
 			for (size_t i = 0; i < subsets.size(); ++i)
@@ -305,6 +496,26 @@ namespace wiScene
 				archive << vertex_uvset_1;
 			}
 
+			if (archive.GetVersion() >= 34)
+			{
+				archive << subsets_per_lod;
+			}
+
+			if (archive.GetVersion() >= 35)
+			{
+				for (auto& subset : subsets)
+				{
+					archive << subset.meshletOffset;
+					archive << subset.meshletCount;
+				}
+				archive << meshlets.size();
+				for (auto& meshlet : meshlets)
+				{
+					archive << meshlet.indexOffset;
+					archive << meshlet.indexCount;
+				}
+			}
+
 		}
 	}
 	void ImpostorComponent::Serialize(wiArchive& archive, uint32_t seed)
@@ -10,7 +10,7 @@ wiSprite::wiSprite(const std::string& newTexture, const std::string& newMask)
 	if (!newTexture.empty())
 	{
 		textureName = newTexture;
-		textureResource = wiResourceManager::Load(newTexture);
+		textureResource = wiResourceManager::Load(newTexture, wiResourceManager::LOAD_COLOR);
 	}
 	if (!newMask.empty())
 	{
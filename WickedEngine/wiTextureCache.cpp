@@ -0,0 +1,230 @@
+#include "wiTextureCache.h"
+#include "wiBlockCompression.h"
+#include "wiMipGenerator.h"
+#include "wiHelper.h"
+
+#include "Utility/stb_image.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+using namespace wiGraphics;
+
+namespace wiTextureCache
+{
+	bool enabled = false;
+	bool highQuality = false;
+	std::string directory = "texturecache/";
+
+	// Increment this when the encoders change, so that old cache entries are not used anymore:
+	static const uint32_t CACHE_VERSION = 2;
+
+	void SetEnabled(bool value) { enabled = value; }
+	bool IsEnabled() { return enabled; }
+	void SetDirectory(const std::string& path)
+	{
+		directory = path;
+		if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+		{
+			directory += "/";
+		}
+	}
+	std::string GetDirectory() { return directory; }
+	void SetHighQuality(bool value) { highQuality = value; }
+	bool IsHighQuality() { return highQuality; }
+
+	FORMAT SelectFormat(const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		if (highQuality)
+		{
+			return FORMAT_BC7_UNORM;
+		}
+		const size_t pixelCount = (size_t)width * height;
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			if (rgba[i * 4 + 3] < 255)
+			{
+				return FORMAT_BC3_UNORM;
+			}
+		}
+		return FORMAT_BC1_UNORM;
+	}
+
+	bool CreateDDS(const uint8_t* rgba, uint32_t width, uint32_t height, FORMAT format, std::vector<uint8_t>& dds, bool srgb)
+	{
+		uint32_t dxgiFormat = 0;
+		switch (format)
+		{
+		case FORMAT_BC1_UNORM: dxgiFormat = 71; break;
+		case FORMAT_BC1_UNORM_SRGB: dxgiFormat = 72; break;
+		case FORMAT_BC3_UNORM: dxgiFormat = 77; break;
+		case FORMAT_BC3_UNORM_SRGB: dxgiFormat = 78; break;
+		case FORMAT_BC4_UNORM: dxgiFormat = 80; break;
+		case FORMAT_BC5_UNORM: dxgiFormat = 83; break;
+		case FORMAT_BC7_UNORM: dxgiFormat = 98; break;
+		case FORMAT_BC7_UNORM_SRGB: dxgiFormat = 99; break;
+		default:
+			return false;
+		}
+
+		std::vector<uint8_t> mips;
+		wiMipGenerator::GenerateMipChain(rgba, width, height, mips, wiMipGenerator::FILTER_BOX, srgb);
+		const uint32_t mipCount = wiMipGenerator::GetMipCount(width, height);
+
+		// "DDS " + DDS_HEADER (124 bytes) + DDS_HEADER_DXT10 (20 bytes):
+		uint32_t header[1 + 31 + 5] = {};
+		header[0] = 0x20534444;			// "DDS "
+		header[1] = 124;				// size
+		header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+		header[3] = height;
+		header[4] = width;
+		header[5] = (uint32_t)wiBlockCompression::GetCompressedSize(format, width, height);
+		header[7] = mipCount;
+		header[19] = 32;				// pixel format size
+		header[20] = 0x4;				// DDPF_FOURCC
+		header[21] = 0x30315844;		// "DX10"
+		header[27] = 0x1000 | 0x400000 | 0x8; // TEXTURE | MIPMAP | COMPLEX
+		header[32] = dxgiFormat;
+		header[33] = 3;					// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		header[35] = 1;					// array size
+
+		size_t totalSize = sizeof(header);
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			totalSize += wiBlockCompression::GetCompressedSize(format, std::max(1u, width >> mip), std::max(1u, height >> mip));
+		}
+		dds.resize(totalSize);
+		memcpy(dds.data(), header, sizeof(header));
+
+		size_t srcOffset = 0;
+		size_t dstOffset = sizeof(header);
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			const uint32_t mipWidth = std::max(1u, width >> mip);
+			const uint32_t mipHeight = std::max(1u, height >> mip);
+			wiBlockCompression::CompressImage(format, mips.data() + srcOffset, mipWidth, mipHeight, dds.data() + dstOffset);
+			srcOffset += (size_t)mipWidth * mipHeight * 4;
+			dstOffset += wiBlockCompression::GetCompressedSize(format, mipWidth, mipHeight);
+		}
+		return true;
+	}
+
+	// The stamp of a source file remembers the content hash of its last seen version,
+	//	so the contents are only read and hashed again when the size or the modification time changes
+	struct Stamp
+	{
+		uint64_t size = 0;
+		uint64_t modifiedTime = 0;
+		uint64_t hash = 0;
+		uint64_t transcodable = 1; // 0 if the image can't be block compressed, then it is not decoded again
+	};
+
+	void FreeImage(Image& image)
+	{
+		stbi_image_free(image.rgba);
+		image = Image();
+	}
+
+	bool GetDDS(const std::string& fileName, std::vector<uint8_t>& dds, bool srgb, Image* decoded)
+	{
+		Stamp current;
+		if (!wiHelper::GetFileInfo(fileName, current.size, current.modifiedTime))
+		{
+			return false;
+		}
+
+		// The settings that affect the result are part of the hashes:
+		const uint32_t settings[] = { CACHE_VERSION, highQuality ? 1u : 0u, srgb ? 1u : 0u };
+
+		// The stamps are identified by the path of the source file:
+		uint64_t stampHash = wiHelper::HashBytes(fileName.c_str(), fileName.length());
+		stampHash = wiHelper::HashBytes(settings, sizeof(settings), stampHash);
+		std::stringstream ss;
+		ss << directory << std::hex << std::setw(16) << std::setfill('0') << stampHash << ".stamp";
+		const std::string stampFileName = ss.str();
+
+		Stamp stamp;
+		std::ifstream stampFile(stampFileName, std::ios::binary);
+		const bool stampValid = stampFile.is_open() && stampFile.read((char*)&stamp, sizeof(stamp)) &&
+			stamp.size == current.size && stamp.modifiedTime == current.modifiedTime;
+		stampFile.close();
+
+		if (stampValid && stamp.transcodable == 0)
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> fileData;
+		if (stampValid)
+		{
+			current.hash = stamp.hash;
+		}
+		else
+		{
+			if (!wiHelper::readByteData(fileName, fileData))
+			{
+				return false;
+			}
+			current.hash = wiHelper::HashBytes(fileData.data(), fileData.size());
+			current.hash = wiHelper::HashBytes(settings, sizeof(settings), current.hash);
+		}
+
+		ss.str("");
+		ss << directory << std::hex << std::setw(16) << std::setfill('0') << current.hash << ".dds";
+		const std::string cacheFileName = ss.str();
+		if (wiHelper::FileExists(cacheFileName) && wiHelper::readByteData(cacheFileName, dds))
+		{
+			if (!stampValid)
+			{
+				wiHelper::WriteFileAtomic(stampFileName, &current, sizeof(current), true);
+			}
+			return true;
+		}
+
+		// The stamp was valid, but the cache entry was deleted:
+		if (fileData.empty() && !wiHelper::readByteData(fileName, fileData))
+		{
+			return false;
+		}
+
+		int width, height, bpp;
+		uint8_t* rgba = stbi_load_from_memory(fileData.data(), (int)fileData.size(), &width, &height, &bpp, 4);
+		if (rgba == nullptr)
+		{
+			return false;
+		}
+		if (width % 4 != 0 || height % 4 != 0)
+		{
+			// Remember that this version of the file can't be transcoded, and hand the decoded image to the caller:
+			current.transcodable = 0;
+			wiHelper::WriteFileAtomic(stampFileName, &current, sizeof(current), true);
+			if (decoded != nullptr)
+			{
+				decoded->rgba = rgba;
+				decoded->width = (uint32_t)width;
+				decoded->height = (uint32_t)height;
+			}
+			else
+			{
+				stbi_image_free(rgba);
+			}
+			return false;
+		}
+
+		const FORMAT format = SelectFormat(rgba, (uint32_t)width, (uint32_t)height);
+		const bool success = CreateDDS(rgba, (uint32_t)width, (uint32_t)height, format, dds, srgb);
+		stbi_image_free(rgba);
+
+		if (success)
+		{
+			wiHelper::WriteFileAtomic(cacheFileName, dds.data(), dds.size(), false);
+			if (!stampValid)
+			{
+				wiHelper::WriteFileAtomic(stampFileName, &current, sizeof(current), true);
+			}
+		}
+		return success;
+	}
+}
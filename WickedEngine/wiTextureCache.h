@@ -0,0 +1,47 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiGraphicsDescriptors.h"
+
+#include <string>
+#include <vector>
+
+// Transcoding cache for image files (png, jpg, tga...)
+//	Images are block compressed with a full mip chain on the CPU, and the result is stored as a DDS file in the cache directory.
+//	Cache entries are identified by the hash of the source file contents, so they stay valid when files are renamed or moved,
+//	and they are recreated when a source file is modified.
+//	The hash of every source file path is remembered with its size and modification time, and the contents are only hashed again when those change.
+//	Images that can't be block compressed are remembered the same way, so they are only decoded once by the caller.
+namespace wiTextureCache
+{
+	// Enable transcoding when wiResourceManager loads an image file (default: false)
+	void SetEnabled(bool value);
+	bool IsEnabled();
+	// Set the directory where the cached DDS files are stored (default: "texturecache/")
+	void SetDirectory(const std::string& path);
+	std::string GetDirectory();
+	// If enabled, every texture is compressed to BC7, otherwise opaque textures use BC1 and transparent textures use BC3 (default: false)
+	void SetHighQuality(bool value);
+	bool IsHighQuality();
+
+	// Select the block compression format for an RGBA8 image based on the quality setting and on the alpha channel
+	wiGraphics::FORMAT SelectFormat(const uint8_t* rgba, uint32_t width, uint32_t height);
+	// Block compress an RGBA8 image with full mip chain, and write it as a DDS file into memory
+	//	srgb	: the color channels are sRGB encoded, the mips are filtered in linear space
+	//	returns false if the format is not supported by wiBlockCompression
+	bool CreateDDS(const uint8_t* rgba, uint32_t width, uint32_t height, wiGraphics::FORMAT format, std::vector<uint8_t>& dds, bool srgb = false);
+
+	// An image that was decoded by GetDDS(), but couldn't be block compressed
+	struct Image
+	{
+		uint8_t* rgba = nullptr; // allocated by stb_image, free it with FreeImage()
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+	void FreeImage(Image& image);
+
+	// Returns the transcoded DDS file contents of an image file, from the cache if possible, otherwise the image is transcoded and stored in the cache
+	//	srgb		: the color channels are sRGB encoded, the mips are filtered in linear space (this is part of the cache key)
+	//	decoded		: if not null and the image was decoded, but it can't be block compressed, it is returned here instead of being freed
+	//	returns false if the image couldn't be loaded, or it can't be block compressed (the width and height must be multiples of 4)
+	bool GetDDS(const std::string& fileName, std::vector<uint8_t>& dds, bool srgb = false, Image* decoded = nullptr);
+}
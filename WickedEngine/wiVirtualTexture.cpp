@@ -0,0 +1,579 @@
+#include "wiVirtualTexture.h"
+#include "wiMipGenerator.h"
+#include "wiJobSystem.h"
+#include "wiRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+using namespace wiGraphics;
+
+namespace wiVirtualTexture
+{
+	static const uint32_t TILEDIMAGE_MAGIC = 0x54564957; // "WIVT"
+	static const uint32_t TILEDIMAGE_VERSION = 1;
+	static const size_t TILEDIMAGE_HEADER_SIZE = 8 * sizeof(uint32_t);
+
+	uint32_t TiledImageDesc::GetPageCountX(uint32_t mip) const
+	{
+		return (std::max(1u, width >> mip) + pageSize - 1) / pageSize;
+	}
+	uint32_t TiledImageDesc::GetPageCountY(uint32_t mip) const
+	{
+		return (std::max(1u, height >> mip) + pageSize - 1) / pageSize;
+	}
+	uint32_t TiledImageDesc::GetPageCount() const
+	{
+		uint32_t count = 0;
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			count += GetPageCountX(mip) * GetPageCountY(mip);
+		}
+		return count;
+	}
+	uint32_t TiledImageDesc::GetPageIndex(uint32_t page) const
+	{
+		const uint32_t mip = VIRTUALTEXTURE_PAGE_MIP(page);
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < mip; ++i)
+		{
+			offset += GetPageCountX(i) * GetPageCountY(i);
+		}
+		return offset + VIRTUALTEXTURE_PAGE_Y(page) * GetPageCountX(mip) + VIRTUALTEXTURE_PAGE_X(page);
+	}
+
+	void ComputeMipCount(TiledImageDesc& desc)
+	{
+		desc.mipCount = 1;
+		while (desc.mipCount < VIRTUALTEXTURE_MAX_MIPS && (desc.GetPageCountX(desc.mipCount - 1) > 1 || desc.GetPageCountY(desc.mipCount - 1) > 1))
+		{
+			desc.mipCount++;
+		}
+	}
+
+	void CreateTiledImage(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t pageSize, uint32_t border, std::vector<uint8_t>& result)
+	{
+		TiledImageDesc desc;
+		desc.width = width;
+		desc.height = height;
+		desc.pageSize = pageSize;
+		desc.border = border;
+		ComputeMipCount(desc);
+
+		std::vector<uint8_t> mips;
+		wiMipGenerator::GenerateMipChain(rgba, width, height, mips);
+
+		// Page lookup for the parallel tiling:
+		struct MipInfo
+		{
+			size_t dataOffset;
+			uint32_t width, height;
+			uint32_t firstPage;
+			uint32_t pageCountX;
+		};
+		std::vector<MipInfo> mipInfos(desc.mipCount);
+		size_t dataOffset = 0;
+		uint32_t firstPage = 0;
+		for (uint32_t mip = 0; mip < desc.mipCount; ++mip)
+		{
+			MipInfo& info = mipInfos[mip];
+			info.dataOffset = dataOffset;
+			info.width = std::max(1u, width >> mip);
+			info.height = std::max(1u, height >> mip);
+			info.firstPage = firstPage;
+			info.pageCountX = desc.GetPageCountX(mip);
+			dataOffset += (size_t)info.width * info.height * 4;
+			firstPage += desc.GetPageCountX(mip) * desc.GetPageCountY(mip);
+		}
+
+		const uint32_t pageCount = desc.GetPageCount();
+		const size_t pageDataSize = desc.GetPageDataSize();
+		result.resize(TILEDIMAGE_HEADER_SIZE + pageCount * pageDataSize);
+
+		const uint32_t header[8] = { TILEDIMAGE_MAGIC, TILEDIMAGE_VERSION, width, height, pageSize, border, desc.mipCount, 0 };
+		memcpy(result.data(), header, sizeof(header));
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, pageCount, 4, [&](wiJobDispatchArgs args) {
+			const uint32_t pageIndex = args.jobIndex;
+			uint32_t mip = 0;
+			while (mip + 1 < desc.mipCount && mipInfos[mip + 1].firstPage <= pageIndex)
+			{
+				mip++;
+			}
+			const MipInfo& info = mipInfos[mip];
+			const uint32_t pageX = (pageIndex - info.firstPage) % info.pageCountX;
+			const uint32_t pageY = (pageIndex - info.firstPage) / info.pageCountX;
+			const uint8_t* src = mips.data() + info.dataOffset;
+			uint8_t* dst = result.data() + TILEDIMAGE_HEADER_SIZE + pageIndex * pageDataSize;
+
+			const uint32_t paddedSize = desc.GetPaddedPageSize();
+			for (uint32_t y = 0; y < paddedSize; ++y)
+			{
+				const int srcY = std::min(std::max((int)(pageY * pageSize + y) - (int)border, 0), (int)info.height - 1);
+				for (uint32_t x = 0; x < paddedSize; ++x)
+				{
+					const int srcX = std::min(std::max((int)(pageX * pageSize + x) - (int)border, 0), (int)info.width - 1);
+					memcpy(dst + (y * paddedSize + x) * 4, src + ((size_t)srcY * info.width + srcX) * 4, 4);
+				}
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	bool TiledImageFile::Open(const std::string& fileName)
+	{
+		desc = TiledImageDesc();
+		file.open(fileName, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		uint32_t header[8] = {};
+		file.read((char*)header, sizeof(header));
+		if (!file.good() || header[0] != TILEDIMAGE_MAGIC || header[1] != TILEDIMAGE_VERSION || header[4] == 0)
+		{
+			file.close();
+			return false;
+		}
+		desc.width = header[2];
+		desc.height = header[3];
+		desc.pageSize = header[4];
+		desc.border = header[5];
+		desc.mipCount = header[6];
+		return true;
+	}
+
+	bool TiledImageFile::ReadPage(uint32_t page, uint8_t* dest)
+	{
+		const uint32_t mip = VIRTUALTEXTURE_PAGE_MIP(page);
+		if (!IsValid() || mip >= desc.mipCount || VIRTUALTEXTURE_PAGE_X(page) >= desc.GetPageCountX(mip) || VIRTUALTEXTURE_PAGE_Y(page) >= desc.GetPageCountY(mip))
+		{
+			return false;
+		}
+		const size_t pageDataSize = desc.GetPageDataSize();
+		std::lock_guard<std::mutex> lock(locker);
+		file.seekg(TILEDIMAGE_HEADER_SIZE + desc.GetPageIndex(page) * pageDataSize);
+		file.read((char*)dest, pageDataSize);
+		return file.good();
+	}
+
+
+	void PageTable::Initialize(const TiledImageDesc& desc, uint32_t physicalPagesX, uint32_t physicalPagesY)
+	{
+		assert(physicalPagesX <= 256 && physicalPagesY <= 256);
+		this->desc = desc;
+		this->physicalPagesX = physicalPagesX;
+		this->physicalPagesY = physicalPagesY;
+		frame = 1;
+		pages.clear();
+		pages.resize(desc.GetPageCount());
+		slots.clear();
+		slots.resize(physicalPagesX * physicalPagesY, VIRTUALTEXTURE_INVALID_PAGE);
+		requestCounts.clear();
+		requestCounts.resize(pages.size());
+		entries.clear();
+		entries.resize(pages.size());
+		residentCount = 0;
+		dirtyMips = (1u << desc.mipCount) - 1;
+	}
+
+	void PageTable::Touch(uint32_t page)
+	{
+		pages[desc.GetPageIndex(page)].lastUsedFrame = frame;
+	}
+
+	void PageTable::ResolveFeedback(const uint32_t* feedback, size_t count, std::vector<uint32_t>& requests, size_t maxRequests)
+	{
+		requests.clear();
+		if (pages.empty())
+		{
+			return;
+		}
+
+		// The lowest resolution page is always needed as the last fallback:
+		std::vector<uint32_t> requested;
+		const uint32_t topPage = VIRTUALTEXTURE_PACK_PAGE(0, 0, desc.mipCount - 1);
+		requested.push_back(topPage);
+		requestCounts[desc.GetPageIndex(topPage)] = 1;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t page = feedback[i];
+			if (page == VIRTUALTEXTURE_INVALID_PAGE)
+			{
+				continue;
+			}
+			const uint32_t mip = VIRTUALTEXTURE_PAGE_MIP(page);
+			if (mip >= desc.mipCount || VIRTUALTEXTURE_PAGE_X(page) >= desc.GetPageCountX(mip) || VIRTUALTEXTURE_PAGE_Y(page) >= desc.GetPageCountY(mip))
+			{
+				continue;
+			}
+			if (requestCounts[desc.GetPageIndex(page)]++ == 0)
+			{
+				requested.push_back(page);
+			}
+		}
+
+		// The parents of the requested pages are needed for the fallback while the requested pages are loading:
+		for (size_t i = 0; i < requested.size(); ++i)
+		{
+			const uint32_t page = requested[i];
+			const uint32_t mip = VIRTUALTEXTURE_PAGE_MIP(page);
+			if (mip + 1 < desc.mipCount)
+			{
+				const uint32_t parent = VIRTUALTEXTURE_PACK_PAGE(VIRTUALTEXTURE_PAGE_X(page) / 2, VIRTUALTEXTURE_PAGE_Y(page) / 2, mip + 1);
+				if (requestCounts[desc.GetPageIndex(parent)]++ == 0)
+				{
+					requested.push_back(parent);
+				}
+			}
+		}
+
+		for (uint32_t page : requested)
+		{
+			Touch(page);
+			if (!IsResident(page))
+			{
+				requests.push_back(page);
+			}
+		}
+
+		std::sort(requests.begin(), requests.end(), [&](uint32_t a, uint32_t b) {
+			const uint32_t mipA = VIRTUALTEXTURE_PAGE_MIP(a);
+			const uint32_t mipB = VIRTUALTEXTURE_PAGE_MIP(b);
+			if (mipA != mipB)
+			{
+				return mipA > mipB;
+			}
+			const uint32_t countA = requestCounts[desc.GetPageIndex(a)];
+			const uint32_t countB = requestCounts[desc.GetPageIndex(b)];
+			if (countA != countB)
+			{
+				return countA > countB;
+			}
+			return a < b;
+		});
+		if (requests.size() > maxRequests)
+		{
+			requests.resize(maxRequests);
+		}
+
+		for (uint32_t page : requested)
+		{
+			requestCounts[desc.GetPageIndex(page)] = 0;
+		}
+	}
+
+	int PageTable::MakeResident(uint32_t page)
+	{
+		const uint32_t index = desc.GetPageIndex(page);
+		if (pages[index].slot >= 0)
+		{
+			pages[index].lastUsedFrame = frame;
+			return pages[index].slot;
+		}
+
+		// Find a free slot, or the least recently used page that is not needed in this frame:
+		const uint32_t topPage = VIRTUALTEXTURE_PACK_PAGE(0, 0, desc.mipCount - 1);
+		int slot = -1;
+		uint32_t oldestFrame = frame;
+		for (size_t i = 0; i < slots.size(); ++i)
+		{
+			if (slots[i] == VIRTUALTEXTURE_INVALID_PAGE)
+			{
+				slot = (int)i;
+				break;
+			}
+			if (slots[i] == topPage)
+			{
+				continue;
+			}
+			const uint32_t lastUsedFrame = pages[desc.GetPageIndex(slots[i])].lastUsedFrame;
+			if (lastUsedFrame < oldestFrame)
+			{
+				oldestFrame = lastUsedFrame;
+				slot = (int)i;
+			}
+		}
+		if (slot < 0)
+		{
+			return -1;
+		}
+		if (slots[slot] != VIRTUALTEXTURE_INVALID_PAGE)
+		{
+			Evict(slots[slot]);
+		}
+
+		slots[slot] = page;
+		pages[index].slot = slot;
+		pages[index].lastUsedFrame = frame;
+		residentCount++;
+		dirtyMips |= (1u << (VIRTUALTEXTURE_PAGE_MIP(page) + 1)) - 1; // the page and the finer mip levels that can fall back to it
+		return slot;
+	}
+
+	void PageTable::Evict(uint32_t page)
+	{
+		Page& state = pages[desc.GetPageIndex(page)];
+		if (state.slot < 0)
+		{
+			return;
+		}
+		slots[state.slot] = VIRTUALTEXTURE_INVALID_PAGE;
+		state.slot = -1;
+		residentCount--;
+		dirtyMips |= (1u << (VIRTUALTEXTURE_PAGE_MIP(page) + 1)) - 1;
+	}
+
+	bool PageTable::IsResident(uint32_t page) const
+	{
+		return GetSlot(page) >= 0;
+	}
+
+	int PageTable::GetSlot(uint32_t page) const
+	{
+		return pages[desc.GetPageIndex(page)].slot;
+	}
+
+	uint32_t PageTable::UpdatePageTable()
+	{
+		const uint32_t updated = dirtyMips;
+		// From the lowest resolution, so that the parent entries are already up to date:
+		for (int mip = (int)desc.mipCount - 1; mip >= 0; --mip)
+		{
+			if ((dirtyMips & (1u << mip)) == 0)
+			{
+				continue;
+			}
+			const uint32_t pageCountX = desc.GetPageCountX(mip);
+			const uint32_t pageCountY = desc.GetPageCountY(mip);
+			const uint32_t offset = desc.GetPageIndex(VIRTUALTEXTURE_PACK_PAGE(0, 0, mip));
+			const uint32_t parentOffset = mip + 1 < (int)desc.mipCount ? desc.GetPageIndex(VIRTUALTEXTURE_PACK_PAGE(0, 0, mip + 1)) : 0;
+			const uint32_t parentCountX = mip + 1 < (int)desc.mipCount ? desc.GetPageCountX(mip + 1) : 0;
+			for (uint32_t y = 0; y < pageCountY; ++y)
+			{
+				for (uint32_t x = 0; x < pageCountX; ++x)
+				{
+					const uint32_t index = offset + y * pageCountX + x;
+					const int slot = pages[index].slot;
+					if (slot >= 0)
+					{
+						entries[index] = VIRTUALTEXTURE_PACK_ENTRY(slot % physicalPagesX, slot / physicalPagesX, mip);
+					}
+					else if (parentCountX > 0)
+					{
+						entries[index] = entries[parentOffset + (y / 2) * parentCountX + x / 2];
+					}
+					else
+					{
+						entries[index] = 0;
+					}
+				}
+			}
+		}
+		dirtyMips = 0;
+		return updated;
+	}
+
+
+	void FeedbackBuffer::Create()
+	{
+		GraphicsDevice* device = wiRenderer::GetDevice();
+
+		data.clear();
+		data.resize(VIRTUALTEXTURE_FEEDBACK_SIZE * VIRTUALTEXTURE_FEEDBACK_SIZE * 2, 0);
+
+		GPUBufferDesc bd;
+		bd.Usage = USAGE_DEFAULT;
+		bd.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = RESOURCE_MISC_BUFFER_STRUCTURED;
+		bd.StructureByteStride = sizeof(uint32_t) * 2;
+		bd.ByteWidth = sizeof(uint32_t) * (uint32_t)data.size();
+		SubresourceData initData;
+		initData.pSysMem = data.data();
+		device->CreateBuffer(&bd, &initData, &buffer);
+		device->SetName(&buffer, "VirtualTexture::FeedbackBuffer");
+
+		GPUBufferDesc readbackDesc = bd;
+		readbackDesc.Usage = USAGE_STAGING;
+		readbackDesc.CPUAccessFlags = CPU_ACCESS_READ;
+		readbackDesc.BindFlags = 0;
+		readbackDesc.MiscFlags = 0;
+		for (uint32_t i = 0; i < READBACK_COUNT; ++i)
+		{
+			device->CreateBuffer(&readbackDesc, nullptr, &readbackBuffers[i]);
+		}
+		device->CreateBuffer(&readbackDesc, nullptr, &resolveBuffer);
+		frame = 0;
+	}
+
+	void FeedbackBuffer::Update(CommandList cmd)
+	{
+		if (!IsValid())
+		{
+			return;
+		}
+		GraphicsDevice* device = wiRenderer::GetDevice();
+
+		// The oldest readback buffer of the ring was copied READBACK_COUNT - 1 updates ago, the GPU finished that copy already:
+		const uint32_t readIndex = (uint32_t)((frame + 1) % READBACK_COUNT);
+		if (frame + 1 < READBACK_COUNT || !device->DownloadResource(&readbackBuffers[readIndex], &resolveBuffer, data.data()))
+		{
+			std::fill(data.begin(), data.end(), 0);
+		}
+
+		device->Barrier(&GPUBarrier::Buffer(&buffer, BUFFER_STATE_UNORDERED_ACCESS, BUFFER_STATE_COPY_SRC), 1, cmd);
+		device->CopyResource(&readbackBuffers[frame % READBACK_COUNT], &buffer, cmd);
+		device->Barrier(&GPUBarrier::Buffer(&buffer, BUFFER_STATE_COPY_SRC, BUFFER_STATE_UNORDERED_ACCESS), 1, cmd);
+		frame++;
+
+		static const std::vector<uint32_t> cleared(VIRTUALTEXTURE_FEEDBACK_SIZE * VIRTUALTEXTURE_FEEDBACK_SIZE * 2, 0);
+		device->UpdateBuffer(&buffer, cleared.data(), cmd);
+	}
+
+	void FeedbackBuffer::GetPages(uint32_t id, std::vector<uint32_t>& pages) const
+	{
+		pages.clear();
+		for (size_t i = 0; i + 1 < data.size(); i += 2)
+		{
+			if (data[i] == id)
+			{
+				pages.push_back(data[i + 1]);
+			}
+		}
+	}
+
+
+	bool VirtualTexture::Create(const std::string& fileName, uint32_t physicalPages)
+	{
+		if (!file.Open(fileName))
+		{
+			return false;
+		}
+		static std::atomic<uint32_t> nextID{ 1 };
+		id = nextID.fetch_add(1);
+		updatedFrame = ~0ull;
+
+		const TiledImageDesc& desc = file.GetDesc();
+		physicalPagesX = physicalPages;
+		physicalPagesY = physicalPages;
+		pageTable.Initialize(desc, physicalPagesX, physicalPagesY);
+		pageTable.UpdatePageTable();
+
+		GraphicsDevice* device = wiRenderer::GetDevice();
+
+		TextureDesc textureDesc;
+		textureDesc.Width = physicalPagesX * desc.GetPaddedPageSize();
+		textureDesc.Height = physicalPagesY * desc.GetPaddedPageSize();
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = FORMAT_R8G8B8A8_UNORM;
+		textureDesc.SampleCount = 1;
+		textureDesc.Usage = USAGE_DEFAULT;
+		textureDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+		textureDesc.CPUAccessFlags = 0;
+		textureDesc.MiscFlags = 0;
+		device->CreateTexture(&textureDesc, nullptr, &physicalTexture);
+		device->SetName(&physicalTexture, "VirtualTexture::physicalTexture");
+
+		GPUBufferDesc bd;
+		bd.Usage = USAGE_DEFAULT;
+		bd.BindFlags = BIND_SHADER_RESOURCE;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = RESOURCE_MISC_BUFFER_STRUCTURED;
+		bd.StructureByteStride = sizeof(uint32_t);
+		bd.ByteWidth = bd.StructureByteStride * (uint32_t)pageTable.GetEntries().size();
+		SubresourceData data;
+		data.pSysMem = pageTable.GetEntries().data();
+		device->CreateBuffer(&bd, &data, &pageTableBuffer);
+		device->SetName(&pageTableBuffer, "VirtualTexture::pageTableBuffer");
+
+		return true;
+	}
+
+	void VirtualTexture::Update(const FeedbackBuffer& feedbackBuffer, CommandList cmd)
+	{
+		GraphicsDevice* device = wiRenderer::GetDevice();
+		if (!file.IsValid() || updatedFrame == device->GetFrameCount())
+		{
+			return;
+		}
+		updatedFrame = device->GetFrameCount();
+
+		feedbackBuffer.GetPages(id, feedback);
+		pageTable.ResolveFeedback(feedback.data(), feedback.size(), requests, maxUploadsPerFrame);
+
+		// Read the requested pages from the file in parallel:
+		const TiledImageDesc& desc = file.GetDesc();
+		const size_t pageDataSize = desc.GetPageDataSize();
+		pageData.resize(requests.size() * pageDataSize);
+		std::vector<uint8_t> loaded(requests.size());
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)requests.size(), 1, [&](wiJobDispatchArgs args) {
+			loaded[args.jobIndex] = file.ReadPage(requests[args.jobIndex], pageData.data() + args.jobIndex * pageDataSize) ? 1 : 0;
+		});
+		wiJobSystem::Wait(ctx);
+
+		TextureDesc pageDesc;
+		pageDesc.Width = desc.GetPaddedPageSize();
+		pageDesc.Height = desc.GetPaddedPageSize();
+		pageDesc.MipLevels = 1;
+		pageDesc.ArraySize = 1;
+		pageDesc.Format = FORMAT_R8G8B8A8_UNORM;
+		pageDesc.SampleCount = 1;
+		pageDesc.Usage = USAGE_IMMUTABLE;
+		pageDesc.BindFlags = BIND_SHADER_RESOURCE;
+		pageDesc.CPUAccessFlags = 0;
+		pageDesc.MiscFlags = 0;
+
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			if (loaded[i] == 0)
+			{
+				continue;
+			}
+			const int slot = pageTable.MakeResident(requests[i]);
+			if (slot < 0)
+			{
+				break; // every slot is used by the current frame
+			}
+
+			// The temporary page texture is destroyed at the end of the scope, the device keeps it alive until the GPU finished the copy:
+			SubresourceData data;
+			data.pSysMem = pageData.data() + i * pageDataSize;
+			data.SysMemPitch = pageDesc.Width * 4;
+			Texture pageTexture;
+			device->CreateTexture(&pageDesc, &data, &pageTexture);
+			wiRenderer::CopyTexture2D(physicalTexture, 0, (slot % physicalPagesX) * pageDesc.Width, (slot / physicalPagesX) * pageDesc.Height, pageTexture, 0, cmd);
+		}
+
+		if (pageTable.UpdatePageTable() != 0)
+		{
+			device->UpdateBuffer(&pageTableBuffer, pageTable.GetEntries().data(), cmd);
+		}
+		pageTable.NextFrame();
+	}
+
+	std::shared_ptr<VirtualTexture> Load(const std::string& fileName)
+	{
+		static std::mutex locker;
+		static std::unordered_map<std::string, std::weak_ptr<VirtualTexture>> opened;
+		std::lock_guard<std::mutex> lock(locker);
+
+		std::shared_ptr<VirtualTexture> virtualTexture = opened[fileName].lock();
+		if (virtualTexture == nullptr)
+		{
+			virtualTexture = std::make_shared<VirtualTexture>();
+			if (!virtualTexture->Create(fileName))
+			{
+				opened.erase(fileName);
+				return nullptr;
+			}
+			opened[fileName] = virtualTexture;
+		}
+		return virtualTexture;
+	}
+}
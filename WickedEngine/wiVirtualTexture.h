@@ -0,0 +1,184 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiGraphicsDevice.h"
+#include "ShaderInterop_VirtualTexture.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <memory>
+
+// Virtual texturing: large images are split into fixed size pages, and only the pages that are needed are kept in GPU memory
+//	Tiled image:	every mip level is cut into pages with a border for filtering, and stored in a file (CreateTiledImage)
+//	PageTable:		CPU side residency of the pages in the slots of the physical page cache with LRU eviction, it doesn't need a graphics device
+//	VirtualTexture:	GPU resources (physical page cache, page table buffer) and page streaming from the tiled image file
+//	FeedbackBuffer:	the pages that the object shaders requested for every virtual texture, read back from the GPU
+namespace wiVirtualTexture
+{
+	struct TiledImageDesc
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t pageSize = 128;	// page size without the border
+		uint32_t border = 4;		// border pixels on each side of a page
+		uint32_t mipCount = 0;		// down to the mip level that fits into a single page
+
+		// Number of pages of a mip level
+		uint32_t GetPageCountX(uint32_t mip) const;
+		uint32_t GetPageCountY(uint32_t mip) const;
+		// Number of pages in all mip levels
+		uint32_t GetPageCount() const;
+		// Linear index of a packed page ID, this is the position of the page in the file and in the page table
+		uint32_t GetPageIndex(uint32_t page) const;
+		// Page size with the borders
+		uint32_t GetPaddedPageSize() const { return pageSize + border * 2; }
+		// Size of one RGBA8 page with the borders in bytes
+		size_t GetPageDataSize() const { return (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4; }
+	};
+	// Fill the mipCount of the description from the size and page size
+	void ComputeMipCount(TiledImageDesc& desc);
+
+	// Offline tiling of an RGBA8 image, the result is the contents of a tiled image file
+	//	The mip levels are generated with wiMipGenerator. The image size doesn't need to be a multiple of the page size,
+	//	the borders and the pages at the edges are filled by repeating the edge pixels of the mip level.
+	void CreateTiledImage(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t pageSize, uint32_t border, std::vector<uint8_t>& result);
+
+	// Random access reader of tiled image files, pages can be read from multiple threads
+	class TiledImageFile
+	{
+	private:
+		std::ifstream file;
+		std::mutex locker;
+		TiledImageDesc desc;
+	public:
+		bool Open(const std::string& fileName);
+		bool IsValid() const { return desc.mipCount > 0; }
+		const TiledImageDesc& GetDesc() const { return desc; }
+		// Read a page with the borders, dest must be able to hold GetDesc().GetPageDataSize() bytes
+		bool ReadPage(uint32_t page, uint8_t* dest);
+	};
+
+	// Residency of the pages in the physical page cache
+	//	The single page of the last mip level is always resident, so every page table entry has a valid fallback.
+	class PageTable
+	{
+	private:
+		struct Page
+		{
+			int slot = -1;
+			uint32_t lastUsedFrame = 0;
+		};
+		TiledImageDesc desc;
+		uint32_t physicalPagesX = 0;
+		uint32_t physicalPagesY = 0;
+		uint32_t frame = 1;
+		std::vector<Page> pages;		// indexed by the linear page index
+		std::vector<uint32_t> slots;	// resident page ID of every slot, or VIRTUALTEXTURE_INVALID_PAGE
+		std::vector<uint32_t> requestCounts;
+		std::vector<uint32_t> entries;	// page table entries of all mip levels
+		uint32_t dirtyMips = 0;
+		uint32_t residentCount = 0;
+
+		void Touch(uint32_t page);
+	public:
+		// physicalPagesX, physicalPagesY: the page cache has this many slots, at most 256 along each axis
+		void Initialize(const TiledImageDesc& desc, uint32_t physicalPagesX, uint32_t physicalPagesY);
+		const TiledImageDesc& GetDesc() const { return desc; }
+
+		// Resolve the GPU feedback, feedback contains page IDs (or VIRTUALTEXTURE_INVALID_PAGE for pixels without a request)
+		//	The requested pages and their parents are marked as used in the current frame.
+		//	The pages that are not resident are returned in priority order: lower resolution first, then the most requested.
+		//	maxRequests	: the number of returned requests is limited to this
+		void ResolveFeedback(const uint32_t* feedback, size_t count, std::vector<uint32_t>& requests, size_t maxRequests = SIZE_MAX);
+		// Map a page into a slot of the physical page cache
+		//	If the cache is full, the least recently used page that wasn't used in the current frame is evicted
+		//	returns the slot index (slotX + slotY * physicalPagesX), or -1 if every slot is used in this frame
+		int MakeResident(uint32_t page);
+		// Remove a page from the page cache
+		void Evict(uint32_t page);
+		bool IsResident(uint32_t page) const;
+		// Returns the slot of a resident page or -1
+		int GetSlot(uint32_t page) const;
+		uint32_t GetResidentCount() const { return residentCount; }
+		uint32_t GetSlotCount() const { return (uint32_t)slots.size(); }
+		// Advance the LRU clock, call it once per frame after the feedback was resolved and the pages were made resident
+		void NextFrame() { frame++; }
+		uint32_t GetFrame() const { return frame; }
+
+		// Rebuild the page table entries of the mip levels that changed since the last update
+		//	Every entry refers to the slot of its page, or to the slot of the closest resident parent page.
+		//	returns a bitmask of the mip levels that were updated
+		uint32_t UpdatePageTable();
+		// Page table entries of every mip level, in the layout of the GPU page table buffer
+		const std::vector<uint32_t>& GetEntries() const { return entries; }
+		uint32_t GetEntry(uint32_t page) const { return entries[desc.GetPageIndex(page)]; }
+	};
+
+	// Screen space feedback of every virtual texture
+	//	The object shaders write uint2(virtual texture ID, page ID) into a VIRTUALTEXTURE_FEEDBACK_SIZE * VIRTUALTEXTURE_FEEDBACK_SIZE grid (RWStructuredBuffer<uint2>).
+	//	The feedback is copied into a ring of readback buffers on the GPU timeline, and the CPU reads the oldest one,
+	//	so the CPU never waits for the frame that is still in flight.
+	class FeedbackBuffer
+	{
+	private:
+		static const uint32_t READBACK_COUNT = wiGraphics::GraphicsDevice::BACKBUFFER_COUNT;
+		wiGraphics::GPUBuffer buffer;
+		wiGraphics::GPUBuffer readbackBuffers[READBACK_COUNT];
+		wiGraphics::GPUBuffer resolveBuffer;
+		uint64_t frame = 0;
+		std::vector<uint32_t> data;
+	public:
+		void Create();
+		bool IsValid() const { return buffer.IsValid(); }
+
+		// Read back the feedback of an earlier frame, then copy the feedback of the previous frame into the ring and clear it for the next frame
+		//	The feedback is read with READBACK_COUNT - 1 frames of additional latency, so this doesn't wait for the GPU
+		void Update(wiGraphics::CommandList cmd);
+		// Collect the page IDs that were requested for a virtual texture in the feedback that the last Update() read back
+		void GetPages(uint32_t id, std::vector<uint32_t>& pages) const;
+
+		// Bound by wiRenderer to UAVSLOT_RENDERER_VIRTUALTEXTURE_FEEDBACK for the main scene render passes
+		const wiGraphics::GPUBuffer* GetBuffer() const { return &buffer; }
+	};
+
+	// GPU side of a virtual texture
+	//	Update() streams the requested pages from the tiled image file into the physical page cache texture,
+	//	and uploads the page table when it changed.
+	class VirtualTexture
+	{
+	private:
+		TiledImageFile file;
+		PageTable pageTable;
+		wiGraphics::Texture physicalTexture;
+		wiGraphics::GPUBuffer pageTableBuffer;
+		uint32_t id = 0;
+		uint64_t updatedFrame = ~0ull;
+		std::vector<uint32_t> feedback;
+		std::vector<uint32_t> requests;
+		std::vector<uint8_t> pageData;
+		uint32_t physicalPagesX = 0;
+		uint32_t physicalPagesY = 0;
+		uint32_t maxUploadsPerFrame = 16;
+	public:
+		// fileName			: tiled image file created by CreateTiledImage
+		// physicalPages	: the physical page cache has physicalPages * physicalPages slots
+		bool Create(const std::string& fileName, uint32_t physicalPages = 16);
+
+		// Resolve the feedback of this virtual texture, load the requested pages and upload the changes
+		//	It only runs once per frame, even if the virtual texture is shared by multiple materials
+		void Update(const FeedbackBuffer& feedbackBuffer, wiGraphics::CommandList cmd);
+		void SetMaxUploadsPerFrame(uint32_t value) { maxUploadsPerFrame = value; }
+
+		// Identifies the virtual texture in the feedback buffer, it is never 0
+		uint32_t GetID() const { return id; }
+		const wiGraphics::Texture* GetPhysicalTexture() const { return &physicalTexture; }
+		// StructuredBuffer<uint> with the page table entries of every mip level
+		const wiGraphics::GPUBuffer* GetPageTableBuffer() const { return &pageTableBuffer; }
+		const PageTable& GetPageTable() const { return pageTable; }
+	};
+
+	// Open a virtual texture from a tiled image file, materials that refer to the same file share it
+	//	returns nullptr if the file can't be opened
+	std::shared_ptr<VirtualTexture> Load(const std::string& fileName);
+}
@@ -0,0 +1,1270 @@
+#include "wiVorbis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace wiVorbis
+{
+	static const uint32_t FAST_BITS = 10;	// codewords up to this length are decoded with one table lookup
+
+	inline uint32_t ilog(uint32_t value)
+	{
+		uint32_t bits = 0;
+		while (value > 0)
+		{
+			bits++;
+			value >>= 1;
+		}
+		return bits;
+	}
+	inline float float32_unpack(uint32_t value)
+	{
+		const double mantissa = double(value & 0x1FFFFF);
+		const int exponent = int((value & 0x7FE00000) >> 21);
+		return float(std::ldexp((value & 0x80000000) ? -mantissa : mantissa, exponent - 788));
+	}
+	// The largest value whose dimensions-th power is not greater than entries
+	inline uint32_t lookup1_values(uint32_t entries, uint32_t dimensions)
+	{
+		auto power = [&](uint64_t base) {
+			uint64_t result = 1;
+			for (uint32_t i = 0; i < dimensions && result <= entries; ++i)
+			{
+				result *= base;
+			}
+			return result;
+		};
+		uint32_t value = (uint32_t)std::floor(std::pow((double)entries, 1.0 / dimensions));
+		while (power(value + 1) <= entries)
+		{
+			value++;
+		}
+		while (value > 0 && power(value) > entries)
+		{
+			value--;
+		}
+		return value;
+	}
+	inline uint32_t reverse_bits(uint32_t value, uint32_t count)
+	{
+		uint32_t result = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			result = (result << 1) | ((value >> i) & 1);
+		}
+		return result;
+	}
+	template<typename T>
+	inline T read_value(const uint8_t* data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	// Floor 1 amplitudes, from -140 dB (index 0) to 0 dB (index 255)
+	static const struct InverseDBTable
+	{
+		float values[256];
+		InverseDBTable()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				values[i] = float(1.0649863e-07 * std::pow(1.0 / 1.0649863e-07, i / 255.0));
+			}
+		}
+	} inverseDB;
+
+	// Vorbis packs the values from the least significant bit of every byte, reading after the end of the packet returns zeros
+	struct Decoder::BitReader
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		size_t bit = 0;
+		bool end = false;
+
+		BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+		uint32_t Peek(uint32_t count) const
+		{
+			const size_t byte = bit >> 3;
+			uint64_t value = 0;
+			for (size_t i = 0; i < 5 && byte + i < size; ++i)
+			{
+				value |= uint64_t(data[byte + i]) << (i * 8);
+			}
+			return uint32_t((value >> (bit & 7)) & ((1ull << count) - 1));
+		}
+		void Skip(uint32_t count)
+		{
+			bit += count;
+			end = end || bit > size * 8;
+		}
+		uint32_t Read(uint32_t count)
+		{
+			if (count == 0)
+			{
+				return 0;
+			}
+			const uint32_t value = Peek(count);
+			Skip(count);
+			return end ? 0 : value;
+		}
+		bool ReadFlag()
+		{
+			return Read(1) != 0;
+		}
+		// Returns the entry of the next codeword, or -1 at the end of the packet
+		int DecodeEntry(const Codebook& book)
+		{
+			if (book.single >= 0)
+			{
+				Skip(book.lengths[book.single]);
+				return end ? -1 : book.single;
+			}
+			if (book.fast.empty())
+			{
+				return -1;
+			}
+			const int32_t fast = book.fast[Peek(FAST_BITS)];
+			if (fast >= 0)
+			{
+				Skip(uint32_t(fast & 31));
+				return end ? -1 : (fast >> 5);
+			}
+			int32_t node = 0;
+			for (int i = 0; i < 32; ++i)
+			{
+				const int32_t child = book.tree[node * 2 + Read(1)];
+				if (end || child == 0)
+				{
+					return -1;
+				}
+				if (child < 0)
+				{
+					return -1 - child;
+				}
+				node = child;
+			}
+			return -1;
+		}
+	};
+
+	bool Decoder::Open(const uint8_t* data, size_t size)
+	{
+		*this = Decoder();
+		this->data = data;
+		dataSize = size;
+
+		// Index the pages of the first logical stream:
+		static const char capture[] = "OggS";
+		uint32_t serial = 0;
+		size_t offset = 0;
+		while (offset + 27 <= size)
+		{
+			const uint8_t* header = data + offset;
+			if (memcmp(header, capture, 4) != 0 || header[4] != 0)
+			{
+				// Lost the capture pattern, continue with the next page:
+				offset = size_t(std::search(header + 1, data + size, capture, capture + 4) - data);
+				continue;
+			}
+			const uint8_t flags = header[5];
+			const uint32_t segmentCount = header[26];
+			if (offset + 27 + segmentCount > size)
+			{
+				break;
+			}
+			Page page;
+			page.segmentTable = offset + 27;
+			page.data = page.segmentTable + segmentCount;
+			page.segmentCount = segmentCount;
+			size_t bodySize = 0;
+			for (uint32_t i = 0; i < segmentCount; ++i)
+			{
+				const uint8_t lacing = data[page.segmentTable + i];
+				bodySize += lacing;
+				if (lacing < 255)
+				{
+					page.lastPacketEnd = i + 1;
+				}
+			}
+			if (page.data + bodySize > size)
+			{
+				break;
+			}
+			offset = page.data + bodySize;
+
+			if (pages.empty())
+			{
+				if ((flags & 0x02) == 0)
+				{
+					return false; // the first page must begin a stream
+				}
+				serial = read_value<uint32_t>(header + 14);
+			}
+			else if (read_value<uint32_t>(header + 14) != serial)
+			{
+				continue;
+			}
+			page.granule = page.lastPacketEnd > 0 ? read_value<int64_t>(header + 6) : -1;
+			page.last = (flags & 0x04) != 0;
+			pages.push_back(page);
+			if (page.last)
+			{
+				break;
+			}
+		}
+		if (pages.empty())
+		{
+			return false;
+		}
+		cursor.offset = pages[0].data;
+
+		if (!ReadHeaders())
+		{
+			*this = Decoder();
+			return false;
+		}
+		audioBegin = cursor;
+
+		for (auto it = pages.rbegin(); it != pages.rend(); ++it)
+		{
+			if (it->granule >= 0)
+			{
+				frameCount = (uint64_t)std::max(int64_t(0), it->granule);
+				break;
+			}
+		}
+
+		// The inverse MDCT is computed as a DCT-IV of blocksize / 2 values, with an FFT of blocksize / 4 values:
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			const uint32_t n = blocksize[i];
+			const uint32_t n4 = n / 4;
+			preTwiddle[i].resize(n4);
+			postTwiddle[i].resize(n4);
+			fftTwiddle[i].resize(n4 / 2);
+			bitReverse[i].resize(n4);
+			window[i].resize(n / 2);
+			for (uint32_t j = 0; j < n4; ++j)
+			{
+				preTwiddle[i][j] = std::polar(1.0f, float(-XM_PI * (4 * j + 1) / (2.0 * n)));
+				postTwiddle[i][j] = std::polar(1.0f, float(-2 * XM_PI * j / n));
+				bitReverse[i][j] = reverse_bits(j, ilog(n4) - 1);
+			}
+			for (uint32_t j = 0; j < n4 / 2; ++j)
+			{
+				fftTwiddle[i][j] = std::polar(1.0f, float(-2 * XM_PI * j / n4));
+			}
+			for (uint32_t j = 0; j < n / 2; ++j)
+			{
+				const double x = std::sin((j + 0.5) / (n / 2) * XM_PIDIV2);
+				window[i][j] = float(std::sin(XM_PIDIV2 * x * x));
+			}
+		}
+
+		previous.resize(channels);
+		floorCurve.resize(channels);
+		residue.resize(channels);
+		for (uint32_t i = 0; i < channels; ++i)
+		{
+			previous[i].resize(blocksize[1] / 2);
+			floorCurve[i].resize(blocksize[1] / 2);
+			residue[i].resize(blocksize[1] / 2);
+		}
+		block.resize(blocksize[1]);
+		dct.resize(blocksize[1] / 2);
+		scratch.resize(blocksize[1] / 4);
+		output.resize(blocksize[1] / 2 * channels);
+
+		Restart(audioBegin);
+		position = 0;
+		return true;
+	}
+
+	bool Decoder::ReadPacket(Cursor& at, std::vector<uint8_t>& dst, int64_t& granule)
+	{
+		dst.clear();
+		granule = -1;
+		while (at.page < pages.size())
+		{
+			const Page& page = pages[at.page];
+			while (at.segment < page.segmentCount)
+			{
+				const uint8_t lacing = data[page.segmentTable + at.segment];
+				dst.insert(dst.end(), data + at.offset, data + at.offset + lacing);
+				at.offset += lacing;
+				at.segment++;
+				if (lacing < 255)
+				{
+					if (at.segment == page.lastPacketEnd)
+					{
+						granule = page.granule;
+					}
+					return true;
+				}
+			}
+			at.page++;
+			at.segment = 0;
+			if (at.page < pages.size())
+			{
+				at.offset = pages[at.page].data;
+			}
+		}
+		return false;
+	}
+
+	bool Decoder::ReadHeaders()
+	{
+		int64_t granule;
+		BitReader bits(nullptr, 0);
+		auto header = [&](uint8_t type) {
+			if (!ReadPacket(cursor, packet, granule) || packet.size() < 7 || packet[0] != type || memcmp(packet.data() + 1, "vorbis", 6) != 0)
+			{
+				return false;
+			}
+			bits = BitReader(packet.data() + 7, packet.size() - 7);
+			return true;
+		};
+
+		// Identification header:
+		if (!header(1) || bits.Read(32) != 0)
+		{
+			return false;
+		}
+		channels = bits.Read(8);
+		sampleRate = bits.Read(32);
+		bits.Read(32); // maximum bitrate
+		bits.Read(32); // nominal bitrate
+		bits.Read(32); // minimum bitrate
+		blocksize[0] = 1u << bits.Read(4);
+		blocksize[1] = 1u << bits.Read(4);
+		if (channels == 0 || sampleRate == 0 || blocksize[0] < 64 || blocksize[0] > blocksize[1] || blocksize[1] > 8192 || !bits.ReadFlag() || bits.end)
+		{
+			return false;
+		}
+
+		// Comment header, the tags are not used:
+		if (!header(3))
+		{
+			return false;
+		}
+
+		// Setup header:
+		if (!header(5))
+		{
+			return false;
+		}
+
+		codebooks.resize(bits.Read(8) + 1);
+		for (Codebook& book : codebooks)
+		{
+			if (bits.Read(24) != 0x564342) // "BCV"
+			{
+				return false;
+			}
+			book.dimensions = bits.Read(16);
+			book.entries = bits.Read(24);
+			book.lengths.resize(book.entries);
+			if (bits.ReadFlag())
+			{
+				// Ordered, the entries are in the order of increasing codeword length:
+				uint32_t entry = 0;
+				uint32_t length = bits.Read(5) + 1;
+				while (entry < book.entries)
+				{
+					const uint32_t count = bits.Read(ilog(book.entries - entry));
+					if (length > 32 || count > book.entries - entry || bits.end)
+					{
+						return false;
+					}
+					std::fill(book.lengths.begin() + entry, book.lengths.begin() + entry + count, uint8_t(length));
+					entry += count;
+					length++;
+				}
+			}
+			else
+			{
+				const bool sparse = bits.ReadFlag();
+				for (uint32_t i = 0; i < book.entries && !bits.end; ++i)
+				{
+					book.lengths[i] = (!sparse || bits.ReadFlag()) ? uint8_t(bits.Read(5) + 1) : 0;
+				}
+			}
+
+			const uint32_t lookupType = bits.Read(4);
+			if (lookupType == 1 || lookupType == 2)
+			{
+				const float minimum = float32_unpack(bits.Read(32));
+				const float delta = float32_unpack(bits.Read(32));
+				const uint32_t valueBits = bits.Read(4) + 1;
+				const bool sequence = bits.ReadFlag();
+				if (book.dimensions == 0 || uint64_t(book.entries) * book.dimensions > (1u << 24))
+				{
+					return false;
+				}
+				const uint32_t lookupValues = lookupType == 1 ? lookup1_values(book.entries, book.dimensions) : book.entries * book.dimensions;
+				std::vector<uint32_t> multiplicands(lookupValues);
+				for (uint32_t& x : multiplicands)
+				{
+					x = bits.Read(valueBits);
+				}
+				if (bits.end || lookupValues == 0)
+				{
+					return false;
+				}
+				book.vectors.resize(book.entries * book.dimensions);
+				for (uint32_t entry = 0; entry < book.entries; ++entry)
+				{
+					float last = 0;
+					uint32_t divisor = 1;
+					for (uint32_t i = 0; i < book.dimensions; ++i)
+					{
+						const uint32_t index = lookupType == 1 ? (entry / divisor) % lookupValues : entry * book.dimensions + i;
+						const float value = multiplicands[index] * delta + minimum + last;
+						book.vectors[entry * book.dimensions + i] = value;
+						if (sequence)
+						{
+							last = value;
+						}
+						divisor *= lookupValues;
+					}
+				}
+			}
+			else if (lookupType != 0)
+			{
+				return false;
+			}
+			if (bits.end)
+			{
+				return false;
+			}
+
+			// The codewords are assigned in the order of the entries, every codeword is the lowest available one of its length:
+			uint32_t used = 0;
+			for (uint32_t i = 0; i < book.entries; ++i)
+			{
+				if (book.lengths[i] > 0)
+				{
+					used++;
+					book.single = (int32_t)i;
+				}
+			}
+			if (used != 1)
+			{
+				book.single = -1;
+			}
+			if (used < 2)
+			{
+				continue;
+			}
+			uint32_t marker[33] = {};
+			book.fast.assign(1u << FAST_BITS, -1);
+			book.tree.assign(2, 0);
+			for (uint32_t i = 0; i < book.entries; ++i)
+			{
+				const uint32_t length = book.lengths[i];
+				if (length == 0)
+				{
+					continue;
+				}
+				const uint32_t codeword = marker[length];
+				if (length < 32 && (codeword >> length) != 0)
+				{
+					return false; // overspecified tree
+				}
+				for (uint32_t j = length; j > 0; --j)
+				{
+					if (marker[j] & 1)
+					{
+						marker[j] = j == 1 ? marker[1] + 1 : marker[j - 1] << 1;
+						break;
+					}
+					marker[j]++;
+				}
+				uint32_t branch = codeword;
+				for (uint32_t j = length + 1; j < 33 && (marker[j] >> 1) == branch; ++j)
+				{
+					branch = marker[j];
+					marker[j] = marker[j - 1] << 1;
+				}
+
+				// The codeword is read from its most significant bit, which is the first bit in the stream:
+				if (length <= FAST_BITS)
+				{
+					for (uint32_t bits = reverse_bits(codeword, length); bits < (1u << FAST_BITS); bits += 1u << length)
+					{
+						book.fast[bits] = int32_t(i << 5 | length);
+					}
+				}
+				int32_t node = 0;
+				for (uint32_t j = length - 1; j > 0; --j)
+				{
+					int32_t& child = book.tree[node * 2 + ((codeword >> j) & 1)];
+					if (child < 0)
+					{
+						return false;
+					}
+					if (child == 0)
+					{
+						child = int32_t(book.tree.size() / 2);
+						book.tree.push_back(0);
+						book.tree.push_back(0);
+						node = int32_t(book.tree.size() / 2 - 1);
+					}
+					else
+					{
+						node = child;
+					}
+				}
+				book.tree[node * 2 + (codeword & 1)] = -1 - int32_t(i);
+			}
+		}
+
+		// Time domain transforms, only placeholders in Vorbis I:
+		const uint32_t timeCount = bits.Read(6) + 1;
+		for (uint32_t i = 0; i < timeCount; ++i)
+		{
+			if (bits.Read(16) != 0)
+			{
+				return false;
+			}
+		}
+
+		floors.resize(bits.Read(6) + 1);
+		for (Floor& floor : floors)
+		{
+			if (bits.Read(16) != 1)
+			{
+				return false; // floor 0 is not supported
+			}
+			floor.partitionClass.resize(bits.Read(5));
+			int maxClass = -1;
+			for (uint8_t& x : floor.partitionClass)
+			{
+				x = (uint8_t)bits.Read(4);
+				maxClass = std::max(maxClass, (int)x);
+			}
+			for (int i = 0; i <= maxClass; ++i)
+			{
+				floor.classDimensions[i] = uint8_t(bits.Read(3) + 1);
+				floor.classSubclasses[i] = (uint8_t)bits.Read(2);
+				floor.classMasterbook[i] = floor.classSubclasses[i] > 0 ? (int16_t)bits.Read(8) : -1;
+				for (uint32_t j = 0; j < (1u << floor.classSubclasses[i]); ++j)
+				{
+					floor.subclassBooks[i][j] = int16_t(bits.Read(8)) - 1;
+					if (floor.subclassBooks[i][j] >= (int)codebooks.size())
+					{
+						return false;
+					}
+				}
+				if (floor.classMasterbook[i] >= (int)codebooks.size())
+				{
+					return false;
+				}
+			}
+			floor.multiplier = bits.Read(2) + 1;
+			const uint32_t rangeBits = bits.Read(4);
+			floor.x.push_back(0);
+			floor.x.push_back(1u << rangeBits);
+			for (uint8_t x : floor.partitionClass)
+			{
+				for (uint32_t j = 0; j < floor.classDimensions[x]; ++j)
+				{
+					floor.x.push_back(bits.Read(rangeBits));
+				}
+			}
+			if (floor.x.size() > 65 || bits.end)
+			{
+				return false;
+			}
+			const uint32_t count = (uint32_t)floor.x.size();
+			floor.sorted.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				floor.sorted[i] = i;
+			}
+			std::sort(floor.sorted.begin(), floor.sorted.end(), [&](uint32_t a, uint32_t b) { return floor.x[a] < floor.x[b]; });
+			for (uint32_t i = 1; i < count; ++i)
+			{
+				if (floor.x[floor.sorted[i]] == floor.x[floor.sorted[i - 1]])
+				{
+					return false;
+				}
+			}
+			floor.lowNeighbor.resize(count);
+			floor.highNeighbor.resize(count);
+			for (uint32_t i = 2; i < count; ++i)
+			{
+				uint32_t low = 0;
+				uint32_t high = 1;
+				for (uint32_t j = 0; j < i; ++j)
+				{
+					if (floor.x[j] < floor.x[i] && floor.x[j] > floor.x[low])
+					{
+						low = j;
+					}
+					if (floor.x[j] > floor.x[i] && floor.x[j] < floor.x[high])
+					{
+						high = j;
+					}
+				}
+				floor.lowNeighbor[i] = low;
+				floor.highNeighbor[i] = high;
+			}
+		}
+
+		residues.resize(bits.Read(6) + 1);
+		for (Residue& residue : residues)
+		{
+			residue.type = bits.Read(16);
+			residue.begin = bits.Read(24);
+			residue.end = bits.Read(24);
+			residue.partitionSize = bits.Read(24) + 1;
+			residue.classifications = bits.Read(6) + 1;
+			residue.classbook = bits.Read(8);
+			if (residue.type > 2 || residue.classbook >= codebooks.size() || codebooks[residue.classbook].dimensions == 0)
+			{
+				return false;
+			}
+			uint32_t cascade[64];
+			for (uint32_t i = 0; i < residue.classifications; ++i)
+			{
+				cascade[i] = bits.Read(3);
+				if (bits.ReadFlag())
+				{
+					cascade[i] |= bits.Read(5) << 3;
+				}
+			}
+			for (uint32_t i = 0; i < residue.classifications; ++i)
+			{
+				for (uint32_t j = 0; j < 8; ++j)
+				{
+					residue.books[i][j] = -1;
+					if (cascade[i] & (1u << j))
+					{
+						residue.books[i][j] = (int16_t)bits.Read(8);
+						if (residue.books[i][j] >= (int)codebooks.size() || codebooks[residue.books[i][j]].vectors.empty())
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		mappings.resize(bits.Read(6) + 1);
+		for (Mapping& mapping : mappings)
+		{
+			if (bits.Read(16) != 0)
+			{
+				return false;
+			}
+			const uint32_t submaps = bits.ReadFlag() ? bits.Read(4) + 1 : 1;
+			if (bits.ReadFlag())
+			{
+				const uint32_t steps = bits.Read(8) + 1;
+				for (uint32_t i = 0; i < steps; ++i)
+				{
+					mapping.magnitude.push_back((uint8_t)bits.Read(ilog(channels - 1)));
+					mapping.angle.push_back((uint8_t)bits.Read(ilog(channels - 1)));
+					if (mapping.magnitude.back() == mapping.angle.back() || mapping.magnitude.back() >= channels || mapping.angle.back() >= channels)
+					{
+						return false;
+					}
+				}
+			}
+			if (bits.Read(2) != 0)
+			{
+				return false;
+			}
+			mapping.mux.resize(channels);
+			for (uint8_t& x : mapping.mux)
+			{
+				x = submaps > 1 ? (uint8_t)bits.Read(4) : 0;
+				if (x >= submaps)
+				{
+					return false;
+				}
+			}
+			for (uint32_t i = 0; i < submaps; ++i)
+			{
+				bits.Read(8); // unused time configuration
+				mapping.submapFloor.push_back((uint8_t)bits.Read(8));
+				mapping.submapResidue.push_back((uint8_t)bits.Read(8));
+				if (mapping.submapFloor.back() >= floors.size() || mapping.submapResidue.back() >= residues.size())
+				{
+					return false;
+				}
+			}
+		}
+
+		modes.resize(bits.Read(6) + 1);
+		for (Mode& mode : modes)
+		{
+			mode.blockflag = bits.ReadFlag();
+			const uint32_t windowType = bits.Read(16);
+			const uint32_t transformType = bits.Read(16);
+			mode.mapping = bits.Read(8);
+			if (windowType != 0 || transformType != 0 || mode.mapping >= mappings.size())
+			{
+				return false;
+			}
+		}
+
+		return bits.ReadFlag() && !bits.end;
+	}
+
+	uint32_t Decoder::GetPacketBlocksize(const std::vector<uint8_t>& src) const
+	{
+		BitReader bits(src.data(), src.size());
+		if (src.empty() || bits.ReadFlag())
+		{
+			return 0; // empty packets and header packets don't have audio
+		}
+		const uint32_t mode = bits.Read(ilog((uint32_t)modes.size() - 1));
+		return mode < modes.size() && !bits.end ? blocksize[modes[mode].blockflag] : 0;
+	}
+
+	bool Decoder::Restart(const Cursor& at)
+	{
+		cursor = at;
+		previousSize = 0;
+		outputOffset = 0;
+		outputCount = 0;
+		outputPosition = 0;
+
+		// The first granule position after the cursor gives the frame of the first decoded block:
+		//	every block returns the frames from the middle of the previous block until the middle of the block
+		Cursor scan = at;
+		int64_t granule;
+		int64_t frames = 0;
+		uint32_t previousBlocksize = 0;
+		while (ReadPacket(scan, packet, granule))
+		{
+			const uint32_t n = GetPacketBlocksize(packet);
+			if (n > 0)
+			{
+				if (previousBlocksize > 0)
+				{
+					frames += previousBlocksize / 4 + n / 4;
+				}
+				previousBlocksize = n;
+			}
+			if (granule >= 0 && previousBlocksize > 0)
+			{
+				// The granule position of the last page can be lower to cut the end of the stream, then it doesn't give the start:
+				const bool start = at.page == audioBegin.page && at.segment == audioBegin.segment;
+				if (pages[scan.page].last)
+				{
+					return start;
+				}
+				outputPosition = granule - frames;
+				return true;
+			}
+		}
+		return true;
+	}
+
+	size_t Decoder::Decode(float* dst, size_t frames)
+	{
+		size_t done = 0;
+		while (done < frames && IsValid())
+		{
+			if (outputOffset >= outputCount)
+			{
+				if (!DecodePacket())
+				{
+					break;
+				}
+				continue;
+			}
+			const size_t count = std::min(frames - done, outputCount - outputOffset);
+			memcpy(dst + done * channels, output.data() + outputOffset * channels, count * channels * sizeof(float));
+			outputOffset += count;
+			done += count;
+			position += count;
+		}
+		return done;
+	}
+
+	void Decoder::Seek(uint64_t frame)
+	{
+		if (!IsValid())
+		{
+			return;
+		}
+		frame = std::min(frame, frameCount);
+
+		// Inside the decoded block, or shortly after it:
+		const int64_t blockBegin = outputPosition - (int64_t)outputCount;
+		if ((int64_t)frame >= blockBegin && frame >= position && (int64_t)frame < outputPosition + blocksize[1])
+		{
+			std::vector<float> discard(blocksize[1] * channels);
+			while (position < frame && Decode(discard.data(), std::min(size_t(frame - position), (size_t)blocksize[1])) > 0);
+			return;
+		}
+
+		// Restart after the last packet of the last page that ends at least half a long block before the frame,
+		//	the first decoded block can start that much later than the granule position of the page:
+		position = frame;
+		for (uint32_t i = (uint32_t)pages.size(); i > audioBegin.page; --i)
+		{
+			const Page& page = pages[i - 1];
+			if (page.granule < 0 || page.granule + blocksize[1] / 2 > (int64_t)frame || (i - 1 == audioBegin.page && page.lastPacketEnd < audioBegin.segment))
+			{
+				continue;
+			}
+			Cursor start;
+			start.page = i - 1;
+			start.segment = page.lastPacketEnd;
+			start.offset = page.data;
+			for (uint32_t j = 0; j < page.lastPacketEnd; ++j)
+			{
+				start.offset += data[page.segmentTable + j];
+			}
+			if (Restart(start))
+			{
+				return;
+			}
+		}
+		Restart(audioBegin);
+	}
+
+	bool Decoder::DecodePacket()
+	{
+		int64_t granule;
+		while (ReadPacket(cursor, packet, granule))
+		{
+			BitReader bits(packet.data(), packet.size());
+			if (packet.empty() || bits.ReadFlag())
+			{
+				continue;
+			}
+			const uint32_t modeNumber = bits.Read(ilog((uint32_t)modes.size() - 1));
+			if (modeNumber >= modes.size() || bits.end)
+			{
+				continue;
+			}
+			const Mode& mode = modes[modeNumber];
+			const Mapping& mapping = mappings[mode.mapping];
+			const uint32_t n = blocksize[mode.blockflag];
+			const uint32_t half = n / 2;
+			bool previousLong = true;
+			bool nextLong = true;
+			if (mode.blockflag)
+			{
+				previousLong = bits.ReadFlag();
+				nextLong = bits.ReadFlag();
+			}
+
+			// Floor curves, the channels without floor are silent:
+			bool silent[256];
+			bool skip[256];
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				silent[c] = !DecodeFloor(floors[mapping.submapFloor[mapping.mux[c]]], bits, floorCurve[c], half);
+				skip[c] = silent[c];
+			}
+			for (size_t i = 0; i < mapping.magnitude.size(); ++i)
+			{
+				if (!skip[mapping.magnitude[i]] || !skip[mapping.angle[i]])
+				{
+					skip[mapping.magnitude[i]] = false;
+					skip[mapping.angle[i]] = false;
+				}
+			}
+
+			// Residue vectors of every submap:
+			for (size_t submap = 0; submap < mapping.submapResidue.size(); ++submap)
+			{
+				std::vector<float>* vectors[256];
+				bool submapSkip[256];
+				uint32_t count = 0;
+				for (uint32_t c = 0; c < channels; ++c)
+				{
+					if (mapping.mux[c] == submap)
+					{
+						std::fill(residue[c].begin(), residue[c].begin() + half, 0.0f);
+						vectors[count] = &residue[c];
+						submapSkip[count] = skip[c];
+						count++;
+					}
+				}
+				DecodeResidue(residues[mapping.submapResidue[submap]], bits, half, count, vectors, submapSkip);
+			}
+
+			// Inverse channel coupling:
+			for (size_t i = mapping.magnitude.size(); i > 0; --i)
+			{
+				float* magnitude = residue[mapping.magnitude[i - 1]].data();
+				float* angle = residue[mapping.angle[i - 1]].data();
+				for (uint32_t j = 0; j < half; ++j)
+				{
+					const float m = magnitude[j];
+					const float a = angle[j];
+					if (m > 0)
+					{
+						magnitude[j] = a > 0 ? m : m + a;
+						angle[j] = a > 0 ? m - a : m;
+					}
+					else
+					{
+						magnitude[j] = a > 0 ? m : m - a;
+						angle[j] = a > 0 ? m + a : m;
+					}
+				}
+			}
+
+			// Spectrum, inverse MDCT, window and overlap with the previous block:
+			const uint32_t leftSize = mode.blockflag && !previousLong ? blocksize[0] / 2 : half;
+			const uint32_t rightSize = mode.blockflag && !nextLong ? blocksize[0] / 2 : half;
+			const uint32_t leftBegin = n / 4 - leftSize / 2;
+			const uint32_t rightBegin = n * 3 / 4 - rightSize / 2;
+			const float* leftWindow = window[leftSize == half ? mode.blockflag : 0].data();
+			const float* rightWindow = window[rightSize == half ? mode.blockflag : 0].data();
+			const uint32_t count = previousSize > 0 ? previousSize / 4 + n / 4 : 0;
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				float* spectrum = residue[c].data();
+				for (uint32_t j = 0; j < half; ++j)
+				{
+					spectrum[j] = silent[c] ? 0 : spectrum[j] * floorCurve[c][j];
+				}
+				InverseMDCT(mode.blockflag, spectrum, block.data());
+				std::fill(block.begin(), block.begin() + leftBegin, 0.0f);
+				for (uint32_t j = 0; j < leftSize; ++j)
+				{
+					block[leftBegin + j] *= leftWindow[j];
+				}
+				for (uint32_t j = 0; j < rightSize; ++j)
+				{
+					block[rightBegin + j] *= rightWindow[rightSize - 1 - j];
+				}
+				std::fill(block.begin() + rightBegin + rightSize, block.begin() + n, 0.0f);
+
+				for (uint32_t t = 0; t < count; ++t)
+				{
+					const uint32_t p = previousSize / 2 + t;
+					const int32_t b = int32_t(t + n / 4) - int32_t(previousSize / 4);
+					output[t * channels + c] = (p < previousSize ? previous[c][p - previousSize / 2] : 0) + (b >= 0 ? block[b] : 0);
+				}
+				std::copy(block.begin() + half, block.begin() + n, previous[c].begin());
+			}
+			previousSize = n;
+
+			// The frames before the current position and after the end of the stream are not returned:
+			const int64_t begin = outputPosition;
+			outputPosition += count;
+			const int64_t end = std::min(outputPosition, (int64_t)frameCount);
+			outputOffset = (size_t)std::max(int64_t(0), std::min((int64_t)count, (int64_t)position - begin));
+			outputCount = (size_t)std::max((int64_t)outputOffset, end - begin);
+			return true;
+		}
+		return false;
+	}
+
+	bool Decoder::DecodeFloor(const Floor& floor, BitReader& bits, std::vector<float>& curve, uint32_t n)
+	{
+		if (!bits.ReadFlag())
+		{
+			return false;
+		}
+		static const int ranges[4] = { 256, 128, 86, 64 };
+		const int range = ranges[floor.multiplier - 1];
+		const uint32_t count = (uint32_t)floor.x.size();
+		floorY.resize(count);
+		floorY[0] = (int32_t)bits.Read(ilog(range - 1));
+		floorY[1] = (int32_t)bits.Read(ilog(range - 1));
+		uint32_t offset = 2;
+		for (uint8_t partitionClass : floor.partitionClass)
+		{
+			const uint32_t dimensions = floor.classDimensions[partitionClass];
+			const uint32_t subclassBits = floor.classSubclasses[partitionClass];
+			const uint32_t subclassMask = (1u << subclassBits) - 1;
+			uint32_t subclass = 0;
+			if (subclassBits > 0)
+			{
+				const int entry = bits.DecodeEntry(codebooks[floor.classMasterbook[partitionClass]]);
+				if (entry < 0)
+				{
+					return false;
+				}
+				subclass = (uint32_t)entry;
+			}
+			for (uint32_t i = 0; i < dimensions; ++i)
+			{
+				const int book = floor.subclassBooks[partitionClass][subclass & subclassMask];
+				subclass >>= subclassBits;
+				floorY[offset + i] = 0;
+				if (book >= 0)
+				{
+					const int entry = bits.DecodeEntry(codebooks[book]);
+					if (entry < 0)
+					{
+						return false;
+					}
+					floorY[offset + i] = entry;
+				}
+			}
+			offset += dimensions;
+		}
+		if (bits.end)
+		{
+			return false;
+		}
+
+		// Amplitude values, predicted from the line between the neighbors:
+		bool used[65];
+		used[0] = true;
+		used[1] = true;
+		for (uint32_t i = 2; i < count; ++i)
+		{
+			const uint32_t low = floor.lowNeighbor[i];
+			const uint32_t high = floor.highNeighbor[i];
+			const int dy = floorY[high] - floorY[low];
+			const int dx = int(floor.x[high] - floor.x[low]);
+			const int error = std::abs(dy) * int(floor.x[i] - floor.x[low]);
+			const int predicted = dy < 0 ? floorY[low] - error / dx : floorY[low] + error / dx;
+			const int value = floorY[i];
+			const int highRoom = range - predicted;
+			const int lowRoom = predicted;
+			const int room = std::min(highRoom, lowRoom) * 2;
+			used[i] = value != 0;
+			if (value == 0)
+			{
+				floorY[i] = predicted;
+				continue;
+			}
+			used[low] = true;
+			used[high] = true;
+			if (value >= room)
+			{
+				floorY[i] = highRoom > lowRoom ? value - lowRoom + predicted : predicted - value + highRoom - 1;
+			}
+			else
+			{
+				floorY[i] = (value & 1) ? predicted - (value + 1) / 2 : predicted + value / 2;
+			}
+		}
+
+		// Curve, the lines between the used points in increasing x order:
+		auto render_line = [&](int x0, int y0, int x1, int y1) {
+			const int dy = y1 - y0;
+			const int dx = x1 - x0;
+			const int base = dy / dx;
+			const int step = dy < 0 ? base - 1 : base + 1;
+			const int slope = std::abs(dy) - std::abs(base) * dx;
+			int y = y0;
+			int error = 0;
+			for (int x = x0; x < std::min(x1, (int)n); ++x)
+			{
+				if (x > x0)
+				{
+					error += slope;
+					if (error >= dx)
+					{
+						error -= dx;
+						y += step;
+					}
+					else
+					{
+						y += base;
+					}
+				}
+				curve[x] = inverseDB.values[std::max(0, std::min(255, y))];
+			}
+		};
+		const int multiplier = (int)floor.multiplier;
+		int lx = 0;
+		int ly = floorY[floor.sorted[0]] * multiplier;
+		for (uint32_t i = 1; i < count; ++i)
+		{
+			const uint32_t index = floor.sorted[i];
+			if (used[index])
+			{
+				const int hx = (int)floor.x[index];
+				const int hy = floorY[index] * multiplier;
+				render_line(lx, ly, hx, hy);
+				lx = hx;
+				ly = hy;
+			}
+		}
+		if (lx < (int)n)
+		{
+			render_line(lx, ly, (int)n, ly);
+		}
+		return true;
+	}
+
+	void Decoder::DecodeResidue(const Residue& residue, BitReader& bits, uint32_t n, uint32_t count, std::vector<float>** vectors, const bool* skip)
+	{
+		// Residue type 2 is type 1 on the channels interleaved into one vector:
+		uint32_t vectorCount = count;
+		uint32_t size = n;
+		float* targets[256];
+		bool targetSkip[256];
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			targets[i] = vectors[i]->data();
+			targetSkip[i] = skip[i];
+		}
+		if (residue.type == 2)
+		{
+			bool any = false;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				any = any || !skip[i];
+			}
+			if (!any)
+			{
+				return;
+			}
+			interleaved.assign(n * count, 0.0f);
+			vectorCount = 1;
+			size = n * count;
+			targets[0] = interleaved.data();
+			targetSkip[0] = false;
+		}
+
+		const Codebook& classbook = codebooks[residue.classbook];
+		const uint32_t begin = std::min(residue.begin, size);
+		const uint32_t end = std::min(residue.end, size);
+		const uint32_t partitionCount = end > begin ? (end - begin) / residue.partitionSize : 0;
+		const uint32_t classwords = classbook.dimensions;
+		const uint32_t stride = partitionCount + classwords;
+		classes.resize(vectorCount * stride);
+
+		for (uint32_t pass = 0; pass < 8; ++pass)
+		{
+			uint32_t partition = 0;
+			while (partition < partitionCount)
+			{
+				if (pass == 0)
+				{
+					for (uint32_t j = 0; j < vectorCount; ++j)
+					{
+						if (targetSkip[j])
+						{
+							continue;
+						}
+						int entry = bits.DecodeEntry(classbook);
+						if (entry < 0)
+						{
+							goto done;
+						}
+						for (uint32_t i = classwords; i > 0; --i)
+						{
+							classes[j * stride + partition + i - 1] = uint8_t(entry % residue.classifications);
+							entry /= residue.classifications;
+						}
+					}
+				}
+				for (uint32_t i = 0; i < classwords && partition < partitionCount; ++i, ++partition)
+				{
+					for (uint32_t j = 0; j < vectorCount; ++j)
+					{
+						if (targetSkip[j])
+						{
+							continue;
+						}
+						const int book = residue.books[classes[j * stride + partition]][pass];
+						if (book < 0)
+						{
+							continue;
+						}
+						const Codebook& codebook = codebooks[book];
+						const uint32_t dimensions = codebook.dimensions;
+						float* dst = targets[j] + begin + partition * residue.partitionSize;
+						if (residue.type == 0)
+						{
+							const uint32_t step = residue.partitionSize / dimensions;
+							for (uint32_t k = 0; k < step; ++k)
+							{
+								const int entry = bits.DecodeEntry(codebook);
+								if (entry < 0)
+								{
+									goto done;
+								}
+								const float* values = codebook.vectors.data() + entry * dimensions;
+								for (uint32_t d = 0; d < dimensions; ++d)
+								{
+									dst[k + d * step] += values[d];
+								}
+							}
+						}
+						else
+						{
+							for (uint32_t k = 0; k < residue.partitionSize;)
+							{
+								const int entry = bits.DecodeEntry(codebook);
+								if (entry < 0)
+								{
+									goto done;
+								}
+								const float* values = codebook.vectors.data() + entry * dimensions;
+								for (uint32_t d = 0; d < dimensions && k < residue.partitionSize; ++d, ++k)
+								{
+									dst[k] += values[d];
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	done:
+
+		if (residue.type == 2)
+		{
+			for (uint32_t i = 0; i < n; ++i)
+			{
+				for (uint32_t j = 0; j < count; ++j)
+				{
+					(*vectors[j])[i] = interleaved[i * count + j];
+				}
+			}
+		}
+	}
+
+	void Decoder::InverseMDCT(uint32_t blockflag, const float* src, float* dst)
+	{
+		const uint32_t n = blocksize[blockflag];
+		const uint32_t n2 = n / 2;
+		const uint32_t n4 = n / 4;
+		// DCT-IV of the spectrum:
+		for (uint32_t i = 0; i < n4; ++i)
+		{
+			scratch[bitReverse[blockflag][i]] = std::complex<float>(src[2 * i], src[n2 - 1 - 2 * i]) * preTwiddle[blockflag][i];
+		}
+		for (uint32_t size = 2; size <= n4; size *= 2)
+		{
+			const uint32_t step = n4 / size;
+			for (uint32_t begin = 0; begin < n4; begin += size)
+			{
+				for (uint32_t k = 0; k < size / 2; ++k)
+				{
+					const std::complex<float> a = scratch[begin + k];
+					const std::complex<float> b = scratch[begin + k + size / 2] * fftTwiddle[blockflag][k * step];
+					scratch[begin + k] = a + b;
+					scratch[begin + k + size / 2] = a - b;
+				}
+			}
+		}
+		for (uint32_t i = 0; i < n4; ++i)
+		{
+			const std::complex<float> value = scratch[i] * postTwiddle[blockflag][i];
+			dct[2 * i] = value.real();
+			dct[n2 - 1 - 2 * i] = -value.imag();
+		}
+
+		// The inverse MDCT output is the DCT-IV extended with its symmetries, starting a quarter block later:
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			const uint32_t j = i + n4;
+			dst[i] = j < n2 ? dct[j] : (j < n ? -dct[n - 1 - j] : -dct[j - n]);
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+#include <complex>
+
+// Ogg Vorbis decoder of the software audio mixer, it decodes a Vorbis I stream from memory in small chunks
+//	Only the first logical stream of the Ogg file is decoded (chained streams are not supported).
+//	Floor type 0 is not supported, it is not written by any released encoder, these files fail to open.
+//	The positions are sample accurate, they are taken from the granule positions of the Ogg pages, so the encoder padding
+//	at the beginning and the end of the stream is not returned.
+namespace wiVorbis
+{
+	class Decoder
+	{
+	public:
+		// The data is not copied, it must stay valid while the decoder is used
+		//	returns false if the data is not a supported Ogg Vorbis stream
+		bool Open(const uint8_t* data, size_t size);
+		bool IsValid() const { return channels > 0; }
+
+		uint32_t GetChannels() const { return channels; }
+		uint32_t GetSampleRate() const { return sampleRate; }
+		// The length of the stream in frames (samples per channel)
+		uint64_t GetFrameCount() const { return frameCount; }
+		// The frame that the next Decode() starts with
+		uint64_t GetPosition() const { return position; }
+
+		// Decode at most frameCount frames from the current position into dst (interleaved, GetChannels() samples per frame)
+		//	returns the number of decoded frames, which is less than frameCount only at the end of the stream
+		size_t Decode(float* dst, size_t frameCount);
+		// Set the position, the decoder restarts from the closest Ogg page before the frame
+		void Seek(uint64_t frame);
+
+	private:
+		struct Page
+		{
+			size_t data = 0;			// offset of the first segment
+			size_t segmentTable = 0;	// offset of the lacing values
+			uint32_t segmentCount = 0;
+			int64_t granule = -1;		// -1 if no packet ends on the page
+			uint32_t lastPacketEnd = 0;	// the segment after the last segment that ends a packet
+			bool last = false;
+		};
+		struct Cursor
+		{
+			uint32_t page = 0;
+			uint32_t segment = 0;
+			size_t offset = 0;			// offset of the segment in the data
+		};
+		struct Codebook
+		{
+			uint32_t dimensions = 0;
+			uint32_t entries = 0;
+			std::vector<uint8_t> lengths;	// 0 for the unused entries
+			std::vector<float> vectors;		// entries * dimensions values, empty if the book has no lookup
+			std::vector<int32_t> fast;		// entry << 5 | codeword length, indexed by the first FAST_BITS bits, -1 if the codeword is longer
+			std::vector<int32_t> tree;		// pairs of child nodes, negative values are the leaves: -1 - entry, 0 is an invalid codeword
+			int32_t single = -1;			// the only entry if the book has a single codeword
+		};
+		struct Floor
+		{
+			std::vector<uint8_t> partitionClass;
+			uint8_t classDimensions[16] = {};
+			uint8_t classSubclasses[16] = {};
+			int16_t classMasterbook[16] = {};
+			int16_t subclassBooks[16][8] = {};
+			uint32_t multiplier = 1;
+			std::vector<uint32_t> x;			// x positions, in the order of the stream
+			std::vector<uint32_t> sorted;		// indices of x in increasing order
+			std::vector<uint32_t> lowNeighbor;
+			std::vector<uint32_t> highNeighbor;
+		};
+		struct Residue
+		{
+			uint32_t type = 0;
+			uint32_t begin = 0;
+			uint32_t end = 0;
+			uint32_t partitionSize = 0;
+			uint32_t classifications = 0;
+			uint32_t classbook = 0;
+			int16_t books[64][8] = {};		// -1 if the pass is not coded for the class
+		};
+		struct Mapping
+		{
+			std::vector<uint8_t> magnitude;
+			std::vector<uint8_t> angle;
+			std::vector<uint8_t> mux;			// submap of every channel
+			std::vector<uint8_t> submapFloor;
+			std::vector<uint8_t> submapResidue;
+		};
+		struct Mode
+		{
+			bool blockflag = false;
+			uint32_t mapping = 0;
+		};
+		struct BitReader;
+
+		const uint8_t* data = nullptr;
+		size_t dataSize = 0;
+		std::vector<Page> pages;
+		Cursor audioBegin;				// the first audio packet
+
+		uint32_t channels = 0;
+		uint32_t sampleRate = 0;
+		uint64_t frameCount = 0;
+		uint32_t blocksize[2] = {};
+		std::vector<Codebook> codebooks;
+		std::vector<Floor> floors;
+		std::vector<Residue> residues;
+		std::vector<Mapping> mappings;
+		std::vector<Mode> modes;
+
+		// inverse MDCT and window of the two block sizes:
+		std::vector<std::complex<float>> preTwiddle[2];
+		std::vector<std::complex<float>> postTwiddle[2];
+		std::vector<std::complex<float>> fftTwiddle[2];
+		std::vector<uint32_t> bitReverse[2];
+		std::vector<float> window[2];					// rising half of the window, blocksize / 2 values
+
+		// decoding state:
+		Cursor cursor;
+		std::vector<uint8_t> packet;
+		std::vector<std::vector<float>> previous;	// the second half of the previous windowed block of every channel
+		uint32_t previousSize = 0;					// 0 if there is no previous block
+		std::vector<float> block;					// the windowed inverse MDCT of the current block
+		std::vector<float> output;					// decoded frames, interleaved
+		size_t outputOffset = 0;					// frames of the output that are already returned
+		size_t outputCount = 0;
+		int64_t outputPosition = 0;					// the frame of the next decoded block
+		uint64_t position = 0;
+		std::vector<std::vector<float>> floorCurve;
+		std::vector<std::vector<float>> residue;
+		std::vector<int32_t> floorY;
+		std::vector<uint8_t> classes;				// residue partition classes
+		std::vector<float> interleaved;				// residue type 2 vector
+		std::vector<float> dct;
+		std::vector<std::complex<float>> scratch;
+
+		bool ReadPacket(Cursor& at, std::vector<uint8_t>& dst, int64_t& granule);
+		bool ReadHeaders();
+		uint32_t GetPacketBlocksize(const std::vector<uint8_t>& src) const;
+		// Returns false if the frame of the first decoded block after the cursor is unknown
+		bool Restart(const Cursor& at);
+		bool DecodePacket();
+		bool DecodeFloor(const Floor& floor, BitReader& bits, std::vector<float>& curve, uint32_t n);
+		void DecodeResidue(const Residue& residue, BitReader& bits, uint32_t n, uint32_t count, std::vector<float>** vectors, const bool* skip);
+		void InverseMDCT(uint32_t blockflag, const float* src, float* dst);
+	};
+}